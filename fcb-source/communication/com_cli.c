@@ -45,17 +45,34 @@
 #include "fcb_error.h"
 #include "pb_encode.h"
 #include "rotation_transformation.h"
+#include "kernel_benchmark.h"
+#include "variable_watch.h"
+#include "irq_latch.h"
+#include "cycle_counter.h"
+#include "control_phase.h"
+#include "slack_monitor.h"
+#include "adaptive_sampling.h"
+#include "uart.h"
+#include "sensor_injection.h"
+#include "settings_snapshot.h"
 
 #include <stdlib.h>
 #include <string.h>
 #include <stdarg.h>
 #include <stdio.h>
 #include <stdbool.h>
+#include <ctype.h>
+
+#if FCB_USE_CLI
 
 /* Private typedef -----------------------------------------------------------*/
 /* Private define ------------------------------------------------------------*/
 #define MAX_DATA_TRANSFER_DELAY         2000 // [ms]
 
+#if (2 * SETTINGS_SNAPSHOT_MAX_SIZE + 32) > MAX_CLI_COMMAND_SIZE
+#error "MAX_CLI_COMMAND_SIZE too small for import-settings"
+#endif
+
 /* Private function prototypes -----------------------------------------------*/
 
 static portBASE_TYPE CLIEcho(int8_t *pcWriteBuffer, size_t xWriteBufferLen, const int8_t *pcCommandString);
@@ -71,6 +88,8 @@ static portBASE_TYPE CLIGetSensors(int8_t *pcWriteBuffer, size_t xWriteBufferLen
 static portBASE_TYPE CLIStartSensorSampling(int8_t *pcWriteBuffer, size_t xWriteBufferLen, const int8_t *pcCommandString);
 static portBASE_TYPE CLIStopSensorSampling(int8_t *pcWriteBuffer, size_t xWriteBufferLen, const int8_t *pcCommandString);
 static portBASE_TYPE CLIStartAccMagMtrCalibration(int8_t *pcWriteBuffer, size_t xWriteBufferLen, const int8_t *pcCommandString);
+static portBASE_TYPE CLIGetSensorRates(int8_t* pcWriteBuffer, size_t xWriteBufferLen, const int8_t* pcCommandString);
+static portBASE_TYPE CLISetAdaptiveSampling(int8_t* pcWriteBuffer, size_t xWriteBufferLen, const int8_t* pcCommandString);
 static portBASE_TYPE CLIGetMotorValues(int8_t *pcWriteBuffer, size_t xWriteBufferLen, const int8_t *pcCommandString);
 static portBASE_TYPE CLIStartMotorSampling(int8_t *pcWriteBuffer, size_t xWriteBufferLen, const int8_t *pcCommandString);
 static portBASE_TYPE CLIStopMotorSampling(int8_t *pcWriteBuffer, size_t xWriteBufferLen, const int8_t *pcCommandString);
@@ -81,10 +100,31 @@ static portBASE_TYPE CLIGetRefSignals(int8_t* pcWriteBuffer, size_t xWriteBuffer
 static portBASE_TYPE CLIGetCtrlSignals(int8_t* pcWriteBuffer, size_t xWriteBufferLen, const int8_t* pcCommandString);
 static portBASE_TYPE CLISetMaxReferenceSignals(int8_t* pcWriteBuffer, size_t xWriteBufferLen, const int8_t* pcCommandString);
 static portBASE_TYPE CLIGetMaxReferenceSignals(int8_t* pcWriteBuffer, size_t xWriteBufferLen, const int8_t* pcCommandString);
+static portBASE_TYPE CLIExportSettings(int8_t* pcWriteBuffer, size_t xWriteBufferLen, const int8_t* pcCommandString);
+static portBASE_TYPE CLIImportSettings(int8_t* pcWriteBuffer, size_t xWriteBufferLen, const int8_t* pcCommandString);
 static portBASE_TYPE CLITaskStatus(int8_t* pcWriteBuffer, size_t xWriteBufferLen, const int8_t* pcCommandString);
 static portBASE_TYPE CLIGetStateValues(int8_t *pcWriteBuffer, size_t xWriteBufferLen, const int8_t *pcCommandString);
 static portBASE_TYPE CLIStartStateSampling(int8_t* pcWriteBuffer, size_t xWriteBufferLen, const int8_t* pcCommandString);
 static portBASE_TYPE CLIStopStateSampling(int8_t* pcWriteBuffer, size_t xWriteBufferLen, const int8_t* pcCommandString);
+static portBASE_TYPE CLIKernelBenchmark(int8_t* pcWriteBuffer, size_t xWriteBufferLen, const int8_t* pcCommandString);
+#if FCB_USE_VARIABLE_WATCH
+static portBASE_TYPE CLIWatchAdd(int8_t* pcWriteBuffer, size_t xWriteBufferLen, const int8_t* pcCommandString);
+static portBASE_TYPE CLIWatchClear(int8_t* pcWriteBuffer, size_t xWriteBufferLen, const int8_t* pcCommandString);
+static portBASE_TYPE CLIWatchList(int8_t* pcWriteBuffer, size_t xWriteBufferLen, const int8_t* pcCommandString);
+static portBASE_TYPE CLIStartWatch(int8_t* pcWriteBuffer, size_t xWriteBufferLen, const int8_t* pcCommandString);
+static portBASE_TYPE CLIStopWatch(int8_t* pcWriteBuffer, size_t xWriteBufferLen, const int8_t* pcCommandString);
+#endif
+static portBASE_TYPE CLIIrqLatency(int8_t* pcWriteBuffer, size_t xWriteBufferLen, const int8_t* pcCommandString);
+static portBASE_TYPE CLIGetPwmPhase(int8_t* pcWriteBuffer, size_t xWriteBufferLen, const int8_t* pcCommandString);
+static portBASE_TYPE CLISetPwmMargin(int8_t* pcWriteBuffer, size_t xWriteBufferLen, const int8_t* pcCommandString);
+static portBASE_TYPE CLIGetSlack(int8_t* pcWriteBuffer, size_t xWriteBufferLen, const int8_t* pcCommandString);
+static portBASE_TYPE CLIGetUartTx(int8_t* pcWriteBuffer, size_t xWriteBufferLen, const int8_t* pcCommandString);
+#if FCB_USE_SENSOR_INJECTION
+static portBASE_TYPE CLIStartInjection(int8_t* pcWriteBuffer, size_t xWriteBufferLen, const int8_t* pcCommandString);
+static portBASE_TYPE CLIStopInjection(int8_t* pcWriteBuffer, size_t xWriteBufferLen, const int8_t* pcCommandString);
+static portBASE_TYPE CLIGetInjection(int8_t* pcWriteBuffer, size_t xWriteBufferLen, const int8_t* pcCommandString);
+#endif
+static uint8_t HexDigitValue(const int8_t digit);
 
 /* Private variables ---------------------------------------------------------*/
 
@@ -177,6 +217,20 @@ static const CLI_Command_Definition_t startAccMagMtrCalibration = { (const int8_
         1 /* nbr of expected parameters */
 };
 
+/* Structure that defines the "get-sensor-rates" command line command. */
+static const CLI_Command_Definition_t getSensorRatesCommand = { (const int8_t * const ) "get-sensor-rates",
+        (const int8_t * const ) "\r\nget-sensor-rates <mode>:\r\n Prints requested and achieved accelerometer and magnetometer sampling rates, <mode> (p=print, r=print and reset)\r\n",
+        CLIGetSensorRates, /* The function to run. */
+        1 /* Number of parameters expected */
+};
+
+/* Structure that defines the "set-adaptive-sampling" command line command. */
+static const CLI_Command_Definition_t setAdaptiveSamplingCommand = { (const int8_t * const ) "set-adaptive-sampling",
+        (const int8_t * const ) "\r\nset-adaptive-sampling <mode>:\r\n Selects accelerometer and magnetometer rates from the state estimation, <mode> (e=enable, d=disable and sample at the highest rates)\r\n",
+        CLISetAdaptiveSampling, /* The function to run. */
+        1 /* Number of parameters expected */
+};
+
 /* Structure that defines the "get-motors" command line command. */
 static const CLI_Command_Definition_t getMotorsCommand = { (const int8_t * const ) "get-motors",
         (const int8_t * const ) "\r\nget-motors <encoding>:\r\n Prints motor control values with <enc> (n=none, p=proto)\r\n",
@@ -248,6 +302,20 @@ static const CLI_Command_Definition_t getMaxLimitReferenceSignalsCommand = { (co
         0 /* Number of parameters expected */
 };
 
+/* Structure that defines the "export-settings" command line command. */
+static const CLI_Command_Definition_t exportSettingsCommand = { (const int8_t * const ) "export-settings",
+        (const int8_t * const ) "\r\nexport-settings:\r\n Prints all settings stored in flash as one hexadecimal snapshot line\r\n",
+        CLIExportSettings, /* The function to run. */
+        0 /* Number of parameters expected */
+};
+
+/* Structure that defines the "import-settings" command line command. */
+static const CLI_Command_Definition_t importSettingsCommand = { (const int8_t * const ) "import-settings",
+        (const int8_t * const ) "\r\nimport-settings <snapshot>:\r\n Checks a hexadecimal settings snapshot and stores its settings in flash, only when disarmed\r\n",
+        CLIImportSettings, /* The function to run. */
+        1 /* Number of parameters expected */
+};
+
 /* Structure that defines the "task-status" command line command. */
 static const CLI_Command_Definition_t taskStatusCommand = { (const int8_t * const ) "task-status",
         (const int8_t * const ) "\r\ntask-status:\r\n Prints task status\r\n",
@@ -277,6 +345,108 @@ static const CLI_Command_Definition_t stopStateSamplingCommand = { (const int8_t
         0 /* Number of parameters expected */
 };
 
+/* Structure that defines the "kernel-benchmark" command line command. */
+static const CLI_Command_Definition_t kernelBenchmarkCommand = { (const int8_t * const ) "kernel-benchmark",
+        (const int8_t * const ) "\r\nkernel-benchmark <mode>:\r\n Benchmarks math/utility kernels, <mode> (r=run, b=run and set baseline, c=run and compare to baseline)\r\n",
+        CLIKernelBenchmark, /* The function to run. */
+        1 /* Number of parameters expected */
+};
+
+/* Structure that defines the "irq-latency" command line command. */
+static const CLI_Command_Definition_t irqLatencyCommand = { (const int8_t * const ) "irq-latency",
+        (const int8_t * const ) "\r\nirq-latency <mode>:\r\n Prints last and worst case control path interrupt latencies and the receiver interrupt rate, <mode> (p=print, r=print and reset)\r\n",
+        CLIIrqLatency, /* The function to run. */
+        1 /* Number of parameters expected */
+};
+
+/* Structure that defines the "get-pwm-phase" command line command. */
+static const CLI_Command_Definition_t getPwmPhaseCommand = { (const int8_t * const ) "get-pwm-phase",
+        (const int8_t * const ) "\r\nget-pwm-phase:\r\n Prints the control loop phase lock to the motor PWM update and resets min/max values\r\n",
+        CLIGetPwmPhase, /* The function to run. */
+        0 /* Number of parameters expected */
+};
+
+/* Structure that defines the "set-pwm-margin" command line command. */
+static const CLI_Command_Definition_t setPwmMarginCommand = { (const int8_t * const ) "set-pwm-margin",
+        (const int8_t * const ) "\r\nset-pwm-margin <us>:\r\n Sets the margin between control loop completion and motor PWM update\r\n",
+        CLISetPwmMargin, /* The function to run. */
+        1 /* Number of parameters expected */
+};
+
+/* Structure that defines the "get-slack" command line command. */
+static const CLI_Command_Definition_t getSlackCommand = { (const int8_t * const ) "get-slack",
+        (const int8_t * const ) "\r\nget-slack <mode>:\r\n Prints control loop headroom and shed work under CPU pressure, <mode> (p=print, r=print and reset)\r\n",
+        CLIGetSlack, /* The function to run. */
+        1 /* Number of parameters expected */
+};
+
+/* Structure that defines the "get-uart-tx" command line command. */
+static const CLI_Command_Definition_t getUartTxCommand = { (const int8_t * const ) "get-uart-tx",
+        (const int8_t * const ) "\r\nget-uart-tx:\r\n Prints UART transmit buffer usage and dropped data\r\n",
+        CLIGetUartTx, /* The function to run. */
+        0 /* Number of parameters expected */
+};
+
+#if FCB_USE_VARIABLE_WATCH
+/* Structure that defines the "watch-add" command line command. */
+static const CLI_Command_Definition_t watchAddCommand = { (const int8_t * const ) "watch-add",
+        (const int8_t * const ) "\r\nwatch-add <addr> <type>:\r\n Adds a RAM address to the variable watch, <type> (u8, i8, u16, i16, u32, i32, f32)\r\n",
+        CLIWatchAdd, /* The function to run. */
+        2 /* Number of parameters expected */
+};
+
+/* Structure that defines the "watch-clear" command line command. */
+static const CLI_Command_Definition_t watchClearCommand = { (const int8_t * const ) "watch-clear",
+        (const int8_t * const ) "\r\nwatch-clear:\r\n Removes all variables from the variable watch\r\n",
+        CLIWatchClear, /* The function to run. */
+        0 /* Number of parameters expected */
+};
+
+/* Structure that defines the "watch-list" command line command. */
+static const CLI_Command_Definition_t watchListCommand = { (const int8_t * const ) "watch-list",
+        (const int8_t * const ) "\r\nwatch-list:\r\n Lists the watched variables and the number of dropped samples\r\n",
+        CLIWatchList, /* The function to run. */
+        0 /* Number of parameters expected */
+};
+
+/* Structure that defines the "start-watch" command line command. */
+static const CLI_Command_Definition_t startWatchCommand = { (const int8_t * const ) "start-watch",
+        (const int8_t * const ) "\r\nstart-watch <div>:\r\n Streams watched variables every <div>:th flight control loop\r\n",
+        CLIStartWatch, /* The function to run. */
+        1 /* Number of parameters expected */
+};
+
+/* Structure that defines the "stop-watch" command line command. */
+static const CLI_Command_Definition_t stopWatchCommand = { (const int8_t * const ) "stop-watch",
+        (const int8_t * const ) "\r\nstop-watch:\r\n Stops streaming of watched variables\r\n",
+        CLIStopWatch, /* The function to run. */
+        0 /* Number of parameters expected */
+};
+#endif
+
+#if FCB_USE_SENSOR_INJECTION
+/* Structure that defines the "start-injection" command line command. */
+static const CLI_Command_Definition_t startInjectionCommand = { (const int8_t * const ) "start-injection",
+        (const int8_t * const ) "\r\nstart-injection <ch>:\r\n Replaces sensor data with binary frames on <ch> (u=USB, s=UART) and inhibits motors, only when disarmed\r\n",
+        CLIStartInjection, /* The function to run. */
+        1 /* Number of parameters expected */
+};
+
+/* Structure that defines the "stop-injection" command line command. */
+static const CLI_Command_Definition_t stopInjectionCommand = { (const int8_t * const ) "stop-injection",
+        (const int8_t * const ) "\r\nstop-injection:\r\n Stops sensor injection, motors stay inhibited until disarmed\r\n",
+        CLIStopInjection, /* The function to run. */
+        0 /* Number of parameters expected */
+};
+
+/* Structure that defines the "get-injection" command line command. */
+static const CLI_Command_Definition_t getInjectionCommand = { (const int8_t * const ) "get-injection",
+        (const int8_t * const ) "\r\nget-injection:\r\n Prints sensor injection state, frame counters and latency\r\n",
+        CLIGetInjection, /* The function to run. */
+        0 /* Number of parameters expected */
+};
+#endif
+
 static uint16_t dataOutLength = 0;
 static uint16_t outCnt = 0;
 
@@ -314,6 +484,8 @@ void RegisterCLICommands(void) {
     FreeRTOS_CLIRegisterCommand(&startSensorSamplingCommand);
     FreeRTOS_CLIRegisterCommand(&stopSensorSamplingCommand);
     FreeRTOS_CLIRegisterCommand(&startAccMagMtrCalibration);
+    FreeRTOS_CLIRegisterCommand(&getSensorRatesCommand);
+    FreeRTOS_CLIRegisterCommand(&setAdaptiveSamplingCommand);
 
     /* Motors CLI commands */
     FreeRTOS_CLIRegisterCommand(&getMotorsCommand);
@@ -324,6 +496,28 @@ void RegisterCLICommands(void) {
     FreeRTOS_CLIRegisterCommand(&aboutCommand);
     FreeRTOS_CLIRegisterCommand(&systimeCommand);
     FreeRTOS_CLIRegisterCommand(&taskStatusCommand);
+    FreeRTOS_CLIRegisterCommand(&kernelBenchmarkCommand);
+    FreeRTOS_CLIRegisterCommand(&irqLatencyCommand);
+    FreeRTOS_CLIRegisterCommand(&getPwmPhaseCommand);
+    FreeRTOS_CLIRegisterCommand(&setPwmMarginCommand);
+    FreeRTOS_CLIRegisterCommand(&getSlackCommand);
+    FreeRTOS_CLIRegisterCommand(&getUartTxCommand);
+
+#if FCB_USE_VARIABLE_WATCH
+    /* Variable watch CLI commands */
+    FreeRTOS_CLIRegisterCommand(&watchAddCommand);
+    FreeRTOS_CLIRegisterCommand(&watchClearCommand);
+    FreeRTOS_CLIRegisterCommand(&watchListCommand);
+    FreeRTOS_CLIRegisterCommand(&startWatchCommand);
+    FreeRTOS_CLIRegisterCommand(&stopWatchCommand);
+#endif
+
+#if FCB_USE_SENSOR_INJECTION
+    /* Sensor injection CLI commands */
+    FreeRTOS_CLIRegisterCommand(&startInjectionCommand);
+    FreeRTOS_CLIRegisterCommand(&stopInjectionCommand);
+    FreeRTOS_CLIRegisterCommand(&getInjectionCommand);
+#endif
 
     /* Flight control CLI commands */
     FreeRTOS_CLIRegisterCommand(&getFlightModeCommand);
@@ -334,6 +528,10 @@ void RegisterCLICommands(void) {
     FreeRTOS_CLIRegisterCommand(&getStatesCommand);
     FreeRTOS_CLIRegisterCommand(&startStateSamplingCommand);
     FreeRTOS_CLIRegisterCommand(&stopStateSamplingCommand);
+
+    /* Settings CLI commands */
+    FreeRTOS_CLIRegisterCommand(&exportSettingsCommand);
+    FreeRTOS_CLIRegisterCommand(&importSettingsCommand);
 }
 
 /**
@@ -1133,6 +1331,84 @@ static portBASE_TYPE CLIStartAccMagMtrCalibration(int8_t *pcWriteBuffer, size_t
     return pdFALSE; /* false indicates CLI activity completed */
 }
 
+/**
+ * @brief  Implements "get-sensor-rates" command, prints the sampling rates of one sensor per call
+ * @param  pcWriteBuffer : Reference to output buffer
+ * @param  xWriteBufferLen : Size of output buffer
+ * @param  pcCommandString : Command line string
+ * @retval pdTRUE if more data follows, pdFALSE if command activity finished
+ */
+static portBASE_TYPE CLIGetSensorRates(int8_t* pcWriteBuffer, size_t xWriteBufferLen, const int8_t* pcCommandString) {
+    int8_t* pcParameter;
+    portBASE_TYPE xParameterStringLength;
+    static AdaptiveSensor_TypeDef sensor = ADAPTIVE_SENSOR_ACC;
+    static bool resetAfterPrint = false;
+    AdaptiveSamplingStats_TypeDef stats;
+
+    configASSERT(pcWriteBuffer);
+
+    if (sensor == ADAPTIVE_SENSOR_ACC) {
+        pcParameter = (int8_t*) FreeRTOS_CLIGetParameter(pcCommandString, 1, &xParameterStringLength);
+        configASSERT(pcParameter);
+
+        if (pcParameter[0] != 'p' && pcParameter[0] != 'r') {
+            strncpy((char*) pcWriteBuffer, "Invalid parameter\r\n", xWriteBufferLen);
+            return pdFALSE;
+        }
+        resetAfterPrint = (pcParameter[0] == 'r');
+    }
+
+    GetAdaptiveSamplingStats(sensor, &stats);
+
+    snprintf((char*) pcWriteBuffer, xWriteBufferLen,
+            "%s%s: rate %u/%u Hz, achieved %u Hz, %lu samples, %lu rate changes\r\n"
+            " innovation RMS %.2f deg, error std %.2f deg\r\n",
+            (sensor == ADAPTIVE_SENSOR_ACC) ? (IsAdaptiveSamplingEnabled() ? "Adaptive sampling enabled\r\n" :
+                    "Adaptive sampling disabled\r\n") : "",
+            GetAdaptiveSensorName(sensor), stats.rateHz, stats.maxRateHz, stats.achievedRateHz, stats.samples,
+            stats.rateChanges, Radian2Degree(stats.innovationRms), Radian2Degree(stats.errorStd));
+
+    if (sensor + 1 >= ADAPTIVE_SENSOR_COUNT) {
+        if (resetAfterPrint)
+            ResetAdaptiveSamplingStats();
+        sensor = ADAPTIVE_SENSOR_ACC;
+        return pdFALSE;
+    }
+
+    sensor++;
+    return pdTRUE;
+}
+
+/**
+ * @brief  Implements "set-adaptive-sampling" command, enables or disables the adaptive sampling rates
+ * @param  pcWriteBuffer : Reference to output buffer
+ * @param  xWriteBufferLen : Size of output buffer
+ * @param  pcCommandString : Command line string
+ * @retval pdTRUE if more data follows, pdFALSE if command activity finished
+ */
+static portBASE_TYPE CLISetAdaptiveSampling(int8_t* pcWriteBuffer, size_t xWriteBufferLen, const int8_t* pcCommandString) {
+    int8_t* pcParameter;
+    portBASE_TYPE xParameterStringLength;
+
+    configASSERT(pcWriteBuffer);
+
+    pcParameter = (int8_t*) FreeRTOS_CLIGetParameter(pcCommandString, 1, &xParameterStringLength);
+    configASSERT(pcParameter);
+
+    if (pcParameter[0] == 'e') {
+        SetAdaptiveSamplingEnabled(true);
+        strncpy((char*) pcWriteBuffer, "Adaptive sampling enabled\r\n", xWriteBufferLen);
+    } else if (pcParameter[0] == 'd') {
+        SetAdaptiveSamplingEnabled(false);
+        strncpy((char*) pcWriteBuffer, "Adaptive sampling disabled, sampling at the highest rates\r\n",
+                xWriteBufferLen);
+    } else {
+        strncpy((char*) pcWriteBuffer, "Invalid parameter\r\n", xWriteBufferLen);
+    }
+
+    return pdFALSE;
+}
+
 /**
  * @brief  Implements CLI command to print the last control signal values sent to the motors
  * @param  pcWriteBuffer : Reference to output buffer
@@ -1607,6 +1883,110 @@ static portBASE_TYPE CLIGetMaxReferenceSignals(int8_t* pcWriteBuffer, size_t xWr
 
     return pdFALSE; /* Return false to indicate command activity finished */
 }
+
+/**
+ * @brief  Implements "export-settings" command, prints the settings snapshot as one hexadecimal line that is split
+ *         over as many calls as the output buffer requires
+ * @param  pcWriteBuffer : Reference to output buffer
+ * @param  xWriteBufferLen : Size of output buffer
+ * @param  pcCommandString : Command line string
+ * @retval pdTRUE if more data follows, pdFALSE if command activity finished
+ */
+static portBASE_TYPE CLIExportSettings(int8_t* pcWriteBuffer, size_t xWriteBufferLen, const int8_t* pcCommandString) {
+    static uint8_t snapshot[SETTINGS_SNAPSHOT_MAX_SIZE];
+    static uint16_t snapshotSize = 0;
+    static uint16_t printedSize = 0;
+    SettingsSnapshotStatus_TypeDef status;
+    uint32_t exportedMask;
+    size_t length = 0;
+
+    (void) pcCommandString;
+    configASSERT(pcWriteBuffer);
+
+    if (printedSize == 0) {
+        status = ExportSettingsSnapshot(snapshot, sizeof(snapshot), &snapshotSize, &exportedMask);
+        if (status != SETTINGS_SNAPSHOT_OK) {
+            snprintf((char*) pcWriteBuffer, xWriteBufferLen, "Settings export failed: %s\r\n",
+                    GetSettingsSnapshotStatusString(status));
+            return pdFALSE;
+        }
+    }
+
+    /* Leave room for the line end and string termination */
+    while (printedSize < snapshotSize && length + 5 <= xWriteBufferLen) {
+        snprintf((char*) &pcWriteBuffer[length], 3, "%02X", snapshot[printedSize]);
+        length += 2;
+        printedSize++;
+    }
+
+    if (printedSize < snapshotSize)
+        return pdTRUE;
+
+    strncpy((char*) &pcWriteBuffer[length], "\r\n", xWriteBufferLen - length);
+    printedSize = 0;
+    return pdFALSE;
+}
+
+/**
+ * @brief  Implements "import-settings" command, decodes a hexadecimal settings snapshot and imports it
+ * @param  pcWriteBuffer : Reference to output buffer
+ * @param  xWriteBufferLen : Size of output buffer
+ * @param  pcCommandString : Command line string
+ * @retval pdTRUE if more data follows, pdFALSE if command activity finished
+ */
+static portBASE_TYPE CLIImportSettings(int8_t* pcWriteBuffer, size_t xWriteBufferLen, const int8_t* pcCommandString) {
+    static uint8_t snapshot[SETTINGS_SNAPSHOT_MAX_SIZE];
+    SettingsSnapshotImport_TypeDef result;
+    SettingsSnapshotStatus_TypeDef status;
+    int8_t* pcParameter;
+    portBASE_TYPE xParameterStringLength;
+    uint16_t size;
+    uint16_t i;
+
+    configASSERT(pcWriteBuffer);
+
+    pcParameter = (int8_t*) FreeRTOS_CLIGetParameter(pcCommandString, 1, &xParameterStringLength);
+    configASSERT(pcParameter);
+
+    size = xParameterStringLength / 2;
+    if (xParameterStringLength % 2 != 0 || size > SETTINGS_SNAPSHOT_MAX_SIZE) {
+        strncpy((char*) pcWriteBuffer, "Invalid parameter\r\n", xWriteBufferLen);
+        return pdFALSE;
+    }
+
+    for (i = 0; i < size; i++) {
+        if (!isxdigit((unsigned char) pcParameter[2 * i]) || !isxdigit((unsigned char) pcParameter[2 * i + 1])) {
+            strncpy((char*) pcWriteBuffer, "Invalid parameter\r\n", xWriteBufferLen);
+            return pdFALSE;
+        }
+        snapshot[i] = (uint8_t) ((HexDigitValue(pcParameter[2 * i]) << 4) | HexDigitValue(pcParameter[2 * i + 1]));
+    }
+
+    status = ImportSettingsSnapshot(snapshot, size, &result);
+    if (status == SETTINGS_SNAPSHOT_OK) {
+        snprintf((char*) pcWriteBuffer, xWriteBufferLen,
+                "Settings imported from version %u snapshot, settings 0x%02lX, %u migrated and %u skipped fields\r\n",
+                result.version, result.importedMask, result.migratedFields, result.skippedFields);
+    } else {
+        snprintf((char*) pcWriteBuffer, xWriteBufferLen, "Settings import rejected: %s\r\n",
+                GetSettingsSnapshotStatusString(status));
+    }
+
+    return pdFALSE;
+}
+
+/**
+ * @brief  Returns the value of a hexadecimal digit
+ * @param  digit : Hexadecimal digit character, checked with isxdigit
+ * @retval Digit value, 0 to 15
+ */
+static uint8_t HexDigitValue(const int8_t digit) {
+    if (isdigit((unsigned char) digit))
+        return digit - '0';
+
+    return toupper((unsigned char) digit) - 'A' + 10;
+}
+
 /**
  * @brief  Implements "task-status" command, prints task status
  * @param  pcWriteBuffer : Reference to output buffer
@@ -1619,10 +1999,14 @@ static portBASE_TYPE CLITaskStatus(int8_t* pcWriteBuffer, size_t xWriteBufferLen
     (void) pcCommandString;
     configASSERT(pcWriteBuffer);
 
+#if defined(TASK_STATUS)
     strncpy((char*) pcWriteBuffer, "\nTask\t\t\t Abs Time\t % Time \tStack (rem b)\n", xWriteBufferLen);
     size_t len = strlen((char*) pcWriteBuffer);
     len += vTaskGetRunTimeStats(pcWriteBuffer + len, xWriteBufferLen-len);
     strncat((char*) pcWriteBuffer, "\n", xWriteBufferLen - len -1);
+#else
+    strncpy((char*) pcWriteBuffer, "Task run-time statistics not built, see TASK_STATUS\r\n", xWriteBufferLen);
+#endif
 
     return pdFALSE;
 }
@@ -1833,6 +2217,496 @@ static portBASE_TYPE CLIStopStateSampling(int8_t* pcWriteBuffer, size_t xWriteBu
     return pdFALSE;
 }
 
+/**
+ * @brief  Implements "kernel-benchmark" command, runs the kernel benchmarks and prints one result line per kernel
+ * @param  pcWriteBuffer : Reference to output buffer
+ * @param  xWriteBufferLen : Size of output buffer
+ * @param  pcCommandString : Command line string
+ * @retval pdTRUE if more data follows, pdFALSE if command activity finished
+ */
+static portBASE_TYPE CLIKernelBenchmark(int8_t* pcWriteBuffer, size_t xWriteBufferLen, const int8_t* pcCommandString) {
+    int8_t* pcParameter;
+    portBASE_TYPE xParameterStringLength;
+    static uint8_t benchmarkIndex = 0;
+    static bool compareToBaseline = false;
+
+    configASSERT(pcWriteBuffer);
+
+    memset(pcWriteBuffer, 0x00, xWriteBufferLen);
+
+    if (benchmarkIndex == 0) {
+        /* First call after the command has been entered: run the benchmarks and print the header */
+        pcParameter = (int8_t*) FreeRTOS_CLIGetParameter(pcCommandString, 1, &xParameterStringLength);
+        configASSERT(pcParameter);
+
+        if (pcParameter[0] != 'r' && pcParameter[0] != 'b' && pcParameter[0] != 'c') {
+            strncpy((char*) pcWriteBuffer, "Invalid parameter\r\n", xWriteBufferLen);
+            return pdFALSE;
+        }
+
+        if (RunKernelBenchmarks() != FCB_OK) {
+            strncpy((char*) pcWriteBuffer, "Kernel benchmarks only run in idle flight mode without calibration\r\n",
+                    xWriteBufferLen);
+            return pdFALSE;
+        }
+
+        if (pcParameter[0] == 'b')
+            SetKernelBenchmarkBaseline();
+        compareToBaseline = (pcParameter[0] != 'r');
+
+        snprintf((char*) pcWriteBuffer, xWriteBufferLen, "Kernel benchmarks (min/op @ %lu Hz):\r\n", SystemCoreClock);
+        benchmarkIndex++;
+        return pdTRUE;
+    }
+
+    /* Following calls: print one kernel result per call */
+    FormatKernelBenchmarkResult((char*) pcWriteBuffer, xWriteBufferLen - strlen("\r\n"), benchmarkIndex - 1,
+            compareToBaseline);
+    strncat((char*) pcWriteBuffer, "\r\n", xWriteBufferLen - strlen((char*) pcWriteBuffer) - 1);
+
+    if (benchmarkIndex >= GetKernelBenchmarkCount()) {
+        benchmarkIndex = 0;
+        return pdFALSE;
+    }
+
+    benchmarkIndex++;
+    return pdTRUE;
+}
+
+#if FCB_USE_VARIABLE_WATCH
+/**
+ * @brief  Implements "watch-add" command, adds an address and type to the variable watch
+ * @param  pcWriteBuffer : Reference to output buffer
+ * @param  xWriteBufferLen : Size of output buffer
+ * @param  pcCommandString : Command line string
+ * @retval pdTRUE if more data follows, pdFALSE if command activity finished
+ */
+static portBASE_TYPE CLIWatchAdd(int8_t* pcWriteBuffer, size_t xWriteBufferLen, const int8_t* pcCommandString) {
+    int8_t* pcParameter;
+    portBASE_TYPE xParameterStringLength;
+    uint32_t address;
+    WatchType_TypeDef type;
+
+    configASSERT(pcWriteBuffer);
+
+    /* Parameter 1 is the address, decimal or hexadecimal with 0x prefix */
+    pcParameter = (int8_t*) FreeRTOS_CLIGetParameter(pcCommandString, 1, &xParameterStringLength);
+    configASSERT(pcParameter);
+    address = strtoul((char*) pcParameter, NULL, 0);
+
+    /* Parameter 2 is the type name */
+    pcParameter = (int8_t*) FreeRTOS_CLIGetParameter(pcCommandString, 2, &xParameterStringLength);
+    configASSERT(pcParameter);
+
+    if (ParseWatchType((char*) pcParameter, &type) != FCB_OK) {
+        strncpy((char*) pcWriteBuffer, "Invalid type\r\n", xWriteBufferLen);
+    } else if (AddWatchVariable(address, type) != FCB_OK) {
+        strncpy((char*) pcWriteBuffer,
+                "Not added: address outside RAM or unaligned, list full or watch running\r\n", xWriteBufferLen);
+    } else {
+        snprintf((char*) pcWriteBuffer, xWriteBufferLen, "Watch %u: 0x%08lx %s\r\n",
+                GetWatchVariableCount() - 1, address, GetWatchTypeName(type));
+    }
+
+    return pdFALSE;
+}
+
+/**
+ * @brief  Implements "watch-clear" command, removes all variables from the variable watch
+ * @param  pcWriteBuffer : Reference to output buffer
+ * @param  xWriteBufferLen : Size of output buffer
+ * @param  pcCommandString : Command line string
+ * @retval pdTRUE if more data follows, pdFALSE if command activity finished
+ */
+static portBASE_TYPE CLIWatchClear(int8_t* pcWriteBuffer, size_t xWriteBufferLen, const int8_t* pcCommandString) {
+    /* Remove compile time warnings about unused parameters, and check the write buffer is not NULL */
+    (void) pcCommandString;
+    configASSERT(pcWriteBuffer);
+
+    if (ClearWatchVariables() == FCB_OK)
+        strncpy((char*) pcWriteBuffer, "Variable watch cleared\r\n", xWriteBufferLen);
+    else
+        strncpy((char*) pcWriteBuffer, "Stop the variable watch first\r\n", xWriteBufferLen);
+
+    return pdFALSE;
+}
+
+/**
+ * @brief  Implements "watch-list" command, prints one watched variable per call
+ * @param  pcWriteBuffer : Reference to output buffer
+ * @param  xWriteBufferLen : Size of output buffer
+ * @param  pcCommandString : Command line string
+ * @retval pdTRUE if more data follows, pdFALSE if command activity finished
+ */
+static portBASE_TYPE CLIWatchList(int8_t* pcWriteBuffer, size_t xWriteBufferLen, const int8_t* pcCommandString) {
+    static uint8_t watchIndex = 0;
+    WatchVariable_TypeDef variable;
+
+    /* Remove compile time warnings about unused parameters, and check the write buffer is not NULL */
+    (void) pcCommandString;
+    configASSERT(pcWriteBuffer);
+
+    if (watchIndex == 0) {
+        snprintf((char*) pcWriteBuffer, xWriteBufferLen, "Variable watch: %s, %u variables, %lu dropped samples\r\n",
+                IsVariableWatchRunning() ? "running" : "stopped", GetWatchVariableCount(),
+                GetVariableWatchDropCount());
+    } else {
+        GetWatchVariable(watchIndex - 1, &variable);
+        snprintf((char*) pcWriteBuffer, xWriteBufferLen, "%u: 0x%08lx %s\r\n", watchIndex - 1, variable.address,
+                GetWatchTypeName(variable.type));
+    }
+
+    if (watchIndex >= GetWatchVariableCount()) {
+        watchIndex = 0;
+        return pdFALSE;
+    }
+
+    watchIndex++;
+    return pdTRUE;
+}
+
+/**
+ * @brief  Implements "start-watch" command, starts streaming of the watched variables
+ * @param  pcWriteBuffer : Reference to output buffer
+ * @param  xWriteBufferLen : Size of output buffer
+ * @param  pcCommandString : Command line string
+ * @retval pdTRUE if more data follows, pdFALSE if command activity finished
+ */
+static portBASE_TYPE CLIStartWatch(int8_t* pcWriteBuffer, size_t xWriteBufferLen, const int8_t* pcCommandString) {
+    int8_t* pcParameter;
+    portBASE_TYPE xParameterStringLength;
+    int loopDivider;
+
+    configASSERT(pcWriteBuffer);
+
+    pcParameter = (int8_t*) FreeRTOS_CLIGetParameter(pcCommandString, 1, &xParameterStringLength);
+    configASSERT(pcParameter);
+    loopDivider = atoi((char*) pcParameter);
+
+    if (loopDivider < 1 || loopDivider > UINT16_MAX) {
+        strncpy((char*) pcWriteBuffer, "Invalid parameter\r\n", xWriteBufferLen);
+    } else if (StartVariableWatch((uint16_t) loopDivider) != FCB_OK) {
+        strncpy((char*) pcWriteBuffer, "Variable watch not started: list empty or already running\r\n",
+                xWriteBufferLen);
+    } else {
+        strncpy((char*) pcWriteBuffer, "Starting variable watch...\r\n", xWriteBufferLen);
+    }
+
+    return pdFALSE;
+}
+
+/**
+ * @brief  Implements "stop-watch" command, stops streaming of the watched variables
+ * @param  pcWriteBuffer : Reference to output buffer
+ * @param  xWriteBufferLen : Size of output buffer
+ * @param  pcCommandString : Command line string
+ * @retval pdTRUE if more data follows, pdFALSE if command activity finished
+ */
+static portBASE_TYPE CLIStopWatch(int8_t* pcWriteBuffer, size_t xWriteBufferLen, const int8_t* pcCommandString) {
+    /* Remove compile time warnings about unused parameters, and check the write buffer is not NULL */
+    (void) pcCommandString;
+    configASSERT(pcWriteBuffer);
+
+    strncpy((char*) pcWriteBuffer, "Stopping variable watch...\r\n", xWriteBufferLen);
+
+    StopVariableWatch();
+
+    return pdFALSE;
+}
+#endif /* FCB_USE_VARIABLE_WATCH */
+
+/**
+ * @brief  Implements "irq-latency" command, prints one latency measurement point per call
+ * @param  pcWriteBuffer : Reference to output buffer
+ * @param  xWriteBufferLen : Size of output buffer
+ * @param  pcCommandString : Command line string
+ * @retval pdTRUE if more data follows, pdFALSE if command activity finished
+ */
+static portBASE_TYPE CLIIrqLatency(int8_t* pcWriteBuffer, size_t xWriteBufferLen, const int8_t* pcCommandString) {
+    int8_t* pcParameter;
+    portBASE_TYPE xParameterStringLength;
+    static uint8_t latencyIndex = 0;
+    static bool resetAfterPrint = false;
+    IrqLatencyStats_TypeDef stats;
+    Receiver_CaptureStats_TypeDef receiverStats;
+
+    configASSERT(pcWriteBuffer);
+
+    if (latencyIndex == 0) {
+        pcParameter = (int8_t*) FreeRTOS_CLIGetParameter(pcCommandString, 1, &xParameterStringLength);
+        configASSERT(pcParameter);
+
+        if (pcParameter[0] != 'p' && pcParameter[0] != 'r') {
+            strncpy((char*) pcWriteBuffer, "Invalid parameter\r\n", xWriteBufferLen);
+            return pdFALSE;
+        }
+        resetAfterPrint = (pcParameter[0] == 'r');
+
+        GetReceiverCaptureStats(&receiverStats);
+        snprintf((char*) pcWriteBuffer, xWriteBufferLen,
+                "Interrupt latency (last/max ns), missed events: tick %lu, gyro %lu, acc %lu, mag %lu\r\n"
+                "Receiver: %lu interrupts/s, lost edges %lu, dropped edges %lu\r\n",
+                GetIrqEventMissedCount(IRQ_EVENT_CONTROL_TICK), GetIrqEventMissedCount(IRQ_EVENT_GYRO_DRDY),
+                GetIrqEventMissedCount(IRQ_EVENT_ACC_DRDY), GetIrqEventMissedCount(IRQ_EVENT_MAG_DRDY),
+                receiverStats.elapsedMs > 0
+                        ? (uint32_t) (receiverStats.interrupts * 1000ULL / receiverStats.elapsedMs) : 0,
+                receiverStats.lostEdges, receiverStats.droppedEdges);
+        latencyIndex++;
+        return pdTRUE;
+    }
+
+    /* Following calls: print one latency measurement point per call */
+    GetIrqLatencyStats((IrqLatency_TypeDef) (latencyIndex - 1), &stats);
+    snprintf((char*) pcWriteBuffer, xWriteBufferLen, "%-24s %8lu %8lu (n=%lu)\r\n",
+            GetIrqLatencyName((IrqLatency_TypeDef) (latencyIndex - 1)), CYCLES_TO_NS(stats.lastCycles),
+            CYCLES_TO_NS(stats.maxCycles), stats.count);
+
+    if (latencyIndex >= IRQ_LATENCY_COUNT) {
+        if (resetAfterPrint) {
+            ResetIrqLatencyStats();
+            ResetReceiverCaptureStats();
+        }
+        latencyIndex = 0;
+        return pdFALSE;
+    }
+
+    latencyIndex++;
+    return pdTRUE;
+}
+
+/**
+ * @brief  Implements "get-pwm-phase" command, prints the phase lock of the control loop to the motor PWM update event
+ * @param  pcWriteBuffer : Reference to output buffer
+ * @param  xWriteBufferLen : Size of output buffer
+ * @param  pcCommandString : Command line string
+ * @retval pdTRUE if more data follows, pdFALSE if command activity finished
+ */
+static portBASE_TYPE CLIGetPwmPhase(int8_t* pcWriteBuffer, size_t xWriteBufferLen, const int8_t* pcCommandString) {
+    ControlPhaseStats_TypeDef stats;
+
+    configASSERT(pcWriteBuffer);
+
+    GetControlPhaseStats(&stats);
+    ResetControlPhaseStats();
+
+    snprintf((char*) pcWriteBuffer, xWriteBufferLen,
+            "PWM phase lock: %s, margin %u us, error %ld us, adjust %ld ticks, execution %lu us\r\n"
+            "Slack [us] last/min/max: %lu/%lu/%lu\r\nOutput latency [us] last/max: %lu/%lu\r\n",
+            stats.locked ? "locked" : "unlocked", GetControlPhaseMargin(),
+            stats.lastError / CONTROL_PHASE_TICKS_PER_US, stats.lastAdjust,
+            stats.executionTime / CONTROL_PHASE_TICKS_PER_US, stats.lastSlack / CONTROL_PHASE_TICKS_PER_US,
+            stats.minSlack / CONTROL_PHASE_TICKS_PER_US, stats.maxSlack / CONTROL_PHASE_TICKS_PER_US,
+            stats.lastOutputLatency / CONTROL_PHASE_TICKS_PER_US, stats.maxOutputLatency / CONTROL_PHASE_TICKS_PER_US);
+
+    return pdFALSE;
+}
+
+/**
+ * @brief  Implements "set-pwm-margin" command, sets the margin between control loop completion and PWM update event
+ * @param  pcWriteBuffer : Reference to output buffer
+ * @param  xWriteBufferLen : Size of output buffer
+ * @param  pcCommandString : Command line string
+ * @retval pdTRUE if more data follows, pdFALSE if command activity finished
+ */
+static portBASE_TYPE CLISetPwmMargin(int8_t* pcWriteBuffer, size_t xWriteBufferLen, const int8_t* pcCommandString) {
+    int8_t* pcParameter;
+    portBASE_TYPE xParameterStringLength;
+    int marginUs;
+
+    configASSERT(pcWriteBuffer);
+
+    pcParameter = (int8_t*) FreeRTOS_CLIGetParameter(pcCommandString, 1, &xParameterStringLength);
+    configASSERT(pcParameter);
+    marginUs = atoi((char*) pcParameter);
+
+    if (marginUs < 0 || marginUs > UINT16_MAX || SetControlPhaseMargin((uint16_t) marginUs) != FCB_OK) {
+        snprintf((char*) pcWriteBuffer, xWriteBufferLen, "Invalid parameter, margin range %u-%u us\r\n",
+                CONTROL_PHASE_MIN_MARGIN_US, (unsigned int) CONTROL_PHASE_MAX_MARGIN_US);
+    } else {
+        snprintf((char*) pcWriteBuffer, xWriteBufferLen, "PWM margin set to %u us\r\n", GetControlPhaseMargin());
+    }
+
+    return pdFALSE;
+}
+
+/**
+ * @brief  Implements "get-slack" command, prints the slack monitor state followed by one shedding level or
+ *         deferrable work per call
+ * @param  pcWriteBuffer : Reference to output buffer
+ * @param  xWriteBufferLen : Size of output buffer
+ * @param  pcCommandString : Command line string
+ * @retval pdTRUE if more data follows, pdFALSE if command activity finished
+ */
+static portBASE_TYPE CLIGetSlack(int8_t* pcWriteBuffer, size_t xWriteBufferLen, const int8_t* pcCommandString) {
+    int8_t* pcParameter;
+    portBASE_TYPE xParameterStringLength;
+    static uint8_t lineIndex = 0;
+    static bool resetAfterPrint = false;
+    static SlackMonitorStats_TypeDef stats;
+    uint8_t divider;
+
+    configASSERT(pcWriteBuffer);
+
+    if (lineIndex == 0) {
+        pcParameter = (int8_t*) FreeRTOS_CLIGetParameter(pcCommandString, 1, &xParameterStringLength);
+        configASSERT(pcParameter);
+
+        if (pcParameter[0] != 'p' && pcParameter[0] != 'r') {
+            strncpy((char*) pcWriteBuffer, "Invalid parameter\r\n", xWriteBufferLen);
+            return pdFALSE;
+        }
+        resetAfterPrint = (pcParameter[0] == 'r');
+
+        /* Print from a snapshot so that all lines are consistent */
+        GetSlackMonitorStats(&stats);
+        snprintf((char*) pcWriteBuffer, xWriteBufferLen,
+                "Slack level %s, %lu level changes in %lu cycles\r\nHeadroom [us] last/window/min: %lu/%lu/%lu\r\n"
+                "Deadline misses %lu, skipped control ticks %lu\r\n",
+                GetSlackLevelName(stats.level), stats.levelChanges, stats.cycles,
+                CYCLES_TO_NS(stats.lastHeadroom) / 1000,
+                (stats.windowMinHeadroom != UINT32_MAX) ? CYCLES_TO_NS(stats.windowMinHeadroom) / 1000 : 0,
+                (stats.minHeadroom != UINT32_MAX) ? CYCLES_TO_NS(stats.minHeadroom) / 1000 : 0,
+                stats.deadlineMisses, stats.overruns);
+        lineIndex++;
+        return pdTRUE;
+    }
+
+    /* Following calls: print the cycles at each level, then the shedding of each work */
+    if (lineIndex <= SLACK_LEVEL_COUNT) {
+        snprintf((char*) pcWriteBuffer, xWriteBufferLen, "Level %-12s %10lu cycles\r\n",
+                GetSlackLevelName((SlackLevel_TypeDef) (lineIndex - 1)), stats.cyclesAtLevel[lineIndex - 1]);
+    } else {
+        const SlackWork_TypeDef work = (SlackWork_TypeDef) (lineIndex - 1 - SLACK_LEVEL_COUNT);
+
+        divider = GetSlackRateDivider(work);
+        if (divider != 0) {
+            snprintf((char*) pcWriteBuffer, xWriteBufferLen, "Work  %-12s rate 1/%u, shed %lu\r\n",
+                    GetSlackWorkName(work), divider, stats.shedCount[work]);
+        } else {
+            snprintf((char*) pcWriteBuffer, xWriteBufferLen, "Work  %-12s deferred, shed %lu\r\n",
+                    GetSlackWorkName(work), stats.shedCount[work]);
+        }
+    }
+
+    if (lineIndex >= SLACK_LEVEL_COUNT + SLACK_WORK_COUNT) {
+        if (resetAfterPrint)
+            ResetSlackMonitorStats();
+        lineIndex = 0;
+        return pdFALSE;
+    }
+
+    lineIndex++;
+    return pdTRUE;
+}
+
+/**
+ * @brief  Implements "get-uart-tx" command, prints the UART transmit statistics
+ * @param  pcWriteBuffer : Reference to output buffer
+ * @param  xWriteBufferLen : Size of output buffer
+ * @param  pcCommandString : Command line string
+ * @retval pdTRUE if more data follows, pdFALSE if command activity finished
+ */
+static portBASE_TYPE CLIGetUartTx(int8_t* pcWriteBuffer, size_t xWriteBufferLen, const int8_t* pcCommandString) {
+    UartTxStats_TypeDef stats;
+
+    configASSERT(pcWriteBuffer);
+
+    GetUartTxStats(&stats);
+
+    snprintf((char*) pcWriteBuffer, xWriteBufferLen,
+            "UART TX: %lu bytes in %lu DMA spans, buffer max %u/%u bytes\r\n"
+            "Dropped: %lu writes, %lu bytes, DMA errors %lu\r\n",
+            stats.sentBytes, stats.spans, stats.maxUsed, stats.bufferSize, stats.droppedWrites, stats.droppedBytes,
+            stats.dmaErrors);
+
+    return pdFALSE;
+}
+
+#if FCB_USE_SENSOR_INJECTION
+/**
+ * @brief  Implements "start-injection" command, starts replacing sensor data with frames received on a channel
+ * @param  pcWriteBuffer : Reference to output buffer
+ * @param  xWriteBufferLen : Size of output buffer
+ * @param  pcCommandString : Command line string
+ * @retval pdTRUE if more data follows, pdFALSE if command activity finished
+ */
+static portBASE_TYPE CLIStartInjection(int8_t* pcWriteBuffer, size_t xWriteBufferLen, const int8_t* pcCommandString) {
+    int8_t* pcParameter;
+    portBASE_TYPE xParameterStringLength;
+    SensorInjectionChannel_TypeDef channel;
+
+    configASSERT(pcWriteBuffer);
+
+    pcParameter = (int8_t*) FreeRTOS_CLIGetParameter(pcCommandString, 1, &xParameterStringLength);
+    configASSERT(pcParameter);
+
+    if (pcParameter[0] == 'u') {
+        channel = SENSOR_INJECTION_USB;
+    } else if (pcParameter[0] == 's') {
+        channel = SENSOR_INJECTION_UART;
+    } else {
+        strncpy((char*) pcWriteBuffer, "Invalid parameter\r\n", xWriteBufferLen);
+        return pdFALSE;
+    }
+
+    if (StartSensorInjection(channel) != FCB_OK) {
+        strncpy((char*) pcWriteBuffer, "Sensor injection not started: armed, calibrating or already running\r\n",
+                xWriteBufferLen);
+    } else {
+        strncpy((char*) pcWriteBuffer, "Starting sensor injection...\r\n", xWriteBufferLen);
+    }
+
+    return pdFALSE;
+}
+
+/**
+ * @brief  Implements "stop-injection" command, stops sensor injection
+ * @param  pcWriteBuffer : Reference to output buffer
+ * @param  xWriteBufferLen : Size of output buffer
+ * @param  pcCommandString : Command line string
+ * @retval pdTRUE if more data follows, pdFALSE if command activity finished
+ */
+static portBASE_TYPE CLIStopInjection(int8_t* pcWriteBuffer, size_t xWriteBufferLen, const int8_t* pcCommandString) {
+    /* Remove compile time warnings about unused parameters, and check the write buffer is not NULL */
+    (void) pcCommandString;
+    configASSERT(pcWriteBuffer);
+
+    strncpy((char*) pcWriteBuffer, "Stopping sensor injection...\r\n", xWriteBufferLen);
+
+    StopSensorInjection();
+
+    return pdFALSE;
+}
+
+/**
+ * @brief  Implements "get-injection" command, prints the sensor injection state and statistics
+ * @param  pcWriteBuffer : Reference to output buffer
+ * @param  xWriteBufferLen : Size of output buffer
+ * @param  pcCommandString : Command line string
+ * @retval pdTRUE if more data follows, pdFALSE if command activity finished
+ */
+static portBASE_TYPE CLIGetInjection(int8_t* pcWriteBuffer, size_t xWriteBufferLen, const int8_t* pcCommandString) {
+    static const char* const stateNames[] = { "off", "active", "stopping (motors inhibited)" };
+    SensorInjectionStats_TypeDef stats;
+
+    /* Remove compile time warnings about unused parameters, and check the write buffer is not NULL */
+    (void) pcCommandString;
+    configASSERT(pcWriteBuffer);
+
+    GetSensorInjectionStats(&stats);
+
+    snprintf((char*) pcWriteBuffer, xWriteBufferLen,
+            "Sensor injection: %s\r\nFrames: %lu, bad: %lu, dropped bytes: %lu, overruns: %lu\r\n"
+            "Motor frames: %lu, dropped: %lu\r\nLatency [us] last/max: %lu/%lu\r\n",
+            stateNames[GetSensorInjectionState()], stats.frames, stats.badFrames, stats.droppedBytes,
+            stats.overruns, stats.motorFrames, stats.motorDrops, stats.lastLatencyUs, stats.maxLatencyUs);
+
+    return pdFALSE;
+}
+#endif /* FCB_USE_SENSOR_INJECTION */
+
+#endif /* FCB_USE_CLI */
+
 /**
  * @}
  */
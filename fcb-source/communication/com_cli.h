@@ -9,6 +9,7 @@
 
 /* Includes ------------------------------------------------------------------*/
 #include "stm32f3xx.h"
+#include "build_profile.h"
 
 #include "FreeRTOS.h"
 #include "task.h"
@@ -18,7 +19,7 @@
 /* Exported types ------------------------------------------------------------*/
 
 /* Exported constants --------------------------------------------------------*/
-#define MAX_CLI_COMMAND_SIZE    256
+#define MAX_CLI_COMMAND_SIZE    384     // Fits import-settings with a hexadecimal settings snapshot
 #define MAX_CLI_OUTPUT_SIZE     256
 
 /* Exported macro ------------------------------------------------------------*/
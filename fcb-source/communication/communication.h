@@ -24,6 +24,10 @@ enum ProtoMessageTypeEnum {
     SIMULATED_STATES_MSG_ENUM,
 	CTRLSIGNALS_MSG_ENUM,
 	GENERIC_MSG_ENUM, // TODO define proto for this, e.g. one string for generic messages
+	WATCH_SAMPLES_MSG_ENUM, // Raw variable watch samples, see variable_watch.c
+	SENSOR_INJECTION_MSG_ENUM, // Injected sensor frames from host, see sensor_injection.c
+	INJECTION_MOTORS_MSG_ENUM, // Motor commands computed from injected sensor frames
+	FLIGHT_LINK_MSG_ENUM, // Flight link requests and responses, see flight_link.c
 };
 
 #define	PROTO_HEADER_LEN	7
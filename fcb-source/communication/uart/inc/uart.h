@@ -14,6 +14,16 @@ typedef enum {
     UART_FAIL = 0, UART_OK = !UART_FAIL
 } UartStatus;
 
+typedef struct {
+    uint16_t bufferSize;        // Transmit ring buffer size [bytes]
+    uint16_t maxUsed;           // Most bytes buffered at once
+    uint32_t sentBytes;
+    uint32_t spans;             // DMA transfers started
+    uint32_t droppedWrites;     // UartSendData() calls dropped because the buffer was full
+    uint32_t droppedBytes;
+    uint32_t dmaErrors;
+} UartTxStats_TypeDef;
+
 /* Exported constants --------------------------------------------------------*/
 
 /* Definition for USARTx clock resources */
@@ -34,6 +44,10 @@ typedef enum {
 /* Definition for UART's DMA */
 #define UART_TX_DMA_STREAM            	DMA1_Channel7
 #define UART_RX_DMA_STREAM              DMA1_Channel6
+#define UART_TX_DMA                     DMA1
+#define UART_TX_DMA_FLAG_TC             DMA_ISR_TCIF7
+#define UART_TX_DMA_FLAG_TE             DMA_ISR_TEIF7
+#define UART_TX_DMA_CLEAR_FLAGS         DMA_IFCR_CGIF7
 
 /* Definition for UART's NVIC */
 #define UART_DMA_TX_IRQn               	DMA1_Channel7_IRQn
@@ -58,12 +72,12 @@ UART_HandleTypeDef UartHandle;
 /* Exported functions ------------------------------------------------------- */
 void UartConfig(void);
 void CreateUARTComTasks(void);
-void CreateUARTComQueues(void);
 void CreateUARTComSemaphores(void);
 UartStatus UartSendData(const uint8_t* sendData, const uint16_t sendDataSize);
 UartStatus UartSendString(const char* sendString);
+void GetUartTxStats(UartTxStats_TypeDef* stats);
 void HandleUartRxCallback(UART_HandleTypeDef* UartHandle);
-void HandleUartTxCallback(UART_HandleTypeDef* UartHandle);
+void HandleUartTxDmaIRQ(void);
 void HandleUartErrorCallback(UART_HandleTypeDef* UartHandle);
 
 #endif /* __UART_H */
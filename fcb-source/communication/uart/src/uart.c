@@ -1,5 +1,11 @@
 /*****************************************************************************
  * @brief   Module contains UART initialization and handling functions.
+ *
+ *          Transmitted data is appended to a transmit ring buffer that is
+ *          drained by the TX DMA channel in contiguous spans. The DMA transfer
+ *          complete interrupt starts the next span until the buffer is empty,
+ *          so the line is kept busy without any task involvement and sending
+ *          never blocks. Writes that do not fit are dropped and counted.
  ******************************************************************************/
 
 /* Includes ------------------------------------------------------------------*/
@@ -7,8 +13,11 @@
 
 #include "com_cli.h"
 #include "fifo_buffer.h"
+#include "tx_ring_buffer.h"
 #include "fcb_error.h"
 #include "communication.h"
+#include "sensor_injection.h"
+#include "flight_link.h"
 
 #include <string.h>
 
@@ -24,12 +33,11 @@
 #define UART_TX_BUFFER_SIZE         512
 
 #define UART_RX_TASK_PRIO           1
-#define UART_TX_TASK_PRIO           2
 
-#define UART_COM_TX_QUEUE_ITEMS     16
 #define UART_RX_MAX_SEM_COUNT       32
 
 #define UART_COM_MAX_DELAY          1000 // [ms]
+#define UART_TX_DRAIN_POLL_MS       5
 
 /* Private macro -------------------------------------------------------------*/
 
@@ -40,25 +48,25 @@ uint8_t rxByte = 0;
 uint8_t UartRxBufferArray[UART_RX_BUFFER_SIZE];
 volatile FIFOBuffer_TypeDef UartRxFIFOBuffer;
 
-/* UART Transmit FIFO buffer */
+/* UART Transmit ring buffer */
 uint8_t UartTxBufferArray[UART_TX_BUFFER_SIZE];
-volatile FIFOBuffer_TypeDef UartTxFIFOBuffer;
+TxRingBuffer_TypeDef UartTxRingBuffer;
+volatile uint32_t UartTxDmaErrors = 0;
 
 /* UART RTOS variables */
 xTaskHandle UartRxTaskHandle;
-xTaskHandle UartTxTaskHandle;
-
-xQueueHandle UartTxQueue;
 
 xSemaphoreHandle UartRxDataSem;
-xSemaphoreHandle UartTxBufferMutex;
-xSemaphoreHandle UartTxBinarySem;
 
 /* Private function prototypes -----------------------------------------------*/
 static void InitUartCom(void);
+static void EnableUartTxStream(void);
+static void StartUartTxSpan(void);
+#if FCB_USE_CLI
+static void WaitForUartTxSpace(const uint16_t size);
+#endif
 
 static void UartRxTask(void const *argument);
-static void UartTxTask(void const *argument);
 
 /* Exported functions --------------------------------------------------------*/
 
@@ -86,6 +94,10 @@ void UartConfig(void) {
     if(HAL_UART_Init(&UartHandle) != HAL_OK) {
         ErrorHandler();
     }
+
+    /* Transmit ring buffer is set up here, so that data can be sent before the UART tasks run */
+    TxRingBufferInit(&UartTxRingBuffer, UartTxBufferArray, sizeof(UartTxBufferArray));
+    EnableUartTxStream();
 }
 
 /*
@@ -106,17 +118,26 @@ void HandleUartRxCallback(UART_HandleTypeDef* UartHandle) {
 }
 
 /*
- * @brief  Handles the UART Tx Callback
+ * @brief  Handles the UART TX DMA interrupt. Releases the span that has been sent and chains the next span of the
+ *         transmit ring buffer, if any.
  * @param  None.
  * @retval None.
  */
-void HandleUartTxCallback(UART_HandleTypeDef* UartHandle) {
-    portBASE_TYPE xHigherPriorityTaskWoken = pdFALSE;
+void HandleUartTxDmaIRQ(void) {
+    const uint32_t flags = UART_TX_DMA->ISR;
 
-    (void) UartHandle; // To avoid warnings
+    if (!(flags & (UART_TX_DMA_FLAG_TC | UART_TX_DMA_FLAG_TE)))
+        return;
+
+    UART_TX_DMA->IFCR = UART_TX_DMA_CLEAR_FLAGS;
+    UART_TX_DMA_STREAM->CCR &= ~DMA_CCR_EN;
+
+    /* A span with a transfer error is released as well, retrying a failing bus access would stall the stream */
+    if (flags & UART_TX_DMA_FLAG_TE)
+        UartTxDmaErrors++;
+    TxRingBufferCompleteSpan(&UartTxRingBuffer);
 
-    xSemaphoreGiveFromISR(UartTxBinarySem, &xHigherPriorityTaskWoken);
-    portYIELD_FROM_ISR(xHigherPriorityTaskWoken);
+    StartUartTxSpan();
 }
 
 /*
@@ -125,12 +146,31 @@ void HandleUartTxCallback(UART_HandleTypeDef* UartHandle) {
  * @retval None.
  */
 void HandleUartErrorCallback(UART_HandleTypeDef* UartHandle) {
+    uint16_t unsentSize = 0;
+
+    /* Stop the TX DMA channel and count the bytes of the span that have not left the UART. A byte still in the
+     * transmit data register is lost by the re-initialization. */
+    UART_TX_DMA_STREAM->CCR &= ~DMA_CCR_EN;
+    if (!TxRingBufferIsIdle(&UartTxRingBuffer)) {
+        unsentSize = UART_TX_DMA_STREAM->CNDTR;
+        if (!(UART->ISR & USART_ISR_TXE))
+            unsentSize++;
+    }
+
     if(HAL_UART_DeInit(UartHandle) != HAL_OK) {
         ErrorHandler();
     }
     if(HAL_UART_Init(UartHandle) != HAL_OK) {
         ErrorHandler();
     }
+
+    /* Re-initialization resets the TX DMA channel, release the sent bytes and resume with the rest of the span */
+    if (unsentSize < UartTxRingBuffer.spanSize)
+        TxRingBufferAbortSpan(&UartTxRingBuffer, UartTxRingBuffer.spanSize - unsentSize);
+    else
+        TxRingBufferAbortSpan(&UartTxRingBuffer, 0);
+    EnableUartTxStream();
+    StartUartTxSpan();
 }
 
 /*
@@ -151,32 +191,6 @@ void CreateUARTComTasks(void) {
             UART_RX_TASK_PRIO, &UartRxTaskHandle)) {
         ErrorHandler();
     }
-
-    /* UART Tx handler task creation
-     * Task function pointer: UartTxTask
-     * Task name: UART_TX
-     * Stack depth: 3*configMINIMAL_STACK_SIZE
-     * Parameter: NULL
-     * Priority: UART_TX_THREAD_PRIO (0 to configMAX_PRIORITIES-1 possible)
-     * Handle: UartTxTaskHandle
-     * */
-    if (pdPASS != xTaskCreate((pdTASK_CODE )UartTxTask, (signed portCHAR*)"UART_TX", 1*configMINIMAL_STACK_SIZE,
-            NULL, UART_TX_TASK_PRIO, &UartTxTaskHandle)) {
-        ErrorHandler();
-    }
-}
-
-/*
- * @brief  Create UART Tx Queue
- * @param  None.
- * @retval None.
- */
-void CreateUARTComQueues(void) {
-    /* # Create queue for outgoing data ####################################### */
-    UartTxQueue = xQueueCreate(UART_COM_TX_QUEUE_ITEMS, sizeof(ComTxQueueItem_TypeDef));
-
-    /* We want this queue to be viewable in a RTOS kernel aware debugger, so register it. */
-    vQueueAddToRegistry(UartTxQueue, (signed portCHAR*) "UartTxQueue");
 }
 
 /*
@@ -190,70 +204,57 @@ void CreateUARTComSemaphores(void) {
     if (UartRxDataSem == NULL) {
         ErrorHandler();
     }
-
-    UartTxBufferMutex = xSemaphoreCreateMutex();
-    if (UartTxBufferMutex == NULL) {
-        ErrorHandler();
-    }
-
-    /* Create binary semaphore to synchronize UART output/TX. The semaphore is taken when device is
-     * transmitting (UART DMA busy) and given when transfer has completed. */
-    UartTxBinarySem = xSemaphoreCreateBinary();
-    if (UartTxBinarySem == NULL) {
-        ErrorHandler();
-    }
 }
 
 /**
- * @brief  Send data over UART interface. The data is entered into an output FIFO buffer which is then entered is
- *         then referred to into a queue. Both the FIFO buffer and the queue are protected by semaphore which needs to pended on.
+ * @brief  Send data over UART interface. The data is appended to the transmit ring buffer and sent by DMA in the
+ *         background. Never blocks, data that does not fit in the buffer is dropped.
  * @param  sendData : Reference to the data to be sent
  * @param  sendDataSize : Size of data to be sent
- * @param  maxMutexWaitTicks : Max ticks to wait for the FIFO buffer mutex
- * @param  maxQueueWaitTicks : Max ticks to wait for the queue
- * @retval Result of the operation: UART_OK if all operations are OK else UART_FAIL
+ * @retval Result of the operation: UART_OK if the data was buffered, UART_FAIL if it was dropped
  */
 UartStatus UartSendData(const uint8_t* sendData, const uint16_t sendDataSize) {
-    ComTxQueueItem_TypeDef UartTxQueueItem;
-    UartStatus result = UART_OK;
-
-    if (xSemaphoreTake(UartTxBufferMutex, UART_COM_MAX_DELAY) == pdPASS) {
-        // Mutex obtained - access the shared resource
-        if (FIFOBufferPutData(&UartTxFIFOBuffer, sendData, sendDataSize)) {
-            UartTxQueueItem.bufferType = FIFO_BUFFER;
-            UartTxQueueItem.bufferPtr = (void*) &UartTxFIFOBuffer;
-            UartTxQueueItem.BufferMutex = &UartTxBufferMutex;
-            UartTxQueueItem.dataSize = sendDataSize;
-
-            // The Tx Queue needs to be accessed in critical region since we don't want items from the same FIFO entering it in the wrong order!
-            if (xQueueSend(UartTxQueue, &UartTxQueueItem, UART_COM_MAX_DELAY) != pdPASS) {
-                // Queue full, delete data from FIFO
-                FIFOBufferDeleteLastEnteredBytes(&UartTxFIFOBuffer, sendDataSize);
-                result = UART_FAIL;
-            }
-        } else {
-            result = UART_FAIL;
-        }
-
-        xSemaphoreGive(UartTxBufferMutex); // We have finished accessing the shared resource. Release the mutex.
-    } else {
-        result = UART_FAIL;
+    bool appended;
+
+    /* Producers are serialized by suspending the scheduler, so the TX DMA interrupt is never masked while copying */
+    vTaskSuspendAll();
+    appended = TxRingBufferPut(&UartTxRingBuffer, sendData, sendDataSize);
+    xTaskResumeAll();
+
+    /* If a span is in progress, its transfer complete interrupt picks the data up */
+    if (appended && TxRingBufferIsIdle(&UartTxRingBuffer)) {
+        taskENTER_CRITICAL();
+        StartUartTxSpan();
+        taskEXIT_CRITICAL();
     }
 
-    return result;
+    return appended ? UART_OK : UART_FAIL;
 }
 
 /**
- * @brief  Send a string over the UART interface.
+ * @brief  Send a string over the UART interface. Never blocks, see UartSendData().
  * @param  sendString : Reference to the string to be sent
- * @param  maxMutexWaitTicks : Max ticks to wait for the FIFO buffer mutex
- * @param  maxQueueWaitTicks : Max ticks to wait for the queue
- * @retval Result of the operation: UART_OK if all operations are OK else UART_FAIL
+ * @retval Result of the operation: UART_OK if the string was buffered, UART_FAIL if it was dropped
  */
 UartStatus UartSendString(const char* sendString) {
     return UartSendData((uint8_t*) sendString, strlen(sendString));
 }
 
+/**
+ * @brief  Gets the UART transmit statistics
+ * @param  stats : Destination of the statistics
+ * @retval None
+ */
+void GetUartTxStats(UartTxStats_TypeDef* stats) {
+    stats->bufferSize = UartTxRingBuffer.bufferSize;
+    stats->maxUsed = UartTxRingBuffer.maxUsed;
+    stats->sentBytes = UartTxRingBuffer.sentBytes;
+    stats->spans = UartTxRingBuffer.spans;
+    stats->droppedWrites = UartTxRingBuffer.droppedWrites;
+    stats->droppedBytes = UartTxRingBuffer.droppedBytes;
+    stats->dmaErrors = UartTxDmaErrors;
+}
+
 /* Private functions ---------------------------------------------------------*/
 
 /**
@@ -264,11 +265,58 @@ UartStatus UartSendString(const char* sendString) {
 static void InitUartCom(void) {
     /* Create UART RX FIFO Buffer */
     FIFOBufferInit(&UartRxFIFOBuffer, UartRxBufferArray, sizeof(UartRxBufferArray));
+}
 
-    /* Create UART TX FIFO Buffer */
-    FIFOBufferInit(&UartTxFIFOBuffer, UartTxBufferArray, sizeof(UartTxBufferArray));
+/**
+ * @brief  Sets up the TX DMA channel for streaming. The channel configuration is made by HAL_UART_MspInit(), the
+ *         spans are then started directly on the channel registers.
+ * @param  None.
+ * @retval None.
+ */
+static void EnableUartTxStream(void) {
+    UART_TX_DMA_STREAM->CCR &= ~DMA_CCR_EN;
+    UART_TX_DMA_STREAM->CPAR = (uint32_t) &UART->TDR;
+    UART_TX_DMA->IFCR = UART_TX_DMA_CLEAR_FLAGS;
+    UART_TX_DMA_STREAM->CCR |= DMA_CCR_TCIE | DMA_CCR_TEIE;
+
+    /* The UART requests a byte whenever its transmit data register is empty and the channel is enabled */
+    UART->CR3 |= USART_CR3_DMAT;
 }
 
+/**
+ * @brief  Starts the next span of the transmit ring buffer on the TX DMA channel if no span is in progress. Must be
+ *         called from the TX DMA interrupt or with it masked.
+ * @param  None.
+ * @retval None.
+ */
+static void StartUartTxSpan(void) {
+    uint8_t* spanData;
+    uint16_t spanSize;
+
+    if (TxRingBufferStartSpan(&UartTxRingBuffer, &spanData, &spanSize)) {
+        UART_TX_DMA_STREAM->CMAR = (uint32_t) spanData;
+        UART_TX_DMA_STREAM->CNDTR = spanSize;
+        UART_TX_DMA_STREAM->CCR |= DMA_CCR_EN;
+    }
+}
+
+#if FCB_USE_CLI
+/**
+ * @brief  Waits until the transmit ring buffer can take a CLI output chunk, so that long CLI output is paced by the
+ *         line rate instead of dropped
+ * @param  size : Size of the chunk to be sent
+ * @retval None.
+ */
+static void WaitForUartTxSpace(const uint16_t size) {
+    uint32_t waitedMs = 0;
+
+    while (TxRingBufferGetFree(&UartTxRingBuffer) < size && waitedMs < UART_COM_MAX_DELAY) {
+        vTaskDelay(UART_TX_DRAIN_POLL_MS / portTICK_RATE_MS);
+        waitedMs += UART_TX_DRAIN_POLL_MS;
+    }
+}
+#endif
+
 /**
  * @brief  Task code handles the Uart Rx (receive) communication
  * @param  argument : Unused parameter
@@ -277,14 +325,16 @@ static void InitUartCom(void) {
 static void UartRxTask(void const *argument) {
     (void) argument;
 
+    uint8_t getByte;
+#if FCB_USE_CLI
     uint16_t i = 0;
     uint16_t j = 0;
     uint16_t datalen = 0;
     portBASE_TYPE moreDataToFollow;
     ErrorStatus bufferStatus = SUCCESS;
-    uint8_t getByte;
     static uint8_t cliInBuffer[MAX_CLI_COMMAND_SIZE];
     static uint8_t cliOutBuffer[MAX_CLI_OUTPUT_SIZE];
+#endif
 
     /* Init UART communication */
     InitUartCom();
@@ -293,10 +343,20 @@ static void UartRxTask(void const *argument) {
         /* Start receiving data over UART, 1 byte at a time */
         HAL_UART_Receive_DMA(&UartHandle, &rxByte, 1);
 
-        bufferStatus = SUCCESS;
         /* Wait forever for incoming data over Uart by pending on the Uart Rx semaphore */
         if (pdPASS == xSemaphoreTake(UartRxDataSem, portMAX_DELAY)) {
+            /* Binary sensor injection frames bypass the CLI */
+            while (IsSensorInjectionChannel(SENSOR_INJECTION_UART)
+                    && FIFOBufferGetByte(&UartRxFIFOBuffer, &getByte) == SUCCESS) {
+                ParseSensorInjectionByte(getByte);
+            }
+            if (IsSensorInjectionChannel(SENSOR_INJECTION_UART)) {
+                continue;
+            }
+
+#if FCB_USE_CLI
             /* Read out the buffer until '\r' */
+            bufferStatus = SUCCESS;
             getByte = 0;
             while (bufferStatus == SUCCESS && i < MAX_CLI_COMMAND_SIZE && ((char)getByte) != '\r') {
                 bufferStatus = FIFOBufferGetByte(&UartRxFIFOBuffer, &getByte);
@@ -322,8 +382,10 @@ static void UartRxTask(void const *argument) {
                      * by the command interpreter will be placed in the cliOutBuffer buffer. */
                     moreDataToFollow = CLIParser(&(cliInBuffer[k]), cliOutBuffer, &datalen);
                     if(datalen > 0) {
+                        WaitForUartTxSpace(datalen);
                         UartSendData(cliOutBuffer, datalen);
                     } else {
+                        WaitForUartTxSpace(strlen((char*) cliOutBuffer));
                         UartSendString((char*) cliOutBuffer);
                     }
                 } while (moreDataToFollow != pdFALSE);
@@ -340,73 +402,12 @@ static void UartRxTask(void const *argument) {
                 j = 0;
                 memset(cliInBuffer, 0x00, sizeof(cliInBuffer));
             }
-        }
-    }
-}
-
-/**
- * @brief  Task code handles the UART Tx communication
- * @param  argument : Unused parameter
- * @retval None
- */
-static void UartTxTask(void const *argument) {
-    (void) argument;
-
-    static ComTxQueueItem_TypeDef UartTxQueueItem;
-    uint8_t* txDataPtr;
-    uint16_t tmpSize;
-
-    /* Make sure semaphore can be taken the first time */
-    xSemaphoreGive(UartTxBinarySem);
-
-    for (;;) {
-        /* Wait forever for incoming data over UART by pending on the UART Tx queue */
-        if (pdPASS == xQueueReceive(UartTxQueue, &UartTxQueueItem, portMAX_DELAY)) {
-            /* Take the buffer mutex (if it has one) */
-            if ((*UartTxQueueItem.BufferMutex == NULL || xSemaphoreTake(*UartTxQueueItem.BufferMutex, portMAX_DELAY) == pdPASS)) {
-                switch (UartTxQueueItem.bufferType) {
-                case ARRAY_BUFFER:
-                    // Tx buffer is just a good ol' array of data;
-                    if(HAL_UART_Transmit_DMA(&UartHandle, (uint8_t*) UartTxQueueItem.bufferPtr, UartTxQueueItem.dataSize)!= HAL_OK) {
-                        ErrorHandler();
-                    }
-                    break;
-                case FIFO_BUFFER:
-                    // Tx buffer is a FIFO ring buffer that wraps around its zero index
-                    tmpSize = FIFOBufferGetData((volatile FIFOBuffer_TypeDef*) UartTxQueueItem.bufferPtr,
-                            &txDataPtr, UartTxQueueItem.dataSize);
-
-                    if (xSemaphoreTake(UartTxBinarySem, UART_COM_MAX_DELAY) == pdPASS) { // Pend on UART Binary Semaphore while previous transmission is in progress
-                        if(HAL_UART_Transmit_DMA(&UartHandle, txDataPtr, tmpSize) != HAL_OK) {
-                            ErrorHandler();
-                        }
-                    }
-
-                    // If not all data received from buffer (due to FIFO wrap-around), get the rest
-                    if (tmpSize < UartTxQueueItem.dataSize) {
-                        tmpSize = FIFOBufferGetData((volatile FIFOBuffer_TypeDef*) UartTxQueueItem.bufferPtr,
-                                &txDataPtr, UartTxQueueItem.dataSize - tmpSize);
-
-                        if (xSemaphoreTake(UartTxBinarySem, UART_COM_MAX_DELAY) == pdPASS) { // Pend on UART Binary Semaphore while previous transmission is in progress
-                            if(HAL_UART_Transmit_DMA(&UartHandle, txDataPtr, tmpSize) != HAL_OK) {
-                                ErrorHandler();
-                            }
-                        }
-                    }
-                    break;
-                default:
-                    /* Unspecified buffer type, indicate error */
-                    ErrorHandler();
-                    break;
-                }
-
-                if (*UartTxQueueItem.BufferMutex != NULL) {
-                    xSemaphoreGive(*UartTxQueueItem.BufferMutex); // Give buffer mutex
-                }
+#else
+            /* No command line interface, received data is flight link requests (discarded if compiled out) */
+            while (FIFOBufferGetByte(&UartRxFIFOBuffer, &getByte) == SUCCESS) {
+                ParseFlightLinkByte(getByte);
             }
-        } else {
-            /* Give Semaphore if timed out to regain access to UART DMA transmission */
-            xSemaphoreGive(UartTxBinarySem);
+#endif
         }
     }
 }
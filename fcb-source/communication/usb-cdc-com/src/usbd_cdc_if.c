@@ -28,6 +28,7 @@
 #include "usbd_cdc.h"
 #include "fcb_error.h"
 #include "communication.h"
+#include "sensor_injection.h"
 
 #include <string.h>
 #include <stdio.h>
@@ -250,22 +251,34 @@ static int8_t CDCItfReceive(uint8_t* rxData, uint32_t* rxDataLen) {
 static void USBComPortRXTask(void const *argument) {
 	(void) argument;
 
+	uint8_t getByte;
+#if FCB_USE_CLI
 	uint16_t i = 0;
 	uint16_t datalen = 0;
 	portBASE_TYPE moreDataToFollow;
 	ErrorStatus bufferStatus = SUCCESS;
-	uint8_t getByte;
 	static uint8_t cliInBuffer[MAX_CLI_COMMAND_SIZE];
 	static uint8_t cliOutBuffer[MAX_CLI_OUTPUT_SIZE];
+#endif
 
 	/* Init USB communication */
 	InitUSBCom();
 
 	for (;;) {
-		bufferStatus = SUCCESS;
 		/* Wait forever for incoming data over USB by pending on the USB Rx semaphore */
 		if (pdPASS == xSemaphoreTake(USBCOMRxDataSem, portMAX_DELAY)) {
+			// Binary sensor injection frames bypass the CLI
+			while (IsSensorInjectionChannel(SENSOR_INJECTION_USB)
+					&& FIFOBufferGetByte(&USBCOMRxFIFOBuffer, &getByte) == SUCCESS) {
+				ParseSensorInjectionByte(getByte);
+			}
+			if (IsSensorInjectionChannel(SENSOR_INJECTION_USB)) {
+				continue;
+			}
+
+#if FCB_USE_CLI
 			// Read out the FIFO buffer
+			bufferStatus = SUCCESS;
 			getByte = 0;
 			while (bufferStatus == SUCCESS && i < MAX_CLI_COMMAND_SIZE && ((char)getByte) != '\r') {
 				bufferStatus = FIFOBufferGetByte(&USBCOMRxFIFOBuffer, &getByte);
@@ -307,6 +320,10 @@ static void USBComPortRXTask(void const *argument) {
 				i = 0;
 				memset(cliInBuffer, 0x00, sizeof(cliInBuffer));
 			}
+#else
+			// No command line interface, discard received data
+			while (FIFOBufferGetByte(&USBCOMRxFIFOBuffer, &getByte) == SUCCESS);
+#endif
 		}
 	}
 }
@@ -430,6 +447,7 @@ USBD_StatusTypeDef USBComSendString(const char* sendString) {
  * @retval Result of the operation: USBD_OK if all operations are OK else USBD_FAIL
  */
 USBD_StatusTypeDef USBComSendData(const uint8_t* sendData, const uint16_t sendDataSize) {
+#if defined(USE_USB_COM)
     ComTxQueueItem_TypeDef CompPortTxQueueItem;
 	USBD_StatusTypeDef result = USBD_OK;
 
@@ -457,6 +475,12 @@ USBD_StatusTypeDef USBComSendData(const uint8_t* sendData, const uint16_t sendDa
 	}
 
 	return result;
+#else
+	/* USB com port tasks, queues and mutexes are not created, discard the data */
+	(void) sendData;
+	(void) sendDataSize;
+	return USBD_FAIL;
+#endif
 }
 
 /**
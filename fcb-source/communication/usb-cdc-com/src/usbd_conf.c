@@ -31,6 +31,7 @@
 #include "usbd_cdc.h"
 
 #include "FreeRTOS.h"
+#include "irq_priorities.h"
 
 /* Private typedef -----------------------------------------------------------*/
 /* Private define ------------------------------------------------------------*/
@@ -89,14 +90,14 @@ void HAL_PCD_MspInit(PCD_HandleTypeDef *hpcd) {
 #if defined (USE_USB_INTERRUPT_DEFAULT)
 
 	/* Set USB Default FS Interrupt priority */
-	HAL_NVIC_SetPriority(USB_LP_CAN_RX0_IRQn, configLIBRARY_MAX_SYSCALL_INTERRUPT_PRIORITY, 0);
+	HAL_NVIC_SetPriority(USB_LP_CAN_RX0_IRQn, IRQ_PRIO_USB, IRQ_SUB_PRIO);
 
 	/* Enable USB FS Interrupt */
 	HAL_NVIC_EnableIRQ(USB_LP_CAN_RX0_IRQn);
 
 #elif defined (USE_USB_INTERRUPT_REMAPPED)
 	/* Set USB Remapped FS Interrupt priority */
-	HAL_NVIC_SetPriority(USB_LP_IRQn, configLIBRARY_MAX_SYSCALL_INTERRUPT_PRIORITY, 0);
+	HAL_NVIC_SetPriority(USB_LP_IRQn, IRQ_PRIO_USB, IRQ_SUB_PRIO);
 
 	/* Enable USB FS Interrupt */
 	HAL_NVIC_EnableIRQ(USB_LP_IRQn);
@@ -95,7 +95,7 @@ GYRO_DrvTypeDef L3gd20Drv =
 };
 
 /* L3GD20_OUTPUT_DATARATE_1: 96 Hz according to data sheet, 94.5 Hz according to oscilloscope */
-static uint8_t cfgL3GD20OutputDataRate = L3GD20_OUTPUT_DATARATE_3; // 380 Hz
+static uint8_t cfgL3GD20OutputDataRate = L3GD20_OUTPUT_DATARATE_3; // 380 Hz, set by L3GD20_Config
 
 /**
   * @}
@@ -118,9 +118,10 @@ static uint8_t cfgL3GD20OutputDataRate = L3GD20_OUTPUT_DATARATE_3; // 380 Hz
  *
  * enables SPI as well
  *
+ * @param outputDataRate  L3GD20_OUTPUT_DATARATE_1 to L3GD20_OUTPUT_DATARATE_4
  * @returns zero upon success, nonzero upon error
  */
-uint8_t L3GD20_Config(void) {
+uint8_t L3GD20_Config(uint8_t outputDataRate) {
   uint8_t gyroId = 0;
   uint8_t ctrlReg1 = 0;
   uint8_t ctrlReg2 = 0;
@@ -140,6 +141,8 @@ uint8_t L3GD20_Config(void) {
     return 1; // error
   }
 
+  cfgL3GD20OutputDataRate = outputDataRate;
+
   /* Configure Mems : data rate, power mode, full scale and axes */
   L3GD20_InitStructure.Power_Mode = L3GD20_MODE_ACTIVE;
   L3GD20_InitStructure.Output_DataRate = cfgL3GD20OutputDataRate;
@@ -628,6 +628,50 @@ uint16_t LSM303DLHC_AccDataRateHz(void) {
     return 0;
 }
 
+/**
+ * @brief Changes the Output Data Rate of the accelerometer sensor
+ *
+ * The new rate takes effect from the next conversion. The DRDY interrupt
+ * keeps going as long as each sample is read.
+ *
+ * @param rateHz : one of the rates returned by LSM303DLHC_AccDataRateHz,
+ *        except the low power rates. Calls ErrorHandler if not supported.
+ */
+void LSM303DLHC_AccSetDataRateHz(uint16_t rateHz) {
+    switch (rateHz) {
+    case 1:
+        accConfig.dataRate = LSM303DLHC_ODR_1_HZ;
+        break;
+    case 10:
+        accConfig.dataRate = LSM303DLHC_ODR_10_HZ;
+        break;
+    case 25:
+        accConfig.dataRate = LSM303DLHC_ODR_25_HZ;
+        break;
+    case 50:
+        accConfig.dataRate = LSM303DLHC_ODR_50_HZ;
+        break;
+    case 100:
+        accConfig.dataRate = LSM303DLHC_ODR_100_HZ;
+        break;
+    case 200:
+        accConfig.dataRate = LSM303DLHC_ODR_200_HZ;
+        break;
+    case 400:
+        accConfig.dataRate = LSM303DLHC_ODR_400_HZ;
+        break;
+    case 1344:
+        accConfig.dataRate = LSM303DLHC_ODR_1344_HZ;
+        break;
+    default:
+        ErrorHandler();
+        return;
+    }
+
+    I2Cx_WriteData(ACC_I2C_ADDRESS, LSM303DLHC_CTRL_REG1_A,
+            LSM303DLHC_NORMAL_MODE | accConfig.dataRate | LSM303DLHC_AXES_ENABLE);
+}
+
 #define MAGNET
 
 #ifdef MAGNET
@@ -758,6 +802,39 @@ float32_t LSM303DLHC_MagDataRateHz(void) {
         return 0;
     }
 }
+
+/**
+ * Changes the magnetometer data rate. The new rate takes effect from the
+ * next conversion.
+ *
+ * @param rateHz one of the whole number rates returned by
+ *        LSM303DLHC_MagDataRateHz, calls ErrorHandler if not supported
+ */
+void LSM303DLHC_MagSetDataRateHz(uint16_t rateHz) {
+    switch (rateHz) {
+    case 3:
+        magConfig.dataRate = LSM303DLHC_ODR_3_0_HZ;
+        break;
+    case 15:
+        magConfig.dataRate = LSM303DLHC_ODR_15_HZ;
+        break;
+    case 30:
+        magConfig.dataRate = LSM303DLHC_ODR_30_HZ;
+        break;
+    case 75:
+        magConfig.dataRate = LSM303DLHC_ODR_75_HZ;
+        break;
+    case 220:
+        magConfig.dataRate = LSM303DLHC_ODR_220_HZ;
+        break;
+    default:
+        ErrorHandler();
+        return;
+    }
+
+    I2Cx_WriteData(MAG_I2C_ADDRESS, LSM303DLHC_CRA_REG_M,
+            (uint8_t) (magConfig.temperatureSensor | magConfig.dataRate));
+}
 #endif
 /**
  * @}
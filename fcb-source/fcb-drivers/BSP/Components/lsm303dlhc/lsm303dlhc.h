@@ -461,6 +461,7 @@ void      LSM303DLHC_AccClickITEnable(uint8_t ITClick);
 void      LSM303DLHC_AccClickITDisable(uint8_t ITClick);
 void      LSM303DLHC_AccZClickITConfig(void);
 uint16_t  LSM303DLHC_AccDataRateHz(void); /* see source file fcn banner */
+void      LSM303DLHC_AccSetDataRateHz(uint16_t rateHz); /* see source file fcn banner */
 
 /* Mag functions */
 
@@ -477,6 +478,7 @@ void LSM303DLHC_MagInit(void);
 HAL_StatusTypeDef LSM303DLHC_MagReadXYZ(float32_t* pfData);
 
 float32_t LSM303DLHC_MagDataRateHz(void); /* see source fcn banner */
+void LSM303DLHC_MagSetDataRateHz(uint16_t rateHz); /* see source fcn banner */
 
 #if 0
 uint8_t LSM303DLHC_MagGetDataStatus(void);
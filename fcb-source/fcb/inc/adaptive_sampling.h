@@ -0,0 +1,112 @@
+/******************************************************************************
+ * @file    adaptive_sampling.h
+ * @author  Dragonfly
+ * @version v. 1.0.0
+ * @date    2016-06-01
+ * @brief   Header file for the covariance and innovation driven sampling rate
+ *          selection of the accelerometer and magnetometer
+ ******************************************************************************/
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __ADAPTIVE_SAMPLING_H
+#define __ADAPTIVE_SAMPLING_H
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdint.h>
+#include <stdbool.h>
+
+/* Exported constants --------------------------------------------------------*/
+
+/* Sampling rates [Hz], from the lowest to the highest. Each rate must be an output data rate of the LSM303DLHC. */
+#define ADAPTIVE_ACC_RATES_HZ               { 50, 100, 200, 400 }
+#define ADAPTIVE_MAG_RATES_HZ               { 30, 75, 220 }
+#define ADAPTIVE_MAX_RATES                  4
+
+/* Attitude innovation RMS [rad] above which a sensor is sampled at its highest rate, and below which its rate may be
+ * lowered. The calm thresholds are above the hover noise floor of the sensors. */
+#define ADAPTIVE_ACC_INNOVATION_RAISE       0.06f
+#define ADAPTIVE_ACC_INNOVATION_CALM        0.04f
+#define ADAPTIVE_MAG_INNOVATION_RAISE       0.06f
+#define ADAPTIVE_MAG_INNOVATION_CALM        0.045f
+
+/* A priori attitude error standard deviation, sqrt(p11) [rad], above which a sensor is sampled one rate step higher,
+ * and below which its rate may be lowered. With the R1_ACCRP and R1_MAG tuning the deviation grows about 20 % per
+ * halved rate, so the thresholds bound how far the rate goes down when the estimator is uncertain. */
+#define ADAPTIVE_ACC_STD_RAISE              0.30f
+#define ADAPTIVE_ACC_STD_CALM               0.25f
+#define ADAPTIVE_MAG_STD_RAISE              0.15f
+#define ADAPTIVE_MAG_STD_CALM               0.12f
+
+#define ADAPTIVE_INNOVATION_FILTER          8       // Samples averaged by the innovation mean square filter
+#define ADAPTIVE_WINDOW_MS                  250     // Evaluation window for lowering the rate
+#define ADAPTIVE_CALM_WINDOWS               4       // Consecutive calm windows to lower the rate one step (1 s)
+#define ADAPTIVE_RATE_WINDOW_MS             1000    // Achieved rate measurement window
+
+/* Exported types ------------------------------------------------------------*/
+
+typedef enum {
+    ADAPTIVE_SENSOR_ACC = 0,    // Roll and pitch corrections
+    ADAPTIVE_SENSOR_MAG,        // Yaw corrections
+    ADAPTIVE_SENSOR_COUNT
+} AdaptiveSensor_TypeDef;
+
+typedef struct {
+    uint16_t rateHz;                            // Requested sampling rate
+    uint16_t maxRateHz;
+    uint16_t achievedRateHz;                    // Samples in the last rate measurement window, per second
+    float innovationRms;                        // Filtered attitude innovation RMS [rad]
+    float errorStd;                             // Last a priori attitude error standard deviation [rad]
+    uint32_t samples;                           // Samples fused since reset
+    uint32_t rateChanges;
+    uint32_t samplesAtRate[ADAPTIVE_MAX_RATES]; // Samples fused at each rate
+} AdaptiveSamplingStats_TypeDef;
+
+/* Rate selection state of a sensor */
+typedef struct {
+    volatile uint8_t rateIndex;
+    uint8_t rateCount;
+    bool started;
+    bool windowCalm;
+    uint8_t calmWindows;
+    float innovationMeanSquare;
+    float windowMaxErrorStd;
+    uint32_t windowStartMs;
+    uint32_t rateWindowStartMs;
+    uint32_t rateWindowSamples;
+    AdaptiveSamplingStats_TypeDef stats;
+} AdaptiveSensorState_TypeDef;
+
+/* Rate selection state of all sensors, used to run the estimator corrections in the kernel benchmark without
+ * changing the sensor rates */
+typedef struct {
+    AdaptiveSensorState_TypeDef sensorState[ADAPTIVE_SENSOR_COUNT];
+} AdaptiveSamplingContext_TypeDef;
+
+/* Exported macro ------------------------------------------------------------*/
+
+/* Exported function prototypes --------------------------------------------- */
+void InitAdaptiveSampling(void);
+void UpdateAdaptiveSampling(const AdaptiveSensor_TypeDef sensor, const float innovation, const float errorVariance,
+        const uint32_t timeMs);
+
+void SetAdaptiveSamplingEnabled(const bool enabled);
+bool IsAdaptiveSamplingEnabled(void);
+uint16_t GetAdaptiveSampleRateHz(const AdaptiveSensor_TypeDef sensor);
+uint16_t GetAdaptiveMaxSampleRateHz(const AdaptiveSensor_TypeDef sensor);
+
+const char* GetAdaptiveSensorName(const AdaptiveSensor_TypeDef sensor);
+void GetAdaptiveSamplingStats(const AdaptiveSensor_TypeDef sensor, AdaptiveSamplingStats_TypeDef* stats);
+void ResetAdaptiveSamplingStats(void);
+void SaveAdaptiveSamplingContext(AdaptiveSamplingContext_TypeDef* context);
+void RestoreAdaptiveSamplingContext(const AdaptiveSamplingContext_TypeDef* context);
+
+#endif /* __ADAPTIVE_SAMPLING_H */
+
+/**
+ * @}
+ */
+
+/**
+ * @}
+ */
+/*****END OF FILE****/
@@ -0,0 +1,55 @@
+/******************************************************************************
+ * @file    blackbox.h
+ * @author  Dragonfly
+ * @version v. 1.0.0
+ * @date    2016-06-01
+ * @brief   Blackbox hook points of the flight control loop. No recorder is
+ *          implemented yet, so the hooks compile to nothing. A recorder is
+ *          built with -DFCB_USE_BLACKBOX=1 and defines the hook functions.
+ *          The hooks run in the flight control task and must have a bounded
+ *          cost and never block, like WatchSampleHook().
+ ******************************************************************************/
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __BLACKBOX_H
+#define __BLACKBOX_H
+
+/* Includes ------------------------------------------------------------------*/
+#include "build_profile.h"
+#include "flight_control.h"
+#include "pid_control.h"
+
+/* Exported constants --------------------------------------------------------*/
+
+/* Exported types ------------------------------------------------------------*/
+
+/* Exported macro ------------------------------------------------------------*/
+
+/* Exported function prototypes --------------------------------------------- */
+#if FCB_USE_BLACKBOX
+void BlackboxControlHook(const RefSignals_TypeDef* refSignals, const CtrlSignals_TypeDef* ctrlSignals);
+void BlackboxFlightModeHook(const enum FlightControlMode previousMode, const enum FlightControlMode mode);
+#else
+/* No blackbox recorder, the flight control loop hooks do nothing */
+static inline void BlackboxControlHook(const RefSignals_TypeDef* refSignals, const CtrlSignals_TypeDef* ctrlSignals) {
+    (void) refSignals;
+    (void) ctrlSignals;
+}
+
+static inline void BlackboxFlightModeHook(const enum FlightControlMode previousMode,
+        const enum FlightControlMode mode) {
+    (void) previousMode;
+    (void) mode;
+}
+#endif
+
+#endif /* __BLACKBOX_H */
+
+/**
+ * @}
+ */
+
+/**
+ * @}
+ */
+/*****END OF FILE****/
@@ -0,0 +1,114 @@
+/******************************************************************************
+ * @file    build_profile.h
+ * @author  Dragonfly
+ * @version v. 1.0.0
+ * @date    2016-06-01
+ * @brief   Firmware build profiles. Selects which debug and diagnostic
+ *          subsystems are compiled into the firmware.
+ *
+ *          - Bench (default): all subsystems are included.
+ *          - Flight (-DFCB_PROFILE_FLIGHT): the command line interface, the
+ *            print sampling tasks, trace output, variable watch and sensor
+ *            injection are compiled out. The Flight build configuration
+ *            also leaves out USE_USB_COM and TASK_STATUS, so that the USB
+ *            com port tasks and the task run-time statistics timer are not
+ *            included either. Instead of the CLI, the UART Rx task feeds the
+ *            flight link (flight_link.c), a compact binary request/response
+ *            link on the common message header. The UART transmit path and
+ *            the flight control loop are unchanged.
+ *
+ *          Both profiles have the blackbox hook points in the flight control
+ *          loop (blackbox.h). They are empty until a recorder is added.
+ *
+ *          The savings on target are not measured yet. The host tests only
+ *          compare the unlinked host objects of the profile dependent sources
+ *          (profile_sizes target in tests/CMakeLists.txt). These leave out the
+ *          task stacks on the FreeRTOS heap and the linker garbage collection.
+ *          The flash and RAM figures need arm-none-eabi-size on the Release
+ *          and Flight images. The idle CPU figure needs the idle task share on
+ *          a board running each image.
+ *
+ *          Each subsystem can be overridden separately from the profile
+ *          default with -D<flag>=0 or -D<flag>=1.
+ ******************************************************************************/
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __BUILD_PROFILE_H
+#define __BUILD_PROFILE_H
+
+/* Exported constants --------------------------------------------------------*/
+
+#if defined(FCB_PROFILE_FLIGHT)
+#define FCB_PROFILE_NAME                    "flight"
+#define FCB_PROFILE_DEFAULT                 0
+#else
+#define FCB_PROFILE_NAME                    "bench"
+#define FCB_PROFILE_DEFAULT                 1
+#endif
+
+/* Command line interface over USB and UART */
+#ifndef FCB_USE_CLI
+#define FCB_USE_CLI                         FCB_PROFILE_DEFAULT
+#endif
+
+/* Receiver, sensor, motor and state print sampling tasks */
+#ifndef FCB_USE_PRINT_TASKS
+#define FCB_USE_PRINT_TASKS                 FCB_PROFILE_DEFAULT
+#endif
+
+/* trace_post() over USB and trace_printf() over semihosting */
+#ifndef FCB_USE_TRACE
+#define FCB_USE_TRACE                       FCB_PROFILE_DEFAULT
+#endif
+
+/* Variable watch streaming over USB */
+#ifndef FCB_USE_VARIABLE_WATCH
+#if defined(USE_USB_COM)
+#define FCB_USE_VARIABLE_WATCH              FCB_PROFILE_DEFAULT
+#else
+#define FCB_USE_VARIABLE_WATCH              0
+#endif
+#endif
+
+/* Sensor injection for processor-in-the-loop testing */
+#ifndef FCB_USE_SENSOR_INJECTION
+#define FCB_USE_SENSOR_INJECTION            FCB_PROFILE_DEFAULT
+#endif
+
+/* Compact binary link on the UART, which has no other reader without the CLI */
+#ifndef FCB_USE_FLIGHT_LINK
+#define FCB_USE_FLIGHT_LINK                 (!FCB_USE_CLI)
+#endif
+
+/* Blackbox recorder behind the flight control loop hooks in blackbox.h, none is implemented yet */
+#ifndef FCB_USE_BLACKBOX
+#define FCB_USE_BLACKBOX                    0
+#endif
+
+/* Subsystem dependencies */
+#if FCB_USE_PRINT_TASKS && !FCB_USE_CLI
+#error "FCB_USE_PRINT_TASKS requires FCB_USE_CLI, print sampling is started from the CLI"
+#endif
+
+#if FCB_USE_VARIABLE_WATCH && (!FCB_USE_CLI || !defined(USE_USB_COM))
+#error "FCB_USE_VARIABLE_WATCH requires FCB_USE_CLI and USE_USB_COM"
+#endif
+
+#if FCB_USE_SENSOR_INJECTION && !FCB_USE_CLI
+#error "FCB_USE_SENSOR_INJECTION requires FCB_USE_CLI, injection is started from the CLI"
+#endif
+
+#if FCB_USE_FLIGHT_LINK && FCB_USE_CLI
+#error "FCB_USE_FLIGHT_LINK requires FCB_USE_CLI=0, the CLI reads all UART data"
+#endif
+
+#endif /* __BUILD_PROFILE_H */
+
+/**
+ * @}
+ */
+
+/**
+ * @}
+ */
+/*****END OF FILE****/
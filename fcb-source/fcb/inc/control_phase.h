@@ -0,0 +1,80 @@
+/******************************************************************************
+ * @file    control_phase.h
+ * @author  Dragonfly
+ * @version v. 1.0.0
+ * @date    2016-06-01
+ * @brief   Header file for phase locking of the control loop to the motor PWM
+ *          update event
+ ******************************************************************************/
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __CONTROL_PHASE_H
+#define __CONTROL_PHASE_H
+
+/* Includes ------------------------------------------------------------------*/
+#include "stm32f3xx.h"
+#include "fcb_retval.h"
+#include "motor_control.h"
+
+#include <stdbool.h>
+
+/* Exported constants --------------------------------------------------------*/
+#define CONTROL_PHASE_TICKS_PER_US          (MOTOR_OUTPUT_COUNTER_CLOCK / 1000000)
+#define CONTROL_PHASE_PERIOD_TICKS          ((int32_t) MOTOR_OUTPUT_PERIOD + 1)
+
+#define CONTROL_PHASE_DEFAULT_MARGIN_US     200     // Loop completion before the PWM update event [us]
+#define CONTROL_PHASE_MIN_MARGIN_US         20
+#define CONTROL_PHASE_MAX_MARGIN_US         (CONTROL_PHASE_PERIOD_TICKS / CONTROL_PHASE_TICKS_PER_US / 2)
+
+/* Phase controller tuning, gain as right shift. Both timers run from the same clock, so there is no frequency
+ * error to integrate and a proportional correction of the period gives zero phase error. */
+#define CONTROL_PHASE_KP_SHIFT              1       // Kp = 1/2
+#define CONTROL_PHASE_MAX_ADJUST            (CONTROL_PHASE_PERIOD_TICKS / 16) // Max period correction [ticks]
+#define CONTROL_PHASE_LOCK_TOLERANCE        (20 * CONTROL_PHASE_TICKS_PER_US) // [ticks]
+#define CONTROL_PHASE_LOCK_COUNT            50      // Consecutive loops within tolerance to be locked
+#define CONTROL_PHASE_EXEC_DECAY_SHIFT      8       // Decay of the peak execution time estimate
+
+/* Exported types ------------------------------------------------------------*/
+typedef struct {
+    int32_t pendingAdjust;      // Correction written to the preloaded period, not yet seen in the phase [ticks]
+    uint32_t executionTime;     // Peak hold estimate of the loop execution time [ticks]
+    uint16_t inToleranceCount;  // Consecutive loops with phase error within tolerance
+} PhaseController_TypeDef;
+
+typedef struct {
+    bool locked;
+    int32_t lastAdjust;         // Last loop period correction [ticks]
+    int32_t lastError;          // Last phase error, positive if the control tick was too early [ticks]
+    uint32_t executionTime;     // Loop execution time estimate [ticks]
+    uint32_t lastSlack;         // Last time from loop completion to PWM update event [ticks]
+    uint32_t minSlack;
+    uint32_t maxSlack;
+    uint32_t lastOutputLatency; // Last time from control tick to PWM update event [ticks]
+    uint32_t maxOutputLatency;
+} ControlPhaseStats_TypeDef;
+
+/* Exported macro ------------------------------------------------------------*/
+
+/* Exported function prototypes --------------------------------------------- */
+void InitControlPhaseLock(void);
+void UpdateControlPhaseLock(void);
+FcbRetValType SetControlPhaseMargin(const uint16_t marginUs);
+uint16_t GetControlPhaseMargin(void);
+void GetControlPhaseStats(ControlPhaseStats_TypeDef* stats);
+void ResetControlPhaseStats(void);
+
+void ResetPhaseController(PhaseController_TypeDef* controller);
+uint32_t UpdateExecutionTimeEstimate(PhaseController_TypeDef* controller, const uint32_t executionTicks);
+int32_t UpdatePhaseController(PhaseController_TypeDef* controller, const int32_t phaseError);
+int32_t GetPhaseError(const uint32_t pwmCounterAtTick, const uint32_t targetTicks);
+
+#endif /* __CONTROL_PHASE_H */
+
+/**
+ * @}
+ */
+
+/**
+ * @}
+ */
+/*****END OF FILE****/
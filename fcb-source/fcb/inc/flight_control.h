@@ -13,10 +13,11 @@
 /* Includes ------------------------------------------------------------------*/
 #include "arm_math.h"
 #include "fcb_sensors.h"
+#include "loop_rate.h"
 
 /* Exported constants --------------------------------------------------------*/
 
-#define FLIGHT_CONTROL_TASK_PERIOD		2.5 // [ms]
+#define FLIGHT_CONTROL_TASK_PERIOD		LOOP_PERIOD_MS // [ms], see loop_rate.h
 
 /* Physical properties of aircraft */
 
@@ -125,6 +126,7 @@ void SendPredictionUpdateToFlightControl(void);
 void SendCorrectionUpdateToFlightControl(FcbSensorIndexType sensorType, float32_t xyz[3]);
 
 void setMaxLimitForReferenceSignal(float32_t maxZVelocity, float32_t maxRollAngle, float32_t maxPitchAngle, float32_t maxYawAngleRate);
+void applyMaxLimitForReferenceSignal(const RefSignals_TypeDef* maxLimits); // Not saved to flash
 void getMaxLimitForReferenceSignal(float32_t* maxZVelocity, float32_t* maxRollAngle, float32_t* maxPitchAngle, float32_t* maxYawAngle,float32_t* maxYawAngleRate);
 
 #endif /* __FLIGHT_CONTROL_H */
@@ -0,0 +1,61 @@
+/******************************************************************************
+ * @file    flight_link.h
+ * @author  Dragonfly
+ * @version v. 1.0.0
+ * @date    2016-06-01
+ * @brief   Header file for the flight link, the compact binary UART link of
+ *          the flight profile, which has no command line interface
+ ******************************************************************************/
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __FLIGHT_LINK_H
+#define __FLIGHT_LINK_H
+
+/* Includes ------------------------------------------------------------------*/
+#include "stm32f3xx.h"
+#include "build_profile.h"
+
+/* Exported constants --------------------------------------------------------*/
+
+/* Request payload: command (u8) followed by the command parameters, at most FLIGHT_LINK_MAX_REQUEST_SIZE bytes */
+#define FLIGHT_LINK_MAX_REQUEST_SIZE        16  // [bytes]
+
+/* Commands, a response carries the command of its request as the first payload byte */
+#define FLIGHT_LINK_CMD_STATUS              0x01
+
+/* Status response payload: command (u8), uptime [ms] (u32), flight control mode (u8), receiver active (u8),
+ * accepted requests (u32), bad frames (u32), UART transmit bytes dropped (u32) */
+#define FLIGHT_LINK_STATUS_SIZE             19  // [bytes]
+
+/* Exported types ------------------------------------------------------------*/
+typedef struct {
+    uint32_t requests;          // Accepted requests
+    uint32_t badFrames;         // Frames with wrong size, CRC or trailer
+    uint32_t droppedBytes;      // Bytes skipped to find the next frame header
+    uint32_t unknownCommands;   // Valid frames with an unknown command or wrong parameter size
+    uint32_t txDrops;           // Responses dropped because the UART transmit buffer was full
+} FlightLinkStats_TypeDef;
+
+/* Exported macro ------------------------------------------------------------*/
+
+/* Exported function prototypes --------------------------------------------- */
+#if FCB_USE_FLIGHT_LINK
+void ParseFlightLinkByte(const uint8_t byte);
+void GetFlightLinkStats(FlightLinkStats_TypeDef* stats);
+#else
+/* Flight link compiled out, bytes received by a com port without command line interface are discarded */
+static inline void ParseFlightLinkByte(const uint8_t byte) {
+    (void) byte;
+}
+#endif
+
+#endif /* __FLIGHT_LINK_H */
+
+/**
+ * @}
+ */
+
+/**
+ * @}
+ */
+/*****END OF FILE****/
@@ -0,0 +1,83 @@
+/******************************************************************************
+ * @file    irq_latch.h
+ * @author  Dragonfly
+ * @version v. 1.0.0
+ * @date    2016-06-01
+ * @brief   Header file for the interrupt event latching, deferred handling
+ *          and latency measurement of the control path interrupts
+ ******************************************************************************/
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __IRQ_LATCH_H
+#define __IRQ_LATCH_H
+
+/* Includes ------------------------------------------------------------------*/
+#include "stm32f3xx.h"
+#include "irq_priorities.h"
+
+#include <stdbool.h>
+
+/* Exported constants --------------------------------------------------------*/
+
+/* Unused comparator interrupt vectors are used as software triggered deferred handlers */
+#define CONTROL_DEFERRED_IRQn               COMP7_IRQn
+#define CONTROL_DEFERRED_IRQHandler         COMP7_IRQHandler
+#define SENSOR_DEFERRED_IRQn                COMP4_5_6_IRQn
+#define SENSOR_DEFERRED_IRQHandler          COMP4_5_6_IRQHandler
+#define RECEIVER_DEFERRED_IRQn              COMP1_2_3_IRQn      // Pended and handled in receiver.c
+#define RECEIVER_DEFERRED_IRQHandler        COMP1_2_3_IRQHandler
+
+/* Exported types ------------------------------------------------------------*/
+
+/* Latched events, in order of control criticality */
+typedef enum {
+    IRQ_EVENT_CONTROL_TICK = 0,
+    IRQ_EVENT_GYRO_DRDY,
+    IRQ_EVENT_ACC_DRDY,
+    IRQ_EVENT_MAG_DRDY,
+    IRQ_EVENT_COUNT
+} IrqEvent_TypeDef;
+
+/* Latency measurement points */
+typedef enum {
+    IRQ_LATENCY_CONTROL_TICK_ENTRY = 0,     // Timer update event to latch ISR
+    IRQ_LATENCY_CONTROL_TICK_DEFERRED,      // Timer update event to deferred handler
+    IRQ_LATENCY_CONTROL_TICK_TASK,          // Timer update event to flight control task
+    IRQ_LATENCY_GYRO_DEFERRED,              // Gyroscope DRDY latch to deferred handler
+    IRQ_LATENCY_ACC_DEFERRED,               // Accelerometer DRDY latch to deferred handler
+    IRQ_LATENCY_MAG_DEFERRED,               // Magnetometer DRDY latch to deferred handler
+    IRQ_LATENCY_COUNT
+} IrqLatency_TypeDef;
+
+typedef struct {
+    uint32_t lastCycles;
+    uint32_t maxCycles;
+    uint32_t count;
+} IrqLatencyStats_TypeDef;
+
+/* Exported macro ------------------------------------------------------------*/
+
+/* Exported function prototypes --------------------------------------------- */
+void InitInterruptLatch(void);
+void LatchInterruptEvent(const IrqEvent_TypeDef event, const uint32_t eventAge);
+void LatchControlTick(void);
+void HandleControlDeferredIRQ(void);
+void HandleSensorDeferredIRQ(void);
+void RecordControlTaskLatency(void);
+uint32_t GetControlTickTimestamp(void);
+
+const char* GetIrqLatencyName(const IrqLatency_TypeDef latency);
+void GetIrqLatencyStats(const IrqLatency_TypeDef latency, IrqLatencyStats_TypeDef* stats);
+uint32_t GetIrqEventMissedCount(const IrqEvent_TypeDef event);
+void ResetIrqLatencyStats(void);
+
+#endif /* __IRQ_LATCH_H */
+
+/**
+ * @}
+ */
+
+/**
+ * @}
+ */
+/*****END OF FILE****/
@@ -0,0 +1,98 @@
+/******************************************************************************
+ * @file    irq_priorities.h
+ * @author  Dragonfly
+ * @version v. 1.0.0
+ * @date    2016-06-01
+ * @brief   NVIC preemption priorities of all interrupts, in one place.
+ *
+ *          Priority group 4 is used (4 preemption bits, no sub priority),
+ *          a lower number means a more urgent interrupt. Three tiers:
+ *
+ *          - Latch tier, above configLIBRARY_MAX_SYSCALL_INTERRUPT_PRIORITY.
+ *            Never masked by the RTOS, so these ISRs must be tiny and must not
+ *            call any RTOS API. They only latch a timestamp and/or a raw
+ *            capture and pend a deferred handler (see irq_latch.c).
+ *          - Deferred tier, handlers at or below the RTOS syscall limit
+ *            ordered by control criticality: control tick and gyroscope
+ *            first, then the other sensors, then the receiver pulse decoding.
+ *          - Communication and housekeeping, lowest above the kernel.
+ ******************************************************************************/
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __IRQ_PRIORITIES_H
+#define __IRQ_PRIORITIES_H
+
+/* Includes ------------------------------------------------------------------*/
+#include "stm32f3xx.h"
+#include "FreeRTOS.h"
+
+/* Exported constants --------------------------------------------------------*/
+
+/* Fatal, does not return */
+#define IRQ_PRIO_PVD                        0
+
+/* Latch tier, no RTOS calls allowed */
+#define IRQ_PRIO_CONTROL_TICK_LATCH         1   // STATE_ESTIMATION_UPDATE_TIM update event
+#define IRQ_PRIO_GYRO_DRDY_LATCH            1
+#define IRQ_PRIO_RECEIVER_CAPTURE           2   // Input capture ISRs, only store captures
+#define IRQ_PRIO_ACCMAG_DRDY_LATCH          3
+
+/* Deferred tier, RTOS aware */
+#define IRQ_PRIO_CONTROL_DEFERRED           configLIBRARY_MAX_SYSCALL_INTERRUPT_PRIORITY
+#define IRQ_PRIO_SENSOR_DEFERRED            (configLIBRARY_MAX_SYSCALL_INTERRUPT_PRIORITY + 1)
+#define IRQ_PRIO_RECEIVER_DEFERRED          (configLIBRARY_MAX_SYSCALL_INTERRUPT_PRIORITY + 2)
+
+/* Communication and housekeeping */
+#define IRQ_PRIO_USB                        (configLIBRARY_MAX_SYSCALL_INTERRUPT_PRIORITY + 3)
+#define IRQ_PRIO_UART_DMA                   (configLIBRARY_MAX_SYSCALL_INTERRUPT_PRIORITY + 4)
+#define IRQ_PRIO_TASK_STATUS_TIM            (configLIBRARY_MAX_SYSCALL_INTERRUPT_PRIORITY + 6)
+#define IRQ_PRIO_USER_BUTTON                configLIBRARY_LOWEST_INTERRUPT_PRIORITY // Set by BSP_PB_Init()
+
+/* Sub priorities are not used with priority group 4 */
+#define IRQ_SUB_PRIO                        0
+
+/* Scheme checks ------------------------------------------------------------*/
+
+/* Latch tier must be above the RTOS syscall limit, everything calling the RTOS at or below it */
+_Static_assert(IRQ_PRIO_CONTROL_TICK_LATCH < configLIBRARY_MAX_SYSCALL_INTERRUPT_PRIORITY,
+        "Control tick latch ISR must not be masked by the RTOS");
+_Static_assert(IRQ_PRIO_GYRO_DRDY_LATCH < configLIBRARY_MAX_SYSCALL_INTERRUPT_PRIORITY,
+        "Gyroscope latch ISR must not be masked by the RTOS");
+_Static_assert(IRQ_PRIO_RECEIVER_CAPTURE < configLIBRARY_MAX_SYSCALL_INTERRUPT_PRIORITY,
+        "Receiver capture ISR must not be masked by the RTOS");
+_Static_assert(IRQ_PRIO_ACCMAG_DRDY_LATCH < configLIBRARY_MAX_SYSCALL_INTERRUPT_PRIORITY,
+        "Accelerometer/magnetometer latch ISR must not be masked by the RTOS");
+_Static_assert(IRQ_PRIO_CONTROL_DEFERRED >= configLIBRARY_MAX_SYSCALL_INTERRUPT_PRIORITY
+        && IRQ_PRIO_SENSOR_DEFERRED >= configLIBRARY_MAX_SYSCALL_INTERRUPT_PRIORITY
+        && IRQ_PRIO_RECEIVER_DEFERRED >= configLIBRARY_MAX_SYSCALL_INTERRUPT_PRIORITY
+        && IRQ_PRIO_USB >= configLIBRARY_MAX_SYSCALL_INTERRUPT_PRIORITY
+        && IRQ_PRIO_UART_DMA >= configLIBRARY_MAX_SYSCALL_INTERRUPT_PRIORITY,
+        "Interrupts calling RTOS FromISR functions must be at or below the RTOS syscall limit");
+
+/* Ordering by control criticality */
+_Static_assert(IRQ_PRIO_PVD < IRQ_PRIO_CONTROL_TICK_LATCH, "PVD must preempt everything");
+_Static_assert(IRQ_PRIO_CONTROL_TICK_LATCH <= IRQ_PRIO_RECEIVER_CAPTURE
+        && IRQ_PRIO_GYRO_DRDY_LATCH <= IRQ_PRIO_RECEIVER_CAPTURE
+        && IRQ_PRIO_RECEIVER_CAPTURE <= IRQ_PRIO_ACCMAG_DRDY_LATCH,
+        "Latch tier ordering violated");
+_Static_assert(IRQ_PRIO_CONTROL_DEFERRED < IRQ_PRIO_SENSOR_DEFERRED, "Control must preempt other sensors");
+_Static_assert(IRQ_PRIO_SENSOR_DEFERRED < IRQ_PRIO_RECEIVER_DEFERRED, "Sensors must preempt receiver decoding");
+_Static_assert(IRQ_PRIO_RECEIVER_DEFERRED < IRQ_PRIO_USB && IRQ_PRIO_USB < IRQ_PRIO_UART_DMA
+        && IRQ_PRIO_UART_DMA < IRQ_PRIO_TASK_STATUS_TIM, "Communication and housekeeping must be lowest");
+
+/* Nothing may share the kernel priority (SysTick, PendSV) except the user button */
+_Static_assert(IRQ_PRIO_TASK_STATUS_TIM < configLIBRARY_LOWEST_INTERRUPT_PRIORITY,
+        "Housekeeping must be above the kernel priority");
+_Static_assert(configLIBRARY_LOWEST_INTERRUPT_PRIORITY < (1 << __NVIC_PRIO_BITS),
+        "Priority out of range for the implemented NVIC priority bits");
+
+#endif /* __IRQ_PRIORITIES_H */
+
+/**
+ * @}
+ */
+
+/**
+ * @}
+ */
+/*****END OF FILE****/
@@ -0,0 +1,55 @@
+/******************************************************************************
+ * @file    kernel_benchmark.h
+ * @author  Dragonfly
+ * @version v. 1.0.0
+ * @date    2016-06-01
+ * @brief   Header file for on-target micro-benchmarks of the math and utility
+ *          kernels used in the flight control path
+ ******************************************************************************/
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __KERNEL_BENCHMARK_H
+#define __KERNEL_BENCHMARK_H
+
+/* Includes ------------------------------------------------------------------*/
+#include "stm32f3xx.h"
+#include "fcb_retval.h"
+
+#include <stddef.h>
+#include <stdbool.h>
+
+/* Exported constants --------------------------------------------------------*/
+#define KERNEL_BENCHMARK_MAX_LINE_SIZE      80
+
+/* Exported types ------------------------------------------------------------*/
+typedef struct {
+    uint32_t minCycles;         // Fastest measured batch [CPU cycles/op]
+    uint32_t meanCycles;        // Mean over all measured batches [CPU cycles/op]
+    uint32_t baselineCycles;    // Stored baseline min value [CPU cycles/op], 0 if no baseline
+} KernelBenchmarkResult_TypeDef;
+
+/* Exported macro ------------------------------------------------------------*/
+
+/* Exported function prototypes --------------------------------------------- */
+FcbRetValType RunKernelBenchmarks(void);
+void SetKernelBenchmarkBaseline(void);
+bool HasKernelBenchmarkBaseline(void);
+uint8_t GetKernelBenchmarkCount(void);
+const char* GetKernelBenchmarkName(const uint8_t index);
+void GetKernelBenchmarkResult(const uint8_t index, KernelBenchmarkResult_TypeDef* result);
+int FormatKernelBenchmarkResult(char* dst, const size_t dstSize, const uint8_t index, const bool compareToBaseline);
+
+#if defined(KERNEL_PROFILE_SEMIHOSTING)
+void RunKernelProfile(void) __attribute__((noreturn));
+#endif
+
+#endif /* __KERNEL_BENCHMARK_H */
+
+/**
+ * @}
+ */
+
+/**
+ * @}
+ */
+/*****END OF FILE****/
@@ -0,0 +1,34 @@
+/******************************************************************************
+ * @file    loop_costs.h
+ * @author  Dragonfly
+ * @version v. 1.0.0
+ * @date    2016-06-01
+ * @brief   Loop kernel costs for the CPU budget check in loop_rate.h.
+ *
+ *          Not measured yet. These are hand estimates, rounded up from the
+ *          floating point operation counts of the kernels at a few cycles per
+ *          operation. Replace this file with the output of
+ *          tools/gen_loop_costs.py on a kernel-benchmark or Profile build run.
+ ******************************************************************************/
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __LOOP_COSTS_H
+#define __LOOP_COSTS_H
+
+/* Exported constants --------------------------------------------------------*/
+#define LOOP_COSTS_MEASURED                 0
+#define LOOP_COST_FLIGHT_CONTROL_STEP       10000   // Prediction, gyroscope correction, PID and allocation
+#define LOOP_COST_ACC_CORRECTION            3000    // At most one per loop period
+#define LOOP_COST_MAG_CORRECTION            3000    // At most one per loop period
+#define LOOP_COST_OVERHEAD                  5000    // Interrupts, context switches, phase lock and watch
+
+#endif /* __LOOP_COSTS_H */
+
+/**
+ * @}
+ */
+
+/**
+ * @}
+ */
+/*****END OF FILE****/
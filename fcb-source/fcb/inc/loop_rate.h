@@ -0,0 +1,105 @@
+/******************************************************************************
+ * @file    loop_rate.h
+ * @author  Dragonfly
+ * @version v. 1.0.0
+ * @date    2016-06-01
+ * @brief   Flight control loop rate profiles. Every loop timing constant, i.e.
+ *          the control tick and motor PWM timer periods, the estimator and PID
+ *          sample periods, the ESC pulse range and the discretized filter
+ *          noise, is derived from LOOP_RATE_HZ.
+ *
+ *          Select a profile with the build flag -DLOOP_RATE_HZ=<rate>:
+ *
+ *          - 400 Hz (default): standard 1-2 ms ESC PWM.
+ *          - 1000 Hz, 2000 Hz: the PWM period is shorter than a standard ESC
+ *            pulse, so OneShot125 (125-250 us pulses) is used. The ESC:s must
+ *            support OneShot125. The gyroscope runs at its highest data rate.
+ *
+ *          The per loop CPU budget of the selected profile is checked at
+ *          build time against the loop kernel costs in loop_costs.h, which
+ *          tools/gen_loop_costs.py generates from kernel-benchmark or Profile
+ *          build results. The costs are upper bounds for the kernel-benchmark
+ *          CLI command, which marks any kernel measured above its bound.
+ *          Regenerate them when the kernels change.
+ *
+ *          Until the costs are measured, the budget check proves nothing for
+ *          the 1000 and 2000 Hz profiles, so they are unverified and only
+ *          build with -DLOOP_ALLOW_UNVERIFIED_PROFILE. The 400 Hz budget is
+ *          five times the estimated costs.
+ *
+ *          tests/test_loop_rate.c checks the derived timing and runs the
+ *          attitude estimator at each profile rate on the host.
+ ******************************************************************************/
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __LOOP_RATE_H
+#define __LOOP_RATE_H
+
+/* Includes ------------------------------------------------------------------*/
+#include "arm_math.h"
+#include "loop_costs.h"
+
+/* Exported constants --------------------------------------------------------*/
+
+#ifndef LOOP_RATE_HZ
+#define LOOP_RATE_HZ                        400
+#endif
+
+/* Profiles */
+#if LOOP_RATE_HZ == 400
+#define LOOP_ESC_PULSE_MIN_US               1000    // Standard ESC PWM
+#define LOOP_ESC_PULSE_MAX_US               2000
+#elif LOOP_RATE_HZ == 1000 || LOOP_RATE_HZ == 2000
+#define LOOP_ESC_PULSE_MIN_US               125     // OneShot125
+#define LOOP_ESC_PULSE_MAX_US               250
+#else
+#error "Unsupported LOOP_RATE_HZ, use 400, 1000 or 2000"
+#endif
+
+/* Rate the filter noise parameters and controller gains are tuned at */
+#define LOOP_REFERENCE_RATE_HZ              400
+
+/* Timing derived from the loop rate. The control tick and motor PWM timers count on the same counter clock. */
+#define LOOP_CPU_CLOCK_HZ                   72000000    // SystemCoreClock
+#define LOOP_TIMER_CLOCK_HZ                 24000000
+#define LOOP_TIMER_TICKS_PER_US             (LOOP_TIMER_CLOCK_HZ / 1000000)
+#define LOOP_TIMER_PERIOD_TICKS             (LOOP_TIMER_CLOCK_HZ / LOOP_RATE_HZ)
+#define LOOP_CPU_CYCLES_PER_PERIOD          (LOOP_CPU_CLOCK_HZ / LOOP_RATE_HZ)
+#define LOOP_PERIOD_MS                      (1000.0 / LOOP_RATE_HZ)                 // [ms]
+#define LOOP_PERIOD_S                       ((float32_t) (1.0 / LOOP_RATE_HZ))      // [s]
+
+/* Scales a per sample variance tuned at LOOP_REFERENCE_RATE_HZ, so that the same continuous time noise density is
+ * modelled at any loop rate */
+#define LOOP_DISCRETE_VARIANCE(refVariance) \
+    ((float32_t) ((refVariance) * LOOP_REFERENCE_RATE_HZ / LOOP_RATE_HZ))
+
+/* Loop kernel cost bound [CPU cycles], the parts are in loop_costs.h */
+#define LOOP_COST_TOTAL                     (LOOP_COST_FLIGHT_CONTROL_STEP + LOOP_COST_ACC_CORRECTION \
+                                            + LOOP_COST_MAG_CORRECTION + LOOP_COST_OVERHEAD)
+
+/* Part of each loop period that the flight control path may use, the rest is left to communication */
+#define LOOP_MAX_UTILIZATION_PERCENT        60
+
+/* Profile checks ------------------------------------------------------------*/
+_Static_assert(LOOP_TIMER_CLOCK_HZ % LOOP_RATE_HZ == 0, "Loop period must be a whole number of timer ticks");
+_Static_assert(LOOP_TIMER_PERIOD_TICKS - 1 <= UINT16_MAX, "Loop period exceeds the 16 bit timer reload");
+_Static_assert(LOOP_ESC_PULSE_MAX_US * LOOP_TIMER_TICKS_PER_US < LOOP_TIMER_PERIOD_TICKS,
+        "ESC pulse does not fit in the PWM period");
+_Static_assert(LOOP_COST_TOTAL * 100 <= LOOP_CPU_CYCLES_PER_PERIOD * LOOP_MAX_UTILIZATION_PERCENT,
+        "Loop kernel costs exceed the CPU budget of the loop rate profile");
+
+#if !LOOP_COSTS_MEASURED && LOOP_RATE_HZ != LOOP_REFERENCE_RATE_HZ && !defined(LOOP_ALLOW_UNVERIFIED_PROFILE)
+#error "The CPU budget of this loop rate profile is unverified, loop_costs.h holds estimates. Generate it with \
+tools/gen_loop_costs.py, or build with -DLOOP_ALLOW_UNVERIFIED_PROFILE."
+#endif
+
+#endif /* __LOOP_RATE_H */
+
+/**
+ * @}
+ */
+
+/**
+ * @}
+ */
+/*****END OF FILE****/
@@ -44,13 +44,12 @@ typedef enum {
 #define MOTOR3_CHANNEL                          TIM_CHANNEL_3
 #define MOTOR4_CHANNEL                          TIM_CHANNEL_4
 
-/* Defines Motor TIM Timebase
- * 60000 ticks on a 24MHz clock yields a 400 MHz PWM frequency */
-#define MOTOR_OUTPUT_COUNTER_CLOCK              24000000
-#define MOTOR_OUTPUT_PERIOD                     60000
+/* Defines Motor TIM Timebase, one PWM period per flight control loop (see loop_rate.h) */
+#define MOTOR_OUTPUT_COUNTER_CLOCK              LOOP_TIMER_CLOCK_HZ
+#define MOTOR_OUTPUT_PERIOD                     (LOOP_TIMER_PERIOD_TICKS - 1) // Auto-reload value
 
-#define ESC_MAX_OUTPUT                          48000 // 2.0 ms pulse
-#define ESC_MIN_OUTPUT                          24000 // 1.0 ms pulse
+#define ESC_MAX_OUTPUT                          (LOOP_ESC_PULSE_MAX_US * LOOP_TIMER_TICKS_PER_US)
+#define ESC_MIN_OUTPUT                          (LOOP_ESC_PULSE_MIN_US * LOOP_TIMER_TICKS_PER_US)
 
 /* Data fitting variables to map physical outputs to motor control values
  * Thrust T(m) = AT*m + BT 		[Unit: N] [t_out unit in seconds]
@@ -62,17 +61,20 @@ typedef enum {
 #define AQ			0.000001748	// This was calculated based on aerodynamic rotor equations
 // #define BQ			0.0
 
-/* Physical control allocation constants */
-#define THRUST_ALLOC_COEFF		1/(4*AT)
-#define THRUST_ALLOC_OFFSET		-BT/AT
-#define ROLLPITCH_ALLOC_COEFF		1*M_SQRT2/(4*AT*LENGTH_ARM)
-#define	YAW_ALLOC_COEFF			1/(4*AQ)
+/* Physical control allocation constants, folded to single precision at compile time so that the allocation is
+ * done without double arithmetic */
+#define THRUST_ALLOC_COEFF		((float32_t) (1/(4*AT)))
+#define THRUST_ALLOC_OFFSET		((float32_t) (-BT/AT))
+#define ROLLPITCH_ALLOC_COEFF	((float32_t) (1*M_SQRT2/(4*AT*(double) LENGTH_ARM)))
+#define	YAW_ALLOC_COEFF			((float32_t) (1/(4*AQ)))
 
 /* Exported functions ------------------------------------------------------- */
 void MotorControlConfig(void);
 void SetMotors(uint16_t ctrlValMotor1, uint16_t ctrlValMotor2, uint16_t ctrlValMotor3, uint16_t ctrlValMotor4);
 void MotorAllocationRaw(void);
 void MotorAllocationPhysical(const float u1, const float u2, const float u3, const float u4);
+void CalculateMotorAllocationPhysical(uint16_t motorValues[4], const float u1, const float u2, const float u3, const float u4);
+void SaturateMotorSignalValues(int32_t* m1, int32_t* m2, int32_t* m3, int32_t* m4);
 void ShutdownMotors(void);
 
 MotorControlErrorStatus StartMotorControlSamplingTask(const uint16_t sampleTime, const uint32_t sampleDuration);
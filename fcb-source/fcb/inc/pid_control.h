@@ -13,6 +13,8 @@
 /* Includes ------------------------------------------------------------------*/
 #include "arm_math.h"
 
+#include <stdbool.h>
+
 /* Exported constants --------------------------------------------------------*/
 #define PID_USE_PARALLEL_FORM
 
@@ -23,7 +25,7 @@
 #define BETA_VZ				(float32_t) 1.0			// Proportional set-point weighting
 #define GAMMA_VZ			(float32_t) 0.0
 #define N_VZ				(float32_t) 1000.0		// Max derivative gain
-#define MAX_THRUST			((float32_t) 4*AT*UINT16_MAX + 4*BT)	// Maximal upward thrust from all four motors combined [N]
+#define MAX_THRUST			((float32_t) (4*AT*UINT16_MAX + 4*BT))	// Maximal upward thrust from all four motors combined [N]
 
 /* Roll/pitch angle control parameters */
 #define K_RP				(float32_t) 35.0
@@ -32,7 +34,7 @@
 #define BETA_RP				(float32_t) 1.0			// Proportional set-point weighting
 #define GAMMA_RP			(float32_t) 0.0
 #define N_RP				(float32_t) 1000.0		// Max derivative gain
-#define MAX_ROLLPITCH_MOM	((float32_t) MAX_THRUST/2*LENGTH_ARM/M_SQRT2)	// Two motors full thrust, two motors no thrust [Nm]
+#define MAX_ROLLPITCH_MOM	((float32_t) (MAX_THRUST/2*LENGTH_ARM/M_SQRT2))	// Two motors full thrust, two motors no thrust [Nm]
 
 /* Yaw angular rate control parameters */
 #define K_YR 				(float32_t) 0.0 //2.0
@@ -41,7 +43,7 @@
 #define BETA_YR				(float32_t) 1.0			// Proportional set-point weighting
 #define GAMMA_YR			(float32_t) 0.0
 #define N_YR				(float32_t) 1000.0		// Max derivative gain
-#define MAX_YAW_MOM			((float32_t) AQ*2*UINT16_MAX)		// Two motors with same rot dir full thrust, other two motors no thrust [Nm]
+#define MAX_YAW_MOM			((float32_t) (AQ*2*UINT16_MAX))		// Two motors with same rot dir full thrust, other two motors no thrust [Nm]
 
 /* Exported types ------------------------------------------------------------*/
 typedef struct
@@ -52,12 +54,45 @@ typedef struct
   float32_t yawMoment;		// [Nm]
 } CtrlSignals_TypeDef;
 
+typedef struct
+{
+  float32_t K;					// PID gain parameter
+  float32_t Ti;					// PID integration time parameter
+  float32_t Td;					// PID derivative time parameter
+  float32_t Tt;					// Anti-windup tracking parameter
+  float32_t Beta;				// Set-point weighting 0-1
+  float32_t Gamma;				// Derivative set-point weighting 0-1
+  float32_t N;					// Derivative action filter constant
+  float32_t P;					// Proportional control part
+  float32_t I;					// Integration control part
+  float32_t D;					// Derivative control part
+  float32_t preState;			// Previous control state value
+  float32_t preRef;				// Previous reference signal value
+  float32_t upperSatLimit;		// Upper saturation limit of control signal
+  float32_t lowerSatLimit;		// Lower saturation limit of control signal
+  float32_t ctrlSignalScaling;	// Scaling of PID control signal
+  float32_t ctrlSignalOffset;	// Static offset of PID control signal
+  bool useIntegralAction;		// Sets if intergral action should be used or not
+}PIDController_TypeDef;
+
+/* State of all PID controllers, used to run the control kernels in the kernel benchmark without disturbing the
+ * integrators of the flight controllers */
+typedef struct
+{
+  PIDController_TypeDef altCtrl;
+  PIDController_TypeDef rollCtrl;
+  PIDController_TypeDef pitchCtrl;
+  PIDController_TypeDef yawCtrl;
+} PIDControlContext_TypeDef;
+
 /* Exported macro ------------------------------------------------------------*/
 
 /* Exported function prototypes --------------------------------------------- */
 void InitPIDControllers(void);
 void UpdatePIDControlSignals(CtrlSignals_TypeDef* ctrlSignals);
 void ResetCtrlSignals(CtrlSignals_TypeDef* ctrlSignals);
+void SavePIDControlContext(PIDControlContext_TypeDef* context);
+void RestorePIDControlContext(const PIDControlContext_TypeDef* context);
 
 //float32_t getPRollControlSignal();
 //float32_t getDRollControlSignal();
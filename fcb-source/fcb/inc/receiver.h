@@ -12,6 +12,7 @@
 #include "stm32f3xx.h"
 
 #include "communication.h"
+#include "irq_priorities.h"
 
 #include <stdbool.h>
 
@@ -27,16 +28,17 @@
 #define PRIMARY_RECEIVER_TIM_CHANNEL_GPIO_PORT()        __GPIOD_CLK_ENABLE()
 #define PRIMARY_RECEIVER_TIM_AF                         GPIO_AF2_TIM2
 #define PRIMARY_RECEIVER_TIM_PIN_PORT                   GPIOD
-#define PRIMARY_RECEIVER_PIN_CHANNEL1                   GPIO_PIN_3
-#define PRIMARY_RECEIVER_PIN_CHANNEL2                   GPIO_PIN_4
-#define PRIMARY_RECEIVER_PIN_CHANNEL3                   GPIO_PIN_6
-#define PRIMARY_RECEIVER_PIN_CHANNEL4                   GPIO_PIN_7
+/* Pin of each TIM2 channel in the STM32F303 AF2 map. Note that PD6 is CH4 and PD7 is CH3. */
+#define PRIMARY_RECEIVER_PIN_CHANNEL1                   GPIO_PIN_3      // PD3 TIM2_CH1
+#define PRIMARY_RECEIVER_PIN_CHANNEL2                   GPIO_PIN_4      // PD4 TIM2_CH2
+#define PRIMARY_RECEIVER_PIN_CHANNEL3                   GPIO_PIN_7      // PD7 TIM2_CH3
+#define PRIMARY_RECEIVER_PIN_CHANNEL4                   GPIO_PIN_6      // PD6 TIM2_CH4
 
 /* Definitions for PRIMARY_RECEIVER_TIM NVIC */
 #define PRIMARY_RECEIVER_TIM_IRQn                       TIM2_IRQn
 #define PRIMARY_RECEIVER_TIM_IRQHandler                 TIM2_IRQHandler
-#define PRIMARY_RECEIVER_TIM_IRQ_PREEMPT_PRIO           0
-#define PRIMARY_RECEIVER_TIM_IRQ_SUB_PRIO               0
+#define PRIMARY_RECEIVER_TIM_IRQ_PREEMPT_PRIO           IRQ_PRIO_RECEIVER_CAPTURE
+#define PRIMARY_RECEIVER_TIM_IRQ_SUB_PRIO               IRQ_SUB_PRIO
 
 /* Definitions for Primary Receiver channels input */
 #define PRIMARY_RECEIVER_THROTTLE_CHANNEL               TIM_CHANNEL_1
@@ -62,14 +64,14 @@
 #define AUX_RECEIVER_TIM_CHANNEL_GPIO_PORT()            __GPIOB_CLK_ENABLE()
 #define AUX_RECEIVER_TIM_AF                             GPIO_AF2_TIM3
 #define AUX_RECEIVER_TIM_PIN_PORT                       GPIOB
-#define AUX_RECEIVER_PIN_CHANNEL1                       GPIO_PIN_4
-#define AUX_RECEIVER_PIN_CHANNEL2                       GPIO_PIN_5
+#define AUX_RECEIVER_PIN_CHANNEL1                       GPIO_PIN_4      // PB4 TIM3_CH1
+#define AUX_RECEIVER_PIN_CHANNEL2                       GPIO_PIN_5      // PB5 TIM3_CH2
 
 /* Definitions for AUX_RECEIVER_TIM NVIC */
 #define AUX_RECEIVER_TIM_IRQn                           TIM3_IRQn
 #define AUX_RECEIVER_TIM_IRQHandler                     TIM3_IRQHandler
-#define AUX_RECEIVER_TIM_IRQ_PREEMPT_PRIO               0
-#define AUX_RECEIVER_TIM_IRQ_SUB_PRIO                   0
+#define AUX_RECEIVER_TIM_IRQ_PREEMPT_PRIO               IRQ_PRIO_RECEIVER_CAPTURE
+#define AUX_RECEIVER_TIM_IRQ_SUB_PRIO                   IRQ_SUB_PRIO
 
 /* Definitions for Aux Receiver channels input */
 #define AUX_RECEIVER_GEAR_CHANNEL                       TIM_CHANNEL_1
@@ -136,6 +138,14 @@ typedef struct {
 	Receiver_IC_ChannelCalibrationValues_TypeDef Aux1Channel;
 } Receiver_CalibrationValues_TypeDef;
 
+/* Receiver capture load since start or the last reset */
+typedef struct {
+	uint32_t interrupts;        // Receiver timer interrupts
+	uint32_t elapsedMs;
+	uint32_t lostEdges;         // Overcaptures and edges out of sequence
+	uint32_t droppedEdges;      // Edges dropped because the decoding fell behind
+} Receiver_CaptureStats_TypeDef;
+
 /* Exported macro ------------------------------------------------------------*/
 
 /* Exported function prototypes --------------------------------------------- */
@@ -143,6 +153,8 @@ ReceiverErrorStatus ReceiverInputConfig(void);
 ReceiverErrorStatus StartReceiverCalibration(void);
 ReceiverErrorStatus StopReceiverCalibration(void);
 void ResetReceiverCalibrationValues(void);
+ReceiverErrorStatus CheckReceiverCalibrationValues(const Receiver_CalibrationValues_TypeDef* calibrationValues);
+void SetReceiverCalibrationValues(const Receiver_CalibrationValues_TypeDef* calibrationValues);
 ReceiverErrorStatus StartReceiverSamplingTask(const uint16_t sampleTime, const uint32_t sampleDuration);
 ReceiverErrorStatus StopReceiverSamplingTask(void);
 ReceiverErrorStatus IsReceiverActive(void);
@@ -192,12 +204,20 @@ uint32_t GetRudderReceiverChannelPeriodTicks(void);
 uint32_t GetGearReceiverChannelPeriodTicks(void);
 uint32_t GetAux1ReceiverChannelPeriodTicks(void);
 
+#if defined(RECEIVER_LEGACY_CAPTURE)
 ReceiverErrorStatus UpdateReceiverThrottleChannel(void);
 ReceiverErrorStatus UpdateReceiverAileronChannel(void);
 ReceiverErrorStatus UpdateReceiverElevatorChannel(void);
 ReceiverErrorStatus UpdateReceiverRudderChannel(void);
 ReceiverErrorStatus UpdateReceiverGearChannel(void);
 ReceiverErrorStatus UpdateReceiverAux1Channel(void);
+#else
+void HandleReceiverDeferredIRQ(void);
+#endif
+void HandlePrimaryReceiverIRQ(void);
+void HandleAuxReceiverIRQ(void);
+void GetReceiverCaptureStats(Receiver_CaptureStats_TypeDef* stats);
+void ResetReceiverCaptureStats(void);
 
 bool GetReceiverRawFlightSet(void);
 bool GetReceiverPIDFlightSet(void);
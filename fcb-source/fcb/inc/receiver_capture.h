@@ -0,0 +1,85 @@
+/******************************************************************************
+ * @file    receiver_capture.h
+ * @author  Dragonfly
+ * @version v. 1.0.0
+ * @date    2016-06-01
+ * @brief   Header file for the receiver edge timestamp capture and the batch
+ *          decoding of edge timestamps into receiver pulses
+ ******************************************************************************/
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __RECEIVER_CAPTURE_H
+#define __RECEIVER_CAPTURE_H
+
+/* Includes ------------------------------------------------------------------*/
+#include "stm32f3xx.h"
+#include "receiver.h"
+
+#include <stdbool.h>
+
+/* Exported constants --------------------------------------------------------*/
+
+/* Edges buffered per channel between two batch decodes. A decode is made every receiver counter period (~3.64 ms),
+ * in which a channel has at most two edges. Must be a power of two. */
+#define RECEIVER_EDGE_BUFFER_SIZE           8
+
+/* Edge flags */
+#define RECEIVER_EDGE_RISING                0x01    // Input level high after the edge
+#define RECEIVER_EDGE_OVERCAPTURE           0x02    // At least one edge before this one was lost
+
+/* Receiver counter period in ticks, i.e. the weight of one timer period count in an edge timestamp */
+#define RECEIVER_EDGE_COUNTER_TICKS         (RECEIVER_COUNTER_PERIOD + 1UL)
+
+/* Exported types ------------------------------------------------------------*/
+
+/* Edge timestamp ring buffer, written by the capture ISR and read by the batch decoder */
+typedef struct {
+    uint32_t timestamp[RECEIVER_EDGE_BUFFER_SIZE];  // [ticks], timer period count << 16 | capture
+    uint8_t flags[RECEIVER_EDGE_BUFFER_SIZE];
+    volatile uint8_t head;
+    volatile uint8_t tail;
+    uint32_t droppedEdges;                          // Edges dropped because the buffer was full
+} ReceiverEdgeBuffer_TypeDef;
+
+/* Per channel edge decoder state */
+typedef struct {
+    uint32_t risingTimestamp;
+    uint32_t previousRisingTimestamp;
+    uint32_t period;
+    bool pulseHigh;
+    bool previousRisingValid;
+    uint32_t lostEdges;                             // Overcaptures and edges out of sequence
+    uint32_t invalidPulses;                         // Pulses outside the valid width range
+} ReceiverEdgeDecoder_TypeDef;
+
+/* Decoded receiver pulse */
+typedef struct {
+    uint32_t risingTimestamp;                       // [ticks]
+    uint32_t period;                                // Rising to rising edge, 0 if unknown [ticks]
+    uint16_t width;                                 // [ticks]
+} ReceiverPulse_TypeDef;
+
+/* Exported macro ------------------------------------------------------------*/
+
+/* Exported function prototypes --------------------------------------------- */
+void ResetReceiverEdgeBuffer(ReceiverEdgeBuffer_TypeDef* buffer);
+void PushReceiverEdge(ReceiverEdgeBuffer_TypeDef* buffer, const uint32_t timestamp, const uint8_t flags);
+bool PopReceiverEdge(ReceiverEdgeBuffer_TypeDef* buffer, uint32_t* timestamp, uint8_t* flags);
+uint32_t GetReceiverEdgeTimestamp(const uint16_t timerPeriodCount, const uint16_t capture,
+        const bool updatePending);
+
+void ResetReceiverEdgeDecoder(ReceiverEdgeDecoder_TypeDef* decoder);
+bool DecodeReceiverEdge(ReceiverEdgeDecoder_TypeDef* decoder, const uint32_t timestamp, const uint8_t flags,
+        ReceiverPulse_TypeDef* pulse);
+bool IsReceiverPulsePeriodValid(const ReceiverPulse_TypeDef* pulse);
+
+#endif /* __RECEIVER_CAPTURE_H */
+
+/**
+ * @}
+ */
+
+/**
+ * @}
+ */
+/*****END OF FILE****/
@@ -0,0 +1,124 @@
+/******************************************************************************
+ * @file    sensor_injection.h
+ * @author  Dragonfly
+ * @version v. 1.0.0
+ * @date    2016-06-01
+ * @brief   Header file for the sensor injection mode, which replaces sensor
+ *          driver reads with frames from a host plant model and streams the
+ *          resulting motor commands back
+ ******************************************************************************/
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __SENSOR_INJECTION_H
+#define __SENSOR_INJECTION_H
+
+/* Includes ------------------------------------------------------------------*/
+#include "stm32f3xx.h"
+#include "fcb_retval.h"
+#include "build_profile.h"
+#include "arm_math.h"
+
+#include <stdbool.h>
+
+/* Exported constants --------------------------------------------------------*/
+
+/* Sensor frame payload: timestamp [us] (u32), gyroscope [rad/s] (3 x f32), accelerometer [m/s^2] (3 x f32),
+ * magnetometer (3 x f32), pressure [Pa] (i32), sensor mask (u8). Vectors are calibrated and in FCB body axes. */
+#define SENSOR_INJECTION_FRAME_SIZE         45  // [bytes]
+
+/* Motor frame payload: timestamp of the last injected frame [us] (u32), latency from its reception to the motor
+ * command [us] (u32), loop counter (u32), motor 1-4 values (4 x u16), flight control mode (u8) */
+#define SENSOR_INJECTION_MOTOR_FRAME_SIZE   21  // [bytes]
+
+/* Sensor mask bits, a sensor is only injected if its bit is set */
+#define SENSOR_INJECTION_GYRO               0x01
+#define SENSOR_INJECTION_ACC                0x02
+#define SENSOR_INJECTION_MAG                0x04
+#define SENSOR_INJECTION_BARO               0x08
+
+/* Injection stops if no sensor frame has arrived within this time */
+#define SENSOR_INJECTION_HOST_TIMEOUT       500 // [ms]
+
+/* Exported types ------------------------------------------------------------*/
+typedef enum {
+    SENSOR_INJECTION_USB = 0,
+    SENSOR_INJECTION_UART
+} SensorInjectionChannel_TypeDef;
+
+typedef enum {
+    SENSOR_INJECTION_OFF = 0,
+    SENSOR_INJECTION_ACTIVE,    // Injected frames replace driver reads, motor outputs inhibited
+    SENSOR_INJECTION_STOPPING   // Driver reads restored, motor outputs inhibited until disarmed
+} SensorInjectionState_TypeDef;
+
+typedef struct {
+    uint32_t timestampUs;
+    float32_t gyro[3];
+    float32_t acc[3];
+    float32_t mag[3];
+    int32_t pressure;
+    uint8_t sensorMask;
+} SensorInjectionFrame_TypeDef;
+
+typedef struct {
+    uint32_t frames;            // Accepted sensor frames
+    uint32_t badFrames;         // Frames with wrong size, CRC or trailer
+    uint32_t droppedBytes;      // Bytes skipped to find the next frame header
+    uint32_t overruns;          // Sensor frames dropped because the sensor task was behind
+    uint32_t motorFrames;       // Motor frames queued for sending
+    uint32_t motorDrops;        // Motor frames dropped because the send queue was full
+    uint32_t lastLatencyUs;     // Last time from sensor frame reception to motor command [us]
+    uint32_t maxLatencyUs;
+} SensorInjectionStats_TypeDef;
+
+/* Exported macro ------------------------------------------------------------*/
+
+/* Exported function prototypes --------------------------------------------- */
+#if FCB_USE_SENSOR_INJECTION
+FcbRetValType StartSensorInjection(const SensorInjectionChannel_TypeDef channel);
+FcbRetValType StopSensorInjection(void);
+SensorInjectionState_TypeDef GetSensorInjectionState(void);
+bool IsSensorInjectionActive(void);
+bool IsSensorInjectionChannel(const SensorInjectionChannel_TypeDef channel);
+bool IsMotorOutputInhibited(void);
+void GetSensorInjectionStats(SensorInjectionStats_TypeDef* stats);
+
+void ParseSensorInjectionByte(const uint8_t byte);
+void ProcessInjectedSensorFrames(void);
+void SensorInjectionControlHook(void);
+#else
+/* Sensor injection compiled out, the sensor drivers, motor output and com ports always run normally */
+static inline bool IsSensorInjectionActive(void) {
+    return false;
+}
+
+static inline bool IsSensorInjectionChannel(const SensorInjectionChannel_TypeDef channel) {
+    (void) channel;
+    return false;
+}
+
+static inline bool IsMotorOutputInhibited(void) {
+    return false;
+}
+
+static inline void ParseSensorInjectionByte(const uint8_t byte) {
+    (void) byte;
+}
+
+static inline void ProcessInjectedSensorFrames(void) {
+}
+
+static inline void SensorInjectionControlHook(void) {
+}
+#endif
+
+#endif /* __SENSOR_INJECTION_H */
+
+/**
+ * @}
+ */
+
+/**
+ * @}
+ */
+/*****END OF FILE****/
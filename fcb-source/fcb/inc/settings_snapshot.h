@@ -0,0 +1,85 @@
+/******************************************************************************
+ * @file    settings_snapshot.h
+ * @author  Dragonfly
+ * @version v. 1.0.0
+ * @date    2016-06-01
+ * @brief   Header file for the versioned binary snapshot of all settings
+ *          persisted in flash, exported and imported in one transfer
+ ******************************************************************************/
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __SETTINGS_SNAPSHOT_H
+#define __SETTINGS_SNAPSHOT_H
+
+/* Includes ------------------------------------------------------------------*/
+#include "stm32f3xx.h"
+#include "flash.h"
+
+#include <stdint.h>
+
+/* Exported constants --------------------------------------------------------*/
+
+/* Snapshot layout, all values little endian:
+ *   magic (u32), version (u8), field count (u8), payload size (u16),
+ *   payload: field count x [ field id (u8), field size (u8), field data ],
+ *   CRC (u32) of everything before it, as calculated by CalculateCRC.
+ * Field data is the in-memory layout of the stored setting. Fields may be left out, which keeps the stored value of
+ * that setting on import. */
+#define SETTINGS_SNAPSHOT_MAGIC             0x53424346  // "FCBS"
+/* Host builds of the tests may set a later version, to run the migration of snapshots exported by earlier firmware */
+#ifndef SETTINGS_SNAPSHOT_VERSION
+#define SETTINGS_SNAPSHOT_VERSION           1           // Version 0 is never valid
+#endif
+#define SETTINGS_SNAPSHOT_HEADER_SIZE       8           // [bytes]
+#define SETTINGS_SNAPSHOT_FIELD_HEADER_SIZE 2           // [bytes]
+#define SETTINGS_SNAPSHOT_CRC_SIZE          4           // [bytes]
+#define SETTINGS_SNAPSHOT_MAX_SIZE          176         // [bytes]
+
+/* Exported types ------------------------------------------------------------*/
+
+/* Field ids are never reused. A field that is extended in a later version only has members appended, so that fields
+ * of earlier versions can be migrated by keeping the stored values of the members they lack. */
+typedef enum {
+    SETTINGS_FIELD_RECEIVER_CALIBRATION = 1,    // Receiver_CalibrationValues_TypeDef
+    SETTINGS_FIELD_REFERENCE_MAX_LIMITS = 2,    // RefSignals_TypeDef
+    SETTINGS_FIELD_MAG_CALIBRATION = 3,         // float32_t[6], see FcbSensorCalibrationParmIndex
+    SETTINGS_FIELD_ACC_CALIBRATION = 4          // float32_t[6], see FcbSensorCalibrationParmIndex
+} SettingsSnapshotField_TypeDef;
+
+typedef enum {
+    SETTINGS_SNAPSHOT_OK = 0,
+    SETTINGS_SNAPSHOT_BAD_HEADER,       // Wrong magic or size
+    SETTINGS_SNAPSHOT_BAD_CRC,
+    SETTINGS_SNAPSHOT_BAD_VERSION,      // Version 0 or newer than this firmware
+    SETTINGS_SNAPSHOT_BAD_FIELD,        // Truncated, duplicated, unknown or wrong size field
+    SETTINGS_SNAPSHOT_BAD_VALUE,        // Setting value out of range
+    SETTINGS_SNAPSHOT_NOT_IDLE,         // Flight control not idle or sensors calibrating
+    SETTINGS_SNAPSHOT_FLASH_ERROR
+} SettingsSnapshotStatus_TypeDef;
+
+typedef struct {
+    uint8_t version;            // Version of the imported snapshot
+    uint8_t migratedFields;     // Fields of an earlier version extended with stored values
+    uint8_t skippedFields;      // Fields of an earlier version no longer used by this firmware
+    uint32_t importedMask;      // FLASH_SETTINGS_* bits of the imported settings
+} SettingsSnapshotImport_TypeDef;
+
+/* Exported macro ------------------------------------------------------------*/
+
+/* Exported function prototypes --------------------------------------------- */
+SettingsSnapshotStatus_TypeDef ExportSettingsSnapshot(uint8_t* snapshot, const uint16_t maxSize, uint16_t* size,
+        uint32_t* exportedMask);
+SettingsSnapshotStatus_TypeDef ImportSettingsSnapshot(const uint8_t* snapshot, const uint16_t size,
+        SettingsSnapshotImport_TypeDef* result);
+const char* GetSettingsSnapshotStatusString(const SettingsSnapshotStatus_TypeDef status);
+
+#endif /* __SETTINGS_SNAPSHOT_H */
+
+/**
+ * @}
+ */
+
+/**
+ * @}
+ */
+/*****END OF FILE****/
@@ -0,0 +1,99 @@
+/******************************************************************************
+ * @file    slack_monitor.h
+ * @author  Dragonfly
+ * @version v. 1.0.0
+ * @date    2016-06-01
+ * @brief   Header file for the control loop slack monitor and the shedding of
+ *          deferrable work under CPU pressure
+ ******************************************************************************/
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __SLACK_MONITOR_H
+#define __SLACK_MONITOR_H
+
+/* Includes ------------------------------------------------------------------*/
+#include "loop_rate.h"
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/* Exported constants --------------------------------------------------------*/
+#define SLACK_PERIOD_CYCLES                 LOOP_CPU_CYCLES_PER_PERIOD
+#define SLACK_WINDOW_CYCLES                 (LOOP_RATE_HZ / 10)     // Control cycles per evaluation window (100 ms)
+
+/* Headroom below which a level is entered, in percent of the loop period */
+#define SLACK_THROTTLE_PERCENT              40
+#define SLACK_SUSPEND_PERCENT               25
+#define SLACK_CRITICAL_PERCENT              10
+
+#define SLACK_RESTORE_PERCENT               10      // Extra headroom needed to leave a level (hysteresis)
+#define SLACK_RESTORE_WINDOWS               10      // Consecutive windows with extra headroom to leave a level (1 s)
+#define SLACK_THROTTLE_DIVIDER              4       // Rate divider of throttled work
+
+/* Consecutive skipped control ticks that are tolerated before the error handler is called (100 ms) */
+#define SLACK_MAX_CONSECUTIVE_OVERRUNS      (LOOP_RATE_HZ / 10)
+
+/* Longest time a flash write is deferred before it fails [ms] */
+#define SLACK_MAX_FLASH_DEFER_MS            5000
+#define SLACK_FLASH_DEFER_POLL_MS           100
+
+/* Exported types ------------------------------------------------------------*/
+
+/* Shedding levels, in order of increasing CPU pressure */
+typedef enum {
+    SLACK_LEVEL_NORMAL = 0,     // All work at full rate
+    SLACK_LEVEL_THROTTLE,       // Telemetry and prints at reduced rate
+    SLACK_LEVEL_SUSPEND,        // Telemetry and prints suspended
+    SLACK_LEVEL_CRITICAL,       // Calibration and flash writes deferred as well
+    SLACK_LEVEL_COUNT
+} SlackLevel_TypeDef;
+
+/* Deferrable work */
+typedef enum {
+    SLACK_WORK_TELEMETRY = 0,   // Variable watch samples
+    SLACK_WORK_PRINT,           // Print sampling tasks
+    SLACK_WORK_CALIBRATION,     // Accelerometer and magnetometer calibration
+    SLACK_WORK_FLASH,           // Flash writes
+    SLACK_WORK_COUNT
+} SlackWork_TypeDef;
+
+typedef struct {
+    SlackLevel_TypeDef level;
+    uint32_t cycles;                            // Monitored control cycles
+    uint32_t lastHeadroom;                      // Last time from loop completion to next control tick [CPU cycles]
+    uint32_t windowMinHeadroom;                 // Least headroom in the last evaluation window [CPU cycles]
+    uint32_t minHeadroom;                       // Least headroom since reset [CPU cycles]
+    uint32_t deadlineMisses;                    // Cycles that completed after the next control tick
+    uint32_t overruns;                          // Control ticks skipped because the flight control queue was full
+    uint32_t levelChanges;
+    uint32_t cyclesAtLevel[SLACK_LEVEL_COUNT];
+    uint32_t shedCount[SLACK_WORK_COUNT];       // Work items skipped or deferred
+} SlackMonitorStats_TypeDef;
+
+/* Exported macro ------------------------------------------------------------*/
+#define SLACK_PERCENT_TO_CYCLES(PERCENT)    ((uint32_t) ((uint64_t) SLACK_PERIOD_CYCLES * (PERCENT) / 100))
+
+/* Exported function prototypes --------------------------------------------- */
+void InitSlackMonitor(void);
+void UpdateSlackMonitor(const uint32_t busyCycles);
+bool ReportControlOverrun(void);
+
+SlackLevel_TypeDef GetSlackLevel(void);
+uint8_t GetSlackRateDivider(const SlackWork_TypeDef work);
+bool IsSlackWorkDue(const SlackWork_TypeDef work, const uint32_t sequence);
+
+const char* GetSlackLevelName(const SlackLevel_TypeDef level);
+const char* GetSlackWorkName(const SlackWork_TypeDef work);
+void GetSlackMonitorStats(SlackMonitorStats_TypeDef* stats);
+void ResetSlackMonitorStats(void);
+
+#endif /* __SLACK_MONITOR_H */
+
+/**
+ * @}
+ */
+
+/**
+ * @}
+ */
+/*****END OF FILE****/
@@ -15,6 +15,8 @@
 #include "flight_control.h"
 #include "fcb_retval.h"
 #include "common.h"
+#include "irq_priorities.h"
+#include "motor_control.h"
 
 /* Exported types ------------------------------------------------------------*/
 
@@ -72,27 +74,43 @@ typedef struct AttitudeStateVector
   float32_t angleRateUnbiased; // Not used in Kalman filter derivation, but should be fed in to control
 } AttitudeStateVectorType;
 
+/**
+ * Complete state of the roll, pitch and yaw estimators, used to run the estimator kernels in the kernel benchmark
+ * without disturbing the flight state estimate.
+ */
+typedef struct StateEstimationContext
+{
+  AttitudeStateVectorType state[AXES_NPR];
+  AttitudeStateVectorType stateInternal[AXES_NPR];
+  KalmanFilterType estimator[AXES_NPR];
+  uint32_t accLastCorrectionTick;
+  uint32_t magLastCorrectionTick;
+} StateEstimationContextType;
+
 /* Exported constants --------------------------------------------------------*/
 #define STATE_ESTIMATION_UPDATE_TIM                     TIM7
 #define STATE_ESTIMATION_UPDATE_TIM_CLK_ENABLE()        __TIM7_CLK_ENABLE()
 #define STATE_ESTIMATION_UPDATE_TIM_CLK_DISABLE()       __TIM7_CLK_DISABLE()
 #define STATE_ESTIMATION_UPDATE_TIM_IRQn                TIM7_IRQn
 #define STATE_ESTIMATION_UPDATE_TIM_IRQHandler          TIM7_IRQHandler
-#define STATE_ESTIMATION_UPDATE_TIM_IRQ_PREEMPT_PRIO    configLIBRARY_MAX_SYSCALL_INTERRUPT_PRIORITY // Set to this since used w/ RTOS
-#define STATE_ESTIMATION_UPDATE_TIM_IRQ_SUB_PRIO        0
-#define STATE_ESTIMATION_TIME_UPDATE_PERIOD             (60000-1)
-#define STATE_ESTIMATION_TIME_UPDATE_PRESCALER          3
+#define STATE_ESTIMATION_UPDATE_TIM_IRQ_PREEMPT_PRIO    IRQ_PRIO_CONTROL_TICK_LATCH // No RTOS calls, see irq_latch.c
+#define STATE_ESTIMATION_UPDATE_TIM_IRQ_SUB_PRIO        IRQ_SUB_PRIO
+/* The update timer counts on the motor PWM counter clock with the same nominal period, so that the control loop can
+ * be phase locked to the PWM update event (see control_phase.c) */
+#define STATE_ESTIMATION_TIME_UPDATE_PERIOD             MOTOR_OUTPUT_PERIOD
+#define STATE_ESTIMATION_TIME_UPDATE_PRESCALER          (SystemCoreClock / MOTOR_OUTPUT_COUNTER_CLOCK - 1)
 
 // TODO we need separate values for roll pitch and yaw as well as separate init values of P matrix
-#define	STATE_ESTIMATION_SAMPLE_PERIOD	(float32_t) 	FLIGHT_CONTROL_TASK_PERIOD / 1000.0
+#define	STATE_ESTIMATION_SAMPLE_PERIOD					LOOP_PERIOD_S
 
-#define Q1_RP (float32_t)								0.0008
-#define	Q2_RP (float32_t)								0.0008
+/* Model noise variances per prediction step, tuned at LOOP_REFERENCE_RATE_HZ */
+#define Q1_RP											LOOP_DISCRETE_VARIANCE(0.0008)
+#define	Q2_RP											LOOP_DISCRETE_VARIANCE(0.0008)
 
-#define Q1_Y (float32_t)								0.0004
-#define	Q2_Y (float32_t)								0.0003
+#define Q1_Y											LOOP_DISCRETE_VARIANCE(0.0004)
+#define	Q2_Y											LOOP_DISCRETE_VARIANCE(0.0003)
 
-#define Q3_CAL (float32_t)                              0.000002
+#define Q3_CAL											LOOP_DISCRETE_VARIANCE(0.000002)
 
 #define R1_MAG (float32_t)								0.05
 #define	R1_ACCRP (float32_t)						   	0.8
@@ -119,6 +137,8 @@ void InitStatesXYZ(float32_t initAngles[3]);
 StateEstimationStatus InitStateEstimationTimeEvent(void);
 void UpdatePredictionState(void);
 void UpdateCorrectionState(FcbSensorIndexType sensorType, float32_t const * pXYZ);
+void SaveStateEstimationContext(StateEstimationContextType* context);
+void RestoreStateEstimationContext(const StateEstimationContextType* context);
 
 FcbRetValType StartStateSamplingTask(const uint16_t sampleTime, const uint32_t sampleDuration);
 FcbRetValType StopStateSamplingTask(void);
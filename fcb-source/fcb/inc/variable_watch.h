@@ -0,0 +1,80 @@
+/******************************************************************************
+ * @file    variable_watch.h
+ * @author  Dragonfly
+ * @version v. 1.0.0
+ * @date    2016-06-01
+ * @brief   Header file for the variable watch, which samples arbitrary RAM
+ *          addresses from the flight control loop and streams them over USB
+ ******************************************************************************/
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __VARIABLE_WATCH_H
+#define __VARIABLE_WATCH_H
+
+/* Includes ------------------------------------------------------------------*/
+#include "stm32f3xx.h"
+#include "fcb_retval.h"
+#include "build_profile.h"
+
+#include <stdbool.h>
+
+/* Exported constants --------------------------------------------------------*/
+#define WATCH_MAX_VARIABLES             16
+#define WATCH_MAX_VALUE_SIZE            4   // [bytes]
+
+/* Allowed watch address ranges, peripheral and flash addresses are rejected */
+#define WATCH_SRAM_START                SRAM_BASE
+#define WATCH_SRAM_SIZE                 (40UL * 1024)
+#define WATCH_CCM_START                 CCMDATARAM_BASE
+#define WATCH_CCM_SIZE                  (8UL * 1024)
+
+/* Exported types ------------------------------------------------------------*/
+typedef enum {
+    WATCH_TYPE_U8 = 0,
+    WATCH_TYPE_I8,
+    WATCH_TYPE_U16,
+    WATCH_TYPE_I16,
+    WATCH_TYPE_U32,
+    WATCH_TYPE_I32,
+    WATCH_TYPE_F32,
+    WATCH_TYPE_COUNT
+} WatchType_TypeDef;
+
+typedef struct {
+    uint32_t address;
+    WatchType_TypeDef type;
+} WatchVariable_TypeDef;
+
+/* Exported macro ------------------------------------------------------------*/
+
+/* Exported function prototypes --------------------------------------------- */
+#if FCB_USE_VARIABLE_WATCH
+FcbRetValType AddWatchVariable(const uint32_t address, const WatchType_TypeDef type);
+FcbRetValType ClearWatchVariables(void);
+uint8_t GetWatchVariableCount(void);
+FcbRetValType GetWatchVariable(const uint8_t index, WatchVariable_TypeDef* variable);
+FcbRetValType ParseWatchType(const char* typeString, WatchType_TypeDef* type);
+const char* GetWatchTypeName(const WatchType_TypeDef type);
+
+FcbRetValType StartVariableWatch(const uint16_t loopDivider);
+FcbRetValType StopVariableWatch(void);
+bool IsVariableWatchRunning(void);
+uint32_t GetVariableWatchDropCount(void);
+
+void WatchSampleHook(void);
+#else
+/* Variable watch compiled out, the flight control loop hook does nothing */
+static inline void WatchSampleHook(void) {
+}
+#endif
+
+#endif /* __VARIABLE_WATCH_H */
+
+/**
+ * @}
+ */
+
+/**
+ * @}
+ */
+/*****END OF FILE****/
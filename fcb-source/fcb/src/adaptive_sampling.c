@@ -0,0 +1,336 @@
+/******************************************************************************
+ * @brief   File contains the sampling rate selection of the accelerometer and
+ *          magnetometer from the information their samples add to the
+ *          attitude estimate.
+ *
+ *          Each attitude correction reports its innovation and the a priori
+ *          error variance (p11) of the corrected estimator. A sensor is
+ *          sampled at its highest rate as soon as the filtered innovation RMS
+ *          grows, e.g. in aggressive flight, and one rate step higher when the
+ *          attitude error variance grows too large between samples. The rate
+ *          is lowered one step at a time after both have stayed below their
+ *          calm thresholds for several evaluation windows, e.g. in hover.
+ *
+ *          The sensor driver applies the requested rate as the output data
+ *          rate of the sensor, so that skipped samples cost neither an I2C
+ *          transfer nor an estimator correction.
+ *
+ *          The selection does not access any hardware or RTOS services so that
+ *          it can be run in a host model, see tools/adaptive_sampling_sim.py.
+ *
+ * @license
+ * Dragonfly FCB firmware to control the Dragonfly quadrotor UAV
+ * Copyright (C) 2016  ÅF Technology South: Dragonfly Project
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA
+ *****************************************************************************/
+
+/* Includes ------------------------------------------------------------------*/
+#include "adaptive_sampling.h"
+
+#include <string.h>
+#include <math.h>
+
+/* Private typedef -----------------------------------------------------------*/
+
+typedef struct {
+    const char* name;
+    uint16_t ratesHz[ADAPTIVE_MAX_RATES];
+    float innovationRaise;
+    float innovationCalm;
+    float stdRaise;
+    float stdCalm;
+} AdaptiveSensorConfig_TypeDef;
+
+/* Private define ------------------------------------------------------------*/
+_Static_assert(ADAPTIVE_ACC_INNOVATION_CALM < ADAPTIVE_ACC_INNOVATION_RAISE
+        && ADAPTIVE_MAG_INNOVATION_CALM < ADAPTIVE_MAG_INNOVATION_RAISE, "Innovation calm threshold must be lower");
+_Static_assert(ADAPTIVE_ACC_STD_CALM < ADAPTIVE_ACC_STD_RAISE && ADAPTIVE_MAG_STD_CALM < ADAPTIVE_MAG_STD_RAISE,
+        "Error deviation calm threshold must be lower");
+
+/* Private macro -------------------------------------------------------------*/
+
+/* Private variables ---------------------------------------------------------*/
+static const AdaptiveSensorConfig_TypeDef sensorConfig[ADAPTIVE_SENSOR_COUNT] = {
+        [ADAPTIVE_SENSOR_ACC] = { "acc", ADAPTIVE_ACC_RATES_HZ, ADAPTIVE_ACC_INNOVATION_RAISE,
+                ADAPTIVE_ACC_INNOVATION_CALM, ADAPTIVE_ACC_STD_RAISE, ADAPTIVE_ACC_STD_CALM },
+        [ADAPTIVE_SENSOR_MAG] = { "mag", ADAPTIVE_MAG_RATES_HZ, ADAPTIVE_MAG_INNOVATION_RAISE,
+                ADAPTIVE_MAG_INNOVATION_CALM, ADAPTIVE_MAG_STD_RAISE, ADAPTIVE_MAG_STD_CALM } };
+
+static AdaptiveSensorState_TypeDef sensorState[ADAPTIVE_SENSOR_COUNT];
+static volatile bool adaptiveSamplingEnabled = true;
+
+/* Private function prototypes -----------------------------------------------*/
+static void SetRateIndex(AdaptiveSensorState_TypeDef* state, const uint8_t rateIndex);
+static void UpdateAchievedRate(AdaptiveSensorState_TypeDef* state, const uint32_t timeMs);
+
+/* Exported functions --------------------------------------------------------*/
+
+/*
+ * @brief  Initializes the sampling rate selection, all sensors start at their highest rate
+ * @param  None
+ * @retval None
+ */
+void InitAdaptiveSampling(void) {
+    AdaptiveSensor_TypeDef sensor;
+    uint8_t rateCount;
+
+    memset(sensorState, 0, sizeof(sensorState));
+
+    for (sensor = ADAPTIVE_SENSOR_ACC; sensor < ADAPTIVE_SENSOR_COUNT; sensor++) {
+        /* The rate tables are zero padded up to ADAPTIVE_MAX_RATES */
+        rateCount = 0;
+        while (rateCount < ADAPTIVE_MAX_RATES && sensorConfig[sensor].ratesHz[rateCount] != 0)
+            rateCount++;
+
+        sensorState[sensor].rateCount = rateCount;
+        sensorState[sensor].rateIndex = rateCount - 1;
+    }
+
+    ResetAdaptiveSamplingStats();
+}
+
+/*
+ * @brief  Updates the sampling rate of a sensor from an attitude correction. Called by the state estimation after
+ *         each accelerometer or magnetometer correction.
+ * @param  sensor : Sensor the correction was made with
+ * @param  innovation : Difference between the measured and the a priori attitude [rad], the largest of the corrected
+ *         axes
+ * @param  errorVariance : A priori attitude error variance (p11) [rad^2], the largest of the corrected axes
+ * @param  timeMs : Time of the correction [ms]
+ * @retval None
+ */
+void UpdateAdaptiveSampling(const AdaptiveSensor_TypeDef sensor, const float innovation, const float errorVariance,
+        const uint32_t timeMs) {
+    const AdaptiveSensorConfig_TypeDef* config;
+    AdaptiveSensorState_TypeDef* state;
+    float innovationRms;
+    float errorStd;
+
+    if (sensor >= ADAPTIVE_SENSOR_COUNT)
+        return;
+
+    config = &sensorConfig[sensor];
+    state = &sensorState[sensor];
+
+    if (!state->started) {
+        state->started = true;
+        state->windowCalm = true;
+        state->windowStartMs = timeMs;
+        state->rateWindowStartMs = timeMs;
+    }
+
+    state->innovationMeanSquare += (innovation * innovation - state->innovationMeanSquare) / ADAPTIVE_INNOVATION_FILTER;
+    innovationRms = sqrtf(state->innovationMeanSquare);
+    errorStd = sqrtf(errorVariance);
+
+    state->stats.samples++;
+    state->stats.samplesAtRate[state->rateIndex]++;
+    state->stats.innovationRms = innovationRms;
+    state->stats.errorStd = errorStd;
+    UpdateAchievedRate(state, timeMs);
+
+    if (!adaptiveSamplingEnabled)
+        return;
+
+    /* Growing innovations raise the rate to the highest at once */
+    if (innovationRms > config->innovationRaise) {
+        SetRateIndex(state, state->rateCount - 1);
+        state->calmWindows = 0;
+    }
+
+    if (innovationRms >= config->innovationCalm || errorStd >= config->stdCalm)
+        state->windowCalm = false;
+    if (errorStd > state->windowMaxErrorStd)
+        state->windowMaxErrorStd = errorStd;
+
+    /* A grown attitude error raises the rate one step per window, a sustained calm lowers it one step */
+    if (timeMs - state->windowStartMs >= ADAPTIVE_WINDOW_MS) {
+        if (state->windowMaxErrorStd > config->stdRaise) {
+            if (state->rateIndex < state->rateCount - 1)
+                SetRateIndex(state, state->rateIndex + 1);
+            state->calmWindows = 0;
+        } else if (state->windowCalm && state->rateIndex > 0) {
+            if (++state->calmWindows >= ADAPTIVE_CALM_WINDOWS) {
+                SetRateIndex(state, state->rateIndex - 1);
+                state->calmWindows = 0;
+            }
+        } else {
+            state->calmWindows = 0;
+        }
+
+        state->windowCalm = true;
+        state->windowMaxErrorStd = 0.0f;
+        state->windowStartMs = timeMs;
+    }
+}
+
+/*
+ * @brief  Enables or disables the rate selection. Disabled, all sensors are sampled at their highest rate.
+ * @param  enabled : true to enable, false to disable
+ * @retval None
+ */
+void SetAdaptiveSamplingEnabled(const bool enabled) {
+    AdaptiveSensor_TypeDef sensor;
+
+    adaptiveSamplingEnabled = enabled;
+    if (enabled)
+        return;
+
+    for (sensor = ADAPTIVE_SENSOR_ACC; sensor < ADAPTIVE_SENSOR_COUNT; sensor++) {
+        SetRateIndex(&sensorState[sensor], sensorState[sensor].rateCount - 1);
+        sensorState[sensor].calmWindows = 0;
+    }
+}
+
+/*
+ * @brief  Checks if the rate selection is enabled
+ * @param  None
+ * @retval true if enabled, else false
+ */
+bool IsAdaptiveSamplingEnabled(void) {
+    return adaptiveSamplingEnabled;
+}
+
+/*
+ * @brief  Returns the requested sampling rate of a sensor
+ * @param  sensor : Sensor
+ * @retval Sampling rate [Hz], 0 if the rate selection has not been initialized
+ */
+uint16_t GetAdaptiveSampleRateHz(const AdaptiveSensor_TypeDef sensor) {
+    if (sensor >= ADAPTIVE_SENSOR_COUNT || sensorState[sensor].rateCount == 0)
+        return 0;
+
+    return sensorConfig[sensor].ratesHz[sensorState[sensor].rateIndex];
+}
+
+/*
+ * @brief  Returns the highest sampling rate of a sensor
+ * @param  sensor : Sensor
+ * @retval Sampling rate [Hz], 0 if the rate selection has not been initialized
+ */
+uint16_t GetAdaptiveMaxSampleRateHz(const AdaptiveSensor_TypeDef sensor) {
+    if (sensor >= ADAPTIVE_SENSOR_COUNT || sensorState[sensor].rateCount == 0)
+        return 0;
+
+    return sensorConfig[sensor].ratesHz[sensorState[sensor].rateCount - 1];
+}
+
+/*
+ * @brief  Returns the name of a sensor
+ * @param  sensor : Sensor
+ * @retval Name string
+ */
+const char* GetAdaptiveSensorName(const AdaptiveSensor_TypeDef sensor) {
+    if (sensor >= ADAPTIVE_SENSOR_COUNT)
+        return "?";
+
+    return sensorConfig[sensor].name;
+}
+
+/*
+ * @brief  Gets the sampling rate selection state and statistics of a sensor
+ * @param  sensor : Sensor
+ * @param  stats : Destination of the statistics
+ * @retval None
+ */
+void GetAdaptiveSamplingStats(const AdaptiveSensor_TypeDef sensor, AdaptiveSamplingStats_TypeDef* stats) {
+    if (sensor >= ADAPTIVE_SENSOR_COUNT) {
+        memset(stats, 0, sizeof(AdaptiveSamplingStats_TypeDef));
+        return;
+    }
+
+    memcpy(stats, &sensorState[sensor].stats, sizeof(AdaptiveSamplingStats_TypeDef));
+    stats->rateHz = GetAdaptiveSampleRateHz(sensor);
+    stats->maxRateHz = GetAdaptiveMaxSampleRateHz(sensor);
+}
+
+/*
+ * @brief  Resets the sampling statistics. The requested rates are kept.
+ * @param  None
+ * @retval None
+ */
+void ResetAdaptiveSamplingStats(void) {
+    AdaptiveSensor_TypeDef sensor;
+
+    for (sensor = ADAPTIVE_SENSOR_ACC; sensor < ADAPTIVE_SENSOR_COUNT; sensor++) {
+        memset(&sensorState[sensor].stats, 0, sizeof(AdaptiveSamplingStats_TypeDef));
+        sensorState[sensor].rateWindowSamples = 0;
+        sensorState[sensor].started = false;
+    }
+}
+
+/*
+ * @brief  Saves the rate selection state of all sensors. Must be called with the scheduler suspended together with
+ *         the matching RestoreAdaptiveSamplingContext(), so that no update in between is lost.
+ * @param  context : Destination of the rate selection state
+ * @retval None
+ */
+void SaveAdaptiveSamplingContext(AdaptiveSamplingContext_TypeDef* context) {
+    memcpy(context->sensorState, sensorState, sizeof(sensorState));
+}
+
+/*
+ * @brief  Restores a rate selection state saved with SaveAdaptiveSamplingContext()
+ * @param  context : The saved rate selection state
+ * @retval None
+ */
+void RestoreAdaptiveSamplingContext(const AdaptiveSamplingContext_TypeDef* context) {
+    memcpy(sensorState, context->sensorState, sizeof(sensorState));
+}
+
+/* Private functions ---------------------------------------------------------*/
+
+/*
+ * @brief  Changes the requested sampling rate of a sensor
+ * @param  state : Sensor state
+ * @param  rateIndex : Index of the new rate in the rate table
+ * @retval None
+ */
+static void SetRateIndex(AdaptiveSensorState_TypeDef* state, const uint8_t rateIndex) {
+    if (rateIndex == state->rateIndex)
+        return;
+
+    state->rateIndex = rateIndex;
+    state->stats.rateChanges++;
+}
+
+/*
+ * @brief  Counts a sample in the achieved rate measurement window and updates the achieved rate at its end
+ * @param  state : Sensor state
+ * @param  timeMs : Time of the sample [ms]
+ * @retval None
+ */
+static void UpdateAchievedRate(AdaptiveSensorState_TypeDef* state, const uint32_t timeMs) {
+    const uint32_t elapsedMs = timeMs - state->rateWindowStartMs;
+
+    state->rateWindowSamples++;
+    if (elapsedMs < ADAPTIVE_RATE_WINDOW_MS)
+        return;
+
+    /* The sample at the window end starts the next window */
+    state->stats.achievedRateHz = (uint16_t) ((state->rateWindowSamples - 1) * 1000 / elapsedMs);
+    state->rateWindowSamples = 1;
+    state->rateWindowStartMs = timeMs;
+}
+
+/**
+ * @}
+ */
+
+/**
+ * @}
+ */
+/*****END OF FILE****/
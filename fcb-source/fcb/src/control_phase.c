@@ -0,0 +1,245 @@
+/******************************************************************************
+ * @brief   File contains the phase locking of the control loop to the motor
+ *          PWM update event.
+ *
+ *          The motor timer has compare preload enabled, so new motor values
+ *          written by SetMotors() take effect at the next PWM update event.
+ *          If the control loop runs unrelated to the PWM timer, a new command
+ *          waits anywhere between 0 and one PWM period before it is output,
+ *          and the delay drifts.
+ *
+ *          The control tick timer (STATE_ESTIMATION_UPDATE_TIM) counts on the
+ *          same counter clock with the same nominal period as the motor timer.
+ *          After every control update both counters are read. The control
+ *          tick timer counter is the loop execution time and gives the motor
+ *          timer counter at the control tick, i.e. the phase of the control
+ *          tick relative to the PWM update event. The phase is measured by
+ *          hardware and therefore free of execution time jitter.
+ *
+ *          The target is to tick the configured margin plus a peak hold
+ *          estimate of the execution time before the PWM update event, so that
+ *          also slow loops complete the margin before it. A proportional
+ *          controller corrects the period of the control tick timer
+ *          (auto-reload preload, so the correction is applied from its next
+ *          period) until the phase error is zero. The output latency from
+ *          control tick to PWM update is then the peak execution time plus the
+ *          margin.
+ *
+ *          The controller functions below the exported API do not access any
+ *          hardware so that the controller can be run in a host model.
+ *
+ * @license
+ * Dragonfly FCB firmware to control the Dragonfly quadrotor UAV
+ * Copyright (C) 2016  ÅF Technology South: Dragonfly Project
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA
+ *****************************************************************************/
+
+/* Includes ------------------------------------------------------------------*/
+#include "control_phase.h"
+
+#include "state_estimation.h"
+
+/* Private typedef -----------------------------------------------------------*/
+/* Private define ------------------------------------------------------------*/
+/* Private macro -------------------------------------------------------------*/
+
+/* Private variables ---------------------------------------------------------*/
+static PhaseController_TypeDef phaseController;
+static volatile uint32_t phaseMarginTicks = CONTROL_PHASE_DEFAULT_MARGIN_US * CONTROL_PHASE_TICKS_PER_US;
+static volatile ControlPhaseStats_TypeDef phaseStats;
+
+/* Private function prototypes -----------------------------------------------*/
+
+/* Exported functions --------------------------------------------------------*/
+
+/*
+ * @brief  Initializes the control loop phase lock
+ * @param  None
+ * @retval None
+ */
+void InitControlPhaseLock(void) {
+    ResetPhaseController(&phaseController);
+    ResetControlPhaseStats();
+}
+
+/*
+ * @brief  Measures the phase of the control tick relative to the PWM update event and corrects the
+ *         period of the control tick timer. Called by the flight control task after the motors have been set.
+ * @param  None
+ * @retval None
+ */
+void UpdateControlPhaseLock(void) {
+    const uint32_t tickCounter = STATE_ESTIMATION_UPDATE_TIM->CNT;
+    const uint32_t pwmCounter = TIM_MOTOR->CNT;
+    const uint32_t slack = CONTROL_PHASE_PERIOD_TICKS - pwmCounter;
+    const uint32_t pwmCounterAtTick = (pwmCounter + CONTROL_PHASE_PERIOD_TICKS
+            - tickCounter % CONTROL_PHASE_PERIOD_TICKS) % CONTROL_PHASE_PERIOD_TICKS;
+    const uint32_t executionTime = UpdateExecutionTimeEstimate(&phaseController, tickCounter);
+    const int32_t error = GetPhaseError(pwmCounterAtTick, phaseMarginTicks + executionTime);
+    const int32_t adjust = UpdatePhaseController(&phaseController, error);
+
+    STATE_ESTIMATION_UPDATE_TIM->ARR = (uint32_t) ((int32_t) STATE_ESTIMATION_TIME_UPDATE_PERIOD + adjust);
+
+    phaseStats.locked = (phaseController.inToleranceCount >= CONTROL_PHASE_LOCK_COUNT);
+    phaseStats.lastAdjust = adjust;
+    phaseStats.lastError = error;
+    phaseStats.executionTime = executionTime;
+    phaseStats.lastSlack = slack;
+    if (slack < phaseStats.minSlack)
+        phaseStats.minSlack = slack;
+    if (slack > phaseStats.maxSlack)
+        phaseStats.maxSlack = slack;
+    phaseStats.lastOutputLatency = tickCounter + slack;
+    if (phaseStats.lastOutputLatency > phaseStats.maxOutputLatency)
+        phaseStats.maxOutputLatency = phaseStats.lastOutputLatency;
+}
+
+/*
+ * @brief  Sets the margin between control loop completion and the PWM update event
+ * @param  marginUs : Margin [us]
+ * @retval FCB_OK if within CONTROL_PHASE_MIN_MARGIN_US and CONTROL_PHASE_MAX_MARGIN_US, else FCB_ERR
+ */
+FcbRetValType SetControlPhaseMargin(const uint16_t marginUs) {
+    if (marginUs < CONTROL_PHASE_MIN_MARGIN_US || marginUs > CONTROL_PHASE_MAX_MARGIN_US)
+        return FCB_ERR;
+
+    phaseMarginTicks = (uint32_t) marginUs * CONTROL_PHASE_TICKS_PER_US;
+    return FCB_OK;
+}
+
+/*
+ * @brief  Returns the margin between control loop completion and the PWM update event
+ * @param  None
+ * @retval Margin [us]
+ */
+uint16_t GetControlPhaseMargin(void) {
+    return (uint16_t) (phaseMarginTicks / CONTROL_PHASE_TICKS_PER_US);
+}
+
+/*
+ * @brief  Gets the phase lock statistics
+ * @param  stats : Destination of the statistics, times in motor timer ticks
+ * @retval None
+ */
+void GetControlPhaseStats(ControlPhaseStats_TypeDef* stats) {
+    stats->locked = phaseStats.locked;
+    stats->lastAdjust = phaseStats.lastAdjust;
+    stats->lastError = phaseStats.lastError;
+    stats->executionTime = phaseStats.executionTime;
+    stats->lastSlack = phaseStats.lastSlack;
+    stats->minSlack = phaseStats.minSlack;
+    stats->maxSlack = phaseStats.maxSlack;
+    stats->lastOutputLatency = phaseStats.lastOutputLatency;
+    stats->maxOutputLatency = phaseStats.maxOutputLatency;
+}
+
+/*
+ * @brief  Resets the minimum/maximum values of the phase lock statistics
+ * @param  None
+ * @retval None
+ */
+void ResetControlPhaseStats(void) {
+    phaseStats.minSlack = UINT32_MAX;
+    phaseStats.maxSlack = 0;
+    phaseStats.maxOutputLatency = 0;
+}
+
+/*
+ * @brief  Resets a phase controller
+ * @param  controller : Phase controller
+ * @retval None
+ */
+void ResetPhaseController(PhaseController_TypeDef* controller) {
+    controller->pendingAdjust = 0;
+    controller->executionTime = 0;
+    controller->inToleranceCount = 0;
+}
+
+/*
+ * @brief  Updates the peak hold estimate of the control loop execution time, which rises immediately and decays
+ *         slowly
+ * @param  controller : Phase controller
+ * @param  executionTicks : Measured execution time from control tick to loop completion [ticks]
+ * @retval Execution time estimate [ticks]
+ */
+uint32_t UpdateExecutionTimeEstimate(PhaseController_TypeDef* controller, const uint32_t executionTicks) {
+    if (executionTicks >= controller->executionTime)
+        controller->executionTime = executionTicks;
+    else
+        controller->executionTime -= (controller->executionTime - executionTicks) >> CONTROL_PHASE_EXEC_DECAY_SHIFT;
+
+    return controller->executionTime;
+}
+
+/*
+ * @brief  Runs one step of the phase controller. The correction is written to the preloaded period and applied
+ *         from the next period, so the correction of the current period has not yet moved the measured phase and is
+ *         compensated for to avoid a limit cycle.
+ * @param  controller : Phase controller
+ * @param  measuredError : Phase error from GetPhaseError() [ticks]
+ * @retval Correction of the next control tick period [ticks]
+ */
+int32_t UpdatePhaseController(PhaseController_TypeDef* controller, const int32_t measuredError) {
+    int32_t phaseError = measuredError - controller->pendingAdjust;
+    int32_t adjust;
+
+    if (phaseError > CONTROL_PHASE_PERIOD_TICKS / 2)
+        phaseError -= CONTROL_PHASE_PERIOD_TICKS;
+    else if (phaseError <= -CONTROL_PHASE_PERIOD_TICKS / 2)
+        phaseError += CONTROL_PHASE_PERIOD_TICKS;
+
+    adjust = phaseError >> CONTROL_PHASE_KP_SHIFT;
+    if (adjust > CONTROL_PHASE_MAX_ADJUST)
+        adjust = CONTROL_PHASE_MAX_ADJUST;
+    else if (adjust < -CONTROL_PHASE_MAX_ADJUST)
+        adjust = -CONTROL_PHASE_MAX_ADJUST;
+
+    if (phaseError <= CONTROL_PHASE_LOCK_TOLERANCE && phaseError >= -CONTROL_PHASE_LOCK_TOLERANCE) {
+        if (controller->inToleranceCount < UINT16_MAX)
+            controller->inToleranceCount++;
+    } else {
+        controller->inToleranceCount = 0;
+    }
+
+    controller->pendingAdjust = adjust;
+    return adjust;
+}
+
+/*
+ * @brief  Calculates the phase error of the control tick
+ * @param  pwmCounterAtTick : Motor timer counter value at the control tick
+ * @param  targetTicks : Wanted time from control tick to PWM update event [ticks]
+ * @retval Phase error in (-period/2, period/2], positive if the control tick was too early [ticks]
+ */
+int32_t GetPhaseError(const uint32_t pwmCounterAtTick, const uint32_t targetTicks) {
+    int32_t error = (CONTROL_PHASE_PERIOD_TICKS - (int32_t) pwmCounterAtTick) - (int32_t) targetTicks;
+
+    if (error > CONTROL_PHASE_PERIOD_TICKS / 2)
+        error -= CONTROL_PHASE_PERIOD_TICKS;
+    else if (error <= -CONTROL_PHASE_PERIOD_TICKS / 2)
+        error += CONTROL_PHASE_PERIOD_TICKS;
+
+    return error;
+}
+
+/**
+ * @}
+ */
+
+/**
+ * @}
+ */
+/*****END OF FILE****/
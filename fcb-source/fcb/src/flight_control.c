@@ -36,6 +36,14 @@
 #include "fcb_accelerometer_magnetometer.h"
 #include "fcb_barometer.h"
 #include "flash.h"
+#include "variable_watch.h"
+#include "sensor_injection.h"
+#include "irq_latch.h"
+#include "control_phase.h"
+#include "slack_monitor.h"
+#include "adaptive_sampling.h"
+#include "blackbox.h"
+#include "cycle_counter.h"
 
 #include "FreeRTOS.h"
 #include "task.h"
@@ -67,6 +75,7 @@ typedef struct FlightControlMsg {
 
 #define FLIGHT_CONTROL_QUEUE_SIZE		      6
 #define FLIGHT_CONTROL_QUEUE_TIMEOUT          2000 // [ms]
+#define FLIGHT_CONTROL_LED_TOGGLE_LOOPS       (LOOP_RATE_HZ / 4)
 
 #define GOT_GYRO_SENSOR_SAMPLE  1
 #define GOT_ACC_SENSOR_SAMPLE   2
@@ -289,6 +298,8 @@ static void UpdateFlightControl(void) {
  * @retval None.
  */
 static void UpdateFlightMode(void) {
+	const enum FlightControlMode previousMode = flightControlMode;
+
 	if (!IsReceiverActive())
 		flightControlMode = FLIGHT_CONTROL_IDLE;
 	else if (GetReceiverRawFlightSet())
@@ -297,6 +308,9 @@ static void UpdateFlightMode(void) {
 		flightControlMode = FLIGHT_CONTROL_PID;
 	else
 		flightControlMode = FLIGHT_CONTROL_IDLE;
+
+	if (flightControlMode != previousMode)
+		BlackboxFlightModeHook(previousMode, flightControlMode);
 }
 
 /*
@@ -399,9 +413,15 @@ void SendPredictionUpdateToFlightControl(void)
     msg.type = PREDICTION_UPDATE;
     portBASE_TYPE higherPriorityTaskWoken = pdFALSE;
 
+    /* Skip the tick if the flight control task is behind, only a sustained overrun is an error */
     if (pdTRUE != xQueueSendFromISR(qFlightControl, &msg, &higherPriorityTaskWoken)) {
-        ErrorHandler();
+        if (ReportControlOverrun()) {
+            ErrorHandler();
+        }
     }
+
+    /* Switch to the flight control task directly instead of at the next RTOS tick */
+    portEND_SWITCHING_ISR(higherPriorityTaskWoken);
 }
 
 void SendCorrectionUpdateToFlightControl(FcbSensorIndexType sensorType, float32_t xyz[3])
@@ -447,6 +467,9 @@ void initKalmanFiler(void) {
 
     /* Init the states for the Kalman filter */
     InitStatesXYZ(startupSensorValues);
+    InitControlPhaseLock();
+    InitSlackMonitor();
+    InitAdaptiveSampling();
     InitStateEstimationTimeEvent();
 }
 
@@ -460,6 +483,10 @@ void setMaxLimitForReferenceSignal(float32_t maxZVelocity, float32_t maxRollAngl
 	WriteReferenceMaxLimitsToFlash(&refSignalsLimits);
 }
 
+void applyMaxLimitForReferenceSignal(const RefSignals_TypeDef* maxLimits) {
+	refSignalsLimits = *maxLimits;
+}
+
 void setMaxLimitForReferenceSignalToDefault(void) {
 	refSignalsLimits.zVelocity = DEFAULT_MAX_Z_VELOCITY;
 	refSignalsLimits.rollAngle = DEFAULT_MAX_ROLLPITCH_ANGLE;
@@ -504,6 +531,7 @@ static void FlightControlTask(void const *argument) {
 
 	for (;;) {
         FlightControlMsg_TypeDef msg;
+        uint32_t tickTimestamp;
 
         if (pdFALSE == xQueueReceive(qFlightControl, &msg,  FLIGHT_CONTROL_QUEUE_TIMEOUT)) {
             /*
@@ -515,14 +543,31 @@ static void FlightControlTask(void const *argument) {
 
         switch (msg.type) {
         case PREDICTION_UPDATE:
+            tickTimestamp = GetControlTickTimestamp();
+            RecordControlTaskLatency();
             UpdatePredictionState();
             // Intended fall through. But has to comment next case state to remove warning.
         //case FLIGHT_CONTROL_UPDATE:
             /* Perform flight control activities */
             UpdateFlightControl();
 
+            /* Align the next control tick to the PWM update event */
+            UpdateControlPhaseLock();
+
+            /* Sample watched variables, bounded cost and never blocking */
+            WatchSampleHook();
+
+            /* Report motor commands computed from injected sensor frames, never blocking */
+            SensorInjectionControlHook();
+
+            /* Record the control loop outputs, bounded cost and never blocking */
+            BlackboxControlHook(&refSignals, &ctrlSignals);
+
+            /* Shed deferrable work if the headroom to the next control tick is short */
+            UpdateSlackMonitor(GetCyclesSince(tickTimestamp));
+
             /* Blink with LED to indicate thread is alive */
-            if(ledFlashCounter % 100 == 0) {
+            if(ledFlashCounter % FLIGHT_CONTROL_LED_TOGGLE_LOOPS == 0) {
             	BSP_LED_Toggle(LED6);
             }
             ledFlashCounter++;
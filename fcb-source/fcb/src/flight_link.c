@@ -0,0 +1,205 @@
+/******************************************************************************
+ * @brief   File contains the flight link, the compact binary UART link of the
+ *          flight profile. The flight image has no command line interface, so
+ *          the UART RX task hands all received bytes to ParseFlightLinkByte().
+ *
+ *          Requests and responses use the common message header (msg id
+ *          FLIGHT_LINK_MSG_ENUM, CRC, size) and "\r\n" trailer, like the
+ *          variable watch and sensor injection frames. The payload starts
+ *          with a command byte, see flight_link.h. Requests are answered from
+ *          the UART RX task and the response is appended to the UART transmit
+ *          buffer without blocking, so the link never stalls the RX task and
+ *          never touches the flight control loop.
+ *
+ * @license
+ * Dragonfly FCB firmware to control the Dragonfly quadrotor UAV
+ * Copyright (C) 2016  ÅF Technology South: Dragonfly Project
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA
+ *****************************************************************************/
+
+/* Includes ------------------------------------------------------------------*/
+#include "flight_link.h"
+
+#include "communication.h"
+#include "common.h"
+#include "flight_control.h"
+#include "receiver.h"
+#include "uart.h"
+
+#include <string.h>
+
+#if FCB_USE_FLIGHT_LINK
+
+/* Private typedef -----------------------------------------------------------*/
+
+/* Private define ------------------------------------------------------------*/
+#define FLIGHT_LINK_TRAILER                 "\r\n"
+#define FLIGHT_LINK_TRAILER_LEN             2
+#define FLIGHT_LINK_PARSER_BUFFER_SIZE      (PROTO_HEADER_LEN + FLIGHT_LINK_MAX_REQUEST_SIZE + FLIGHT_LINK_TRAILER_LEN)
+
+/* Private variables ---------------------------------------------------------*/
+static FlightLinkStats_TypeDef linkStats;
+
+static uint8_t parserBuffer[FLIGHT_LINK_PARSER_BUFFER_SIZE];
+static uint16_t parserLength = 0;
+
+/* Private function prototypes -----------------------------------------------*/
+static void ProcessFlightLinkParserBuffer(void);
+static void DropFlightLinkParserByte(void);
+static void HandleFlightLinkRequest(const uint8_t* payload, const uint16_t payloadSize);
+static void SendFlightLinkResponse(uint8_t* frame, const uint16_t payloadSize);
+
+/* Exported functions --------------------------------------------------------*/
+
+/*
+ * @brief  Parses a byte received on the flight link. A complete request is answered before returning.
+ * @param  byte : Received byte
+ * @retval None
+ */
+void ParseFlightLinkByte(const uint8_t byte) {
+    parserBuffer[parserLength++] = byte;
+    ProcessFlightLinkParserBuffer();
+}
+
+/*
+ * @brief  Gets the flight link statistics
+ * @param  stats : Destination of the statistics
+ * @retval None
+ */
+void GetFlightLinkStats(FlightLinkStats_TypeDef* stats) {
+    *stats = linkStats;
+}
+
+/* Private functions ---------------------------------------------------------*/
+
+/*
+ * @brief  Extracts complete requests from the parser buffer. On a bad header, size, CRC or trailer one byte is
+ *         dropped and the rest of the buffer is searched for the next header.
+ * @param  None
+ * @retval None
+ */
+static void ProcessFlightLinkParserBuffer(void) {
+    uint16_t payloadSize;
+    uint32_t crc;
+
+    while (parserLength > 0) {
+        if (parserBuffer[0] != FLIGHT_LINK_MSG_ENUM) {
+            DropFlightLinkParserByte();
+            continue;
+        }
+
+        if (parserLength < PROTO_HEADER_LEN)
+            return;
+
+        memcpy(&payloadSize, &parserBuffer[5], sizeof(payloadSize));
+        if (payloadSize == 0 || payloadSize > FLIGHT_LINK_MAX_REQUEST_SIZE) {
+            linkStats.badFrames++;
+            DropFlightLinkParserByte();
+            continue;
+        }
+
+        if (parserLength < PROTO_HEADER_LEN + payloadSize + FLIGHT_LINK_TRAILER_LEN)
+            return;
+
+        memcpy(&crc, &parserBuffer[1], sizeof(crc));
+        if (crc != CalculateCRC(&parserBuffer[PROTO_HEADER_LEN], payloadSize)
+                || memcmp(&parserBuffer[PROTO_HEADER_LEN + payloadSize], FLIGHT_LINK_TRAILER,
+                        FLIGHT_LINK_TRAILER_LEN) != 0) {
+            linkStats.badFrames++;
+            DropFlightLinkParserByte();
+            continue;
+        }
+
+        HandleFlightLinkRequest(&parserBuffer[PROTO_HEADER_LEN], payloadSize);
+        parserLength = 0;
+        return;
+    }
+}
+
+/*
+ * @brief  Drops the first byte of the parser buffer
+ * @param  None
+ * @retval None
+ */
+static void DropFlightLinkParserByte(void) {
+    linkStats.droppedBytes++;
+    parserLength--;
+    memmove(parserBuffer, &parserBuffer[1], parserLength);
+}
+
+/*
+ * @brief  Handles a received request and sends its response
+ * @param  payload : Request payload, starting with the command
+ * @param  payloadSize : Payload size, 1 to FLIGHT_LINK_MAX_REQUEST_SIZE [bytes]
+ * @retval None
+ */
+static void HandleFlightLinkRequest(const uint8_t* payload, const uint16_t payloadSize) {
+    static uint8_t txBuffer[PROTO_HEADER_LEN + FLIGHT_LINK_STATUS_SIZE + FLIGHT_LINK_TRAILER_LEN];
+    uint8_t* response = &txBuffer[PROTO_HEADER_LEN];
+    UartTxStats_TypeDef uartStats;
+    uint32_t value;
+
+    if (payload[0] != FLIGHT_LINK_CMD_STATUS || payloadSize != 1) {
+        linkStats.unknownCommands++;
+        return;
+    }
+
+    linkStats.requests++;
+    GetUartTxStats(&uartStats);
+
+    response[0] = FLIGHT_LINK_CMD_STATUS;
+    value = HAL_GetTick();
+    memcpy(&response[1], &value, 4);
+    response[5] = (uint8_t) GetFlightControlMode();
+    response[6] = (IsReceiverActive() == RECEIVER_OK) ? 1 : 0;
+    memcpy(&response[7], &linkStats.requests, 4);
+    memcpy(&response[11], &linkStats.badFrames, 4);
+    memcpy(&response[15], &uartStats.droppedBytes, 4);
+
+    SendFlightLinkResponse(txBuffer, FLIGHT_LINK_STATUS_SIZE);
+}
+
+/*
+ * @brief  Adds the message header and trailer to a response and sends it without blocking
+ * @param  frame : Response frame, with the payload at PROTO_HEADER_LEN and room for the trailer
+ * @param  payloadSize : Payload size [bytes]
+ * @retval None
+ */
+static void SendFlightLinkResponse(uint8_t* frame, const uint16_t payloadSize) {
+    const uint8_t msgId = FLIGHT_LINK_MSG_ENUM;
+    uint8_t* payload = &frame[PROTO_HEADER_LEN];
+    uint32_t crc;
+
+    crc = CalculateCRC(payload, payloadSize);
+    memcpy(frame, &msgId, 1);
+    memcpy(&frame[1], &crc, 4);
+    memcpy(&frame[5], &payloadSize, 2);
+    memcpy(&payload[payloadSize], FLIGHT_LINK_TRAILER, FLIGHT_LINK_TRAILER_LEN);
+
+    if (UartSendData(frame, PROTO_HEADER_LEN + payloadSize + FLIGHT_LINK_TRAILER_LEN) != UART_OK)
+        linkStats.txDrops++;
+}
+
+#endif /* FCB_USE_FLIGHT_LINK */
+
+/**
+ * @}
+ */
+
+/**
+ * @}
+ */
+/*****END OF FILE****/
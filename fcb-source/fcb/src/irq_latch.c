@@ -0,0 +1,288 @@
+/******************************************************************************
+ * @brief   File contains the latching of control path interrupt events, their
+ *          deferred RTOS aware handling and the interrupt latency measurement.
+ *
+ *          The control tick timer and sensor DRDY interrupts run in the latch
+ *          tier of irq_priorities.h, above the RTOS syscall limit, so they
+ *          are never delayed by RTOS critical sections or by communication
+ *          interrupts. They only record a DWT cycle count timestamp of the
+ *          event and pend a software triggered deferred interrupt. The
+ *          deferred handlers run at RTOS aware priorities and forward the
+ *          events to the sensor and flight control queues, control tick and
+ *          gyroscope before the other sensors.
+ *
+ *          Each event has a latch counter written only by the latch ISR and a
+ *          handled counter written only by the deferred handler, so no
+ *          critical section is needed. If several events of the same kind are
+ *          latched before the deferred handler runs, they are handled once and
+ *          the rest are counted as missed.
+ *
+ *          For the control tick, the age of the event at ISR entry is read
+ *          from the timer counter, so all control tick latencies are measured
+ *          from the hardware update event. Worst case and last latencies are
+ *          shown with the irq-latency CLI command.
+ *
+ *          The before/after worst case latency table of this scheme is still
+ *          open, it has not been measured on a board. To measure, run each
+ *          image with the receiver on, armed in RAW mode without propellers
+ *          and with communication load (USB watch stream and print tasks).
+ *          Reset with "irq-latency r", wait at least one minute and read the
+ *          max column with "irq-latency p". For the before column, build the
+ *          earlier layout from this tree. In irq_priorities.h, set the latch
+ *          and deferred tiers, USB and UART DMA to
+ *          configLIBRARY_MAX_SYSCALL_INTERRUPT_PRIORITY, and the receiver
+ *          capture and task status timer to 0. Disable the scheme checks for
+ *          that build. The latch ISRs make no RTOS calls, so they are safe at
+ *          the shared priority.
+ *
+ * @license
+ * Dragonfly FCB firmware to control the Dragonfly quadrotor UAV
+ * Copyright (C) 2016  ÅF Technology South: Dragonfly Project
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA
+ *****************************************************************************/
+
+/* Includes ------------------------------------------------------------------*/
+#include "irq_latch.h"
+
+#include "cycle_counter.h"
+#include "fcb_sensors.h"
+#include "flight_control.h"
+#include "state_estimation.h"
+
+#include <string.h>
+
+/* Private typedef -----------------------------------------------------------*/
+/* Private define ------------------------------------------------------------*/
+/* Private macro -------------------------------------------------------------*/
+
+/* Private variables ---------------------------------------------------------*/
+static volatile uint32_t latchTimestamp[IRQ_EVENT_COUNT];
+static volatile uint32_t latchCount[IRQ_EVENT_COUNT];
+static uint32_t handledCount[IRQ_EVENT_COUNT];
+static volatile uint32_t missedCount[IRQ_EVENT_COUNT];
+
+static volatile IrqLatencyStats_TypeDef latencyStats[IRQ_LATENCY_COUNT];
+
+static const char* const latencyNames[IRQ_LATENCY_COUNT] = {
+        "Control tick ISR entry",
+        "Control tick deferred",
+        "Control tick task",
+        "Gyro DRDY deferred",
+        "Acc DRDY deferred",
+        "Mag DRDY deferred"
+};
+
+/* Private function prototypes -----------------------------------------------*/
+static bool ConsumeEvent(const IrqEvent_TypeDef event, const IrqLatency_TypeDef latency);
+static void UpdateLatency(const IrqLatency_TypeDef latency, const uint32_t cycles);
+
+/* Exported functions --------------------------------------------------------*/
+
+/*
+ * @brief  Enables the timestamp cycle counter and the deferred handler interrupts
+ * @param  None
+ * @retval None
+ */
+void InitInterruptLatch(void) {
+    InitCycleCounter();
+
+    HAL_NVIC_SetPriority(CONTROL_DEFERRED_IRQn, IRQ_PRIO_CONTROL_DEFERRED, IRQ_SUB_PRIO);
+    HAL_NVIC_EnableIRQ(CONTROL_DEFERRED_IRQn);
+
+    HAL_NVIC_SetPriority(SENSOR_DEFERRED_IRQn, IRQ_PRIO_SENSOR_DEFERRED, IRQ_SUB_PRIO);
+    HAL_NVIC_EnableIRQ(SENSOR_DEFERRED_IRQn);
+}
+
+/*
+ * @brief  Latches an interrupt event and pends its deferred handler. Called from latch tier ISRs.
+ * @param  event : Latched event
+ * @param  eventAge : CPU cycles since the event occurred, 0 if unknown
+ * @retval None
+ */
+void LatchInterruptEvent(const IrqEvent_TypeDef event, const uint32_t eventAge) {
+    latchTimestamp[event] = GetCycleCount() - eventAge;
+    latchCount[event]++;
+
+    if (event <= IRQ_EVENT_GYRO_DRDY)
+        NVIC_SetPendingIRQ(CONTROL_DEFERRED_IRQn);
+    else
+        NVIC_SetPendingIRQ(SENSOR_DEFERRED_IRQn);
+}
+
+/*
+ * @brief  Latches the control tick from the STATE_ESTIMATION_UPDATE_TIM update interrupt
+ * @param  None
+ * @retval None
+ */
+void LatchControlTick(void) {
+    /* Read the counter first, it holds the time since the update event. The timer runs on the core clock
+     * (APB1 timer clock is 2 x 36 MHz). */
+    const uint32_t eventAge = STATE_ESTIMATION_UPDATE_TIM->CNT * (STATE_ESTIMATION_UPDATE_TIM->PSC + 1);
+
+    if (__HAL_TIM_GET_FLAG(&StateEstimationTimHandle, TIM_FLAG_UPDATE) == RESET)
+        return;
+    __HAL_TIM_CLEAR_IT(&StateEstimationTimHandle, TIM_IT_UPDATE);
+
+    UpdateLatency(IRQ_LATENCY_CONTROL_TICK_ENTRY, eventAge);
+    LatchInterruptEvent(IRQ_EVENT_CONTROL_TICK, eventAge);
+}
+
+/*
+ * @brief  Deferred handler of the control tick and gyroscope events
+ * @param  None
+ * @retval None
+ */
+void HandleControlDeferredIRQ(void) {
+    if (ConsumeEvent(IRQ_EVENT_CONTROL_TICK, IRQ_LATENCY_CONTROL_TICK_DEFERRED))
+        SendPredictionUpdateToFlightControl();
+
+    if (ConsumeEvent(IRQ_EVENT_GYRO_DRDY, IRQ_LATENCY_GYRO_DEFERRED))
+        FcbSendSensorMessageFromISR(FCB_SENSOR_GYRO_DATA_READY);
+}
+
+/*
+ * @brief  Deferred handler of the accelerometer and magnetometer events
+ * @param  None
+ * @retval None
+ */
+void HandleSensorDeferredIRQ(void) {
+    if (ConsumeEvent(IRQ_EVENT_ACC_DRDY, IRQ_LATENCY_ACC_DEFERRED))
+        FcbSendSensorMessageFromISR(FCB_SENSOR_ACC_DATA_READY);
+
+    if (ConsumeEvent(IRQ_EVENT_MAG_DRDY, IRQ_LATENCY_MAG_DEFERRED))
+        FcbSendSensorMessageFromISR(FCB_SENSOR_MAGNETO_DATA_READY);
+}
+
+/*
+ * @brief  Records the latency from the last control tick to the flight control task. Called by the flight control
+ *         task when it receives a prediction update.
+ * @param  None
+ * @retval None
+ */
+void RecordControlTaskLatency(void) {
+    UpdateLatency(IRQ_LATENCY_CONTROL_TICK_TASK, GetCyclesSince(latchTimestamp[IRQ_EVENT_CONTROL_TICK]));
+}
+
+/*
+ * @brief  Returns the time of the last control tick
+ * @param  None
+ * @retval Cycle counter value at the timer update event of the last control tick
+ */
+uint32_t GetControlTickTimestamp(void) {
+    return latchTimestamp[IRQ_EVENT_CONTROL_TICK];
+}
+
+/*
+ * @brief  Returns the name of a latency measurement point
+ * @param  latency : Latency measurement point
+ * @retval Name string
+ */
+const char* GetIrqLatencyName(const IrqLatency_TypeDef latency) {
+    if (latency >= IRQ_LATENCY_COUNT)
+        return "?";
+
+    return latencyNames[latency];
+}
+
+/*
+ * @brief  Gets the statistics of a latency measurement point
+ * @param  latency : Latency measurement point
+ * @param  stats : Destination of the statistics [CPU cycles]
+ * @retval None
+ */
+void GetIrqLatencyStats(const IrqLatency_TypeDef latency, IrqLatencyStats_TypeDef* stats) {
+    if (latency >= IRQ_LATENCY_COUNT) {
+        memset(stats, 0, sizeof(IrqLatencyStats_TypeDef));
+        return;
+    }
+
+    stats->lastCycles = latencyStats[latency].lastCycles;
+    stats->maxCycles = latencyStats[latency].maxCycles;
+    stats->count = latencyStats[latency].count;
+}
+
+/*
+ * @brief  Returns the number of events that were latched again before their deferred handler ran
+ * @param  event : Latched event
+ * @retval Missed events since start or last reset
+ */
+uint32_t GetIrqEventMissedCount(const IrqEvent_TypeDef event) {
+    if (event >= IRQ_EVENT_COUNT)
+        return 0;
+
+    return missedCount[event];
+}
+
+/*
+ * @brief  Resets the latency statistics and missed event counters
+ * @param  None
+ * @retval None
+ */
+void ResetIrqLatencyStats(void) {
+    uint8_t i;
+
+    for (i = 0; i < IRQ_LATENCY_COUNT; i++) {
+        latencyStats[i].lastCycles = 0;
+        latencyStats[i].maxCycles = 0;
+        latencyStats[i].count = 0;
+    }
+
+    for (i = 0; i < IRQ_EVENT_COUNT; i++)
+        missedCount[i] = 0;
+}
+
+/* Private functions ---------------------------------------------------------*/
+
+/*
+ * @brief  Checks if an event has been latched since it was last handled and records its latency
+ * @param  event : Latched event
+ * @param  latency : Latency measurement point of the handler
+ * @retval true if the event shall be handled, else false
+ */
+static bool ConsumeEvent(const IrqEvent_TypeDef event, const IrqLatency_TypeDef latency) {
+    const uint32_t latched = latchCount[event];
+
+    if (latched == handledCount[event])
+        return false;
+
+    missedCount[event] += latched - handledCount[event] - 1;
+    handledCount[event] = latched;
+
+    UpdateLatency(latency, GetCyclesSince(latchTimestamp[event]));
+    return true;
+}
+
+/*
+ * @brief  Updates the statistics of a latency measurement point. Each point is only updated from one context.
+ * @param  latency : Latency measurement point
+ * @param  cycles : Measured latency [CPU cycles]
+ * @retval None
+ */
+static void UpdateLatency(const IrqLatency_TypeDef latency, const uint32_t cycles) {
+    latencyStats[latency].lastCycles = cycles;
+    if (cycles > latencyStats[latency].maxCycles)
+        latencyStats[latency].maxCycles = cycles;
+    latencyStats[latency].count++;
+}
+
+/**
+ * @}
+ */
+
+/**
+ * @}
+ */
+/*****END OF FILE****/
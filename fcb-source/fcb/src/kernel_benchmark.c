@@ -0,0 +1,691 @@
+/******************************************************************************
+ * @brief   File contains micro-benchmarks of the math and utility kernels used
+ *          in the flight control path (rotation transformations, state
+ *          estimation, PID control, motor allocation, sphere calibration and
+ *          FIFO buffers).
+ *
+ *          Each kernel is executed in a number of batches. Every batch is run
+ *          with the scheduler suspended and timed with the DWT cycle counter,
+ *          so the numbers reflect the real Cortex-M4 cost including FPU, flash
+ *          wait states and any soft-float double arithmetic. Interrupts stay
+ *          enabled, so the fastest batch, which is the one without interrupt
+ *          time, is reported together with the mean over all batches. The cost
+ *          of the benchmark loop itself is measured with an empty kernel and
+ *          subtracted.
+ *
+ *          A set of results can be stored as baseline, so that a later run
+ *          (e.g. after optimizing a kernel) can be compared against it.
+ *
+ *          The estimator, PID and sphere calibration kernels operate on the
+ *          live flight control state. Benchmarks are therefore only allowed
+ *          while the flight control is idle and no accelerometer/magnetometer
+ *          calibration is in progress, and the estimator, PID controller,
+ *          sensor rate selection and calibration state is saved before and
+ *          restored after each batch, with the scheduler suspended throughout.
+ *          This state is only changed by tasks, so no other task sees the
+ *          state changed by a benchmark, and no update from another task is
+ *          lost.
+ *
+ *          The control tick interrupt keeps queueing ticks for the flight
+ *          control task while a batch runs, and the ticks that do not fit in
+ *          the queue count as overruns (see slack_monitor.h). A batch must
+ *          therefore end well before SLACK_MAX_CONSECUTIVE_OVERRUNS loop
+ *          periods (100 ms). The longest batch is a single sphere fit. A run
+ *          stops when a batch takes more than half of that bound.
+ *
+ *          Profile builds (KERNEL_PROFILE_SEMIHOSTING, "Profile" build
+ *          configuration) run the same kernels in QEMU's Cortex-M4 machine
+ *          model instead of the flight application, without HAL, RTOS or
+ *          sensors, and print the approximate number of executed instructions
+ *          per kernel through semihosting before exiting QEMU:
+ *
+ *          qemu-system-arm -M netduinoplus2 -nographic -icount shift=3
+ *                          -semihosting-config enable=on,target=native
+ *                          -kernel dragonfly-fcb.elf
+ *
+ *          With -icount every instruction advances the virtual clock by the
+ *          same amount of time, so SysTick ticks are proportional to executed
+ *          instructions. The ratio is calibrated at start-up with a loop of a
+ *          known number of instructions.
+ *
+ * @license
+ * Dragonfly FCB firmware to control the Dragonfly quadrotor UAV
+ * Copyright (C) 2016  ÅF Technology South: Dragonfly Project
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA
+ *****************************************************************************/
+
+/* Includes ------------------------------------------------------------------*/
+#include "kernel_benchmark.h"
+
+#include "cycle_counter.h"
+#include "rotation_transformation.h"
+#include "state_estimation.h"
+#include "flight_control.h"
+#include "pid_control.h"
+#include "motor_control.h"
+#include "sphere_calibration.h"
+#include "fifo_buffer.h"
+#include "vector_math.h"
+#include "math_tables.h"
+#include "loop_rate.h"
+#include "fcb_sensors.h"
+#include "fcb_gyroscope.h"
+#include "fcb_accelerometer_magnetometer.h"
+#include "adaptive_sampling.h"
+#include "slack_monitor.h"
+
+#if defined(KERNEL_PROFILE_SEMIHOSTING)
+#include "trace.h"
+#include "semihosting.h"
+#endif
+
+#include "FreeRTOS.h"
+#include "task.h"
+
+#include "arm_math.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* Private typedef -----------------------------------------------------------*/
+typedef struct {
+    const char* name;
+    void (*setup)(void);    // Called before each batch, not timed (may be NULL)
+    void (*kernel)(void);   // The kernel operation to time
+    uint16_t opsPerBatch;
+    uint16_t batches;
+    uint32_t budgetCycles;  // Loop cost bound from loop_rate.h [CPU cycles/op], 0 if none
+} KernelBenchmark_TypeDef;
+
+/* Private define ------------------------------------------------------------*/
+#define KERNEL_BENCHMARK_SPHERE_SAMPLES     48
+#define KERNEL_BENCHMARK_FIFO_SIZE          128
+#define KERNEL_BENCHMARK_FIFO_CHUNK_SIZE    32
+
+/* Longest batch before the run stops, half of the control ticks the flight control task may fall behind by */
+#define KERNEL_BENCHMARK_MAX_BATCH_CYCLES   (SLACK_MAX_CONSECUTIVE_OVERRUNS * LOOP_CPU_CYCLES_PER_PERIOD / 2)
+
+#if defined(KERNEL_PROFILE_SEMIHOSTING)
+#define KERNEL_PROFILE_CALIBRATION_LOOPS    65536 // Each loop iteration is 2 instructions (subs, bne)
+#define KERNEL_PROFILE_CALIBRATION_INSTR    (2*KERNEL_PROFILE_CALIBRATION_LOOPS)
+#endif
+
+/* Private function prototypes -----------------------------------------------*/
+static void InitBenchmarkInputs(void);
+static void MeasureBatch(const KernelBenchmark_TypeDef* benchmark, uint32_t* batchCycles);
+static uint32_t MeasureOverhead(void);
+static bool IsBenchmarkAllowed(void);
+static void SaveFlightState(void);
+static void RestoreFlightState(void);
+
+static void EmptyKernel(void);
+static void UpdateRotationMatrixKernel(void);
+static void UpdateAngularRotationMatrixKernel(void);
+static void GetEulerAngularRatesKernel(void);
+static void GetAttitudeFromAccelerometerKernel(void);
+static void GetMagYawAngleKernel(void);
+static void Vector3DNormalizeKernel(void);
+static void ArmSinCosKernel(void);
+static void FastSinCosKernel(void);
+static void PressureToAltitudeKernel(void);
+static void QuatMultKernel(void);
+static void QuatRotateVec3Kernel(void);
+static void UpdatePredictionStateKernel(void);
+static void GyroCorrectionKernel(void);
+static void AccCorrectionKernel(void);
+static void MagCorrectionKernel(void);
+static void UpdatePIDControlSignalsKernel(void);
+static void MotorAllocationKernel(void);
+static void AddNewSampleKernel(void);
+static void SphereCalibrationSetup(void);
+static void SphereCalibrationKernel(void);
+static void FIFOBufferKernel(void);
+static void FlightControlStepKernel(void);
+
+#if defined(KERNEL_PROFILE_SEMIHOSTING)
+static uint32_t MeasureCalibrationLoop(void);
+static uint32_t TicksToInstructions(const uint32_t ticks, const uint32_t calibrationTicks);
+#endif
+
+/* Private variables ---------------------------------------------------------*/
+static const KernelBenchmark_TypeDef KernelBenchmarks[] = {
+        { "UpdateRotationMatrix", NULL, UpdateRotationMatrixKernel, 32, 16, 0 },
+        { "UpdateAngularRotationMatrix", NULL, UpdateAngularRotationMatrixKernel, 32, 16, 0 },
+        { "GetEulerAngularRates", NULL, GetEulerAngularRatesKernel, 32, 16, 0 },
+        { "GetAttitudeFromAccelerometer", NULL, GetAttitudeFromAccelerometerKernel, 32, 16, 0 },
+        { "GetMagYawAngle", NULL, GetMagYawAngleKernel, 32, 16, 0 },
+        { "Vector3DNormalize", NULL, Vector3DNormalizeKernel, 32, 16, 0 },
+        { "arm_sin_f32 + arm_cos_f32", NULL, ArmSinCosKernel, 32, 16, 0 },
+        { "FastSinCos", NULL, FastSinCosKernel, 32, 16, 0 },
+        { "PressureToAltitude", NULL, PressureToAltitudeKernel, 32, 16, 0 },
+        { "QuatMult", NULL, QuatMultKernel, 32, 16, 0 },
+        { "QuatRotateVec3", NULL, QuatRotateVec3Kernel, 32, 16, 0 },
+        { "UpdatePredictionState", NULL, UpdatePredictionStateKernel, 16, 16, 0 },
+        { "UpdateCorrectionState gyro", NULL, GyroCorrectionKernel, 16, 16, 0 },
+        { "UpdateCorrectionState acc", NULL, AccCorrectionKernel, 16, 16, LOOP_COST_ACC_CORRECTION },
+        { "UpdateCorrectionState mag", NULL, MagCorrectionKernel, 16, 16, LOOP_COST_MAG_CORRECTION },
+        { "UpdatePIDControlSignals", NULL, UpdatePIDControlSignalsKernel, 32, 16, 0 },
+        { "MotorAllocationPhysical", NULL, MotorAllocationKernel, 32, 16, 0 },
+        { "addNewSample", NULL, AddNewSampleKernel, KERNEL_BENCHMARK_SPHERE_SAMPLES, 8, 0 },
+        { "calibrate", SphereCalibrationSetup, SphereCalibrationKernel, 1, 4, 0 },
+        { "FIFOBuffer put/get 32 B", NULL, FIFOBufferKernel, 32, 16, 0 },
+        { "Flight control step", NULL, FlightControlStepKernel, 16, 16, LOOP_COST_FLIGHT_CONTROL_STEP },
+};
+
+#define KERNEL_BENCHMARK_COUNT  (sizeof(KernelBenchmarks)/sizeof(KernelBenchmarks[0]))
+
+static KernelBenchmarkResult_TypeDef KernelBenchmarkResults[KERNEL_BENCHMARK_COUNT];
+static bool kernelBenchmarkBaselineSet = false;
+
+/* Benchmark kernel inputs and outputs */
+static float32_t benchAttitude[3];
+static float32_t benchGyro[3];
+static float32_t benchAcc[3];
+static float32_t benchMag[3];
+static float32_t benchVector[3];
+static float32_t benchResult[3];
+static float32_t benchQuat[4];
+static float32_t benchQuatResult[4];
+static volatile int32_t benchPressure = 99870; // [Pa]
+static float32_t benchSphereSamples[KERNEL_BENCHMARK_SPHERE_SAMPLES][3];
+static float32_t benchCalibrationParams[6];
+static uint16_t benchMotorValues[4];
+static uint16_t benchSampleIndex;
+static CtrlSignals_TypeDef benchCtrlSignals;
+
+static uint8_t benchFIFOArray[KERNEL_BENCHMARK_FIFO_SIZE];
+static volatile FIFOBuffer_TypeDef benchFIFOBuffer;
+static uint8_t benchFIFOData[KERNEL_BENCHMARK_FIFO_CHUNK_SIZE];
+
+/* Flight state saved around each batch */
+static StateEstimationContextType savedStateEstimation;
+static PIDControlContext_TypeDef savedPIDControl;
+static AdaptiveSamplingContext_TypeDef savedAdaptiveSampling;
+static SphereObservations_t savedSphereObservations;
+
+/* Exported functions --------------------------------------------------------*/
+
+/*
+ * @brief  Runs all kernel benchmarks and stores the results
+ * @param  None
+ * @retval FCB_OK if benchmarks were run, FCB_ERR if flight control is not idle or a calibration is in progress
+ */
+FcbRetValType RunKernelBenchmarks(void) {
+    uint32_t batchCycles, overheadCycles, sumCycles, opCycles;
+    uint16_t i, j;
+
+    if (!IsBenchmarkAllowed())
+        return FCB_ERR;
+
+    InitCycleCounter();
+    InitBenchmarkInputs();
+    overheadCycles = MeasureOverhead();
+
+    for (i = 0; i < KERNEL_BENCHMARK_COUNT; i++) {
+        KernelBenchmarkResults[i].minCycles = UINT32_MAX;
+        sumCycles = 0;
+
+        for (j = 0; j < KernelBenchmarks[i].batches; j++) {
+            /* Stop if the flight control leaves idle or a calibration is started while the benchmarks run */
+            if (!IsBenchmarkAllowed())
+                return FCB_ERR;
+
+            MeasureBatch(&KernelBenchmarks[i], &batchCycles);
+
+#if !defined(KERNEL_PROFILE_SEMIHOSTING)
+            /* Stop before a longer batch lets the flight control task fall too far behind the control ticks */
+            if (batchCycles > KERNEL_BENCHMARK_MAX_BATCH_CYCLES)
+                return FCB_ERR;
+#endif
+
+            /* Remove benchmark loop overhead and normalize to cycles per operation */
+            if (batchCycles > overheadCycles * KernelBenchmarks[i].opsPerBatch)
+                batchCycles -= overheadCycles * KernelBenchmarks[i].opsPerBatch;
+            else
+                batchCycles = 0;
+            opCycles = batchCycles / KernelBenchmarks[i].opsPerBatch;
+
+            if (opCycles < KernelBenchmarkResults[i].minCycles)
+                KernelBenchmarkResults[i].minCycles = opCycles;
+            sumCycles += opCycles;
+        }
+
+        KernelBenchmarkResults[i].meanCycles = sumCycles / KernelBenchmarks[i].batches;
+    }
+
+    return FCB_OK;
+}
+
+/*
+ * @brief  Stores the min cycle counts of the last benchmark run as baseline for later comparisons
+ * @param  None
+ * @retval None
+ */
+void SetKernelBenchmarkBaseline(void) {
+    uint8_t i;
+
+    for (i = 0; i < KERNEL_BENCHMARK_COUNT; i++)
+        KernelBenchmarkResults[i].baselineCycles = KernelBenchmarkResults[i].minCycles;
+
+    kernelBenchmarkBaselineSet = true;
+}
+
+/*
+ * @brief  Returns true if a benchmark baseline has been stored
+ * @param  None
+ * @retval true if baseline stored, else false
+ */
+bool HasKernelBenchmarkBaseline(void) {
+    return kernelBenchmarkBaselineSet;
+}
+
+/*
+ * @brief  Returns the number of kernel benchmarks
+ * @param  None
+ * @retval Number of kernel benchmarks
+ */
+uint8_t GetKernelBenchmarkCount(void) {
+    return KERNEL_BENCHMARK_COUNT;
+}
+
+/*
+ * @brief  Returns the name of a kernel benchmark
+ * @param  index : Benchmark index [0, GetKernelBenchmarkCount()-1]
+ * @retval Benchmark name, or NULL if index is out of range
+ */
+const char* GetKernelBenchmarkName(const uint8_t index) {
+    if (index >= KERNEL_BENCHMARK_COUNT)
+        return NULL;
+
+    return KernelBenchmarks[index].name;
+}
+
+/*
+ * @brief  Gets the result of a kernel benchmark from the last run
+ * @param  index : Benchmark index [0, GetKernelBenchmarkCount()-1]
+ * @param  result : Destination of the benchmark result
+ * @retval None
+ */
+void GetKernelBenchmarkResult(const uint8_t index, KernelBenchmarkResult_TypeDef* result) {
+    if (index < KERNEL_BENCHMARK_COUNT)
+        *result = KernelBenchmarkResults[index];
+}
+
+/*
+ * @brief  Formats a kernel benchmark result as a single text line
+ * @param  dst : Destination string buffer
+ * @param  dstSize : Size of destination string buffer
+ * @param  index : Benchmark index [0, GetKernelBenchmarkCount()-1]
+ * @param  compareToBaseline : If true, the relative change to the stored baseline is appended
+ * @retval Number of characters written (see snprintf), or 0 if index is out of range
+ */
+int FormatKernelBenchmarkResult(char* dst, const size_t dstSize, const uint8_t index, const bool compareToBaseline) {
+    const KernelBenchmarkResult_TypeDef* result;
+    int len;
+    int32_t deltaPermille;
+
+    if (index >= KERNEL_BENCHMARK_COUNT)
+        return 0;
+
+    result = &KernelBenchmarkResults[index];
+
+    len = snprintf(dst, dstSize, "%-29s %7lu cyc %8lu ns %7lu mean", KernelBenchmarks[index].name,
+            result->minCycles, CYCLES_TO_NS(result->minCycles), result->meanCycles);
+
+    if (compareToBaseline && len > 0 && (size_t) len < dstSize) {
+        if (kernelBenchmarkBaselineSet && result->baselineCycles > 0) {
+            deltaPermille = ((int32_t) result->minCycles - (int32_t) result->baselineCycles) * 1000
+                    / (int32_t) result->baselineCycles;
+            len += snprintf(&dst[len], dstSize - len, " base %7lu %c%ld.%ld%%", result->baselineCycles,
+                    deltaPermille < 0 ? '-' : '+', labs(deltaPermille) / 10, labs(deltaPermille) % 10);
+        } else {
+            len += snprintf(&dst[len], dstSize - len, " no baseline");
+        }
+    }
+
+    /* Measured above the loop cost bound, the loop rate budget check in loop_rate.h is no longer valid */
+    if (KernelBenchmarks[index].budgetCycles > 0 && result->minCycles > KernelBenchmarks[index].budgetCycles
+            && len > 0 && (size_t) len < dstSize) {
+        len += snprintf(&dst[len], dstSize - len, " OVER BUDGET %lu", KernelBenchmarks[index].budgetCycles);
+    }
+
+    return len;
+}
+
+#if defined(KERNEL_PROFILE_SEMIHOSTING)
+/*
+ * @brief  Runs all kernel benchmarks without HAL and RTOS and reports the approximate number of executed
+ *         instructions per kernel to the host through semihosting. Exits QEMU when done.
+ * @param  None
+ * @retval None
+ */
+void RunKernelProfile(void) {
+    float32_t initAngles[3] = { 0.0, 0.0, 0.0 };
+    uint32_t calibrationTicks;
+    uint8_t i;
+
+    /* Same estimator and control initialization as in the flight application */
+    InitRotationMatrix();
+    InitAngularRotationMatrix();
+    InitPIDControllers();
+    InitStatesXYZ(initAngles);
+
+    InitCycleCounter();
+    calibrationTicks = MeasureCalibrationLoop();
+
+    trace_printf("Kernel profile (instructions/op, %lu ticks per %lu instructions):\n", calibrationTicks,
+            (uint32_t) KERNEL_PROFILE_CALIBRATION_INSTR);
+    trace_printf("Loop rate profile %u Hz, %lu cycles per loop, loop kernel cost bound %lu%s\n",
+            (unsigned int) LOOP_RATE_HZ, (uint32_t) LOOP_CPU_CYCLES_PER_PERIOD, (uint32_t) LOOP_COST_TOTAL,
+            LOOP_COSTS_MEASURED ? "" : " (estimated)");
+
+    if (calibrationTicks == 0 || RunKernelBenchmarks() != FCB_OK) {
+        trace_printf("Kernel profile failed, is QEMU started with -icount?\n");
+        report_exception(ADP_Stopped_RunTimeError);
+    }
+
+    for (i = 0; i < KERNEL_BENCHMARK_COUNT; i++) {
+        trace_printf("%-29s %8lu instr %8lu mean\n", KernelBenchmarks[i].name,
+                TicksToInstructions(KernelBenchmarkResults[i].minCycles, calibrationTicks),
+                TicksToInstructions(KernelBenchmarkResults[i].meanCycles, calibrationTicks));
+    }
+
+    report_exception(ADP_Stopped_ApplicationExit);
+}
+#endif
+
+/* Private functions ---------------------------------------------------------*/
+
+/*
+ * @brief  Initializes the benchmark input data from the latest sensor readings and creates synthetic samples
+ *         on a sphere for the sphere calibration benchmark
+ * @param  None
+ * @retval None
+ */
+static void InitBenchmarkInputs(void) {
+    uint16_t i;
+    float32_t azimuth, elevation;
+
+#if defined(KERNEL_PROFILE_SEMIHOSTING)
+    /* No sensors (and no RTOS for the sensor mutexes) in profile builds, use a slightly tilted hovering state */
+    benchGyro[0] = 0.02;
+    benchGyro[1] = -0.01;
+    benchGyro[2] = 0.005;
+    benchAcc[0] = 0.35;
+    benchAcc[1] = -0.17;
+    benchAcc[2] = -G_ACC;
+    benchMag[0] = 0.21;
+    benchMag[1] = 0.02;
+    benchMag[2] = 0.45;
+#else
+    GetGyroAngleDot(&benchGyro[0], &benchGyro[1], &benchGyro[2]);
+    GetAcceleration(&benchAcc[0], &benchAcc[1], &benchAcc[2]);
+    GetMagVector(&benchMag[0], &benchMag[1], &benchMag[2]);
+#endif
+
+    benchAttitude[0] = GetRollAngle();
+    benchAttitude[1] = GetPitchAngle();
+    benchAttitude[2] = GetYawAngle();
+
+    benchVector[0] = 0.3;
+    benchVector[1] = -1.2;
+    benchVector[2] = 9.7;
+
+    Vec3Normalize(benchResult, benchVector);
+    QuatFromAxisAngle(benchQuat, benchResult, 0.3);
+
+    /* Samples distributed on a sphere with offset center and non-unit radius, like raw sensor readings */
+    for (i = 0; i < KERNEL_BENCHMARK_SPHERE_SAMPLES; i++) {
+        azimuth = 2*PI*i/KERNEL_BENCHMARK_SPHERE_SAMPLES;
+        elevation = PI*((float32_t)(i % 8)/8 - 0.4375);
+        benchSphereSamples[i][0] = 0.1 + 1.2*arm_cos_f32(elevation)*arm_cos_f32(azimuth);
+        benchSphereSamples[i][1] = -0.05 + 1.1*arm_cos_f32(elevation)*arm_sin_f32(azimuth);
+        benchSphereSamples[i][2] = 0.2 + 0.9*arm_sin_f32(elevation);
+    }
+    benchSampleIndex = 0;
+
+    FIFOBufferInit(&benchFIFOBuffer, benchFIFOArray, KERNEL_BENCHMARK_FIFO_SIZE);
+    for (i = 0; i < KERNEL_BENCHMARK_FIFO_CHUNK_SIZE; i++)
+        benchFIFOData[i] = (uint8_t) i;
+
+    ResetCtrlSignals(&benchCtrlSignals);
+}
+
+/*
+ * @brief  Runs one batch of a kernel benchmark with the scheduler suspended and measures it
+ * @param  benchmark : The benchmark to run
+ * @param  batchCycles : Destination of the total number of CPU cycles of the batch
+ * @retval None
+ */
+static void MeasureBatch(const KernelBenchmark_TypeDef* benchmark, uint32_t* batchCycles) {
+    uint32_t startCycles;
+    uint16_t i;
+
+    vTaskSuspendAll();
+    SaveFlightState();
+
+    if (benchmark->setup != NULL)
+        benchmark->setup();
+
+    startCycles = GetCycleCount();
+    for (i = 0; i < benchmark->opsPerBatch; i++)
+        benchmark->kernel();
+    *batchCycles = GetCyclesSince(startCycles);
+
+    RestoreFlightState();
+    xTaskResumeAll();
+}
+
+/*
+ * @brief  Measures the per-operation overhead of the benchmark loop with an empty kernel
+ * @param  None
+ * @retval Overhead in CPU cycles per operation
+ */
+static uint32_t MeasureOverhead(void) {
+    const KernelBenchmark_TypeDef emptyBenchmark = { "", NULL, EmptyKernel, 32, 1, 0 };
+    uint32_t batchCycles, minCycles = UINT32_MAX;
+    uint8_t i;
+
+    for (i = 0; i < 8; i++) {
+        MeasureBatch(&emptyBenchmark, &batchCycles);
+        if (batchCycles < minCycles)
+            minCycles = batchCycles;
+    }
+
+    return minCycles / emptyBenchmark.opsPerBatch;
+}
+
+/*
+ * @brief  Checks that the benchmarks may run on the flight control state
+ * @param  None
+ * @retval true if the flight control is idle and no accelerometer/magnetometer calibration is in progress
+ */
+static bool IsBenchmarkAllowed(void) {
+    return GetFlightControlMode() == FLIGHT_CONTROL_IDLE && !IsAccMagMtrCalibrating();
+}
+
+/*
+ * @brief  Saves the flight state changed by the estimator, PID and calibration kernels. Called with the scheduler
+ *         suspended.
+ * @param  None
+ * @retval None
+ */
+static void SaveFlightState(void) {
+    SaveStateEstimationContext(&savedStateEstimation);
+    SavePIDControlContext(&savedPIDControl);
+    SaveAdaptiveSamplingContext(&savedAdaptiveSampling);
+    saveObservations(&savedSphereObservations);
+}
+
+/*
+ * @brief  Restores the flight state saved with SaveFlightState(). Called before the scheduler is resumed.
+ * @param  None
+ * @retval None
+ */
+static void RestoreFlightState(void) {
+    RestoreStateEstimationContext(&savedStateEstimation);
+    RestorePIDControlContext(&savedPIDControl);
+    RestoreAdaptiveSamplingContext(&savedAdaptiveSampling);
+    restoreObservations(&savedSphereObservations);
+}
+
+#if defined(KERNEL_PROFILE_SEMIHOSTING)
+/*
+ * @brief  Measures the number of SysTick ticks for a loop with a known number of instructions
+ * @param  None
+ * @retval Ticks for KERNEL_PROFILE_CALIBRATION_INSTR instructions
+ */
+static uint32_t MeasureCalibrationLoop(void) {
+    uint32_t loops = KERNEL_PROFILE_CALIBRATION_LOOPS;
+    uint32_t startTicks;
+
+    startTicks = GetCycleCount();
+    __ASM volatile ("1: subs %0, %0, #1 \n\t"
+                    "   bne 1b" : "+r" (loops) : : "cc");
+    return GetCyclesSince(startTicks);
+}
+
+/*
+ * @brief  Converts SysTick ticks to executed instructions using the calibration loop result
+ * @param  ticks : Number of ticks
+ * @param  calibrationTicks : Ticks measured with MeasureCalibrationLoop()
+ * @retval Approximate number of instructions
+ */
+static uint32_t TicksToInstructions(const uint32_t ticks, const uint32_t calibrationTicks) {
+    return (uint32_t) (((uint64_t) ticks * KERNEL_PROFILE_CALIBRATION_INSTR + calibrationTicks / 2) / calibrationTicks);
+}
+#endif
+
+static void EmptyKernel(void) {
+    __NOP();
+}
+
+static void UpdateRotationMatrixKernel(void) {
+    UpdateRotationMatrix(benchAttitude[0], benchAttitude[1], benchAttitude[2]);
+}
+
+static void UpdateAngularRotationMatrixKernel(void) {
+    UpdateAngularRotationMatrix(benchAttitude[0], benchAttitude[1]);
+}
+
+static void GetEulerAngularRatesKernel(void) {
+    GetEulerAngularRates(benchResult, benchGyro, benchAttitude[0], benchAttitude[1]);
+}
+
+static void GetAttitudeFromAccelerometerKernel(void) {
+    GetAttitudeFromAccelerometer(benchResult, benchAcc);
+}
+
+static void GetMagYawAngleKernel(void) {
+    benchResult[0] = GetMagYawAngle(benchMag, benchAttitude[0], benchAttitude[1]);
+}
+
+static void Vector3DNormalizeKernel(void) {
+    Vector3DNormalize(benchResult, benchVector);
+}
+
+static void ArmSinCosKernel(void) {
+    benchResult[0] = arm_sin_f32(benchAttitude[0]);
+    benchResult[1] = arm_cos_f32(benchAttitude[0]);
+}
+
+static void FastSinCosKernel(void) {
+    FastSinCos(benchAttitude[0], &benchResult[0], &benchResult[1]);
+}
+
+static void PressureToAltitudeKernel(void) {
+    benchResult[0] = PressureToAltitude(benchPressure);
+}
+
+static void QuatMultKernel(void) {
+    QuatMult(benchQuatResult, benchQuat, benchQuat);
+}
+
+static void QuatRotateVec3Kernel(void) {
+    QuatRotateVec3(benchResult, benchQuat, benchVector);
+}
+
+static void UpdatePredictionStateKernel(void) {
+    UpdatePredictionState();
+}
+
+static void GyroCorrectionKernel(void) {
+    UpdateCorrectionState(GYRO_IDX, benchGyro);
+}
+
+static void AccCorrectionKernel(void) {
+    UpdateCorrectionState(ACC_IDX, benchAcc);
+}
+
+static void MagCorrectionKernel(void) {
+    UpdateCorrectionState(MAG_IDX, benchMag);
+}
+
+static void UpdatePIDControlSignalsKernel(void) {
+    UpdatePIDControlSignals(&benchCtrlSignals);
+}
+
+static void MotorAllocationKernel(void) {
+    CalculateMotorAllocationPhysical(benchMotorValues, -MASS*G_ACC, 0.05, -0.05, 0.01);
+}
+
+static void AddNewSampleKernel(void) {
+    addNewSample(benchSphereSamples[benchSampleIndex]);
+    benchSampleIndex = (benchSampleIndex + 1) % KERNEL_BENCHMARK_SPHERE_SAMPLES;
+}
+
+static void SphereCalibrationSetup(void) {
+    uint16_t i;
+
+    /* calibrate() clears the observations, so new samples are needed before each run */
+    for (i = 0; i < KERNEL_BENCHMARK_SPHERE_SAMPLES; i++)
+        addNewSample(benchSphereSamples[i]);
+}
+
+static void SphereCalibrationKernel(void) {
+    calibrate(benchCalibrationParams);
+}
+
+static void FIFOBufferKernel(void) {
+    uint8_t* dataPtr;
+    uint16_t dataSize;
+
+    FIFOBufferPutData(&benchFIFOBuffer, benchFIFOData, KERNEL_BENCHMARK_FIFO_CHUNK_SIZE);
+
+    /* Data may be returned in two parts if the FIFO wraps around */
+    dataSize = FIFOBufferGetData(&benchFIFOBuffer, &dataPtr, KERNEL_BENCHMARK_FIFO_CHUNK_SIZE);
+    if (dataSize < KERNEL_BENCHMARK_FIFO_CHUNK_SIZE)
+        FIFOBufferGetData(&benchFIFOBuffer, &dataPtr, KERNEL_BENCHMARK_FIFO_CHUNK_SIZE - dataSize);
+}
+
+static void FlightControlStepKernel(void) {
+    /* One flight control cycle: prediction, gyroscope correction, PID control and motor allocation */
+    UpdatePredictionState();
+    UpdateCorrectionState(GYRO_IDX, benchGyro);
+    UpdatePIDControlSignals(&benchCtrlSignals);
+    CalculateMotorAllocationPhysical(benchMotorValues, -MASS*G_ACC, benchCtrlSignals.rollMoment,
+            benchCtrlSignals.pitchMoment, benchCtrlSignals.yawMoment);
+}
+
+/**
+ * @}
+ */
+
+/**
+ * @}
+ */
+/*****END OF FILE****/
@@ -40,6 +40,8 @@
 #include "fcb_gyroscope.h"
 #include "state_estimation.h"
 #include "uart.h"
+#include "kernel_benchmark.h"
+#include "irq_latch.h"
 
 #include "FreeRTOS.h"
 #include "task.h"
@@ -71,6 +73,11 @@ int main(void) {
      * system_stm32f30x.c file
      */
 
+#if defined(KERNEL_PROFILE_SEMIHOSTING)
+    /* Profile the flight control kernels in QEMU instead of running the flight application */
+    RunKernelProfile();
+#endif
+
     /* Init system at low level */
     InitSystem();
 
@@ -110,8 +117,10 @@ static void InitSystem(void) {
     /* Configure the system clock to 72 Mhz */
     ConfigSystemClock();
 
+#if FCB_USE_CLI
     /* Initialize Command Line Interface for USB communication */
     RegisterCLICommands();
+#endif
 
     /* Configure UART */
     UartConfig();
@@ -122,6 +131,9 @@ static void InitSystem(void) {
     /* Init User button */
     BSP_PB_Init(BUTTON_USER, BUTTON_MODE_EXTI);
 
+    /* Init interrupt event latching before any latch tier interrupt is enabled */
+    InitInterruptLatch();
+
     /* Init sensor reading */
     if (FCB_OK != FcbSensorsConfig()) {
         ErrorHandler();
@@ -140,8 +152,10 @@ static void InitSystem(void) {
     /* Setup receiver timers for receiver input */
     ReceiverInputConfig();
 
+#if defined(TASK_STATUS)
     /* Setup timer for task status command*/
     InitMonitoring();
+#endif
 }
 
 /**
@@ -162,10 +176,11 @@ static void InitRTOS(void) {
 #if defined(USE_USB_COM)
     CreateUSBComQueues();
 #endif
-    CreateUARTComQueues();
 
     /* # CREATE SEMAPHORES #################################################### */
+#if FCB_USE_CLI
     CreateCLISemaphores();
+#endif
 #if defined(USE_USB_COM)
     CreateUSBComSemaphores();
 #endif
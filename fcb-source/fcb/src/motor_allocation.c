@@ -0,0 +1,112 @@
+/*****************************************************************************
+ * @file    motor_allocation.c
+ * @brief   File contains the physical control allocation, which maps the
+ *          thrust force and roll, pitch and yaw moments to the four motor
+ *          signal values. Kept apart from the PWM output in motor_control.c
+ *          as it does not depend on any hardware, so that it can also be
+ *          built and benchmarked on the host (see tests/).
+ ******************************************************************************/
+
+/* Includes ------------------------------------------------------------------*/
+#include "motor_control.h"
+
+#include "common.h"
+
+/* Private typedef -----------------------------------------------------------*/
+/* Private define ------------------------------------------------------------*/
+/* Private macro -------------------------------------------------------------*/
+/* Private variables ---------------------------------------------------------*/
+/* Private function prototypes -----------------------------------------------*/
+
+/* Exported functions --------------------------------------------------------*/
+
+/*
+ * @brief  Calculates the motor output values for the desired thrust force and moments without setting the motors.
+ * @param  motorValues : Destination array for the saturated motor 1-4 output values [0, UINT16_MAX]
+ * @param  u1 : thrust force [N]
+ * @param  u2 : roll moment [Nm]
+ * @param  u3 : pitch moment [Nm]
+ * @param  u4 : yaw moment [Nm]
+ * @retval None.
+ */
+void CalculateMotorAllocationPhysical(uint16_t motorValues[4], const float u1, const float u2, const float u3, const float u4) {
+	int32_t m1, m2, m3, m4;
+	float32_t thrust, roll, pitch, yaw;
+
+	/* Calculate physical motor control allocation. Remember that Z points down, so u1 will be negative. */
+	thrust = -THRUST_ALLOC_COEFF*u1 - THRUST_ALLOC_OFFSET;
+	roll = ROLLPITCH_ALLOC_COEFF*u2;
+	pitch = ROLLPITCH_ALLOC_COEFF*u3;
+	yaw = YAW_ALLOC_COEFF*u4;
+
+	m1 = (int32_t) (thrust - roll + pitch + yaw);
+	m2 = (int32_t) (thrust + roll + pitch - yaw);
+	m3 = (int32_t) (thrust + roll - pitch + yaw);
+	m4 = (int32_t) (thrust - roll - pitch - yaw);
+
+	/* Saturate motor signal values [0, UINT16_MAX] */
+	SaturateMotorSignalValues(&m1, &m2, &m3, &m4);
+
+	motorValues[0] = (uint16_t) m1;
+	motorValues[1] = (uint16_t) m2;
+	motorValues[2] = (uint16_t) m3;
+	motorValues[3] = (uint16_t) m4;
+}
+
+/*
+ * @brief  Saturates motor signal values to [0, UINT16_MAX]. A negative value is moved to the opposite motor, which
+ *         has the same rotation direction, so that the yaw moment is kept.
+ * @param  m1 : Motor 1 signal value, saturated in place
+ * @param  m2 : Motor 2 signal value, saturated in place
+ * @param  m3 : Motor 3 signal value, saturated in place
+ * @param  m4 : Motor 4 signal value, saturated in place
+ * @retval None.
+ */
+void SaturateMotorSignalValues(int32_t* m1, int32_t* m2, int32_t* m3, int32_t* m4)
+{
+	/* Check unsigned 16-bit overflow */
+	if (!IS_NOT_GREATER_UINT16_MAX(*m1))
+		*m1 = UINT16_MAX;
+	if (!IS_NOT_GREATER_UINT16_MAX(*m2))
+		*m2 = UINT16_MAX;
+	if (!IS_NOT_GREATER_UINT16_MAX(*m3))
+		*m3 = UINT16_MAX;
+	if (!IS_NOT_GREATER_UINT16_MAX(*m4))
+		*m4 = UINT16_MAX;
+
+	/* Check unsigned 16-bit underflow (less than zero) */
+	if (!IS_POS(*m1) && !IS_POS(*m3)) {
+		*m1 = 0;
+		*m3 = 0;
+	}
+	if (!IS_POS(*m2) && !IS_POS(*m4)) {
+		*m2 = 0;
+		*m4 = 0;
+	}
+
+	if (!IS_POS(*m1)) {
+		*m3 += *m1;
+		*m1 = 0;
+	}
+	if (!IS_POS(*m2)) {
+		*m4 += *m2;
+		*m2 = 0;
+	}
+	if (!IS_POS(*m3)) {
+		*m1 += *m3;
+		*m3 = 0;
+	}
+	if (!IS_POS(*m4)) {
+		*m2 += *m4;
+		*m4 = 0;
+	}
+}
+
+/**
+ * @}
+ */
+
+/**
+ * @}
+ */
+/*****END OF FILE****/
@@ -18,7 +18,10 @@
 
 #include "fcb_error.h"
 #include "receiver.h"
+#include "sensor_injection.h"
 #include "common.h"
+#include "build_profile.h"
+#include "slack_monitor.h"
 #include "dragonfly_fcb.pb.h"
 #include "pb_encode.h"
 #include "usbd_cdc_if.h"
@@ -71,16 +74,20 @@ static TIM_HandleTypeDef MotorControlTimHandle;
 
 /* Task handle for printing of sensor values task */
 xTaskHandle MotorControlPrintSamplingTaskHandle = NULL;
+#if FCB_USE_PRINT_TASKS
 static volatile uint16_t motorControlPrintSampleTime;
 static volatile uint16_t motorControlPrintSampleDuration;
+#endif
 
 /* Private function prototypes -----------------------------------------------*/
+#if FCB_USE_PRINT_TASKS
 static void MotorControlPrintSamplingTask(void const *argument);
+#endif
 static void SetMotor1(const uint16_t ctrlVal);
 static void SetMotor2(const uint16_t ctrlVal);
 static void SetMotor3(const uint16_t ctrlVal);
 static void SetMotor4(const uint16_t ctrlVal);
-static void SaturateMotorSignalValues();
+static uint16_t GetMotorCompareValue(const uint16_t ctrlVal);
 
 /* Exported functions --------------------------------------------------------*/
 
@@ -157,6 +164,10 @@ void MotorControlConfig(void) {
 		ErrorHandler();
 	}
 
+	/* The HAL enables compare preload for PWM channels. Together with auto-reload preload, new motor values take
+	 * effect simultaneously at the next update event, which the control loop is phase locked to. */
+	MotorControlTimHandle.Instance->CR1 |= TIM_CR1_ARPE;
+
 	/*##-3- Start PWM signals generation #######################################*/
 	/* Start Motor 1 channel */
 	if (HAL_TIM_PWM_Start(&MotorControlTimHandle, MOTOR1_CHANNEL) != HAL_OK) {
@@ -267,20 +278,13 @@ void ShutdownMotors(void) {
  * @retval None.
  */
 void MotorAllocationPhysical(const float u1, const float u2, const float u3, const float u4) {
-	int32_t m1, m2, m3, m4;
-
-	/* Calculate physical motor control allocation. Remember that Z points down, so u1 will be negative. */
-	m1 = (int32_t) (-THRUST_ALLOC_COEFF*u1 - THRUST_ALLOC_OFFSET - ROLLPITCH_ALLOC_COEFF*u2 + ROLLPITCH_ALLOC_COEFF*u3 + YAW_ALLOC_COEFF*u4);
-	m2 = (int32_t) (-THRUST_ALLOC_COEFF*u1 - THRUST_ALLOC_OFFSET + ROLLPITCH_ALLOC_COEFF*u2 + ROLLPITCH_ALLOC_COEFF*u3 - YAW_ALLOC_COEFF*u4);
-	m3 = (int32_t) (-THRUST_ALLOC_COEFF*u1 - THRUST_ALLOC_OFFSET + ROLLPITCH_ALLOC_COEFF*u2 - ROLLPITCH_ALLOC_COEFF*u3 + YAW_ALLOC_COEFF*u4);
-	m4 = (int32_t) (-THRUST_ALLOC_COEFF*u1 - THRUST_ALLOC_OFFSET - ROLLPITCH_ALLOC_COEFF*u2 - ROLLPITCH_ALLOC_COEFF*u3 - YAW_ALLOC_COEFF*u4);
+	uint16_t motorValues[4];
 
-	/* Saturate motor signal values [0, UINT16_MAX] */
-	SaturateMotorSignalValues(&m1, &m2, &m3, &m4);
+	CalculateMotorAllocationPhysical(motorValues, u1, u2, u3, u4);
 
 	if (IsReceiverActive()) {
 		/* Set the motor signal values */
-		SetMotors(m1, m2, m3, m4);
+		SetMotors(motorValues[0], motorValues[1], motorValues[2], motorValues[3]);
 	} else {
 		ShutdownMotors();
 	}
@@ -293,6 +297,7 @@ void MotorAllocationPhysical(const float u1, const float u2, const float u3, con
  * @retval MOTORCTRL_OK if thread started, else MOTORCTRL_ERROR.
  */
 MotorControlErrorStatus StartMotorControlSamplingTask(const uint16_t sampleTime, const uint32_t sampleDuration) {
+#if FCB_USE_PRINT_TASKS
 	if(sampleTime < MOTOR_CONTROL_PRINT_MINIMUM_SAMPLING_TIME)
 		motorControlPrintSampleTime = MOTOR_CONTROL_PRINT_MINIMUM_SAMPLING_TIME;
 	else
@@ -315,6 +320,11 @@ MotorControlErrorStatus StartMotorControlSamplingTask(const uint16_t sampleTime,
 	}
 
 	return MOTORCTRL_OK;
+#else
+	(void) sampleTime;
+	(void) sampleDuration;
+	return MOTORCTRL_ERROR;
+#endif
 }
 
 /*
@@ -353,6 +363,7 @@ uint16_t GetMotorValue(uint8_t motorNumber) {
 
 /* Private functions ---------------------------------------------------------*/
 
+#if FCB_USE_PRINT_TASKS
 /**
  * @brief  Task code handles motor control signal print sampling
  * @param  argument : Unused parameter
@@ -363,6 +374,7 @@ static void MotorControlPrintSamplingTask(void const *argument) {
 
 	portTickType xLastWakeTime;
 	portTickType xSampleStartTime;
+	uint32_t printCount = 0;
 
 	/* Initialise the xLastWakeTime variable with the current time */
 	xLastWakeTime = xTaskGetTickCount();
@@ -371,13 +383,15 @@ static void MotorControlPrintSamplingTask(void const *argument) {
 	for (;;) {
 		vTaskDelayUntil(&xLastWakeTime, motorControlPrintSampleTime);
 
-		PrintMotorControlValues();
+		if (IsSlackWorkDue(SLACK_WORK_PRINT, printCount++))
+			PrintMotorControlValues();
 
 		/* If sampling duration exceeded, delete task to stop sampling */
 		if (xTaskGetTickCount() >= xSampleStartTime + motorControlPrintSampleDuration * configTICK_RATE_HZ)
 			StopMotorControlSamplingTask();
 	}
 }
+#endif
 
 /*
  * @brief  Sets the motor control PWM (sent to ESC) for motor 1
@@ -385,8 +399,7 @@ static void MotorControlPrintSamplingTask(void const *argument) {
  * @retval None.
  */
 static void SetMotor1(const uint16_t ctrlVal) {
-	uint32_t ccrVal = ESC_MIN_OUTPUT + ctrlVal * (ESC_MAX_OUTPUT - ESC_MIN_OUTPUT) / UINT16_MAX;
-	__HAL_TIM_SetCompare(&MotorControlTimHandle, MOTOR1_CHANNEL, (uint16_t)ccrVal);
+	__HAL_TIM_SetCompare(&MotorControlTimHandle, MOTOR1_CHANNEL, GetMotorCompareValue(ctrlVal));
 	MotorControlValues.Motor1 = ctrlVal;
 }
 
@@ -396,8 +409,7 @@ static void SetMotor1(const uint16_t ctrlVal) {
  * @retval None.
  */
 static void SetMotor2(const uint16_t ctrlVal) {
-	uint32_t ccrVal = ESC_MIN_OUTPUT + ctrlVal * (ESC_MAX_OUTPUT - ESC_MIN_OUTPUT) / UINT16_MAX;
-	__HAL_TIM_SetCompare(&MotorControlTimHandle, MOTOR2_CHANNEL, (uint16_t)ccrVal);
+	__HAL_TIM_SetCompare(&MotorControlTimHandle, MOTOR2_CHANNEL, GetMotorCompareValue(ctrlVal));
 	MotorControlValues.Motor2 = ctrlVal;
 }
 
@@ -407,8 +419,7 @@ static void SetMotor2(const uint16_t ctrlVal) {
  * @retval None.
  */
 static void SetMotor3(const uint16_t ctrlVal) {
-	uint32_t ccrVal = ESC_MIN_OUTPUT + ctrlVal * (ESC_MAX_OUTPUT - ESC_MIN_OUTPUT) / UINT16_MAX;
-	__HAL_TIM_SetCompare(&MotorControlTimHandle, MOTOR3_CHANNEL, (uint16_t)ccrVal);
+	__HAL_TIM_SetCompare(&MotorControlTimHandle, MOTOR3_CHANNEL, GetMotorCompareValue(ctrlVal));
 	MotorControlValues.Motor3 = ctrlVal;
 }
 
@@ -418,49 +429,21 @@ static void SetMotor3(const uint16_t ctrlVal) {
  * @retval None.
  */
 static void SetMotor4(const uint16_t ctrlVal) {
-	uint32_t ccrVal = ESC_MIN_OUTPUT + ctrlVal * (ESC_MAX_OUTPUT - ESC_MIN_OUTPUT) / UINT16_MAX;
-	__HAL_TIM_SetCompare(&MotorControlTimHandle, MOTOR4_CHANNEL, (uint16_t)ccrVal);
+	__HAL_TIM_SetCompare(&MotorControlTimHandle, MOTOR4_CHANNEL, GetMotorCompareValue(ctrlVal));
 	MotorControlValues.Motor4 = ctrlVal;
 }
 
-static void SaturateMotorSignalValues(int32_t* m1, int32_t* m2, int32_t* m3, int32_t* m4)
-{
-	/* Check unsigned 16-bit overflow */
-	if (!IS_NOT_GREATER_UINT16_MAX(*m1))
-		*m1 = UINT16_MAX;
-	if (!IS_NOT_GREATER_UINT16_MAX(*m2))
-		*m2 = UINT16_MAX;
-	if (!IS_NOT_GREATER_UINT16_MAX(*m3))
-		*m3 = UINT16_MAX;
-	if (!IS_NOT_GREATER_UINT16_MAX(*m4))
-		*m4 = UINT16_MAX;
-
-	/* Check unsigned 16-bit underflow (less than zero) */
-	if (!IS_POS(*m1) && !IS_POS(*m3)) {
-		*m1 = 0;
-		*m3 = 0;
-	}
-	if (!IS_POS(*m2) && !IS_POS(*m4)) {
-		*m2 = 0;
-		*m4 = 0;
-	}
+/*
+ * @brief  Converts a motor control value to the PWM compare value. Zero pulse width while the motor outputs are
+ *         inhibited by sensor injection, so that the motors are never driven from simulated sensor data.
+ * @param  ctrlVal: value [0,65535] indicating amount of motor thrust
+ * @retval PWM compare value
+ */
+static uint16_t GetMotorCompareValue(const uint16_t ctrlVal) {
+	if (IsMotorOutputInhibited())
+		return 0;
 
-	if (!IS_POS(*m1)) {
-		*m3 += *m1;
-		*m1 = 0;
-	}
-	if (!IS_POS(*m2)) {
-		*m4 += *m2;
-		*m2 = 0;
-	}
-	if (!IS_POS(*m3)) {
-		*m1 += *m3;
-		*m3 = 0;
-	}
-	if (!IS_POS(*m4)) {
-		*m2 += *m4;
-		*m4 = 0;
-	}
+	return (uint16_t) (ESC_MIN_OUTPUT + ctrlVal * (ESC_MAX_OUTPUT - ESC_MIN_OUTPUT) / UINT16_MAX);
 }
 
 /**
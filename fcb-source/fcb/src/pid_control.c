@@ -33,31 +33,11 @@
 #include <stdbool.h>
 
 /* Private typedef -----------------------------------------------------------*/
-typedef struct
-{
-  float32_t K;					// PID gain parameter
-  float32_t Ti;					// PID integration time parameter
-  float32_t Td;					// PID derivative time parameter
-  float32_t Tt;					// Anti-windup tracking parameter
-  float32_t Beta;				// Set-point weighting 0-1
-  float32_t Gamma;				// Derivative set-point weighting 0-1
-  float32_t N;					// Derivative action filter constant
-  float32_t P;					// Proportional control part
-  float32_t I;					// Integration control part
-  float32_t D;					// Derivative control part
-  float32_t preState;			// Previous control state value
-  float32_t preRef;				// Previous reference signal value
-  float32_t upperSatLimit;		// Upper saturation limit of control signal
-  float32_t lowerSatLimit;		// Lower saturation limit of control signal
-  float32_t ctrlSignalScaling;	// Scaling of PID control signal
-  float32_t ctrlSignalOffset;	// Static offset of PID control signal
-  bool useIntegralAction;		// Sets if intergral action should be used or not
-}PIDController_TypeDef;
 
 /* Private define ------------------------------------------------------------*/
 #define PID_USE_PARALLELL_FORM  1
 
-#define CONTROL_PERIOD			((float32_t) FLIGHT_CONTROL_TASK_PERIOD/1000.0)
+#define CONTROL_PERIOD			LOOP_PERIOD_S
 
 /* Private macro -------------------------------------------------------------*/
 
@@ -198,6 +178,31 @@ void ResetCtrlSignals(CtrlSignals_TypeDef* ctrlSignals) {
     ctrlSignals->yawMoment = 0.0;
 }
 
+/*
+ * @brief  Saves the state of all PID controllers. Must be called with the scheduler suspended together with the
+ *         matching RestorePIDControlContext(), so that no controller update in between is lost.
+ * @param  context : Destination of the controller state
+ * @retval None.
+ */
+void SavePIDControlContext(PIDControlContext_TypeDef* context) {
+    context->altCtrl = AltCtrl;
+    context->rollCtrl = RollCtrl;
+    context->pitchCtrl = PitchCtrl;
+    context->yawCtrl = YawCtrl;
+}
+
+/*
+ * @brief  Restores a PID controller state saved with SavePIDControlContext()
+ * @param  context : The saved controller state
+ * @retval None.
+ */
+void RestorePIDControlContext(const PIDControlContext_TypeDef* context) {
+    AltCtrl = context->altCtrl;
+    RollCtrl = context->rollCtrl;
+    PitchCtrl = context->pitchCtrl;
+    YawCtrl = context->yawCtrl;
+}
+
 /* Private functions ---------------------------------------------------------*/
 
 /*
@@ -15,6 +15,26 @@
  *          ~1 ms when the transmitter control stick is held in one direction and
  *          ~2 ms when it is held in the opposite direction.
  *
+ *          _PULSE CAPTURE_
+ *          By default, the channels capture both pulse edges in hardware and
+ *          the capture ISR, in the latch tier of irq_priorities.h, only stores
+ *          the edge timestamps. On each counter update it pends the receiver
+ *          deferred interrupt, which decodes the buffered edges of all channels
+ *          in one batch at IRQ_PRIO_RECEIVER_DEFERRED, see receiver_capture.c.
+ *          Defining RECEIVER_LEGACY_CAPTURE selects the previous capture, which
+ *          toggles the capture polarity in software on every edge.
+ *
+ *          Both captures take one interrupt per edge plus one per counter
+ *          update: 6 channels x 2 edges / 22 ms + 2 timers / 3.64 ms, about
+ *          1100 interrupts per second. PWM input (slave reset) mode only pairs
+ *          CH1/CH2 and resets the shared counter, and DMA edge timestamps are
+ *          only possible for TIM2_CH1 and TIM2_CH3: TIM2_CH2/CH4 share DMA1
+ *          channel 7 with TIM3_CH1 on channel 6, both used by the UART, and
+ *          TIM3_CH2 has no DMA request. What the default capture saves is the
+ *          HAL dispatch and capture reconfiguration on every edge, and the
+ *          decoding in the latch tier. The receiver interrupt rate and lost
+ *          edges are shown by the irq-latency CLI command.
+ *
  *          _PERFORMING A CALIBRATION_
  *          To perform a calibration of the receiver channels, the function
  *          StartReceiverCalibration() must be called. The receiver channels
@@ -55,9 +75,13 @@
 
 /* Includes ------------------------------------------------------------------*/
 #include "receiver.h"
+#include "receiver_capture.h"
 
+#include "irq_latch.h"
 #include "flash.h"
 #include "common.h"
+#include "build_profile.h"
+#include "slack_monitor.h"
 #include "fcb_error.h"
 #include "dragonfly_fcb.pb.h"
 #include "pb_encode.h"
@@ -116,6 +140,20 @@ typedef struct {
     bool minBufferUpdated;
 } Receiver_ChannelCalibrationSampling_TypeDef;
 
+#if !defined(RECEIVER_LEGACY_CAPTURE)
+typedef struct {
+    ReceiverEdgeBuffer_TypeDef Edges;
+    ReceiverEdgeDecoder_TypeDef Decoder;
+    volatile uint32_t* CaptureRegister;
+    uint32_t CaptureFlag;
+    uint32_t OvercaptureFlag;
+    GPIO_TypeDef* InputPort;
+    uint16_t InputPin;
+    volatile Receiver_IC_Values_TypeDef* ICValues;
+    volatile Receiver_ChannelCalibrationSampling_TypeDef* CalibrationSampling;
+} Receiver_CaptureChannel_TypeDef;
+#endif
+
 /* Private define ------------------------------------------------------------*/
 #define RECEIVER_PRINT_SAMPLING_TASK_PRIO				1
 #define RECEIVER_PRINT_MINIMUM_SAMPLING_TIME			22	// Since the receiver pulses have this update frequency
@@ -123,6 +161,12 @@ typedef struct {
 #define RECEIVER_SWITCH_ON_MIN_VAL						INT16_MAX*8/10
 #define RECEIVER_SWITCH_OFF_MAX_VAL						INT16_MIN*8/10
 
+#if defined(RECEIVER_LEGACY_CAPTURE)
+#define RECEIVER_IC_POLARITY                            TIM_ICPOLARITY_RISING
+#else
+#define RECEIVER_IC_POLARITY                            TIM_ICPOLARITY_BOTHEDGE
+#endif
+
 /* Private macro -------------------------------------------------------------*/
 #define IS_RECEIVER_PULSE_VALID(PULSE_TIM_CNT, CURR_PERIOD_CNT, PRE_PERIOD_CNT)	(((PULSE_TIM_CNT) <= RECEIVER_MAX_VALID_IC_PULSE_COUNT) \
         && ((PULSE_TIM_CNT) >= RECEIVER_MIN_VALID_IC_PULSE_COUNT) && ((CURR_PERIOD_CNT) - (PRE_PERIOD_CNT) <= 1))
@@ -149,8 +193,10 @@ static TIM_IC_InitTypeDef RudderChannelICConfig;
 static TIM_IC_InitTypeDef GearChannelICConfig;
 static TIM_IC_InitTypeDef Aux1ChannelICConfig;
 
+#if defined(RECEIVER_LEGACY_CAPTURE)
 /* Struct contaning HIGH/LOW state for each input channel pulse */
 static Receiver_Pulse_States_TypeDef ReceiverPulseStates;
+#endif
 
 /* Structs for each channel's timer count values */
 static volatile Receiver_IC_Values_TypeDef ThrottleICValues;
@@ -178,11 +224,45 @@ static volatile Receiver_ChannelCalibrationSampling_TypeDef Aux1CalibrationSampl
 static volatile uint16_t PrimaryReceiverTimerPeriodCount;
 static volatile uint16_t AuxReceiverTimerPeriodCount;
 
+/* Receiver timer interrupt count, and the capture statistics at the last statistics reset */
+static volatile uint32_t receiverInterruptCount;
+static Receiver_CaptureStats_TypeDef captureStatsBase;
+
+#if !defined(RECEIVER_LEGACY_CAPTURE)
+/* Edge capture of each channel, in timer channel order. The input pin must be the pin routed to the channel's
+ * capture, as its level at the capture gives the edge polarity (see the pin map in receiver.h). */
+static Receiver_CaptureChannel_TypeDef PrimaryCaptureChannels[] = {
+    { .CaptureRegister = &PRIMARY_RECEIVER_TIM->CCR1, .CaptureFlag = TIM_SR_CC1IF, .OvercaptureFlag = TIM_SR_CC1OF,
+      .InputPort = PRIMARY_RECEIVER_TIM_PIN_PORT, .InputPin = PRIMARY_RECEIVER_PIN_CHANNEL1,
+      .ICValues = &ThrottleICValues, .CalibrationSampling = &ThrottleCalibrationSampling },
+    { .CaptureRegister = &PRIMARY_RECEIVER_TIM->CCR2, .CaptureFlag = TIM_SR_CC2IF, .OvercaptureFlag = TIM_SR_CC2OF,
+      .InputPort = PRIMARY_RECEIVER_TIM_PIN_PORT, .InputPin = PRIMARY_RECEIVER_PIN_CHANNEL2,
+      .ICValues = &AileronICValues, .CalibrationSampling = &AileronCalibrationSampling },
+    { .CaptureRegister = &PRIMARY_RECEIVER_TIM->CCR3, .CaptureFlag = TIM_SR_CC3IF, .OvercaptureFlag = TIM_SR_CC3OF,
+      .InputPort = PRIMARY_RECEIVER_TIM_PIN_PORT, .InputPin = PRIMARY_RECEIVER_PIN_CHANNEL3,
+      .ICValues = &ElevatorICValues, .CalibrationSampling = &ElevatorCalibrationSampling },
+    { .CaptureRegister = &PRIMARY_RECEIVER_TIM->CCR4, .CaptureFlag = TIM_SR_CC4IF, .OvercaptureFlag = TIM_SR_CC4OF,
+      .InputPort = PRIMARY_RECEIVER_TIM_PIN_PORT, .InputPin = PRIMARY_RECEIVER_PIN_CHANNEL4,
+      .ICValues = &RudderICValues, .CalibrationSampling = &RudderCalibrationSampling }
+};
+
+static Receiver_CaptureChannel_TypeDef AuxCaptureChannels[] = {
+    { .CaptureRegister = &AUX_RECEIVER_TIM->CCR1, .CaptureFlag = TIM_SR_CC1IF, .OvercaptureFlag = TIM_SR_CC1OF,
+      .InputPort = AUX_RECEIVER_TIM_PIN_PORT, .InputPin = AUX_RECEIVER_PIN_CHANNEL1,
+      .ICValues = &GearICValues, .CalibrationSampling = &GearCalibrationSampling },
+    { .CaptureRegister = &AUX_RECEIVER_TIM->CCR2, .CaptureFlag = TIM_SR_CC2IF, .OvercaptureFlag = TIM_SR_CC2OF,
+      .InputPort = AUX_RECEIVER_TIM_PIN_PORT, .InputPin = AUX_RECEIVER_PIN_CHANNEL2,
+      .ICValues = &Aux1ICValues, .CalibrationSampling = &Aux1CalibrationSampling }
+};
+#endif
+
 /* Task handle for printing of receiver values task */
 xTaskHandle ReceiverPrintSamplingTaskHandle = NULL;
 
+#if FCB_USE_PRINT_TASKS
 static volatile uint16_t receiverPrintSampleTime;
 static volatile uint16_t receiverPrintSampleDuration;
+#endif
 
 /* Private function prototypes -----------------------------------------------*/
 static ReceiverErrorStatus InitReceiverCalibrationValues(void);
@@ -192,10 +272,20 @@ static void SetDefaultReceiverCalibrationValues(volatile Receiver_CalibrationVal
 static ReceiverErrorStatus PrimaryReceiverInputConfig(void);
 static ReceiverErrorStatus AuxReceiverInput_Config(void);
 
+#if defined(RECEIVER_LEGACY_CAPTURE)
 static ReceiverErrorStatus UpdateReceiverChannel(TIM_HandleTypeDef* TimHandle, TIM_IC_InitTypeDef* TimIC,
         Pulse_State* channelInputState, volatile Receiver_IC_Values_TypeDef* ChannelICValues,
         const uint32_t receiverChannel, volatile const uint16_t ReceiverTimerPeriodCount,
         volatile Receiver_ChannelCalibrationSampling_TypeDef* ChannelCalibrationSampling);
+#else
+static void CaptureReceiverEdges(TIM_TypeDef* tim, Receiver_CaptureChannel_TypeDef* channels,
+        const uint8_t channelCount, volatile uint16_t* ReceiverTimerPeriodCount);
+static void DecodeReceiverChannel(Receiver_CaptureChannel_TypeDef* channel);
+#endif
+static void GetCaptureStatsTotal(Receiver_CaptureStats_TypeDef* stats);
+static void SetChannelPulse(volatile Receiver_IC_Values_TypeDef* ChannelICValues,
+        volatile Receiver_ChannelCalibrationSampling_TypeDef* ChannelCalibrationSampling,
+        const uint16_t pulseTimerCount);
 static ReceiverErrorStatus UpdateChannelCalibrationSamples(
         volatile Receiver_ChannelCalibrationSampling_TypeDef* channelCalibrationSampling,
         const uint16_t channelPulseTimerCount);
@@ -210,9 +300,13 @@ static ReceiverErrorStatus IsCalibrationValuesValid(
 
 static void EnforceNewCalibrationValues(volatile Receiver_CalibrationValues_TypeDef* newCalibrationValues);
 static void ResetCalibrationSampling(volatile Receiver_ChannelCalibrationSampling_TypeDef* channelCalibrationSampling);
+#if defined(RECEIVER_LEGACY_CAPTURE)
 static void ReceiverToggleICPolarity(TIM_HandleTypeDef* htim, TIM_IC_InitTypeDef* sConfig, uint32_t Channel);
+#endif
 
+#if FCB_USE_PRINT_TASKS
 static void ReceiverPrintSamplingTask(void const *argument);
+#endif
 
 /* Exported functions --------------------------------------------------------*/
 
@@ -222,6 +316,23 @@ static void ReceiverPrintSamplingTask(void const *argument);
  * @retval None
  */
 ReceiverErrorStatus ReceiverInputConfig(void) {
+#if !defined(RECEIVER_LEGACY_CAPTURE)
+    uint8_t i;
+
+    for (i = 0; i < sizeof(PrimaryCaptureChannels) / sizeof(PrimaryCaptureChannels[0]); i++) {
+        ResetReceiverEdgeBuffer(&PrimaryCaptureChannels[i].Edges);
+        ResetReceiverEdgeDecoder(&PrimaryCaptureChannels[i].Decoder);
+    }
+    for (i = 0; i < sizeof(AuxCaptureChannels) / sizeof(AuxCaptureChannels[0]); i++) {
+        ResetReceiverEdgeBuffer(&AuxCaptureChannels[i].Edges);
+        ResetReceiverEdgeDecoder(&AuxCaptureChannels[i].Decoder);
+    }
+
+    HAL_NVIC_SetPriority(RECEIVER_DEFERRED_IRQn, IRQ_PRIO_RECEIVER_DEFERRED, IRQ_SUB_PRIO);
+    HAL_NVIC_EnableIRQ(RECEIVER_DEFERRED_IRQn);
+#endif
+    ResetReceiverCaptureStats();
+
     InitReceiverCalibrationValues();
 
     if (!PrimaryReceiverInputConfig())
@@ -240,6 +351,7 @@ ReceiverErrorStatus ReceiverInputConfig(void) {
  * @retval RECEIVER_OK if thread started, else RECEIVER_ERROR
  */
 ReceiverErrorStatus StartReceiverSamplingTask(const uint16_t sampleTime, const uint32_t sampleDuration) {
+#if FCB_USE_PRINT_TASKS
     if(sampleTime < RECEIVER_PRINT_MINIMUM_SAMPLING_TIME)
         receiverPrintSampleTime = RECEIVER_PRINT_MINIMUM_SAMPLING_TIME;
     else
@@ -263,6 +375,11 @@ ReceiverErrorStatus StartReceiverSamplingTask(const uint16_t sampleTime, const u
     }
 
     return RECEIVER_OK;
+#else
+    (void) sampleTime;
+    (void) sampleDuration;
+    return RECEIVER_ERROR;
+#endif
 }
 
 /*
@@ -673,6 +790,24 @@ void ResetReceiverCalibrationValues(void)
     EnforceNewCalibrationValues(&tmpCalibrationValues);
 }
 
+/*
+ * @brief  Checks that receiver calibration values, e.g. from an imported settings snapshot, are within valid ranges
+ * @param  calibrationValues : pointer to a calibration values struct
+ * @retval RECEIVER_OK if the values are valid, else RECEIVER_ERROR
+ */
+ReceiverErrorStatus CheckReceiverCalibrationValues(const Receiver_CalibrationValues_TypeDef* calibrationValues) {
+    return IsCalibrationValuesValid(calibrationValues);
+}
+
+/*
+ * @brief  Starts using new receiver calibration values, including the mid counts. The caller stores them in flash.
+ * @param  calibrationValues : pointer to a calibration values struct with valid values
+ * @retval None.
+ */
+void SetReceiverCalibrationValues(const Receiver_CalibrationValues_TypeDef* calibrationValues) {
+    CalibrationValues = *calibrationValues;
+}
+
 /*
  * @brief  Checks if the RC transmission between transmitter and receiver is active.
  * @param  None.
@@ -855,6 +990,7 @@ uint16_t GetAux1ReceiverCalibrationMinValue(void) {
     return CalibrationValues.Aux1Channel.ChannelMinCount;
 }
 
+#if defined(RECEIVER_LEGACY_CAPTURE)
 /*
  * @brief  Handles the receiver input pulse measurements from the throttle channel and updates pulse and frequency values.
  * @param  None.
@@ -918,6 +1054,77 @@ ReceiverErrorStatus UpdateReceiverAux1Channel(void) {
     return UpdateReceiverChannel(&AuxReceiverTimHandle, &Aux1ChannelICConfig, &ReceiverPulseStates.Aux1InputState,
             &Aux1ICValues, AUX_RECEIVER_AUX1_CHANNEL, AuxReceiverTimerPeriodCount, &Aux1CalibrationSampling);
 }
+#else
+/*
+ * @brief  Decodes the buffered edges of all receiver channels. Handler of the receiver deferred interrupt, which the
+ *         capture ISRs pend once every counter period.
+ * @param  None.
+ * @retval None.
+ */
+void HandleReceiverDeferredIRQ(void) {
+    uint8_t i;
+
+    for (i = 0; i < sizeof(PrimaryCaptureChannels) / sizeof(PrimaryCaptureChannels[0]); i++)
+        DecodeReceiverChannel(&PrimaryCaptureChannels[i]);
+    for (i = 0; i < sizeof(AuxCaptureChannels) / sizeof(AuxCaptureChannels[0]); i++)
+        DecodeReceiverChannel(&AuxCaptureChannels[i]);
+}
+#endif
+
+/*
+ * @brief  Handles the primary receiver timer interrupt. Stores the captured edges and pends their decoding once
+ *         every counter period.
+ * @param  None.
+ * @retval None.
+ */
+void HandlePrimaryReceiverIRQ(void) {
+    receiverInterruptCount++;
+#if defined(RECEIVER_LEGACY_CAPTURE)
+    HAL_TIM_IRQHandler(&PrimaryReceiverTimHandle);
+#else
+    CaptureReceiverEdges(PRIMARY_RECEIVER_TIM, PrimaryCaptureChannels,
+            sizeof(PrimaryCaptureChannels) / sizeof(PrimaryCaptureChannels[0]), &PrimaryReceiverTimerPeriodCount);
+#endif
+}
+
+/*
+ * @brief  Handles the auxiliary receiver timer interrupt. Stores the captured edges and pends their decoding once
+ *         every counter period.
+ * @param  None.
+ * @retval None.
+ */
+void HandleAuxReceiverIRQ(void) {
+    receiverInterruptCount++;
+#if defined(RECEIVER_LEGACY_CAPTURE)
+    HAL_TIM_IRQHandler(&AuxReceiverTimHandle);
+#else
+    CaptureReceiverEdges(AUX_RECEIVER_TIM, AuxCaptureChannels,
+            sizeof(AuxCaptureChannels) / sizeof(AuxCaptureChannels[0]), &AuxReceiverTimerPeriodCount);
+#endif
+}
+
+/*
+ * @brief  Gets the receiver capture load since start or the last ResetReceiverCaptureStats()
+ * @param  stats : Destination of the statistics
+ * @retval None.
+ */
+void GetReceiverCaptureStats(Receiver_CaptureStats_TypeDef* stats) {
+    GetCaptureStatsTotal(stats);
+    stats->interrupts -= captureStatsBase.interrupts;
+    stats->elapsedMs -= captureStatsBase.elapsedMs;
+    stats->lostEdges -= captureStatsBase.lostEdges;
+    stats->droppedEdges -= captureStatsBase.droppedEdges;
+}
+
+/*
+ * @brief  Resets the receiver capture statistics. The counters are owned by the interrupt handlers, so only their
+ *         current values are recorded.
+ * @param  None.
+ * @retval None.
+ */
+void ResetReceiverCaptureStats(void) {
+    GetCaptureStatsTotal(&captureStatsBase);
+}
 
 /*
  * @brief  Increments the primary timer's period counter
@@ -1060,7 +1267,7 @@ static ReceiverErrorStatus PrimaryReceiverInputConfig(void) {
     /* Common configuration */
     ThrottleChannelICConfig.ICPrescaler = TIM_ICPSC_DIV1;
     ThrottleChannelICConfig.ICFilter = 0;
-    ThrottleChannelICConfig.ICPolarity = TIM_ICPOLARITY_RISING;
+    ThrottleChannelICConfig.ICPolarity = RECEIVER_IC_POLARITY;
     ThrottleChannelICConfig.ICSelection = TIM_ICSELECTION_DIRECTTI;
     /* Configure the Input Capture of throttle channel */
     if (HAL_TIM_IC_ConfigChannel(&PrimaryReceiverTimHandle, &ThrottleChannelICConfig, PRIMARY_RECEIVER_THROTTLE_CHANNEL)
@@ -1072,7 +1279,7 @@ static ReceiverErrorStatus PrimaryReceiverInputConfig(void) {
 
     AileronChannelICConfig.ICPrescaler = TIM_ICPSC_DIV1;
     AileronChannelICConfig.ICFilter = 0;
-    AileronChannelICConfig.ICPolarity = TIM_ICPOLARITY_RISING;
+    AileronChannelICConfig.ICPolarity = RECEIVER_IC_POLARITY;
     AileronChannelICConfig.ICSelection = TIM_ICSELECTION_DIRECTTI;
     /* Configure the Input Capture of aileron channel */
     if (HAL_TIM_IC_ConfigChannel(&PrimaryReceiverTimHandle, &AileronChannelICConfig, PRIMARY_RECEIVER_AILERON_CHANNEL)
@@ -1084,7 +1291,7 @@ static ReceiverErrorStatus PrimaryReceiverInputConfig(void) {
 
     ElevatorChannelICConfig.ICPrescaler = TIM_ICPSC_DIV1;
     ElevatorChannelICConfig.ICFilter = 0;
-    ElevatorChannelICConfig.ICPolarity = TIM_ICPOLARITY_RISING;
+    ElevatorChannelICConfig.ICPolarity = RECEIVER_IC_POLARITY;
     ElevatorChannelICConfig.ICSelection = TIM_ICSELECTION_DIRECTTI;
     /* Configure the Input Capture of elevator channel */
     if (HAL_TIM_IC_ConfigChannel(&PrimaryReceiverTimHandle, &ElevatorChannelICConfig, PRIMARY_RECEIVER_ELEVATOR_CHANNEL)
@@ -1096,7 +1303,7 @@ static ReceiverErrorStatus PrimaryReceiverInputConfig(void) {
 
     RudderChannelICConfig.ICPrescaler = TIM_ICPSC_DIV1;
     RudderChannelICConfig.ICFilter = 0;
-    RudderChannelICConfig.ICPolarity = TIM_ICPOLARITY_RISING;
+    RudderChannelICConfig.ICPolarity = RECEIVER_IC_POLARITY;
     RudderChannelICConfig.ICSelection = TIM_ICSELECTION_DIRECTTI;
     /* Configure the Input Capture of rudder channel */
     if (HAL_TIM_IC_ConfigChannel(&PrimaryReceiverTimHandle, &RudderChannelICConfig, PRIMARY_RECEIVER_RUDDER_CHANNEL)
@@ -1174,7 +1381,7 @@ static ReceiverErrorStatus AuxReceiverInput_Config(void) {
     /* Common configuration */
     GearChannelICConfig.ICPrescaler = TIM_ICPSC_DIV1;
     GearChannelICConfig.ICFilter = 0;
-    GearChannelICConfig.ICPolarity = TIM_ICPOLARITY_RISING;
+    GearChannelICConfig.ICPolarity = RECEIVER_IC_POLARITY;
     GearChannelICConfig.ICSelection = TIM_ICSELECTION_DIRECTTI;
     /* Configure the Input Capture of gear channel */
     if (HAL_TIM_IC_ConfigChannel(&AuxReceiverTimHandle, &GearChannelICConfig, AUX_RECEIVER_GEAR_CHANNEL) != HAL_OK) {
@@ -1185,7 +1392,7 @@ static ReceiverErrorStatus AuxReceiverInput_Config(void) {
 
     Aux1ChannelICConfig.ICPrescaler = TIM_ICPSC_DIV1;
     Aux1ChannelICConfig.ICFilter = 0;
-    Aux1ChannelICConfig.ICPolarity = TIM_ICPOLARITY_RISING;
+    Aux1ChannelICConfig.ICPolarity = RECEIVER_IC_POLARITY;
     Aux1ChannelICConfig.ICSelection = TIM_ICSELECTION_DIRECTTI;
     /* Configure the Input Capture of aux1 channel */
     if (HAL_TIM_IC_ConfigChannel(&AuxReceiverTimHandle, &Aux1ChannelICConfig, AUX_RECEIVER_AUX1_CHANNEL) != HAL_OK) {
@@ -1217,6 +1424,7 @@ static ReceiverErrorStatus AuxReceiverInput_Config(void) {
     return errorStatus;
 }
 
+#if defined(RECEIVER_LEGACY_CAPTURE)
 /*
  * @brief  Updates a receiver channel IC counts. The channel is specified by the function parameters.
  * @param  TimHandle : Reference to the TIM_HandleTypeDef struct used to read the channel's IC count
@@ -1284,17 +1492,7 @@ static ReceiverErrorStatus UpdateReceiverChannel(TIM_HandleTypeDef* TimHandle, T
         /* Sanity check of pulse count before updating it */
         if (IS_RECEIVER_PULSE_VALID(tempPulseTimerCount, ReceiverTimerPeriodCount,
                 ChannelICValues->PreviousRisingCountTimerPeriodCount)) {
-            ChannelICValues->PulseTimerCount = tempPulseTimerCount;
-            ChannelICValues->IsActive = RECEIVER_OK; // Set channel to active
-
-            /* Check if calibration is being performed */
-            if (receiverCalibrationState == RECEIVER_CALIBRATION_IN_PROGRESS) {
-                /* Check if max calibration time has been reached (time out) */
-                if (HAL_GetTick() > RECEIVER_MAX_CALIBRATION_DURATION + receiverCalibrationStartTime)
-                    receiverCalibrationState = RECEIVER_CALIBRATION_WAITING;
-                else
-                    UpdateChannelCalibrationSamples(ChannelCalibrationSampling, tempPulseTimerCount);
-            }
+            SetChannelPulse(ChannelICValues, ChannelCalibrationSampling, tempPulseTimerCount);
         } else
             errorStatus = RECEIVER_ERROR;
     }
@@ -1304,6 +1502,123 @@ static ReceiverErrorStatus UpdateReceiverChannel(TIM_HandleTypeDef* TimHandle, T
 
     return errorStatus;
 }
+#else
+/*
+ * @brief  Stores the captured edges of a receiver timer's channels in their edge buffers. On the timer update, the
+ *         period count is incremented and the decoding of the buffered edges is pended. Runs in the latch tier, so
+ *         the decoding and all RTOS calls are left to HandleReceiverDeferredIRQ().
+ * @param  tim : Receiver timer
+ * @param  channels : The timer's capture channels
+ * @param  channelCount : Number of capture channels
+ * @param  ReceiverTimerPeriodCount : Reference to the timer period count variable (primary or aux)
+ * @retval None.
+ */
+static void CaptureReceiverEdges(TIM_TypeDef* tim, Receiver_CaptureChannel_TypeDef* channels,
+        const uint8_t channelCount, volatile uint16_t* ReceiverTimerPeriodCount) {
+    const uint32_t status = tim->SR;
+    const bool updatePending = (status & TIM_SR_UIF) != 0;
+    uint8_t i;
+
+    for (i = 0; i < channelCount; i++) {
+        Receiver_CaptureChannel_TypeDef* channel = &channels[i];
+
+        if (status & channel->CaptureFlag) {
+            /* Reading the capture clears the capture flag. The input level tells the edge polarity. */
+            const uint16_t capture = (uint16_t) *channel->CaptureRegister;
+            uint8_t flags = (channel->InputPort->IDR & channel->InputPin) ? RECEIVER_EDGE_RISING : 0;
+
+            if (status & channel->OvercaptureFlag) {
+                tim->SR = ~channel->OvercaptureFlag;
+                flags |= RECEIVER_EDGE_OVERCAPTURE;
+            }
+
+            PushReceiverEdge(&channel->Edges,
+                    GetReceiverEdgeTimestamp(*ReceiverTimerPeriodCount, capture, updatePending), flags);
+        }
+    }
+
+    if (updatePending) {
+        tim->SR = ~TIM_SR_UIF;
+        (*ReceiverTimerPeriodCount)++;
+        NVIC_SetPendingIRQ(RECEIVER_DEFERRED_IRQn);
+    }
+}
+
+/*
+ * @brief  Decodes the buffered edges of a receiver channel and updates its pulse and period values
+ * @param  channel : Capture channel
+ * @retval None.
+ */
+static void DecodeReceiverChannel(Receiver_CaptureChannel_TypeDef* channel) {
+    ReceiverPulse_TypeDef pulse;
+    uint32_t timestamp;
+    uint8_t flags;
+
+    while (PopReceiverEdge(&channel->Edges, &timestamp, &flags)) {
+        if (!DecodeReceiverEdge(&channel->Decoder, timestamp, flags, &pulse))
+            continue;
+
+        channel->ICValues->RisingCount = (uint16_t) pulse.risingTimestamp;
+        channel->ICValues->FallingCounter = (uint16_t) (pulse.risingTimestamp + pulse.width);
+        channel->ICValues->PreviousRisingCountTimerPeriodCount = (uint16_t) (pulse.risingTimestamp
+                / RECEIVER_EDGE_COUNTER_TICKS);
+        if (IsReceiverPulsePeriodValid(&pulse))
+            channel->ICValues->PeriodCount = pulse.period;
+
+        SetChannelPulse(channel->ICValues, channel->CalibrationSampling, pulse.width);
+    }
+}
+#endif
+
+/*
+ * @brief  Gets the receiver capture counters since start
+ * @param  stats : Destination of the counters
+ * @retval None.
+ */
+static void GetCaptureStatsTotal(Receiver_CaptureStats_TypeDef* stats) {
+#if !defined(RECEIVER_LEGACY_CAPTURE)
+    uint8_t i;
+#endif
+
+    stats->interrupts = receiverInterruptCount;
+    stats->elapsedMs = HAL_GetTick();
+    stats->lostEdges = 0;
+    stats->droppedEdges = 0;
+
+#if !defined(RECEIVER_LEGACY_CAPTURE)
+    for (i = 0; i < sizeof(PrimaryCaptureChannels) / sizeof(PrimaryCaptureChannels[0]); i++) {
+        stats->lostEdges += PrimaryCaptureChannels[i].Decoder.lostEdges;
+        stats->droppedEdges += PrimaryCaptureChannels[i].Edges.droppedEdges;
+    }
+    for (i = 0; i < sizeof(AuxCaptureChannels) / sizeof(AuxCaptureChannels[0]); i++) {
+        stats->lostEdges += AuxCaptureChannels[i].Decoder.lostEdges;
+        stats->droppedEdges += AuxCaptureChannels[i].Edges.droppedEdges;
+    }
+#endif
+}
+
+/*
+ * @brief  Sets a valid pulse of a receiver channel, marks the channel active and samples it if calibrating
+ * @param  ChannelICValues : Reference to the channels IC value struct
+ * @param  ChannelCalibrationSampling : Reference to channel's calibration sampling struct
+ * @param  pulseTimerCount : Pulse width [ticks]
+ * @retval None.
+ */
+static void SetChannelPulse(volatile Receiver_IC_Values_TypeDef* ChannelICValues,
+        volatile Receiver_ChannelCalibrationSampling_TypeDef* ChannelCalibrationSampling,
+        const uint16_t pulseTimerCount) {
+    ChannelICValues->PulseTimerCount = pulseTimerCount;
+    ChannelICValues->IsActive = RECEIVER_OK; // Set channel to active
+
+    /* Check if calibration is being performed */
+    if (receiverCalibrationState == RECEIVER_CALIBRATION_IN_PROGRESS) {
+        /* Check if max calibration time has been reached (time out) */
+        if (HAL_GetTick() > RECEIVER_MAX_CALIBRATION_DURATION + receiverCalibrationStartTime)
+            receiverCalibrationState = RECEIVER_CALIBRATION_WAITING;
+        else
+            UpdateChannelCalibrationSamples(ChannelCalibrationSampling, pulseTimerCount);
+    }
+}
 
 /*
  * @brief  Updates the receiver channel's calibration samples
@@ -1491,6 +1806,7 @@ static void ResetCalibrationSampling(volatile Receiver_ChannelCalibrationSamplin
     channelCalibrationSampling->midSamplesPulseSum = 0;
 }
 
+#if defined(RECEIVER_LEGACY_CAPTURE)
 /**
  * @brief  Toggles the IC polarity
  * @param  htim : timer handle reference
@@ -1570,7 +1886,9 @@ static void ReceiverToggleICPolarity(TIM_HandleTypeDef* htim, TIM_IC_InitTypeDef
     /* Enable the Input Capture channel */
     TIM_CCxChannelCmd(htim->Instance, Channel, TIM_CCx_ENABLE);
 }
+#endif
 
+#if FCB_USE_PRINT_TASKS
 /**
  * @brief  Task code handles receiver print sampling
  * @param  argument : Unused parameter
@@ -1581,6 +1899,7 @@ static void ReceiverPrintSamplingTask(void const *argument) {
 
     portTickType xLastWakeTime;
     portTickType xSampleStartTime;
+    uint32_t printCount = 0;
 
     /* Initialise the xLastWakeTime variable with the current time */
     xLastWakeTime = xTaskGetTickCount();
@@ -1599,13 +1918,15 @@ static void ReceiverPrintSamplingTask(void const *argument) {
             receiverCalibrationStartSaturatingMessageSent = true;
         }
 
-        PrintReceiverValues();
+        if (IsSlackWorkDue(SLACK_WORK_PRINT, printCount++))
+            PrintReceiverValues();
 
         /* If sampling duration exceeded, delete task to stop sampling */
         if (xTaskGetTickCount() >= xSampleStartTime + receiverPrintSampleDuration * configTICK_RATE_HZ)
             StopReceiverSamplingTask();
     }
 }
+#endif
 
 /**
  * @}
@@ -0,0 +1,209 @@
+/******************************************************************************
+ * @brief   File contains the receiver edge timestamp buffering and the batch
+ *          decoding of edge timestamps into receiver pulses.
+ *
+ *          The receiver input capture channels capture both edges, so the
+ *          timestamp of every edge is latched by the timer hardware and no
+ *          polarity reconfiguration is needed between edges. The capture ISR
+ *          only extends the 16-bit capture to a 32-bit timestamp with the
+ *          timer period count and stores it together with the input level in
+ *          the channel's edge buffer. A captured width is therefore correct as
+ *          long as the ISR runs before the next edge on the same channel, and
+ *          if it does not, the timer sets the overcapture flag so that the lost
+ *          edge is detected instead of producing a wrong width.
+ *
+ *          The buffered edges are decoded in batches once every receiver
+ *          counter period, where each falling edge that completes a pulse of
+ *          valid width yields a pulse with its width and period.
+ *
+ *          The buffer and decoder functions do not access any hardware so
+ *          that the edge decoding can be run in a host model.
+ *
+ * @license
+ * Dragonfly FCB firmware to control the Dragonfly quadrotor UAV
+ * Copyright (C) 2016  ÅF Technology South: Dragonfly Project
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA
+ *****************************************************************************/
+
+/* Includes ------------------------------------------------------------------*/
+#include "receiver_capture.h"
+
+/* Private typedef -----------------------------------------------------------*/
+/* Private define ------------------------------------------------------------*/
+#define RECEIVER_EDGE_BUFFER_MASK           (RECEIVER_EDGE_BUFFER_SIZE - 1)
+
+_Static_assert((RECEIVER_EDGE_BUFFER_SIZE & RECEIVER_EDGE_BUFFER_MASK) == 0,
+        "Receiver edge buffer size must be a power of two");
+_Static_assert(RECEIVER_EDGE_COUNTER_TICKS == 0x10000UL, "Edge timestamps assume a 16-bit receiver counter");
+
+/* Private macro -------------------------------------------------------------*/
+#define IS_RECEIVER_EDGE_PULSE_VALID(WIDTH)     ((WIDTH) >= RECEIVER_MIN_VALID_IC_PULSE_COUNT \
+        && (WIDTH) <= RECEIVER_MAX_VALID_IC_PULSE_COUNT)
+
+/* Private variables ---------------------------------------------------------*/
+/* Private function prototypes -----------------------------------------------*/
+
+/* Exported functions --------------------------------------------------------*/
+
+/*
+ * @brief  Empties an edge buffer
+ * @param  buffer : Edge buffer
+ * @retval None
+ */
+void ResetReceiverEdgeBuffer(ReceiverEdgeBuffer_TypeDef* buffer) {
+    buffer->head = 0;
+    buffer->tail = 0;
+    buffer->droppedEdges = 0;
+}
+
+/*
+ * @brief  Stores an edge in an edge buffer. Called by the capture ISR, the edge is dropped if the buffer is full.
+ * @param  buffer : Edge buffer
+ * @param  timestamp : Edge timestamp from GetReceiverEdgeTimestamp() [ticks]
+ * @param  flags : Edge flags (RECEIVER_EDGE_RISING, RECEIVER_EDGE_OVERCAPTURE)
+ * @retval None
+ */
+void PushReceiverEdge(ReceiverEdgeBuffer_TypeDef* buffer, const uint32_t timestamp, const uint8_t flags) {
+    const uint8_t head = buffer->head;
+    const uint8_t next = (head + 1) & RECEIVER_EDGE_BUFFER_MASK;
+
+    if (next == buffer->tail) {
+        buffer->droppedEdges++;
+        return;
+    }
+
+    buffer->timestamp[head] = timestamp;
+    buffer->flags[head] = flags;
+    buffer->head = next;
+}
+
+/*
+ * @brief  Takes the oldest edge from an edge buffer
+ * @param  buffer : Edge buffer
+ * @param  timestamp : Destination of the edge timestamp [ticks]
+ * @param  flags : Destination of the edge flags
+ * @retval true if an edge was taken, false if the buffer was empty
+ */
+bool PopReceiverEdge(ReceiverEdgeBuffer_TypeDef* buffer, uint32_t* timestamp, uint8_t* flags) {
+    const uint8_t tail = buffer->tail;
+
+    if (tail == buffer->head)
+        return false;
+
+    *timestamp = buffer->timestamp[tail];
+    *flags = buffer->flags[tail];
+    buffer->tail = (tail + 1) & RECEIVER_EDGE_BUFFER_MASK;
+    return true;
+}
+
+/*
+ * @brief  Extends a 16-bit capture to a 32-bit edge timestamp. If the timer update is pending when the capture is
+ *         read, a capture in the lower half of the counter period was made after the update, i.e. in the period
+ *         not yet counted.
+ * @param  timerPeriodCount : Timer period count when the capture was read
+ * @param  capture : Captured counter value
+ * @param  updatePending : True if the timer update flag was set when the capture was read
+ * @retval Edge timestamp [ticks]
+ */
+uint32_t GetReceiverEdgeTimestamp(const uint16_t timerPeriodCount, const uint16_t capture,
+        const bool updatePending) {
+    uint32_t periodCount = timerPeriodCount;
+
+    if (updatePending && capture < RECEIVER_EDGE_COUNTER_TICKS / 2)
+        periodCount++;
+
+    return periodCount * RECEIVER_EDGE_COUNTER_TICKS + capture;
+}
+
+/*
+ * @brief  Resets an edge decoder, so that it waits for a rising edge
+ * @param  decoder : Edge decoder
+ * @retval None
+ */
+void ResetReceiverEdgeDecoder(ReceiverEdgeDecoder_TypeDef* decoder) {
+    decoder->risingTimestamp = 0;
+    decoder->previousRisingTimestamp = 0;
+    decoder->period = 0;
+    decoder->pulseHigh = false;
+    decoder->previousRisingValid = false;
+    decoder->lostEdges = 0;
+    decoder->invalidPulses = 0;
+}
+
+/*
+ * @brief  Decodes one edge. A falling edge ending a pulse of valid width yields a pulse. A lost edge, i.e. an
+ *         overcapture or two edges of the same level in a row, resynchronizes the decoder on the next rising edge
+ *         and invalidates the period across the lost edge.
+ * @param  decoder : Edge decoder
+ * @param  timestamp : Edge timestamp [ticks]
+ * @param  flags : Edge flags
+ * @param  pulse : Destination of the decoded pulse
+ * @retval true if a pulse was decoded, else false
+ */
+bool DecodeReceiverEdge(ReceiverEdgeDecoder_TypeDef* decoder, const uint32_t timestamp, const uint8_t flags,
+        ReceiverPulse_TypeDef* pulse) {
+    const bool rising = (flags & RECEIVER_EDGE_RISING) != 0;
+    uint32_t width;
+
+    if ((flags & RECEIVER_EDGE_OVERCAPTURE) || rising == decoder->pulseHigh) {
+        decoder->lostEdges++;
+        decoder->pulseHigh = false;
+        decoder->previousRisingValid = false;
+    }
+
+    if (rising) {
+        /* Unsigned difference is correct across timestamp wrap-around */
+        decoder->period = decoder->previousRisingValid ? timestamp - decoder->previousRisingTimestamp : 0;
+        decoder->previousRisingTimestamp = timestamp;
+        decoder->previousRisingValid = true;
+        decoder->risingTimestamp = timestamp;
+        decoder->pulseHigh = true;
+        return false;
+    }
+
+    if (!decoder->pulseHigh)
+        return false;   // Falling edge of a pulse whose rising edge was lost
+
+    decoder->pulseHigh = false;
+    width = timestamp - decoder->risingTimestamp;
+    if (!IS_RECEIVER_EDGE_PULSE_VALID(width)) {
+        decoder->invalidPulses++;
+        return false;
+    }
+
+    pulse->risingTimestamp = decoder->risingTimestamp;
+    pulse->period = decoder->period;
+    pulse->width = (uint16_t) width;
+    return true;
+}
+
+/*
+ * @brief  Checks if the period of a decoded pulse is known and within the valid receiver period range
+ * @param  pulse : Decoded pulse
+ * @retval true if the period is valid, else false
+ */
+bool IsReceiverPulsePeriodValid(const ReceiverPulse_TypeDef* pulse) {
+    return pulse->period >= RECEIVER_MIN_VALID_PERIOD_COUNT && pulse->period <= RECEIVER_MAX_VALID_PERIOD_COUNT;
+}
+
+/**
+ * @}
+ */
+
+/**
+ * @}
+ */
+/*****END OF FILE****/
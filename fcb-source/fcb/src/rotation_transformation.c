@@ -25,6 +25,8 @@
 
 /* Includes ------------------------------------------------------------------*/
 #include "rotation_transformation.h"
+#include "vector_math.h"
+#include "math_tables.h"
 
 #include <math.h>
 
@@ -33,13 +35,10 @@
 /* Private macro -------------------------------------------------------------*/
 
 /* Private variables ---------------------------------------------------------*/
-static arm_matrix_instance_f32 DCM; // From inertial/world frame to body frame
-static float32_t DCMf32[9];
-static arm_matrix_instance_f32 DCMInv; // From body frame to inertial/world frame
-//static float32_t DCMInvf32[9];
+static float32_t DCMf32[9]; // From inertial/world frame to body frame
+static float32_t DCMInvf32[9]; // From body frame to inertial/world frame
 
-static arm_matrix_instance_f32 angRateMatrix; // Used to transform angular rate from body to inertial/worl frame
-static float32_t angRateMatrixf32[9];
+static float32_t angRateMatrixf32[9]; // Used to transform angular rate from body to inertial/worl frame
 
 /* [Unit: Gauss] Set to the magnetic vector in Malmö, SE, year 2015 (Components in north, east, down convention)
  * Data used from http://www.ngdc.noaa.gov/geomag-web/
@@ -57,17 +56,7 @@ float32_t inertialMagneticVectorNormalized[3] = {0.340345, 0.0209924, 0.940066};
  * @retval None
  */
 void InitRotationMatrix(void) {
-    float32_t DCMInvInit[9] =
-    {
-            1.0,     0.0,     0.0,
-            0.0,     1.0,     0.0,
-            0.0,     0.0,     1.0,
-    };
-
-    /* Initialize the inverse DCM to the unit matrix (3x3) */
-    arm_mat_init_f32(&DCMInv, 3, 3, DCMInvInit);
-
-    /* Initializes the DCM to the unit matrix (3x3) */
+    /* Initializes the DCM and its inverse to the unit matrix (3x3) */
     UpdateRotationMatrix(0.0, 0.0, 0.0);
 }
 
@@ -77,18 +66,8 @@ void InitRotationMatrix(void) {
  * @retval None
  */
 void InitAngularRotationMatrix(void) {
-    angRateMatrixf32[0] = 1.0;
-    angRateMatrixf32[1] = 0.0;
-    angRateMatrixf32[2] = 0.0;
-    angRateMatrixf32[3] = 0.0;
-    angRateMatrixf32[4] = 1.0;
-    angRateMatrixf32[5] = 0.0;
-    angRateMatrixf32[6] = 0.0;
-    angRateMatrixf32[7] = 0.0;
-    angRateMatrixf32[8] = 1.0;
-
     /* Initialize the angular rate matrix to the unit matrix (3x3) */
-    arm_mat_init_f32(&angRateMatrix, 3, 3, angRateMatrixf32);
+    Mat3Identity(angRateMatrixf32);
 }
 
 /*
@@ -101,12 +80,9 @@ void InitAngularRotationMatrix(void) {
 void UpdateRotationMatrix(const float32_t roll, const float32_t pitch, const float32_t yaw) {
     float32_t sinRoll, cosRoll, sinPitch, cosPitch, sinYaw, cosYaw;
 
-    sinRoll = arm_sin_f32(roll);
-    cosRoll = arm_cos_f32(roll);
-    sinPitch = arm_sin_f32(pitch);
-    cosPitch = arm_cos_f32(pitch);
-    sinYaw = arm_sin_f32(yaw);
-    cosYaw = arm_cos_f32(yaw);
+    FastSinCos(roll, &sinRoll, &cosRoll);
+    FastSinCos(pitch, &sinPitch, &cosPitch);
+    FastSinCos(yaw, &sinYaw, &cosYaw);
 
     /* Calculate the DCM based on roll, pitch and yaw angles */
     DCMf32[0] = cosPitch*cosYaw;
@@ -119,12 +95,9 @@ void UpdateRotationMatrix(const float32_t roll, const float32_t pitch, const flo
     DCMf32[7] = -sinRoll*cosYaw+cosRoll*sinPitch*sinYaw;
     DCMf32[8] = cosRoll*cosPitch;
 
-    /* Init the DCM that transforms FROM the inertial frame TO the body frame */
-    arm_mat_init_f32(&DCM, 3, 3, angRateMatrixf32);
-
     /* Calculate the DCM inverse, which is the same as matrix transpose since DCM is an orthonormal matrix. The inverse
      * transforms FROM the body frame TO the inertial frame*/
-    arm_mat_trans_f32(&DCM, &DCMInv);
+    Mat3Transpose(DCMInvf32, DCMf32);
 }
 
 /*
@@ -137,10 +110,8 @@ void UpdateRotationMatrix(const float32_t roll, const float32_t pitch, const flo
 TransformationErrorStatus UpdateAngularRotationMatrix(const float32_t roll, const float32_t pitch) {
     float32_t sinRoll, cosRoll, sinPitch, cosPitch, tanPitch, secPitch;
 
-    sinRoll = arm_sin_f32(roll);
-    cosRoll = arm_cos_f32(roll);
-    sinPitch = arm_sin_f32(pitch);
-    cosPitch = arm_cos_f32(pitch);
+    FastSinCos(roll, &sinRoll, &cosRoll);
+    FastSinCos(pitch, &sinPitch, &cosPitch);
 
     /* Check so that transformation matrix is not too close to becoming singular */
     if (fabsf(cosPitch) < 0.1) {
@@ -148,7 +119,7 @@ TransformationErrorStatus UpdateAngularRotationMatrix(const float32_t roll, cons
     }
 
     tanPitch = sinPitch/cosPitch;
-    secPitch = 1.0/cosPitch;
+    secPitch = 1.0f/cosPitch;
 
     /* Calculate the angular rate transformation matrix based on roll and pitch angles*/
     angRateMatrixf32[0] = 1.0;
@@ -161,9 +132,6 @@ TransformationErrorStatus UpdateAngularRotationMatrix(const float32_t roll, cons
     angRateMatrixf32[7] = sinRoll*secPitch;
     angRateMatrixf32[8] = cosRoll*secPitch;
 
-    /* Init the DCM that transforms FROM the inertial frame TO the body frame */
-    arm_mat_init_f32(&angRateMatrix, 3, 3, angRateMatrixf32);
-
     return TRANSF_OK;
 }
 
@@ -198,32 +166,26 @@ void GetAttitudeFromMagnetometer(float32_t* dstAttitude, float32_t* bodyMagnetic
      * readings. NOTE: Inertial magnetic field vector depends on where on earth UAV is operating - Malmö, SE assumed.
      * */
 
-    float32_t bodyMagneticVectorNormalized[3], rotationAxisVector[3], rotationAxisVectorNormalized[3];
-    float32_t rotationAngle, dotProd, cosHalfAngle, sinHalfAngle, q0, q1, q2, q3;
+    float32_t bodyMagneticVectorNormalized[3], rotationAxisVector[3];
+    float32_t rotationAngle, q[4];
 
     /* Get unit length normalized versions of the vectors */
-    Vector3DNormalize(bodyMagneticVectorNormalized, bodyMagneticReadings);
+    Vec3Normalize(bodyMagneticVectorNormalized, bodyMagneticReadings);
 
     /* Get the rotation axis vector between the two magnetic vectors (inertial and body) */
-    Vector3DCrossProduct(rotationAxisVector, bodyMagneticVectorNormalized, inertialMagneticVectorNormalized);
-    Vector3DNormalize(rotationAxisVectorNormalized, rotationAxisVector);
+    Vec3Cross(rotationAxisVector, bodyMagneticVectorNormalized, inertialMagneticVectorNormalized);
+    Vec3Normalize(rotationAxisVector, rotationAxisVector);
 
     /* Get the angle for the body to the inertial frame vectors rotated around rotation vector axis */
-    arm_dot_prod_f32(bodyMagneticVectorNormalized, inertialMagneticVectorNormalized, 3, &dotProd);
-    rotationAngle = acosf(dotProd);
+    rotationAngle = acosf(Vec3Dot(bodyMagneticVectorNormalized, inertialMagneticVectorNormalized));
 
     /* Calculate the axis/angle quaternion representation (q = q0 + q1*i + q2*j + q3*k) */
-    cosHalfAngle = arm_cos_f32(rotationAngle*0.5);
-    sinHalfAngle = arm_sin_f32(rotationAngle*0.5);
-    q0 = cosHalfAngle;
-    q1 = rotationAxisVectorNormalized[0]*sinHalfAngle;
-    q2 = rotationAxisVectorNormalized[1]*sinHalfAngle;
-    q3 = rotationAxisVectorNormalized[2]*sinHalfAngle;
+    QuatFromAxisAngle(q, rotationAxisVector, rotationAngle);
 
     /* From the quaternion, the Euler angles (roll, pitch, yaw) are obtained */
-    dstAttitude[0] = atan2f(2.0*q0*q1 + 2.0*q2*q3, q0*q0 - q1*q1 - q2*q2 + q3*q3); // Roll-Phi
-    dstAttitude[1] = asinf(2.0*q0*q2 - 2.0*q1*q3); // Pitch-Theta
-    dstAttitude[2] = atan2f(2.0*q0*q3 + 2.0*q1*q2, q0*q0 + q1*q1 - q2*q2 - q3*q3); // Yaw-Psi
+    dstAttitude[0] = atan2f(2.0f*(q[0]*q[1] + q[2]*q[3]), q[0]*q[0] - q[1]*q[1] - q[2]*q[2] + q[3]*q[3]); // Roll-Phi
+    dstAttitude[1] = asinf(2.0f*(q[0]*q[2] - q[1]*q[3])); // Pitch-Theta
+    dstAttitude[2] = atan2f(2.0f*(q[0]*q[3] + q[1]*q[2]), q[0]*q[0] + q[1]*q[1] - q[2]*q[2] - q[3]*q[3]); // Yaw-Psi
 }
 
 /*
@@ -234,9 +196,7 @@ void GetAttitudeFromMagnetometer(float32_t* dstAttitude, float32_t* bodyMagnetic
  * @retval None
  */
 void Vector3DCrossProduct(float32_t* dstVector, const float32_t* srcVector1, const float32_t* srcVector2) {
-    dstVector[0] = srcVector1[1]*srcVector2[2] - srcVector1[2]*srcVector2[1];
-    dstVector[1] = srcVector1[2]*srcVector2[0] - srcVector1[0]*srcVector2[2];
-    dstVector[2] = srcVector1[0]*srcVector2[1] - srcVector1[1]*srcVector2[0];;
+    Vec3Cross(dstVector, srcVector1, srcVector2);
 }
 
 /*
@@ -246,14 +206,7 @@ void Vector3DCrossProduct(float32_t* dstVector, const float32_t* srcVector1, con
  * @retval None
  */
 void Vector3DNormalize(float32_t* dstVector, float32_t* srcVector) {
-    float32_t norm;
-
-    /* Calculate norm of source vector */
-    arm_dot_prod_f32(srcVector, srcVector, 3, &norm);
-    norm = sqrt(norm);
-
-    /* Normalize the vector to unit length and store it in destination vector */
-    arm_scale_f32(srcVector, 1.0/norm, dstVector, 3);
+    Vec3Normalize(dstVector, srcVector);
 }
 
 /*
@@ -263,14 +216,23 @@ void Vector3DNormalize(float32_t* dstVector, float32_t* srcVector) {
  * @retval None
  */
 void Vector3DTiltCompensate(float32_t* dstVector, float32_t* srcVector, float32_t roll, float32_t pitch) {
-    dstVector[0] = srcVector[0]*arm_cos_f32(pitch)
-                         + srcVector[2]*arm_sin_f32(pitch);
-    dstVector[1] = srcVector[0]*arm_sin_f32(roll)*arm_sin_f32(pitch)
-                         + srcVector[1]*arm_cos_f32(roll)
-                         - srcVector[2]*arm_sin_f32(roll)*arm_cos_f32(pitch);
-    dstVector[2] = -srcVector[0]*arm_cos_f32(roll)*arm_sin_f32(pitch)
-                         + srcVector[1]*arm_sin_f32(roll)
-                         + srcVector[2]*arm_cos_f32(roll)*arm_cos_f32(pitch);
+    float32_t sinRoll, cosRoll, sinPitch, cosPitch, tiltMatrix[9];
+
+    FastSinCos(roll, &sinRoll, &cosRoll);
+    FastSinCos(pitch, &sinPitch, &cosPitch);
+
+    tiltMatrix[0] = cosPitch;
+    tiltMatrix[1] = 0.0;
+    tiltMatrix[2] = sinPitch;
+    tiltMatrix[3] = sinRoll*sinPitch;
+    tiltMatrix[4] = cosRoll;
+    tiltMatrix[5] = -sinRoll*cosPitch;
+    tiltMatrix[6] = -cosRoll*sinPitch;
+    tiltMatrix[7] = sinRoll;
+    tiltMatrix[8] = cosRoll*cosPitch;
+
+    /* Source and destination may be the same vector */
+    Mat3MultVec3(dstVector, tiltMatrix, srcVector);
 }
 
 /*
@@ -306,25 +268,13 @@ float32_t GetMagYawAngle(float32_t* magValues, const float32_t roll, const float
 TransformationErrorStatus GetEulerAngularRates(float32_t* rateDst, const float32_t* bodyAngularRates, const float32_t roll, const float32_t pitch)
 {
     TransformationErrorStatus status = TRANSF_OK;
-    arm_status arm_math_status = ARM_MATH_SUCCESS;
-    arm_matrix_instance_f32 pqr;
-    arm_matrix_instance_f32 eulerRates;
 
     status = UpdateAngularRotationMatrix(roll, pitch);
     if (status != TRANSF_OK) {
         return status;
     }
 
-    arm_mat_init_f32(&pqr, 3, 1, (float32_t*) bodyAngularRates);
-    arm_mat_init_f32(&eulerRates, 3, 1, rateDst);
-    arm_math_status = arm_mat_mult_f32(&angRateMatrix, &pqr, &eulerRates);
-    if (arm_math_status != ARM_MATH_SUCCESS) {
-        return TRANSF_ERROR;
-    }
-
-    rateDst[0] = eulerRates.pData[0];
-    rateDst[1] = eulerRates.pData[1];
-    rateDst[2] = eulerRates.pData[2];
+    Mat3MultVec3(rateDst, angRateMatrixf32, bodyAngularRates);
 
     return status;
 }
@@ -0,0 +1,477 @@
+/******************************************************************************
+ * @brief   File contains the sensor injection mode for processor-in-the-loop
+ *          testing, where the firmware runs on the target against a host
+ *          plant model instead of the physical sensors.
+ *
+ *          Injection is started with the start-injection CLI command while
+ *          disarmed. From then on the USB or UART RX task hands all received
+ *          bytes to ParseSensorInjectionByte() instead of the CLI. Frames use
+ *          the common message header (msg id SENSOR_INJECTION_MSG_ENUM, CRC,
+ *          size) and "\r\n" trailer. A frame with empty payload stops the
+ *          injection, and so does the host not sending any frame for
+ *          SENSOR_INJECTION_HOST_TIMEOUT.
+ *
+ *          Accepted frames are queued to the SENSORS task, which publishes the
+ *          values through the same path as the driver reads (stored values and
+ *          estimator correction callbacks). The sensors keep raising DRDY and
+ *          are still read, so the DRDY timeouts stay valid, but the driver
+ *          values are not published while injecting.
+ *
+ *          The motor outputs are inhibited from start until the flight control
+ *          is back in idle after injection stopped, so the motors never spin
+ *          on simulated data and the estimator has converged on real data
+ *          before they can be armed again. Arming and setpoints still come
+ *          from the RC receiver.
+ *
+ *          After the first control update following each injected frame, the
+ *          motor values are posted without blocking to a low priority task
+ *          that sends them on the injection channel (msg id
+ *          INJECTION_MOTORS_MSG_ENUM) together with the frame timestamp and
+ *          the latency from frame reception to motor command.
+ *
+ * @license
+ * Dragonfly FCB firmware to control the Dragonfly quadrotor UAV
+ * Copyright (C) 2016  ÅF Technology South: Dragonfly Project
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA
+ *****************************************************************************/
+
+/* Includes ------------------------------------------------------------------*/
+#include "sensor_injection.h"
+
+#include "communication.h"
+#include "common.h"
+#include "cycle_counter.h"
+#include "fcb_error.h"
+#include "fcb_sensors.h"
+#include "fcb_gyroscope.h"
+#include "fcb_accelerometer_magnetometer.h"
+#include "fcb_barometer.h"
+#include "flight_control.h"
+#include "motor_control.h"
+#include "usbd_cdc_if.h"
+#include "uart.h"
+
+#include "FreeRTOS.h"
+#include "task.h"
+#include "queue.h"
+
+#include <string.h>
+
+#if FCB_USE_SENSOR_INJECTION
+
+/* Private typedef -----------------------------------------------------------*/
+typedef struct {
+    SensorInjectionFrame_TypeDef frame;
+    uint32_t rxCycles;          // Cycle count at frame reception
+} InjectionQueueItem_TypeDef;
+
+typedef struct {
+    uint32_t frameTimestampUs;
+    uint32_t latencyUs;
+    uint32_t loopCounter;
+    uint16_t motors[4];
+    uint8_t flightMode;
+} InjectionMotorItem_TypeDef;
+
+/* Private define ------------------------------------------------------------*/
+#define INJECTION_TX_TASK_PRIO              1
+#define INJECTION_FRAME_QUEUE_SIZE          4
+#define INJECTION_MOTOR_QUEUE_SIZE          4
+#define INJECTION_QUEUE_TIMEOUT             100 // [ms]
+
+#define INJECTION_TRAILER                   "\r\n"
+#define INJECTION_TRAILER_LEN               2
+#define INJECTION_PARSER_BUFFER_SIZE        (PROTO_HEADER_LEN + SENSOR_INJECTION_FRAME_SIZE + INJECTION_TRAILER_LEN)
+
+/* Private variables ---------------------------------------------------------*/
+static volatile SensorInjectionState_TypeDef injectionState = SENSOR_INJECTION_OFF;
+static volatile SensorInjectionChannel_TypeDef injectionChannel = SENSOR_INJECTION_USB;
+static volatile SensorInjectionStats_TypeDef injectionStats;
+static volatile uint32_t lastFrameTick = 0;   // [ms]
+
+/* Last injected frame published by the SENSORS task, read by the flight control task */
+static volatile uint32_t injectedFrameCounter = 0;
+static volatile uint32_t injectedFrameTimestampUs = 0;
+static volatile uint32_t injectedFrameRxCycles = 0;
+static uint32_t reportedFrameCounter = 0;
+static uint32_t injectionLoopCounter = 0;
+
+static uint8_t parserBuffer[INJECTION_PARSER_BUFFER_SIZE];
+static uint16_t parserLength = 0;
+
+static xQueueHandle qInjectionFrames = NULL;
+static xQueueHandle qInjectionMotors = NULL;
+xTaskHandle InjectionTxTaskHandle = NULL;
+
+/* Private function prototypes -----------------------------------------------*/
+static void ProcessInjectionParserBuffer(void);
+static void DropInjectionParserByte(void);
+static void HandleInjectionMessage(const uint8_t* payload, const uint16_t payloadSize);
+static void InjectionTxTask(void const *argument);
+
+/* Exported functions --------------------------------------------------------*/
+
+/*
+ * @brief  Starts the sensor injection mode. Only allowed while the flight control is idle (disarmed) and the
+ *         accelerometer/magnetometer are not being calibrated.
+ * @param  channel : Channel that receives sensor frames and sends motor frames
+ * @retval FCB_OK if started, else FCB_ERR
+ */
+FcbRetValType StartSensorInjection(const SensorInjectionChannel_TypeDef channel) {
+    if (injectionState != SENSOR_INJECTION_OFF || InjectionTxTaskHandle != NULL)
+        return FCB_ERR;
+
+    if (GetFlightControlMode() != FLIGHT_CONTROL_IDLE || IsAccMagMtrCalibrating())
+        return FCB_ERR;
+
+    /* The queues are kept between injection sessions to avoid heap fragmentation */
+    if (qInjectionFrames == NULL) {
+        qInjectionFrames = xQueueCreate(INJECTION_FRAME_QUEUE_SIZE, sizeof(InjectionQueueItem_TypeDef));
+        qInjectionMotors = xQueueCreate(INJECTION_MOTOR_QUEUE_SIZE, sizeof(InjectionMotorItem_TypeDef));
+        if (qInjectionFrames == NULL || qInjectionMotors == NULL) {
+            ErrorHandler();
+            return FCB_ERR;
+        }
+    }
+    xQueueReset(qInjectionFrames);
+    xQueueReset(qInjectionMotors);
+
+    memset((void*) &injectionStats, 0, sizeof(injectionStats));
+    parserLength = 0;
+    reportedFrameCounter = injectedFrameCounter;
+    injectionLoopCounter = 0;
+    lastFrameTick = HAL_GetTick();
+    injectionChannel = channel;
+    injectionState = SENSOR_INJECTION_ACTIVE;
+
+    /* Sensor injection TX task creation
+     * Task function pointer: InjectionTxTask
+     * Task name: INJECT_TX
+     * Stack depth: 2*configMINIMAL_STACK_SIZE
+     * Parameter: NULL
+     * Priority: INJECTION_TX_TASK_PRIO (0 to configMAX_PRIORITIES-1 possible)
+     * Handle: InjectionTxTaskHandle
+     **/
+    if (pdPASS
+            != xTaskCreate((pdTASK_CODE )InjectionTxTask, (signed portCHAR*)"INJECT_TX", 2*configMINIMAL_STACK_SIZE, NULL,
+                    INJECTION_TX_TASK_PRIO, &InjectionTxTaskHandle)) {
+        injectionState = SENSOR_INJECTION_OFF;
+        ErrorHandler();
+        return FCB_ERR;
+    }
+
+    return FCB_OK;
+}
+
+/*
+ * @brief  Stops the sensor injection mode. The driver values are published again immediately, the motor outputs
+ *         stay inhibited until the flight control is idle.
+ * @param  None
+ * @retval FCB_OK if injection was active, else FCB_ERR
+ */
+FcbRetValType StopSensorInjection(void) {
+    if (injectionState != SENSOR_INJECTION_ACTIVE)
+        return FCB_ERR;
+
+    injectionState = SENSOR_INJECTION_STOPPING;
+    return FCB_OK;
+}
+
+/*
+ * @brief  Returns the sensor injection state
+ * @param  None
+ * @retval Sensor injection state
+ */
+SensorInjectionState_TypeDef GetSensorInjectionState(void) {
+    return injectionState;
+}
+
+/*
+ * @brief  Returns if injected frames replace the sensor driver values
+ * @param  None
+ * @retval true if injection is active, else false
+ */
+bool IsSensorInjectionActive(void) {
+    return injectionState == SENSOR_INJECTION_ACTIVE;
+}
+
+/*
+ * @brief  Returns if a communication channel is used for sensor injection, i.e. received bytes shall be passed to
+ *         ParseSensorInjectionByte() instead of the CLI
+ * @param  channel : Communication channel
+ * @retval true if injection is active on the channel, else false
+ */
+bool IsSensorInjectionChannel(const SensorInjectionChannel_TypeDef channel) {
+    return injectionState == SENSOR_INJECTION_ACTIVE && injectionChannel == channel;
+}
+
+/*
+ * @brief  Returns if the motor outputs shall be kept at zero pulse width regardless of the motor commands
+ * @param  None
+ * @retval true if inhibited by sensor injection, else false
+ */
+bool IsMotorOutputInhibited(void) {
+    return injectionState != SENSOR_INJECTION_OFF;
+}
+
+/*
+ * @brief  Gets the sensor injection statistics
+ * @param  stats : Destination of the statistics
+ * @retval None
+ */
+void GetSensorInjectionStats(SensorInjectionStats_TypeDef* stats) {
+    memcpy(stats, (const void*) &injectionStats, sizeof(SensorInjectionStats_TypeDef));
+}
+
+/*
+ * @brief  Parses one byte received on the injection channel. Called from the RX task of the channel.
+ * @param  byte : Received byte
+ * @retval None
+ */
+void ParseSensorInjectionByte(const uint8_t byte) {
+    if (parserLength >= INJECTION_PARSER_BUFFER_SIZE)
+        DropInjectionParserByte();
+
+    parserBuffer[parserLength++] = byte;
+    ProcessInjectionParserBuffer();
+}
+
+/*
+ * @brief  Publishes the queued injected sensor frames. Called from the SENSORS task on
+ *         FCB_SENSOR_INJECTION_DATA_READY.
+ * @param  None
+ * @retval None
+ */
+void ProcessInjectedSensorFrames(void) {
+    InjectionQueueItem_TypeDef item;
+
+    while (qInjectionFrames != NULL && pdTRUE == xQueueReceive(qInjectionFrames, &item, 0)) {
+        if (injectionState != SENSOR_INJECTION_ACTIVE)
+            continue; // Stopped while queued
+
+        if (item.frame.sensorMask & SENSOR_INJECTION_GYRO)
+            InjectGyroscopeData(item.frame.gyro);
+        if (item.frame.sensorMask & SENSOR_INJECTION_ACC)
+            InjectAccelerometerData(item.frame.acc);
+        if (item.frame.sensorMask & SENSOR_INJECTION_MAG)
+            InjectMagnetometerData(item.frame.mag);
+#if defined(USE_BAROMETER)
+        if (item.frame.sensorMask & SENSOR_INJECTION_BARO)
+            InjectBarometerPressure(item.frame.pressure);
+#endif
+
+        taskENTER_CRITICAL();
+        injectedFrameTimestampUs = item.frame.timestampUs;
+        injectedFrameRxCycles = item.rxCycles;
+        injectedFrameCounter++;
+        taskEXIT_CRITICAL();
+    }
+}
+
+/*
+ * @brief  Reports the motor commands of the first control update after each injected frame, stops injection at
+ *         host timeout and releases the motor outputs once idle after injection. Called from the flight control task
+ *         after each control update.
+ * @param  None
+ * @retval None
+ */
+void SensorInjectionControlHook(void) {
+    InjectionMotorItem_TypeDef item;
+    uint32_t frameCounter, rxCycles;
+    uint8_t i;
+
+    if (injectionState == SENSOR_INJECTION_OFF)
+        return;
+
+    if (injectionState == SENSOR_INJECTION_STOPPING) {
+        if (GetFlightControlMode() == FLIGHT_CONTROL_IDLE)
+            injectionState = SENSOR_INJECTION_OFF;
+        return;
+    }
+
+    if (HAL_GetTick() - lastFrameTick > SENSOR_INJECTION_HOST_TIMEOUT) {
+        StopSensorInjection();
+        return;
+    }
+
+    injectionLoopCounter++;
+
+    taskENTER_CRITICAL();
+    frameCounter = injectedFrameCounter;
+    item.frameTimestampUs = injectedFrameTimestampUs;
+    rxCycles = injectedFrameRxCycles;
+    taskEXIT_CRITICAL();
+
+    if (frameCounter == reportedFrameCounter)
+        return;
+    reportedFrameCounter = frameCounter;
+
+    item.latencyUs = CYCLES_TO_NS(GetCyclesSince(rxCycles)) / 1000;
+    item.loopCounter = injectionLoopCounter;
+    for (i = 0; i < 4; i++)
+        item.motors[i] = GetMotorValue(i + 1);
+    item.flightMode = (uint8_t) GetFlightControlMode();
+
+    injectionStats.lastLatencyUs = item.latencyUs;
+    if (item.latencyUs > injectionStats.maxLatencyUs)
+        injectionStats.maxLatencyUs = item.latencyUs;
+
+    if (pdTRUE == xQueueSend(qInjectionMotors, &item, 0))
+        injectionStats.motorFrames++;
+    else
+        injectionStats.motorDrops++;
+}
+
+/* Private functions ---------------------------------------------------------*/
+
+/*
+ * @brief  Extracts complete messages from the parser buffer. On a bad header, size, CRC or trailer one byte is
+ *         dropped and the rest of the buffer is searched for the next header.
+ * @param  None
+ * @retval None
+ */
+static void ProcessInjectionParserBuffer(void) {
+    uint16_t payloadSize;
+    uint32_t crc;
+
+    while (parserLength > 0) {
+        if (parserBuffer[0] != SENSOR_INJECTION_MSG_ENUM) {
+            DropInjectionParserByte();
+            continue;
+        }
+
+        if (parserLength < PROTO_HEADER_LEN)
+            return;
+
+        memcpy(&payloadSize, &parserBuffer[5], sizeof(payloadSize));
+        if (payloadSize != 0 && payloadSize != SENSOR_INJECTION_FRAME_SIZE) {
+            injectionStats.badFrames++;
+            DropInjectionParserByte();
+            continue;
+        }
+
+        if (parserLength < PROTO_HEADER_LEN + payloadSize + INJECTION_TRAILER_LEN)
+            return;
+
+        memcpy(&crc, &parserBuffer[1], sizeof(crc));
+        if (crc != CalculateCRC(&parserBuffer[PROTO_HEADER_LEN], payloadSize)
+                || memcmp(&parserBuffer[PROTO_HEADER_LEN + payloadSize], INJECTION_TRAILER, INJECTION_TRAILER_LEN) != 0) {
+            injectionStats.badFrames++;
+            DropInjectionParserByte();
+            continue;
+        }
+
+        HandleInjectionMessage(&parserBuffer[PROTO_HEADER_LEN], payloadSize);
+        parserLength = 0;
+        return;
+    }
+}
+
+/*
+ * @brief  Drops the first byte of the parser buffer
+ * @param  None
+ * @retval None
+ */
+static void DropInjectionParserByte(void) {
+    injectionStats.droppedBytes++;
+    parserLength--;
+    memmove(parserBuffer, &parserBuffer[1], parserLength);
+}
+
+/*
+ * @brief  Handles a received injection message, an empty payload stops the injection
+ * @param  payload : Message payload
+ * @param  payloadSize : Payload size, 0 or SENSOR_INJECTION_FRAME_SIZE [bytes]
+ * @retval None
+ */
+static void HandleInjectionMessage(const uint8_t* payload, const uint16_t payloadSize) {
+    InjectionQueueItem_TypeDef item;
+
+    if (payloadSize == 0) {
+        StopSensorInjection();
+        return;
+    }
+
+    item.rxCycles = GetCycleCount();
+    lastFrameTick = HAL_GetTick();
+
+    memcpy(&item.frame.timestampUs, &payload[0], 4);
+    memcpy(item.frame.gyro, &payload[4], 12);
+    memcpy(item.frame.acc, &payload[16], 12);
+    memcpy(item.frame.mag, &payload[28], 12);
+    memcpy(&item.frame.pressure, &payload[40], 4);
+    item.frame.sensorMask = payload[44];
+
+    if (pdTRUE != xQueueSend(qInjectionFrames, &item, 0)) {
+        injectionStats.overruns++;
+        return;
+    }
+
+    injectionStats.frames++;
+    FcbSendSensorMessage(FCB_SENSOR_INJECTION_DATA_READY);
+}
+
+/**
+ * @brief  Task code that frames motor commands and sends them on the injection channel
+ * @param  argument : Unused parameter
+ * @retval None
+ */
+static void InjectionTxTask(void const *argument) {
+    (void) argument;
+
+    static uint8_t txBuffer[PROTO_HEADER_LEN + SENSOR_INJECTION_MOTOR_FRAME_SIZE + INJECTION_TRAILER_LEN];
+    InjectionMotorItem_TypeDef item;
+    const uint16_t payloadSize = SENSOR_INJECTION_MOTOR_FRAME_SIZE;
+    const uint8_t msgId = INJECTION_MOTORS_MSG_ENUM;
+    uint8_t* payload = &txBuffer[PROTO_HEADER_LEN];
+    uint32_t crc;
+
+    for (;;) {
+        if (pdTRUE == xQueueReceive(qInjectionMotors, &item, INJECTION_QUEUE_TIMEOUT)) {
+            memcpy(&payload[0], &item.frameTimestampUs, 4);
+            memcpy(&payload[4], &item.latencyUs, 4);
+            memcpy(&payload[8], &item.loopCounter, 4);
+            memcpy(&payload[12], item.motors, 8);
+            payload[20] = item.flightMode;
+
+            crc = CalculateCRC(payload, payloadSize);
+            memcpy(txBuffer, &msgId, 1);
+            memcpy(&txBuffer[1], &crc, 4);
+            memcpy(&txBuffer[5], &payloadSize, 2);
+            memcpy(&payload[payloadSize], INJECTION_TRAILER, INJECTION_TRAILER_LEN);
+
+            if (injectionChannel == SENSOR_INJECTION_UART)
+                UartSendData(txBuffer, sizeof(txBuffer));
+            else
+                USBComSendData(txBuffer, sizeof(txBuffer));
+        } else if (injectionState != SENSOR_INJECTION_ACTIVE) {
+            /* Injection stopped and all queued motor frames sent */
+            InjectionTxTaskHandle = NULL;
+            vTaskDelete(NULL);
+        }
+    }
+}
+
+#endif /* FCB_USE_SENSOR_INJECTION */
+
+/**
+ * @}
+ */
+
+/**
+ * @}
+ */
+/*****END OF FILE****/
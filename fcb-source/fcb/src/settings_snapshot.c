@@ -0,0 +1,391 @@
+/******************************************************************************
+ * @brief   File contains the export and import of a binary snapshot of all
+ *          settings persisted in flash.
+ *
+ *          A board is provisioned with one transfer: the snapshot is checked
+ *          as a whole (header, CRC, version, fields and setting values)
+ *          before anything is written, and the imported settings are then
+ *          committed together with a single flash page erase and program.
+ *          Settings left out of the snapshot keep their stored values, which
+ *          also allows importing single settings.
+ *
+ *          See settings_snapshot.h for the layout and tools/settings_snapshot.py
+ *          for the host side.
+ *
+ * @license
+ * Dragonfly FCB firmware to control the Dragonfly quadrotor UAV
+ * Copyright (C) 2016  ÅF Technology South: Dragonfly Project
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA
+ *****************************************************************************/
+
+/* Includes ------------------------------------------------------------------*/
+#include "settings_snapshot.h"
+#include "flash.h"
+#include "common.h"
+#include "receiver.h"
+#include "flight_control.h"
+#include "fcb_accelerometer_magnetometer.h"
+#include "fcb_sensor_calibration.h"
+#include "fcb_retval.h"
+
+#include <stddef.h>
+#include <string.h>
+#include <math.h>
+
+/* Private typedef -----------------------------------------------------------*/
+typedef struct {
+    uint8_t id;         // SettingsSnapshotField_TypeDef
+    uint8_t size;       // Field size in the current version [bytes]
+    uint16_t offset;    // Offset of the setting in FlashSettings_TypeDef
+    uint32_t mask;      // FLASH_SETTINGS_* bit
+} SnapshotField_TypeDef;
+
+/* Private define ------------------------------------------------------------*/
+#define SNAPSHOT_VERSION_IDX        4
+#define SNAPSHOT_FIELD_COUNT_IDX    5
+#define SNAPSHOT_PAYLOAD_SIZE_IDX   6
+
+/* Private macro -------------------------------------------------------------*/
+
+/* Private variables ---------------------------------------------------------*/
+static const SnapshotField_TypeDef snapshotFields[] = {
+        { SETTINGS_FIELD_RECEIVER_CALIBRATION, sizeof(Receiver_CalibrationValues_TypeDef),
+                offsetof(FlashSettings_TypeDef, receiverCalibration), FLASH_SETTINGS_RECEIVER_CALIBRATION },
+        { SETTINGS_FIELD_REFERENCE_MAX_LIMITS, sizeof(RefSignals_TypeDef),
+                offsetof(FlashSettings_TypeDef, referenceMaxLimits), FLASH_SETTINGS_REFERENCE_MAX_LIMITS },
+        { SETTINGS_FIELD_MAG_CALIBRATION, sizeof(((FlashSettings_TypeDef*) 0)->magCalibration),
+                offsetof(FlashSettings_TypeDef, magCalibration), FLASH_SETTINGS_MAG_CALIBRATION },
+        { SETTINGS_FIELD_ACC_CALIBRATION, sizeof(((FlashSettings_TypeDef*) 0)->accCalibration),
+                offsetof(FlashSettings_TypeDef, accCalibration), FLASH_SETTINGS_ACC_CALIBRATION } };
+
+#define SNAPSHOT_FIELDS_COUNT       (sizeof(snapshotFields) / sizeof(snapshotFields[0]))
+
+static const char* const snapshotStatusStrings[] = {
+        [SETTINGS_SNAPSHOT_OK] = "ok",
+        [SETTINGS_SNAPSHOT_BAD_HEADER] = "bad header or size",
+        [SETTINGS_SNAPSHOT_BAD_CRC] = "bad CRC",
+        [SETTINGS_SNAPSHOT_BAD_VERSION] = "unsupported version",
+        [SETTINGS_SNAPSHOT_BAD_FIELD] = "bad field",
+        [SETTINGS_SNAPSHOT_BAD_VALUE] = "setting value out of range",
+        [SETTINGS_SNAPSHOT_NOT_IDLE] = "flight control not idle or sensors calibrating",
+        [SETTINGS_SNAPSHOT_FLASH_ERROR] = "flash write failed" };
+
+static FlashSettings_TypeDef snapshotSettings; // Declared as static so the CLI task stack is not loaded with this
+
+/* Private function prototypes -----------------------------------------------*/
+static SettingsSnapshotStatus_TypeDef CheckSnapshotHeader(const uint8_t* snapshot, const uint16_t size);
+static SettingsSnapshotStatus_TypeDef ParseSnapshotFields(const uint8_t* snapshot, FlashSettings_TypeDef* settings,
+        SettingsSnapshotImport_TypeDef* result);
+static SettingsSnapshotStatus_TypeDef CheckSettingsValues(const FlashSettings_TypeDef* settings, const uint32_t mask);
+static const SnapshotField_TypeDef* GetSnapshotField(const uint8_t id);
+static bool IsFiniteArray(const float32_t* values, const uint8_t count);
+
+/* Exported functions --------------------------------------------------------*/
+
+/*
+ * @brief  Exports all settings stored in flash to a snapshot. Settings that have not been stored are left out.
+ * @param  snapshot : Buffer that receives the snapshot
+ * @param  maxSize : Buffer size, at most SETTINGS_SNAPSHOT_MAX_SIZE is used
+ * @param  size : Returns the snapshot size [bytes]
+ * @param  exportedMask : Returns the FLASH_SETTINGS_* bits of the exported settings
+ * @retval SETTINGS_SNAPSHOT_OK if exported, SETTINGS_SNAPSHOT_BAD_HEADER if the buffer is too small
+ */
+SettingsSnapshotStatus_TypeDef ExportSettingsSnapshot(uint8_t* snapshot, const uint16_t maxSize, uint16_t* size,
+        uint32_t* exportedMask) {
+    const uint32_t magic = SETTINGS_SNAPSHOT_MAGIC;
+    uint16_t offset = SETTINGS_SNAPSHOT_HEADER_SIZE;
+    uint16_t payloadSize;
+    uint32_t crc;
+    uint8_t fieldCount = 0;
+    uint8_t i;
+
+    *size = 0;
+    *exportedMask = 0;
+    if (maxSize < SETTINGS_SNAPSHOT_HEADER_SIZE + SETTINGS_SNAPSHOT_CRC_SIZE)
+        return SETTINGS_SNAPSHOT_BAD_HEADER;
+
+    ReadAllSettingsFromFlash(&snapshotSettings);
+
+    for (i = 0; i < SNAPSHOT_FIELDS_COUNT; i++) {
+        const SnapshotField_TypeDef* field = &snapshotFields[i];
+
+        if (!(snapshotSettings.validMask & field->mask))
+            continue;
+
+        if (offset + SETTINGS_SNAPSHOT_FIELD_HEADER_SIZE + field->size + SETTINGS_SNAPSHOT_CRC_SIZE > maxSize
+                || offset + SETTINGS_SNAPSHOT_FIELD_HEADER_SIZE + field->size + SETTINGS_SNAPSHOT_CRC_SIZE
+                        > SETTINGS_SNAPSHOT_MAX_SIZE)
+            return SETTINGS_SNAPSHOT_BAD_HEADER;
+
+        snapshot[offset] = field->id;
+        snapshot[offset + 1] = field->size;
+        memcpy(&snapshot[offset + SETTINGS_SNAPSHOT_FIELD_HEADER_SIZE], (uint8_t*) &snapshotSettings + field->offset,
+                field->size);
+        offset += SETTINGS_SNAPSHOT_FIELD_HEADER_SIZE + field->size;
+        *exportedMask |= field->mask;
+        fieldCount++;
+    }
+
+    payloadSize = offset - SETTINGS_SNAPSHOT_HEADER_SIZE;
+    memcpy(&snapshot[0], &magic, sizeof(magic));
+    snapshot[SNAPSHOT_VERSION_IDX] = SETTINGS_SNAPSHOT_VERSION;
+    snapshot[SNAPSHOT_FIELD_COUNT_IDX] = fieldCount;
+    memcpy(&snapshot[SNAPSHOT_PAYLOAD_SIZE_IDX], &payloadSize, sizeof(payloadSize));
+
+    crc = CalculateCRC(snapshot, offset);
+    memcpy(&snapshot[offset], &crc, sizeof(crc));
+    *size = offset + SETTINGS_SNAPSHOT_CRC_SIZE;
+
+    return SETTINGS_SNAPSHOT_OK;
+}
+
+/*
+ * @brief  Imports a settings snapshot. The whole snapshot is checked first, then the imported settings are written
+ *         to flash with one page operation and used from then on. Only allowed while the flight control is idle.
+ * @param  snapshot : Snapshot buffer
+ * @param  size : Snapshot size [bytes]
+ * @param  result : Returns the version and the imported settings, valid if SETTINGS_SNAPSHOT_OK is returned
+ * @retval SETTINGS_SNAPSHOT_OK if imported, else the reason the snapshot was rejected. Nothing is written to flash
+ *         unless SETTINGS_SNAPSHOT_OK or SETTINGS_SNAPSHOT_FLASH_ERROR is returned.
+ */
+SettingsSnapshotStatus_TypeDef ImportSettingsSnapshot(const uint8_t* snapshot, const uint16_t size,
+        SettingsSnapshotImport_TypeDef* result) {
+    SettingsSnapshotStatus_TypeDef status;
+    uint32_t storedMask;
+
+    memset(result, 0, sizeof(*result));
+
+    status = CheckSnapshotHeader(snapshot, size);
+    if (status != SETTINGS_SNAPSHOT_OK)
+        return status;
+
+    if (GetFlightControlMode() != FLIGHT_CONTROL_IDLE || IsAccMagMtrCalibrating())
+        return SETTINGS_SNAPSHOT_NOT_IDLE;
+
+    /* The snapshot fields are applied on top of the stored settings */
+    ReadAllSettingsFromFlash(&snapshotSettings);
+    storedMask = snapshotSettings.validMask;
+
+    status = ParseSnapshotFields(snapshot, &snapshotSettings, result);
+    if (status != SETTINGS_SNAPSHOT_OK)
+        return status;
+
+    status = CheckSettingsValues(&snapshotSettings, result->importedMask);
+    if (status != SETTINGS_SNAPSHOT_OK)
+        return status;
+
+    snapshotSettings.validMask = storedMask | result->importedMask;
+    if (!WriteAllSettingsToFlash(&snapshotSettings))
+        return SETTINGS_SNAPSHOT_FLASH_ERROR;
+
+    if (result->importedMask & FLASH_SETTINGS_RECEIVER_CALIBRATION)
+        SetReceiverCalibrationValues(&snapshotSettings.receiverCalibration);
+
+    if (result->importedMask & FLASH_SETTINGS_REFERENCE_MAX_LIMITS)
+        applyMaxLimitForReferenceSignal(&snapshotSettings.referenceMaxLimits);
+
+    /* Only refused if a sensor calibration was started meanwhile, which stores its own result when done */
+    SetAccMagMtrCalibrationParams(
+            (result->importedMask & FLASH_SETTINGS_ACC_CALIBRATION) ? snapshotSettings.accCalibration : NULL,
+            (result->importedMask & FLASH_SETTINGS_MAG_CALIBRATION) ? snapshotSettings.magCalibration : NULL);
+
+    return SETTINGS_SNAPSHOT_OK;
+}
+
+/*
+ * @brief  Returns a description of a snapshot status
+ * @param  status : Snapshot status
+ * @retval Status string
+ */
+const char* GetSettingsSnapshotStatusString(const SettingsSnapshotStatus_TypeDef status) {
+    if ((uint32_t) status >= sizeof(snapshotStatusStrings) / sizeof(snapshotStatusStrings[0]))
+        return "unknown";
+
+    return snapshotStatusStrings[status];
+}
+
+/* Private functions ---------------------------------------------------------*/
+
+/*
+ * @brief  Checks the snapshot magic, size, CRC and version
+ * @param  snapshot : Snapshot buffer
+ * @param  size : Snapshot size [bytes]
+ * @retval SETTINGS_SNAPSHOT_OK if valid, else the reason the snapshot is invalid
+ */
+static SettingsSnapshotStatus_TypeDef CheckSnapshotHeader(const uint8_t* snapshot, const uint16_t size) {
+    uint32_t magic;
+    uint32_t crc;
+    uint16_t payloadSize;
+
+    if (size < SETTINGS_SNAPSHOT_HEADER_SIZE + SETTINGS_SNAPSHOT_CRC_SIZE || size > SETTINGS_SNAPSHOT_MAX_SIZE)
+        return SETTINGS_SNAPSHOT_BAD_HEADER;
+
+    memcpy(&magic, &snapshot[0], sizeof(magic));
+    memcpy(&payloadSize, &snapshot[SNAPSHOT_PAYLOAD_SIZE_IDX], sizeof(payloadSize));
+    if (magic != SETTINGS_SNAPSHOT_MAGIC
+            || SETTINGS_SNAPSHOT_HEADER_SIZE + payloadSize + SETTINGS_SNAPSHOT_CRC_SIZE != size)
+        return SETTINGS_SNAPSHOT_BAD_HEADER;
+
+    memcpy(&crc, &snapshot[size - SETTINGS_SNAPSHOT_CRC_SIZE], sizeof(crc));
+    if (CalculateCRC(snapshot, size - SETTINGS_SNAPSHOT_CRC_SIZE) != crc)
+        return SETTINGS_SNAPSHOT_BAD_CRC;
+
+    if (snapshot[SNAPSHOT_VERSION_IDX] == 0 || snapshot[SNAPSHOT_VERSION_IDX] > SETTINGS_SNAPSHOT_VERSION)
+        return SETTINGS_SNAPSHOT_BAD_VERSION;
+
+    return SETTINGS_SNAPSHOT_OK;
+}
+
+/*
+ * @brief  Copies the snapshot fields into the settings, migrating fields of earlier snapshot versions
+ * @param  snapshot : Snapshot buffer with a valid header
+ * @param  settings : Stored settings, the imported settings are overwritten
+ * @param  result : Returns the version, the imported settings and the migrated and skipped field counts
+ * @retval SETTINGS_SNAPSHOT_OK if all fields are valid, else SETTINGS_SNAPSHOT_BAD_FIELD
+ */
+static SettingsSnapshotStatus_TypeDef ParseSnapshotFields(const uint8_t* snapshot, FlashSettings_TypeDef* settings,
+        SettingsSnapshotImport_TypeDef* result) {
+    const uint8_t version = snapshot[SNAPSHOT_VERSION_IDX];
+    const uint8_t fieldCount = snapshot[SNAPSHOT_FIELD_COUNT_IDX];
+    const uint32_t storedMask = settings->validMask;
+    uint32_t importedMask = 0;
+    uint16_t payloadSize;
+    uint16_t payloadEnd;
+    uint16_t offset = SETTINGS_SNAPSHOT_HEADER_SIZE;
+    uint8_t i;
+
+    memcpy(&payloadSize, &snapshot[SNAPSHOT_PAYLOAD_SIZE_IDX], sizeof(payloadSize));
+    payloadEnd = SETTINGS_SNAPSHOT_HEADER_SIZE + payloadSize;
+    result->version = version;
+
+    for (i = 0; i < fieldCount; i++) {
+        const SnapshotField_TypeDef* field;
+        uint8_t fieldSize;
+
+        if (offset + SETTINGS_SNAPSHOT_FIELD_HEADER_SIZE > payloadEnd)
+            return SETTINGS_SNAPSHOT_BAD_FIELD;
+
+        field = GetSnapshotField(snapshot[offset]);
+        fieldSize = snapshot[offset + 1];
+        offset += SETTINGS_SNAPSHOT_FIELD_HEADER_SIZE;
+
+        if (offset + fieldSize > payloadEnd)
+            return SETTINGS_SNAPSHOT_BAD_FIELD;
+
+        if (field == NULL) {
+            /* Only fields of earlier versions may have been removed since */
+            if (version == SETTINGS_SNAPSHOT_VERSION)
+                return SETTINGS_SNAPSHOT_BAD_FIELD;
+            result->skippedFields++;
+        } else {
+            if ((importedMask & field->mask) || fieldSize > field->size)
+                return SETTINGS_SNAPSHOT_BAD_FIELD;
+
+            /* A shorter field of an earlier version lacks the members appended since, which keep their stored
+             * values. Without stored values the setting would be incomplete. */
+            if (fieldSize < field->size) {
+                if (version == SETTINGS_SNAPSHOT_VERSION || !(storedMask & field->mask))
+                    return SETTINGS_SNAPSHOT_BAD_FIELD;
+                result->migratedFields++;
+            }
+
+            memcpy((uint8_t*) settings + field->offset, &snapshot[offset], fieldSize);
+            importedMask |= field->mask;
+        }
+
+        offset += fieldSize;
+    }
+
+    if (offset != payloadEnd)
+        return SETTINGS_SNAPSHOT_BAD_FIELD;
+
+    result->importedMask = importedMask;
+    return SETTINGS_SNAPSHOT_OK;
+}
+
+/*
+ * @brief  Checks that the imported settings are within the same ranges as enforced when loading them at startup
+ * @param  settings : Settings to check
+ * @param  mask : FLASH_SETTINGS_* bits of the settings to check
+ * @retval SETTINGS_SNAPSHOT_OK if valid, else SETTINGS_SNAPSHOT_BAD_VALUE
+ */
+static SettingsSnapshotStatus_TypeDef CheckSettingsValues(const FlashSettings_TypeDef* settings, const uint32_t mask) {
+    const RefSignals_TypeDef* limits = &settings->referenceMaxLimits;
+
+    if ((mask & FLASH_SETTINGS_RECEIVER_CALIBRATION)
+            && !CheckReceiverCalibrationValues(&settings->receiverCalibration))
+        return SETTINGS_SNAPSHOT_BAD_VALUE;
+
+    if ((mask & FLASH_SETTINGS_REFERENCE_MAX_LIMITS)
+            && (!IsFiniteArray((const float32_t*) limits, sizeof(RefSignals_TypeDef) / sizeof(float32_t))
+                    || limits->zVelocity <= 0.0f || limits->rollAngle <= 0.0f || limits->pitchAngle <= 0.0f
+                    || limits->yawAngle <= 0.0f || limits->yawAngleRate <= 0.0f))
+        return SETTINGS_SNAPSHOT_BAD_VALUE;
+
+    if ((mask & FLASH_SETTINGS_MAG_CALIBRATION)
+            && (!IsFiniteArray(settings->magCalibration, CALIB_IDX_MAX)
+                    || CheckCalParams(settings->magCalibration) != FCB_OK))
+        return SETTINGS_SNAPSHOT_BAD_VALUE;
+
+    if ((mask & FLASH_SETTINGS_ACC_CALIBRATION)
+            && (!IsFiniteArray(settings->accCalibration, CALIB_IDX_MAX)
+                    || CheckCalParams(settings->accCalibration) != FCB_OK))
+        return SETTINGS_SNAPSHOT_BAD_VALUE;
+
+    return SETTINGS_SNAPSHOT_OK;
+}
+
+/*
+ * @brief  Looks up a snapshot field
+ * @param  id : Field id
+ * @retval Field description, NULL if the id is not used by this firmware
+ */
+static const SnapshotField_TypeDef* GetSnapshotField(const uint8_t id) {
+    uint8_t i;
+
+    for (i = 0; i < SNAPSHOT_FIELDS_COUNT; i++) {
+        if (snapshotFields[i].id == id)
+            return &snapshotFields[i];
+    }
+
+    return NULL;
+}
+
+/*
+ * @brief  Checks that values are neither NaN nor infinite
+ * @param  values : Values to check
+ * @param  count : Number of values
+ * @retval true if all values are finite
+ */
+static bool IsFiniteArray(const float32_t* values, const uint8_t count) {
+    uint8_t i;
+
+    for (i = 0; i < count; i++) {
+        if (!isfinite(values[i]))
+            return false;
+    }
+
+    return true;
+}
+
+/**
+ * @}
+ */
+
+/**
+ * @}
+ */
+/*****END OF FILE****/
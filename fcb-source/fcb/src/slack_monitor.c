@@ -0,0 +1,288 @@
+/******************************************************************************
+ * @brief   File contains the control loop slack monitor and the shedding of
+ *          deferrable work under CPU pressure.
+ *
+ *          The flight control task reports the CPU cycles from the control
+ *          tick to the completion of each control cycle. The headroom left to
+ *          the next control tick is evaluated over windows of control cycles,
+ *          and the least headroom of a window selects the shedding level:
+ *
+ *          - Normal: all work runs at full rate.
+ *          - Throttle: telemetry and print tasks run at a reduced rate.
+ *          - Suspend: telemetry and print tasks are suspended.
+ *          - Critical: calibration and flash writes are deferred as well.
+ *
+ *          A level is entered as soon as a window has too little headroom,
+ *          and a missed deadline or a skipped control tick enters the critical
+ *          level at once. A level is left one step at a time after headroom
+ *          has stayed above the level threshold plus a hysteresis margin for
+ *          several windows.
+ *
+ *          The monitor does not access any hardware or RTOS services so that
+ *          it can be run in a host model.
+ *
+ * @license
+ * Dragonfly FCB firmware to control the Dragonfly quadrotor UAV
+ * Copyright (C) 2016  ÅF Technology South: Dragonfly Project
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA
+ *****************************************************************************/
+
+/* Includes ------------------------------------------------------------------*/
+#include "slack_monitor.h"
+
+#include <string.h>
+
+/* Private typedef -----------------------------------------------------------*/
+/* Private define ------------------------------------------------------------*/
+_Static_assert(SLACK_THROTTLE_PERCENT > SLACK_SUSPEND_PERCENT && SLACK_SUSPEND_PERCENT > SLACK_CRITICAL_PERCENT,
+        "Slack level thresholds must decrease with level");
+_Static_assert(SLACK_THROTTLE_PERCENT + SLACK_RESTORE_PERCENT < 100, "Slack restore threshold exceeds loop period");
+_Static_assert(SLACK_WINDOW_CYCLES > 0, "Slack window must contain at least one control cycle");
+
+/* Private macro -------------------------------------------------------------*/
+
+/* Private variables ---------------------------------------------------------*/
+static const char* const levelNames[SLACK_LEVEL_COUNT] = { "normal", "throttle", "suspend", "critical" };
+static const char* const workNames[SLACK_WORK_COUNT] = { "telemetry", "print", "calibration", "flash" };
+
+/* Headroom threshold of each level [% of loop period] */
+static const uint8_t levelThresholdPercent[SLACK_LEVEL_COUNT] = {
+        100, SLACK_THROTTLE_PERCENT, SLACK_SUSPEND_PERCENT, SLACK_CRITICAL_PERCENT };
+
+/* Rate divider of each work at each level, 0 if the work is suspended or deferred */
+static const uint8_t workRateDivider[SLACK_WORK_COUNT][SLACK_LEVEL_COUNT] = {
+        [SLACK_WORK_TELEMETRY] = { 1, SLACK_THROTTLE_DIVIDER, 0, 0 },
+        [SLACK_WORK_PRINT] = { 1, SLACK_THROTTLE_DIVIDER, 0, 0 },
+        [SLACK_WORK_CALIBRATION] = { 1, 1, 1, 0 },
+        [SLACK_WORK_FLASH] = { 1, 1, 1, 0 } };
+
+static volatile SlackLevel_TypeDef slackLevel = SLACK_LEVEL_NORMAL;
+static SlackMonitorStats_TypeDef slackStats;
+
+static uint32_t windowCycles;
+static uint32_t windowMinHeadroom;
+static uint16_t restoreWindows;
+static volatile bool overrunPending;
+static volatile uint32_t consecutiveOverruns;
+
+/* Private function prototypes -----------------------------------------------*/
+static SlackLevel_TypeDef GetSlackLevelForHeadroom(const uint32_t headroom, const uint8_t marginPercent);
+static void SetSlackLevel(const SlackLevel_TypeDef level);
+
+/* Exported functions --------------------------------------------------------*/
+
+/*
+ * @brief  Initializes the slack monitor to the normal level
+ * @param  None
+ * @retval None
+ */
+void InitSlackMonitor(void) {
+    slackLevel = SLACK_LEVEL_NORMAL;
+    windowCycles = 0;
+    windowMinHeadroom = UINT32_MAX;
+    restoreWindows = 0;
+    overrunPending = false;
+    consecutiveOverruns = 0;
+    ResetSlackMonitorStats();
+}
+
+/*
+ * @brief  Updates the headroom statistics and the shedding level. Called by the flight control task at the end of
+ *         each control cycle.
+ * @param  busyCycles : CPU cycles from the control tick to the completion of the control cycle
+ * @retval None
+ */
+void UpdateSlackMonitor(const uint32_t busyCycles) {
+    const uint32_t headroom = (busyCycles < SLACK_PERIOD_CYCLES) ? SLACK_PERIOD_CYCLES - busyCycles : 0;
+    SlackLevel_TypeDef target;
+
+    slackStats.cycles++;
+    slackStats.cyclesAtLevel[slackLevel]++;
+    slackStats.lastHeadroom = headroom;
+    if (headroom < slackStats.minHeadroom)
+        slackStats.minHeadroom = headroom;
+    if (headroom < windowMinHeadroom)
+        windowMinHeadroom = headroom;
+    consecutiveOverruns = 0;
+
+    /* A missed deadline or a skipped control tick sheds all deferrable work at once */
+    if (busyCycles > SLACK_PERIOD_CYCLES || overrunPending) {
+        if (busyCycles > SLACK_PERIOD_CYCLES)
+            slackStats.deadlineMisses++;
+        overrunPending = false;
+        SetSlackLevel(SLACK_LEVEL_CRITICAL);
+        restoreWindows = 0;
+    }
+
+    if (++windowCycles < SLACK_WINDOW_CYCLES)
+        return;
+
+    /* Escalate as soon as a window is short of headroom, restore one level after a sustained recovery */
+    target = GetSlackLevelForHeadroom(windowMinHeadroom, 0);
+    if (target > slackLevel) {
+        SetSlackLevel(target);
+        restoreWindows = 0;
+    } else if (slackLevel > SLACK_LEVEL_NORMAL
+            && GetSlackLevelForHeadroom(windowMinHeadroom, SLACK_RESTORE_PERCENT) < slackLevel) {
+        if (++restoreWindows >= SLACK_RESTORE_WINDOWS) {
+            SetSlackLevel(slackLevel - 1);
+            restoreWindows = 0;
+        }
+    } else {
+        restoreWindows = 0;
+    }
+
+    slackStats.windowMinHeadroom = windowMinHeadroom;
+    windowMinHeadroom = UINT32_MAX;
+    windowCycles = 0;
+}
+
+/*
+ * @brief  Reports a control tick that was skipped because the flight control task had not taken the previous one.
+ *         Called from the control tick deferred handler.
+ * @param  None
+ * @retval true if more than SLACK_MAX_CONSECUTIVE_OVERRUNS ticks in a row were skipped, else false
+ */
+bool ReportControlOverrun(void) {
+    slackStats.overruns++;
+    overrunPending = true;
+    return ++consecutiveOverruns > SLACK_MAX_CONSECUTIVE_OVERRUNS;
+}
+
+/*
+ * @brief  Returns the current shedding level
+ * @param  None
+ * @retval Shedding level
+ */
+SlackLevel_TypeDef GetSlackLevel(void) {
+    return slackLevel;
+}
+
+/*
+ * @brief  Returns the rate divider of a deferrable work at the current shedding level
+ * @param  work : Deferrable work
+ * @retval Rate divider, 1 at full rate, 0 if the work is suspended or deferred
+ */
+uint8_t GetSlackRateDivider(const SlackWork_TypeDef work) {
+    if (work >= SLACK_WORK_COUNT)
+        return 1;
+
+    return workRateDivider[work][slackLevel];
+}
+
+/*
+ * @brief  Checks if a work item should run at the current shedding level. Skipped items are counted as shed.
+ * @param  work : Deferrable work
+ * @param  sequence : Sequence number of the work item, selects which items run when the work is throttled
+ * @retval true if the item should run, false if it should be skipped or deferred
+ */
+bool IsSlackWorkDue(const SlackWork_TypeDef work, const uint32_t sequence) {
+    const uint8_t divider = GetSlackRateDivider(work);
+
+    if (divider != 0 && sequence % divider == 0)
+        return true;
+
+    if (work < SLACK_WORK_COUNT)
+        slackStats.shedCount[work]++;
+    return false;
+}
+
+/*
+ * @brief  Returns the name of a shedding level
+ * @param  level : Shedding level
+ * @retval Name string
+ */
+const char* GetSlackLevelName(const SlackLevel_TypeDef level) {
+    if (level >= SLACK_LEVEL_COUNT)
+        return "?";
+
+    return levelNames[level];
+}
+
+/*
+ * @brief  Returns the name of a deferrable work
+ * @param  work : Deferrable work
+ * @retval Name string
+ */
+const char* GetSlackWorkName(const SlackWork_TypeDef work) {
+    if (work >= SLACK_WORK_COUNT)
+        return "?";
+
+    return workNames[work];
+}
+
+/*
+ * @brief  Gets the slack monitor state and statistics
+ * @param  stats : Destination of the statistics, headroom in CPU cycles
+ * @retval None
+ */
+void GetSlackMonitorStats(SlackMonitorStats_TypeDef* stats) {
+    memcpy(stats, &slackStats, sizeof(SlackMonitorStats_TypeDef));
+    stats->level = slackLevel;
+}
+
+/*
+ * @brief  Resets the slack monitor statistics. The shedding level is kept.
+ * @param  None
+ * @retval None
+ */
+void ResetSlackMonitorStats(void) {
+    memset(&slackStats, 0, sizeof(SlackMonitorStats_TypeDef));
+    slackStats.windowMinHeadroom = UINT32_MAX;
+    slackStats.minHeadroom = UINT32_MAX;
+}
+
+/* Private functions ---------------------------------------------------------*/
+
+/*
+ * @brief  Returns the shedding level for a headroom
+ * @param  headroom : Headroom [CPU cycles]
+ * @param  marginPercent : Margin added to the level thresholds [% of loop period]
+ * @retval Highest level whose threshold plus margin is above the headroom
+ */
+static SlackLevel_TypeDef GetSlackLevelForHeadroom(const uint32_t headroom, const uint8_t marginPercent) {
+    SlackLevel_TypeDef level = SLACK_LEVEL_NORMAL;
+    SlackLevel_TypeDef i;
+
+    for (i = SLACK_LEVEL_THROTTLE; i < SLACK_LEVEL_COUNT; i++) {
+        if (headroom < SLACK_PERCENT_TO_CYCLES(levelThresholdPercent[i] + marginPercent))
+            level = i;
+    }
+
+    return level;
+}
+
+/*
+ * @brief  Changes the shedding level
+ * @param  level : New shedding level
+ * @retval None
+ */
+static void SetSlackLevel(const SlackLevel_TypeDef level) {
+    if (level == slackLevel)
+        return;
+
+    slackLevel = level;
+    slackStats.levelChanges++;
+}
+
+/**
+ * @}
+ */
+
+/**
+ * @}
+ */
+/*****END OF FILE****/
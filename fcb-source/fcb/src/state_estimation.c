@@ -33,15 +33,15 @@
 #include "task.h"
 #include "semphr.h"
 
-#include "dragonfly_fcb.pb.h"
-#include "pb_encode.h"
-
 #include "fcb_sensors.h"
 #include "fcb_gyroscope.h"
 #include "fcb_error.h"
 #include "rotation_transformation.h"
 #include "fcb_accelerometer_magnetometer.h"
 #include "fcb_retval.h"
+#include "build_profile.h"
+#include "slack_monitor.h"
+#include "adaptive_sampling.h"
 #include "usbd_cdc_if.h"
 #include "rotation_transformation.h"
 
@@ -74,8 +74,10 @@ static KalmanFilterType pitchEstimator;
 static KalmanFilterType yawEstimator;
 
 /* Task handle for printing of sensor values task */
+#if FCB_USE_PRINT_TASKS
 static volatile uint16_t statePrintSampleTime;
 static volatile uint16_t statePrintSampleDuration;
+#endif
 xTaskHandle StatePrintSamplingTaskHandle = NULL;
 
 static float32_t sensorAttitudeRPY[3] = { 0.0f, 0.0f, 0.0f };
@@ -88,11 +90,13 @@ static portTickType accLastCorrectionTick = 0;
 static void StateInit(KalmanFilterType * Estimator, float32_t q1, float32_t q2, float32_t q3, float32_t r1, float32_t r2);
 static void PredictAttitudeState(KalmanFilterType* pEstimator, AttitudeStateVectorType * pState,
         float32_t const inertia, float32_t const ctrl, float32_t const tSinceLastCorrection);
-static void CorrectAttitudeState(const float32_t sensorAngle, KalmanFilterType* pEstimator,
+static float32_t CorrectAttitudeState(const float32_t sensorAngle, KalmanFilterType* pEstimator,
 		AttitudeStateVectorType* pStateInternal, AttitudeStateVectorType* pState);
 static void CorrectAttitudeRateState(const float32_t sensorRate, KalmanFilterType* pEstimator,
         AttitudeStateVectorType* pStateInternal, AttitudeStateVectorType* pState);
+#if FCB_USE_PRINT_TASKS
 static void StatePrintSamplingTask(void const *argument);
+#endif
 
 /* Exported functions --------------------------------------------------------*/
 
@@ -161,6 +165,9 @@ StateEstimationStatus InitStateEstimationTimeEvent(void) {
         ErrorHandler();
     }
 
+    /* Auto-reload preload, period corrections from the phase lock take effect at the next update event */
+    StateEstimationTimHandle.Instance->CR1 |= TIM_CR1_ARPE;
+
     /*##-2- Start the TIM Base generation in interrupt mode ####################*/
     if (HAL_TIM_Base_Start_IT(&StateEstimationTimHandle) != HAL_OK) {
         /* Starting Error */
@@ -241,6 +248,45 @@ float32_t GetYawRate(void) {
     return yawState.angleRateUnbiased;
 }
 
+/*
+ * @brief  Saves the complete estimator state. Must be called with the scheduler suspended together with the
+ *         matching RestoreStateEstimationContext(), so that no estimator update in between is lost.
+ * @param  context : Destination of the estimator state
+ * @retval None
+ */
+void SaveStateEstimationContext(StateEstimationContextType* context) {
+    context->state[ROLL_IDX] = rollState;
+    context->state[PITCH_IDX] = pitchState;
+    context->state[YAW_IDX] = yawState;
+    context->stateInternal[ROLL_IDX] = rollStateInternal;
+    context->stateInternal[PITCH_IDX] = pitchStateInternal;
+    context->stateInternal[YAW_IDX] = yawStateInternal;
+    context->estimator[ROLL_IDX] = rollEstimator;
+    context->estimator[PITCH_IDX] = pitchEstimator;
+    context->estimator[YAW_IDX] = yawEstimator;
+    context->accLastCorrectionTick = accLastCorrectionTick;
+    context->magLastCorrectionTick = magLastCorrectionTick;
+}
+
+/*
+ * @brief  Restores an estimator state saved with SaveStateEstimationContext()
+ * @param  context : The saved estimator state
+ * @retval None
+ */
+void RestoreStateEstimationContext(const StateEstimationContextType* context) {
+    rollState = context->state[ROLL_IDX];
+    pitchState = context->state[PITCH_IDX];
+    yawState = context->state[YAW_IDX];
+    rollStateInternal = context->stateInternal[ROLL_IDX];
+    pitchStateInternal = context->stateInternal[PITCH_IDX];
+    yawStateInternal = context->stateInternal[YAW_IDX];
+    rollEstimator = context->estimator[ROLL_IDX];
+    pitchEstimator = context->estimator[PITCH_IDX];
+    yawEstimator = context->estimator[YAW_IDX];
+    accLastCorrectionTick = context->accLastCorrectionTick;
+    magLastCorrectionTick = context->magLastCorrectionTick;
+}
+
 
 /* Private functions ---------------------------------------------------------*/
 
@@ -272,7 +318,8 @@ static void StateInit(KalmanFilterType * Estimator, float32_t q1, float32_t q2,
     Estimator->r1 = r1;
     Estimator->r2 = r2;
 
-    Estimator->h = 1.0/((float32_t)(SystemCoreClock/(STATE_ESTIMATION_TIME_UPDATE_PERIOD+1)/STATE_ESTIMATION_TIME_UPDATE_PRESCALER));
+    Estimator->h = ((float32_t) (STATE_ESTIMATION_TIME_UPDATE_PERIOD+1)*(STATE_ESTIMATION_TIME_UPDATE_PRESCALER+1))
+            / SystemCoreClock;
 }
 
 /*
@@ -301,20 +348,28 @@ void UpdateCorrectionState(FcbSensorIndexType sensorType, float32_t const * pXYZ
     case ACC_IDX: {
         /* run correction step */
         float32_t const * pAccMeterXYZ = pXYZ; /* interpret values as accelerations */
+        float32_t errorVariance = MAX(rollEstimator.p11, pitchEstimator.p11); // A priori, for the adaptive sampling
+        float32_t rollInnovation, pitchInnovation;
         GetAttitudeFromAccelerometer(sensorAttitudeRPY, pAccMeterXYZ);
-        CorrectAttitudeState(sensorAttitudeRPY[ROLL_IDX], &rollEstimator, &rollStateInternal, &rollState);
-        CorrectAttitudeState(sensorAttitudeRPY[PITCH_IDX], &pitchEstimator, &pitchStateInternal, &pitchState);
+        rollInnovation = CorrectAttitudeState(sensorAttitudeRPY[ROLL_IDX], &rollEstimator, &rollStateInternal, &rollState);
+        pitchInnovation = CorrectAttitudeState(sensorAttitudeRPY[PITCH_IDX], &pitchEstimator, &pitchStateInternal, &pitchState);
 
         accLastCorrectionTick = xTaskGetTickCount();
+        UpdateAdaptiveSampling(ADAPTIVE_SENSOR_ACC, MAX(fabsf(rollInnovation), fabsf(pitchInnovation)), errorVariance,
+                accLastCorrectionTick * portTICK_RATE_MS);
     }
         break;
     case MAG_IDX: {
         /* run correction step */
         float32_t const * pMagMeter = pXYZ;
+        float32_t errorVariance = yawEstimator.p11;
+        float32_t yawInnovation;
         sensorAttitudeRPY[YAW_IDX] = GetMagYawAngle((float32_t*) pMagMeter, GetRollAngle(), GetPitchAngle());
-        CorrectAttitudeState(sensorAttitudeRPY[YAW_IDX], &yawEstimator, &yawStateInternal, &yawState);
+        yawInnovation = CorrectAttitudeState(sensorAttitudeRPY[YAW_IDX], &yawEstimator, &yawStateInternal, &yawState);
 
         magLastCorrectionTick = xTaskGetTickCount();
+        UpdateAdaptiveSampling(ADAPTIVE_SENSOR_MAG, fabsf(yawInnovation), errorVariance,
+                magLastCorrectionTick * portTICK_RATE_MS);
     }
         break;
     case BARO_IDX: {
@@ -385,9 +440,9 @@ static void PredictAttitudeState(KalmanFilterType* pEstimator,
  * @param 	pEstimator: Pointer to KalmanFilterType struct (roll pitch or yaw estimator)
  * @param 	stateAngle: Pointer to struct member of StateVectorType (roll, pitch or yaw)
  * @param 	stateRateBias: Pointer to struct member of StateVectorType (rollRateBias, pitchRateBias or yawRateBias)
- * @retval 	None
+ * @retval 	Innovation, i.e. difference between measured and a priori angle [rad]
  */
-static void CorrectAttitudeState(const float32_t sensorAngle, KalmanFilterType* pEstimator,
+static float32_t CorrectAttitudeState(const float32_t sensorAngle, KalmanFilterType* pEstimator,
 		AttitudeStateVectorType* pStateInternal, AttitudeStateVectorType* pState) {
     float32_t y1, s11, s12, s21, s22, InvDetS;
     float32_t p11_tmp, p12_tmp, p13_tmp, p21_tmp, p22_tmp, p23_tmp, p31_tmp, p32_tmp, p33_tmp;
@@ -436,6 +491,8 @@ static void CorrectAttitudeState(const float32_t sensorAngle, KalmanFilterType*
 
     /* Update real states (i.e. filter output) by copying internal state from correction */
     pState->angle = pStateInternal->angle;
+
+    return y1;
 }
 
 /*
@@ -501,6 +558,7 @@ static void CorrectAttitudeRateState(const float32_t sensorRate, KalmanFilterTyp
 //                 Debug printing functions
 ///////////////////////////////////////////////////////////////////////////////
 
+#if FCB_USE_PRINT_TASKS
 /**
  * @brief  Task code handles state (angle, rate, ratebias) print sampling
  * @param  argument : Unused parameter
@@ -511,6 +569,7 @@ static void StatePrintSamplingTask(void const *argument) {
 
     portTickType xLastWakeTime;
     portTickType xSampleStartTime;
+    uint32_t printCount = 0;
 
     /* Initialize the xLastWakeTime variable with the current time */
     xLastWakeTime = xTaskGetTickCount();
@@ -519,13 +578,15 @@ static void StatePrintSamplingTask(void const *argument) {
     for (;;) {
         vTaskDelayUntil(&xLastWakeTime, statePrintSampleTime);
 
-        PrintStateValues();
+        if (IsSlackWorkDue(SLACK_WORK_PRINT, printCount++))
+            PrintStateValues();
 
         /* If sampling duration exceeded, delete task to stop sampling */
         if (xTaskGetTickCount() >= xSampleStartTime + statePrintSampleDuration * configTICK_RATE_HZ)
             StopStateSamplingTask();
     }
 }
+#endif
 
 /*
  * @brief  Creates a task to print states over USB.
@@ -534,7 +595,7 @@ static void StatePrintSamplingTask(void const *argument) {
  * @retval MOTORCTRL_OK if thread started, else MOTORCTRL_ERROR.
  */
 FcbRetValType StartStateSamplingTask(const uint16_t sampleTime, const uint32_t sampleDuration) {
-
+#if FCB_USE_PRINT_TASKS
     // TODO do not start a new task if one is already running, just update sampleTime/sampleDuration
 
     if (sampleTime < STATE_PRINT_MINIMUM_SAMPLING_TIME) {
@@ -560,6 +621,11 @@ FcbRetValType StartStateSamplingTask(const uint16_t sampleTime, const uint32_t s
         return FCB_ERR;
     }
     return FCB_OK;
+#else
+    (void) sampleTime;
+    (void) sampleDuration;
+    return FCB_ERR;
+#endif
 }
 
 /*
@@ -17,6 +17,7 @@
 #include "usbd_cdc_if.h"
 #include "uart.h"
 #include "state_estimation.h"
+#include "irq_latch.h"
 
 #include "stm32f3_discovery.h"
 
@@ -53,14 +54,15 @@ void HAL_GPIO_EXTI_Callback(uint16_t GPIO_Pin) {
             UserButtonPressed = 0x0;
         }
         break;
+    /* Sensor DRDY interrupts are in the latch tier, the sensor messages are sent from the deferred handlers */
     case GPIO_GYRO_DRDY:
-        FcbSendSensorMessageFromISR(FCB_SENSOR_GYRO_DATA_READY);
+        LatchInterruptEvent(IRQ_EVENT_GYRO_DRDY, 0);
         break;
     case GPIO_ACCELEROMETER_DRDY:
-        FcbSendSensorMessageFromISR(FCB_SENSOR_ACC_DATA_READY);
+        LatchInterruptEvent(IRQ_EVENT_ACC_DRDY, 0);
         break;
     case GPIO_MAGNETOMETER_DRDY:
-        FcbSendSensorMessageFromISR(FCB_SENSOR_MAGNETO_DATA_READY);
+        LatchInterruptEvent(IRQ_EVENT_MAG_DRDY, 0);
         break;
     default:
         break;
@@ -113,11 +115,10 @@ void HAL_TIM_PeriodElapsedCallback(TIM_HandleTypeDef *htim) {
 		AuxReceiverTimerPeriodCountIncrement();
 	} else if (htim->Instance == TASK_STATUS_TIM){
 		IncreaseTaskStatusTimerPeriodCount();
-	} else if (htim->Instance == STATE_ESTIMATION_UPDATE_TIM){
-		SendPredictionUpdateToFlightControl();
-    }
+	}
 }
 
+#if defined(RECEIVER_LEGACY_CAPTURE)
 /**
  * @brief  Input Capture callback in non blocking mode
  * @param  htim : TIM IC handle
@@ -140,18 +141,7 @@ void HAL_TIM_IC_CaptureCallback(TIM_HandleTypeDef *htim) {
 			UpdateReceiverAux1Channel();
 	}
 }
-
-/**
-  * @brief  Tx Transfer completed callback
-  * @param  UartHandle: UART handle.
-  * @retval None
-  */
-void HAL_UART_TxCpltCallback(UART_HandleTypeDef *UartHandle)
-{
-    if(UartHandle->Instance == UART) {
-        HandleUartTxCallback(UartHandle);
-    }
-}
+#endif
 
 /**
   * @brief  Rx Transfer completed callback
@@ -57,6 +57,7 @@
 #include "uart.h"
 
 #include "task_status.h"
+#include "irq_priorities.h"
 
 /** @addtogroup STM32F3xx_HAL_Driver
  * @{
@@ -437,11 +438,11 @@ void HAL_UART_MspInit(UART_HandleTypeDef *huart)
 
   /*##-4- Configure the NVIC for DMA #########################################*/
   /* NVIC configuration for DMA transfer complete interrupt (USARTx_TX) */
-  HAL_NVIC_SetPriority(UART_DMA_TX_IRQn, configLIBRARY_MAX_SYSCALL_INTERRUPT_PRIORITY, 0);
+  HAL_NVIC_SetPriority(UART_DMA_TX_IRQn, IRQ_PRIO_UART_DMA, IRQ_SUB_PRIO);
   HAL_NVIC_EnableIRQ(UART_DMA_TX_IRQn);
 
   /* NVIC configuration for DMA transfer complete interrupt (USARTx_RX) */
-  HAL_NVIC_SetPriority(UART_DMA_RX_IRQn, configLIBRARY_MAX_SYSCALL_INTERRUPT_PRIORITY, 0);
+  HAL_NVIC_SetPriority(UART_DMA_RX_IRQn, IRQ_PRIO_UART_DMA, IRQ_SUB_PRIO);
   HAL_NVIC_EnableIRQ(UART_DMA_RX_IRQn);
 }
 
@@ -18,6 +18,7 @@
 #include "task_status.h"
 #include "receiver.h"
 #include "state_estimation.h"
+#include "irq_latch.h"
 #include "uart.h"
 
 /** @addtogroup STM32F3-Discovery_Demo STM32F3-Discovery_Demo
@@ -161,7 +162,7 @@ void PVD_IRQHandler(void) {
  * @retval None
  */
 void PRIMARY_RECEIVER_TIM_IRQHandler(void) {
-	HAL_TIM_IRQHandler(&PrimaryReceiverTimHandle);
+	HandlePrimaryReceiverIRQ();
 }
 
 /**
@@ -170,7 +171,7 @@ void PRIMARY_RECEIVER_TIM_IRQHandler(void) {
  * @retval None
  */
 void AUX_RECEIVER_TIM_IRQHandler(void) {
-	HAL_TIM_IRQHandler(&AuxReceiverTimHandle);
+	HandleAuxReceiverIRQ();
 }
 
 /**
@@ -188,9 +189,39 @@ void TASK_STATUS_TIM_IRQHandler(void) {
  * @retval None
  */
 void STATE_ESTIMATION_UPDATE_TIM_IRQHandler(void) {
-    HAL_TIM_IRQHandler(&StateEstimationTimHandle);
+    /* Latch tier, the prediction update is sent from the control deferred handler */
+    LatchControlTick();
 }
 
+/**
+ * @brief  This function handles the software triggered control deferred interrupt request.
+ * @param  None
+ * @retval None
+ */
+void CONTROL_DEFERRED_IRQHandler(void) {
+    HandleControlDeferredIRQ();
+}
+
+/**
+ * @brief  This function handles the software triggered sensor deferred interrupt request.
+ * @param  None
+ * @retval None
+ */
+void SENSOR_DEFERRED_IRQHandler(void) {
+    HandleSensorDeferredIRQ();
+}
+
+#if !defined(RECEIVER_LEGACY_CAPTURE)
+/**
+ * @brief  This function handles the software triggered receiver deferred interrupt request.
+ * @param  None
+ * @retval None
+ */
+void RECEIVER_DEFERRED_IRQHandler(void) {
+    HandleReceiverDeferredIRQ();
+}
+#endif
+
 /**
  * @brief  This function handles USB Handler.
  * @param  None
@@ -262,11 +293,11 @@ void UART_DMA_RX_IRQHandler(void)
   * @param  None
   * @retval None
   * @Note   This function is redefined in "uart.h" and related to DMA channel
-  *         used for UART data reception
+  *         used for UART data transmission
   */
 void UART_DMA_TX_IRQHandler(void)
 {
-  HAL_DMA_IRQHandler(UartHandle.hdmatx);
+  HandleUartTxDmaIRQ();
 }
 
 /**
@@ -0,0 +1,380 @@
+/******************************************************************************
+ * @brief   File contains the variable watch, a software oscilloscope for
+ *          firmware variables that does not require a rebuild.
+ *
+ *          The host resolves symbols in the ELF file (see tools/watch.py) and
+ *          adds a list of (address, type) tuples with the watch-add command.
+ *          Addresses are only accepted if the whole value lies in SRAM or CCM
+ *          RAM and is naturally aligned, so that reading it can neither fault
+ *          nor trigger read side effects in peripheral registers.
+ *
+ *          When the watch is started, WatchSampleHook() is called from the
+ *          flight control task after every control update. Every n:th call it
+ *          copies the watched values to a fixed size sample and posts it to a
+ *          queue without blocking. The cost in the control loop is thus
+ *          bounded by WATCH_MAX_VARIABLES loads plus one queue copy. If the
+ *          queue is full the sample is dropped and counted instead.
+ *
+ *          A low priority task frames the samples with the common message
+ *          header (msg id WATCH_SAMPLES_MSG_ENUM, CRC, size) and sends them
+ *          over USB. The payload is the 32-bit sample counter followed by the
+ *          raw little-endian values in the order they were added, each using
+ *          the size of its type. Gaps in the sample counter show dropped
+ *          samples.
+ *
+ * @license
+ * Dragonfly FCB firmware to control the Dragonfly quadrotor UAV
+ * Copyright (C) 2016  ÅF Technology South: Dragonfly Project
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA
+ *****************************************************************************/
+
+/* Includes ------------------------------------------------------------------*/
+#include "variable_watch.h"
+
+#include "communication.h"
+#include "common.h"
+#include "fcb_error.h"
+#include "usbd_cdc_if.h"
+#include "slack_monitor.h"
+
+#include "FreeRTOS.h"
+#include "task.h"
+#include "queue.h"
+
+#include <string.h>
+
+#if FCB_USE_VARIABLE_WATCH
+
+/* Private typedef -----------------------------------------------------------*/
+typedef struct {
+    uint32_t sampleCounter;
+    uint8_t values[WATCH_MAX_VARIABLES * WATCH_MAX_VALUE_SIZE];
+} WatchSample_TypeDef;
+
+/* Private define ------------------------------------------------------------*/
+#define WATCH_TX_TASK_PRIO              1
+#define WATCH_QUEUE_SIZE                8
+#define WATCH_QUEUE_TIMEOUT             100 // [ms]
+
+#define WATCH_MAX_PAYLOAD_SIZE          (sizeof(uint32_t) + WATCH_MAX_VARIABLES * WATCH_MAX_VALUE_SIZE)
+
+/* Private variables ---------------------------------------------------------*/
+static const uint8_t watchTypeSize[WATCH_TYPE_COUNT] = { 1, 1, 2, 2, 4, 4, 4 };
+static const char* const watchTypeName[WATCH_TYPE_COUNT] = { "u8", "i8", "u16", "i16", "u32", "i32", "f32" };
+
+static WatchVariable_TypeDef watchVariables[WATCH_MAX_VARIABLES];
+static uint8_t watchVariableCount = 0;
+static uint16_t watchSampleSize = 0;
+
+static volatile bool watchRunning = false;
+static volatile uint16_t watchLoopDivider = 1;
+static uint16_t watchLoopCounter = 0;
+static uint32_t watchSampleCounter = 0;
+static volatile uint32_t watchDropCount = 0;
+
+static xQueueHandle qWatchSamples = NULL;
+xTaskHandle WatchTxTaskHandle = NULL;
+
+/* Private function prototypes -----------------------------------------------*/
+static bool IsWatchAddressAllowed(const uint32_t address, const uint8_t size);
+static void WatchTxTask(void const *argument);
+
+/* Exported functions --------------------------------------------------------*/
+
+/*
+ * @brief  Adds a variable to the watch list. Not allowed while the watch is running.
+ * @param  address : RAM address of the variable
+ * @param  type : Type of the variable
+ * @retval FCB_OK if added, FCB_ERR if the list is full, the address is not allowed or the watch is running
+ */
+FcbRetValType AddWatchVariable(const uint32_t address, const WatchType_TypeDef type) {
+    if (watchRunning || WatchTxTaskHandle != NULL || type >= WATCH_TYPE_COUNT
+            || watchVariableCount >= WATCH_MAX_VARIABLES)
+        return FCB_ERR;
+
+    if (!IsWatchAddressAllowed(address, watchTypeSize[type]))
+        return FCB_ERR;
+
+    watchVariables[watchVariableCount].address = address;
+    watchVariables[watchVariableCount].type = type;
+    watchVariableCount++;
+    watchSampleSize += watchTypeSize[type];
+
+    return FCB_OK;
+}
+
+/*
+ * @brief  Clears the watch list. Not allowed while the watch is running.
+ * @param  None
+ * @retval FCB_OK if cleared, FCB_ERR if the watch is running
+ */
+FcbRetValType ClearWatchVariables(void) {
+    if (watchRunning || WatchTxTaskHandle != NULL)
+        return FCB_ERR;
+
+    watchVariableCount = 0;
+    watchSampleSize = 0;
+
+    return FCB_OK;
+}
+
+/*
+ * @brief  Returns the number of variables in the watch list
+ * @param  None
+ * @retval Number of watched variables
+ */
+uint8_t GetWatchVariableCount(void) {
+    return watchVariableCount;
+}
+
+/*
+ * @brief  Gets a variable in the watch list
+ * @param  index : Index in the watch list
+ * @param  variable : Destination of the watched variable
+ * @retval FCB_OK if index is valid, else FCB_ERR
+ */
+FcbRetValType GetWatchVariable(const uint8_t index, WatchVariable_TypeDef* variable) {
+    if (index >= watchVariableCount)
+        return FCB_ERR;
+
+    *variable = watchVariables[index];
+    return FCB_OK;
+}
+
+/*
+ * @brief  Parses a watch type name, e.g. "f32"
+ * @param  typeString : Type name, may be followed by other characters after a space
+ * @param  type : Destination of parsed type
+ * @retval FCB_OK if a type name matched, else FCB_ERR
+ */
+FcbRetValType ParseWatchType(const char* typeString, WatchType_TypeDef* type) {
+    uint8_t i;
+    size_t nameLength;
+
+    for (i = 0; i < WATCH_TYPE_COUNT; i++) {
+        nameLength = strlen(watchTypeName[i]);
+        if (strncmp(typeString, watchTypeName[i], nameLength) == 0
+                && (typeString[nameLength] == '\0' || typeString[nameLength] == ' ')) {
+            *type = (WatchType_TypeDef) i;
+            return FCB_OK;
+        }
+    }
+
+    return FCB_ERR;
+}
+
+/*
+ * @brief  Returns the name of a watch type
+ * @param  type : Watch type
+ * @retval Type name string
+ */
+const char* GetWatchTypeName(const WatchType_TypeDef type) {
+    if (type >= WATCH_TYPE_COUNT)
+        return "?";
+
+    return watchTypeName[type];
+}
+
+/*
+ * @brief  Starts sampling of the watched variables and the task that streams them over USB
+ * @param  loopDivider : A sample is taken every loopDivider:th flight control loop iteration
+ * @retval FCB_OK if started, FCB_ERR if already running or the watch list is empty
+ */
+FcbRetValType StartVariableWatch(const uint16_t loopDivider) {
+    if (watchRunning || WatchTxTaskHandle != NULL || watchVariableCount == 0)
+        return FCB_ERR;
+
+    /* The queue is kept between watch sessions to avoid heap fragmentation */
+    if (qWatchSamples == NULL) {
+        qWatchSamples = xQueueCreate(WATCH_QUEUE_SIZE, sizeof(WatchSample_TypeDef));
+        if (qWatchSamples == NULL) {
+            ErrorHandler();
+            return FCB_ERR;
+        }
+    }
+    xQueueReset(qWatchSamples);
+
+    watchLoopDivider = loopDivider > 0 ? loopDivider : 1;
+    watchLoopCounter = 0;
+    watchSampleCounter = 0;
+    watchDropCount = 0;
+    watchRunning = true;
+
+    /* Variable watch TX task creation
+     * Task function pointer: WatchTxTask
+     * Task name: WATCH_TX
+     * Stack depth: 2*configMINIMAL_STACK_SIZE
+     * Parameter: NULL
+     * Priority: WATCH_TX_TASK_PRIO (0 to configMAX_PRIORITIES-1 possible)
+     * Handle: WatchTxTaskHandle
+     **/
+    if (pdPASS
+            != xTaskCreate((pdTASK_CODE )WatchTxTask, (signed portCHAR*)"WATCH_TX", 2*configMINIMAL_STACK_SIZE, NULL,
+                    WATCH_TX_TASK_PRIO, &WatchTxTaskHandle)) {
+        watchRunning = false;
+        ErrorHandler();
+        return FCB_ERR;
+    }
+
+    return FCB_OK;
+}
+
+/*
+ * @brief  Stops sampling of the watched variables. The TX task deletes itself once it is idle, so that it is
+ *         never deleted while holding the USB mutex.
+ * @param  None
+ * @retval FCB_OK if the watch was running, else FCB_ERR
+ */
+FcbRetValType StopVariableWatch(void) {
+    if (!watchRunning)
+        return FCB_ERR;
+
+    watchRunning = false;
+    return FCB_OK;
+}
+
+/*
+ * @brief  Returns if the variable watch is running
+ * @param  None
+ * @retval true if running, else false
+ */
+bool IsVariableWatchRunning(void) {
+    return watchRunning;
+}
+
+/*
+ * @brief  Returns the number of samples dropped because the sample queue was full
+ * @param  None
+ * @retval Dropped samples since the watch was started
+ */
+uint32_t GetVariableWatchDropCount(void) {
+    return watchDropCount;
+}
+
+/*
+ * @brief  Samples the watched variables. Called from the flight control task after each control update.
+ * @param  None
+ * @retval None
+ */
+void WatchSampleHook(void) {
+    WatchSample_TypeDef sample;
+    uint8_t* dst = sample.values;
+    uint8_t i;
+
+    if (!watchRunning)
+        return;
+
+    if (++watchLoopCounter < watchLoopDivider)
+        return;
+    watchLoopCounter = 0;
+
+    /* Shed samples under CPU pressure, the host sees the gap in the sample counter */
+    sample.sampleCounter = watchSampleCounter++;
+    if (!IsSlackWorkDue(SLACK_WORK_TELEMETRY, sample.sampleCounter))
+        return;
+
+    /* Addresses are validated to be aligned, so each value is read with a single access */
+    for (i = 0; i < watchVariableCount; i++) {
+        switch (watchTypeSize[watchVariables[i].type]) {
+        case 1:
+            *dst = *(volatile uint8_t*) (uintptr_t) watchVariables[i].address;
+            break;
+        case 2:
+        {
+            const uint16_t value = *(volatile uint16_t*) (uintptr_t) watchVariables[i].address;
+            memcpy(dst, &value, sizeof(value));
+            break;
+        }
+        default:
+        {
+            const uint32_t value = *(volatile uint32_t*) (uintptr_t) watchVariables[i].address;
+            memcpy(dst, &value, sizeof(value));
+            break;
+        }
+        }
+        dst += watchTypeSize[watchVariables[i].type];
+    }
+
+    if (pdTRUE != xQueueSend(qWatchSamples, &sample, 0)) {
+        watchDropCount++;
+    }
+}
+
+/* Private functions ---------------------------------------------------------*/
+
+/*
+ * @brief  Checks that a value lies entirely in SRAM or CCM RAM and is naturally aligned
+ * @param  address : Start address of the value
+ * @param  size : Size of the value [bytes]
+ * @retval true if the address may be watched, else false
+ */
+static bool IsWatchAddressAllowed(const uint32_t address, const uint8_t size) {
+    if (address & (size - 1))
+        return false;
+
+    if (address >= WATCH_SRAM_START && address - WATCH_SRAM_START <= WATCH_SRAM_SIZE - size)
+        return true;
+
+    if (address >= WATCH_CCM_START && address - WATCH_CCM_START <= WATCH_CCM_SIZE - size)
+        return true;
+
+    return false;
+}
+
+/**
+ * @brief  Task code that frames watch samples and sends them over USB
+ * @param  argument : Unused parameter
+ * @retval None
+ */
+static void WatchTxTask(void const *argument) {
+    (void) argument;
+
+    static uint8_t txBuffer[PROTO_HEADER_LEN + WATCH_MAX_PAYLOAD_SIZE + 2];
+    WatchSample_TypeDef sample;
+    const uint16_t payloadSize = sizeof(sample.sampleCounter) + watchSampleSize;
+    const uint8_t msgId = WATCH_SAMPLES_MSG_ENUM;
+    uint32_t crc;
+
+    for (;;) {
+        if (pdTRUE == xQueueReceive(qWatchSamples, &sample, WATCH_QUEUE_TIMEOUT)) {
+            memcpy(&txBuffer[PROTO_HEADER_LEN], &sample.sampleCounter, sizeof(sample.sampleCounter));
+            memcpy(&txBuffer[PROTO_HEADER_LEN + sizeof(sample.sampleCounter)], sample.values, watchSampleSize);
+
+            crc = CalculateCRC(&txBuffer[PROTO_HEADER_LEN], payloadSize);
+            memcpy(txBuffer, &msgId, 1);
+            memcpy(&txBuffer[1], &crc, 4);
+            memcpy(&txBuffer[5], &payloadSize, 2);
+            memcpy(&txBuffer[PROTO_HEADER_LEN + payloadSize], "\r\n", strlen("\r\n"));
+
+            USBComSendData(txBuffer, PROTO_HEADER_LEN + payloadSize + strlen("\r\n"));
+        } else if (!watchRunning) {
+            /* Watch stopped and all queued samples sent */
+            WatchTxTaskHandle = NULL;
+            vTaskDelete(NULL);
+        }
+    }
+}
+
+#endif /* FCB_USE_VARIABLE_WATCH */
+
+/**
+ * @}
+ */
+
+/**
+ * @}
+ */
+/*****END OF FILE****/
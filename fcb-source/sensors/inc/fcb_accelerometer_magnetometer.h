@@ -15,6 +15,7 @@
 
 #include "arm_math.h"
 #include <stdint.h>
+#include <stdbool.h>
 
 /**
  * The Data Ready input from the magnetometer.
@@ -62,6 +63,13 @@ uint8_t SensorRegisterAccClientCallback(SendCorrectionUpdateCallback_TypeDef cbk
 void FetchDataFromAccelerometer(void);
 
 
+/**
+ * Publishes injected calibrated accelerations [m/s2] along FCB axes
+ * instead of sensor data, see sensor_injection.h. Ignored while calibrating.
+ */
+void InjectAccelerometerData(float32_t *xyzDotDot);
+
+
 /**
  * When this function has been called, GetAcceleration and GetMagVector
  * will return uncalibrated values until the CPU has rebooted or
@@ -76,6 +84,33 @@ void FetchDataFromAccelerometer(void);
 void StartAccMagMtrCalibration(uint32_t samples);
 
 
+/**
+ * Returns true while the magnetometer or accelerometer calibration
+ * started with StartAccMagMtrCalibration is collecting samples.
+ */
+bool IsAccMagMtrCalibrating(void);
+
+
+/**
+ * Replaces the accelerometer and magnetometer calibration parameters
+ * (see FcbSensorCalibrationParmIndex) with e.g. values from an imported
+ * settings snapshot. NULL keeps the current parameters of that sensor.
+ * The caller stores the parameters in flash.
+ *
+ * @retval FCB_OK, FCB_ERR while calibrating or if a scaling is invalid
+ */
+uint8_t SetAccMagMtrCalibrationParams(const float32_t* accCalPrms, const float32_t* magCalPrms);
+
+
+/**
+ * Checks accelerometer or magnetometer calibration parameters
+ * (see FcbSensorCalibrationParmIndex).
+ *
+ * @retval FCB_OK if the scalings are valid, FCB_ERR otherwise
+ */
+uint8_t CheckCalParams(const float32_t* calPrms);
+
+
 /*
  * get the current calibrated reading from the accelerometer.
  *
@@ -104,6 +139,13 @@ void GetAccelerationNoMutex(float32_t * xDotDot, float32_t * yDotDot, float32_t
 void FetchDataFromMagnetometer(void);
 
 
+/**
+ * Publishes an injected calibrated magnetic vector along FCB axes
+ * instead of sensor data, see sensor_injection.h. Ignored while calibrating.
+ */
+void InjectMagnetometerData(float32_t *xyzMagVector);
+
+
 /*
  * get the current reading from the magnetometer.
  *
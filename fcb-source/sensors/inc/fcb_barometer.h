@@ -16,6 +16,7 @@ uint8_t FcbInitialiseBarometer(void);
 uint8_t SensorRegisterBaroClientCallback(SendCorrectionUpdateCallback_TypeDef cbk);
 
 void FetchDataFromBarometer(void);
+void InjectBarometerPressure(int32_t pressure);
 void GetAltitude(float32_t * alt);
 
 #endif /* INC_FCB_BAROMETER_H_ */
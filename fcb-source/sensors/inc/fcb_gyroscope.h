@@ -10,6 +10,8 @@
 #include "stm32f3_discovery.h"
 #include "arm_math.h"
 #include "fcb_sensors.h"
+#include "loop_rate.h"
+#include "l3gd20.h"
 
 
 /**
@@ -28,6 +30,16 @@ extern const float32_t GYRO_AXIS_VARIANCE_ROUGH;
  */
 #define GPIO_GYRO_DRDY GPIO_PIN_1
 
+/**
+ * Gyroscope output data rate of the loop rate profile. The high rate
+ * profiles use the highest data rate of the L3GD20.
+ */
+#if LOOP_RATE_HZ > LOOP_REFERENCE_RATE_HZ
+#define GYRO_OUTPUT_DATARATE L3GD20_OUTPUT_DATARATE_4 /* 760 Hz */
+#else
+#define GYRO_OUTPUT_DATARATE L3GD20_OUTPUT_DATARATE_3 /* 380 Hz */
+#endif
+
 
 /**
  * Initialises gyroscope.
@@ -45,6 +57,12 @@ uint8_t SensorRegisterGyroClientCallback(SendCorrectionUpdateCallback_TypeDef cb
  */
 void FetchDataFromGyroscope(void);
 
+/**
+ * Publishes injected angular rates [rad/s] along FCB axes instead of
+ * sensor data, see sensor_injection.h.
+ */
+void InjectGyroscopeData(float32_t * xyzAngleDot);
+
 /*
  * get the current reading from the gyroscope.
  *
@@ -59,7 +59,8 @@ typedef enum FcbSensorEvent {
     FCB_SENSOR_GYRO_DATA_READY = 0x0A,
     FCB_SENSOR_ACC_DATA_READY = 0x1A,
     FCB_SENSOR_MAGNETO_DATA_READY = 0x2A,
-	FCB_SENSOR_BAR_DATA_READY = 0x3A
+	FCB_SENSOR_BAR_DATA_READY = 0x3A,
+    FCB_SENSOR_INJECTION_DATA_READY = 0x4A /* injected sensor frames queued, see sensor_injection.h */
 } FcbSensorEventType;
 
 /**
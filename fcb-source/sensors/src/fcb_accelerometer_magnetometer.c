@@ -18,12 +18,16 @@
 #include "fcb_sensor_calibration.h"
 #include "sphere_calibration.h"
 #include "fcb_sensors.h"
+#include "sensor_injection.h"
 #include "fcb_error.h"
+#include "irq_priorities.h"
 #include "lsm303dlhc.h"
 #include "usbd_cdc_if.h"
 #include "arm_math.h"
 #include "trace.h"
 #include "flash.h"
+#include "slack_monitor.h"
+#include "adaptive_sampling.h"
 
 #include "FreeRTOS.h"
 #include "FreeRTOSConfig.h"
@@ -71,14 +75,18 @@ static float32_t sXYZAccCalPrm[CALIB_IDX_MAX] = { 0.0, 0.0, 0.0, 1.0, 1.0, 1.0 }
 
 static enum FcbAccMagMode accMagMode = ACCMAGMTR_UNINITIALISED;
 
+/* Accelerometer calibration samples taken, the sphere fit waits for slack. Reset when a calibration is started. */
+static bool accSamplingDone = false;
+
 /* static fcn declarations */
 
 static SendCorrectionUpdateCallback_TypeDef SendCorrectionUpdateCallback = NULL;
 static void setXYZVector(float32_t *srcVector, float32_t *dstVector);
+static void updateAccDataRate(void);
+static void updateMagDataRate(void);
 void adjustAxesOrientation(float32_t *xyzValues);
 static void applayCalibrationPrmToRawData(float32_t *calPrmVector, float32_t *xyzValues);
 bool handleAccSampling(float32_t *acceleroMeterData);
-uint8_t CheckCalParams(float32_t* magCalPrms);
 
 /* public fcn definitions */
 
@@ -110,12 +118,11 @@ uint8_t FcbInitialiseAccMagSensor(void) {
     FcbSensorsInitGpioPinForInterrupt(GPIOE, GPIO_PIN_2);
 
     /* set up interrupt DRDY for accelerometer - see HAL_GPIO_EXTI_Callback fcn */
-    HAL_NVIC_SetPriority(EXTI4_IRQn, configLIBRARY_MAX_SYSCALL_INTERRUPT_PRIORITY, 0);
+    HAL_NVIC_SetPriority(EXTI4_IRQn, IRQ_PRIO_ACCMAG_DRDY_LATCH, IRQ_SUB_PRIO);
     HAL_NVIC_EnableIRQ(EXTI4_IRQn);
 
     /* set up interrupt DRDY for magnetometer - see HAL_GPIO_EXTI_Callback fcn */
-    HAL_NVIC_SetPriority(EXTI2_TSC_IRQn,
-            configLIBRARY_MAX_SYSCALL_INTERRUPT_PRIORITY, 0);
+    HAL_NVIC_SetPriority(EXTI2_TSC_IRQn, IRQ_PRIO_ACCMAG_DRDY_LATCH, IRQ_SUB_PRIO);
     HAL_NVIC_EnableIRQ(EXTI2_TSC_IRQn);
 
     /* ISSUE1_TODO - fetch accelerometer calib from flash */
@@ -174,6 +181,30 @@ void setXYZVector(float32_t *srcVector, float32_t *dstVector) {
     }
 }
 
+/**
+ * Applies the sampling rate requested by the adaptive sampling as the
+ * accelerometer output data rate. Calibration samples at the highest rate.
+ */
+static void updateAccDataRate(void) {
+    const uint16_t rateHz = IsAccMagMtrCalibrating() ? GetAdaptiveMaxSampleRateHz(ADAPTIVE_SENSOR_ACC)
+            : GetAdaptiveSampleRateHz(ADAPTIVE_SENSOR_ACC);
+
+    /* No rate is requested before the state estimation has started */
+    if (rateHz != 0 && rateHz != LSM303DLHC_AccDataRateHz())
+        LSM303DLHC_AccSetDataRateHz(rateHz);
+}
+
+/**
+ * As updateAccDataRate, for the magnetometer
+ */
+static void updateMagDataRate(void) {
+    const uint16_t rateHz = IsAccMagMtrCalibrating() ? GetAdaptiveMaxSampleRateHz(ADAPTIVE_SENSOR_MAG)
+            : GetAdaptiveSampleRateHz(ADAPTIVE_SENSOR_MAG);
+
+    if (rateHz != 0 && rateHz != (uint16_t) LSM303DLHC_MagDataRateHz())
+        LSM303DLHC_MagSetDataRateHz(rateHz);
+}
+
 void adjustAxesOrientation(float32_t *xyzValues) {
     /* adjust sensor axes to the axes of the quadcopter fuselage
      * see "Sensors" page in Wiki.
@@ -253,9 +284,11 @@ void FetchDataFromAccelerometer(void) {
             FcbSendSensorMessage(FCB_SENSOR_ACC_DATA_READY);
             return;
         }
+        updateAccDataRate();
     }
 
-    if (ACCMAGMTR_FETCHING == accMagMode) {
+    /* injected values replace the sensor values, the read above re-arms DRDY */
+    if (ACCMAGMTR_FETCHING == accMagMode && !IsSensorInjectionActive()) {
         adjustAxesOrientation(acceleroMeterData);
         applayCalibrationPrmToRawData(sXYZAccCalPrm, acceleroMeterData);
         setXYZVector(acceleroMeterData, sXYZDotDot);
@@ -264,7 +297,12 @@ void FetchDataFromAccelerometer(void) {
             SendCorrectionUpdateCallback(ACC_IDX, sXYZDotDot);
         }
     } else if (ACCMTR_CALIBRATING == accMagMode) {
-        if (handleAccSampling(acceleroMeterData)) {
+        if (!accSamplingDone)
+            accSamplingDone = handleAccSampling(acceleroMeterData);
+
+        /* Sphere fit and flash write are deferred while the control loop is short of headroom */
+        if (accSamplingDone && IsSlackWorkDue(SLACK_WORK_CALIBRATION, 0)) {
+            accSamplingDone = false;
             calibrate(sXYZAccCalPrm);
             WriteAccCalibrationValuesToFlash(sXYZAccCalPrm);
 
@@ -281,11 +319,48 @@ void FetchDataFromAccelerometer(void) {
     }
 }
 
+void InjectAccelerometerData(float32_t *xyzDotDot) {
+    if (ACCMAGMTR_FETCHING == accMagMode) {
+        setXYZVector(xyzDotDot, sXYZDotDot);
+
+        if (SendCorrectionUpdateCallback != NULL) {
+            SendCorrectionUpdateCallback(ACC_IDX, sXYZDotDot);
+        }
+    }
+}
+
 void StartAccMagMtrCalibration(uint32_t samples) {
     nbrOfSamplesForCalibration = samples;
+    accSamplingDone = false;
     accMagMode = MAGMTR_CALIBRATING;
 }
 
+bool IsAccMagMtrCalibrating(void) {
+    return (MAGMTR_CALIBRATING == accMagMode) || (ACCMTR_CALIBRATING == accMagMode);
+}
+
+uint8_t SetAccMagMtrCalibrationParams(const float32_t* accCalPrms, const float32_t* magCalPrms) {
+    if (IsAccMagMtrCalibrating()) {
+        return FCB_ERR;
+    }
+    if ((accCalPrms != NULL && CheckCalParams(accCalPrms) != FCB_OK)
+            || (magCalPrms != NULL && CheckCalParams(magCalPrms) != FCB_OK)) {
+        return FCB_ERR;
+    }
+
+    /* The sensors task applies the parameters to every fetched sample */
+    taskENTER_CRITICAL();
+    if (accCalPrms != NULL) {
+        memcpy(sXYZAccCalPrm, accCalPrms, sizeof(sXYZAccCalPrm));
+    }
+    if (magCalPrms != NULL) {
+        memcpy(sXYZMagCalPrm, magCalPrms, sizeof(sXYZMagCalPrm));
+    }
+    taskEXIT_CRITICAL();
+
+    return FCB_OK;
+}
+
 void FetchDataFromMagnetometer(void) {
     HAL_StatusTypeDef status = HAL_OK;
     float32_t magnetoMeterData[3] = { 0.0f, 0.0f, 0.0f };
@@ -299,9 +374,11 @@ void FetchDataFromMagnetometer(void) {
             FcbSendSensorMessage(FCB_SENSOR_MAGNETO_DATA_READY);
             return;
         }
+        updateMagDataRate();
     }
 
-    if (ACCMAGMTR_FETCHING == accMagMode) {
+    /* injected values replace the sensor values, the read above re-arms DRDY */
+    if (ACCMAGMTR_FETCHING == accMagMode && !IsSensorInjectionActive()) {
         adjustAxesOrientation(magnetoMeterData);
         applayCalibrationPrmToRawData(sXYZMagCalPrm, magnetoMeterData);
         setXYZVector(magnetoMeterData, sXYZMagVector);
@@ -315,7 +392,7 @@ void FetchDataFromMagnetometer(void) {
             adjustAxesOrientation(magnetoMeterData);
             addNewSample(magnetoMeterData);
             sampleIndex++;
-        } else {
+        } else if (IsSlackWorkDue(SLACK_WORK_CALIBRATION, 0)) {
             calibrate(sXYZMagCalPrm);
 
             WriteMagCalibrationValuesToFlash(sXYZMagCalPrm);
@@ -335,6 +412,16 @@ void FetchDataFromMagnetometer(void) {
     }
 }
 
+void InjectMagnetometerData(float32_t *xyzMagVector) {
+    if (ACCMAGMTR_FETCHING == accMagMode) {
+        setXYZVector(xyzMagVector, sXYZMagVector);
+
+        if (SendCorrectionUpdateCallback != NULL) {
+            SendCorrectionUpdateCallback(MAG_IDX, sXYZMagVector);
+        }
+    }
+}
+
 void GetAcceleration(float32_t * xDotDot, float32_t * yDotDot, float32_t * zDotDot) {
     if (pdTRUE != xSemaphoreTake(mutexAcc, portMAX_DELAY /* wait forever */)) {
         ErrorHandler();
@@ -390,7 +477,7 @@ void PrintAccelerometerValues(void) {
     USBComSendString(sampleString);
 }
 
-uint8_t CheckCalParams(float32_t* calPrms) {
+uint8_t CheckCalParams(const float32_t* calPrms) {
     uint8_t status = FCB_OK;
 
     if (calPrms[X_SCALING_CALIB_IDX] < 0.1) {
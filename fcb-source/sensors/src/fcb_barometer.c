@@ -12,10 +12,12 @@
 #include "fcb_barometer.h"
 #include "bmp180.h"
 #include "fcb_sensors.h"
+#include "sensor_injection.h"
 #include "fcb_error.h"
 
 #include "fcb_retval.h"
 #include "arm_math.h"
+#include "math_tables.h"
 
 #include "FreeRTOS.h"
 #include "semphr.h"
@@ -51,6 +53,7 @@ static float32_t sAltitude;
 
 static void InitBarometerTimeEvent(void);
 static float32_t CalcAltitudeFromPressure(int32_t pressure);
+static void publishPressure(int32_t pressure);
 
 /* Exported functions --------------------------------------------------------*/
 
@@ -74,14 +77,12 @@ void FetchDataFromBarometer(void) {
     if (currentMeasurementType == PRESSURE_MEASUREMENT) {
         int32_t pressureData = 0;
         BMP180_ReadPressureValue(&pressureData);
-        float32_t newAltitude = CalcAltitudeFromPressure(pressureData);
 
-        if (SendCorrectionUpdateCallback != NULL) {
-            SendCorrectionUpdateCallback(BARO_IDX, &newAltitude);
+        // Injected pressure replaces the measured one, the measurement cycle keeps running.
+        if (!IsSensorInjectionActive()) {
+            publishPressure(pressureData);
         }
 
-        sAltitude = newAltitude;
-
         // Start a new temperature measurement.
 		currentMeasurementType = TEMPERATURE_MEASUREMENT;
         BMP180_StartTemperatureMeasure();
@@ -94,6 +95,10 @@ void FetchDataFromBarometer(void) {
 	}
 }
 
+void InjectBarometerPressure(int32_t pressure) {
+    publishPressure(pressure);
+}
+
 uint8_t SensorRegisterBaroClientCallback(SendCorrectionUpdateCallback_TypeDef cbk) {
     if (NULL != SendCorrectionUpdateCallback) {
         return FCB_ERR;
@@ -127,9 +132,17 @@ static void InitBarometerTimeEvent(void) {
     }
 }
 
-static float32_t CalcAltitudeFromPressure(int32_t pressure) {
-	float32_t tmp = powf((float32_t)pressure / 101325.0f, 1.0f/5.255f);
-	float32_t altitude = 44330.0f * ( 1.0f - tmp);
+static void publishPressure(int32_t pressure) {
+    float32_t newAltitude = CalcAltitudeFromPressure(pressure);
 
-	return altitude;
+    if (SendCorrectionUpdateCallback != NULL) {
+        SendCorrectionUpdateCallback(BARO_IDX, &newAltitude);
+    }
+
+    sAltitude = newAltitude;
+}
+
+static float32_t CalcAltitudeFromPressure(int32_t pressure) {
+	/* 44330*(1-(p/101325)^(1/5.255)) by table lookup instead of powf */
+	return PressureToAltitude(pressure);
 }
@@ -9,10 +9,12 @@
 /* Includes ------------------------------------------------------------------*/
 #include "fcb_gyroscope.h"
 #include "fcb_sensors.h"
+#include "sensor_injection.h"
 #include "l3gd20.h"
 
 
 #include "fcb_error.h"
+#include "irq_priorities.h"
 #include "FreeRTOS.h"
 #include "semphr.h"
 #include "usbd_cdc_if.h"
@@ -53,6 +55,7 @@ static float32_t sGyroXYZAngleDot[3] = { 0.0, 0.0, 0.0 }; /* not volatile - only
 static xSemaphoreHandle mutexGyro;
 
 /* Private function prototypes -----------------------------------------------*/
+static void publishGyroscopeData(float32_t * xyzAngleDot);
 
 /* Exported functions --------------------------------------------------------*/
 
@@ -74,11 +77,11 @@ uint8_t InitialiseGyroscope(void) {
     GPIO_InitStructure.Speed = GPIO_SPEED_HIGH;
     HAL_GPIO_Init(GYRO_INT_GPIO_PORT, &GPIO_InitStructure);
 
-    HAL_NVIC_SetPriority(EXTI1_IRQn, configLIBRARY_MAX_SYSCALL_INTERRUPT_PRIORITY, 0);
+    HAL_NVIC_SetPriority(EXTI1_IRQn, IRQ_PRIO_GYRO_DRDY_LATCH, IRQ_SUB_PRIO);
     HAL_NVIC_EnableIRQ(EXTI1_IRQn);
 
     /* sets full scale (and sensitivity) plus data rate of L3GD20 gyroscope */
-    if(L3GD20_Config() != 0)
+    if(L3GD20_Config(GYRO_OUTPUT_DATARATE) != 0)
     {
         /* Initialization Error */
         ErrorHandler();
@@ -122,14 +125,27 @@ void FetchDataFromGyroscope(void) {
     lGyroXYZAngleDot[YDOT_IDX] = -gyroscopeData[XDOT_IDX];
     lGyroXYZAngleDot[ZDOT_IDX] = -gyroscopeData[ZDOT_IDX];
 
+    /* the read above re-arms DRDY, but injected values replace the sensor values */
+    if (IsSensorInjectionActive()) {
+        return;
+    }
+
+    publishGyroscopeData(lGyroXYZAngleDot);
+}
+
+void InjectGyroscopeData(float32_t * xyzAngleDot) {
+    publishGyroscopeData(xyzAngleDot);
+}
+
+static void publishGyroscopeData(float32_t * xyzAngleDot) {
     if (pdTRUE != xSemaphoreTake(mutexGyro,  portMAX_DELAY /* wait forever */)) {
         ErrorHandler();
         return;
     }
 
-    sGyroXYZAngleDot[XDOT_IDX] = lGyroXYZAngleDot[XDOT_IDX];
-    sGyroXYZAngleDot[YDOT_IDX] = lGyroXYZAngleDot[YDOT_IDX];
-    sGyroXYZAngleDot[ZDOT_IDX] = lGyroXYZAngleDot[ZDOT_IDX];
+    sGyroXYZAngleDot[XDOT_IDX] = xyzAngleDot[XDOT_IDX];
+    sGyroXYZAngleDot[YDOT_IDX] = xyzAngleDot[YDOT_IDX];
+    sGyroXYZAngleDot[ZDOT_IDX] = xyzAngleDot[ZDOT_IDX];
 
     if (pdTRUE != xSemaphoreGive(mutexGyro)) {
         ErrorHandler();
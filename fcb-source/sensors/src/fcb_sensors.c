@@ -10,8 +10,11 @@
 #include "fcb_accelerometer_magnetometer.h"
 #include "fcb_gyroscope.h"
 #include "fcb_barometer.h"
+#include "sensor_injection.h"
 #include "fcb_error.h"
 #include "fcb_retval.h"
+#include "build_profile.h"
+#include "slack_monitor.h"
 #include "dragonfly_fcb.pb.h"
 #include "pb_encode.h"
 #include "usbd_cdc_if.h"
@@ -72,15 +75,19 @@ static FcbSensorDataRateCalcType sensorDrdyCalc[FCB_SENSOR_NBR] = { { 0} };
 
 /* Task handle for printing of sensor values task */
 xTaskHandle SensorPrintSamplingTaskHandle = NULL;
+#if FCB_USE_PRINT_TASKS
 static volatile uint16_t sensorPrintSampleTime;
 static volatile uint16_t sensorPrintSampleDuration;
+#endif
 
 /* Private function prototypes -----------------------------------------------*/
 static void _ProcessSensorValues(void*);
 static void _FetchSensorAtTimeout(uint8_t event);
 
 static void _DebugFlashLEDs(uint8_t event);
+#if FCB_USE_PRINT_TASKS
 static void _SensorPrintSamplingTask(void const *argument);
+#endif
 
 /* Exported functions --------------------------------------------------------*/
 
@@ -287,6 +294,9 @@ static void _ProcessSensorValues(void* val __attribute__ ((unused))) {
         	FetchDataFromBarometer();
 #endif
         	break;
+        case FCB_SENSOR_INJECTION_DATA_READY:
+            ProcessInjectedSensorFrames();
+            break;
         }
 
         /* Check for sensor data ready read timeouts */
@@ -331,6 +341,7 @@ static void _DebugFlashLEDs(uint8_t event) {
  * @retval FCB_OK if thread started, else FCB_ERR
  */
 FcbRetValType StartSensorSamplingTask(const uint16_t sampleTime, const uint32_t sampleDuration) {
+#if FCB_USE_PRINT_TASKS
   if(sampleTime < SENSOR_PRINT_MINIMUM_SAMPLING_TIME)
     sensorPrintSampleTime = SENSOR_PRINT_MINIMUM_SAMPLING_TIME;
   else
@@ -353,6 +364,11 @@ FcbRetValType StartSensorSamplingTask(const uint16_t sampleTime, const uint32_t
   }
 
   return FCB_OK;
+#else
+  (void) sampleTime;
+  (void) sampleDuration;
+  return FCB_ERR;
+#endif
 }
 
 /*
@@ -389,6 +405,7 @@ void PrintSensorValues(void) {
   USBComSendString(sensorString);
 }
 
+#if FCB_USE_PRINT_TASKS
 /**
  * @brief  Task code handles sensor print sampling
  * @param  argument : Unused parameter
@@ -399,6 +416,7 @@ static void _SensorPrintSamplingTask(void const *argument) {
 
   portTickType xLastWakeTime;
   portTickType xSampleStartTime;
+  uint32_t printCount = 0;
 
   /* Initialise the xLastWakeTime variable with the current time */
   xLastWakeTime = xTaskGetTickCount();
@@ -407,13 +425,15 @@ static void _SensorPrintSamplingTask(void const *argument) {
   for (;;) {
     vTaskDelayUntil(&xLastWakeTime, sensorPrintSampleTime);
 
-    PrintSensorValues();
+    if (IsSlackWorkDue(SLACK_WORK_PRINT, printCount++))
+      PrintSensorValues();
 
     /* If sampling duration exceeded, delete task to stop sampling */
     if (xTaskGetTickCount() >= xSampleStartTime + sensorPrintSampleDuration * configTICK_RATE_HZ)
       StopSensorSamplingTask();
   }
 }
+#endif
 
 /**
  * @}
@@ -0,0 +1,732 @@
+/******************************************************************************
+ * @brief   Host benchmark of the flight control kernels (rotation
+ *          transformations, state estimation, PID control, vector math,
+ *          sin/cos and altitude tables, FIFO buffers, motor allocation and
+ *          sphere calibration).
+ *
+ *          The kernels are built unchanged from the firmware sources with the
+ *          host compiler, so the numbers are host nanoseconds and host
+ *          instructions and not Cortex-M4 cycles. They are meant for comparing
+ *          kernel variants on a workstation and for catching regressions
+ *          before running the kernel-benchmark CLI command on target (see
+ *          kernel_benchmark.c). The table mirrors the target benchmark: each
+ *          kernel is run in batches, the fastest batch is reported together
+ *          with the mean over all batches, and the loop overhead measured with
+ *          an empty kernel is subtracted.
+ *
+ *          The executed user space instructions per operation are counted with
+ *          the perf_event hardware counter. Where the counter is not available
+ *          (virtual machines, perf_event_paranoid), the column shows "-".
+ *          Instruction counts do not depend on the machine load, so they are
+ *          the better regression check where they are available.
+ *
+ *          The estimator and PID kernels change the state they operate on, so
+ *          that state is restored before each batch with the same context
+ *          functions as on target.
+ *
+ *          Usage: kernel_benchmark_host [batches] [--baseline FILE]
+ *                                       [--compare FILE [--max-regression PERCENT]]
+ *
+ *          batches             Batches per kernel, default 200
+ *          --baseline FILE     Stores the results as baseline in FILE
+ *          --compare FILE      Compares the results with the baseline in FILE
+ *          --max-regression    Fails if a kernel is slower than its baseline
+ *                              by more than PERCENT, in instructions if both
+ *                              runs counted them, else in min ns/op
+ *
+ * @license
+ * Dragonfly FCB firmware to control the Dragonfly quadrotor UAV
+ * Copyright (C) 2016  ÅF Technology South: Dragonfly Project
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA
+ *****************************************************************************/
+
+/* Includes ------------------------------------------------------------------*/
+#include "rotation_transformation.h"
+#include "state_estimation.h"
+#include "pid_control.h"
+#include "flight_control.h"
+#include "vector_math.h"
+#include "math_tables.h"
+#include "fifo_buffer.h"
+#include "motor_control.h"
+#include "sphere_calibration.h"
+#include "fcb_sensors.h"
+#include "fcb_accelerometer_magnetometer.h"
+
+#include "FreeRTOS.h"
+#include "task.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+
+/* Private typedef -----------------------------------------------------------*/
+typedef struct {
+    const char* name;
+    void (*setup)(void);    // Called before each batch, not timed (may be NULL)
+    void (*kernel)(void);   // The kernel operation to time
+    uint16_t opsPerBatch;
+} HostBenchmark_TypeDef;
+
+typedef struct {
+    uint64_t ns;
+    uint64_t instructions;  // Executed user space instructions, 0 if not counted
+} HostBatchResult_TypeDef;
+
+typedef struct {
+    double minNs;           // Fastest batch [ns/op]
+    double meanNs;          // Mean over all batches [ns/op]
+    double instructions;    // Fewest instructions of all batches [instructions/op], negative if not counted
+} HostBenchmarkResult_TypeDef;
+
+/* Private define ------------------------------------------------------------*/
+#define HOST_BENCHMARK_DEFAULT_BATCHES  200
+#define HOST_BENCHMARK_SPHERE_SAMPLES   48
+#define HOST_BENCHMARK_FIFO_SIZE        128
+#define HOST_BENCHMARK_FIFO_CHUNK_SIZE  32
+#define HOST_BENCHMARK_MAX_NAME_SIZE    64
+
+/* Private function prototypes -----------------------------------------------*/
+static void InitBenchmarkInputs(void);
+static void InitInstructionCounter(void);
+static void MeasureBatch(const HostBenchmark_TypeDef* benchmark, HostBatchResult_TypeDef* batch);
+static void RunBenchmark(const HostBenchmark_TypeDef* benchmark, const long batches,
+        const HostBatchResult_TypeDef* overhead, const uint16_t overheadOps, HostBenchmarkResult_TypeDef* result);
+static bool WriteBaseline(const char* path, const HostBenchmarkResult_TypeDef* results);
+static bool CompareBaseline(const char* path, const HostBenchmarkResult_TypeDef* results, const double maxRegression);
+static uint64_t GetTimeNs(void);
+
+static void EmptyKernel(void);
+static void UpdateRotationMatrixKernel(void);
+static void UpdateAngularRotationMatrixKernel(void);
+static void GetEulerAngularRatesKernel(void);
+static void GetAttitudeFromAccelerometerKernel(void);
+static void GetMagYawAngleKernel(void);
+static void Vector3DNormalizeKernel(void);
+static void Vec3NormalizeKernel(void);
+static void Vec3CrossKernel(void);
+static void Mat3MultVec3Kernel(void);
+static void Mat3MultKernel(void);
+static void QuatMultKernel(void);
+static void QuatNormalizeKernel(void);
+static void QuatRotateVec3Kernel(void);
+static void QuatToMat3Kernel(void);
+static void LibmSinCosKernel(void);
+static void FastSinCosKernel(void);
+static void LibmPressureToAltitudeKernel(void);
+static void PressureToAltitudeKernel(void);
+static void FlightStateSetup(void);
+static void UpdatePredictionStateKernel(void);
+static void GyroCorrectionKernel(void);
+static void AccCorrectionKernel(void);
+static void MagCorrectionKernel(void);
+static void UpdatePIDControlSignalsKernel(void);
+static void FlightControlStepKernel(void);
+static void FIFOBufferKernel(void);
+static void MotorAllocationKernel(void);
+static void AddNewSampleKernel(void);
+static void SphereCalibrationSetup(void);
+static void SphereCalibrationKernel(void);
+
+/* Private variables ---------------------------------------------------------*/
+static const HostBenchmark_TypeDef HostBenchmarks[] = {
+        { "UpdateRotationMatrix", NULL, UpdateRotationMatrixKernel, 1000 },
+        { "UpdateAngularRotationMatrix", NULL, UpdateAngularRotationMatrixKernel, 1000 },
+        { "GetEulerAngularRates", NULL, GetEulerAngularRatesKernel, 1000 },
+        { "GetAttitudeFromAccelerometer", NULL, GetAttitudeFromAccelerometerKernel, 1000 },
+        { "GetMagYawAngle", NULL, GetMagYawAngleKernel, 1000 },
+        { "Vector3DNormalize", NULL, Vector3DNormalizeKernel, 1000 },
+        { "Vec3Normalize", NULL, Vec3NormalizeKernel, 1000 },
+        { "Vec3Cross", NULL, Vec3CrossKernel, 1000 },
+        { "Mat3MultVec3", NULL, Mat3MultVec3Kernel, 1000 },
+        { "Mat3Mult", NULL, Mat3MultKernel, 1000 },
+        { "QuatMult", NULL, QuatMultKernel, 1000 },
+        { "QuatNormalize", NULL, QuatNormalizeKernel, 1000 },
+        { "QuatRotateVec3", NULL, QuatRotateVec3Kernel, 1000 },
+        { "QuatToMat3", NULL, QuatToMat3Kernel, 1000 },
+        { "sinf + cosf (libm)", NULL, LibmSinCosKernel, 1000 },
+        { "FastSinCos", NULL, FastSinCosKernel, 1000 },
+        { "powf altitude (libm)", NULL, LibmPressureToAltitudeKernel, 1000 },
+        { "PressureToAltitude", NULL, PressureToAltitudeKernel, 1000 },
+        { "UpdatePredictionState", FlightStateSetup, UpdatePredictionStateKernel, 100 },
+        { "UpdateCorrectionState gyro", FlightStateSetup, GyroCorrectionKernel, 100 },
+        { "UpdateCorrectionState acc", FlightStateSetup, AccCorrectionKernel, 100 },
+        { "UpdateCorrectionState mag", FlightStateSetup, MagCorrectionKernel, 100 },
+        { "UpdatePIDControlSignals", FlightStateSetup, UpdatePIDControlSignalsKernel, 100 },
+        { "Flight control step", FlightStateSetup, FlightControlStepKernel, 100 },
+        { "FIFOBuffer put/get 32 B", NULL, FIFOBufferKernel, 1000 },
+        { "CalculateMotorAllocationPhysical", NULL, MotorAllocationKernel, 1000 },
+        { "addNewSample", NULL, AddNewSampleKernel, HOST_BENCHMARK_SPHERE_SAMPLES },
+        { "calibrate", SphereCalibrationSetup, SphereCalibrationKernel, 1 },
+};
+
+#define HOST_BENCHMARK_COUNT    (sizeof(HostBenchmarks)/sizeof(HostBenchmarks[0]))
+
+static int instructionCounterFd = -1;
+
+/* Kernel inputs are read through volatile pointers and results written to volatile variables, so that the compiler
+ * can neither hoist the kernels out of the batch loop nor remove them */
+static volatile float32_t benchAngle = 0.7f;
+static volatile int32_t benchPressure = 99870; // [Pa]
+static float32_t benchAttitude[3];
+static float32_t benchGyro[3];
+static float32_t benchAcc[3];
+static float32_t benchMag[3];
+static float32_t benchVector[3];
+static float32_t benchMatrix[9];
+static float32_t benchQuat[4];
+static volatile float32_t benchResult[9];
+static float32_t benchResultVector[3];
+static float32_t benchResultMatrix[9];
+static float32_t benchResultQuat[4];
+static float32_t benchSphereSamples[HOST_BENCHMARK_SPHERE_SAMPLES][3];
+static float32_t benchCalibrationParams[6];
+static uint16_t benchMotorValues[4];
+static uint16_t benchSampleIndex;
+static CtrlSignals_TypeDef benchCtrlSignals;
+
+static uint8_t benchFIFOArray[HOST_BENCHMARK_FIFO_SIZE];
+static volatile FIFOBuffer_TypeDef benchFIFOBuffer;
+static uint8_t benchFIFOData[HOST_BENCHMARK_FIFO_CHUNK_SIZE];
+
+/* Flight state restored before each estimator and PID batch */
+static StateEstimationContextType benchStateEstimation;
+static PIDControlContext_TypeDef benchPIDControl;
+
+static HostBenchmarkResult_TypeDef HostBenchmarkResults[HOST_BENCHMARK_COUNT];
+
+/* Fakes ---------------------------------------------------------------------*/
+uint32_t SystemCoreClock = 72000000;
+
+const float32_t GYRO_X_AXIS_VARIANCE = 0.098603;
+const float32_t GYRO_Y_AXIS_VARIANCE = 0.104274;
+const float32_t GYRO_Z_AXIS_VARIANCE = 0.103256;
+
+portTickType xTaskGetTickCount(void) {
+    return 0;
+}
+
+float32_t GetRollControlSignal(void) {
+    return benchCtrlSignals.rollMoment;
+}
+
+float32_t GetPitchControlSignal(void) {
+    return benchCtrlSignals.pitchMoment;
+}
+
+float32_t GetYawControlSignal(void) {
+    return benchCtrlSignals.yawMoment;
+}
+
+/* A small step of the reference signals, so that the controllers do work */
+float32_t GetRollAngleReferenceSignal(void) {
+    return 0.1f;
+}
+
+float32_t GetPitchAngleReferenceSignal(void) {
+    return -0.05f;
+}
+
+float32_t GetYawAngularRateReferenceSignal(void) {
+    return 0.2f;
+}
+
+void ErrorHandler(void) {
+    fprintf(stderr, "ErrorHandler called\n");
+    exit(EXIT_FAILURE);
+}
+
+/* Exported functions --------------------------------------------------------*/
+
+int main(int argc, char* argv[]) {
+    const HostBenchmark_TypeDef emptyBenchmark = { "", NULL, EmptyKernel, 1000 };
+    HostBatchResult_TypeDef batch, overhead = { UINT64_MAX, UINT64_MAX };
+    const char* baselinePath = NULL;
+    const char* comparePath = NULL;
+    double maxRegression = -1.0;
+    long batches = HOST_BENCHMARK_DEFAULT_BATCHES;
+    bool argsValid = true;
+    long j;
+    int i;
+
+    for (i = 1; i < argc && argsValid; i++) {
+        if (strcmp(argv[i], "--baseline") == 0 && i + 1 < argc)
+            baselinePath = argv[++i];
+        else if (strcmp(argv[i], "--compare") == 0 && i + 1 < argc)
+            comparePath = argv[++i];
+        else if (strcmp(argv[i], "--max-regression") == 0 && i + 1 < argc)
+            maxRegression = strtod(argv[++i], NULL);
+        else if (argv[i][0] != '-')
+            batches = strtol(argv[i], NULL, 10);
+        else
+            argsValid = false;
+    }
+    if (!argsValid || batches <= 0 || (maxRegression >= 0.0 && comparePath == NULL)) {
+        fprintf(stderr, "usage: %s [batches] [--baseline FILE] [--compare FILE [--max-regression PERCENT]]\n",
+                argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    InitBenchmarkInputs();
+    InitInstructionCounter();
+
+    for (j = 0; j < batches || j < 8; j++) {
+        MeasureBatch(&emptyBenchmark, &batch);
+        if (batch.ns < overhead.ns)
+            overhead.ns = batch.ns;
+        if (batch.instructions < overhead.instructions)
+            overhead.instructions = batch.instructions;
+    }
+
+    printf("%-33s %10s %10s %10s  (%ld batches, overhead %.2f ns/op subtracted)\n", "Kernel", "min ns/op",
+            "mean ns/op", "instr/op", batches, (double) overhead.ns / emptyBenchmark.opsPerBatch);
+
+    for (i = 0; i < (int) HOST_BENCHMARK_COUNT; i++) {
+        RunBenchmark(&HostBenchmarks[i], batches, &overhead, emptyBenchmark.opsPerBatch, &HostBenchmarkResults[i]);
+
+        if (HostBenchmarkResults[i].instructions >= 0.0)
+            printf("%-33s %10.2f %10.2f %10.1f\n", HostBenchmarks[i].name, HostBenchmarkResults[i].minNs,
+                    HostBenchmarkResults[i].meanNs, HostBenchmarkResults[i].instructions);
+        else
+            printf("%-33s %10.2f %10.2f %10s\n", HostBenchmarks[i].name, HostBenchmarkResults[i].minNs,
+                    HostBenchmarkResults[i].meanNs, "-");
+    }
+
+    if (baselinePath != NULL && !WriteBaseline(baselinePath, HostBenchmarkResults))
+        return EXIT_FAILURE;
+    if (comparePath != NULL && !CompareBaseline(comparePath, HostBenchmarkResults, maxRegression))
+        return EXIT_FAILURE;
+
+    return EXIT_SUCCESS;
+}
+
+/* Private functions ---------------------------------------------------------*/
+
+/*
+ * @brief  Initializes the benchmark inputs, the same tilted hovering state and sphere samples as on target, and the
+ *         estimator and PID controllers as in the flight application
+ * @param  None
+ * @retval None
+ */
+static void InitBenchmarkInputs(void) {
+    const float32_t axis[3] = { 0.3f, -1.2f, 9.7f };
+    float32_t azimuth, elevation;
+    uint16_t i;
+
+    /* The input values of the profile build in kernel_benchmark.c */
+    benchGyro[0] = 0.02f;
+    benchGyro[1] = -0.01f;
+    benchGyro[2] = 0.005f;
+    benchAcc[0] = 0.35f;
+    benchAcc[1] = -0.17f;
+    benchAcc[2] = -G_ACC;
+    benchMag[0] = 0.21f;
+    benchMag[1] = 0.02f;
+    benchMag[2] = 0.45f;
+
+    benchVector[0] = 0.3f;
+    benchVector[1] = -1.2f;
+    benchVector[2] = 9.7f;
+
+    Vec3Normalize(benchResultVector, axis);
+    QuatFromAxisAngle(benchQuat, benchResultVector, 0.3f);
+    QuatToMat3(benchMatrix, benchQuat);
+
+    /* Attitude of the accelerometer and magnetometer readings */
+    InitRotationMatrix();
+    InitAngularRotationMatrix();
+    GetAttitudeFromAccelerometer(benchAttitude, benchAcc);
+    benchAttitude[2] = GetMagYawAngle(benchMag, benchAttitude[0], benchAttitude[1]);
+
+    InitStatesXYZ(benchAttitude);
+    InitPIDControllers();
+    ResetCtrlSignals(&benchCtrlSignals);
+    SaveStateEstimationContext(&benchStateEstimation);
+    SavePIDControlContext(&benchPIDControl);
+
+    /* Samples distributed on a sphere with offset center and non-unit radius, like raw sensor readings */
+    for (i = 0; i < HOST_BENCHMARK_SPHERE_SAMPLES; i++) {
+        azimuth = 2*PI*i/HOST_BENCHMARK_SPHERE_SAMPLES;
+        elevation = PI*((float32_t)(i % 8)/8 - 0.4375f);
+        benchSphereSamples[i][0] = 0.1f + 1.2f*cosf(elevation)*cosf(azimuth);
+        benchSphereSamples[i][1] = -0.05f + 1.1f*cosf(elevation)*sinf(azimuth);
+        benchSphereSamples[i][2] = 0.2f + 0.9f*sinf(elevation);
+    }
+    benchSampleIndex = 0;
+
+    FIFOBufferInit(&benchFIFOBuffer, benchFIFOArray, HOST_BENCHMARK_FIFO_SIZE);
+    for (i = 0; i < HOST_BENCHMARK_FIFO_CHUNK_SIZE; i++)
+        benchFIFOData[i] = (uint8_t) i;
+}
+
+/*
+ * @brief  Opens the hardware instruction counter of this process, user space only. The counter is left closed if
+ *         perf_event is not available.
+ * @param  None
+ * @retval None
+ */
+static void InitInstructionCounter(void) {
+    struct perf_event_attr attr;
+
+    memset(&attr, 0, sizeof(attr));
+    attr.type = PERF_TYPE_HARDWARE;
+    attr.size = sizeof(attr);
+    attr.config = PERF_COUNT_HW_INSTRUCTIONS;
+    attr.disabled = 1;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+
+    instructionCounterFd = (int) syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+}
+
+/*
+ * @brief  Runs one batch of a benchmark and measures its time and instructions
+ * @param  benchmark : The benchmark to run
+ * @param  batch : Destination of the batch time and instructions
+ * @retval None
+ */
+static void MeasureBatch(const HostBenchmark_TypeDef* benchmark, HostBatchResult_TypeDef* batch) {
+    uint64_t startNs, instructions = 0;
+    uint16_t i;
+
+    if (benchmark->setup != NULL)
+        benchmark->setup();
+
+    if (instructionCounterFd >= 0) {
+        ioctl(instructionCounterFd, PERF_EVENT_IOC_RESET, 0);
+        ioctl(instructionCounterFd, PERF_EVENT_IOC_ENABLE, 0);
+    }
+
+    startNs = GetTimeNs();
+    for (i = 0; i < benchmark->opsPerBatch; i++)
+        benchmark->kernel();
+    batch->ns = GetTimeNs() - startNs;
+
+    if (instructionCounterFd >= 0) {
+        ioctl(instructionCounterFd, PERF_EVENT_IOC_DISABLE, 0);
+        if (read(instructionCounterFd, &instructions, sizeof(instructions)) != sizeof(instructions))
+            instructions = 0;
+    }
+    batch->instructions = instructions;
+}
+
+/*
+ * @brief  Runs all batches of a benchmark and normalizes the results to one operation without the loop overhead
+ * @param  benchmark : The benchmark to run
+ * @param  batches : Number of batches
+ * @param  overhead : Fastest batch and fewest instructions of the empty kernel
+ * @param  overheadOps : Operations per batch of the empty kernel
+ * @param  result : Destination of the benchmark result
+ * @retval None
+ */
+static void RunBenchmark(const HostBenchmark_TypeDef* benchmark, const long batches,
+        const HostBatchResult_TypeDef* overhead, const uint16_t overheadOps, HostBenchmarkResult_TypeDef* result) {
+    const double ops = benchmark->opsPerBatch;
+    const double overheadScale = ops / overheadOps;
+    HostBatchResult_TypeDef batch;
+    uint64_t minNs = UINT64_MAX, sumNs = 0, minInstructions = UINT64_MAX;
+    long j;
+
+    for (j = 0; j < batches; j++) {
+        MeasureBatch(benchmark, &batch);
+        if (batch.ns < minNs)
+            minNs = batch.ns;
+        if (batch.instructions < minInstructions)
+            minInstructions = batch.instructions;
+        sumNs += batch.ns;
+    }
+
+    result->minNs = fmax(((double) minNs - (double) overhead->ns * overheadScale) / ops, 0.0);
+    result->meanNs = fmax(((double) sumNs / batches - (double) overhead->ns * overheadScale) / ops, 0.0);
+    if (instructionCounterFd >= 0 && minInstructions > 0)
+        result->instructions = fmax(((double) minInstructions - (double) overhead->instructions * overheadScale)
+                / ops, 0.0);
+    else
+        result->instructions = -1.0;
+}
+
+/*
+ * @brief  Writes the results as baseline file, one line per kernel: min ns/op, instructions/op (-1 if not counted)
+ *         and name
+ * @param  path : Baseline file path
+ * @param  results : Results of all benchmarks
+ * @retval true if written, else false
+ */
+static bool WriteBaseline(const char* path, const HostBenchmarkResult_TypeDef* results) {
+    FILE* file = fopen(path, "w");
+    size_t i;
+
+    if (file == NULL) {
+        perror(path);
+        return false;
+    }
+
+    for (i = 0; i < HOST_BENCHMARK_COUNT; i++)
+        fprintf(file, "%.3f %.1f %s\n", results[i].minNs, results[i].instructions, HostBenchmarks[i].name);
+
+    if (fclose(file) != 0) {
+        perror(path);
+        return false;
+    }
+    printf("Baseline written to %s\n", path);
+    return true;
+}
+
+/*
+ * @brief  Compares the results with a baseline file written by WriteBaseline() and prints the change of each kernel
+ * @param  path : Baseline file path
+ * @param  results : Results of all benchmarks
+ * @param  maxRegression : Largest allowed slowdown of a kernel [percent], negative for no limit
+ * @retval false if the file cannot be read or a kernel is slower than the limit, else true
+ */
+static bool CompareBaseline(const char* path, const HostBenchmarkResult_TypeDef* results, const double maxRegression) {
+    FILE* file = fopen(path, "r");
+    char line[HOST_BENCHMARK_MAX_NAME_SIZE + 64];
+    char name[HOST_BENCHMARK_MAX_NAME_SIZE];
+    double baseNs, baseInstructions, change;
+    bool found, passed = true;
+    size_t i;
+
+    if (file == NULL) {
+        perror(path);
+        return false;
+    }
+
+    printf("\n%-33s %10s %10s %10s %10s\n", "Kernel vs baseline", "base ns", "change", "base instr", "change");
+    for (i = 0; i < HOST_BENCHMARK_COUNT; i++) {
+        found = false;
+        rewind(file);
+        while (!found && fgets(line, sizeof(line), file) != NULL) {
+            line[strcspn(line, "\n")] = '\0';
+            found = sscanf(line, "%lf %lf %63[^\n]", &baseNs, &baseInstructions, name) == 3
+                    && strcmp(name, HostBenchmarks[i].name) == 0;
+        }
+        if (!found) {
+            printf("%-33s %10s\n", HostBenchmarks[i].name, "new");
+            continue;
+        }
+
+        printf("%-33s %10.2f %+9.1f%%", HostBenchmarks[i].name, baseNs,
+                baseNs > 0.0 ? 100.0*(results[i].minNs - baseNs)/baseNs : 0.0);
+        if (baseInstructions > 0.0 && results[i].instructions >= 0.0) {
+            change = 100.0*(results[i].instructions - baseInstructions)/baseInstructions;
+            printf(" %10.1f %+9.1f%%", baseInstructions, change);
+        } else {
+            change = baseNs > 0.0 ? 100.0*(results[i].minNs - baseNs)/baseNs : 0.0;
+            printf(" %10s %10s", "-", "-");
+        }
+
+        if (maxRegression >= 0.0 && change > maxRegression) {
+            printf("  REGRESSION");
+            passed = false;
+        }
+        printf("\n");
+    }
+
+    fclose(file);
+    return passed;
+}
+
+/*
+ * @brief  Returns the monotonic time
+ * @param  None
+ * @retval Time [ns]
+ */
+static uint64_t GetTimeNs(void) {
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t) now.tv_sec * 1000000000u + (uint64_t) now.tv_nsec;
+}
+
+static void EmptyKernel(void) {
+    benchResult[0] = benchAngle;
+}
+
+static void UpdateRotationMatrixKernel(void) {
+    UpdateRotationMatrix(benchAttitude[0], benchAttitude[1], benchAttitude[2]);
+}
+
+static void UpdateAngularRotationMatrixKernel(void) {
+    UpdateAngularRotationMatrix(benchAttitude[0], benchAttitude[1]);
+}
+
+static void GetEulerAngularRatesKernel(void) {
+    GetEulerAngularRates(benchResultVector, benchGyro, benchAttitude[0], benchAttitude[1]);
+    benchResult[0] = benchResultVector[0];
+}
+
+static void GetAttitudeFromAccelerometerKernel(void) {
+    GetAttitudeFromAccelerometer(benchResultVector, benchAcc);
+    benchResult[0] = benchResultVector[0];
+}
+
+static void GetMagYawAngleKernel(void) {
+    benchResult[0] = GetMagYawAngle(benchMag, benchAttitude[0], benchAttitude[1]);
+}
+
+static void Vector3DNormalizeKernel(void) {
+    Vector3DNormalize(benchResultVector, benchVector);
+    benchResult[0] = benchResultVector[0];
+}
+
+static void Vec3NormalizeKernel(void) {
+    Vec3Normalize(benchResultVector, benchVector);
+    benchResult[0] = benchResultVector[0];
+}
+
+static void Vec3CrossKernel(void) {
+    Vec3Cross(benchResultVector, benchVector, benchMatrix);
+    benchResult[0] = benchResultVector[0];
+}
+
+static void Mat3MultVec3Kernel(void) {
+    Mat3MultVec3(benchResultVector, benchMatrix, benchVector);
+    benchResult[0] = benchResultVector[0];
+}
+
+static void Mat3MultKernel(void) {
+    Mat3Mult(benchResultMatrix, benchMatrix, benchMatrix);
+    benchResult[0] = benchResultMatrix[0];
+}
+
+static void QuatMultKernel(void) {
+    QuatMult(benchResultQuat, benchQuat, benchQuat);
+    benchResult[0] = benchResultQuat[0];
+}
+
+static void QuatNormalizeKernel(void) {
+    QuatNormalize(benchResultQuat, benchQuat);
+    benchResult[0] = benchResultQuat[0];
+}
+
+static void QuatRotateVec3Kernel(void) {
+    QuatRotateVec3(benchResultVector, benchQuat, benchVector);
+    benchResult[0] = benchResultVector[0];
+}
+
+static void QuatToMat3Kernel(void) {
+    QuatToMat3(benchResultMatrix, benchQuat);
+    benchResult[0] = benchResultMatrix[0];
+}
+
+static void LibmSinCosKernel(void) {
+    const float32_t angle = benchAngle;
+
+    benchResult[0] = sinf(angle);
+    benchResult[1] = cosf(angle);
+}
+
+static void FastSinCosKernel(void) {
+    float32_t sinValue, cosValue;
+
+    FastSinCos(benchAngle, &sinValue, &cosValue);
+    benchResult[0] = sinValue;
+    benchResult[1] = cosValue;
+}
+
+static void LibmPressureToAltitudeKernel(void) {
+    /* The barometric formula the altitude table is generated from (tools/gen_math_tables.py) */
+    benchResult[0] = 44330.0f*(1.0f - powf((float32_t) benchPressure / 101325.0f, 0.190295f));
+}
+
+static void PressureToAltitudeKernel(void) {
+    benchResult[0] = PressureToAltitude(benchPressure);
+}
+
+static void FlightStateSetup(void) {
+    RestoreStateEstimationContext(&benchStateEstimation);
+    RestorePIDControlContext(&benchPIDControl);
+    ResetCtrlSignals(&benchCtrlSignals);
+}
+
+static void UpdatePredictionStateKernel(void) {
+    UpdatePredictionState();
+}
+
+static void GyroCorrectionKernel(void) {
+    UpdateCorrectionState(GYRO_IDX, benchGyro);
+}
+
+static void AccCorrectionKernel(void) {
+    UpdateCorrectionState(ACC_IDX, benchAcc);
+}
+
+static void MagCorrectionKernel(void) {
+    UpdateCorrectionState(MAG_IDX, benchMag);
+}
+
+static void UpdatePIDControlSignalsKernel(void) {
+    UpdatePIDControlSignals(&benchCtrlSignals);
+}
+
+static void FlightControlStepKernel(void) {
+    /* One flight control cycle: prediction, gyroscope correction, PID control and motor allocation */
+    UpdatePredictionState();
+    UpdateCorrectionState(GYRO_IDX, benchGyro);
+    UpdatePIDControlSignals(&benchCtrlSignals);
+    CalculateMotorAllocationPhysical(benchMotorValues, -MASS*G_ACC, benchCtrlSignals.rollMoment,
+            benchCtrlSignals.pitchMoment, benchCtrlSignals.yawMoment);
+}
+
+static void FIFOBufferKernel(void) {
+    uint8_t* dataPtr;
+    uint16_t dataSize;
+
+    FIFOBufferPutData(&benchFIFOBuffer, benchFIFOData, HOST_BENCHMARK_FIFO_CHUNK_SIZE);
+
+    /* Data may be returned in two parts if the FIFO wraps around */
+    dataSize = FIFOBufferGetData(&benchFIFOBuffer, &dataPtr, HOST_BENCHMARK_FIFO_CHUNK_SIZE);
+    if (dataSize < HOST_BENCHMARK_FIFO_CHUNK_SIZE)
+        FIFOBufferGetData(&benchFIFOBuffer, &dataPtr, HOST_BENCHMARK_FIFO_CHUNK_SIZE - dataSize);
+}
+
+static void MotorAllocationKernel(void) {
+    CalculateMotorAllocationPhysical(benchMotorValues, -MASS*G_ACC, 0.05f*benchAngle, -0.05f, 0.01f);
+    benchResult[0] = benchMotorValues[0];
+}
+
+static void AddNewSampleKernel(void) {
+    addNewSample(benchSphereSamples[benchSampleIndex]);
+    benchSampleIndex = (benchSampleIndex + 1) % HOST_BENCHMARK_SPHERE_SAMPLES;
+}
+
+static void SphereCalibrationSetup(void) {
+    uint16_t i;
+
+    /* calibrate() clears the observations, so new samples are needed before each run */
+    for (i = 0; i < HOST_BENCHMARK_SPHERE_SAMPLES; i++)
+        addNewSample(benchSphereSamples[i]);
+}
+
+static void SphereCalibrationKernel(void) {
+    calibrate(benchCalibrationParams);
+    benchResult[0] = benchCalibrationParams[0];
+}
+
+/**
+ * @}
+ */
+
+/**
+ * @}
+ */
+/*****END OF FILE****/
@@ -0,0 +1,154 @@
+/******************************************************************************
+ * @file    dragonfly_fcb.pb.h
+ * @author  Dragonfly
+ * @version v. 1.0.0
+ * @date    2016-06-01
+ * @brief   Host build stand-in for the nanopb generated message header of the
+ *          FCB protobuf messages, see pb.h. Holds the messages and fields the
+ *          firmware sources set, with the field types of their values. The
+ *          encoded sizes are upper bounds for these fields, not the generated
+ *          values.
+ ******************************************************************************/
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef PB_DRAGONFLY_FCB_PB_H_INCLUDED
+#define PB_DRAGONFLY_FCB_PB_H_INCLUDED
+
+/* Includes ------------------------------------------------------------------*/
+#include "pb.h"
+
+/* Exported types ------------------------------------------------------------*/
+typedef struct {
+    bool has_is_active;
+    bool is_active;
+    bool has_throttle;
+    int32_t throttle;
+    bool has_aileron;
+    int32_t aileron;
+    bool has_elevator;
+    int32_t elevator;
+    bool has_rudder;
+    int32_t rudder;
+    bool has_gear;
+    int32_t gear;
+    bool has_aux1;
+    int32_t aux1;
+} ReceiverSignalValuesProto;
+
+typedef struct {
+    bool has_accX;
+    float accX;
+    bool has_accY;
+    float accY;
+    bool has_accZ;
+    float accZ;
+    bool has_accRoll;
+    float accRoll;
+    bool has_accPitch;
+    float accPitch;
+    bool has_accYaw;
+    float accYaw;
+    bool has_gyroX;
+    float gyroX;
+    bool has_gyroY;
+    float gyroY;
+    bool has_gyroZ;
+    float gyroZ;
+    bool has_magX;
+    float magX;
+    bool has_magY;
+    float magY;
+    bool has_magZ;
+    float magZ;
+} SensorSamplesProto;
+
+typedef struct {
+    bool has_M1;
+    uint32_t M1;
+    bool has_M2;
+    uint32_t M2;
+    bool has_M3;
+    uint32_t M3;
+    bool has_M4;
+    uint32_t M4;
+} MotorSignalValuesProto;
+
+typedef struct {
+    bool has_refRoll;
+    float refRoll;
+    bool has_refPitch;
+    float refPitch;
+    bool has_refYaw;
+    float refYaw;
+    bool has_refYawRate;
+    float refYawRate;
+} ControlReferenceSignalsProto;
+
+typedef struct {
+    bool has_ctrlState;
+    int32_t ctrlState;
+    bool has_thrustCtrl;
+    float thrustCtrl;
+    bool has_rollCtrl;
+    float rollCtrl;
+    bool has_pitchCtrl;
+    float pitchCtrl;
+    bool has_yawCtrl;
+    float yawCtrl;
+} ControlSignalsProto;
+
+typedef struct {
+    bool has_rollAngle;
+    float rollAngle;
+    bool has_pitchAngle;
+    float pitchAngle;
+    bool has_yawAngle;
+    float yawAngle;
+    bool has_rollRate;
+    float rollRate;
+    bool has_pitchRate;
+    float pitchRate;
+    bool has_yawRate;
+    float yawRate;
+    bool has_posX;
+    float posX;
+    bool has_posY;
+    float posY;
+    bool has_posZ;
+    float posZ;
+    bool has_velX;
+    float velX;
+    bool has_velY;
+    float velY;
+    bool has_velZ;
+    float velZ;
+} FlightStatesProto;
+
+/* Exported constants --------------------------------------------------------*/
+
+/* Encoded sizes: 5 bytes per float, 6 per uint32, 11 per int32 and 2 per bool field */
+#define ReceiverSignalValuesProto_size      68
+#define SensorSamplesProto_size             60
+#define MotorSignalValuesProto_size         24
+#define ControlReferenceSignalsProto_size   20
+#define ControlSignalsProto_size            31
+#define FlightStatesProto_size              60
+
+/* Field descriptions */
+extern const pb_field_t ReceiverSignalValuesProto_fields[];
+extern const pb_field_t SensorSamplesProto_fields[];
+extern const pb_field_t MotorSignalValuesProto_fields[];
+extern const pb_field_t ControlReferenceSignalsProto_fields[];
+extern const pb_field_t ControlSignalsProto_fields[];
+extern const pb_field_t FlightStatesProto_fields[];
+
+#endif /* PB_DRAGONFLY_FCB_PB_H_INCLUDED */
+
+/**
+ * @}
+ */
+
+/**
+ * @}
+ */
+/*****END OF FILE****/
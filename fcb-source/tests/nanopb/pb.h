@@ -0,0 +1,44 @@
+/******************************************************************************
+ * @file    pb.h
+ * @author  Dragonfly
+ * @version v. 1.0.0
+ * @date    2016-06-01
+ * @brief   Host build stand-in for the nanopb 0.3.3 pb.h. Declares only the
+ *          types the firmware sources use, so that they compile in the build
+ *          profile check of the host tests without the nanopb distribution.
+ *          The firmware is built with the real nanopb.
+ ******************************************************************************/
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef PB_H_INCLUDED
+#define PB_H_INCLUDED
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/* Exported types ------------------------------------------------------------*/
+typedef uint8_t pb_byte_t;
+
+/* Field description, layout of the default (8-bit tag) nanopb configuration */
+typedef struct pb_field_s {
+    uint8_t tag;
+    uint8_t type;
+    uint8_t data_offset;
+    int8_t size_offset;
+    uint8_t data_size;
+    uint8_t array_size;
+    const void* ptr;
+} pb_field_t;
+
+#endif /* PB_H_INCLUDED */
+
+/**
+ * @}
+ */
+
+/**
+ * @}
+ */
+/*****END OF FILE****/
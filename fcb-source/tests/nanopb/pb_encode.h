@@ -0,0 +1,41 @@
+/******************************************************************************
+ * @file    pb_encode.h
+ * @author  Dragonfly
+ * @version v. 1.0.0
+ * @date    2016-06-01
+ * @brief   Host build stand-in for the nanopb 0.3.3 pb_encode.h, see pb.h.
+ *          The functions are declared only, the profile check compiles but
+ *          does not link.
+ ******************************************************************************/
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef PB_ENCODE_H_INCLUDED
+#define PB_ENCODE_H_INCLUDED
+
+/* Includes ------------------------------------------------------------------*/
+#include "pb.h"
+
+/* Exported types ------------------------------------------------------------*/
+typedef struct pb_ostream_s pb_ostream_t;
+
+struct pb_ostream_s {
+    bool (*callback)(pb_ostream_t* stream, const pb_byte_t* buf, size_t count);
+    void* state;
+    size_t max_size;
+    size_t bytes_written;
+};
+
+/* Exported function prototypes --------------------------------------------- */
+pb_ostream_t pb_ostream_from_buffer(pb_byte_t* buf, size_t bufsize);
+bool pb_encode(pb_ostream_t* stream, const pb_field_t fields[], const void* src_struct);
+
+#endif /* PB_ENCODE_H_INCLUDED */
+
+/**
+ * @}
+ */
+
+/**
+ * @}
+ */
+/*****END OF FILE****/
@@ -0,0 +1,192 @@
+/******************************************************************************
+ * @brief   Host build of the settings snapshot (fcb/src/settings_snapshot.c)
+ *          and the flash settings storage (utilities/src/flash.c), loaded by
+ *          the selftest of tools/settings_snapshot.py through ctypes.
+ *
+ *          The settings flash pages and the flash registers are RAM mapped at
+ *          their target addresses, so that flash.c runs unchanged. Page erase
+ *          and word program are faked on that RAM with the flash rule that
+ *          only erased words can be programmed. The setting range checks of
+ *          receiver.c and fcb_accelerometer_magnetometer.c, which do not
+ *          build for the host, are repeated here.
+ *
+ * @license
+ * Dragonfly FCB firmware to control the Dragonfly quadrotor UAV
+ * Copyright (C) 2016  ÅF Technology South: Dragonfly Project
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA
+ *****************************************************************************/
+
+/* Includes ------------------------------------------------------------------*/
+#include "test_common.h"
+
+#include "settings_snapshot.h"
+#include "flash.h"
+#include "receiver.h"
+#include "flight_control.h"
+#include "fcb_accelerometer_magnetometer.h"
+#include "fcb_sensor_calibration.h"
+#include "fcb_retval.h"
+
+#include "FreeRTOS.h"
+#include "task.h"
+
+#include <string.h>
+
+/* Private define ------------------------------------------------------------*/
+#define RECEIVER_CHANNELS       (sizeof(Receiver_CalibrationValues_TypeDef) \
+        / sizeof(Receiver_IC_ChannelCalibrationValues_TypeDef))
+
+/* Private variables ---------------------------------------------------------*/
+static bool flightControlIdle = true;
+static uint32_t pageErases = 0;
+
+/* Fakes ---------------------------------------------------------------------*/
+
+/* Software version of the CRC peripheral settings in InitCRC(), as in tools/watch.py */
+uint32_t CalculateCRC(const uint8_t* dataBuffer, const uint32_t dataBufferSize) {
+    uint32_t crc = 0xFFFFFFFF;
+    uint32_t i;
+    int bit;
+
+    for (i = 0; i < dataBufferSize; i++) {
+        crc ^= (uint32_t) dataBuffer[i] << 24;
+        for (bit = 0; bit < 8; bit++)
+            crc = (crc & 0x80000000) ? (crc << 1) ^ 0x04C11DB7 : crc << 1;
+    }
+    return crc;
+}
+
+HAL_StatusTypeDef HAL_FLASH_Unlock(void) {
+    return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_FLASH_Lock(void) {
+    return HAL_OK;
+}
+
+void FLASH_PageErase(uint32_t PageAddress) {
+    memset((void*) (uintptr_t) PageAddress, 0xFF, FLASH_PAGE_SIZE);
+    pageErases++;
+}
+
+HAL_StatusTypeDef HAL_FLASH_Program(uint32_t TypeProgram, uint32_t Address, uint64_t Data) {
+    uint32_t* word = (uint32_t*) (uintptr_t) Address;
+
+    if (TypeProgram != TYPEPROGRAM_WORD || *word != 0xFFFFFFFF)
+        return HAL_ERROR;
+
+    *word = (uint32_t) Data;
+    return HAL_OK;
+}
+
+void vTaskDelay(const portTickType xTicksToDelay) {
+    (void) xTicksToDelay;
+}
+
+enum FlightControlMode GetFlightControlMode(void) {
+    return flightControlIdle ? FLIGHT_CONTROL_IDLE : FLIGHT_CONTROL_PID;
+}
+
+bool IsAccMagMtrCalibrating(void) {
+    return false;
+}
+
+/* The ranges of IS_RECEIVER_CALIBRATION_*_PULSE_VALID in receiver.c */
+ReceiverErrorStatus CheckReceiverCalibrationValues(const Receiver_CalibrationValues_TypeDef* calibrationValues) {
+    const Receiver_IC_ChannelCalibrationValues_TypeDef* channels =
+            (const Receiver_IC_ChannelCalibrationValues_TypeDef*) calibrationValues;
+    uint8_t i;
+
+    for (i = 0; i < RECEIVER_CHANNELS; i++) {
+        if (channels[i].ChannelMaxCount > RECEIVER_MAX_CALIBRATION_MAX_PULSE_COUNT
+                || channels[i].ChannelMaxCount < RECEIVER_MAX_CALIBRATION_MIN_PULSE_COUNT
+                || channels[i].ChannelMidCount > RECEIVER_MID_CALIBRATION_MAX_PULSE_COUNT
+                || channels[i].ChannelMidCount < RECEIVER_MID_CALIBRATION_MIN_PULSE_COUNT
+                || channels[i].ChannelMinCount > RECEIVER_MIN_CALIBRATION_MAX_PULSE_COUNT
+                || channels[i].ChannelMinCount < RECEIVER_MIN_CALIBRATION_MIN_PULSE_COUNT)
+            return RECEIVER_ERROR;
+    }
+
+    return RECEIVER_OK;
+}
+
+void SetReceiverCalibrationValues(const Receiver_CalibrationValues_TypeDef* calibrationValues) {
+    (void) calibrationValues;
+}
+
+void applyMaxLimitForReferenceSignal(const RefSignals_TypeDef* maxLimits) {
+    (void) maxLimits;
+}
+
+/* As in fcb_accelerometer_magnetometer.c */
+uint8_t CheckCalParams(const float32_t* calPrms) {
+    if (calPrms[X_SCALING_CALIB_IDX] < 0.1 || calPrms[Y_SCALING_CALIB_IDX] < 0.1
+            || calPrms[Z_SCALING_CALIB_IDX] < 0.1)
+        return FCB_ERR;
+
+    return FCB_OK;
+}
+
+uint8_t SetAccMagMtrCalibrationParams(const float32_t* accCalPrms, const float32_t* magCalPrms) {
+    (void) accCalPrms;
+    (void) magCalPrms;
+    return FCB_OK;
+}
+
+/* Exported functions --------------------------------------------------------*/
+
+/*
+ * @brief  Maps the settings flash and the flash registers, erases the settings flash and sets the flight control
+ *         idle, as on a new board
+ * @param  None
+ * @retval true if the target regions are mapped, else false
+ */
+bool InitSettingsSnapshotHost(void) {
+    /* Both library builds of the selftest are loaded into the same process and share these regions */
+    if (!MapTargetAddress(FLASH_SETTINGS_START_ADDR, FLASH_SETTINGS_SIZE)
+            || !MapTargetAddress(FLASH_R_BASE, sizeof(FLASH_TypeDef)))
+        return false;
+
+    memset((void*) (uintptr_t) FLASH_SETTINGS_START_ADDR, 0xFF, FLASH_SETTINGS_SIZE);
+    pageErases = 0;
+    flightControlIdle = true;
+    return true;
+}
+
+void SetSettingsSnapshotHostIdle(const bool idle) {
+    flightControlIdle = idle;
+}
+
+uint8_t* GetSettingsSnapshotHostPage(void) {
+    return (uint8_t*) (uintptr_t) FLASH_SETTINGS_START_ADDR;
+}
+
+uint32_t GetSettingsSnapshotHostErases(void) {
+    return pageErases;
+}
+
+uint8_t GetSettingsSnapshotHostVersion(void) {
+    return SETTINGS_SNAPSHOT_VERSION;
+}
+
+/**
+ * @}
+ */
+
+/**
+ * @}
+ */
+/*****END OF FILE****/
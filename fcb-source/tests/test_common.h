@@ -0,0 +1,105 @@
+/******************************************************************************
+ * @file    test_common.h
+ * @author  Dragonfly
+ * @version v. 1.0.0
+ * @date    2016-06-01
+ * @brief   Minimal check macros for the host tests. A failed check prints its
+ *          location and values and the test continues, so that one run
+ *          reports all failures. main() returns TEST_RESULT().
+ *
+ *          MapTargetAddress() maps RAM at target addresses, for the code under
+ *          test that accesses target memory or registers directly.
+ ******************************************************************************/
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __TEST_COMMON_H
+#define __TEST_COMMON_H
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/mman.h>
+
+/* Exported variables --------------------------------------------------------*/
+static int testFailures __attribute__((unused)) = 0;
+
+/* Exported macro ------------------------------------------------------------*/
+#define TEST_CHECK(condition) \
+    do { \
+        if (!(condition)) { \
+            testFailures++; \
+            printf("%s:%d: check failed: %s\n", __FILE__, __LINE__, #condition); \
+        } \
+    } while (0)
+
+#define TEST_CHECK_EQUAL(actual, expected) \
+    do { \
+        const long long actual_ = (long long) (actual), expected_ = (long long) (expected); \
+        if (actual_ != expected_) { \
+            testFailures++; \
+            printf("%s:%d: check failed: %s == %s (%lld != %lld)\n", __FILE__, __LINE__, #actual, #expected, \
+                    actual_, expected_); \
+        } \
+    } while (0)
+
+#define TEST_CHECK_CLOSE(actual, expected, tolerance) \
+    do { \
+        const double actual_ = (actual), expected_ = (expected); \
+        if (!(fabs(actual_ - expected_) <= (tolerance))) { \
+            testFailures++; \
+            printf("%s:%d: check failed: %s == %s (%.9g != %.9g, tolerance %g)\n", __FILE__, __LINE__, #actual, \
+                    #expected, actual_, expected_, (double) (tolerance)); \
+        } \
+    } while (0)
+
+#define TEST_RUN(test) \
+    do { \
+        const int failuresBefore_ = testFailures; \
+        test(); \
+        printf("%s %s\n", testFailures == failuresBefore_ ? "PASS" : "FAIL", #test); \
+    } while (0)
+
+#define TEST_RESULT()   (testFailures == 0 ? EXIT_SUCCESS : EXIT_FAILURE)
+
+/* Exported functions ------------------------------------------------------- */
+
+/*
+ * @brief  Maps zeroed RAM over the host pages of a target address range. A range that is already mapped by an
+ *         earlier call, also from another shared library of the same process, is accepted as it is.
+ * @param  address : Start address of the range on target
+ * @param  size : Size of the range [bytes]
+ * @retval true if the whole range is mapped at its target address, else false
+ */
+static inline bool MapTargetAddress(const uintptr_t address, const size_t size) {
+    const uintptr_t pageMask = (uintptr_t) sysconf(_SC_PAGESIZE) - 1;
+    const uintptr_t start = address & ~pageMask;
+    const size_t mapSize = ((address + size + pageMask) & ~pageMask) - start;
+    void* mapped = mmap((void*) start, mapSize, PROT_READ | PROT_WRITE,
+            MAP_PRIVATE | MAP_ANONYMOUS | MAP_FIXED_NOREPLACE, -1, 0);
+
+    if (mapped == MAP_FAILED)
+        return errno == EEXIST;
+
+    /* Kernels without MAP_FIXED_NOREPLACE take the address as a hint only */
+    if (mapped != (void*) start) {
+        munmap(mapped, mapSize);
+        return false;
+    }
+    return true;
+}
+
+#endif /* __TEST_COMMON_H */
+
+/**
+ * @}
+ */
+
+/**
+ * @}
+ */
+/*****END OF FILE****/
@@ -0,0 +1,216 @@
+/******************************************************************************
+ * @brief   Host tests of the control loop phase lock (fcb/src/control_phase.c):
+ *          - GetPhaseError wrap to (-period/2, period/2]
+ *          - UpdatePhaseController compensation of the pending adjust and
+ *            the clamp of the period correction
+ *          - the margin limits of SetControlPhaseMargin
+ *          - closed loop convergence from every initial phase, including the
+ *            worst case half a period off, in a simulation of the control
+ *            tick timer with the ARR preload: a correction written in one
+ *            period is applied from the next.
+ *
+ * @license
+ * Dragonfly FCB firmware to control the Dragonfly quadrotor UAV
+ * Copyright (C) 2016  ÅF Technology South: Dragonfly Project
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA
+ *****************************************************************************/
+
+/* Includes ------------------------------------------------------------------*/
+#include "test_common.h"
+
+#include "control_phase.h"
+
+/* Private define ------------------------------------------------------------*/
+#define PERIOD                  CONTROL_PHASE_PERIOD_TICKS
+#define TARGET_TICKS            (CONTROL_PHASE_DEFAULT_MARGIN_US * CONTROL_PHASE_TICKS_PER_US)
+#define INITIAL_PHASE_STEPS     64
+
+/* Lock time bound: a half period error at the maximum correction per loop, a few loops to settle and the lock count */
+#define MAX_LOCK_LOOPS          ((PERIOD/2)/CONTROL_PHASE_MAX_ADJUST + 8 + CONTROL_PHASE_LOCK_COUNT)
+
+/* Private functions ---------------------------------------------------------*/
+
+/*
+ * Simulates the phase lock with the control tick first at initialPhase in the PWM period. Returns the number of
+ * loops until locked, or -1 if not locked within MAX_LOCK_LOOPS. The absolute phase error must not grow by more
+ * than the lock tolerance from one loop to the next, i.e. no overshoot or limit cycle from the preload delay.
+ */
+static int SimulatePhaseLock(const int32_t initialPhase, const bool compensatePending) {
+    PhaseController_TypeDef controller;
+    int64_t tickTime = initialPhase;
+    int32_t error, adjust, appliedAdjust = 0, lastAbsError = PERIOD;
+    int loop;
+
+    ResetPhaseController(&controller);
+
+    for (loop = 1; loop <= 4*MAX_LOCK_LOOPS; loop++) {
+        error = GetPhaseError((uint32_t) (tickTime % PERIOD), TARGET_TICKS);
+        if (!compensatePending)
+            controller.pendingAdjust = 0;
+        adjust = UpdatePhaseController(&controller, error);
+
+        if (abs(error) > lastAbsError + CONTROL_PHASE_LOCK_TOLERANCE)
+            return -1;
+        lastAbsError = abs(error);
+
+        if (controller.inToleranceCount >= CONTROL_PHASE_LOCK_COUNT)
+            return loop <= MAX_LOCK_LOOPS ? loop : -1;
+
+        /* The period that runs now was preloaded in the previous loop, this loop's correction comes after it */
+        tickTime += PERIOD + appliedAdjust;
+        appliedAdjust = adjust;
+    }
+
+    return -1;
+}
+
+static void TestPhaseErrorWrap(void) {
+    /* Tick exactly at the target */
+    TEST_CHECK_EQUAL(GetPhaseError(PERIOD - TARGET_TICKS, TARGET_TICKS), 0);
+    TEST_CHECK_EQUAL(GetPhaseError(PERIOD - TARGET_TICKS - 10, TARGET_TICKS), 10);
+    TEST_CHECK_EQUAL(GetPhaseError(PERIOD - TARGET_TICKS + 10, TARGET_TICKS), -10);
+
+    /* Wrap to (-period/2, period/2] */
+    TEST_CHECK_EQUAL(GetPhaseError(0, 0), 0);
+    TEST_CHECK_EQUAL(GetPhaseError(PERIOD/2, 0), PERIOD/2);
+    TEST_CHECK_EQUAL(GetPhaseError(PERIOD/2 + 1, 0), PERIOD/2 - 1);
+    TEST_CHECK_EQUAL(GetPhaseError(PERIOD - 1, 0), 1);
+    TEST_CHECK_EQUAL(GetPhaseError(1, 0), -1);
+    TEST_CHECK_EQUAL(GetPhaseError(0, PERIOD/2), PERIOD/2);
+    TEST_CHECK_EQUAL(GetPhaseError(1, PERIOD/2), PERIOD/2 - 1);
+    TEST_CHECK_EQUAL(GetPhaseError(PERIOD - 1, PERIOD/2), -PERIOD/2 + 1);
+}
+
+static void TestPendingAdjust(void) {
+    PhaseController_TypeDef controller;
+
+    ResetPhaseController(&controller);
+    TEST_CHECK_EQUAL(UpdatePhaseController(&controller, 400), 400 >> CONTROL_PHASE_KP_SHIFT);
+    TEST_CHECK_EQUAL(controller.pendingAdjust, 200);
+
+    /* The measured error still contains the preloaded correction, which is not corrected for again */
+    TEST_CHECK_EQUAL(UpdatePhaseController(&controller, 200), 0);
+    TEST_CHECK_EQUAL(controller.pendingAdjust, 0);
+
+    controller.pendingAdjust = -100;
+    TEST_CHECK_EQUAL(UpdatePhaseController(&controller, 100), 200 >> CONTROL_PHASE_KP_SHIFT);
+
+    /* The compensated error is wrapped, near half a period it changes direction */
+    controller.pendingAdjust = -4;
+    TEST_CHECK_EQUAL(UpdatePhaseController(&controller, PERIOD/2 - 2), -CONTROL_PHASE_MAX_ADJUST);
+}
+
+static void TestAdjustClamp(void) {
+    PhaseController_TypeDef controller;
+    int32_t error, adjust;
+
+    for (error = -PERIOD/2 + 1; error <= PERIOD/2; error += 7) {
+        ResetPhaseController(&controller);
+        adjust = UpdatePhaseController(&controller, error);
+
+        TEST_CHECK(adjust <= CONTROL_PHASE_MAX_ADJUST && adjust >= -CONTROL_PHASE_MAX_ADJUST);
+        if (abs(error >> CONTROL_PHASE_KP_SHIFT) <= CONTROL_PHASE_MAX_ADJUST)
+            TEST_CHECK_EQUAL(adjust, error >> CONTROL_PHASE_KP_SHIFT);
+    }
+
+    ResetPhaseController(&controller);
+    TEST_CHECK_EQUAL(UpdatePhaseController(&controller, PERIOD/2), CONTROL_PHASE_MAX_ADJUST);
+    TEST_CHECK_EQUAL(UpdatePhaseController(&controller, -PERIOD/2 + 1 + CONTROL_PHASE_MAX_ADJUST),
+            -CONTROL_PHASE_MAX_ADJUST);
+}
+
+static void TestLockCount(void) {
+    PhaseController_TypeDef controller;
+    int i;
+
+    ResetPhaseController(&controller);
+    for (i = 0; i < CONTROL_PHASE_LOCK_COUNT; i++)
+        UpdatePhaseController(&controller, 0);
+    TEST_CHECK_EQUAL(controller.inToleranceCount, CONTROL_PHASE_LOCK_COUNT);
+
+    UpdatePhaseController(&controller, CONTROL_PHASE_LOCK_TOLERANCE + 1);
+    TEST_CHECK_EQUAL(controller.inToleranceCount, 0);
+}
+
+static void TestMarginClamp(void) {
+    TEST_CHECK_EQUAL(GetControlPhaseMargin(), CONTROL_PHASE_DEFAULT_MARGIN_US);
+    TEST_CHECK_EQUAL(SetControlPhaseMargin(CONTROL_PHASE_MIN_MARGIN_US - 1), FCB_ERR);
+    TEST_CHECK_EQUAL(SetControlPhaseMargin(CONTROL_PHASE_MAX_MARGIN_US + 1), FCB_ERR);
+    TEST_CHECK_EQUAL(SetControlPhaseMargin(0), FCB_ERR);
+    TEST_CHECK_EQUAL(SetControlPhaseMargin(UINT16_MAX), FCB_ERR);
+    TEST_CHECK_EQUAL(GetControlPhaseMargin(), CONTROL_PHASE_DEFAULT_MARGIN_US);
+
+    TEST_CHECK_EQUAL(SetControlPhaseMargin(CONTROL_PHASE_MIN_MARGIN_US), FCB_OK);
+    TEST_CHECK_EQUAL(GetControlPhaseMargin(), CONTROL_PHASE_MIN_MARGIN_US);
+    TEST_CHECK_EQUAL(SetControlPhaseMargin(CONTROL_PHASE_MAX_MARGIN_US), FCB_OK);
+    TEST_CHECK_EQUAL(GetControlPhaseMargin(), CONTROL_PHASE_MAX_MARGIN_US);
+
+    /* The largest margin leaves at least half a period for the loop execution */
+    TEST_CHECK((int32_t) CONTROL_PHASE_MAX_MARGIN_US * CONTROL_PHASE_TICKS_PER_US <= PERIOD/2);
+    TEST_CHECK_EQUAL(SetControlPhaseMargin(CONTROL_PHASE_DEFAULT_MARGIN_US), FCB_OK);
+}
+
+static void TestConvergence(void) {
+    const int32_t worstPhase = PERIOD - TARGET_TICKS - PERIOD/2;
+    int loops, maxLoops = 0, i;
+
+    /* Half a period off is the largest phase error */
+    TEST_CHECK_EQUAL(GetPhaseError(worstPhase, TARGET_TICKS), PERIOD/2);
+    loops = SimulatePhaseLock(worstPhase, true);
+    TEST_CHECK(loops > 0);
+    printf("Locked from worst case phase in %d loops (bound %d)\n", loops, MAX_LOCK_LOOPS);
+
+    for (i = 0; i < INITIAL_PHASE_STEPS; i++) {
+        loops = SimulatePhaseLock((int32_t) ((int64_t) PERIOD*i/INITIAL_PHASE_STEPS), true);
+        TEST_CHECK(loops > 0);
+        if (loops > maxLoops)
+            maxLoops = loops;
+    }
+    TEST_CHECK(maxLoops <= MAX_LOCK_LOOPS);
+}
+
+static void TestConvergenceNeedsCompensation(void) {
+    int i, failures = 0;
+
+    /* Without the pending adjust compensation, the preload delay overshoots at Kp = 1/2 */
+    for (i = 0; i < INITIAL_PHASE_STEPS; i++) {
+        if (SimulatePhaseLock((int32_t) ((int64_t) PERIOD*i/INITIAL_PHASE_STEPS), false) < 0)
+            failures++;
+    }
+    TEST_CHECK(failures > 0);
+}
+
+/* Exported functions --------------------------------------------------------*/
+
+int main(void) {
+    TEST_RUN(TestPhaseErrorWrap);
+    TEST_RUN(TestPendingAdjust);
+    TEST_RUN(TestAdjustClamp);
+    TEST_RUN(TestLockCount);
+    TEST_RUN(TestMarginClamp);
+    TEST_RUN(TestConvergence);
+    TEST_RUN(TestConvergenceNeedsCompensation);
+    return TEST_RESULT();
+}
+
+/**
+ * @}
+ */
+
+/**
+ * @}
+ */
+/*****END OF FILE****/
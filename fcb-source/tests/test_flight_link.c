@@ -0,0 +1,269 @@
+/******************************************************************************
+ * @brief   Host test of the flight link (fcb/src/flight_link.c). Requests are
+ *          fed byte by byte to ParseFlightLinkByte() like the UART RX task
+ *          does in the flight profile:
+ *          - status request answered with a valid status response
+ *          - corrupt requests: bad CRC, size and trailer, garbage before a
+ *            request and a request split over several reads
+ *          - unknown command and a full UART transmit buffer
+ *
+ *          The CRC, tick, flight mode, receiver and UART functions are
+ *          faked. flight_link.c is included so that the test can check the
+ *          parser state.
+ *
+ * @license
+ * Dragonfly FCB firmware to control the Dragonfly quadrotor UAV
+ * Copyright (C) 2016  ÅF Technology South: Dragonfly Project
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA
+ *****************************************************************************/
+
+/* Includes ------------------------------------------------------------------*/
+#include "test_common.h"
+
+#include "../fcb/src/flight_link.c"
+
+
+/* Private define ------------------------------------------------------------*/
+#define REQUEST_SIZE            (PROTO_HEADER_LEN + 1 + FLIGHT_LINK_TRAILER_LEN)
+#define RESPONSE_SIZE           (PROTO_HEADER_LEN + FLIGHT_LINK_STATUS_SIZE + FLIGHT_LINK_TRAILER_LEN)
+#define FAKE_TICK               123456
+#define FAKE_UART_DROPPED_BYTES 42
+
+/* Private variables ---------------------------------------------------------*/
+
+/* Last response sent with UartSendData() */
+static uint8_t sentData[64];
+static unsigned int sentSize = 0;
+static int sentResponses = 0;
+static bool uartFull = false;
+
+/* Fakes ---------------------------------------------------------------------*/
+uint32_t HAL_GetTick(void) {
+    return FAKE_TICK;
+}
+
+/* Software version of the CRC peripheral settings in InitCRC(), as in tools/injection_bridge.py */
+uint32_t CalculateCRC(const uint8_t* dataBuffer, const uint32_t dataBufferSize) {
+    uint32_t crc = 0xFFFFFFFF;
+    uint32_t i;
+    int bit;
+
+    for (i = 0; i < dataBufferSize; i++) {
+        crc ^= (uint32_t) dataBuffer[i] << 24;
+        for (bit = 0; bit < 8; bit++)
+            crc = (crc & 0x80000000) ? (crc << 1) ^ 0x04C11DB7 : crc << 1;
+    }
+    return crc;
+}
+
+enum FlightControlMode GetFlightControlMode(void) {
+    return FLIGHT_CONTROL_RAW;
+}
+
+ReceiverErrorStatus IsReceiverActive(void) {
+    return RECEIVER_OK;
+}
+
+void GetUartTxStats(UartTxStats_TypeDef* stats) {
+    memset(stats, 0, sizeof(*stats));
+    stats->droppedBytes = FAKE_UART_DROPPED_BYTES;
+}
+
+UartStatus UartSendData(const uint8_t* sendData, const uint16_t sendDataSize) {
+    if (uartFull)
+        return UART_FAIL;
+
+    TEST_CHECK(sendDataSize <= sizeof(sentData));
+    if (sendDataSize <= sizeof(sentData)) {
+        memcpy(sentData, sendData, sendDataSize);
+        sentSize = sendDataSize;
+    }
+    sentResponses++;
+    return UART_OK;
+}
+
+/* Private functions ---------------------------------------------------------*/
+
+/* Serializes a request with the given payload, returns the frame size */
+static unsigned int BuildRequest(uint8_t* buffer, const uint8_t* payload, const uint16_t payloadSize) {
+    const uint32_t crc = CalculateCRC(payload, payloadSize);
+
+    buffer[0] = FLIGHT_LINK_MSG_ENUM;
+    memcpy(&buffer[1], &crc, 4);
+    memcpy(&buffer[5], &payloadSize, 2);
+    memcpy(&buffer[PROTO_HEADER_LEN], payload, payloadSize);
+    memcpy(&buffer[PROTO_HEADER_LEN + payloadSize], FLIGHT_LINK_TRAILER, FLIGHT_LINK_TRAILER_LEN);
+    return PROTO_HEADER_LEN + payloadSize + FLIGHT_LINK_TRAILER_LEN;
+}
+
+static unsigned int BuildStatusRequest(uint8_t* buffer) {
+    const uint8_t command = FLIGHT_LINK_CMD_STATUS;
+
+    return BuildRequest(buffer, &command, 1);
+}
+
+static void FeedBytes(const uint8_t* data, const unsigned int size) {
+    unsigned int i;
+
+    for (i = 0; i < size; i++)
+        ParseFlightLinkByte(data[i]);
+}
+
+static void ResetLink(void) {
+    memset(&linkStats, 0, sizeof(linkStats));
+    parserLength = 0;
+    sentSize = 0;
+    sentResponses = 0;
+    uartFull = false;
+}
+
+/* Checks the header, CRC and trailer of the last response and the status values it carries */
+static void CheckStatusResponse(const uint32_t requests, const uint32_t badFrames) {
+    const uint8_t* payload = &sentData[PROTO_HEADER_LEN];
+    uint16_t payloadSize;
+    uint32_t crc, value;
+
+    TEST_CHECK_EQUAL(sentSize, RESPONSE_SIZE);
+    TEST_CHECK_EQUAL(sentData[0], FLIGHT_LINK_MSG_ENUM);
+    memcpy(&payloadSize, &sentData[5], 2);
+    TEST_CHECK_EQUAL(payloadSize, FLIGHT_LINK_STATUS_SIZE);
+    memcpy(&crc, &sentData[1], 4);
+    TEST_CHECK_EQUAL(crc, CalculateCRC(payload, FLIGHT_LINK_STATUS_SIZE));
+    TEST_CHECK(memcmp(&payload[FLIGHT_LINK_STATUS_SIZE], FLIGHT_LINK_TRAILER, FLIGHT_LINK_TRAILER_LEN) == 0);
+
+    TEST_CHECK_EQUAL(payload[0], FLIGHT_LINK_CMD_STATUS);
+    memcpy(&value, &payload[1], 4);
+    TEST_CHECK_EQUAL(value, FAKE_TICK);
+    TEST_CHECK_EQUAL(payload[5], FLIGHT_CONTROL_RAW);
+    TEST_CHECK_EQUAL(payload[6], 1);
+    memcpy(&value, &payload[7], 4);
+    TEST_CHECK_EQUAL(value, requests);
+    memcpy(&value, &payload[11], 4);
+    TEST_CHECK_EQUAL(value, badFrames);
+    memcpy(&value, &payload[15], 4);
+    TEST_CHECK_EQUAL(value, FAKE_UART_DROPPED_BYTES);
+}
+
+static void TestStatusRequest(void) {
+    uint8_t buffer[REQUEST_SIZE];
+    unsigned int size, i;
+
+    ResetLink();
+    size = BuildStatusRequest(buffer);
+    TEST_CHECK_EQUAL(size, REQUEST_SIZE);
+
+    /* Nothing is answered before the last trailer byte */
+    for (i = 0; i < size - 1; i++)
+        ParseFlightLinkByte(buffer[i]);
+    TEST_CHECK_EQUAL(sentResponses, 0);
+    TEST_CHECK_EQUAL(parserLength, size - 1);
+    ParseFlightLinkByte(buffer[size - 1]);
+    TEST_CHECK_EQUAL(sentResponses, 1);
+    TEST_CHECK_EQUAL(parserLength, 0);
+    CheckStatusResponse(1, 0);
+
+    /* Back to back requests */
+    FeedBytes(buffer, size);
+    FeedBytes(buffer, size);
+    TEST_CHECK_EQUAL(sentResponses, 3);
+    CheckStatusResponse(3, 0);
+}
+
+static void TestCorruptRequests(void) {
+    uint8_t buffer[PROTO_HEADER_LEN + FLIGHT_LINK_MAX_REQUEST_SIZE + 1 + FLIGHT_LINK_TRAILER_LEN];
+    uint8_t payload[FLIGHT_LINK_MAX_REQUEST_SIZE + 1] = { FLIGHT_LINK_CMD_STATUS };
+    const uint8_t garbage[] = { 0x00, '\r', '\n', 0xFF, FLIGHT_LINK_MSG_ENUM + 1, 0x55 };
+    FlightLinkStats_TypeDef stats;
+    unsigned int size;
+
+    ResetLink();
+
+    /* Bad CRC */
+    size = BuildStatusRequest(buffer);
+    buffer[1] ^= 0x01;
+    FeedBytes(buffer, size);
+    TEST_CHECK_EQUAL(sentResponses, 0);
+
+    /* Bad trailer */
+    size = BuildStatusRequest(buffer);
+    buffer[size - 1] = 'x';
+    FeedBytes(buffer, size);
+    TEST_CHECK_EQUAL(sentResponses, 0);
+
+    /* Empty and oversized payload */
+    size = BuildRequest(buffer, payload, 0);
+    FeedBytes(buffer, size);
+    size = BuildRequest(buffer, payload, sizeof(payload));
+    FeedBytes(buffer, size);
+    TEST_CHECK_EQUAL(sentResponses, 0);
+
+    GetFlightLinkStats(&stats);
+    TEST_CHECK(stats.badFrames >= 4);
+    TEST_CHECK_EQUAL(stats.requests, 0);
+
+    /* The parser resynchronizes on the next valid request after garbage */
+    FeedBytes(garbage, sizeof(garbage));
+    size = BuildStatusRequest(buffer);
+    FeedBytes(buffer, size);
+    TEST_CHECK_EQUAL(sentResponses, 1);
+    TEST_CHECK_EQUAL(parserLength, 0);
+    GetFlightLinkStats(&stats);
+    TEST_CHECK_EQUAL(stats.requests, 1);
+    CheckStatusResponse(1, stats.badFrames);
+}
+
+static void TestUnknownCommandAndTxDrop(void) {
+    uint8_t buffer[PROTO_HEADER_LEN + 2 + FLIGHT_LINK_TRAILER_LEN];
+    const uint8_t unknownCommand = 0x7F;
+    const uint8_t statusWithParameter[] = { FLIGHT_LINK_CMD_STATUS, 0x00 };
+    FlightLinkStats_TypeDef stats;
+
+    ResetLink();
+
+    FeedBytes(buffer, BuildRequest(buffer, &unknownCommand, 1));
+    FeedBytes(buffer, BuildRequest(buffer, statusWithParameter, sizeof(statusWithParameter)));
+    TEST_CHECK_EQUAL(sentResponses, 0);
+    TEST_CHECK_EQUAL(parserLength, 0);
+
+    /* A response that does not fit in the UART transmit buffer is dropped, never waited for */
+    uartFull = true;
+    FeedBytes(buffer, BuildStatusRequest(buffer));
+    TEST_CHECK_EQUAL(sentResponses, 0);
+
+    GetFlightLinkStats(&stats);
+    TEST_CHECK_EQUAL(stats.unknownCommands, 2);
+    TEST_CHECK_EQUAL(stats.requests, 1);
+    TEST_CHECK_EQUAL(stats.txDrops, 1);
+    TEST_CHECK_EQUAL(stats.badFrames, 0);
+    TEST_CHECK_EQUAL(stats.droppedBytes, 0);
+}
+
+int main(void) {
+    TEST_RUN(TestStatusRequest);
+    TEST_RUN(TestCorruptRequests);
+    TEST_RUN(TestUnknownCommandAndTxDrop);
+
+    return TEST_RESULT();
+}
+
+/**
+ * @}
+ */
+
+/**
+ * @}
+ */
+/*****END OF FILE****/
@@ -0,0 +1,221 @@
+/******************************************************************************
+ * @brief   Software in the loop test of a loop rate profile (loop_rate.h),
+ *          built once per LOOP_RATE_HZ:
+ *          - the timing derived from the loop rate: timer periods, ESC pulse
+ *            range, task and sample periods, slack monitor windows and the
+ *            gyroscope data rate of the profile
+ *          - the attitude estimator (state_estimation.c) run at the loop rate
+ *            with simulated gyroscope and accelerometer readings. It must
+ *            track a roll and pitch manoeuvre and recover from an initial
+ *            attitude error in the same time at every loop rate, which checks
+ *            that the sample period and the noise scaling follow the profile.
+ *
+ *          The CPU budget of the profile is checked when loop_rate.h is
+ *          compiled. The PID control signals are zero, the adaptive sampling
+ *          and the RTOS tick count are faked.
+ *
+ * @license
+ * Dragonfly FCB firmware to control the Dragonfly quadrotor UAV
+ * Copyright (C) 2016  ÅF Technology South: Dragonfly Project
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA
+ *****************************************************************************/
+
+/* Includes ------------------------------------------------------------------*/
+#include "test_common.h"
+
+#include "loop_rate.h"
+#include "flight_control.h"
+#include "motor_control.h"
+#include "state_estimation.h"
+#include "slack_monitor.h"
+#include "adaptive_sampling.h"
+#include "fcb_gyroscope.h"
+#include "l3gd20.h"
+
+#include "FreeRTOS.h"
+#include "task.h"
+
+/* Private define ------------------------------------------------------------*/
+#define ACC_RATE_HZ             100     // Accelerometer corrections, independent of the loop rate
+#define MANOEUVRE_AMPLITUDE     0.4     // [rad]
+#define MANOEUVRE_FREQUENCY     0.5     // [Hz]
+#define MANOEUVRE_TIME          10.0    // [s]
+#define TRACKING_TOLERANCE      0.02    // RMS attitude error during the manoeuvre [rad]
+#define INITIAL_ERROR           0.3     // [rad]
+#define RECOVERED_ERROR         0.01    // [rad]
+
+/* Recovery time from the initial attitude error, as measured at LOOP_REFERENCE_RATE_HZ. The other profiles must be
+ * within the tolerance of it [s] */
+#define REFERENCE_RECOVERY_TIME 0.47
+#define RECOVERY_TOLERANCE      0.15
+
+/* Private variables ---------------------------------------------------------*/
+static portTickType tickCount = 0;
+
+/* Fakes ---------------------------------------------------------------------*/
+uint32_t SystemCoreClock = LOOP_CPU_CLOCK_HZ;
+
+const float32_t GYRO_X_AXIS_VARIANCE = 0.098603;
+const float32_t GYRO_Y_AXIS_VARIANCE = 0.104274;
+const float32_t GYRO_Z_AXIS_VARIANCE = 0.103256;
+
+portTickType xTaskGetTickCount(void) {
+    return tickCount;
+}
+
+float32_t GetRollControlSignal(void) {
+    return 0.0f;
+}
+
+float32_t GetPitchControlSignal(void) {
+    return 0.0f;
+}
+
+float32_t GetYawControlSignal(void) {
+    return 0.0f;
+}
+
+void UpdateAdaptiveSampling(const AdaptiveSensor_TypeDef sensor, const float32_t innovation,
+        const float32_t errorVariance, const uint32_t timeMs) {
+    (void) sensor;
+    (void) innovation;
+    (void) errorVariance;
+    (void) timeMs;
+}
+
+void ErrorHandler(void) {
+    TEST_CHECK(!"ErrorHandler called");
+}
+
+/* Private functions ---------------------------------------------------------*/
+
+/* Body frame accelerometer reading at rest with the given roll and pitch, in the convention of
+ * GetAttitudeFromAccelerometer */
+static void AccFromAttitude(float32_t acc[3], const double roll, const double pitch) {
+    acc[0] = (float32_t) (9.82*sin(pitch));
+    acc[1] = (float32_t) (-9.82*cos(pitch)*sin(roll));
+    acc[2] = (float32_t) (-9.82*cos(pitch)*cos(roll));
+}
+
+/* Body frame angular rate of the given Euler angle rates at zero yaw rate */
+static void GyroFromAttitudeRates(float32_t gyro[3], const double roll, const double pitch, const double rollRate,
+        const double pitchRate) {
+    gyro[0] = (float32_t) (rollRate);
+    gyro[1] = (float32_t) (cos(roll)*pitchRate);
+    gyro[2] = (float32_t) (-sin(roll)*pitchRate);
+    (void) pitch;
+}
+
+/*
+ * Runs the estimator for a number of loops. Each loop runs the prediction and the gyroscope correction like the
+ * flight control task, the accelerometer corrections come at ACC_RATE_HZ. Returns the RMS roll and pitch error.
+ */
+static double RunEstimator(const uint32_t loops, const double amplitude, double* recoveryTime) {
+    const uint32_t accDivider = LOOP_RATE_HZ / ACC_RATE_HZ;
+    const double w = 2.0*M_PI*MANOEUVRE_FREQUENCY;
+    float32_t gyro[3], acc[3];
+    double t, roll, pitch, rollRate, pitchRate, error, squaredErrorSum = 0.0;
+    uint32_t loop;
+
+    *recoveryTime = -1.0;
+    for (loop = 1; loop <= loops; loop++) {
+        t = (double) loop / LOOP_RATE_HZ;
+        tickCount = (portTickType) (t*configTICK_RATE_HZ);
+        roll = amplitude*sin(w*t);
+        pitch = 0.5*amplitude*sin(0.5*w*t);
+        rollRate = amplitude*w*cos(w*t);
+        pitchRate = 0.25*amplitude*w*cos(0.5*w*t);
+
+        UpdatePredictionState();
+        GyroFromAttitudeRates(gyro, roll, pitch, rollRate, pitchRate);
+        UpdateCorrectionState(GYRO_IDX, gyro);
+        if (loop % accDivider == 0) {
+            AccFromAttitude(acc, roll, pitch);
+            UpdateCorrectionState(ACC_IDX, acc);
+        }
+
+        error = fmax(fabs(GetRollAngle() - roll), fabs(GetPitchAngle() - pitch));
+        squaredErrorSum += error*error;
+        if (error > RECOVERED_ERROR)
+            *recoveryTime = -1.0;
+        else if (*recoveryTime < 0.0)
+            *recoveryTime = t;
+    }
+
+    return sqrt(squaredErrorSum / loops);
+}
+
+static void TestProfileTiming(void) {
+    TEST_CHECK_EQUAL(LOOP_TIMER_PERIOD_TICKS * LOOP_RATE_HZ, LOOP_TIMER_CLOCK_HZ);
+    TEST_CHECK_EQUAL(MOTOR_OUTPUT_PERIOD + 1, LOOP_TIMER_PERIOD_TICKS);
+    TEST_CHECK_EQUAL(STATE_ESTIMATION_TIME_UPDATE_PERIOD, MOTOR_OUTPUT_PERIOD);
+    TEST_CHECK(ESC_MIN_OUTPUT < ESC_MAX_OUTPUT);
+    TEST_CHECK(ESC_MAX_OUTPUT < MOTOR_OUTPUT_PERIOD);
+    TEST_CHECK_CLOSE(FLIGHT_CONTROL_TASK_PERIOD * LOOP_RATE_HZ, 1000.0, 1e-9);
+    TEST_CHECK_CLOSE(STATE_ESTIMATION_SAMPLE_PERIOD * LOOP_RATE_HZ, 1.0, 1e-6);
+    TEST_CHECK_CLOSE(Q1_RP * LOOP_RATE_HZ, 0.0008 * LOOP_REFERENCE_RATE_HZ, 1e-6);
+    TEST_CHECK_EQUAL(SLACK_WINDOW_CYCLES * 10, LOOP_RATE_HZ);
+    TEST_CHECK_EQUAL(LOOP_RATE_HZ % ACC_RATE_HZ, 0);
+
+    /* The gyroscope runs at its highest data rate in the high rate profiles */
+    if (LOOP_RATE_HZ > LOOP_REFERENCE_RATE_HZ)
+        TEST_CHECK_EQUAL(GYRO_OUTPUT_DATARATE, L3GD20_OUTPUT_DATARATE_4);
+    else
+        TEST_CHECK_EQUAL(GYRO_OUTPUT_DATARATE, L3GD20_OUTPUT_DATARATE_3);
+
+    printf("Profile %d Hz: %d timer ticks, %d CPU cycles per loop, loop cost bound %d cycles%s\n", LOOP_RATE_HZ,
+            LOOP_TIMER_PERIOD_TICKS, LOOP_CPU_CYCLES_PER_PERIOD, LOOP_COST_TOTAL,
+            LOOP_COSTS_MEASURED ? "" : " (estimated)");
+}
+
+static void TestManoeuvreTracking(void) {
+    float32_t initAngles[3] = { 0.0f, 0.0f, 0.0f };
+    double rmsError, recoveryTime;
+
+    InitStatesXYZ(initAngles);
+    rmsError = RunEstimator((uint32_t) (MANOEUVRE_TIME*LOOP_RATE_HZ), MANOEUVRE_AMPLITUDE, &recoveryTime);
+    printf("RMS attitude error during the manoeuvre: %.4f rad\n", rmsError);
+    TEST_CHECK(rmsError < TRACKING_TOLERANCE);
+}
+
+static void TestRecoveryTime(void) {
+    float32_t initAngles[3] = { (float32_t) INITIAL_ERROR, (float32_t) -INITIAL_ERROR, 0.0f };
+    double recoveryTime;
+
+    InitStatesXYZ(initAngles);
+    RunEstimator((uint32_t) (3*REFERENCE_RECOVERY_TIME*LOOP_RATE_HZ), 0.0, &recoveryTime);
+    printf("Recovery from %.2f rad attitude error: %.3f s\n", INITIAL_ERROR, recoveryTime);
+    TEST_CHECK(recoveryTime > 0.0);
+    TEST_CHECK_CLOSE(recoveryTime, REFERENCE_RECOVERY_TIME, REFERENCE_RECOVERY_TIME*RECOVERY_TOLERANCE);
+}
+
+/* Exported functions --------------------------------------------------------*/
+
+int main(void) {
+    TEST_RUN(TestProfileTiming);
+    TEST_RUN(TestManoeuvreTracking);
+    TEST_RUN(TestRecoveryTime);
+    return TEST_RESULT();
+}
+
+/**
+ * @}
+ */
+
+/**
+ * @}
+ */
+/*****END OF FILE****/
@@ -0,0 +1,176 @@
+/******************************************************************************
+ * @brief   Host tests of the table based functions in math_tables.h against
+ *          libm:
+ *          - FastSinCos over one period, at the table ends and the wrap at
+ *            +-pi, and over several periods in both directions
+ *          - FastSinCos of large angles, which are reduced to one period
+ *            before the integer cast, and of NaN and infinity
+ *          - PressureToAltitude for every pressure of the table range and the
+ *            saturation at and below PRESSURE_TABLE_MIN and above the table
+ *
+ *          The limits are the ones tools/gen_math_tables.py verifies the
+ *          tables against, plus the float rounding of the angle.
+ *
+ * @license
+ * Dragonfly FCB firmware to control the Dragonfly quadrotor UAV
+ * Copyright (C) 2016  ÅF Technology South: Dragonfly Project
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA
+ *****************************************************************************/
+
+/* Includes ------------------------------------------------------------------*/
+#include "test_common.h"
+
+#include "math_tables.h"
+
+#include <float.h>
+
+/* Private define ------------------------------------------------------------*/
+#define SIN_TOLERANCE           5e-5    // --max-sin-error of gen_math_tables.py
+#define ANGLE_ROUNDING          1e-6    // Relative float rounding of the angle, added per radian
+#define ALTITUDE_TOLERANCE      0.1     // --max-altitude-error of gen_math_tables.py [m]
+#define SWEEP_STEPS             100000
+#define PRESSURE_TABLE_MAX      (PRESSURE_TABLE_MIN + (PRESSURE_TABLE_SIZE - 1)*(1 << PRESSURE_TABLE_STEP_SHIFT))
+
+/* Private functions ---------------------------------------------------------*/
+
+static double ExactAltitude(const double pressure) {
+    return 44330.0*(1.0 - pow(pressure/101325.0, 1.0/5.255));
+}
+
+/* Checks FastSinCos at angle against libm, with the float rounding of the angle taken into account */
+static void CheckSinCos(const float32_t angle) {
+    const double tolerance = SIN_TOLERANCE + ANGLE_ROUNDING*fabs(angle);
+    float32_t sinValue, cosValue;
+
+    FastSinCos(angle, &sinValue, &cosValue);
+    TEST_CHECK_CLOSE(sinValue, sin(angle), tolerance);
+    TEST_CHECK_CLOSE(cosValue, cos(angle), tolerance);
+    TEST_CHECK_CLOSE(FastSin(angle), sinValue, 0.0);
+    TEST_CHECK_CLOSE(FastCos(angle), cosValue, 0.0);
+}
+
+static void TestSinCosPeriod(void) {
+    double maxError = 0.0;
+    float32_t sinValue, cosValue, angle;
+    int i;
+
+    for (i = 0; i <= SWEEP_STEPS; i++) {
+        angle = (float32_t) (-M_PI + 2.0*M_PI*i/SWEEP_STEPS);
+        CheckSinCos(angle);
+        FastSinCos(angle, &sinValue, &cosValue);
+        maxError = fmax(maxError, fmax(fabs(sinValue - sin(angle)), fabs(cosValue - cos(angle))));
+    }
+    printf("FastSinCos max error over [-pi, pi]: %.2e\n", maxError);
+}
+
+static void TestSinCosTableEnds(void) {
+    const float32_t step = 2.0f*PI/SIN_TABLE_SIZE;
+    const float32_t angles[] = { 0.0f, -0.0f, 1e-9f, -1e-9f, step, -step, step/2.0f, -step/2.0f, PI/2.0f, -PI/2.0f,
+            PI, -PI, nextafterf(PI, 0.0f), nextafterf(-PI, 0.0f), nextafterf(PI, 4.0f), nextafterf(-PI, -4.0f),
+            2.0f*PI, -2.0f*PI, nextafterf(2.0f*PI, 0.0f), nextafterf(-2.0f*PI, 0.0f), 2.0f*PI - step/2.0f };
+    unsigned int i;
+
+    for (i = 0; i < sizeof(angles)/sizeof(angles[0]); i++)
+        CheckSinCos(angles[i]);
+}
+
+static void TestSinCosWrap(void) {
+    float32_t angle;
+    int i, period;
+
+    /* Wrap at +-pi and several periods away in both directions */
+    for (period = -4; period <= 4; period++) {
+        for (i = 0; i <= SWEEP_STEPS/100; i++) {
+            angle = (float32_t) (-M_PI + 2.0*M_PI*i/(SWEEP_STEPS/100) + 2.0*M_PI*period);
+            CheckSinCos(angle);
+        }
+    }
+}
+
+static void TestSinCosLargeAndNonFinite(void) {
+    const float32_t large[] = { 1e5f, -1e5f, 205887.4f, 1e6f, -1e6f, 1e7f, 3e8f, -3e8f, 1e30f, -1e30f, FLT_MAX,
+            -FLT_MAX };
+    const float32_t nonFinite[] = { NAN, -NAN, INFINITY, -INFINITY };
+    float32_t sinValue, cosValue;
+    unsigned int i;
+
+    /* Large angles are far coarser than the table, so only check that the result is a point on the circle */
+    for (i = 0; i < sizeof(large)/sizeof(large[0]); i++) {
+        FastSinCos(large[i], &sinValue, &cosValue);
+        TEST_CHECK(fabsf(sinValue) <= 1.0f && fabsf(cosValue) <= 1.0f);
+        TEST_CHECK_CLOSE(sinValue*sinValue + cosValue*cosValue, 1.0, 2.0*SIN_TOLERANCE);
+    }
+
+    /* Both sides of the reduction */
+    CheckSinCos(nextafterf(SIN_TABLE_REDUCE_ANGLE, 0.0f));
+    CheckSinCos(SIN_TABLE_REDUCE_ANGLE);
+    CheckSinCos(-SIN_TABLE_REDUCE_ANGLE);
+
+    for (i = 0; i < sizeof(nonFinite)/sizeof(nonFinite[0]); i++) {
+        FastSinCos(nonFinite[i], &sinValue, &cosValue);
+        TEST_CHECK(isnan(sinValue) && isnan(cosValue));
+    }
+}
+
+static void TestPressureToAltitude(void) {
+    double maxError = 0.0;
+    int32_t pressure;
+
+    for (pressure = PRESSURE_TABLE_MIN; pressure <= PRESSURE_TABLE_MAX; pressure++) {
+        TEST_CHECK_CLOSE(PressureToAltitude(pressure), ExactAltitude(pressure), ALTITUDE_TOLERANCE);
+        maxError = fmax(maxError, fabs(PressureToAltitude(pressure) - ExactAltitude(pressure)));
+        if (pressure > PRESSURE_TABLE_MIN)
+            TEST_CHECK(PressureToAltitude(pressure) < PressureToAltitude(pressure - 1));
+    }
+    printf("PressureToAltitude max error over [%d, %d] Pa: %.3f m\n", PRESSURE_TABLE_MIN, PRESSURE_TABLE_MAX,
+            maxError);
+}
+
+static void TestPressureSaturation(void) {
+    const int32_t below[] = { PRESSURE_TABLE_MIN, PRESSURE_TABLE_MIN - 1, 20000, 1, 0, -1, -100000 };
+    const int32_t above[] = { PRESSURE_TABLE_MAX, PRESSURE_TABLE_MAX + 1, 120000, 1000000 };
+    unsigned int i;
+
+    for (i = 0; i < sizeof(below)/sizeof(below[0]); i++)
+        TEST_CHECK_CLOSE(PressureToAltitude(below[i]), ExactAltitude(PRESSURE_TABLE_MIN), ALTITUDE_TOLERANCE);
+    for (i = 0; i < sizeof(above)/sizeof(above[0]); i++)
+        TEST_CHECK_CLOSE(PressureToAltitude(above[i]), ExactAltitude(PRESSURE_TABLE_MAX), ALTITUDE_TOLERANCE);
+
+    /* The last interval interpolates up to the last entry without reading past the table */
+    TEST_CHECK_CLOSE(PressureToAltitude(PRESSURE_TABLE_MAX - 1), ExactAltitude(PRESSURE_TABLE_MAX - 1),
+            ALTITUDE_TOLERANCE);
+}
+
+/* Exported functions --------------------------------------------------------*/
+
+int main(void) {
+    TEST_RUN(TestSinCosPeriod);
+    TEST_RUN(TestSinCosTableEnds);
+    TEST_RUN(TestSinCosWrap);
+    TEST_RUN(TestSinCosLargeAndNonFinite);
+    TEST_RUN(TestPressureToAltitude);
+    TEST_RUN(TestPressureSaturation);
+    return TEST_RESULT();
+}
+
+/**
+ * @}
+ */
+
+/**
+ * @}
+ */
+/*****END OF FILE****/
@@ -0,0 +1,389 @@
+/******************************************************************************
+ * @brief   Host tests of the receiver edge capture and decoding
+ *          (fcb/src/receiver_capture.c):
+ *          - GetReceiverEdgeTimestamp with and without a pending timer update,
+ *            and across the wrap of the 32-bit timestamp
+ *          - the edge buffer order, index wrap and full buffer drops
+ *          - DecodeReceiverEdge on overcaptures, out of order edges and
+ *            invalid widths
+ *          - a simulation of the capture ISR of receiver.c, with the capture
+ *            ISR serviced late and edges close to the timer update, and the
+ *            deferred batch decoding delayed by up to two timer periods,
+ *            decoding a pulse train through the timestamp wrap
+ *
+ * @license
+ * Dragonfly FCB firmware to control the Dragonfly quadrotor UAV
+ * Copyright (C) 2016  ÅF Technology South: Dragonfly Project
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA
+ *****************************************************************************/
+
+/* Includes ------------------------------------------------------------------*/
+#include "test_common.h"
+
+#include "receiver_capture.h"
+
+#include <string.h>
+
+/* Private define ------------------------------------------------------------*/
+#define TICKS                   RECEIVER_EDGE_COUNTER_TICKS
+#define PULSE_PERIOD            396000      // 22 ms at the 18 MHz counter clock [ticks]
+#define SIM_PULSES              2000
+#define SIM_MAX_ISR_LATENCY     (TICKS/2 - 1)
+#define SIM_MAX_DECODE_LATENCY  (2*TICKS)
+
+/* Private typedef -----------------------------------------------------------*/
+
+/* Simulated receiver timer with one capture channel, as serviced by CaptureReceiverEdges() in receiver.c */
+typedef struct {
+    uint64_t updatesCounted;    // Timer updates handled by the ISR since the simulation start
+    uint16_t periodCount;       // The ISR's timer period count
+    bool capturePending;        // Capture flag
+    uint16_t capture;           // Capture register
+    uint8_t captureFlags;
+    ReceiverEdgeBuffer_TypeDef edges;
+    uint64_t decodeTime;        // Time the pended deferred decoding runs, UINT64_MAX if not pended
+} SimTimer_TypeDef;
+
+/* Expected results of the simulated pulse train */
+typedef struct {
+    uint32_t edgeTimestamp[2*SIM_PULSES];
+    uint32_t width[SIM_PULSES];
+    uint32_t period[SIM_PULSES];
+    int decodedEdges;
+    int decodedPulses;
+    int wrapped;
+} SimExpected_TypeDef;
+
+/* Private variables ---------------------------------------------------------*/
+static uint32_t randomState = 12345;
+static SimExpected_TypeDef simExpected;
+
+/* Private functions ---------------------------------------------------------*/
+
+static uint32_t Random(const uint32_t range) {
+    randomState = randomState*1103515245 + 12345;
+    return (randomState >> 8) % range;
+}
+
+static void TestEdgeTimestamp(void) {
+    /* No update pending, the capture is in the counted period */
+    TEST_CHECK_EQUAL(GetReceiverEdgeTimestamp(0, 0, false), 0);
+    TEST_CHECK_EQUAL(GetReceiverEdgeTimestamp(3, 1234, false), 3*TICKS + 1234);
+    TEST_CHECK_EQUAL(GetReceiverEdgeTimestamp(3, TICKS - 1, false), 4*TICKS - 1);
+
+    /* Update pending: a capture in the lower half was made after the update, one in the upper half before it */
+    TEST_CHECK_EQUAL(GetReceiverEdgeTimestamp(3, 0, true), 4*TICKS);
+    TEST_CHECK_EQUAL(GetReceiverEdgeTimestamp(3, TICKS/2 - 1, true), 4*TICKS + TICKS/2 - 1);
+    TEST_CHECK_EQUAL(GetReceiverEdgeTimestamp(3, TICKS/2, true), 3*TICKS + TICKS/2);
+    TEST_CHECK_EQUAL(GetReceiverEdgeTimestamp(3, TICKS - 1, true), 4*TICKS - 1);
+
+    /* The timestamp wraps with the 16-bit period count */
+    TEST_CHECK_EQUAL(GetReceiverEdgeTimestamp(UINT16_MAX, TICKS - 1, false), UINT32_MAX);
+    TEST_CHECK_EQUAL(GetReceiverEdgeTimestamp(UINT16_MAX, 10, true), 10);
+    TEST_CHECK_EQUAL(GetReceiverEdgeTimestamp(UINT16_MAX, TICKS - 10, true), UINT32_MAX - 9);
+}
+
+static void TestEdgeBuffer(void) {
+    ReceiverEdgeBuffer_TypeDef buffer;
+    uint32_t timestamp;
+    uint8_t flags;
+    int i, round;
+
+    ResetReceiverEdgeBuffer(&buffer);
+    TEST_CHECK(!PopReceiverEdge(&buffer, &timestamp, &flags));
+
+    /* One slot is kept free, a full buffer drops the newest edge */
+    for (i = 0; i < RECEIVER_EDGE_BUFFER_SIZE; i++)
+        PushReceiverEdge(&buffer, 100 + i, (uint8_t) (i & RECEIVER_EDGE_RISING));
+    TEST_CHECK_EQUAL(buffer.droppedEdges, 1);
+    for (i = 0; i < RECEIVER_EDGE_BUFFER_SIZE - 1; i++) {
+        TEST_CHECK(PopReceiverEdge(&buffer, &timestamp, &flags));
+        TEST_CHECK_EQUAL(timestamp, 100 + i);
+        TEST_CHECK_EQUAL(flags, i & RECEIVER_EDGE_RISING);
+    }
+    TEST_CHECK(!PopReceiverEdge(&buffer, &timestamp, &flags));
+
+    /* Order is kept across the index wrap */
+    for (round = 0; round < 3*RECEIVER_EDGE_BUFFER_SIZE; round++) {
+        PushReceiverEdge(&buffer, 2*round, RECEIVER_EDGE_RISING);
+        PushReceiverEdge(&buffer, 2*round + 1, 0);
+        TEST_CHECK(PopReceiverEdge(&buffer, &timestamp, &flags));
+        TEST_CHECK_EQUAL(timestamp, 2*round);
+        TEST_CHECK_EQUAL(flags, RECEIVER_EDGE_RISING);
+        TEST_CHECK(PopReceiverEdge(&buffer, &timestamp, &flags));
+        TEST_CHECK_EQUAL(timestamp, 2*round + 1);
+        TEST_CHECK_EQUAL(flags, 0);
+    }
+    TEST_CHECK_EQUAL(buffer.droppedEdges, 1);
+}
+
+static void TestDecodeWrap(void) {
+    ReceiverEdgeDecoder_TypeDef decoder;
+    ReceiverPulse_TypeDef pulse;
+    const uint32_t width = RECEIVER_PULSE_DEFAULT_MID_COUNT;
+    const uint32_t rising = UINT32_MAX - width/2;
+
+    ResetReceiverEdgeDecoder(&decoder);
+    TEST_CHECK(!DecodeReceiverEdge(&decoder, rising - PULSE_PERIOD, RECEIVER_EDGE_RISING, &pulse));
+    TEST_CHECK(DecodeReceiverEdge(&decoder, rising - PULSE_PERIOD + width, 0, &pulse));
+    TEST_CHECK_EQUAL(pulse.period, 0);
+    TEST_CHECK(!IsReceiverPulsePeriodValid(&pulse));
+
+    /* The pulse spans the timestamp wrap */
+    TEST_CHECK(!DecodeReceiverEdge(&decoder, rising, RECEIVER_EDGE_RISING, &pulse));
+    TEST_CHECK(DecodeReceiverEdge(&decoder, rising + width, 0, &pulse));
+    TEST_CHECK_EQUAL(pulse.width, width);
+    TEST_CHECK_EQUAL(pulse.period, PULSE_PERIOD);
+    TEST_CHECK_EQUAL(pulse.risingTimestamp, rising);
+    TEST_CHECK(IsReceiverPulsePeriodValid(&pulse));
+
+    /* The period spans the timestamp wrap */
+    TEST_CHECK(!DecodeReceiverEdge(&decoder, rising + PULSE_PERIOD, RECEIVER_EDGE_RISING, &pulse));
+    TEST_CHECK(DecodeReceiverEdge(&decoder, rising + PULSE_PERIOD + width, 0, &pulse));
+    TEST_CHECK_EQUAL(pulse.period, PULSE_PERIOD);
+    TEST_CHECK_EQUAL(decoder.lostEdges, 0);
+    TEST_CHECK_EQUAL(decoder.invalidPulses, 0);
+}
+
+static void TestDecodeOvercapture(void) {
+    ReceiverEdgeDecoder_TypeDef decoder;
+    ReceiverPulse_TypeDef pulse;
+    const uint32_t width = RECEIVER_PULSE_DEFAULT_MID_COUNT;
+    uint32_t t = 1000;
+
+    ResetReceiverEdgeDecoder(&decoder);
+    TEST_CHECK(!DecodeReceiverEdge(&decoder, t, RECEIVER_EDGE_RISING, &pulse));
+    TEST_CHECK(DecodeReceiverEdge(&decoder, t + width, 0, &pulse));
+    t += PULSE_PERIOD;
+
+    /* The falling edge overwrote a lost edge, the width from the rising edge can not be trusted */
+    TEST_CHECK(!DecodeReceiverEdge(&decoder, t, RECEIVER_EDGE_RISING, &pulse));
+    TEST_CHECK(!DecodeReceiverEdge(&decoder, t + width, RECEIVER_EDGE_OVERCAPTURE, &pulse));
+    TEST_CHECK_EQUAL(decoder.lostEdges, 1);
+    t += PULSE_PERIOD;
+
+    /* A rising edge with overcapture starts a new pulse, the period across the lost edge is unknown */
+    TEST_CHECK(!DecodeReceiverEdge(&decoder, t, RECEIVER_EDGE_RISING | RECEIVER_EDGE_OVERCAPTURE, &pulse));
+    TEST_CHECK_EQUAL(decoder.lostEdges, 2);
+    TEST_CHECK(DecodeReceiverEdge(&decoder, t + width, 0, &pulse));
+    TEST_CHECK_EQUAL(pulse.width, width);
+    TEST_CHECK_EQUAL(pulse.period, 0);
+    t += PULSE_PERIOD;
+
+    /* Back in sequence */
+    TEST_CHECK(!DecodeReceiverEdge(&decoder, t, RECEIVER_EDGE_RISING, &pulse));
+    TEST_CHECK(DecodeReceiverEdge(&decoder, t + width, 0, &pulse));
+    TEST_CHECK_EQUAL(pulse.period, PULSE_PERIOD);
+    TEST_CHECK_EQUAL(decoder.lostEdges, 2);
+}
+
+static void TestDecodeOutOfOrder(void) {
+    ReceiverEdgeDecoder_TypeDef decoder;
+    ReceiverPulse_TypeDef pulse;
+    const uint32_t width = RECEIVER_PULSE_DEFAULT_MID_COUNT;
+    uint32_t t = 5000;
+
+    /* A falling edge first, e.g. started in the middle of a pulse */
+    ResetReceiverEdgeDecoder(&decoder);
+    TEST_CHECK(!DecodeReceiverEdge(&decoder, t, 0, &pulse));
+    TEST_CHECK_EQUAL(decoder.lostEdges, 1);
+
+    /* Two rising edges in a row, the falling edge between them was lost. The second one starts the pulse. */
+    t += PULSE_PERIOD;
+    TEST_CHECK(!DecodeReceiverEdge(&decoder, t, RECEIVER_EDGE_RISING, &pulse));
+    TEST_CHECK(!DecodeReceiverEdge(&decoder, t + PULSE_PERIOD, RECEIVER_EDGE_RISING, &pulse));
+    TEST_CHECK_EQUAL(decoder.lostEdges, 2);
+    t += PULSE_PERIOD;
+    TEST_CHECK(DecodeReceiverEdge(&decoder, t + width, 0, &pulse));
+    TEST_CHECK_EQUAL(pulse.risingTimestamp, t);
+    TEST_CHECK_EQUAL(pulse.period, 0);
+
+    /* Two falling edges in a row, the rising edge between them was lost */
+    TEST_CHECK(!DecodeReceiverEdge(&decoder, t + width + PULSE_PERIOD, 0, &pulse));
+    TEST_CHECK_EQUAL(decoder.lostEdges, 3);
+    t += 2*PULSE_PERIOD;
+    TEST_CHECK(!DecodeReceiverEdge(&decoder, t, RECEIVER_EDGE_RISING, &pulse));
+    TEST_CHECK(DecodeReceiverEdge(&decoder, t + width, 0, &pulse));
+    TEST_CHECK_EQUAL(pulse.period, 0);
+    TEST_CHECK_EQUAL(decoder.invalidPulses, 0);
+}
+
+static void TestDecodeInvalidWidth(void) {
+    ReceiverEdgeDecoder_TypeDef decoder;
+    ReceiverPulse_TypeDef pulse;
+    uint32_t t = 0;
+
+    ResetReceiverEdgeDecoder(&decoder);
+    TEST_CHECK(!DecodeReceiverEdge(&decoder, t, RECEIVER_EDGE_RISING, &pulse));
+    TEST_CHECK(!DecodeReceiverEdge(&decoder, t + RECEIVER_MIN_VALID_IC_PULSE_COUNT - 1, 0, &pulse));
+    t += PULSE_PERIOD;
+    TEST_CHECK(!DecodeReceiverEdge(&decoder, t, RECEIVER_EDGE_RISING, &pulse));
+    TEST_CHECK(!DecodeReceiverEdge(&decoder, t + RECEIVER_MAX_VALID_IC_PULSE_COUNT + 1, 0, &pulse));
+    TEST_CHECK_EQUAL(decoder.invalidPulses, 2);
+
+    /* The period is still measured across invalid pulses */
+    t += PULSE_PERIOD;
+    TEST_CHECK(!DecodeReceiverEdge(&decoder, t, RECEIVER_EDGE_RISING, &pulse));
+    TEST_CHECK(DecodeReceiverEdge(&decoder, t + RECEIVER_MIN_VALID_IC_PULSE_COUNT, 0, &pulse));
+    TEST_CHECK_EQUAL(pulse.period, PULSE_PERIOD);
+    t += PULSE_PERIOD;
+    TEST_CHECK(!DecodeReceiverEdge(&decoder, t, RECEIVER_EDGE_RISING, &pulse));
+    TEST_CHECK(DecodeReceiverEdge(&decoder, t + RECEIVER_MAX_VALID_IC_PULSE_COUNT, 0, &pulse));
+    TEST_CHECK_EQUAL(decoder.lostEdges, 0);
+}
+
+/*
+ * Runs the capture ISR of the simulated timer at a time, like CaptureReceiverEdges(): the capture is extended with
+ * the period count and whether the update is pending, then the update is handled and the decoding is pended. The ISR
+ * runs at least once per timer period.
+ */
+static void RunSimIsr(SimTimer_TypeDef* timer, const uint64_t time) {
+    const bool updatePending = time / TICKS > timer->updatesCounted;
+
+    if (timer->capturePending) {
+        PushReceiverEdge(&timer->edges, GetReceiverEdgeTimestamp(timer->periodCount, timer->capture, updatePending),
+                timer->captureFlags);
+        timer->capturePending = false;
+    }
+
+    if (updatePending) {
+        timer->updatesCounted++;
+        timer->periodCount++;
+        if (timer->decodeTime == UINT64_MAX)
+            timer->decodeTime = time + Random(SIM_MAX_DECODE_LATENCY);
+    }
+}
+
+/* Runs the deferred decoding like HandleReceiverDeferredIRQ() if it is pended and due at a time */
+static void RunSimDecode(SimTimer_TypeDef* timer, ReceiverEdgeDecoder_TypeDef* decoder, const uint64_t time) {
+    ReceiverPulse_TypeDef pulse;
+    uint32_t timestamp;
+    uint8_t flags;
+    int pulseIndex;
+
+    if (time < timer->decodeTime)
+        return;
+    timer->decodeTime = UINT64_MAX;
+
+    while (PopReceiverEdge(&timer->edges, &timestamp, &flags)) {
+        /* The timestamp is the edge time, counted from the initial period count */
+        TEST_CHECK_EQUAL(timestamp, simExpected.edgeTimestamp[simExpected.decodedEdges]);
+        TEST_CHECK_EQUAL(flags, simExpected.decodedEdges % 2 == 0 ? RECEIVER_EDGE_RISING : 0);
+        if (timestamp < (uint32_t) ((UINT16_MAX - 20)*TICKS))
+            simExpected.wrapped++;
+        simExpected.decodedEdges++;
+
+        if (DecodeReceiverEdge(decoder, timestamp, flags, &pulse)) {
+            pulseIndex = simExpected.decodedPulses++;
+            TEST_CHECK_EQUAL(pulse.width, simExpected.width[pulseIndex]);
+            if (pulseIndex > 0)
+                TEST_CHECK_EQUAL(pulse.period, simExpected.period[pulseIndex]);
+        }
+    }
+}
+
+/* Captures an edge at a time on the simulated timer */
+static void SimEdge(SimTimer_TypeDef* timer, const uint64_t time, const uint8_t flags) {
+    TEST_CHECK(!timer->capturePending);
+    timer->capture = (uint16_t) (time % TICKS);
+    timer->captureFlags = flags;
+    timer->capturePending = true;
+}
+
+static void TestCaptureSimulation(void) {
+    SimTimer_TypeDef timer;
+    ReceiverEdgeDecoder_TypeDef decoder;
+    uint64_t risingTime, previousRisingTime = 0, edgeTime[2], isrTime, nextUpdateIsr;
+    uint32_t width;
+    int i, edge;
+
+    /* Start just before the 32-bit timestamp wraps */
+    timer.periodCount = UINT16_MAX - 20;
+    timer.updatesCounted = 0;
+    timer.capturePending = false;
+    timer.decodeTime = UINT64_MAX;
+    ResetReceiverEdgeBuffer(&timer.edges);
+    ResetReceiverEdgeDecoder(&decoder);
+    memset(&simExpected, 0, sizeof(simExpected));
+    nextUpdateIsr = TICKS + Random(SIM_MAX_ISR_LATENCY);
+
+    for (i = 0, risingTime = 1000; i < SIM_PULSES; i++, risingTime += PULSE_PERIOD + Random(4000) - 2000) {
+        width = RECEIVER_MIN_VALID_IC_PULSE_COUNT + Random(RECEIVER_MAX_VALID_IC_PULSE_COUNT
+                - RECEIVER_MIN_VALID_IC_PULSE_COUNT + 1);
+
+        /* Every few pulses, put the edges right before and after a timer update */
+        if (i % 4 == 1)
+            risingTime += TICKS - 1 - risingTime % TICKS;
+        else if (i % 4 == 3)
+            risingTime += TICKS - risingTime % TICKS;
+        edgeTime[0] = risingTime;
+        edgeTime[1] = risingTime + width;
+        simExpected.width[i] = width;
+        simExpected.period[i] = (uint32_t) (risingTime - previousRisingTime);
+
+        for (edge = 0; edge < 2; edge++) {
+            /* The ISRs of the updates before the edge run first. The capture ISR is serviced late, or together
+             * with a later update if that ISR comes first. The deferred decoding runs when it is due. */
+            while (nextUpdateIsr <= edgeTime[edge]) {
+                RunSimDecode(&timer, &decoder, nextUpdateIsr);
+                RunSimIsr(&timer, nextUpdateIsr);
+                nextUpdateIsr = (timer.updatesCounted + 1)*TICKS + Random(SIM_MAX_ISR_LATENCY);
+            }
+            isrTime = edgeTime[edge] + Random(SIM_MAX_ISR_LATENCY);
+            if (nextUpdateIsr < isrTime)
+                isrTime = nextUpdateIsr;
+
+            RunSimDecode(&timer, &decoder, edgeTime[edge]);
+            SimEdge(&timer, edgeTime[edge], edge == 0 ? RECEIVER_EDGE_RISING : 0);
+            simExpected.edgeTimestamp[2*i + edge] = (uint32_t) ((uint64_t) (UINT16_MAX - 20)*TICKS + edgeTime[edge]);
+            RunSimIsr(&timer, isrTime);
+            if (nextUpdateIsr <= isrTime)
+                nextUpdateIsr = (timer.updatesCounted + 1)*TICKS + Random(SIM_MAX_ISR_LATENCY);
+        }
+        previousRisingTime = risingTime;
+    }
+    timer.decodeTime = 0;
+    RunSimDecode(&timer, &decoder, 0);
+
+    TEST_CHECK_EQUAL(simExpected.decodedEdges, 2*SIM_PULSES);
+    TEST_CHECK_EQUAL(simExpected.decodedPulses, SIM_PULSES);
+    TEST_CHECK(simExpected.wrapped > 0);
+    TEST_CHECK_EQUAL(decoder.lostEdges, 0);
+    TEST_CHECK_EQUAL(decoder.invalidPulses, 0);
+    TEST_CHECK_EQUAL(timer.edges.droppedEdges, 0);
+}
+
+/* Exported functions --------------------------------------------------------*/
+
+int main(void) {
+    TEST_RUN(TestEdgeTimestamp);
+    TEST_RUN(TestEdgeBuffer);
+    TEST_RUN(TestDecodeWrap);
+    TEST_RUN(TestDecodeOvercapture);
+    TEST_RUN(TestDecodeOutOfOrder);
+    TEST_RUN(TestDecodeInvalidWidth);
+    TEST_RUN(TestCaptureSimulation);
+    return TEST_RESULT();
+}
+
+/**
+ * @}
+ */
+
+/**
+ * @}
+ */
+/*****END OF FILE****/
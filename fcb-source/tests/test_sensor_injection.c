@@ -0,0 +1,569 @@
+/******************************************************************************
+ * @brief   Host test of the sensor injection frame parser
+ *          (fcb/src/sensor_injection.c). Frames are fed byte by byte to
+ *          ParseSensorInjectionByte() like the RX tasks do:
+ *          - valid frames, with all and with part of the sensors, decoded
+ *            and published by ProcessInjectedSensorFrames()
+ *          - corrupt frames: bad CRC, size, trailer and message id, garbage
+ *            before a frame and a frame header in the payload
+ *          - truncated frames followed by a valid frame
+ *          - sensor task overrun and the empty stop frame
+ *
+ *          The frames are built like tools/injection_bridge.py does. The
+ *          queue, task, CRC, sensor publish and motor functions are faked,
+ *          and the Cortex-M private peripheral region is mapped into the test
+ *          process for the DWT cycle counter. sensor_injection.c is included
+ *          so that the test can check the parser state.
+ *
+ * @license
+ * Dragonfly FCB firmware to control the Dragonfly quadrotor UAV
+ * Copyright (C) 2016  ÅF Technology South: Dragonfly Project
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA
+ *****************************************************************************/
+
+/* Includes ------------------------------------------------------------------*/
+#include "test_common.h"
+
+#include "../fcb/src/sensor_injection.c"
+
+
+/* Private define ------------------------------------------------------------*/
+#define FAKE_QUEUE_MAX_ITEMS    8
+#define FAKE_QUEUE_COUNT        2
+#define FRAME_SIZE              (PROTO_HEADER_LEN + SENSOR_INJECTION_FRAME_SIZE + INJECTION_TRAILER_LEN)
+#define ALL_SENSORS             (SENSOR_INJECTION_GYRO | SENSOR_INJECTION_ACC | SENSOR_INJECTION_MAG \
+                                 | SENSOR_INJECTION_BARO)
+#define PPB_SIZE                0x100000    // Cortex-M private peripheral bus region
+
+/* Private typedef -----------------------------------------------------------*/
+typedef struct {
+    uint8_t items[FAKE_QUEUE_MAX_ITEMS][sizeof(InjectionQueueItem_TypeDef)];
+    unsigned int length, itemSize, head, count;
+} FakeQueue_TypeDef;
+
+/* Private variables ---------------------------------------------------------*/
+
+/* Fake queues, the frame queue is created first */
+static FakeQueue_TypeDef queues[FAKE_QUEUE_COUNT];
+static unsigned int queuesCreated = 0;
+
+/* Last values published by ProcessInjectedSensorFrames() */
+static float32_t injectedGyro[3], injectedAcc[3], injectedMag[3];
+static int32_t injectedPressure;
+static int gyroInjections, accInjections, magInjections, baroInjections;
+
+static int sensorMessages = 0;
+static int errorHandlerCalls = 0;
+
+/* Fakes ---------------------------------------------------------------------*/
+uint32_t SystemCoreClock = 72000000;
+
+xQueueHandle xQueueGenericCreate(unsigned portBASE_TYPE uxQueueLength, unsigned portBASE_TYPE uxItemSize,
+        unsigned char ucQueueType) {
+    FakeQueue_TypeDef* queue;
+    (void) ucQueueType;
+
+    if (queuesCreated >= FAKE_QUEUE_COUNT || uxQueueLength > FAKE_QUEUE_MAX_ITEMS
+            || uxItemSize > sizeof(queues[0].items[0]))
+        return NULL;
+
+    queue = &queues[queuesCreated++];
+    queue->length = uxQueueLength;
+    queue->itemSize = uxItemSize;
+    queue->head = 0;
+    queue->count = 0;
+    return (xQueueHandle) queue;
+}
+
+portBASE_TYPE xQueueGenericReset(xQueueHandle xQueue, portBASE_TYPE xNewQueue) {
+    FakeQueue_TypeDef* queue = (FakeQueue_TypeDef*) xQueue;
+    (void) xNewQueue;
+
+    queue->head = 0;
+    queue->count = 0;
+    return pdPASS;
+}
+
+signed portBASE_TYPE xQueueGenericSend(xQueueHandle xQueue, const void * const pvItemToQueue,
+        portTickType xTicksToWait, portBASE_TYPE xCopyPosition) {
+    FakeQueue_TypeDef* queue = (FakeQueue_TypeDef*) xQueue;
+    (void) xTicksToWait;
+    (void) xCopyPosition;
+
+    if (queue->count >= queue->length)
+        return errQUEUE_FULL;
+
+    memcpy(queue->items[(queue->head + queue->count) % queue->length], pvItemToQueue, queue->itemSize);
+    queue->count++;
+    return pdTRUE;
+}
+
+signed portBASE_TYPE xQueueGenericReceive(xQueueHandle xQueue, void * const pvBuffer, portTickType xTicksToWait,
+        portBASE_TYPE xJustPeek) {
+    FakeQueue_TypeDef* queue = (FakeQueue_TypeDef*) xQueue;
+    (void) xTicksToWait;
+    (void) xJustPeek;
+
+    if (queue->count == 0)
+        return pdFALSE;
+
+    memcpy(pvBuffer, queue->items[queue->head], queue->itemSize);
+    queue->head = (queue->head + 1) % queue->length;
+    queue->count--;
+    return pdTRUE;
+}
+
+signed portBASE_TYPE xTaskGenericCreate(pdTASK_CODE pxTaskCode, const signed char * const pcName,
+        unsigned short usStackDepth, void *pvParameters, unsigned portBASE_TYPE uxPriority, xTaskHandle *pxCreatedTask,
+        portSTACK_TYPE *puxStackBuffer, const xMemoryRegion * const xRegions) {
+    (void) pxTaskCode;
+    (void) pcName;
+    (void) usStackDepth;
+    (void) pvParameters;
+    (void) uxPriority;
+    (void) puxStackBuffer;
+    (void) xRegions;
+
+    /* The TX task is not run, the parser runs in the RX tasks */
+    *pxCreatedTask = (xTaskHandle) &queues;
+    return pdPASS;
+}
+
+void vTaskDelete(xTaskHandle xTaskToDelete) {
+    (void) xTaskToDelete;
+}
+
+void vPortEnterCritical(void) {
+}
+
+void vPortExitCritical(void) {
+}
+
+uint32_t HAL_GetTick(void) {
+    return 0;
+}
+
+/* Software version of the CRC peripheral settings in InitCRC(), as in tools/injection_bridge.py */
+uint32_t CalculateCRC(const uint8_t* dataBuffer, const uint32_t dataBufferSize) {
+    uint32_t crc = 0xFFFFFFFF;
+    uint32_t i;
+    int bit;
+
+    for (i = 0; i < dataBufferSize; i++) {
+        crc ^= (uint32_t) dataBuffer[i] << 24;
+        for (bit = 0; bit < 8; bit++)
+            crc = (crc & 0x80000000) ? (crc << 1) ^ 0x04C11DB7 : crc << 1;
+    }
+    return crc;
+}
+
+enum FlightControlMode GetFlightControlMode(void) {
+    return FLIGHT_CONTROL_IDLE;
+}
+
+bool IsAccMagMtrCalibrating(void) {
+    return false;
+}
+
+uint16_t GetMotorValue(uint8_t motorNumber) {
+    return motorNumber;
+}
+
+void FcbSendSensorMessage(uint8_t event) {
+    TEST_CHECK_EQUAL(event, FCB_SENSOR_INJECTION_DATA_READY);
+    sensorMessages++;
+}
+
+void InjectGyroscopeData(float32_t * xyzAngleDot) {
+    memcpy(injectedGyro, xyzAngleDot, sizeof(injectedGyro));
+    gyroInjections++;
+}
+
+void InjectAccelerometerData(float32_t *xyzDotDot) {
+    memcpy(injectedAcc, xyzDotDot, sizeof(injectedAcc));
+    accInjections++;
+}
+
+void InjectMagnetometerData(float32_t *xyzMagVector) {
+    memcpy(injectedMag, xyzMagVector, sizeof(injectedMag));
+    magInjections++;
+}
+
+void InjectBarometerPressure(int32_t pressure) {
+    injectedPressure = pressure;
+    baroInjections++;
+}
+
+USBD_StatusTypeDef USBComSendData(const uint8_t* sendData, const uint16_t sendDataSize) {
+    (void) sendData;
+    (void) sendDataSize;
+    return USBD_OK;
+}
+
+UartStatus UartSendData(const uint8_t* sendData, const uint16_t sendDataSize) {
+    (void) sendData;
+    (void) sendDataSize;
+    return UART_OK;
+}
+
+void ErrorHandler(void) {
+    errorHandlerCalls++;
+}
+
+/* Private functions ---------------------------------------------------------*/
+
+/* Frame values derived from a seed, so that each frame of a test is distinguishable */
+static void SeedFrame(SensorInjectionFrame_TypeDef* frame, const uint32_t seed, const uint8_t sensorMask) {
+    int i;
+
+    frame->timestampUs = 1000*seed + 7;
+    for (i = 0; i < 3; i++) {
+        frame->gyro[i] = 0.125f*(float32_t) seed - 0.5f*i;
+        frame->acc[i] = -9.82f + 0.01f*(float32_t) (seed + i);
+        frame->mag[i] = 0.3f*(float32_t) i - 0.001f*(float32_t) seed;
+    }
+    frame->pressure = 101325 - (int32_t) seed;
+    frame->sensorMask = sensorMask;
+}
+
+/* Serializes a frame like tools/injection_bridge.py, returns the frame size */
+static unsigned int BuildFrame(uint8_t* buffer, const SensorInjectionFrame_TypeDef* frame) {
+    uint8_t* payload = &buffer[PROTO_HEADER_LEN];
+    const uint16_t payloadSize = SENSOR_INJECTION_FRAME_SIZE;
+    uint32_t crc;
+
+    memcpy(&payload[0], &frame->timestampUs, 4);
+    memcpy(&payload[4], frame->gyro, 12);
+    memcpy(&payload[16], frame->acc, 12);
+    memcpy(&payload[28], frame->mag, 12);
+    memcpy(&payload[40], &frame->pressure, 4);
+    payload[44] = frame->sensorMask;
+
+    crc = CalculateCRC(payload, payloadSize);
+    buffer[0] = SENSOR_INJECTION_MSG_ENUM;
+    memcpy(&buffer[1], &crc, 4);
+    memcpy(&buffer[5], &payloadSize, 2);
+    memcpy(&payload[payloadSize], INJECTION_TRAILER, INJECTION_TRAILER_LEN);
+    return FRAME_SIZE;
+}
+
+static void FeedBytes(const uint8_t* data, const unsigned int size) {
+    unsigned int i;
+
+    for (i = 0; i < size; i++)
+        ParseSensorInjectionByte(data[i]);
+}
+
+static void StartInjection(void) {
+    if (GetSensorInjectionState() != SENSOR_INJECTION_OFF) {
+        StopSensorInjection();
+        SensorInjectionControlHook();
+    }
+    InjectionTxTaskHandle = NULL;
+
+    TEST_CHECK_EQUAL(StartSensorInjection(SENSOR_INJECTION_USB), FCB_OK);
+    TEST_CHECK(IsSensorInjectionChannel(SENSOR_INJECTION_USB));
+    sensorMessages = 0;
+    gyroInjections = accInjections = magInjections = baroInjections = 0;
+}
+
+/* Publishes the queued frames and checks that the last one carried the given values */
+static void CheckPublishedFrame(const SensorInjectionFrame_TypeDef* expected) {
+    int i;
+
+    gyroInjections = accInjections = magInjections = baroInjections = 0;
+    ProcessInjectedSensorFrames();
+    TEST_CHECK_EQUAL(injectedFrameTimestampUs, expected->timestampUs);
+
+    TEST_CHECK_EQUAL(gyroInjections, (expected->sensorMask & SENSOR_INJECTION_GYRO) ? 1 : 0);
+    TEST_CHECK_EQUAL(accInjections, (expected->sensorMask & SENSOR_INJECTION_ACC) ? 1 : 0);
+    TEST_CHECK_EQUAL(magInjections, (expected->sensorMask & SENSOR_INJECTION_MAG) ? 1 : 0);
+    TEST_CHECK_EQUAL(baroInjections, (expected->sensorMask & SENSOR_INJECTION_BARO) ? 1 : 0);
+    for (i = 0; i < 3; i++) {
+        if (gyroInjections)
+            TEST_CHECK_CLOSE(injectedGyro[i], expected->gyro[i], 0.0);
+        if (accInjections)
+            TEST_CHECK_CLOSE(injectedAcc[i], expected->acc[i], 0.0);
+        if (magInjections)
+            TEST_CHECK_CLOSE(injectedMag[i], expected->mag[i], 0.0);
+    }
+    if (baroInjections)
+        TEST_CHECK_EQUAL(injectedPressure, expected->pressure);
+}
+
+/*
+ * Returns the number of message id bytes after the first byte of a rejected frame. The parser searches the rejected
+ * bytes for the next header, so each of them may start another bad frame depending on the bytes that follow.
+ */
+static uint32_t CountStrayHeaders(const uint8_t* data, const unsigned int size) {
+    uint32_t count = 0;
+    unsigned int i;
+
+    for (i = 1; i < size; i++) {
+        if (data[i] == SENSOR_INJECTION_MSG_ENUM)
+            count++;
+    }
+    return count;
+}
+
+static void CheckStats(const uint32_t frames, const uint32_t badFrames, const uint32_t strayHeaders,
+        const uint32_t droppedBytes) {
+    SensorInjectionStats_TypeDef stats;
+
+    GetSensorInjectionStats(&stats);
+    TEST_CHECK_EQUAL(stats.frames, frames);
+    TEST_CHECK(stats.badFrames >= badFrames && stats.badFrames <= badFrames + strayHeaders);
+    TEST_CHECK_EQUAL(stats.droppedBytes, droppedBytes);
+    TEST_CHECK_EQUAL(stats.overruns, 0);
+}
+
+static void TestValidFrames(void) {
+    SensorInjectionFrame_TypeDef frame, partialFrame;
+    uint8_t buffer[FRAME_SIZE];
+    unsigned int size, i;
+
+    StartInjection();
+    SeedFrame(&frame, 1, ALL_SENSORS);
+    size = BuildFrame(buffer, &frame);
+    TEST_CHECK_EQUAL(size, INJECTION_PARSER_BUFFER_SIZE);
+
+    /* Nothing is accepted before the last trailer byte */
+    for (i = 0; i < size - 1; i++)
+        ParseSensorInjectionByte(buffer[i]);
+    TEST_CHECK_EQUAL(queues[0].count, 0);
+    TEST_CHECK_EQUAL(parserLength, size - 1);
+    ParseSensorInjectionByte(buffer[size - 1]);
+    TEST_CHECK_EQUAL(queues[0].count, 1);
+    TEST_CHECK_EQUAL(parserLength, 0);
+    TEST_CHECK_EQUAL(sensorMessages, 1);
+    CheckStats(1, 0, 0, 0);
+    CheckPublishedFrame(&frame);
+
+    /* Back to back frames, the second with gyroscope and barometer only */
+    SeedFrame(&frame, 2, ALL_SENSORS);
+    FeedBytes(buffer, BuildFrame(buffer, &frame));
+    SeedFrame(&partialFrame, 3, SENSOR_INJECTION_GYRO | SENSOR_INJECTION_BARO);
+    FeedBytes(buffer, BuildFrame(buffer, &partialFrame));
+    TEST_CHECK_EQUAL(queues[0].count, 2);
+    CheckStats(3, 0, 0, 0);
+
+    gyroInjections = accInjections = magInjections = baroInjections = 0;
+    ProcessInjectedSensorFrames();
+    TEST_CHECK_EQUAL(injectedFrameTimestampUs, partialFrame.timestampUs);
+    TEST_CHECK_EQUAL(gyroInjections, 2);
+    TEST_CHECK_EQUAL(accInjections, 1);
+    TEST_CHECK_EQUAL(magInjections, 1);
+    TEST_CHECK_EQUAL(baroInjections, 2);
+    TEST_CHECK_CLOSE(injectedGyro[0], partialFrame.gyro[0], 0.0);
+    TEST_CHECK_CLOSE(injectedAcc[2], frame.acc[2], 0.0);
+    TEST_CHECK_EQUAL(injectedPressure, partialFrame.pressure);
+    TEST_CHECK_EQUAL(queues[0].count, 0);
+}
+
+static void TestCorruptFrames(void) {
+    SensorInjectionFrame_TypeDef frame;
+    uint8_t buffer[FRAME_SIZE];
+    const uint8_t garbage[] = { 0x00, '\r', '\n', 0xFF, SENSOR_INJECTION_MSG_ENUM + 1, 0x55 };
+    const uint8_t falseHeader[] = { SENSOR_INJECTION_MSG_ENUM, 0x12, 0x34, 0x56, 0x78, 0xFF, 0x00 };
+    uint32_t badFrames = 0, strayHeaders = 0, droppedBytes = 0, frames = 0;
+    uint16_t badSize;
+
+    StartInjection();
+
+    /* Bad CRC */
+    SeedFrame(&frame, 10, ALL_SENSORS);
+    BuildFrame(buffer, &frame);
+    buffer[1] ^= 0x01;
+    FeedBytes(buffer, FRAME_SIZE);
+    TEST_CHECK_EQUAL(queues[0].count, 0);
+    badFrames++;
+    strayHeaders += CountStrayHeaders(buffer, FRAME_SIZE);
+    droppedBytes += FRAME_SIZE;
+    CheckStats(frames, badFrames, strayHeaders, droppedBytes);
+
+    /* Corrupt payload byte */
+    BuildFrame(buffer, &frame);
+    buffer[PROTO_HEADER_LEN + 20] ^= 0x80;
+    FeedBytes(buffer, FRAME_SIZE);
+    badFrames++;
+    strayHeaders += CountStrayHeaders(buffer, FRAME_SIZE);
+    droppedBytes += FRAME_SIZE;
+    CheckStats(frames, badFrames, strayHeaders, droppedBytes);
+
+    /* Bad trailer */
+    BuildFrame(buffer, &frame);
+    buffer[FRAME_SIZE - 1] = '\r';
+    FeedBytes(buffer, FRAME_SIZE);
+    badFrames++;
+    strayHeaders += CountStrayHeaders(buffer, FRAME_SIZE);
+    droppedBytes += FRAME_SIZE;
+    CheckStats(frames, badFrames, strayHeaders, droppedBytes);
+
+    /* Wrong payload size, rejected at the header */
+    BuildFrame(buffer, &frame);
+    badSize = SENSOR_INJECTION_FRAME_SIZE - 1;
+    memcpy(&buffer[5], &badSize, sizeof(badSize));
+    FeedBytes(buffer, PROTO_HEADER_LEN);
+    TEST_CHECK_EQUAL(parserLength, 0);
+    badFrames++;
+    strayHeaders += CountStrayHeaders(buffer, PROTO_HEADER_LEN);
+    droppedBytes += PROTO_HEADER_LEN;
+    CheckStats(frames, badFrames, strayHeaders, droppedBytes);
+
+    /* Wrong message id, skipped byte by byte without counting a bad frame */
+    BuildFrame(buffer, &frame);
+    buffer[0] = WATCH_SAMPLES_MSG_ENUM;
+    FeedBytes(buffer, 1);
+    droppedBytes++;
+    CheckStats(frames, badFrames, strayHeaders, droppedBytes);
+
+    /* A message id byte in the garbage starts a header, which is rejected at its size */
+    FeedBytes(falseHeader, sizeof(falseHeader));
+    TEST_CHECK_EQUAL(parserLength, 0);
+    badFrames++;
+    droppedBytes += sizeof(falseHeader);
+    CheckStats(frames, badFrames, strayHeaders, droppedBytes);
+
+    /* Garbage before a valid frame */
+    FeedBytes(garbage, sizeof(garbage));
+    SeedFrame(&frame, 11, ALL_SENSORS);
+    FeedBytes(buffer, BuildFrame(buffer, &frame));
+    frames++;
+    droppedBytes += sizeof(garbage);
+    CheckStats(frames, badFrames, strayHeaders, droppedBytes);
+    CheckPublishedFrame(&frame);
+
+    /* A valid frame right after a corrupt one is still found, the corrupt bytes are searched for a header */
+    SeedFrame(&frame, 12, ALL_SENSORS);
+    BuildFrame(buffer, &frame);
+    buffer[2] ^= 0x10;
+    FeedBytes(buffer, FRAME_SIZE);
+    badFrames++;
+    strayHeaders += CountStrayHeaders(buffer, FRAME_SIZE);
+    SeedFrame(&frame, 13, SENSOR_INJECTION_ACC);
+    FeedBytes(buffer, BuildFrame(buffer, &frame));
+    frames++;
+    droppedBytes += FRAME_SIZE;
+    CheckStats(frames, badFrames, strayHeaders, droppedBytes);
+    CheckPublishedFrame(&frame);
+    TEST_CHECK_EQUAL(errorHandlerCalls, 0);
+}
+
+static void TestTruncatedFrames(void) {
+    SensorInjectionFrame_TypeDef frame;
+    SensorInjectionStats_TypeDef stats;
+    uint8_t buffer[FRAME_SIZE];
+    const unsigned int truncatedSizes[] = { 1, 3, PROTO_HEADER_LEN, PROTO_HEADER_LEN + 20, FRAME_SIZE - 1 };
+    unsigned int i, droppedBytes = 0;
+
+    StartInjection();
+
+    /* A frame cut off anywhere, e.g. by a host restart, costs only its own bytes */
+    for (i = 0; i < sizeof(truncatedSizes)/sizeof(truncatedSizes[0]); i++) {
+        SeedFrame(&frame, 20 + i, ALL_SENSORS);
+        BuildFrame(buffer, &frame);
+        FeedBytes(buffer, truncatedSizes[i]);
+        TEST_CHECK_EQUAL(queues[0].count, 0);
+
+        SeedFrame(&frame, 30 + i, ALL_SENSORS);
+        FeedBytes(buffer, BuildFrame(buffer, &frame));
+        droppedBytes += truncatedSizes[i];
+
+        GetSensorInjectionStats(&stats);
+        TEST_CHECK_EQUAL(stats.frames, i + 1);
+        TEST_CHECK_EQUAL(stats.droppedBytes, droppedBytes);
+        TEST_CHECK(stats.badFrames <= i + 1);
+        CheckPublishedFrame(&frame);
+    }
+
+    /* A truncated frame alone stays pending until more bytes arrive */
+    SeedFrame(&frame, 40, ALL_SENSORS);
+    BuildFrame(buffer, &frame);
+    FeedBytes(buffer, FRAME_SIZE - 1);
+    TEST_CHECK_EQUAL(parserLength, FRAME_SIZE - 1);
+    FeedBytes(&buffer[FRAME_SIZE - 1], 1);
+    CheckPublishedFrame(&frame);
+}
+
+static void TestOverrunAndStop(void) {
+    SensorInjectionFrame_TypeDef frame;
+    SensorInjectionStats_TypeDef stats;
+    InjectionQueueItem_TypeDef item;
+    uint8_t buffer[FRAME_SIZE];
+    const uint16_t emptySize = 0;
+    const uint32_t emptyCrc = CalculateCRC(NULL, 0);
+    unsigned int i;
+
+    StartInjection();
+
+    /* The SENSORS task is behind, the frames that do not fit in the queue are dropped */
+    for (i = 0; i < INJECTION_FRAME_QUEUE_SIZE + 2; i++) {
+        SeedFrame(&frame, 50 + i, ALL_SENSORS);
+        FeedBytes(buffer, BuildFrame(buffer, &frame));
+    }
+    GetSensorInjectionStats(&stats);
+    TEST_CHECK_EQUAL(stats.frames, INJECTION_FRAME_QUEUE_SIZE);
+    TEST_CHECK_EQUAL(stats.overruns, 2);
+    TEST_CHECK_EQUAL(queues[0].count, INJECTION_FRAME_QUEUE_SIZE);
+    ProcessInjectedSensorFrames();
+    TEST_CHECK_EQUAL(injectedFrameTimestampUs, 1000*(50 + INJECTION_FRAME_QUEUE_SIZE - 1) + 7);
+
+    /* An empty payload stops the injection */
+    buffer[0] = SENSOR_INJECTION_MSG_ENUM;
+    memcpy(&buffer[1], &emptyCrc, 4);
+    memcpy(&buffer[5], &emptySize, 2);
+    memcpy(&buffer[PROTO_HEADER_LEN], INJECTION_TRAILER, INJECTION_TRAILER_LEN);
+    FeedBytes(buffer, PROTO_HEADER_LEN + INJECTION_TRAILER_LEN);
+    TEST_CHECK_EQUAL(GetSensorInjectionState(), SENSOR_INJECTION_STOPPING);
+    TEST_CHECK(!IsSensorInjectionActive());
+    TEST_CHECK(IsMotorOutputInhibited());
+
+    /* Frames queued after the stop are not published */
+    SeedFrame(&item.frame, 60, ALL_SENSORS);
+    item.rxCycles = 0;
+    xQueueSend(qInjectionFrames, &item, 0);
+    gyroInjections = 0;
+    ProcessInjectedSensorFrames();
+    TEST_CHECK_EQUAL(gyroInjections, 0);
+
+    SensorInjectionControlHook();
+    TEST_CHECK_EQUAL(GetSensorInjectionState(), SENSOR_INJECTION_OFF);
+    TEST_CHECK(!IsMotorOutputInhibited());
+}
+
+/* Exported functions --------------------------------------------------------*/
+
+int main(void) {
+    if (!MapTargetAddress((uintptr_t) SCS_BASE & ~(uintptr_t) (PPB_SIZE - 1), PPB_SIZE)) {
+        printf("Could not map the private peripheral region at 0x%08lX\n", (unsigned long) SCS_BASE);
+        return EXIT_FAILURE;
+    }
+
+    TEST_RUN(TestValidFrames);
+    TEST_RUN(TestCorruptFrames);
+    TEST_RUN(TestTruncatedFrames);
+    TEST_RUN(TestOverrunAndStop);
+    return TEST_RESULT();
+}
+
+/**
+ * @}
+ */
+
+/**
+ * @}
+ */
+/*****END OF FILE****/
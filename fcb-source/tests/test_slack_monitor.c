@@ -0,0 +1,327 @@
+/******************************************************************************
+ * @brief   Host tests of the slack monitor (fcb/src/slack_monitor.c):
+ *          - escalation at the end of each window to the level of the least
+ *            headroom in the window, and at once on a missed deadline or a
+ *            skipped control tick
+ *          - the restore hysteresis: one level down only after
+ *            SLACK_RESTORE_WINDOWS consecutive windows with the extra headroom
+ *          - the consecutive overrun count of ReportControlOverrun, and a
+ *            simulation of the control tick deferred handler and the flight
+ *            control queue, which calls the error handler only on a stall
+ *            longer than the queue and SLACK_MAX_CONSECUTIVE_OVERRUNS ticks
+ *          - the rate dividers and shed counts of the deferrable work.
+ *
+ * @license
+ * Dragonfly FCB firmware to control the Dragonfly quadrotor UAV
+ * Copyright (C) 2016  ÅF Technology South: Dragonfly Project
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA
+ *****************************************************************************/
+
+/* Includes ------------------------------------------------------------------*/
+#include "test_common.h"
+
+#include "slack_monitor.h"
+
+/* Private define ------------------------------------------------------------*/
+#define PERIOD                  SLACK_PERIOD_CYCLES
+#define CONTROL_QUEUE_SIZE      6       // FLIGHT_CONTROL_QUEUE_SIZE in flight_control.c
+#define LOOP_CYCLES             SLACK_PERCENT_TO_CYCLES(30)     // Control cycle cost in the stall simulation
+#define STALL_START_TICKS       LOOP_RATE_HZ
+#define STALL_INTERVAL_TICKS    LOOP_RATE_HZ
+#define RECOVERY_TICKS          (4*LOOP_RATE_HZ)
+
+/* Longest flight control task stall without a call to the error handler. The tick at the end of the stall comes
+ * before the task has taken a message, so it is skipped as well. */
+#define MAX_TOLERATED_STALL     (CONTROL_QUEUE_SIZE - 1 + SLACK_MAX_CONSECUTIVE_OVERRUNS)
+
+/* Private variables ---------------------------------------------------------*/
+static uint32_t errorHandlerCalls = 0;
+
+/* Fakes ---------------------------------------------------------------------*/
+void ErrorHandler(void) {
+    errorHandlerCalls++;
+}
+
+/* Private functions ---------------------------------------------------------*/
+
+/* Busy cycles of a control cycle that leaves the given headroom */
+static uint32_t BusyForHeadroom(const uint32_t headroomCycles) {
+    return PERIOD - headroomCycles;
+}
+
+/* Runs whole evaluation windows with the given headroom in every cycle */
+static void RunWindows(const uint32_t windows, const uint32_t headroomCycles) {
+    uint32_t i;
+
+    for (i = 0; i < windows*SLACK_WINDOW_CYCLES; i++)
+        UpdateSlackMonitor(BusyForHeadroom(headroomCycles));
+}
+
+/*
+ * Simulates the control tick deferred handler (SendPredictionUpdateToFlightControl) and the flight control task.
+ * The task is blocked for stallTicks control ticks, stallCount times, and otherwise runs the queued control cycles
+ * back to back at LOOP_CYCLES each. Returns the number of error handler calls.
+ */
+static uint32_t SimulateControlStalls(const uint32_t stallTicks, const uint32_t stallCount) {
+    const uint32_t ticks = STALL_START_TICKS + stallCount*(stallTicks + STALL_INTERVAL_TICKS) + RECOVERY_TICKS;
+    uint64_t queuedTickTimes[CONTROL_QUEUE_SIZE];
+    uint64_t now, taskTime = 0;
+    uint32_t tick, stallTick, queueHead = 0, queued = 0;
+
+    InitSlackMonitor();
+    errorHandlerCalls = 0;
+
+    for (tick = 0; tick < ticks; tick++) {
+        now = (uint64_t) tick*PERIOD;
+
+        /* The deferred handler skips the tick if the queue is full */
+        if (queued < CONTROL_QUEUE_SIZE) {
+            queuedTickTimes[(queueHead + queued) % CONTROL_QUEUE_SIZE] = now;
+            queued++;
+        } else if (ReportControlOverrun()) {
+            ErrorHandler();
+        }
+
+        stallTick = (tick >= STALL_START_TICKS) ? (tick - STALL_START_TICKS) % (stallTicks + STALL_INTERVAL_TICKS) : 0;
+        if (tick >= STALL_START_TICKS && tick < ticks - RECOVERY_TICKS && stallTick < stallTicks)
+            continue;
+
+        /* The task takes the queued ticks until the next tick comes */
+        if (taskTime < now)
+            taskTime = now;
+        while (queued > 0 && taskTime + LOOP_CYCLES <= now + PERIOD) {
+            taskTime += LOOP_CYCLES;
+            UpdateSlackMonitor((uint32_t) (taskTime - queuedTickTimes[queueHead]));
+            queueHead = (queueHead + 1) % CONTROL_QUEUE_SIZE;
+            queued--;
+        }
+    }
+
+    return errorHandlerCalls;
+}
+
+static void TestEscalation(void) {
+    SlackMonitorStats_TypeDef stats;
+    uint32_t i;
+
+    InitSlackMonitor();
+    RunWindows(2, SLACK_PERCENT_TO_CYCLES(SLACK_THROTTLE_PERCENT));
+    TEST_CHECK_EQUAL(GetSlackLevel(), SLACK_LEVEL_NORMAL);
+
+    RunWindows(1, SLACK_PERCENT_TO_CYCLES(SLACK_THROTTLE_PERCENT) - 1);
+    TEST_CHECK_EQUAL(GetSlackLevel(), SLACK_LEVEL_THROTTLE);
+    RunWindows(1, SLACK_PERCENT_TO_CYCLES(SLACK_SUSPEND_PERCENT) - 1);
+    TEST_CHECK_EQUAL(GetSlackLevel(), SLACK_LEVEL_SUSPEND);
+    RunWindows(1, SLACK_PERCENT_TO_CYCLES(SLACK_CRITICAL_PERCENT) - 1);
+    TEST_CHECK_EQUAL(GetSlackLevel(), SLACK_LEVEL_CRITICAL);
+
+    /* The level changes only at the end of a window, to the level of the least headroom in it */
+    InitSlackMonitor();
+    UpdateSlackMonitor(BusyForHeadroom(SLACK_PERCENT_TO_CYCLES(SLACK_SUSPEND_PERCENT) - 1));
+    for (i = 1; i < SLACK_WINDOW_CYCLES - 1; i++)
+        UpdateSlackMonitor(BusyForHeadroom(SLACK_PERCENT_TO_CYCLES(90)));
+    TEST_CHECK_EQUAL(GetSlackLevel(), SLACK_LEVEL_NORMAL);
+    UpdateSlackMonitor(BusyForHeadroom(SLACK_PERCENT_TO_CYCLES(90)));
+    TEST_CHECK_EQUAL(GetSlackLevel(), SLACK_LEVEL_SUSPEND);
+
+    GetSlackMonitorStats(&stats);
+    TEST_CHECK_EQUAL(stats.levelChanges, 1);
+    TEST_CHECK_EQUAL(stats.windowMinHeadroom, SLACK_PERCENT_TO_CYCLES(SLACK_SUSPEND_PERCENT) - 1);
+    TEST_CHECK_EQUAL(stats.cyclesAtLevel[SLACK_LEVEL_NORMAL], SLACK_WINDOW_CYCLES);
+
+    /* A missed deadline is critical at once */
+    InitSlackMonitor();
+    UpdateSlackMonitor(PERIOD + 1);
+    TEST_CHECK_EQUAL(GetSlackLevel(), SLACK_LEVEL_CRITICAL);
+    GetSlackMonitorStats(&stats);
+    TEST_CHECK_EQUAL(stats.deadlineMisses, 1);
+    TEST_CHECK_EQUAL(stats.minHeadroom, 0);
+
+    /* Completing exactly at the next tick is not a miss */
+    InitSlackMonitor();
+    UpdateSlackMonitor(PERIOD);
+    TEST_CHECK_EQUAL(GetSlackLevel(), SLACK_LEVEL_NORMAL);
+    GetSlackMonitorStats(&stats);
+    TEST_CHECK_EQUAL(stats.deadlineMisses, 0);
+
+    /* A skipped control tick is critical at the next completed cycle */
+    InitSlackMonitor();
+    TEST_CHECK(!ReportControlOverrun());
+    TEST_CHECK_EQUAL(GetSlackLevel(), SLACK_LEVEL_NORMAL);
+    UpdateSlackMonitor(BusyForHeadroom(SLACK_PERCENT_TO_CYCLES(90)));
+    TEST_CHECK_EQUAL(GetSlackLevel(), SLACK_LEVEL_CRITICAL);
+    GetSlackMonitorStats(&stats);
+    TEST_CHECK_EQUAL(stats.overruns, 1);
+    TEST_CHECK_EQUAL(stats.deadlineMisses, 0);
+}
+
+static void TestRestoreHysteresis(void) {
+    const uint32_t throttleRestore = SLACK_PERCENT_TO_CYCLES(SLACK_THROTTLE_PERCENT + SLACK_RESTORE_PERCENT);
+    uint32_t i;
+
+    /* Just short of the extra headroom the level is kept */
+    InitSlackMonitor();
+    RunWindows(1, SLACK_PERCENT_TO_CYCLES(SLACK_THROTTLE_PERCENT) - 1);
+    TEST_CHECK_EQUAL(GetSlackLevel(), SLACK_LEVEL_THROTTLE);
+    RunWindows(10*SLACK_RESTORE_WINDOWS, throttleRestore - 1);
+    TEST_CHECK_EQUAL(GetSlackLevel(), SLACK_LEVEL_THROTTLE);
+
+    /* With the extra headroom, one level down after SLACK_RESTORE_WINDOWS windows */
+    RunWindows(SLACK_RESTORE_WINDOWS - 1, throttleRestore);
+    TEST_CHECK_EQUAL(GetSlackLevel(), SLACK_LEVEL_THROTTLE);
+    RunWindows(1, throttleRestore);
+    TEST_CHECK_EQUAL(GetSlackLevel(), SLACK_LEVEL_NORMAL);
+
+    /* A window without the extra headroom restarts the count */
+    InitSlackMonitor();
+    RunWindows(1, SLACK_PERCENT_TO_CYCLES(SLACK_THROTTLE_PERCENT) - 1);
+    RunWindows(SLACK_RESTORE_WINDOWS - 1, throttleRestore);
+    RunWindows(1, throttleRestore - 1);
+    RunWindows(SLACK_RESTORE_WINDOWS - 1, throttleRestore);
+    TEST_CHECK_EQUAL(GetSlackLevel(), SLACK_LEVEL_THROTTLE);
+    RunWindows(1, throttleRestore);
+    TEST_CHECK_EQUAL(GetSlackLevel(), SLACK_LEVEL_NORMAL);
+
+    /* A single short cycle in a window is enough to restart the count */
+    InitSlackMonitor();
+    RunWindows(1, SLACK_PERCENT_TO_CYCLES(SLACK_THROTTLE_PERCENT) - 1);
+    RunWindows(SLACK_RESTORE_WINDOWS - 1, throttleRestore);
+    UpdateSlackMonitor(BusyForHeadroom(throttleRestore - 1));
+    for (i = 1; i < SLACK_WINDOW_CYCLES; i++)
+        UpdateSlackMonitor(BusyForHeadroom(throttleRestore));
+    RunWindows(SLACK_RESTORE_WINDOWS - 1, throttleRestore);
+    TEST_CHECK_EQUAL(GetSlackLevel(), SLACK_LEVEL_THROTTLE);
+
+    /* From critical, one level per SLACK_RESTORE_WINDOWS down to the level the headroom allows */
+    InitSlackMonitor();
+    UpdateSlackMonitor(PERIOD + 1);
+    for (i = 1; i < SLACK_WINDOW_CYCLES; i++)
+        UpdateSlackMonitor(BusyForHeadroom(SLACK_PERCENT_TO_CYCLES(35)));
+    RunWindows(SLACK_RESTORE_WINDOWS - 1, SLACK_PERCENT_TO_CYCLES(35));
+    TEST_CHECK_EQUAL(GetSlackLevel(), SLACK_LEVEL_CRITICAL);
+    RunWindows(1, SLACK_PERCENT_TO_CYCLES(35));
+    TEST_CHECK_EQUAL(GetSlackLevel(), SLACK_LEVEL_SUSPEND);
+    RunWindows(SLACK_RESTORE_WINDOWS, SLACK_PERCENT_TO_CYCLES(35));
+    TEST_CHECK_EQUAL(GetSlackLevel(), SLACK_LEVEL_THROTTLE);
+    RunWindows(10*SLACK_RESTORE_WINDOWS, SLACK_PERCENT_TO_CYCLES(35));
+    TEST_CHECK_EQUAL(GetSlackLevel(), SLACK_LEVEL_THROTTLE);
+}
+
+static void TestOverrunCount(void) {
+    uint32_t i;
+
+    InitSlackMonitor();
+    for (i = 0; i < SLACK_MAX_CONSECUTIVE_OVERRUNS; i++)
+        TEST_CHECK(!ReportControlOverrun());
+    TEST_CHECK(ReportControlOverrun());
+    TEST_CHECK(ReportControlOverrun());
+
+    /* A completed control cycle restarts the count */
+    UpdateSlackMonitor(BusyForHeadroom(SLACK_PERCENT_TO_CYCLES(50)));
+    for (i = 0; i < SLACK_MAX_CONSECUTIVE_OVERRUNS; i++)
+        TEST_CHECK(!ReportControlOverrun());
+    UpdateSlackMonitor(BusyForHeadroom(SLACK_PERCENT_TO_CYCLES(50)));
+    for (i = 0; i < SLACK_MAX_CONSECUTIVE_OVERRUNS; i++)
+        TEST_CHECK(!ReportControlOverrun());
+    TEST_CHECK(ReportControlOverrun());
+}
+
+static void TestControlStallSimulation(void) {
+    SlackMonitorStats_TypeDef stats;
+
+    /* Without a stall the load of LOOP_CYCLES keeps the normal level */
+    TEST_CHECK_EQUAL(SimulateControlStalls(0, 1), 0);
+    TEST_CHECK_EQUAL(GetSlackLevel(), SLACK_LEVEL_NORMAL);
+    GetSlackMonitorStats(&stats);
+    TEST_CHECK_EQUAL(stats.overruns, 0);
+    TEST_CHECK_EQUAL(stats.levelChanges, 0);
+
+    /* The longest tolerated stall sheds the work and recovers */
+    TEST_CHECK_EQUAL(SimulateControlStalls(MAX_TOLERATED_STALL, 1), 0);
+    GetSlackMonitorStats(&stats);
+    TEST_CHECK_EQUAL(stats.overruns, SLACK_MAX_CONSECUTIVE_OVERRUNS);
+    TEST_CHECK(stats.deadlineMisses > 0);
+    TEST_CHECK(stats.cyclesAtLevel[SLACK_LEVEL_CRITICAL] > 0);
+    TEST_CHECK_EQUAL(GetSlackLevel(), SLACK_LEVEL_NORMAL);
+
+    /* Repeated tolerated stalls do not add up */
+    TEST_CHECK_EQUAL(SimulateControlStalls(MAX_TOLERATED_STALL, 5), 0);
+    GetSlackMonitorStats(&stats);
+    TEST_CHECK_EQUAL(stats.overruns, 5*SLACK_MAX_CONSECUTIVE_OVERRUNS);
+
+    /* One tick longer calls the error handler, at every further skipped tick */
+    TEST_CHECK_EQUAL(SimulateControlStalls(MAX_TOLERATED_STALL + 1, 1), 1);
+    TEST_CHECK_EQUAL(SimulateControlStalls(MAX_TOLERATED_STALL + 10, 1), 10);
+    printf("Longest tolerated control task stall: %d ticks (%.1f ms)\n", MAX_TOLERATED_STALL,
+            1000.0*MAX_TOLERATED_STALL/LOOP_RATE_HZ);
+}
+
+static void TestWorkShedding(void) {
+    SlackMonitorStats_TypeDef stats;
+    uint32_t sequence, due;
+
+    InitSlackMonitor();
+    for (sequence = 0; sequence < 100; sequence++)
+        TEST_CHECK(IsSlackWorkDue(SLACK_WORK_TELEMETRY, sequence));
+
+    RunWindows(1, SLACK_PERCENT_TO_CYCLES(SLACK_THROTTLE_PERCENT) - 1);
+    for (due = 0, sequence = 0; sequence < 100; sequence++)
+        due += IsSlackWorkDue(SLACK_WORK_TELEMETRY, sequence);
+    TEST_CHECK_EQUAL(due, 100 / SLACK_THROTTLE_DIVIDER);
+    TEST_CHECK(IsSlackWorkDue(SLACK_WORK_CALIBRATION, 1));
+    TEST_CHECK(IsSlackWorkDue(SLACK_WORK_FLASH, 1));
+
+    RunWindows(1, SLACK_PERCENT_TO_CYCLES(SLACK_SUSPEND_PERCENT) - 1);
+    TEST_CHECK(!IsSlackWorkDue(SLACK_WORK_PRINT, 0));
+    TEST_CHECK(IsSlackWorkDue(SLACK_WORK_CALIBRATION, 0));
+
+    UpdateSlackMonitor(PERIOD + 1);
+    TEST_CHECK(!IsSlackWorkDue(SLACK_WORK_CALIBRATION, 0));
+    TEST_CHECK(!IsSlackWorkDue(SLACK_WORK_FLASH, 0));
+    TEST_CHECK_EQUAL(GetSlackRateDivider(SLACK_WORK_COUNT), 1);
+
+    GetSlackMonitorStats(&stats);
+    TEST_CHECK_EQUAL(stats.shedCount[SLACK_WORK_TELEMETRY], 100 - 100 / SLACK_THROTTLE_DIVIDER);
+    TEST_CHECK_EQUAL(stats.shedCount[SLACK_WORK_PRINT], 1);
+    TEST_CHECK_EQUAL(stats.shedCount[SLACK_WORK_CALIBRATION], 1);
+    TEST_CHECK_EQUAL(stats.shedCount[SLACK_WORK_FLASH], 1);
+
+    /* Resetting the statistics keeps the level */
+    ResetSlackMonitorStats();
+    GetSlackMonitorStats(&stats);
+    TEST_CHECK_EQUAL(stats.level, SLACK_LEVEL_CRITICAL);
+    TEST_CHECK_EQUAL(stats.shedCount[SLACK_WORK_TELEMETRY], 0);
+}
+
+/* Exported functions --------------------------------------------------------*/
+
+int main(void) {
+    TEST_RUN(TestEscalation);
+    TEST_RUN(TestRestoreHysteresis);
+    TEST_RUN(TestOverrunCount);
+    TEST_RUN(TestControlStallSimulation);
+    TEST_RUN(TestWorkShedding);
+    return TEST_RESULT();
+}
+
+/**
+ * @}
+ */
+
+/**
+ * @}
+ */
+/*****END OF FILE****/
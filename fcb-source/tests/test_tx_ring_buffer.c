@@ -0,0 +1,258 @@
+/******************************************************************************
+ * @brief   Host tests of the transmit ring buffer (utilities/src/tx_ring_buffer.c):
+ *          - whole or dropped writes and the free space, one byte kept free
+ *          - spans that end at the end of the storage array when the data
+ *            wraps around, and no overwrite of the span in progress
+ *          - the partial release of an aborted span, as after a UART error
+ *          - a stream of writes of random sizes sent in spans that are
+ *            completed or aborted part way. The sent bytes must be the
+ *            written bytes, less the dropped writes, in order.
+ *
+ * @license
+ * Dragonfly FCB firmware to control the Dragonfly quadrotor UAV
+ * Copyright (C) 2016  ÅF Technology South: Dragonfly Project
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA
+ *****************************************************************************/
+
+/* Includes ------------------------------------------------------------------*/
+#include "test_common.h"
+
+#include "tx_ring_buffer.h"
+
+#include <string.h>
+
+/* Private define ------------------------------------------------------------*/
+#define BUFFER_SIZE             16
+#define STREAM_BUFFER_SIZE      37      // Not a divisor of the write sizes, so that the spans wrap at every offset
+#define STREAM_STEPS            100000
+#define STREAM_MAX_WRITE        12
+
+/* Private variables ---------------------------------------------------------*/
+static uint32_t randomState = 1;
+
+/* Private functions ---------------------------------------------------------*/
+
+/* Deterministic pseudo random numbers in [0, range) */
+static uint32_t Random(const uint32_t range) {
+    randomState = randomState*1103515245u + 12345u;
+    return (randomState >> 16) % range;
+}
+
+static void FillSequence(uint8_t* data, const uint16_t size, const uint8_t first) {
+    uint16_t i;
+
+    for (i = 0; i < size; i++)
+        data[i] = (uint8_t) (first + i);
+}
+
+static void TestPutAndFree(void) {
+    TxRingBuffer_TypeDef buffer;
+    uint8_t storage[BUFFER_SIZE];
+    uint8_t data[BUFFER_SIZE];
+
+    FillSequence(data, sizeof(data), 0);
+    TxRingBufferInit(&buffer, storage, sizeof(storage));
+    TEST_CHECK_EQUAL(TxRingBufferGetFree(&buffer), BUFFER_SIZE - 1);
+    TEST_CHECK(TxRingBufferIsIdle(&buffer));
+
+    TEST_CHECK(TxRingBufferPut(&buffer, data, 10));
+    TEST_CHECK_EQUAL(TxRingBufferGetFree(&buffer), BUFFER_SIZE - 11);
+
+    /* A write that does not fit is dropped as a whole */
+    TEST_CHECK(!TxRingBufferPut(&buffer, data, BUFFER_SIZE - 10));
+    TEST_CHECK_EQUAL(buffer.droppedWrites, 1);
+    TEST_CHECK_EQUAL(buffer.droppedBytes, BUFFER_SIZE - 10);
+    TEST_CHECK_EQUAL(TxRingBufferGetFree(&buffer), BUFFER_SIZE - 11);
+
+    TEST_CHECK(TxRingBufferPut(&buffer, data, BUFFER_SIZE - 11));
+    TEST_CHECK_EQUAL(TxRingBufferGetFree(&buffer), 0);
+    TEST_CHECK_EQUAL(buffer.maxUsed, BUFFER_SIZE - 1);
+    TEST_CHECK(!TxRingBufferPut(&buffer, data, 1));
+    TEST_CHECK(TxRingBufferPut(&buffer, data, 0));
+}
+
+static void TestSpanWrap(void) {
+    TxRingBuffer_TypeDef buffer;
+    uint8_t storage[BUFFER_SIZE];
+    uint8_t data[BUFFER_SIZE];
+    uint8_t* span;
+    uint16_t spanSize;
+
+    FillSequence(data, sizeof(data), 100);
+    TxRingBufferInit(&buffer, storage, sizeof(storage));
+    TEST_CHECK(!TxRingBufferStartSpan(&buffer, &span, &spanSize));
+
+    TEST_CHECK(TxRingBufferPut(&buffer, data, 12));
+    TEST_CHECK(TxRingBufferStartSpan(&buffer, &span, &spanSize));
+    TEST_CHECK(span == storage);
+    TEST_CHECK_EQUAL(spanSize, 12);
+    TEST_CHECK(!TxRingBufferIsIdle(&buffer));
+
+    /* One span at a time, and the bytes of the span in progress are not free */
+    TEST_CHECK(!TxRingBufferStartSpan(&buffer, &span, &spanSize));
+    TEST_CHECK_EQUAL(TxRingBufferGetFree(&buffer), BUFFER_SIZE - 13);
+    TEST_CHECK(!TxRingBufferPut(&buffer, data, 4));
+    TEST_CHECK(TxRingBufferPut(&buffer, data, 3));
+    TEST_CHECK(memcmp(storage, data, 12) == 0);
+
+    TxRingBufferCompleteSpan(&buffer);
+    TEST_CHECK_EQUAL(buffer.sentBytes, 12);
+    TEST_CHECK_EQUAL(TxRingBufferGetFree(&buffer), BUFFER_SIZE - 4);
+
+    /* A write across the end of the storage array is sent in two spans */
+    TEST_CHECK(TxRingBufferPut(&buffer, &data[3], 6));
+    TEST_CHECK_EQUAL(buffer.head, 5);
+    TEST_CHECK(TxRingBufferStartSpan(&buffer, &span, &spanSize));
+    TEST_CHECK(span == &storage[12]);
+    TEST_CHECK_EQUAL(spanSize, BUFFER_SIZE - 12);
+    TEST_CHECK(memcmp(span, data, spanSize) == 0);
+    TxRingBufferCompleteSpan(&buffer);
+
+    TEST_CHECK(TxRingBufferStartSpan(&buffer, &span, &spanSize));
+    TEST_CHECK(span == storage);
+    TEST_CHECK_EQUAL(spanSize, 5);
+    TEST_CHECK(memcmp(span, &data[4], spanSize) == 0);
+    TxRingBufferCompleteSpan(&buffer);
+
+    TEST_CHECK(!TxRingBufferStartSpan(&buffer, &span, &spanSize));
+    TEST_CHECK_EQUAL(buffer.sentBytes, 21);
+    TEST_CHECK_EQUAL(buffer.spans, 3);
+    TEST_CHECK_EQUAL(TxRingBufferGetFree(&buffer), BUFFER_SIZE - 1);
+}
+
+static void TestAbortSpan(void) {
+    TxRingBuffer_TypeDef buffer;
+    uint8_t storage[BUFFER_SIZE];
+    uint8_t data[BUFFER_SIZE];
+    uint8_t* span;
+    uint16_t spanSize;
+
+    FillSequence(data, sizeof(data), 0);
+    TxRingBufferInit(&buffer, storage, sizeof(storage));
+    TEST_CHECK(TxRingBufferPut(&buffer, data, 10));
+
+    /* Nothing sent, the next span is the same */
+    TEST_CHECK(TxRingBufferStartSpan(&buffer, &span, &spanSize));
+    TxRingBufferAbortSpan(&buffer, 0);
+    TEST_CHECK(TxRingBufferIsIdle(&buffer));
+    TEST_CHECK(TxRingBufferStartSpan(&buffer, &span, &spanSize));
+    TEST_CHECK(span == storage);
+    TEST_CHECK_EQUAL(spanSize, 10);
+
+    /* The sent bytes are released, the next span resumes at the first unsent byte */
+    TxRingBufferAbortSpan(&buffer, 4);
+    TEST_CHECK_EQUAL(buffer.sentBytes, 4);
+    TEST_CHECK_EQUAL(TxRingBufferGetFree(&buffer), BUFFER_SIZE - 7);
+    TEST_CHECK(TxRingBufferStartSpan(&buffer, &span, &spanSize));
+    TEST_CHECK(span == &storage[4]);
+    TEST_CHECK_EQUAL(spanSize, 6);
+    TEST_CHECK_EQUAL(span[0], 4);
+
+    /* At most the span is released */
+    TxRingBufferAbortSpan(&buffer, UINT16_MAX);
+    TEST_CHECK_EQUAL(buffer.sentBytes, 10);
+    TEST_CHECK_EQUAL(buffer.tail, 10);
+    TEST_CHECK(!TxRingBufferStartSpan(&buffer, &span, &spanSize));
+
+    /* Aborting while idle releases nothing */
+    TxRingBufferAbortSpan(&buffer, 3);
+    TEST_CHECK_EQUAL(buffer.tail, 10);
+
+    /* A span aborted at the end of the storage array resumes there */
+    TEST_CHECK(TxRingBufferPut(&buffer, data, 8));
+    TEST_CHECK(TxRingBufferStartSpan(&buffer, &span, &spanSize));
+    TEST_CHECK_EQUAL(spanSize, BUFFER_SIZE - 10);
+    TxRingBufferAbortSpan(&buffer, BUFFER_SIZE - 11);
+    TEST_CHECK(TxRingBufferStartSpan(&buffer, &span, &spanSize));
+    TEST_CHECK(span == &storage[BUFFER_SIZE - 1]);
+    TEST_CHECK_EQUAL(spanSize, 1);
+    TEST_CHECK_EQUAL(span[0], BUFFER_SIZE - 11);
+    TxRingBufferCompleteSpan(&buffer);
+    TEST_CHECK_EQUAL(buffer.tail, 0);
+    TEST_CHECK(TxRingBufferStartSpan(&buffer, &span, &spanSize));
+    TEST_CHECK_EQUAL(spanSize, 2);
+}
+
+static void TestStream(void) {
+    TxRingBuffer_TypeDef buffer;
+    uint8_t storage[STREAM_BUFFER_SIZE];
+    uint8_t data[STREAM_MAX_WRITE];
+    uint8_t* span = NULL;
+    uint16_t spanSize = 0, sent, writeSize;
+    uint8_t nextWritten = 0, nextExpected = 0;
+    uint32_t step, writtenBytes = 0, receivedBytes = 0, mismatches = 0, aborts = 0;
+    uint16_t i;
+
+    TxRingBufferInit(&buffer, storage, sizeof(storage));
+
+    for (step = 0; step < STREAM_STEPS; step++) {
+        /* Producer: a write of random size, with a sequence that tells a dropped write from a lost byte */
+        writeSize = (uint16_t) (1 + Random(STREAM_MAX_WRITE));
+        FillSequence(data, writeSize, nextWritten);
+        if (TxRingBufferPut(&buffer, data, writeSize)) {
+            nextWritten = (uint8_t) (nextWritten + writeSize);
+            writtenBytes += writeSize;
+        }
+
+        /* Transmitter: a span is sent in steps, completed or aborted after part of it was sent */
+        if (TxRingBufferIsIdle(&buffer) && !TxRingBufferStartSpan(&buffer, &span, &spanSize))
+            continue;
+        if (Random(3) != 0)
+            continue;
+
+        sent = (Random(4) == 0) ? (uint16_t) Random(spanSize + 1) : spanSize;
+        for (i = 0; i < sent; i++) {
+            if (span[i] != nextExpected)
+                mismatches++;
+            nextExpected = (uint8_t) (span[i] + 1);
+        }
+        receivedBytes += sent;
+
+        if (sent < spanSize) {
+            TxRingBufferAbortSpan(&buffer, sent);
+            aborts++;
+        } else {
+            TxRingBufferCompleteSpan(&buffer);
+        }
+    }
+
+    TEST_CHECK_EQUAL(mismatches, 0);
+    TEST_CHECK(aborts > 0);
+    TEST_CHECK(buffer.droppedWrites > 0);
+    TEST_CHECK_EQUAL(buffer.sentBytes, receivedBytes);
+    TEST_CHECK_EQUAL(writtenBytes - receivedBytes, STREAM_BUFFER_SIZE - 1 - TxRingBufferGetFree(&buffer));
+    printf("Stream: %u bytes sent in %u spans, %u aborted, %u writes dropped\n", (unsigned) receivedBytes,
+            (unsigned) buffer.spans, (unsigned) aborts, (unsigned) buffer.droppedWrites);
+}
+
+/* Exported functions --------------------------------------------------------*/
+
+int main(void) {
+    TEST_RUN(TestPutAndFree);
+    TEST_RUN(TestSpanWrap);
+    TEST_RUN(TestAbortSpan);
+    TEST_RUN(TestStream);
+    return TEST_RESULT();
+}
+
+/**
+ * @}
+ */
+
+/**
+ * @}
+ */
+/*****END OF FILE****/
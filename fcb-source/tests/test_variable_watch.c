@@ -0,0 +1,366 @@
+/******************************************************************************
+ * @brief   Software in the loop test of the variable watch
+ *          (fcb/src/variable_watch.c):
+ *          - the watch address check at the SRAM and CCM RAM boundaries
+ *          - the watch list and the type names
+ *          - the sample stream: loop divider, values, sample counter gaps
+ *            from shed and dropped samples and the frames the TX task sends,
+ *            decoded and CRC checked like tools/watch.py does
+ *
+ *          The SRAM and CCM RAM address ranges are mapped into the test
+ *          process, so that the watched variables are read from the same
+ *          addresses as on target. The queue, task, USB, CRC and slack
+ *          monitor functions are faked. variable_watch.c is included so that
+ *          the test can run its static TX task.
+ *
+ * @license
+ * Dragonfly FCB firmware to control the Dragonfly quadrotor UAV
+ * Copyright (C) 2016  ÅF Technology South: Dragonfly Project
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA
+ *****************************************************************************/
+
+/* Includes ------------------------------------------------------------------*/
+#include "test_common.h"
+
+#include "../fcb/src/variable_watch.c"
+
+#include <setjmp.h>
+
+/* Private define ------------------------------------------------------------*/
+#define FAKE_QUEUE_MAX_ITEMS    16
+#define SENT_BUFFER_SIZE        4096
+
+/* Private variables ---------------------------------------------------------*/
+
+/* Fake queue, the watch uses a single queue */
+static uint8_t queueItems[FAKE_QUEUE_MAX_ITEMS][sizeof(WatchSample_TypeDef)];
+static unsigned int queueLength, queueItemSize, queueHead, queueCount;
+
+/* Frames sent over the fake USB */
+static uint8_t sentData[SENT_BUFFER_SIZE];
+static unsigned int sentSize;
+
+static bool slackSheddingOdd = false;
+static int errorHandlerCalls = 0;
+static jmp_buf taskDeleted;
+
+/* Fakes ---------------------------------------------------------------------*/
+
+xQueueHandle xQueueGenericCreate(unsigned portBASE_TYPE uxQueueLength, unsigned portBASE_TYPE uxItemSize,
+        unsigned char ucQueueType) {
+    (void) ucQueueType;
+
+    if (uxQueueLength > FAKE_QUEUE_MAX_ITEMS || uxItemSize > sizeof(queueItems[0]))
+        return NULL;
+
+    queueLength = uxQueueLength;
+    queueItemSize = uxItemSize;
+    queueHead = 0;
+    queueCount = 0;
+    return (xQueueHandle) queueItems;
+}
+
+portBASE_TYPE xQueueGenericReset(xQueueHandle xQueue, portBASE_TYPE xNewQueue) {
+    (void) xQueue;
+    (void) xNewQueue;
+
+    queueHead = 0;
+    queueCount = 0;
+    return pdPASS;
+}
+
+signed portBASE_TYPE xQueueGenericSend(xQueueHandle xQueue, const void * const pvItemToQueue,
+        portTickType xTicksToWait, portBASE_TYPE xCopyPosition) {
+    (void) xQueue;
+    (void) xTicksToWait;
+    (void) xCopyPosition;
+
+    if (queueCount >= queueLength)
+        return errQUEUE_FULL;
+
+    memcpy(queueItems[(queueHead + queueCount) % queueLength], pvItemToQueue, queueItemSize);
+    queueCount++;
+    return pdTRUE;
+}
+
+signed portBASE_TYPE xQueueGenericReceive(xQueueHandle xQueue, void * const pvBuffer, portTickType xTicksToWait,
+        portBASE_TYPE xJustPeek) {
+    (void) xQueue;
+    (void) xTicksToWait;
+    (void) xJustPeek;
+
+    if (queueCount == 0)
+        return pdFALSE;
+
+    memcpy(pvBuffer, queueItems[queueHead], queueItemSize);
+    queueHead = (queueHead + 1) % queueLength;
+    queueCount--;
+    return pdTRUE;
+}
+
+signed portBASE_TYPE xTaskGenericCreate(pdTASK_CODE pxTaskCode, const signed char * const pcName,
+        unsigned short usStackDepth, void *pvParameters, unsigned portBASE_TYPE uxPriority, xTaskHandle *pxCreatedTask,
+        portSTACK_TYPE *puxStackBuffer, const xMemoryRegion * const xRegions) {
+    (void) pxTaskCode;
+    (void) pcName;
+    (void) usStackDepth;
+    (void) pvParameters;
+    (void) uxPriority;
+    (void) puxStackBuffer;
+    (void) xRegions;
+
+    /* The task is run by the test with RunWatchTxTask() */
+    *pxCreatedTask = (xTaskHandle) &taskDeleted;
+    return pdPASS;
+}
+
+void vTaskDelete(xTaskHandle xTaskToDelete) {
+    (void) xTaskToDelete;
+
+    longjmp(taskDeleted, 1);
+}
+
+USBD_StatusTypeDef USBComSendData(const uint8_t* sendData, const uint16_t sendDataSize) {
+    TEST_CHECK(sentSize + sendDataSize <= SENT_BUFFER_SIZE);
+    if (sentSize + sendDataSize <= SENT_BUFFER_SIZE) {
+        memcpy(&sentData[sentSize], sendData, sendDataSize);
+        sentSize += sendDataSize;
+    }
+    return USBD_OK;
+}
+
+/* Software version of the CRC peripheral settings in InitCRC(), as in tools/watch.py */
+uint32_t CalculateCRC(const uint8_t* dataBuffer, const uint32_t dataBufferSize) {
+    uint32_t crc = 0xFFFFFFFF;
+    uint32_t i;
+    int bit;
+
+    for (i = 0; i < dataBufferSize; i++) {
+        crc ^= (uint32_t) dataBuffer[i] << 24;
+        for (bit = 0; bit < 8; bit++)
+            crc = (crc & 0x80000000) ? (crc << 1) ^ 0x04C11DB7 : crc << 1;
+    }
+    return crc;
+}
+
+bool IsSlackWorkDue(const SlackWork_TypeDef work, const uint32_t sequence) {
+    TEST_CHECK_EQUAL(work, SLACK_WORK_TELEMETRY);
+    return !slackSheddingOdd || (sequence & 1) == 0;
+}
+
+void ErrorHandler(void) {
+    errorHandlerCalls++;
+}
+
+/* Private functions ---------------------------------------------------------*/
+
+/* Runs the TX task until it deletes itself, which it does once the watch is stopped and the queue is empty */
+static void RunWatchTxTask(void) {
+    sentSize = 0;
+    if (setjmp(taskDeleted) == 0)
+        WatchTxTask(NULL);
+}
+
+/* Decodes the next frame of the sent data like tools/watch.py, returns the payload size or -1 if invalid */
+static int DecodeFrame(unsigned int* offset, uint32_t* sampleCounter, uint8_t* values) {
+    uint32_t crc;
+    uint16_t payloadSize;
+    const uint8_t* frame = &sentData[*offset];
+
+    if (*offset + PROTO_HEADER_LEN > sentSize || frame[0] != WATCH_SAMPLES_MSG_ENUM)
+        return -1;
+
+    memcpy(&crc, &frame[1], sizeof(crc));
+    memcpy(&payloadSize, &frame[5], sizeof(payloadSize));
+    if (*offset + PROTO_HEADER_LEN + payloadSize + 2 > sentSize || payloadSize < sizeof(*sampleCounter)
+            || memcmp(&frame[PROTO_HEADER_LEN + payloadSize], "\r\n", 2) != 0
+            || CalculateCRC(&frame[PROTO_HEADER_LEN], payloadSize) != crc)
+        return -1;
+
+    memcpy(sampleCounter, &frame[PROTO_HEADER_LEN], sizeof(*sampleCounter));
+    memcpy(values, &frame[PROTO_HEADER_LEN + sizeof(*sampleCounter)], payloadSize - sizeof(*sampleCounter));
+    *offset += PROTO_HEADER_LEN + payloadSize + 2;
+    return payloadSize;
+}
+
+static void TestWatchAddressCheck(void) {
+    TEST_CHECK(IsWatchAddressAllowed(SRAM_BASE, 4));
+    TEST_CHECK(IsWatchAddressAllowed(SRAM_BASE + WATCH_SRAM_SIZE - 4, 4));
+    TEST_CHECK(IsWatchAddressAllowed(SRAM_BASE + WATCH_SRAM_SIZE - 1, 1));
+    TEST_CHECK(!IsWatchAddressAllowed(SRAM_BASE + WATCH_SRAM_SIZE - 2, 4));
+    TEST_CHECK(!IsWatchAddressAllowed(SRAM_BASE + WATCH_SRAM_SIZE, 1));
+    TEST_CHECK(!IsWatchAddressAllowed(SRAM_BASE - 4, 4));
+    TEST_CHECK(IsWatchAddressAllowed(CCMDATARAM_BASE, 4));
+    TEST_CHECK(IsWatchAddressAllowed(CCMDATARAM_BASE + WATCH_CCM_SIZE - 2, 2));
+    TEST_CHECK(!IsWatchAddressAllowed(CCMDATARAM_BASE + WATCH_CCM_SIZE, 4));
+
+    /* Unaligned */
+    TEST_CHECK(!IsWatchAddressAllowed(SRAM_BASE + 1, 2));
+    TEST_CHECK(!IsWatchAddressAllowed(SRAM_BASE + 2, 4));
+    TEST_CHECK(IsWatchAddressAllowed(SRAM_BASE + 3, 1));
+
+    /* Flash, peripherals and wrap around */
+    TEST_CHECK(!IsWatchAddressAllowed(FLASH_BASE, 4));
+    TEST_CHECK(!IsWatchAddressAllowed(PERIPH_BASE, 4));
+    TEST_CHECK(!IsWatchAddressAllowed(0xFFFFFFFC, 4));
+    TEST_CHECK(!IsWatchAddressAllowed(0, 1));
+}
+
+static void TestWatchList(void) {
+    WatchType_TypeDef type;
+    WatchVariable_TypeDef variable = { 0, WATCH_TYPE_U8 };
+    int i;
+
+    TEST_CHECK_EQUAL(ClearWatchVariables(), FCB_OK);
+    TEST_CHECK_EQUAL(ParseWatchType("f32", &type), FCB_OK);
+    TEST_CHECK_EQUAL(type, WATCH_TYPE_F32);
+    TEST_CHECK_EQUAL(ParseWatchType("i16 2", &type), FCB_OK);
+    TEST_CHECK_EQUAL(type, WATCH_TYPE_I16);
+    TEST_CHECK_EQUAL(ParseWatchType("u3", &type), FCB_ERR);
+    TEST_CHECK_EQUAL(ParseWatchType("u322", &type), FCB_ERR);
+    TEST_CHECK(strcmp(GetWatchTypeName(WATCH_TYPE_U16), "u16") == 0);
+    TEST_CHECK(strcmp(GetWatchTypeName(WATCH_TYPE_COUNT), "?") == 0);
+
+    TEST_CHECK_EQUAL(AddWatchVariable(SRAM_BASE + 1, WATCH_TYPE_U32), FCB_ERR);
+    TEST_CHECK_EQUAL(AddWatchVariable(SRAM_BASE, WATCH_TYPE_COUNT), FCB_ERR);
+    TEST_CHECK_EQUAL(GetWatchVariableCount(), 0);
+    TEST_CHECK_EQUAL(StartVariableWatch(1), FCB_ERR);
+
+    for (i = 0; i < WATCH_MAX_VARIABLES; i++)
+        TEST_CHECK_EQUAL(AddWatchVariable(SRAM_BASE + 4*i, WATCH_TYPE_F32), FCB_OK);
+    TEST_CHECK_EQUAL(AddWatchVariable(SRAM_BASE, WATCH_TYPE_U8), FCB_ERR);
+    TEST_CHECK_EQUAL(GetWatchVariableCount(), WATCH_MAX_VARIABLES);
+    TEST_CHECK_EQUAL(GetWatchVariable(3, &variable), FCB_OK);
+    TEST_CHECK_EQUAL(variable.address, SRAM_BASE + 12);
+    TEST_CHECK_EQUAL(variable.type, WATCH_TYPE_F32);
+    TEST_CHECK_EQUAL(GetWatchVariable(WATCH_MAX_VARIABLES, &variable), FCB_ERR);
+    TEST_CHECK_EQUAL(watchSampleSize, WATCH_MAX_VARIABLES*4);
+
+    TEST_CHECK_EQUAL(ClearWatchVariables(), FCB_OK);
+    TEST_CHECK_EQUAL(GetWatchVariableCount(), 0);
+    TEST_CHECK_EQUAL(watchSampleSize, 0);
+}
+
+static void TestWatchStream(void) {
+    volatile uint8_t* const u8Value = (volatile uint8_t*) (uintptr_t) (SRAM_BASE + 0x101);
+    volatile int16_t* const i16Value = (volatile int16_t*) (uintptr_t) (SRAM_BASE + WATCH_SRAM_SIZE - 2);
+    volatile uint32_t* const u32Value = (volatile uint32_t*) (uintptr_t) (SRAM_BASE + 0x200);
+    volatile float32_t* const f32Value = (volatile float32_t*) (uintptr_t) (CCMDATARAM_BASE + 0x40);
+    const uint16_t loopDivider = 3;
+    uint8_t values[WATCH_MAX_VARIABLES * WATCH_MAX_VALUE_SIZE];
+    uint32_t sampleCounter, u32Read;
+    int16_t i16Read;
+    float32_t f32Read;
+    unsigned int offset = 0;
+    int i, frames = 0;
+
+    TEST_CHECK_EQUAL(ClearWatchVariables(), FCB_OK);
+    TEST_CHECK_EQUAL(AddWatchVariable((uint32_t) (uintptr_t) u8Value, WATCH_TYPE_U8), FCB_OK);
+    TEST_CHECK_EQUAL(AddWatchVariable((uint32_t) (uintptr_t) i16Value, WATCH_TYPE_I16), FCB_OK);
+    TEST_CHECK_EQUAL(AddWatchVariable((uint32_t) (uintptr_t) u32Value, WATCH_TYPE_U32), FCB_OK);
+    TEST_CHECK_EQUAL(AddWatchVariable((uint32_t) (uintptr_t) f32Value, WATCH_TYPE_F32), FCB_OK);
+    TEST_CHECK_EQUAL(StartVariableWatch(loopDivider), FCB_OK);
+    TEST_CHECK(IsVariableWatchRunning());
+    TEST_CHECK_EQUAL(StartVariableWatch(loopDivider), FCB_ERR);
+    TEST_CHECK_EQUAL(AddWatchVariable(SRAM_BASE, WATCH_TYPE_U8), FCB_ERR);
+
+    /* The flight control loop updates the variables and calls the hook, every third call takes a sample */
+    for (i = 1; i <= 4*loopDivider; i++) {
+        *u8Value = (uint8_t) (200 + i);
+        *i16Value = (int16_t) (-1000*i);
+        *u32Value = 0x80000000u + i;
+        *f32Value = 0.25f*i;
+        WatchSampleHook();
+    }
+    TEST_CHECK_EQUAL(StopVariableWatch(), FCB_OK);
+    TEST_CHECK_EQUAL(StopVariableWatch(), FCB_ERR);
+    WatchSampleHook();
+    TEST_CHECK_EQUAL(queueCount, 4);
+
+    RunWatchTxTask();
+    TEST_CHECK(WatchTxTaskHandle == NULL);
+    TEST_CHECK_EQUAL(queueCount, 0);
+
+    while (offset < sentSize) {
+        const int loop = (frames + 1)*loopDivider;
+
+        TEST_CHECK_EQUAL(DecodeFrame(&offset, &sampleCounter, values), sizeof(uint32_t) + 1 + 2 + 4 + 4);
+        TEST_CHECK_EQUAL(sampleCounter, frames);
+        TEST_CHECK_EQUAL(values[0], 200 + loop);
+        memcpy(&i16Read, &values[1], sizeof(i16Read));
+        TEST_CHECK_EQUAL(i16Read, -1000*loop);
+        memcpy(&u32Read, &values[3], sizeof(u32Read));
+        TEST_CHECK_EQUAL(u32Read, 0x80000000u + loop);
+        memcpy(&f32Read, &values[7], sizeof(f32Read));
+        TEST_CHECK_CLOSE(f32Read, 0.25f*loop, 0.0);
+        if (++frames > 4)
+            break;
+    }
+    TEST_CHECK_EQUAL(frames, 4);
+    TEST_CHECK_EQUAL(offset, sentSize);
+    TEST_CHECK_EQUAL(GetVariableWatchDropCount(), 0);
+}
+
+static void TestWatchSheddingAndDrops(void) {
+    uint8_t values[WATCH_MAX_VARIABLES * WATCH_MAX_VALUE_SIZE];
+    uint32_t sampleCounter, expectedCounter;
+    unsigned int offset = 0;
+    int i;
+
+    /* The list is kept from the previous test, restart with a sample every loop and shed every odd sample */
+    TEST_CHECK_EQUAL(StartVariableWatch(0), FCB_OK);
+    slackSheddingOdd = true;
+    for (i = 0; i < 4*WATCH_QUEUE_SIZE; i++)
+        WatchSampleHook();
+    slackSheddingOdd = false;
+    TEST_CHECK_EQUAL(StopVariableWatch(), FCB_OK);
+
+    /* 16 samples not shed, of which the queue takes the first 8 */
+    TEST_CHECK_EQUAL(queueCount, WATCH_QUEUE_SIZE);
+    TEST_CHECK_EQUAL(GetVariableWatchDropCount(), 2*WATCH_QUEUE_SIZE - WATCH_QUEUE_SIZE);
+
+    RunWatchTxTask();
+    for (expectedCounter = 0; expectedCounter < 2*WATCH_QUEUE_SIZE; expectedCounter += 2) {
+        TEST_CHECK(DecodeFrame(&offset, &sampleCounter, values) > 0);
+        TEST_CHECK_EQUAL(sampleCounter, expectedCounter);
+    }
+    TEST_CHECK_EQUAL(offset, sentSize);
+    TEST_CHECK_EQUAL(errorHandlerCalls, 0);
+}
+
+/* Exported functions --------------------------------------------------------*/
+
+int main(void) {
+    if (!MapTargetAddress(SRAM_BASE, WATCH_SRAM_SIZE) || !MapTargetAddress(CCMDATARAM_BASE, WATCH_CCM_SIZE)) {
+        printf("Could not map the target RAM addresses\n");
+        return EXIT_FAILURE;
+    }
+
+    TEST_RUN(TestWatchAddressCheck);
+    TEST_RUN(TestWatchList);
+    TEST_RUN(TestWatchStream);
+    TEST_RUN(TestWatchSheddingAndDrops);
+    return TEST_RESULT();
+}
+
+/**
+ * @}
+ */
+
+/**
+ * @}
+ */
+/*****END OF FILE****/
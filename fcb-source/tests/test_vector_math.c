@@ -0,0 +1,283 @@
+/******************************************************************************
+ * @brief   Host tests of the vector, matrix and quaternion library
+ *          (vector_math.h) and of its use in rotation_transformation.c:
+ *          - every function gives the same result when the destination is
+ *            one of its sources
+ *          - quaternion normalization and the rotation matrix and quaternion
+ *            conversions
+ *          - regression of the DCM initialization, whose inverse was built
+ *            from the angular rate matrix instead of the DCM
+ *          - regression of the in place tilt compensation in GetMagYawAngle
+ *
+ *          rotation_transformation.c is included so that the test can read
+ *          its static rotation matrices.
+ *
+ * @license
+ * Dragonfly FCB firmware to control the Dragonfly quadrotor UAV
+ * Copyright (C) 2016  ÅF Technology South: Dragonfly Project
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA
+ *****************************************************************************/
+
+/* Includes ------------------------------------------------------------------*/
+#include "test_common.h"
+
+#include "../fcb/src/rotation_transformation.c"
+
+#include <string.h>
+
+/* Private define ------------------------------------------------------------*/
+#define EXACT_TOLERANCE     0.0
+#define FLOAT_TOLERANCE     1e-6
+#define TABLE_TOLERANCE     1e-4    // FastSinCos interpolation error, see test_math_tables.c
+
+/* Private variables ---------------------------------------------------------*/
+static const float32_t vectorA[3] = { 0.3f, -1.2f, 9.7f };
+static const float32_t vectorB[3] = { -2.5f, 0.75f, 1.125f };
+static const float32_t matrixA[9] = { 1.0f, 2.0f, -3.0f, 0.5f, -4.0f, 6.0f, 7.0f, 0.25f, -1.5f };
+static const float32_t matrixB[9] = { -2.0f, 1.5f, 0.0f, 3.0f, 0.125f, -1.0f, 4.0f, 2.0f, 5.0f };
+static const float32_t quatP[4] = { 0.9f, 0.1f, -0.3f, 0.2f };
+static const float32_t quatQ[4] = { 0.4f, -0.5f, 0.6f, 0.1f };
+
+/* Private functions ---------------------------------------------------------*/
+
+static void CheckArraysClose(const float32_t* actual, const float32_t* expected, const int size, const double tolerance) {
+    int i;
+
+    for (i = 0; i < size; i++)
+        TEST_CHECK_CLOSE(actual[i], expected[i], tolerance);
+}
+
+/* Euler angles (Z-Y-X) to the quaternion of the body to world rotation, from three axis rotations */
+static void QuatFromEuler(float32_t* dst, const float32_t roll, const float32_t pitch, const float32_t yaw) {
+    const float32_t xAxis[3] = { 1.0f, 0.0f, 0.0f }, yAxis[3] = { 0.0f, 1.0f, 0.0f }, zAxis[3] = { 0.0f, 0.0f, 1.0f };
+    float32_t qRoll[4], qPitch[4], qYaw[4];
+
+    QuatFromAxisAngle(qRoll, xAxis, roll);
+    QuatFromAxisAngle(qPitch, yAxis, pitch);
+    QuatFromAxisAngle(qYaw, zAxis, yaw);
+    QuatMult(dst, qPitch, qRoll);
+    QuatMult(dst, qYaw, dst);
+}
+
+static void TestVectorAliasing(void) {
+    float32_t expected[3], v[3];
+
+    Vec3Cross(expected, vectorA, vectorB);
+    Vec3Copy(v, vectorA);
+    Vec3Cross(v, v, vectorB);
+    CheckArraysClose(v, expected, 3, EXACT_TOLERANCE);
+    Vec3Copy(v, vectorB);
+    Vec3Cross(v, vectorA, v);
+    CheckArraysClose(v, expected, 3, EXACT_TOLERANCE);
+
+    Vec3Cross(expected, vectorA, vectorA);
+    Vec3Copy(v, vectorA);
+    Vec3Cross(v, v, v);
+    CheckArraysClose(v, expected, 3, EXACT_TOLERANCE);
+
+    Vec3Scale(expected, vectorA, -0.5f);
+    Vec3Copy(v, vectorA);
+    Vec3Scale(v, v, -0.5f);
+    CheckArraysClose(v, expected, 3, EXACT_TOLERANCE);
+
+    Vec3Normalize(expected, vectorA);
+    Vec3Copy(v, vectorA);
+    Vec3Normalize(v, v);
+    CheckArraysClose(v, expected, 3, EXACT_TOLERANCE);
+    TEST_CHECK_CLOSE(Vec3Norm(v), 1.0, FLOAT_TOLERANCE);
+}
+
+static void TestMatrixAliasing(void) {
+    float32_t expected[9], m[9], v[3];
+
+    Mat3Transpose(expected, matrixA);
+    memcpy(m, matrixA, sizeof(m));
+    Mat3Transpose(m, m);
+    CheckArraysClose(m, expected, 9, EXACT_TOLERANCE);
+    TEST_CHECK_EQUAL(m[1], matrixA[3]);
+
+    Mat3MultVec3(expected, matrixA, vectorA);
+    Vec3Copy(v, vectorA);
+    Mat3MultVec3(v, matrixA, v);
+    CheckArraysClose(v, expected, 3, EXACT_TOLERANCE);
+
+    Mat3TransMultVec3(expected, matrixA, vectorA);
+    Vec3Copy(v, vectorA);
+    Mat3TransMultVec3(v, matrixA, v);
+    CheckArraysClose(v, expected, 3, EXACT_TOLERANCE);
+
+    Mat3Mult(expected, matrixA, matrixB);
+    memcpy(m, matrixA, sizeof(m));
+    Mat3Mult(m, m, matrixB);
+    CheckArraysClose(m, expected, 9, EXACT_TOLERANCE);
+    memcpy(m, matrixB, sizeof(m));
+    Mat3Mult(m, matrixA, m);
+    CheckArraysClose(m, expected, 9, EXACT_TOLERANCE);
+
+    Mat3Mult(expected, matrixA, matrixA);
+    memcpy(m, matrixA, sizeof(m));
+    Mat3Mult(m, m, m);
+    CheckArraysClose(m, expected, 9, EXACT_TOLERANCE);
+}
+
+static void TestQuaternionAliasing(void) {
+    float32_t expected[4], q[4], unitQ[4], v[3], expectedV[3];
+
+    QuatMult(expected, quatP, quatQ);
+    memcpy(q, quatP, sizeof(q));
+    QuatMult(q, q, quatQ);
+    CheckArraysClose(q, expected, 4, EXACT_TOLERANCE);
+    memcpy(q, quatQ, sizeof(q));
+    QuatMult(q, quatP, q);
+    CheckArraysClose(q, expected, 4, EXACT_TOLERANCE);
+
+    QuatMult(expected, quatP, quatP);
+    memcpy(q, quatP, sizeof(q));
+    QuatMult(q, q, q);
+    CheckArraysClose(q, expected, 4, EXACT_TOLERANCE);
+
+    QuatConjugate(expected, quatP);
+    memcpy(q, quatP, sizeof(q));
+    QuatConjugate(q, q);
+    CheckArraysClose(q, expected, 4, EXACT_TOLERANCE);
+
+    QuatNormalize(expected, quatP);
+    memcpy(q, quatP, sizeof(q));
+    QuatNormalize(q, q);
+    CheckArraysClose(q, expected, 4, EXACT_TOLERANCE);
+
+    QuatNormalize(unitQ, quatQ);
+    QuatRotateVec3(expectedV, unitQ, vectorA);
+    Vec3Copy(v, vectorA);
+    QuatRotateVec3(v, unitQ, v);
+    CheckArraysClose(v, expectedV, 3, EXACT_TOLERANCE);
+}
+
+static void TestQuaternionNormalization(void) {
+    const float32_t scales[] = { 1e-3f, 0.5f, 1.0f, 7.0f, 1e3f };
+    float32_t q[4], unitQ[4], identity[4], m[9], mT[9], product[9], rotated[3], expected[3];
+    unsigned int i;
+
+    for (i = 0; i < sizeof(scales)/sizeof(scales[0]); i++) {
+        q[0] = quatQ[0]*scales[i];
+        q[1] = quatQ[1]*scales[i];
+        q[2] = quatQ[2]*scales[i];
+        q[3] = quatQ[3]*scales[i];
+        QuatNormalize(unitQ, q);
+
+        TEST_CHECK_CLOSE(unitQ[0]*unitQ[0] + unitQ[1]*unitQ[1] + unitQ[2]*unitQ[2] + unitQ[3]*unitQ[3], 1.0,
+                FLOAT_TOLERANCE);
+        /* Same direction as the source */
+        TEST_CHECK_CLOSE(unitQ[1]*q[0], unitQ[0]*q[1], FLOAT_TOLERANCE*scales[i]);
+        TEST_CHECK(unitQ[0] > 0.0f);
+
+        /* A unit quaternion keeps the vector length and equals its rotation matrix */
+        QuatRotateVec3(rotated, unitQ, vectorA);
+        TEST_CHECK_CLOSE(Vec3Norm(rotated), Vec3Norm(vectorA), 1e-5);
+        QuatToMat3(m, unitQ);
+        Mat3MultVec3(expected, m, vectorA);
+        CheckArraysClose(rotated, expected, 3, 1e-5);
+
+        /* The rotation matrix is orthonormal */
+        Mat3Transpose(mT, m);
+        Mat3Mult(product, m, mT);
+        Mat3Identity(m);
+        CheckArraysClose(product, m, 9, FLOAT_TOLERANCE);
+
+        /* q * q^-1 is the identity */
+        QuatConjugate(q, unitQ);
+        QuatMult(q, unitQ, q);
+        QuatIdentity(identity);
+        CheckArraysClose(q, identity, 4, FLOAT_TOLERANCE);
+    }
+}
+
+static void TestRotationMatrixInit(void) {
+    const float32_t angles[][3] = { { 0.0f, 0.0f, 0.0f }, { 0.4f, -0.3f, 1.2f }, { -1.0f, 0.7f, -2.9f } };
+    float32_t identity[9], transposed[9], product[9], quatMatrix[9], q[4];
+    unsigned int i;
+
+    Mat3Identity(identity);
+
+    /* The DCM inverse used to be built from the angular rate matrix, which is not the identity after an update */
+    TEST_CHECK(UpdateAngularRotationMatrix(0.4f, 0.3f) == TRANSF_OK);
+    InitRotationMatrix();
+    CheckArraysClose(DCMf32, identity, 9, EXACT_TOLERANCE);
+    CheckArraysClose(DCMInvf32, identity, 9, EXACT_TOLERANCE);
+
+    InitAngularRotationMatrix();
+    CheckArraysClose(angRateMatrixf32, identity, 9, EXACT_TOLERANCE);
+
+    for (i = 0; i < sizeof(angles)/sizeof(angles[0]); i++) {
+        TEST_CHECK(UpdateAngularRotationMatrix(angles[i][1], angles[i][0]) == TRANSF_OK);
+        UpdateRotationMatrix(angles[i][0], angles[i][1], angles[i][2]);
+
+        /* The inverse is the transpose of the DCM, and the DCM is orthonormal */
+        Mat3Transpose(transposed, DCMf32);
+        CheckArraysClose(DCMInvf32, transposed, 9, EXACT_TOLERANCE);
+        Mat3Mult(product, DCMf32, DCMInvf32);
+        CheckArraysClose(product, identity, 9, TABLE_TOLERANCE);
+
+        /* The DCM rotates from world to body frame, i.e. it is the inverse of the Z-Y-X body to world rotation */
+        QuatFromEuler(q, angles[i][0], angles[i][1], angles[i][2]);
+        QuatToMat3(quatMatrix, q);
+        CheckArraysClose(DCMInvf32, quatMatrix, 9, TABLE_TOLERANCE);
+    }
+}
+
+static void TestMagYawAngle(void) {
+    const float32_t field[3] = { 0.8f, 0.0f, 0.6f }, yaws[] = { 0.0f, 0.8f, -2.5f };
+    const float32_t roll = 0.3f, pitch = -0.2f;
+    float32_t q[4], mag[3], normalized[3], compensated[3];
+    unsigned int i;
+
+    /* Without tilt the yaw of the field rotated into the body frame is given back */
+    for (i = 0; i < sizeof(yaws)/sizeof(yaws[0]); i++) {
+        QuatFromEuler(q, 0.0f, 0.0f, yaws[i]);
+        QuatConjugate(q, q);
+        QuatRotateVec3(mag, q, field);
+        TEST_CHECK_CLOSE(GetMagYawAngle(mag, 0.0f, 0.0f), yaws[i], TABLE_TOLERANCE);
+    }
+
+    /* GetMagYawAngle tilt compensates in place, which used to read the already overwritten source */
+    Vec3Normalize(normalized, mag);
+    Vector3DTiltCompensate(compensated, normalized, roll, pitch);
+    Vector3DTiltCompensate(normalized, normalized, roll, pitch);
+    CheckArraysClose(normalized, compensated, 3, EXACT_TOLERANCE);
+    TEST_CHECK_CLOSE(GetMagYawAngle(mag, roll, pitch), atan2f(-compensated[1], compensated[0]), FLOAT_TOLERANCE);
+}
+
+/* Exported functions --------------------------------------------------------*/
+
+int main(void) {
+    TEST_RUN(TestVectorAliasing);
+    TEST_RUN(TestMatrixAliasing);
+    TEST_RUN(TestQuaternionAliasing);
+    TEST_RUN(TestQuaternionNormalization);
+    TEST_RUN(TestRotationMatrixInit);
+    TEST_RUN(TestMagYawAngle);
+
+    return TEST_RESULT();
+}
+
+/**
+ * @}
+ */
+
+/**
+ * @}
+ */
+/*****END OF FILE****/
@@ -0,0 +1,279 @@
+#!/usr/bin/env python3
+"""
+Host simulation of the adaptive accelerometer and magnetometer sampling
+(fcb/src/adaptive_sampling.c). Compares the attitude estimation error with
+the I2C bus time and CPU time saved against sampling at the highest rates.
+
+    python3 tools/adaptive_sampling_sim.py --duration 20
+
+The firmware rate selection is compiled from its source with the host C
+compiler and driven through ctypes. The roll, pitch and yaw estimators are a
+model of state_estimation.c: the same three state Kalman filter and noise
+parameters, a prediction and a gyroscope correction every loop period and an
+attitude correction per accelerometer or magnetometer sample.
+
+The simulated vehicle flies a hover, an aggressive flight and a mixed flight
+that alternates between the two. The gyroscope has a bias and a scale error,
+the accelerometer attitude is disturbed by the linear acceleration of
+maneuvers and the magnetometer yaw by the roll and pitch errors of its tilt
+compensation, so that the innovations grow in aggressive flight.
+
+A blocking I2C transfer keeps the sensor task busy for the whole transfer,
+so the CPU time of a sample is its bus time plus the correction cost
+(LOOP_COST_ACC_CORRECTION in loop_costs.h).
+"""
+
+import argparse
+import ctypes
+import math
+import os
+import random
+import subprocess
+import sys
+import tempfile
+
+SOURCE_DIR = os.path.join(os.path.dirname(os.path.abspath(__file__)), "..", "fcb")
+
+LOOP_RATE_HZ = 400
+CPU_CLOCK_HZ = 72000000
+CORRECTION_CYCLES = 3000                # LOOP_COST_ACC_CORRECTION, LOOP_COST_MAG_CORRECTION
+READ_BITS = (4 + 6) * 9 + 3             # Register read: address, register, address, 6 data bytes, start/restart/stop
+RATE_CHANGE_BITS = 3 * 9 + 2            # Register write: address, register, value
+
+# state_estimation.h and fcb_gyroscope.c
+Q1_RP, Q2_RP = 0.0008, 0.0008
+Q1_Y, Q2_Y = 0.0004, 0.0003
+Q3_CAL = 0.000002
+R1_ACCRP, R1_MAG = 0.8, 0.05
+GYRO_VARIANCE = 0.1
+
+ADAPTIVE_SENSOR_ACC, ADAPTIVE_SENSOR_MAG = 0, 1
+ADAPTIVE_MAX_RATES = 4
+
+
+class AdaptiveSamplingStats(ctypes.Structure):
+    _fields_ = [("rateHz", ctypes.c_uint16), ("maxRateHz", ctypes.c_uint16), ("achievedRateHz", ctypes.c_uint16),
+                ("innovationRms", ctypes.c_float), ("errorStd", ctypes.c_float), ("samples", ctypes.c_uint32),
+                ("rateChanges", ctypes.c_uint32), ("samplesAtRate", ctypes.c_uint32 * ADAPTIVE_MAX_RATES)]
+
+
+def load_rate_selection(workdir):
+    library = os.path.join(workdir, "adaptive_sampling.so")
+    subprocess.check_call([os.environ.get("CC", "cc"), "-std=c99", "-O2", "-shared", "-fPIC",
+                           "-I" + os.path.join(SOURCE_DIR, "inc"),
+                           os.path.join(SOURCE_DIR, "src", "adaptive_sampling.c"), "-o", library, "-lm"])
+    lib = ctypes.CDLL(library)
+    lib.UpdateAdaptiveSampling.argtypes = [ctypes.c_int, ctypes.c_float, ctypes.c_float, ctypes.c_uint32]
+    lib.SetAdaptiveSamplingEnabled.argtypes = [ctypes.c_bool]
+    lib.GetAdaptiveSampleRateHz.argtypes = [ctypes.c_int]
+    lib.GetAdaptiveSampleRateHz.restype = ctypes.c_uint16
+    lib.GetAdaptiveSamplingStats.argtypes = [ctypes.c_int, ctypes.POINTER(AdaptiveSamplingStats)]
+    return lib
+
+
+class AttitudeEstimator:
+    """One axis of state_estimation.c: angle, angle rate and angle rate bias."""
+
+    def __init__(self, q1, q2, r1, r2, angle):
+        self.q1, self.q2, self.q3, self.r1, self.r2 = q1, q2, Q3_CAL, r1, r2
+        self.h = 1.0 / LOOP_RATE_HZ
+        self.p = [[0.1, 0.0, 0.0], [0.0, 1.0, 0.0], [0.0, 0.0, 0.01]]
+        self.angle, self.rate, self.bias = angle, 0.0, 0.0
+
+    def predict(self):
+        p, h = self.p, self.h
+        self.angle += h * (self.rate - self.bias)
+        self.p = [[p[0][0] + h * (p[0][1] - p[0][2] + p[1][0] - p[2][0])
+                   + h * h * (p[1][1] - p[1][2] - p[2][1] + p[2][2]) + self.q1,
+                   p[0][1] + h * (p[1][1] - p[2][1]), p[0][2] + h * (p[1][2] - p[2][2])],
+                  [p[1][0] + h * (p[1][1] - p[1][2]), p[1][1] + self.q2, p[1][2]],
+                  [p[2][0] + h * (p[2][1] - p[2][2]), p[2][1], p[2][2] + self.q3]]
+
+    def correct_angle(self, measured):
+        """Returns the innovation and the a priori error variance."""
+        p = self.p
+        prior_variance = p[0][0]
+        y = wrap(measured - self.angle)
+        s11, s12, s21, s22 = p[0][0] + self.r1, p[0][1], p[1][0], p[1][1] + self.r2
+        inv_det = 1.0 / (s11 * s22 - s12 * s21)
+        k1 = inv_det * (p[0][0] * s22 - p[0][1] * s21)
+        k2 = inv_det * (p[1][0] * s22 - p[1][1] * s21)
+        k3 = inv_det * (p[2][0] * s22 - p[2][1] * s21)
+        self.angle = wrap(self.angle + k1 * y)
+        self.rate += k2 * y
+        self.bias += k3 * y
+        self.p = [[p[0][j] - p[0][j] * k1 for j in range(3)],
+                  [p[1][j] - p[0][j] * k2 for j in range(3)],
+                  [p[2][j] - p[0][j] * k3 for j in range(3)]]
+        return y, prior_variance
+
+    def correct_rate(self, measured):
+        p = self.p
+        y = measured - self.rate
+        s11, s12, s21, s22 = p[0][0] + self.r1, p[0][1], p[1][0], p[1][1] + self.r2
+        inv_det = 1.0 / (s11 * s22 - s12 * s21)
+        k1 = inv_det * (p[0][1] * s11 - p[0][0] * s12)
+        k2 = inv_det * (p[1][1] * s11 - p[1][0] * s12)
+        k3 = inv_det * (p[2][1] * s11 + p[2][0] * s12)
+        self.angle += k1 * y
+        self.rate += k2 * y
+        self.bias += k3 * y
+        self.p = [[p[0][j] - p[1][j] * k1 for j in range(3)],
+                  [p[1][j] - p[1][j] * k2 for j in range(3)],
+                  [p[2][j] - p[1][j] * k3 for j in range(3)]]
+
+
+def wrap(angle):
+    return (angle + math.pi) % (2 * math.pi) - math.pi
+
+
+class Flight:
+    """Vehicle attitude: a slow hover wander plus maneuvers while aggressive."""
+
+    def __init__(self, profile, duration, rng):
+        self.profile, self.duration = profile, duration
+        self.phases = [(rng.uniform(0, 2 * math.pi), rng.uniform(0.8, 1.2)) for _ in range(6)]
+
+    def aggressive(self, t):
+        if self.profile == "hover":
+            return 0.0
+        if self.profile == "aggressive":
+            return 1.0
+        # mixed: 5 s hover and 5 s aggressive flight with 1 s transitions
+        cycle = t % 10.0
+        ramp = min(max(cycle - 5.0, 0.0), 1.0) if cycle < 9.0 else 10.0 - cycle
+        return 0.5 - 0.5 * math.cos(math.pi * ramp)
+
+    def angles(self, t):
+        a = self.aggressive(t)
+        angles = []
+        for axis in range(3):
+            phase, scale = self.phases[axis]
+            hover = math.radians(1.5) * math.sin(2 * math.pi * 0.2 * scale * t + phase)
+            maneuver = math.radians(90.0 if axis == 2 else 30.0) * math.sin(
+                2 * math.pi * (0.3 if axis == 2 else 1.2) * scale * t + phase)
+            angles.append(hover + a * maneuver)
+        return angles
+
+    def attitude(self, t):
+        """Returns angle, rate and angular acceleration of roll, pitch and yaw."""
+        dt = 1e-4
+        before, now, after = self.angles(t - dt), self.angles(t), self.angles(t + dt)
+        return [(now[axis], (after[axis] - before[axis]) / (2 * dt),
+                 (after[axis] - 2 * now[axis] + before[axis]) / (dt * dt)) for axis in range(3)]
+
+
+def simulate(lib, profile, adaptive, args, seed):
+    rng = random.Random(seed)
+    flight = Flight(profile, args.duration, rng)
+    lib.InitAdaptiveSampling()
+    lib.SetAdaptiveSamplingEnabled(adaptive)
+
+    truth = flight.attitude(0.0)
+    estimators = [AttitudeEstimator(Q1_RP, Q2_RP, R1_ACCRP, GYRO_VARIANCE, truth[0][0]),
+                  AttitudeEstimator(Q1_RP, Q2_RP, R1_ACCRP, GYRO_VARIANCE, truth[1][0]),
+                  AttitudeEstimator(Q1_Y, Q2_Y, R1_MAG, GYRO_VARIANCE, truth[2][0])]
+    gyro_bias = [rng.gauss(0.0, args.gyro_bias) for _ in range(3)]
+    gyro_scale = [1.0 + rng.gauss(0.0, args.gyro_scale_error) for _ in range(3)]
+
+    next_sample = [0.0, 0.0]
+    rate_hz = [0, 0]
+    reads = [0, 0]
+    rate_changes = 0
+    squared_error = [0.0, 0.0, 0.0]
+    max_error = [0.0, 0.0, 0.0]
+    loops = int(args.duration * LOOP_RATE_HZ)
+
+    for loop in range(loops):
+        t = loop / LOOP_RATE_HZ
+        truth = flight.attitude(t)
+        for axis, estimator in enumerate(estimators):
+            estimator.predict()
+            gyro = truth[axis][1] * gyro_scale[axis] + gyro_bias[axis] + rng.gauss(0.0, args.gyro_noise)
+            estimator.correct_rate(gyro)
+
+        for sensor in (ADAPTIVE_SENSOR_ACC, ADAPTIVE_SENSOR_MAG):
+            if t < next_sample[sensor]:
+                continue
+            requested = lib.GetAdaptiveSampleRateHz(sensor)
+            if requested != rate_hz[sensor]:
+                rate_hz[sensor] = requested
+                rate_changes += 1
+            next_sample[sensor] += 1.0 / rate_hz[sensor]
+            reads[sensor] += 1
+
+            if sensor == ADAPTIVE_SENSOR_ACC:
+                # Linear acceleration of maneuvers disturbs the gravity direction
+                corrections = []
+                for axis in (0, 1):
+                    disturbance = args.acc_disturbance * truth[axis][2] * flight.aggressive(t)
+                    measured = truth[axis][0] + disturbance + rng.gauss(0.0, args.acc_noise)
+                    corrections.append(estimators[axis].correct_angle(measured))
+            else:
+                # The yaw is tilt compensated with the estimated roll and pitch
+                tilt_error = (wrap(estimators[0].angle - truth[0][0]) * math.sin(truth[2][0])
+                              + wrap(estimators[1].angle - truth[1][0]) * math.cos(truth[2][0]))
+                measured = truth[2][0] + args.mag_tilt_coupling * tilt_error + rng.gauss(0.0, args.mag_noise)
+                corrections = [estimators[2].correct_angle(measured)]
+
+            innovation = max(abs(y) for y, _ in corrections)
+            variance = max(v for _, v in corrections)
+            lib.UpdateAdaptiveSampling(sensor, innovation, variance, int(t * 1000))
+
+        for axis in range(3):
+            error = abs(wrap(estimators[axis].angle - truth[axis][0]))
+            squared_error[axis] += error * error
+            max_error[axis] = max(max_error[axis], error)
+
+    bus_time = (sum(reads) * READ_BITS + rate_changes * RATE_CHANGE_BITS) / (args.i2c_khz * 1000.0)
+    cpu_time = bus_time + sum(reads) * CORRECTION_CYCLES / float(CPU_CLOCK_HZ)
+    return {
+        "rms": [math.degrees(math.sqrt(e / loops)) for e in squared_error],
+        "max": [math.degrees(e) for e in max_error],
+        "rates": [reads[s] / args.duration for s in (ADAPTIVE_SENSOR_ACC, ADAPTIVE_SENSOR_MAG)],
+        "bus": 100.0 * bus_time / args.duration,
+        "cpu": 100.0 * cpu_time / args.duration,
+    }
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("--duration", type=float, default=20.0, help="simulated time per flight [s]")
+    parser.add_argument("--runs", type=int, default=3, help="runs per flight with different noise")
+    parser.add_argument("--i2c-khz", type=float, default=400.0, help="I2C bus clock [kHz]")
+    parser.add_argument("--gyro-noise", type=float, default=0.01, help="gyroscope noise [rad/s]")
+    parser.add_argument("--gyro-bias", type=float, default=0.02, help="gyroscope bias spread [rad/s]")
+    parser.add_argument("--gyro-scale-error", type=float, default=0.03, help="gyroscope scale error spread")
+    parser.add_argument("--acc-noise", type=float, default=0.02, help="accelerometer attitude noise [rad]")
+    parser.add_argument("--acc-disturbance", type=float, default=0.005,
+                        help="accelerometer attitude error per angular acceleration [rad per rad/s2]")
+    parser.add_argument("--mag-noise", type=float, default=0.03, help="magnetometer yaw noise [rad]")
+    parser.add_argument("--mag-tilt-coupling", type=float, default=2.0,
+                        help="yaw error per roll and pitch error, tan of the field inclination")
+    args = parser.parse_args()
+
+    workdir = tempfile.mkdtemp(prefix="fcb-adaptive-")
+    lib = load_rate_selection(workdir)
+
+    print("%-11s %-9s %20s %20s %9s %9s %7s %7s" % ("flight", "sampling", "RMS err r/p/y [deg]",
+                                                   "max err r/p/y [deg]", "acc [Hz]", "mag [Hz]", "bus %", "CPU %"))
+    for profile in ("hover", "aggressive", "mixed"):
+        results = {}
+        for adaptive in (False, True):
+            runs = [simulate(lib, profile, adaptive, args, seed) for seed in range(args.runs)]
+            result = {key: [sum(r[key][i] for r in runs) / len(runs) for i in range(len(runs[0][key]))]
+                      if isinstance(runs[0][key], list) else sum(r[key] for r in runs) / len(runs)
+                      for key in runs[0]}
+            results[adaptive] = result
+            print("%-11s %-9s %20s %20s %9.0f %9.0f %7.2f %7.2f" % (
+                profile, "adaptive" if adaptive else "fixed",
+                "/".join("%.2f" % e for e in result["rms"]), "/".join("%.2f" % e for e in result["max"]),
+                result["rates"][0], result["rates"][1], result["bus"], result["cpu"]))
+        fixed, adaptive = results[False], results[True]
+        print("%-11s saved %.0f %% of bus time and %.0f %% of sensor CPU time, RMS error %+.2f/%+.2f/%+.2f deg" % (
+            "", 100.0 * (1.0 - adaptive["bus"] / fixed["bus"]), 100.0 * (1.0 - adaptive["cpu"] / fixed["cpu"]),
+            *(a - f for a, f in zip(adaptive["rms"], fixed["rms"]))))
+
+
+if __name__ == "__main__":
+    sys.exit(main())
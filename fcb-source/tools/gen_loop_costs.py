@@ -0,0 +1,123 @@
+#!/usr/bin/env python3
+"""
+Generates fcb/inc/loop_costs.h, the loop kernel costs that loop_rate.h checks
+the CPU budget of the loop rate profile against, from measured kernel costs.
+
+The input is the output of one of the kernel benchmarks in
+fcb/src/kernel_benchmark.c:
+
+ - "kernel-benchmark r" on target, lines of the form
+       Flight control step             8123 cyc   112819 ns    8450 mean
+   The min cycle counts are used as they are.
+ - The Profile build in QEMU, lines of the form
+       Flight control step             6020 instr     6020 mean
+   Instructions are converted to cycles with --cycles-per-instruction, which
+   covers the flash wait states and multi-cycle instructions not seen by the
+   instruction count.
+
+The kernel costs are the "Flight control step" and the "UpdateCorrectionState
+acc" and "UpdateCorrectionState mag" results plus --margin. The loop overhead
+(interrupts, context switches, phase lock, watch) is not a kernel and is given
+with --overhead.
+
+Usage (from the fcb-source directory):
+    python3 tools/gen_loop_costs.py kernel_benchmark.log [--margin 50] [--overhead 5000]
+"""
+
+import argparse
+import os
+import re
+import sys
+
+HEADER_FILE = os.path.join("fcb", "inc", "loop_costs.h")
+
+# Define name: benchmark name in kernel_benchmark.c
+KERNELS = {
+    "LOOP_COST_FLIGHT_CONTROL_STEP": "Flight control step",
+    "LOOP_COST_ACC_CORRECTION": "UpdateCorrectionState acc",
+    "LOOP_COST_MAG_CORRECTION": "UpdateCorrectionState mag",
+}
+
+RESULT_LINE = re.compile(r"^\s*(?P<name>.*?)\s+(?P<min>\d+) (?P<unit>cyc|instr)\b")
+
+
+def parse_results(lines):
+    """Returns {benchmark name: (min value, unit)} of the benchmark result lines."""
+    results = {}
+    for line in lines:
+        match = RESULT_LINE.match(line)
+        if match:
+            results[match.group("name")] = (int(match.group("min")), match.group("unit"))
+    return results
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("log", help="kernel-benchmark or Profile build output")
+    parser.add_argument("--margin", type=float, default=50.0, help="margin added to the kernel costs [%%]")
+    parser.add_argument("--overhead", type=int, default=5000, help="loop overhead [CPU cycles]")
+    parser.add_argument("--cycles-per-instruction", type=float, default=1.5,
+                        help="cycles per instruction of Profile build results")
+    parser.add_argument("--output", default=HEADER_FILE, help="header to write")
+    args = parser.parse_args()
+
+    with open(args.log, encoding="utf-8", errors="replace") as f:
+        results = parse_results(f)
+
+    costs = {}
+    sources = []
+    units = set()
+    for define, name in KERNELS.items():
+        if name not in results:
+            sys.exit("No \"%s\" result in %s" % (name, args.log))
+        value, unit = results[name]
+        units.add(unit)
+        cycles = value if unit == "cyc" else value * args.cycles_per_instruction
+        costs[define] = int(cycles * (1.0 + args.margin / 100.0) + 0.5)
+        sources.append("%s %d %s" % (name, value, unit))
+
+    with open(args.output, "w", encoding="utf-8", newline="\n") as f:
+        f.write("""/******************************************************************************
+ * @file    loop_costs.h
+ * @author  Dragonfly
+ * @version v. 1.0.0
+ * @date    2016-06-01
+ * @brief   Loop kernel costs for the CPU budget check in loop_rate.h.
+ *
+ *          Generated by tools/gen_loop_costs.py from %s, do not edit by hand.
+ *          Measured:
+%s
+ *          Margin %.0f %%%s, the loop overhead is given.
+ ******************************************************************************/
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __LOOP_COSTS_H
+#define __LOOP_COSTS_H
+
+/* Exported constants --------------------------------------------------------*/
+#define LOOP_COSTS_MEASURED                 1
+#define LOOP_COST_FLIGHT_CONTROL_STEP       %-8d// Prediction, gyroscope correction, PID and allocation
+#define LOOP_COST_ACC_CORRECTION            %-8d// At most one per loop period
+#define LOOP_COST_MAG_CORRECTION            %-8d// At most one per loop period
+#define LOOP_COST_OVERHEAD                  %-8d// Interrupts, context switches, phase lock and watch
+
+#endif /* __LOOP_COSTS_H */
+
+/**
+ * @}
+ */
+
+/**
+ * @}
+ */
+/*****END OF FILE****/
+""" % (os.path.basename(args.log), "\n".join(" *            %s" % source for source in sources), args.margin,
+       "" if units == {"cyc"} else ", %.2f cycles per instruction" % args.cycles_per_instruction,
+       costs["LOOP_COST_FLIGHT_CONTROL_STEP"], costs["LOOP_COST_ACC_CORRECTION"],
+       costs["LOOP_COST_MAG_CORRECTION"], args.overhead))
+
+    print("Wrote %s: %s" % (args.output, ", ".join("%s %d" % item for item in costs.items())))
+
+
+if __name__ == "__main__":
+    main()
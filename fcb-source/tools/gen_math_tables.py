@@ -0,0 +1,178 @@
+#!/usr/bin/env python3
+"""
+Generates utilities/src/math_tables.c with the lookup tables used by
+utilities/inc/math_tables.h and updates the table size defines in the header.
+
+ - Sine table for FastSin()/FastCos()/FastSinCos(), one full period with
+   SIN_TABLE_SIZE+1 entries (linear interpolation)
+ - Pressure to altitude table for PressureToAltitude() using the barometric
+   formula from the BMP180 datasheet (linear interpolation)
+
+Before anything is written, the interpolation is evaluated in single
+precision against the exact functions, and generation fails if the maximum
+error exceeds the given limits.
+
+Usage (from the fcb-source directory):
+    python3 tools/gen_math_tables.py [--sin-table-size 512] [--pressure-step-shift 8]
+"""
+
+import argparse
+import math
+import os
+import re
+import struct
+import sys
+
+SRC_FILE = os.path.join("utilities", "src", "math_tables.c")
+HEADER_FILE = os.path.join("utilities", "inc", "math_tables.h")
+
+SEA_LEVEL_PRESSURE = 101325.0  # [Pa]
+ALTITUDE_SCALE = 44330.0       # [m]
+ALTITUDE_EXPONENT = 1.0/5.255
+
+
+def f32(value):
+    """Rounds a Python float to the nearest single precision float."""
+    return struct.unpack("f", struct.pack("f", value))[0]
+
+
+def altitude(pressure):
+    return ALTITUDE_SCALE*(1.0 - (pressure/SEA_LEVEL_PRESSURE)**ALTITUDE_EXPONENT)
+
+
+def sin_table(size):
+    return [f32(math.sin(2.0*math.pi*i/size)) for i in range(size + 1)]
+
+
+def pressure_table(p_min, p_max, step_shift):
+    step = 1 << step_shift
+    size = (p_max - p_min + step - 1)//step + 1
+    return [f32(altitude(p_min + i*step)) for i in range(size)]
+
+
+def table_sin_cos(table, size, angle):
+    """Same algorithm as FastSinCos() in math_tables.h."""
+    if math.isnan(angle) or math.isinf(angle):
+        return math.nan, math.nan
+    if abs(angle) >= f32(1.0e5):
+        angle = math.fmod(angle, f32(2.0*math.pi))
+    findex = f32(angle*f32(size/f32(2.0*math.pi)))
+    index = int(findex)
+    if findex < 0.0:
+        index -= 1
+    fract = f32(findex - index)
+    index &= size - 1
+    cos_index = (index + size//4) & (size - 1)
+    sin_value = f32(table[index] + f32(fract*f32(table[index + 1] - table[index])))
+    cos_value = f32(table[cos_index] + f32(fract*f32(table[cos_index + 1] - table[cos_index])))
+    return sin_value, cos_value
+
+
+def table_altitude(table, p_min, step_shift, pressure):
+    """Same algorithm as PressureToAltitude() in math_tables.h."""
+    offset = pressure - p_min
+    if offset <= 0:
+        return table[0]
+    index = offset >> step_shift
+    if index >= len(table) - 1:
+        return table[-1]
+    fract = f32((offset & ((1 << step_shift) - 1))*f32(1.0/(1 << step_shift)))
+    return f32(table[index] + f32(fract*f32(table[index + 1] - table[index])))
+
+
+def format_table(values, per_line, fmt):
+    lines = []
+    for i in range(0, len(values), per_line):
+        lines.append("        " + ", ".join(fmt % v for v in values[i:i + per_line]) + ",")
+    return "\n".join(lines)
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("--sin-table-size", type=int, default=512, help="sine table entries per period (power of two)")
+    parser.add_argument("--pressure-min", type=int, default=30000, help="lowest table pressure [Pa]")
+    parser.add_argument("--pressure-max", type=int, default=110000, help="highest table pressure [Pa]")
+    parser.add_argument("--pressure-step-shift", type=int, default=8, help="log2 of table pressure step [Pa]")
+    parser.add_argument("--max-sin-error", type=float, default=5e-5, help="max allowed sin/cos error")
+    parser.add_argument("--max-altitude-error", type=float, default=0.1, help="max allowed altitude error [m]")
+    args = parser.parse_args()
+
+    size = args.sin_table_size
+    if size < 4 or size & (size - 1):
+        sys.exit("--sin-table-size must be a power of two")
+
+    sines = sin_table(size)
+    altitudes = pressure_table(args.pressure_min, args.pressure_max, args.pressure_step_shift)
+
+    # Accuracy check of the interpolated tables, including negative angles and several periods
+    max_sin_error = 0.0
+    samples = 200000
+    for i in range(samples + 1):
+        angle = f32(-4.0*math.pi + 8.0*math.pi*i/samples)
+        sin_value, cos_value = table_sin_cos(sines, size, angle)
+        max_sin_error = max(max_sin_error, abs(sin_value - math.sin(angle)), abs(cos_value - math.cos(angle)))
+
+    max_altitude_error = 0.0
+    for pressure in range(args.pressure_min, args.pressure_max + 1):
+        max_altitude_error = max(max_altitude_error,
+                abs(table_altitude(altitudes, args.pressure_min, args.pressure_step_shift, pressure) - altitude(pressure)))
+
+    print("sin/cos table: %d entries, max error %.2e" % (size + 1, max_sin_error))
+    print("altitude table: %d entries, max error %.3f m" % (len(altitudes), max_altitude_error))
+    if max_sin_error > args.max_sin_error or max_altitude_error > args.max_altitude_error:
+        sys.exit("Table accuracy requirement not met, increase the table resolution")
+
+    defines = {
+        "SIN_TABLE_SIZE": size,
+        "PRESSURE_TABLE_MIN": args.pressure_min,
+        "PRESSURE_TABLE_STEP_SHIFT": args.pressure_step_shift,
+        "PRESSURE_TABLE_SIZE": len(altitudes),
+    }
+
+    with open(HEADER_FILE, encoding="utf-8") as f:
+        header = f.read()
+    for name, value in defines.items():
+        header, count = re.subn(r"(#define %s\s+)\d+" % name, r"\g<1>%d" % value, header)
+        if count != 1:
+            sys.exit("Could not find #define %s in %s" % (name, HEADER_FILE))
+    with open(HEADER_FILE, "w", encoding="utf-8", newline="\n") as f:
+        f.write(header)
+
+    check = " || ".join("%s != %d" % (name, value) for name, value in defines.items())
+    with open(SRC_FILE, "w", encoding="utf-8", newline="\n") as f:
+        f.write("""/******************************************************************************
+ * @file    math_tables.c
+ * @author  Dragonfly
+ * @brief   Lookup tables for math_tables.h
+ *
+ *          GENERATED FILE, DO NOT EDIT. Generated by tools/gen_math_tables.py
+ *          sin/cos max interpolation error: %.2e
+ *          Altitude max interpolation error: %.3f m
+ ******************************************************************************/
+
+/* Includes ------------------------------------------------------------------*/
+#include "math_tables.h"
+
+#if %s
+#error "math_tables.c does not match math_tables.h, rerun tools/gen_math_tables.py"
+#endif
+
+/* Exported variables --------------------------------------------------------*/
+
+/* sin(2*pi*i/SIN_TABLE_SIZE), i = 0..SIN_TABLE_SIZE */
+const float32_t SinTable[SIN_TABLE_SIZE + 1] = {
+%s
+};
+
+/* Altitude [m] at pressure PRESSURE_TABLE_MIN + i*2^PRESSURE_TABLE_STEP_SHIFT [Pa] */
+const float32_t PressureAltitudeTable[PRESSURE_TABLE_SIZE] = {
+%s
+};
+
+/*****END OF FILE****/
+""" % (max_sin_error, max_altitude_error, check,
+       format_table(sines, 6, "%.9ef"), format_table(altitudes, 6, "%.6ff")))
+
+
+if __name__ == "__main__":
+    main()
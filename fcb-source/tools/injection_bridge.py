@@ -0,0 +1,443 @@
+#!/usr/bin/env python3
+"""
+Host side of the sensor injection mode (fcb/src/sensor_injection.c). Runs a
+rigid body quadrotor plant model in real time, sends its simulated sensor
+readings to the FCB and integrates the plant with the motor commands the FCB
+streams back, so that the real firmware flies the simulated quadrotor.
+
+    python3 tools/injection_bridge.py --port /dev/ttyACM0 --rate 400 \\
+        --duration 30 > flight.csv
+
+The FCB must be disarmed when the bridge starts. The motor outputs are kept
+at zero pulse width during injection, arming and setpoints still come from
+the RC receiver. The port may be any serial device, e.g. a pty.
+
+Frames use the common message header: msg id (u8), CRC (u32, STM32 CRC of
+the payload), payload size (u16), payload, "\\r\\n". Sensor frames are sent
+with SENSOR_INJECTION_MSG_ENUM, an empty payload stops the injection.
+
+Axes are the FCB body axes, x forward, y right, z down, and the plant
+position is north, east, down. The accelerometer reading is the specific
+force in body axes, i.e. -g along z when level at rest. The magnetometer
+reading is the earth field (--mag-field, north/east/down) in body axes.
+
+USB is the preferred channel. On the UART at 115200 baud a sensor and motor
+frame pair takes about 7 ms, so frame rates above 100 Hz will be dropped or
+delayed. CSV with the plant state and the motor values is written to stdout,
+frame and latency statistics to stderr. Requires pyserial.
+
+    python3 tools/injection_bridge.py --selftest
+
+runs the bridge against a stand-in FCB on a pty, which answers
+start-injection and echoes an INJECTION_MOTORS frame for every sensor frame.
+It checks the frame round trip and that the bridge sends the empty stop
+frame both when --duration expires and on Ctrl-C. The host tests run it.
+"""
+
+import argparse
+import math
+import os
+import pty
+import select
+import signal
+import struct
+import subprocess
+import sys
+import threading
+import time
+import tty
+
+from watch import PROTO_HEADER_LEN, command, stm32_crc
+
+SENSOR_INJECTION_MSG_ENUM = 11  # communication.h ProtoMessageTypeEnum
+INJECTION_MOTORS_MSG_ENUM = 12
+
+SENSOR_FRAME_LAYOUT = "<I3f3f3fiB"  # timestamp, gyro, acc, mag, pressure, sensor mask
+MOTOR_FRAME_LAYOUT = "<III4HB"  # frame timestamp, latency, loop counter, motors, flight mode
+SENSOR_MASKS = {"g": 0x01, "a": 0x02, "m": 0x04, "b": 0x08}
+
+# Plant parameters, see flight_control.h and motor_control.h
+MASS = 2.1983808  # [kg]
+INERTIA = (0.04065473, 0.040693168, 0.074656405)  # [kg*m^2]
+LENGTH_ARM = 0.30  # [m]
+AT = 0.0001768  # Thrust per motor value [N]
+AQ = 0.000001748  # Drag torque per motor value [Nm]
+G_ACC = 9.815  # [m/s^2]
+SEA_LEVEL_PRESSURE = 101325.0  # [Pa]
+
+
+def frame(msg_id, payload):
+    """Frames a payload with the common message header and trailer."""
+    return struct.pack("<BIH", msg_id, stm32_crc(payload), len(payload)) + payload + b"\r\n"
+
+
+def cross(a, b):
+    return (a[1] * b[2] - a[2] * b[1], a[2] * b[0] - a[0] * b[2], a[0] * b[1] - a[1] * b[0])
+
+
+def mat_vec(m, v):
+    return tuple(sum(m[i][j] * v[j] for j in range(3)) for i in range(3))
+
+
+def mat_t_vec(m, v):
+    return tuple(sum(m[j][i] * v[j] for j in range(3)) for i in range(3))
+
+
+def mat_mul(a, b):
+    return tuple(tuple(sum(a[i][k] * b[k][j] for k in range(3)) for j in range(3)) for i in range(3))
+
+
+def orthonormalize(m):
+    """Gram-Schmidt on the columns to remove integration drift."""
+    x = (m[0][0], m[1][0], m[2][0])
+    y = (m[0][1], m[1][1], m[2][1])
+    nx = math.sqrt(sum(c * c for c in x))
+    x = tuple(c / nx for c in x)
+    d = sum(x[i] * y[i] for i in range(3))
+    y = tuple(y[i] - d * x[i] for i in range(3))
+    ny = math.sqrt(sum(c * c for c in y))
+    y = tuple(c / ny for c in y)
+    z = cross(x, y)
+    return tuple((x[i], y[i], z[i]) for i in range(3))
+
+
+class Quadrotor:
+    """Rigid body quadrotor, motor numbering and rotation directions as in
+    CalculateMotorAllocationPhysical(). Starts level at rest on the ground."""
+
+    def __init__(self):
+        self.position = (0.0, 0.0, 0.0)  # [m] north, east, down
+        self.velocity = (0.0, 0.0, 0.0)  # [m/s]
+        self.rotation = ((1.0, 0.0, 0.0), (0.0, 1.0, 0.0), (0.0, 0.0, 1.0))  # body to NED
+        self.rates = (0.0, 0.0, 0.0)  # [rad/s] body
+        self.specific_force = (0.0, 0.0, -G_ACC)  # [m/s^2] body
+
+    def forces(self, motors):
+        """Inverts the physical control allocation: motor values to thrust [N] along body z and
+        roll, pitch, yaw moments [Nm]."""
+        m1, m2, m3, m4 = motors
+        arm = AT * LENGTH_ARM / math.sqrt(2)
+        thrust = -AT * (m1 + m2 + m3 + m4)
+        roll = arm * (-m1 + m2 + m3 - m4)
+        pitch = arm * (m1 + m2 - m3 - m4)
+        yaw = AQ * (m1 - m2 + m3 - m4)
+        return thrust, (roll, pitch, yaw)
+
+    def step(self, motors, dt):
+        thrust, torque = self.forces(motors)
+
+        # Translation, the ground at down = 0 only pushes up
+        gravity = (0.0, 0.0, G_ACC)
+        thrust_ned = mat_vec(self.rotation, (0.0, 0.0, thrust / MASS))
+        accel = tuple(thrust_ned[i] + gravity[i] for i in range(3))
+        on_ground = self.position[2] >= 0.0 and accel[2] >= 0.0
+        if on_ground:
+            accel = (0.0, 0.0, 0.0)
+            self.velocity = (0.0, 0.0, 0.0)
+        self.velocity = tuple(self.velocity[i] + accel[i] * dt for i in range(3))
+        self.position = tuple(self.position[i] + self.velocity[i] * dt for i in range(3))
+        if self.position[2] > 0.0:
+            self.position = (self.position[0], self.position[1], 0.0)
+        self.specific_force = mat_t_vec(self.rotation, tuple(accel[i] - gravity[i] for i in range(3)))
+
+        # Rotation, Euler's equations in body axes. Resting on the ground only allows yaw.
+        inertia_rates = tuple(INERTIA[i] * self.rates[i] for i in range(3))
+        gyroscopic = cross(self.rates, inertia_rates)
+        rate_dot = tuple((torque[i] - gyroscopic[i]) / INERTIA[i] for i in range(3))
+        self.rates = tuple(self.rates[i] + rate_dot[i] * dt for i in range(3))
+        if on_ground:
+            self.rates = (0.0, 0.0, self.rates[2])
+
+        # Attitude update with the rotation of the body rates over dt (Rodrigues)
+        angle = math.sqrt(sum(r * r for r in self.rates)) * dt
+        if angle > 0.0:
+            axis = tuple(r * dt / angle for r in self.rates)
+            c, s = math.cos(angle), math.sin(angle)
+            x, y, z = axis
+            delta = ((c + x * x * (1 - c), x * y * (1 - c) - z * s, x * z * (1 - c) + y * s),
+                     (y * x * (1 - c) + z * s, c + y * y * (1 - c), y * z * (1 - c) - x * s),
+                     (z * x * (1 - c) - y * s, z * y * (1 - c) + x * s, c + z * z * (1 - c)))
+            self.rotation = orthonormalize(mat_mul(self.rotation, delta))
+
+    def euler(self):
+        """Roll, pitch, yaw [rad] (ZYX) of the body."""
+        r = self.rotation
+        return (math.atan2(r[2][1], r[2][2]), -math.asin(max(-1.0, min(1.0, r[2][0]))),
+                math.atan2(r[1][0], r[0][0]))
+
+    def pressure(self):
+        altitude = -self.position[2]
+        return SEA_LEVEL_PRESSURE * (1.0 - altitude / 44330.0) ** 5.255
+
+
+def motor_frames(port, buffer):
+    """Returns the motor frames decoded from the bytes currently available on the port.
+    Frames with wrong size or CRC are skipped, which also skips CLI text."""
+    payload_size = struct.calcsize(MOTOR_FRAME_LAYOUT)
+    frame_size = PROTO_HEADER_LEN + payload_size + 2
+    buffer += port.read(port.in_waiting or 1)
+    frames = []
+
+    while len(buffer) >= frame_size:
+        if buffer[0] != INJECTION_MOTORS_MSG_ENUM:
+            del buffer[0]
+            continue
+        crc, size = struct.unpack_from("<IH", buffer, 1)
+        payload = bytes(buffer[PROTO_HEADER_LEN:PROTO_HEADER_LEN + payload_size])
+        if size != payload_size or buffer[frame_size - 2:frame_size] != b"\r\n" or stm32_crc(payload) != crc:
+            del buffer[0]
+            continue
+        del buffer[:frame_size]
+        frames.append(struct.unpack(MOTOR_FRAME_LAYOUT, payload))
+    return frames
+
+
+class StandInBoard(object):
+    """FCB side of the injection link for the selftest. Answers start-injection, checks the sensor frames and echoes a
+    motor frame with MOTORS for each of them until the empty stop frame."""
+
+    MOTORS = (1000, 1001, 1002, 1003)
+    FLIGHT_MODE = 1
+    LATENCY_US = 250
+
+    def __init__(self):
+        self.injecting = False
+        self.sensor_frames = []     # Decoded payloads
+        self.bad_frames = 0
+        self.stopped = False
+        self.frames_after_stop = 0
+
+    def serve(self, fd, stop):
+        buffer = bytearray()
+        while not stop.is_set():
+            if not select.select([fd], [], [], 0.05)[0]:
+                continue
+            try:
+                buffer += os.read(fd, 4096)
+            except OSError:     # Bridge closed the port
+                break
+            while self.handle(fd, buffer):
+                pass
+
+    def handle(self, fd, buffer):
+        """Handles the first command or frame in buffer, returns False if it is incomplete."""
+        if not self.injecting:
+            if b"\r" not in buffer:
+                return False
+            end = buffer.index(b"\r")
+            line = buffer[:end].decode("ascii", "replace").strip()
+            del buffer[:end + 1]
+            if line.startswith("start-injection") and not self.stopped:
+                self.injecting = True
+                os.write(fd, b"Starting sensor injection...\r\n")
+            elif line:
+                os.write(fd, b"Command not recognised\r\n")
+            return True
+
+        if len(buffer) < PROTO_HEADER_LEN:
+            return False
+        msg_id, crc, size = struct.unpack_from("<BIH", buffer)
+        frame_size = PROTO_HEADER_LEN + size + 2
+        if len(buffer) < frame_size:
+            return False
+        payload = bytes(buffer[PROTO_HEADER_LEN:PROTO_HEADER_LEN + size])
+        valid = msg_id == SENSOR_INJECTION_MSG_ENUM and stm32_crc(payload) == crc and \
+            buffer[frame_size - 2:frame_size] == b"\r\n" and size in (0, struct.calcsize(SENSOR_FRAME_LAYOUT))
+        if not valid:
+            self.bad_frames += 1
+            del buffer[0]
+            return True
+        del buffer[:frame_size]
+
+        if self.stopped:
+            self.frames_after_stop += 1
+        elif not payload:
+            self.stopped = True
+            self.injecting = False
+        else:
+            sensors = struct.unpack(SENSOR_FRAME_LAYOUT, payload)
+            self.sensor_frames.append(sensors)
+            os.write(fd, frame(INJECTION_MOTORS_MSG_ENUM, struct.pack(
+                MOTOR_FRAME_LAYOUT, sensors[0], self.LATENCY_US, len(self.sensor_frames), *self.MOTORS,
+                self.FLIGHT_MODE)))
+        return True
+
+
+def check(condition, description, failures):
+    print("%-4s %s" % ("ok" if condition else "FAIL", description))
+    if not condition:
+        failures.append(description)
+
+
+def run_bridge(failures, description, bridge_args, interrupt):
+    """Runs the bridge against a stand-in board on a pty. With interrupt, the bridge runs until it has sent a few
+    frames and is then stopped with Ctrl-C (SIGINT). Returns the board, CSV rows, bridge stderr and run time."""
+    master, slave = pty.openpty()
+    tty.setraw(master)
+    board = StandInBoard()
+    stop = threading.Event()
+    thread = threading.Thread(target=board.serve, args=(master, stop))
+    thread.daemon = True
+    thread.start()
+
+    start = time.monotonic()
+    bridge = subprocess.Popen([sys.executable, os.path.abspath(__file__), "--port", os.ttyname(slave),
+                               "--log-div", "1"] + bridge_args,
+                              stdout=subprocess.PIPE, stderr=subprocess.PIPE, universal_newlines=True)
+    if interrupt:
+        while len(board.sensor_frames) < 10 and bridge.poll() is None and time.monotonic() - start < 10.0:
+            time.sleep(0.01)
+        bridge.send_signal(signal.SIGINT)
+    try:
+        out, err = bridge.communicate(timeout=20.0)
+    except subprocess.TimeoutExpired:
+        bridge.kill()
+        out, err = bridge.communicate()
+    elapsed = time.monotonic() - start
+
+    # The stop frame may still be in the pty when the bridge exits
+    deadline = time.monotonic() + 1.0
+    while not board.stopped and time.monotonic() < deadline:
+        time.sleep(0.01)
+    stop.set()
+    thread.join()
+    os.close(master)
+    os.close(slave)
+
+    check(bridge.returncode == 0, "%s: bridge exits cleanly (%s)" % (description, err.strip().replace("\n", ", ")),
+          failures)
+    return board, [line.split(",") for line in out.splitlines()[1:]], err, elapsed
+
+
+def selftest():
+    try:
+        import serial  # noqa: F401
+    except ImportError:
+        print("pyserial not installed, selftest skipped")
+        return 77
+    failures = []
+    rate, duration = 100.0, 0.5
+
+    # Round trip and the --duration stop
+    board, rows, err, elapsed = run_bridge(failures, "duration", ["--rate", "%g" % rate, "--duration", "%g" % duration],
+                                           False)
+    sent = len(board.sensor_frames)
+    check(board.bad_frames == 0, "no bad sensor frames", failures)
+    check(abs(sent - rate * duration) <= 1, "%d sensor frames in %g s at %g Hz" % (sent, duration, rate), failures)
+    check(all(sensors[-1] == 0x07 for sensors in board.sensor_frames), "sensor mask of gyroscope, acc and mag",
+          failures)
+    check(all(abs(sensors[6] + G_ACC) < 1e-3 for sensors in board.sensor_frames), "acc reads -g at rest", failures)
+    steps = [b[0] - a[0] for a, b in zip(board.sensor_frames, board.sensor_frames[1:])]
+    check(steps and all(step == int(1e6 / rate) for step in steps), "timestamps advance one frame period", failures)
+    check("%d sensor frames sent, %d motor frames received" % (sent, sent) in err or
+          "%d sensor frames sent, %d motor frames received" % (sent, sent - 1) in err,
+          "motor frame echoed for each sensor frame", failures)
+    check("median %d" % StandInBoard.LATENCY_US in err, "latency decoded from the motor frames", failures)
+    motors = ["%d" % m for m in StandInBoard.MOTORS] + ["%d" % StandInBoard.FLIGHT_MODE]
+    # The first echoes may arrive after the next plant step
+    check(len(rows) >= sent - 1 > 2 and all(row[10:] == motors for row in rows[2:]),
+          "motor values and flight mode applied to the plant", failures)
+    # The start-injection response is read with a 1 s timeout
+    check(elapsed < duration + 3.0, "bridge stops after --duration (%.2f s)" % elapsed, failures)
+    check(board.stopped and board.frames_after_stop == 0, "empty stop frame is the last frame", failures)
+
+    # Ctrl-C stop
+    board, rows, err, elapsed = run_bridge(failures, "Ctrl-C", ["--rate", "%g" % rate], True)
+    check(len(board.sensor_frames) >= 10, "%d sensor frames before Ctrl-C" % len(board.sensor_frames), failures)
+    check(board.stopped and board.frames_after_stop == 0, "empty stop frame sent on Ctrl-C", failures)
+
+    if failures:
+        print("%d checks failed" % len(failures))
+        return 1
+    return 0
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("--port", help="serial port of the injection channel, e.g. /dev/ttyACM0")
+    parser.add_argument("--cli-port", help="port used for the start-injection command if not --port")
+    parser.add_argument("--channel", choices=("u", "s"), default="u", help="injection channel, u=USB, s=UART")
+    parser.add_argument("--baud", type=int, default=115200, help="baud rate, used for the UART")
+    parser.add_argument("--rate", type=float, default=400.0, help="sensor frame rate [Hz]")
+    parser.add_argument("--sensors", default="gam", help="injected sensors, any of g, a, m, b")
+    parser.add_argument("--mag-field", type=float, nargs=3, default=(0.17, 0.01, 0.47),
+                        help="earth magnetic field north, east, down")
+    parser.add_argument("--gyro-noise", type=float, default=0.0, help="gyroscope noise std dev [rad/s]")
+    parser.add_argument("--acc-noise", type=float, default=0.0, help="accelerometer noise std dev [m/s^2]")
+    parser.add_argument("--duration", type=float, default=0.0, help="run time [s], 0 = until Ctrl-C")
+    parser.add_argument("--log-div", type=int, default=10, help="write every n:th plant state to stdout")
+    parser.add_argument("--selftest", action="store_true", help="run against a stand-in FCB on a pty")
+    args = parser.parse_args()
+
+    if args.selftest:
+        sys.exit(selftest())
+    if not args.port:
+        parser.error("--port is required")
+
+    if any(c not in SENSOR_MASKS for c in args.sensors):
+        parser.error("invalid sensors '%s'" % args.sensors)
+    sensor_mask = sum(SENSOR_MASKS[c] for c in set(args.sensors))
+
+    import random
+    import serial
+    port = serial.Serial(args.port, args.baud)
+    cli_port = serial.Serial(args.cli_port, args.baud) if args.cli_port else port
+
+    response = command(cli_port, "start-injection %s" % args.channel)
+    if "Starting" not in response:
+        sys.exit("injection not started: %s" % response.strip())
+    port.reset_input_buffer()
+
+    plant = Quadrotor()
+    motors = (0, 0, 0, 0)
+    flight_mode = 0
+    dt = 1.0 / args.rate
+    buffer = bytearray()
+    sent = received = 0
+    latencies = []
+    start = time.monotonic()
+    next_frame = start
+
+    print("t,north,east,down,roll,pitch,yaw,p,q,r,m1,m2,m3,m4,mode")
+    try:
+        while not args.duration or next_frame - start < args.duration:
+            now = time.monotonic()
+            if now < next_frame:
+                time.sleep(next_frame - now)
+
+            timestamp_us = int((next_frame - start) * 1e6) & 0xFFFFFFFF
+            gyro = tuple(r + random.gauss(0.0, args.gyro_noise) for r in plant.rates)
+            acc = tuple(f + random.gauss(0.0, args.acc_noise) for f in plant.specific_force)
+            mag = mat_t_vec(plant.rotation, args.mag_field)
+            payload = struct.pack(SENSOR_FRAME_LAYOUT, timestamp_us, *(gyro + acc + mag),
+                                  int(plant.pressure()), sensor_mask)
+            port.write(frame(SENSOR_INJECTION_MSG_ENUM, payload))
+            sent += 1
+
+            for frame_timestamp, latency_us, loop_counter, m1, m2, m3, m4, mode in motor_frames(port, buffer):
+                motors = (m1, m2, m3, m4)
+                flight_mode = mode
+                latencies.append(latency_us)
+                received += 1
+
+            plant.step(motors, dt)
+            next_frame += dt
+
+            if sent % args.log_div == 0:
+                print("%.4f,%s,%s,%s,%s,%d" % (
+                    next_frame - start, ",".join("%.4f" % v for v in plant.position),
+                    ",".join("%.5f" % v for v in plant.euler()), ",".join("%.5f" % v for v in plant.rates),
+                    ",".join("%d" % m for m in motors), flight_mode))
+    except KeyboardInterrupt:
+        pass
+    finally:
+        port.write(frame(SENSOR_INJECTION_MSG_ENUM, b""))
+        sys.stderr.write("%d sensor frames sent, %d motor frames received\n" % (sent, received))
+        if latencies:
+            latencies.sort()
+            sys.stderr.write("latency frame to motor command [us] median %d, 99%% %d, max %d\n" % (
+                latencies[len(latencies) // 2], latencies[len(latencies) * 99 // 100], latencies[-1]))
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,627 @@
+#!/usr/bin/env python3
+"""
+Host side of the settings snapshot (fcb/src/settings_snapshot.c). Exports
+all settings stored in flash of a board, or imports them, with one CLI
+command each. Snapshots are kept as binary files or edited as JSON:
+
+    python3 tools/settings_snapshot.py export --port /dev/ttyACM0 -o vehicle.bin
+    python3 tools/settings_snapshot.py show vehicle.bin > vehicle.json
+    python3 tools/settings_snapshot.py pack vehicle.json -o vehicle.bin
+    python3 tools/settings_snapshot.py import --port /dev/ttyACM0 vehicle.bin
+    python3 tools/settings_snapshot.py import --port /dev/ttyACM0 vehicle.bin \\
+        --only acc_calibration,mag_calibration
+
+Settings left out of a snapshot (--only, or keys missing in the JSON file)
+keep the values stored on the board. The board checks the whole snapshot
+before it writes anything and commits the imported settings with a single
+flash page erase and program, so a rejected import leaves the board as it
+was. Imports are only accepted while the flight control is idle.
+
+    python3 tools/settings_snapshot.py selftest --boards 8
+
+runs round trips against a simulated board that models the flash page
+layout of utilities/inc/flash.h and the import rules of the firmware, and
+provisions simulated boards over ptys to time the fleet workflow. With
+--firmware, the round trips also run against settings_snapshot.c and
+flash.c built for the host with a RAM flash (tests/settings_snapshot_host.c),
+once at the current snapshot version and once at a later version for the
+migration. The host tests build both libraries and run the selftest:
+
+    cmake -S tests -B build-tests && cmake --build build-tests
+    python3 tools/settings_snapshot.py selftest --firmware \\
+        build-tests/libsettings_snapshot_host_v1.so build-tests/libsettings_snapshot_host_v2.so
+"""
+
+import argparse
+import ctypes
+import json
+import math
+import os
+import pty
+import select
+import struct
+import sys
+import threading
+import time
+import tty
+
+from telemetry_server import open_link
+from watch import stm32_crc
+
+SNAPSHOT_MAGIC = 0x53424346     # settings_snapshot.h
+SNAPSHOT_VERSION = 1
+SNAPSHOT_HEADER = struct.Struct("<IBBH")    # magic, version, field count, payload size
+SNAPSHOT_MAX_SIZE = 176
+
+RECEIVER_CHANNELS = ("throttle", "aileron", "elevator", "rudder", "gear", "aux1")
+REFERENCE_LIMITS = ("z_velocity", "roll_angle", "pitch_angle", "yaw_angle", "yaw_angle_rate")
+
+
+class Field(object):
+    """A snapshot field, its id, name, layout and conversion from and to JSON values."""
+
+    def __init__(self, field_id, name, layout, to_json, from_json):
+        self.id = field_id
+        self.name = name
+        self.layout = struct.Struct(layout)
+        self.to_json = to_json
+        self.from_json = from_json
+
+    def unpack(self, data):
+        return self.to_json(self.layout.unpack(data))
+
+    def pack(self, value):
+        return self.layout.pack(*self.from_json(value))
+
+
+def receiver_to_json(values):
+    return {name: dict(zip(("max", "mid", "min"), values[3 * i:3 * i + 3])) for i, name in enumerate(RECEIVER_CHANNELS)}
+
+
+def receiver_from_json(value):
+    return [value[name][key] for name in RECEIVER_CHANNELS for key in ("max", "mid", "min")]
+
+
+def calibration_to_json(values):
+    return {"offset": list(values[0:3]), "scaling": list(values[3:6])}
+
+
+def calibration_from_json(value):
+    return list(value["offset"]) + list(value["scaling"])
+
+
+FIELDS = [
+    Field(1, "receiver_calibration", "<18H", receiver_to_json, receiver_from_json),
+    Field(2, "reference_max_limits", "<5f", lambda values: dict(zip(REFERENCE_LIMITS, values)),
+          lambda value: [value[name] for name in REFERENCE_LIMITS]),
+    Field(3, "mag_calibration", "<6f", calibration_to_json, calibration_from_json),
+    Field(4, "acc_calibration", "<6f", calibration_to_json, calibration_from_json),
+]
+FIELDS_BY_NAME = {field.name: field for field in FIELDS}
+FIELDS_BY_ID = {field.id: field for field in FIELDS}
+
+
+def encode(fields, version=SNAPSHOT_VERSION):
+    """Builds a snapshot from a list of (field id, field data) tuples."""
+    payload = b"".join(struct.pack("<BB", field_id, len(data)) + data for field_id, data in fields)
+    body = SNAPSHOT_HEADER.pack(SNAPSHOT_MAGIC, version, len(fields), len(payload)) + payload
+    return body + struct.pack("<I", stm32_crc(body))
+
+
+def decode(snapshot):
+    """Returns (version, [(field id, field data)]) of a snapshot, raises ValueError if it is malformed."""
+    if len(snapshot) < SNAPSHOT_HEADER.size + 4 or len(snapshot) > SNAPSHOT_MAX_SIZE:
+        raise ValueError("bad header or size")
+    magic, version, count, payload_size = SNAPSHOT_HEADER.unpack_from(snapshot)
+    if magic != SNAPSHOT_MAGIC or SNAPSHOT_HEADER.size + payload_size + 4 != len(snapshot):
+        raise ValueError("bad header or size")
+    if stm32_crc(snapshot[:-4]) != struct.unpack_from("<I", snapshot, len(snapshot) - 4)[0]:
+        raise ValueError("bad CRC")
+
+    fields = []
+    offset = SNAPSHOT_HEADER.size
+    end = SNAPSHOT_HEADER.size + payload_size
+    for _ in range(count):
+        if offset + 2 > end:
+            raise ValueError("bad field")
+        field_id, size = struct.unpack_from("<BB", snapshot, offset)
+        offset += 2
+        if offset + size > end:
+            raise ValueError("bad field")
+        fields.append((field_id, bytes(snapshot[offset:offset + size])))
+        offset += size
+    if offset != end:
+        raise ValueError("bad field")
+    return version, fields
+
+
+def snapshot_to_json(snapshot):
+    version, fields = decode(snapshot)
+    document = {"version": version}
+    for field_id, data in fields:
+        field = FIELDS_BY_ID.get(field_id)
+        if field is None or len(data) != field.layout.size:
+            document["field_%d" % field_id] = data.hex()
+        else:
+            document[field.name] = field.unpack(data)
+    return document
+
+
+def json_to_snapshot(document):
+    return encode([(field.id, field.pack(document[field.name])) for field in FIELDS if field.name in document])
+
+
+def select_fields(snapshot, names):
+    """Returns a snapshot with only the named fields, for importing some of the settings."""
+    unknown = set(names) - set(FIELDS_BY_NAME)
+    if unknown:
+        raise ValueError("unknown fields %s" % ", ".join(sorted(unknown)))
+    version, fields = decode(snapshot)
+    wanted = set(FIELDS_BY_NAME[name].id for name in names)
+    return encode([(field_id, data) for field_id, data in fields if field_id in wanted], version)
+
+
+class CliLink(object):
+    """Line based CLI access to a board over a serial port or pty."""
+
+    def __init__(self, port, baud=115200):
+        self.fd = open_link(port, baud)
+        self.buffer = b""
+
+    def close(self):
+        os.close(self.fd)
+
+    def command(self, line, match, timeout=2.0):
+        """Sends a command and returns the first response line for which match(line) is true."""
+        data = (line + "\r").encode("ascii")
+        while data:
+            select.select([], [self.fd], [], timeout)
+            data = data[os.write(self.fd, data):]
+
+        end = time.monotonic() + timeout
+        while True:
+            while b"\n" in self.buffer:
+                response, _, self.buffer = self.buffer.partition(b"\n")
+                response = response.decode("ascii", "replace").strip()
+                if match(response):
+                    return response
+            remaining = end - time.monotonic()
+            if remaining <= 0:
+                raise IOError("no response to '%s'" % line.split(" ")[0])
+            if select.select([self.fd], [], [], remaining)[0]:
+                try:
+                    self.buffer += os.read(self.fd, 4096)
+                except BlockingIOError:
+                    pass
+
+
+def is_hex_line(line):
+    return len(line) >= 2 * (SNAPSHOT_HEADER.size + 4) and all(c in "0123456789ABCDEFabcdef" for c in line)
+
+
+def export_snapshot(link):
+    response = link.command("export-settings", lambda line: is_hex_line(line) or line.startswith("Settings export"))
+    if not is_hex_line(response):
+        raise IOError(response)
+    snapshot = bytes.fromhex(response)
+    decode(snapshot)
+    return snapshot
+
+
+def import_snapshot(link, snapshot):
+    decode(snapshot)
+    response = link.command("import-settings " + snapshot.hex().upper(),
+                            lambda line: line.startswith("Settings import") or line.startswith("Invalid parameter"))
+    if not response.startswith("Settings imported"):
+        raise IOError(response)
+    return response
+
+
+def read_snapshot_file(path):
+    with open(path, "rb") as f:
+        data = f.read()
+    if path.endswith(".json"):
+        return json_to_snapshot(json.loads(data.decode("utf-8")))
+    return data
+
+
+class SimulatedBoard(object):
+    """Models the settings page of utilities/src/flash.c and the snapshot rules of settings_snapshot.c.
+
+    version defaults to the current firmware. A later version models later firmware, to check the migration of
+    snapshots exported by earlier firmware."""
+
+    PAGE_SIZE = 2048
+    ERASE_TIME = 0.040          # STM32F303 page erase, max [s]
+    PROGRAM_TIME = 0.000050     # per word written after the erase [s]
+    # (field id, CRC offset) in flash.h, the settings follow their CRC word
+    OFFSETS = {1: 0, 2: 44, 3: 72, 4: 104}
+    LEGACY_ACC_OFFSET = 96
+
+    def __init__(self, version=SNAPSHOT_VERSION, realtime=False):
+        self.version = version
+        self.sizes = {field.id: field.layout.size for field in FIELDS}
+        self.realtime = realtime
+        self.page = bytearray(b"\xff" * self.PAGE_SIZE)
+        self.erases = 0
+        self.idle = True
+
+    # Flash page, as ReadSettingsFromFlash/InsertSettingsInPage/WriteFlashPage
+    def read_setting(self, offset, size):
+        data = bytes(self.page[offset + 4:offset + 4 + size])
+        crc = struct.unpack_from("<I", self.page, offset)[0]
+        return data if stm32_crc(data) == crc else None
+
+    def insert_setting(self, page, offset, data):
+        page[offset:offset + 4] = struct.pack("<I", stm32_crc(data))
+        page[offset + 4:offset + 4 + len(data)] = data
+
+    def write_page(self, page):
+        words = sum(1 for i in range(0, self.PAGE_SIZE, 4) if page[i:i + 4] != b"\xff\xff\xff\xff")
+        if self.realtime:
+            time.sleep(self.ERASE_TIME + words * self.PROGRAM_TIME)
+        self.page = bytearray(page)
+        self.erases += 1
+
+    def write_legacy_acc(self, data):
+        """Per setting write of the accelerometer calibration by firmware before the flash layout fix."""
+        page = bytearray(self.page)
+        self.insert_setting(page, self.LEGACY_ACC_OFFSET, data)
+        self.write_page(page)
+
+    def stored(self):
+        settings = {}
+        for field_id, size in self.sizes.items():
+            data = self.read_setting(self.OFFSETS[field_id], size)
+            if data is None and field_id == 4:
+                data = self.read_setting(self.LEGACY_ACC_OFFSET, self.sizes[field_id])
+            if data is not None:
+                settings[field_id] = data
+        return settings
+
+    # Snapshot, as ExportSettingsSnapshot/ImportSettingsSnapshot
+    def export(self):
+        return encode(sorted(self.stored().items()), self.version)
+
+    def import_(self, snapshot):
+        try:
+            version, fields = decode(snapshot)
+        except ValueError as error:
+            return str(error)
+        if version == 0 or version > self.version:
+            return "unsupported version"
+        if not self.idle:
+            return "flight control not idle or sensors calibrating"
+
+        settings = self.stored()
+        imported = {}
+        migrated = skipped = 0
+        for field_id, data in fields:
+            if field_id not in self.sizes:
+                if version == self.version:
+                    return "bad field"
+                skipped += 1
+                continue
+            size = self.sizes[field_id]
+            if field_id in imported or len(data) > size:
+                return "bad field"
+            if len(data) < size:
+                if version == self.version or field_id not in settings:
+                    return "bad field"
+                data = data + settings[field_id][len(data):]
+                migrated += 1
+            imported[field_id] = data
+        if not all(self.is_valid(field_id, data) for field_id, data in imported.items()):
+            return "setting value out of range"
+
+        settings.update(imported)
+        page = bytearray(self.page)
+        for field_id, data in settings.items():
+            self.insert_setting(page, self.OFFSETS[field_id], data)
+        self.write_page(page)
+        mask = sum(1 << (field_id - 1) for field_id in imported)
+        return "Settings imported from version %u snapshot, settings 0x%02X, %u migrated and %u skipped fields" % (
+            version, mask, migrated, skipped)
+
+    @staticmethod
+    def is_valid(field_id, data):
+        if field_id == 1:
+            values = struct.unpack_from("<18H", data)
+            return all(17496 <= values[i] <= 38016 and 24300 <= values[i + 1] <= 29700 and
+                       17496 <= values[i + 2] <= 21384 for i in range(0, 18, 3))
+        values = struct.unpack_from("<%df" % (len(data) // 4), data)
+        if not all(math.isfinite(value) for value in values):
+            return False
+        if field_id == 2:
+            return all(value > 0.0 for value in values)
+        return all(value >= 0.1 for value in values[3:6])
+
+    def serve(self, fd, stop):
+        """Answers export-settings and import-settings on the board side of a pty."""
+        line = b""
+        while not stop.is_set():
+            if not select.select([fd], [], [], 0.05)[0]:
+                continue
+            line += os.read(fd, 4096)
+            while b"\r" in line:
+                command, _, line = line.partition(b"\r")
+                words = command.decode("ascii").split()
+                if words == ["export-settings"]:
+                    response = self.export().hex().upper()
+                elif len(words) == 2 and words[0] == "import-settings":
+                    try:
+                        result = self.import_(bytes.fromhex(words[1]))
+                    except ValueError:
+                        result = "Invalid parameter"
+                    response = result if result.startswith(("Settings", "Invalid")) else \
+                        "Settings import rejected: " + result
+                else:
+                    response = "Command not recognised"
+                os.write(fd, (response + "\r\n").encode("ascii"))
+
+
+class SnapshotImport(ctypes.Structure):
+    """SettingsSnapshotImport_TypeDef"""
+    _fields_ = [("version", ctypes.c_uint8), ("migratedFields", ctypes.c_uint8), ("skippedFields", ctypes.c_uint8),
+                ("importedMask", ctypes.c_uint32)]
+
+
+def load_firmware(library):
+    lib = ctypes.CDLL(os.path.abspath(library))
+    lib.InitSettingsSnapshotHost.restype = ctypes.c_bool
+    lib.SetSettingsSnapshotHostIdle.argtypes = [ctypes.c_bool]
+    lib.GetSettingsSnapshotHostPage.restype = ctypes.c_void_p
+    lib.GetSettingsSnapshotHostErases.restype = ctypes.c_uint32
+    lib.GetSettingsSnapshotHostVersion.restype = ctypes.c_uint8
+    lib.ExportSettingsSnapshot.argtypes = [ctypes.c_char_p, ctypes.c_uint16, ctypes.POINTER(ctypes.c_uint16),
+                                           ctypes.POINTER(ctypes.c_uint32)]
+    lib.ImportSettingsSnapshot.argtypes = [ctypes.c_char_p, ctypes.c_uint16, ctypes.POINTER(SnapshotImport)]
+    lib.GetSettingsSnapshotStatusString.argtypes = [ctypes.c_int]
+    lib.GetSettingsSnapshotStatusString.restype = ctypes.c_char_p
+    return lib
+
+
+class FirmwareBoard(SimulatedBoard):
+    """settings_snapshot.c and flash.c built for the host, on RAM mapped at the settings flash address.
+
+    All boards of a library share its flash, which is erased when a board is created, so one board is used at a time.
+    The legacy accelerometer calibration is written with the page helpers of SimulatedBoard."""
+
+    def __init__(self, lib):
+        if not lib.InitSettingsSnapshotHost():
+            raise IOError("settings flash could not be mapped")
+        self.lib = lib
+        self.version = lib.GetSettingsSnapshotHostVersion()
+        self.realtime = False
+        self.flight_control_idle = True
+
+    @property
+    def page(self):
+        return ctypes.string_at(self.lib.GetSettingsSnapshotHostPage(), self.PAGE_SIZE)
+
+    @property
+    def erases(self):
+        return self.lib.GetSettingsSnapshotHostErases()
+
+    @property
+    def idle(self):
+        return self.flight_control_idle
+
+    @idle.setter
+    def idle(self, idle):
+        self.flight_control_idle = idle
+        self.lib.SetSettingsSnapshotHostIdle(idle)
+
+    def write_page(self, page):
+        ctypes.memmove(self.lib.GetSettingsSnapshotHostPage(), bytes(page), self.PAGE_SIZE)
+
+    def export(self):
+        snapshot = ctypes.create_string_buffer(SNAPSHOT_MAX_SIZE)
+        size, mask = ctypes.c_uint16(), ctypes.c_uint32()
+        status = self.lib.ExportSettingsSnapshot(snapshot, SNAPSHOT_MAX_SIZE, ctypes.byref(size), ctypes.byref(mask))
+        if status != 0:
+            raise IOError(self.lib.GetSettingsSnapshotStatusString(status).decode("ascii"))
+        return snapshot.raw[:size.value]
+
+    def import_(self, snapshot):
+        result = SnapshotImport()
+        status = self.lib.ImportSettingsSnapshot(snapshot, len(snapshot), ctypes.byref(result))
+        if status != 0:
+            return self.lib.GetSettingsSnapshotStatusString(status).decode("ascii")
+        return "Settings imported from version %u snapshot, settings 0x%02X, %u migrated and %u skipped fields" % (
+            result.version, result.importedMask, result.migratedFields, result.skippedFields)
+
+
+def sample_settings():
+    return {
+        "receiver_calibration": {name: {"max": 34000 + i, "mid": 27000 - i, "min": 19500 + i}
+                                 for i, name in enumerate(RECEIVER_CHANNELS)},
+        "reference_max_limits": {"z_velocity": 1.5, "roll_angle": 0.25, "pitch_angle": 0.25, "yaw_angle": math.pi,
+                                 "yaw_angle_rate": 0.5},
+        "mag_calibration": {"offset": [0.01, -0.02, 0.03], "scaling": [1.01, 0.99, 1.02]},
+        "acc_calibration": {"offset": [0.1, -0.2, 0.05], "scaling": [1.0, 1.001, 0.998]},
+    }
+
+
+def check(condition, description, failures):
+    print("%-4s %s" % ("ok" if condition else "FAIL", description))
+    if not condition:
+        failures.append(description)
+
+
+def expect_rejected(board, snapshot, reason, description, failures):
+    page, erases = bytes(board.page), board.erases
+    result = board.import_(snapshot)
+    check(result == reason and board.page == page and board.erases == erases,
+          "%s rejected (%s), flash untouched" % (description, result), failures)
+
+
+def selftest_round_trips(failures, new_board=SimulatedBoard):
+    """Round trips against boards from new_board(version)."""
+    settings = sample_settings()
+    full = json_to_snapshot(settings)
+    fields = decode(full)[1]
+
+    board = new_board(SNAPSHOT_VERSION)
+    check(decode(board.export()) == (SNAPSHOT_VERSION, []), "blank flash exports an empty snapshot", failures)
+    check(board.import_(full).startswith("Settings imported") and board.erases == 1,
+          "full import with one page erase (%d bytes)" % len(full), failures)
+    check(board.export() == full, "export after import is identical", failures)
+    check(snapshot_to_json(board.export()) == json.loads(json.dumps(snapshot_to_json(full))),
+          "JSON round trip", failures)
+
+    acc = dict(settings, acc_calibration={"offset": [0.0, 0.0, 0.0], "scaling": [1.1, 1.1, 1.1]})
+    partial = select_fields(json_to_snapshot(acc), ["acc_calibration"])
+    before = dict(decode(board.export())[1])
+    check(board.import_(partial).endswith("settings 0x08, 0 migrated and 0 skipped fields") and board.erases == 2,
+          "partial import with one page erase", failures)
+    after = dict(decode(board.export())[1])
+    check(all(after[i] == before[i] for i in (1, 2, 3)) and after[4] == dict(decode(partial)[1])[4],
+          "partial import keeps the other stored settings", failures)
+
+    body = full[:-4]
+    expect_rejected(board, b"X" + full[1:], "bad header or size", "bad magic", failures)
+    expect_rejected(board, full[:-1], "bad header or size", "truncated snapshot", failures)
+    expect_rejected(board, body + struct.pack("<I", stm32_crc(body) ^ 1), "bad CRC", "bad CRC", failures)
+    expect_rejected(board, encode(fields, 0), "unsupported version", "version 0", failures)
+    expect_rejected(board, encode(fields, SNAPSHOT_VERSION + 1), "unsupported version", "newer version", failures)
+    expect_rejected(board, encode(fields + fields[:1]), "bad field", "duplicate field", failures)
+    expect_rejected(board, encode(fields + [(9, b"\0\0\0\0")]), "bad field", "unknown field", failures)
+    expect_rejected(board, encode([(2, fields[1][1] + b"\0\0\0\0")]), "bad field", "oversized field", failures)
+    expect_rejected(board, encode([(2, fields[1][1][:16])]), "bad field", "short field of current version", failures)
+    bad = dict(settings, receiver_calibration=dict(settings["receiver_calibration"], gear={"max": 34000, "mid": 27000,
+                                                                                             "min": 30000}))
+    expect_rejected(board, json_to_snapshot(bad), "setting value out of range", "receiver min above range", failures)
+    bad = dict(settings, reference_max_limits=dict(settings["reference_max_limits"], roll_angle=float("nan")))
+    expect_rejected(board, json_to_snapshot(bad), "setting value out of range", "NaN reference limit", failures)
+    bad = dict(settings, mag_calibration={"offset": [0.0, 0.0, 0.0], "scaling": [1.0, 0.0, 1.0]})
+    expect_rejected(board, json_to_snapshot(bad), "setting value out of range", "zero magnetometer scaling",
+                    failures)
+    board.idle = False
+    expect_rejected(board, full, "flight control not idle or sensors calibrating", "import while armed", failures)
+
+    # Accelerometer calibration saved at the pre-fix offset is exported and moved by the next import
+    legacy = new_board(SNAPSHOT_VERSION)
+    legacy.write_legacy_acc(fields[3][1])
+    check(dict(decode(legacy.export())[1]) == {4: fields[3][1]}, "legacy accelerometer calibration exported",
+          failures)
+    legacy.import_(full)
+    check(legacy.read_setting(SimulatedBoard.OFFSETS[4], 24) == fields[3][1] and legacy.export() == full,
+          "import moves the legacy accelerometer calibration", failures)
+
+    # Later firmware: the earlier snapshot lacks the last reference limit, appended since, and has a field that was
+    # removed since
+    earlier_limits = fields[1][1][:-4]
+    earlier = encode([fields[0], (2, earlier_limits), (9, b"\0\0\0\0"), fields[3]])
+    later = new_board(SNAPSHOT_VERSION + 1)
+    later.import_(encode([(2, struct.pack("<5f", 2.0, 0.5, 0.5, 1.0, 7.0))], SNAPSHOT_VERSION + 1))
+    result = later.import_(earlier)
+    check(result.endswith("settings 0x0B, 1 migrated and 1 skipped fields") and dict(decode(later.export())[1])[2] ==
+          earlier_limits + struct.pack("<f", 7.0), "earlier version migrated, appended member keeps stored value",
+          failures)
+    expect_rejected(later, encode(fields, 0), "unsupported version", "version 0 in later firmware", failures)
+    expect_rejected(later, encode(fields, SNAPSHOT_VERSION + 2), "unsupported version", "newer version than later "
+                    "firmware", failures)
+    blank = new_board(SNAPSHOT_VERSION + 1)
+    expect_rejected(blank, earlier, "bad field", "migration without stored value", failures)
+
+
+def selftest_fleet(boards, failures):
+    snapshot = json_to_snapshot(sample_settings())
+    stop = threading.Event()
+    simulated = []
+    for _ in range(boards):
+        master, slave = pty.openpty()
+        tty.setraw(master)
+        board = SimulatedBoard(realtime=True)
+        thread = threading.Thread(target=board.serve, args=(master, stop))
+        thread.daemon = True
+        thread.start()
+        simulated.append((board, os.ttyname(slave), slave))
+
+    start = time.monotonic()
+    try:
+        for board, port, _ in simulated:
+            link = CliLink(port)
+            export_snapshot(link)       # Backup of the previous settings
+            import_snapshot(link, snapshot)
+            verified = export_snapshot(link) == snapshot
+            link.close()
+            check(verified and board.erases == 1, "%s provisioned and verified" % port, failures)
+    except IOError as error:
+        check(False, "provisioning over pty: %s" % error, failures)
+    finally:
+        stop.set()
+    elapsed = time.monotonic() - start
+    print("%d boards in %.2f s, %.0f ms per board including %.0f ms simulated flash erase and program" % (
+        boards, elapsed, 1e3 * elapsed / boards, 1e3 * SimulatedBoard.ERASE_TIME))
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    commands = parser.add_subparsers(dest="command")
+    export_parser = commands.add_parser("export", help="read the settings of a board")
+    export_parser.add_argument("--port", required=True, help="FCB serial port, e.g. /dev/ttyACM0")
+    export_parser.add_argument("--baud", type=int, default=115200, help="baud rate, used for the UART")
+    export_parser.add_argument("-o", "--output", required=True, help="snapshot file, .json for JSON")
+    import_parser = commands.add_parser("import", help="write settings to a board")
+    import_parser.add_argument("snapshot", help="snapshot file, .json for JSON")
+    import_parser.add_argument("--port", required=True, help="FCB serial port, e.g. /dev/ttyACM0")
+    import_parser.add_argument("--baud", type=int, default=115200, help="baud rate, used for the UART")
+    import_parser.add_argument("--only", help="comma separated fields to import: " + ", ".join(FIELDS_BY_NAME))
+    show_parser = commands.add_parser("show", help="print a snapshot file as JSON")
+    show_parser.add_argument("snapshot")
+    pack_parser = commands.add_parser("pack", help="convert a JSON snapshot to binary")
+    pack_parser.add_argument("json")
+    pack_parser.add_argument("-o", "--output", required=True)
+    selftest_parser = commands.add_parser("selftest", help="round trips against simulated boards")
+    selftest_parser.add_argument("--boards", type=int, default=4, help="simulated boards to provision over ptys")
+    selftest_parser.add_argument("--firmware", nargs=2, metavar=("LIBRARY", "LATER_LIBRARY"),
+                                 help="host builds of the firmware at the current and a later snapshot version")
+    args = parser.parse_args()
+
+    try:
+        if args.command == "export":
+            link = CliLink(args.port, args.baud)
+            snapshot = export_snapshot(link)
+            with open(args.output, "wb") as f:
+                if args.output.endswith(".json"):
+                    f.write(json.dumps(snapshot_to_json(snapshot), indent=2).encode("utf-8") + b"\n")
+                else:
+                    f.write(snapshot)
+            print("exported %s" % ", ".join(name for name in snapshot_to_json(snapshot) if name != "version"))
+        elif args.command == "import":
+            snapshot = read_snapshot_file(args.snapshot)
+            if args.only:
+                snapshot = select_fields(snapshot, args.only.split(","))
+            print(import_snapshot(CliLink(args.port, args.baud), snapshot))
+        elif args.command == "show":
+            print(json.dumps(snapshot_to_json(read_snapshot_file(args.snapshot)), indent=2))
+        elif args.command == "pack":
+            with open(args.output, "wb") as f:
+                f.write(read_snapshot_file(args.json))
+        elif args.command == "selftest":
+            failures = []
+            print("Simulated board")
+            selftest_round_trips(failures)
+            if args.firmware:
+                libs = {}
+                for library in args.firmware:
+                    lib = load_firmware(library)
+                    libs[lib.GetSettingsSnapshotHostVersion()] = lib
+                if sorted(libs) != [SNAPSHOT_VERSION, SNAPSHOT_VERSION + 1]:
+                    sys.exit("error: firmware libraries of snapshot versions %d and %d expected" % (
+                        SNAPSHOT_VERSION, SNAPSHOT_VERSION + 1))
+                print("Firmware built for the host")
+                selftest_round_trips(failures, lambda version: FirmwareBoard(libs[version]))
+            selftest_fleet(args.boards, failures)
+            if failures:
+                sys.exit("%d checks failed" % len(failures))
+        else:
+            parser.print_help()
+    except (IOError, ValueError, KeyError) as error:
+        sys.exit("error: %s" % error)
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,275 @@
+#!/usr/bin/env python3
+"""
+Many-client benchmark of telemetry_server.py against a pty-simulated FCB.
+
+A simulated FCB process writes state, motors and watch frames at the loop
+rate to the master side of a pty and answers CLI commands with text lines.
+The server owns the slave side. Client processes subscribe over the Unix
+socket, UDP and the shared memory ring. Some of them never read their socket,
+others send commands in parallel to exercise the arbitration.
+
+    python3 tools/telemetry_bench.py --clients 32 --slow 4 --shm-readers 4 \\
+        --rate 400 --duration 10
+
+Each frame payload carries the simulator send time and a per topic sequence
+number, so every client reports its end to end latency and the frames it
+lost. The vehicle side is checked separately: every frame written by the
+simulator must be decoded by the server, and the link must never refuse the
+simulator's writes for longer than one loop period. The simulator writes
+without blocking, so the stall is the time the pty buffer stays full because
+the server does not read, not the time the simulator is scheduled out.
+"""
+
+import argparse
+import multiprocessing
+import os
+import pty
+import select
+import socket
+import struct
+import sys
+import tempfile
+import time
+import tty
+
+import telemetry_server as ts
+from watch import stm32_crc
+
+BENCH_PAYLOAD = struct.Struct("<dI")    # send time (CLOCK_MONOTONIC) [s], sequence number
+BENCH_TOPICS = ("state", "motors", "watch")
+LINK_TIMEOUT = 2.0                      # Write stall after which the simulator gives up on the link [s]
+
+
+def frame(msg_id, payload):
+    return struct.pack("<BIH", msg_id, stm32_crc(payload), len(payload)) + payload + b"\r\n"
+
+
+def write_link(master, data):
+    """
+    Writes data to the non-blocking master, returns the time [s] the link refused data, 0 if none. Gives up after
+    LINK_TIMEOUT, the frames are then lost.
+    """
+    stall_start = None
+    while data:
+        try:
+            data = data[os.write(master, data):]
+        except BlockingIOError:
+            pass
+        if data:
+            if stall_start is None:
+                stall_start = time.monotonic()
+            if not select.select([], [master], [], LINK_TIMEOUT)[1]:
+                break
+    return 0.0 if stall_start is None else time.monotonic() - stall_start
+
+
+def simulated_fcb(master, rate, duration, payload_size, result):
+    """Writes one frame per topic and loop period and answers each '\\r' terminated command with text lines."""
+    period = 1.0 / rate
+    padding = bytes(max(0, payload_size - BENCH_PAYLOAD.size))
+    ids = [ts.TOPICS.index(name) for name in BENCH_TOPICS]
+    command = bytearray()
+    sent = 0
+    commands = 0
+    max_stall = 0.0
+    start = time.monotonic()
+    os.set_blocking(master, False)
+    next_loop = start
+
+    while next_loop - start < duration:
+        timeout = max(0.0, next_loop - time.monotonic())
+        readable, _, _ = select.select([master], [], [], timeout)
+        if readable:
+            command += os.read(master, 4096)
+            while b"\r" in command:
+                line, _, rest = bytes(command).partition(b"\r")
+                command = bytearray(rest)
+                commands += 1
+                max_stall = max(max_stall, write_link(master, b"Command '%s' ok\r\nSecond line of %d\r\n" % (
+                    line, commands)))
+        if time.monotonic() < next_loop:
+            continue
+
+        seq = sent // len(ids)
+        data = b"".join(frame(msg_id, BENCH_PAYLOAD.pack(time.monotonic(), seq) + padding) for msg_id in ids)
+        max_stall = max(max_stall, write_link(master, data))
+        sent += len(ids)
+        next_loop += period
+        if max_stall >= LINK_TIMEOUT:
+            break
+
+    result.put(("fcb", sent, commands, max_stall))
+
+
+def run_server(slave_path, socket_path, udp_port, shm_path, duration, result):
+    server = ts.TelemetryServer(ts.open_link(slave_path, 115200), socket_path, udp_port, shm_path)
+    cpu_start = time.process_time()
+    server.serve(duration)
+    result.put(("server", server.decoder.frames, server.decoder.lines, time.process_time() - cpu_start,
+                sum(c.dropped for c in server.clients.values())))
+
+
+def latency_stats(latencies):
+    latencies.sort()
+    if not latencies:
+        return 0.0, 0.0, 0.0
+    return (latencies[len(latencies) // 2] * 1e3, latencies[len(latencies) * 99 // 100] * 1e3,
+            latencies[-1] * 1e3)
+
+
+def count_lost(seen):
+    """Frames missing between the first and last sequence number of each topic."""
+    return sum(max(s) - min(s) + 1 - len(s) for s in seen.values() if s)
+
+
+def stream_client(name, socket_path, topics, slow, commands, duration, result):
+    client = ts.TelemetryClient(socket_path)
+    client.request("sub " + " ".join(topics))
+    if slow:
+        # Never reads, its backlog fills up and the server drops its records
+        time.sleep(duration)
+        result.put((name, 0, 0, (0.0, 0.0, 0.0), 0, 0))
+        return
+
+    latencies = []
+    seen = {}
+    received = replies = done = 0
+    next_command = time.monotonic() + 0.5
+    end = time.monotonic() + duration
+    while time.monotonic() < end:
+        for topic, _, _, payload in client.records(0.05):
+            if commands and time.monotonic() >= next_command:
+                client.request("cmd bench-%s" % name)
+                next_command += 1.0
+            if topic == ts.REPLY_TOPIC:
+                replies += 1
+            elif topic == ts.STATUS_TOPIC and payload.startswith(b"done"):
+                done += 1
+            elif topic < ts.CLI_TOPIC:
+                send_time, seq = BENCH_PAYLOAD.unpack_from(payload)
+                latencies.append(time.monotonic() - send_time)
+                seen.setdefault(topic, set()).add(seq)
+                received += 1
+            if time.monotonic() >= end:
+                break
+    result.put((name, received, count_lost(seen), latency_stats(latencies), replies, done))
+
+
+def udp_client(name, udp_port, topics, duration, result):
+    sock = socket.socket(socket.AF_INET, socket.SOCK_DGRAM)
+    sock.settimeout(0.05)
+    server = ("127.0.0.1", udp_port)
+    sock.sendto(("sub " + " ".join(topics)).encode("ascii"), server)
+    latencies = []
+    seen = {}
+    received = 0
+    end = time.monotonic() + duration
+    next_ping = time.monotonic() + 1.0
+    while time.monotonic() < end:
+        if time.monotonic() >= next_ping:
+            sock.sendto(b"ping", server)
+            next_ping += 1.0
+        try:
+            data = sock.recv(65536)
+        except socket.timeout:
+            continue
+        _, topic, _, _ = ts.RECORD.unpack_from(data)
+        if topic < ts.CLI_TOPIC:
+            send_time, seq = BENCH_PAYLOAD.unpack_from(data, ts.RECORD.size)
+            latencies.append(time.monotonic() - send_time)
+            seen.setdefault(topic, set()).add(seq)
+            received += 1
+    result.put((name, received, count_lost(seen), latency_stats(latencies), 0, 0))
+
+
+def shm_reader(name, shm_path, duration, result):
+    reader = ts.ShmRingReader(shm_path)
+    latencies = []
+    seen = {}
+    received = 0
+    end = time.monotonic() + duration
+    while time.monotonic() < end:
+        for topic, _, _, payload in reader.records():
+            if topic < ts.CLI_TOPIC:
+                send_time, seq = BENCH_PAYLOAD.unpack_from(payload)
+                latencies.append(time.monotonic() - send_time)
+                seen.setdefault(topic, set()).add(seq)
+                received += 1
+        time.sleep(0.001)
+    result.put((name, received, count_lost(seen) + reader.overruns, latency_stats(latencies), 0, 0))
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("--clients", type=int, default=16, help="Unix socket clients")
+    parser.add_argument("--slow", type=int, default=2, help="of which never read their socket")
+    parser.add_argument("--commanders", type=int, default=2, help="of which send a command every second")
+    parser.add_argument("--udp-clients", type=int, default=4, help="UDP clients")
+    parser.add_argument("--shm-readers", type=int, default=2, help="shared memory ring readers")
+    parser.add_argument("--rate", type=float, default=400.0, help="simulated loop rate [Hz]")
+    parser.add_argument("--payload", type=int, default=48, help="frame payload size [bytes]")
+    parser.add_argument("--duration", type=float, default=5.0, help="benchmark time [s]")
+    args = parser.parse_args()
+
+    workdir = tempfile.mkdtemp(prefix="fcb-telemetry-")
+    socket_path = os.path.join(workdir, "server.sock")
+    shm_path = os.path.join(workdir, "ring")
+    udp_port = 20000 + os.getpid() % 20000
+
+    master, slave = pty.openpty()
+    tty.setraw(master)
+    result = multiprocessing.Queue()
+    settle = 1.0
+    server = multiprocessing.Process(target=run_server, args=(os.ttyname(slave), socket_path, udp_port, shm_path,
+                                                              args.duration + 2 * settle + 1.0, result))
+    server.start()
+    while not os.path.exists(socket_path):
+        time.sleep(0.01)
+
+    clients = []
+    for i in range(args.clients):
+        slow = i < args.slow
+        commands = args.slow <= i < args.slow + args.commanders
+        clients.append(multiprocessing.Process(target=stream_client, args=(
+            "unix%d%s" % (i, " slow" if slow else ""), socket_path, BENCH_TOPICS, slow, commands,
+            args.duration + settle, result)))
+    for i in range(args.udp_clients):
+        clients.append(multiprocessing.Process(target=udp_client, args=(
+            "udp%d" % i, udp_port, BENCH_TOPICS, args.duration + settle, result)))
+    for i in range(args.shm_readers):
+        clients.append(multiprocessing.Process(target=shm_reader, args=(
+            "shm%d" % i, shm_path, args.duration + settle, result)))
+    for process in clients:
+        process.start()
+    time.sleep(settle / 2)
+
+    fcb = multiprocessing.Process(target=simulated_fcb, args=(master, args.rate, args.duration, args.payload, result))
+    fcb.start()
+
+    results = [result.get() for _ in range(len(clients) + 2)]
+    for process in clients + [fcb, server]:
+        process.join()
+
+    fcb_result = next(r for r in results if r[0] == "fcb")
+    server_result = next(r for r in results if r[0] == "server")
+    _, sent, commands, max_stall = fcb_result
+    _, frames, lines, cpu, client_drops = server_result
+
+    print("%-14s %9s %6s %9s %9s %9s %7s %5s" % ("client", "received", "lost", "p50 [ms]", "p99 [ms]", "max [ms]",
+                                                  "replies", "done"))
+    for name, received, lost, (p50, p99, worst), replies, done in sorted(r for r in results if r[0] not in
+                                                                         ("fcb", "server")):
+        print("%-14s %9d %6d %9.2f %9.2f %9.2f %7d %5d" % (name, received, lost, p50, p99, worst, replies, done))
+    print("vehicle link: %d frames sent, %d decoded, %d lost, %d commands, max write stall %.2f ms" % (
+        sent, frames, sent - frames, commands, max_stall * 1e3))
+    print("server: %d text lines, %.2f s CPU (%.0f %%), %d records dropped for clients" % (
+        lines, cpu, 100.0 * cpu / (args.duration + 2 * settle + 1.0), client_drops))
+
+    if sent != frames:
+        sys.exit("vehicle link lost frames")
+    if max_stall > 1.0 / args.rate:
+        sys.exit("vehicle link writes stalled for more than one loop period")
+
+
+if __name__ == "__main__":
+    main()
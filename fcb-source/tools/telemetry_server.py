@@ -0,0 +1,646 @@
+#!/usr/bin/env python3
+"""
+Telemetry fan-out server. Owns the FCB USB or UART link, decodes the byte
+stream once into binary frames (common message header, see communication.h)
+and CLI text lines, and fans them out to any number of local clients:
+
+- Unix stream socket (--socket): clients send text lines
+      sub <topic>... | unsub <topic>... | lock | unlock | cmd <cli command> | stats
+  and receive records, RECORD header followed by the payload.
+- UDP (--udp): the same lines as datagrams, one record per datagram. UDP
+  clients must resend a line (e.g. "ping") every UDP_CLIENT_TIMEOUT seconds.
+- Shared memory ring (--shm): every record is appended to a ring file that
+  local readers map read-only and read in place, see ShmRingReader.
+
+Topics are the message types of communication.h (rc, motors, sensors, state,
+watch, ...) plus "cli" for CLI text lines, "reply" for the response lines to
+a client's own commands and "status" for server replies. Subscribing to
+"all" subscribes to every topic.
+
+Commands are arbitrated: one command is in flight on the link at a time and
+its response lines are routed to the requesting client. A client that holds
+the lock is the only one whose commands are accepted until it unlocks or
+disconnects.
+
+The vehicle link is never throttled by clients. The link is read before any
+client is served, all client sockets are non-blocking and each client has a
+bounded backlog; records that do not fit are dropped and counted per
+client.
+
+    python3 tools/telemetry_server.py --port /dev/ttyACM0 \\
+        --socket /tmp/fcb-telemetry.sock --udp 5760 --shm /dev/shm/fcb-telemetry
+
+See telemetry_bench.py for a many-client benchmark against a pty-simulated
+FCB. Only the Python standard library is used, the port may be a pty.
+"""
+
+import argparse
+import mmap
+import os
+import re
+import selectors
+import socket
+import struct
+import sys
+import termios
+import time
+import tty
+
+from watch import PROTO_HEADER_LEN
+
+# communication.h ProtoMessageTypeEnum
+FRAME_TOPICS = ("error", "rc", "motors", "sensors", "state", "pid", "ref", "sim", "ctrl", "generic", "watch",
+                "injection", "injection-motors")
+CLI_TOPIC = len(FRAME_TOPICS)
+REPLY_TOPIC = CLI_TOPIC + 1
+STATUS_TOPIC = CLI_TOPIC + 2
+TOPICS = FRAME_TOPICS + ("cli", "reply", "status")
+
+# Record: payload size, topic, host receive time [s], per topic sequence number
+RECORD = struct.Struct("<IBxxxdI")
+
+MAX_FRAME_PAYLOAD = 256         # Larger sizes in a frame header are taken as CLI text, see MAX_CLI_OUTPUT_SIZE
+MAX_TEXT_LINE = 1024
+STALE_BYTES_TIMEOUT = 0.05      # [s] Partial frame header with no more data is taken as text
+CMD_QUIET_TIME = 0.1            # [s] Command response ends when no text has followed its first line this long
+CMD_TIMEOUT = 2.0               # [s]
+UDP_CLIENT_TIMEOUT = 10.0       # [s]
+LINK_READ_SIZE = 65536
+
+FRAME_ID_PATTERN = re.compile(b"[\\x00-\\x%02x]" % (len(FRAME_TOPICS) - 1))
+
+
+def _crc_table():
+    table = []
+    for i in range(256):
+        crc = i << 24
+        for _ in range(8):
+            crc = ((crc << 1) ^ 0x04C11DB7) & 0xFFFFFFFF if crc & 0x80000000 else (crc << 1) & 0xFFFFFFFF
+        table.append(crc)
+    return table
+
+
+CRC_TABLE = _crc_table()
+
+
+def fast_crc(data):
+    """Table driven equivalent of watch.stm32_crc()."""
+    crc = 0xFFFFFFFF
+    for byte in data:
+        crc = ((crc << 8) & 0xFFFFFFFF) ^ CRC_TABLE[(crc >> 24) ^ byte]
+    return crc
+
+
+def topic_ids(names):
+    """Returns the topic ids of topic names, "all" selects every topic."""
+    ids = set()
+    for name in names:
+        if name == "all":
+            ids.update(range(len(TOPICS)))
+        elif name in TOPICS:
+            ids.add(TOPICS.index(name))
+        else:
+            raise ValueError("unknown topic '%s'" % name)
+    return ids
+
+
+class FrameDecoder:
+    """Splits the link byte stream into binary frames and CLI text lines. A byte that is a message id starts a frame
+    only if the size, trailer and CRC check out, otherwise it is text. Message ids 9 and 10 are also tab and newline,
+    so a frame candidate waits for its remaining bytes, at most STALE_BYTES_TIMEOUT."""
+
+    def __init__(self):
+        self.buffer = bytearray()
+        self.text = bytearray()
+        self.frames = 0
+        self.lines = 0
+        self.last_data = 0.0
+
+    def feed(self, data, now):
+        """Returns the (topic, payload) tuples completed by data."""
+        self.buffer += data
+        self.last_data = now
+        return self._decode(False)
+
+    def flush_stale(self, now):
+        """Takes a partial frame candidate as text if no data has arrived for STALE_BYTES_TIMEOUT."""
+        if self.buffer and now - self.last_data >= STALE_BYTES_TIMEOUT:
+            return self._decode(True)
+        return []
+
+    def _decode(self, force_text):
+        buf = self.buffer
+        out = []
+        pos = 0
+        end = len(buf)
+
+        while pos < end:
+            match = FRAME_ID_PATTERN.search(buf, pos)
+            start = match.start() if match else end
+            if start > pos:
+                self._add_text(buf[pos:start], out)
+                pos = start
+                if pos == end:
+                    break
+
+            # Frame candidate. An incomplete candidate waits for more bytes, unless it is a newline or tab directly
+            # followed by a complete frame.
+            total = self._frame_length(buf, pos, end)
+            if total > 0:
+                out.append((buf[pos], bytes(buf[pos + PROTO_HEADER_LEN:pos + total - 2])))
+                self.frames += 1
+                pos += total
+                continue
+            if total < 0 and not force_text and self._frame_length(buf, pos + 1, end) <= 0:
+                break
+
+            # Not a frame, the byte is text
+            self._add_text(buf[pos:pos + 1], out)
+            pos += 1
+
+        del buf[:pos]
+        return out
+
+    @staticmethod
+    def _frame_length(buf, pos, end):
+        """Returns the length of a valid frame at pos, 0 if there is none or -1 if more bytes are needed to tell."""
+        if pos >= end or buf[pos] >= len(FRAME_TOPICS):
+            return 0
+        if end - pos < PROTO_HEADER_LEN:
+            return -1
+        crc, size = struct.unpack_from("<IH", buf, pos + 1)
+        total = PROTO_HEADER_LEN + size + 2
+        if size > MAX_FRAME_PAYLOAD:
+            return 0
+        if end - pos < total:
+            return -1
+        if buf[pos + total - 2:pos + total] != b"\r\n" \
+                or fast_crc(buf[pos + PROTO_HEADER_LEN:pos + total - 2]) != crc:
+            return 0
+        return total
+
+    def _add_text(self, data, out):
+        text = self.text
+        text += data
+        while True:
+            newline = text.find(b"\n")
+            if newline < 0:
+                if len(text) >= MAX_TEXT_LINE:
+                    newline = len(text) - 1
+                else:
+                    break
+            line = bytes(text[:newline + 1]).strip(b"\r\n")
+            del text[:newline + 1]
+            if line:
+                out.append((CLI_TOPIC, line))
+                self.lines += 1
+
+
+class ShmRing:
+    """Single writer ring of records in a shared memory file. The header holds the total number of bytes written,
+    records are 4 byte aligned and a record that does not fit before the end of the ring is preceded by a pad."""
+
+    HEADER = struct.Struct("<4sIIIQ")   # magic, version, capacity, reserved, write position
+    MAGIC = b"FCBT"
+    VERSION = 1
+    PAD = 0xFFFFFFFF
+    MAX_RECORD = RECORD.size + MAX_TEXT_LINE + MAX_FRAME_PAYLOAD
+
+    def __init__(self, path, capacity):
+        self.capacity = capacity & ~3
+        self.position = 0
+        fd = os.open(path, os.O_RDWR | os.O_CREAT | os.O_TRUNC, 0o644)
+        try:
+            os.ftruncate(fd, self.HEADER.size + self.capacity)
+            self.map = mmap.mmap(fd, self.HEADER.size + self.capacity)
+        finally:
+            os.close(fd)
+        self.HEADER.pack_into(self.map, 0, self.MAGIC, self.VERSION, self.capacity, 0, 0)
+
+    def write(self, record):
+        size = (len(record) + 3) & ~3
+        offset = self.position % self.capacity
+        if offset + size > self.capacity:
+            if self.capacity - offset >= 4:
+                struct.pack_into("<I", self.map, self.HEADER.size + offset, self.PAD)
+            self.position += self.capacity - offset
+            offset = 0
+        base = self.HEADER.size + offset
+        self.map[base:base + len(record)] = record
+        self.position += size
+        struct.pack_into("<Q", self.map, 16, self.position)
+
+
+class ShmRingReader:
+    """Zero-copy reader of a ShmRing. Starts at the current end of the ring. The payload memoryviews point into the
+    shared memory and are only valid until the next record is requested; a reader that falls more than the ring
+    capacity behind skips to the current end and counts an overrun."""
+
+    def __init__(self, path):
+        fd = os.open(path, os.O_RDONLY)
+        try:
+            self.map = mmap.mmap(fd, 0, prot=mmap.PROT_READ)
+        finally:
+            os.close(fd)
+        magic, version, self.capacity, _, _ = ShmRing.HEADER.unpack_from(self.map, 0)
+        if magic != ShmRing.MAGIC or version != ShmRing.VERSION:
+            raise ValueError("not a telemetry ring")
+        self.view = memoryview(self.map)
+        self.position = self._write_position()
+        self.overruns = 0
+
+    def _write_position(self):
+        while True:
+            first = struct.unpack_from("<Q", self.map, 16)[0]
+            if struct.unpack_from("<Q", self.map, 16)[0] == first:
+                return first
+
+    def _overrun(self, write):
+        return write - self.position > self.capacity - ShmRing.MAX_RECORD
+
+    def records(self):
+        """Yields (topic, time, seq, payload) for the records written since the last call."""
+        base = ShmRing.HEADER.size
+        while True:
+            write = self._write_position()
+            if self.position >= write:
+                return
+            if self._overrun(write):
+                self.overruns += 1
+                self.position = write
+                return
+
+            offset = self.position % self.capacity
+            if self.capacity - offset < RECORD.size \
+                    or struct.unpack_from("<I", self.map, base + offset)[0] == ShmRing.PAD:
+                self.position += self.capacity - offset
+                continue
+
+            size, topic, timestamp, seq = RECORD.unpack_from(self.map, base + offset)
+            start = base + offset + RECORD.size
+            yield topic, timestamp, seq, self.view[start:start + size]
+
+            # The writer may have lapped the record while it was in use
+            if self._overrun(self._write_position()):
+                self.overruns += 1
+                self.position = self._write_position()
+                return
+            self.position += (RECORD.size + size + 3) & ~3
+
+
+class Client:
+    """Stream or UDP client with its subscriptions and bounded output backlog."""
+
+    def __init__(self, sock, address, backlog):
+        self.sock = sock
+        self.address = address          # None for stream clients
+        self.backlog = backlog
+        self.topics = set()
+        self.out = bytearray()
+        self.inbuf = bytearray()
+        self.last_seen = time.monotonic()
+        self.sent = 0
+        self.dropped = 0
+        self.writing = False            # Registered for write events
+
+    def name(self):
+        return "udp:%s:%d" % self.address if self.address else "unix:%d" % self.sock.fileno()
+
+
+class TelemetryServer:
+    def __init__(self, link_fd, socket_path=None, udp_port=None, shm_path=None, shm_size=1 << 22,
+                 backlog=1 << 18):
+        self.link_fd = link_fd
+        self.link_out = bytearray()
+        self.link_writing = False
+        self.decoder = FrameDecoder()
+        self.selector = selectors.DefaultSelector()
+        self.selector.register(link_fd, selectors.EVENT_READ, "link")
+        self.backlog = backlog
+        self.clients = {}               # stream socket or UDP address -> Client
+        self.subscribers = [set() for _ in TOPICS]
+        self.seq = [0] * len(TOPICS)
+        self.link_bytes = 0
+        self.lock_owner = None
+        self.commands = []              # queued (client, command)
+        self.command = None             # (client, command, start time) in flight
+        self.last_link_text = 0.0
+
+        self.listener = None
+        if socket_path:
+            if os.path.exists(socket_path):
+                os.unlink(socket_path)
+            self.listener = socket.socket(socket.AF_UNIX, socket.SOCK_STREAM)
+            self.listener.bind(socket_path)
+            self.listener.listen(64)
+            self.listener.setblocking(False)
+            self.selector.register(self.listener, selectors.EVENT_READ, "accept")
+
+        self.udp = None
+        if udp_port:
+            self.udp = socket.socket(socket.AF_INET, socket.SOCK_DGRAM)
+            self.udp.bind(("127.0.0.1", udp_port))
+            self.udp.setblocking(False)
+            self.selector.register(self.udp, selectors.EVENT_READ, "udp")
+
+        self.shm = ShmRing(shm_path, shm_size) if shm_path else None
+
+    def serve(self, duration=0.0):
+        start = time.monotonic()
+        while not duration or time.monotonic() - start < duration:
+            self.poll(STALE_BYTES_TIMEOUT)
+
+    def poll(self, timeout):
+        events = self.selector.select(timeout)
+        now = time.monotonic()
+
+        # The link is always served first
+        for key, mask in events:
+            if key.data == "link":
+                if mask & selectors.EVENT_READ:
+                    self._read_link(now)
+                if mask & selectors.EVENT_WRITE:
+                    self._write_link()
+        for topic, payload in self.decoder.flush_stale(now):
+            self._publish(topic, payload, now)
+
+        for key, mask in events:
+            if key.data == "accept":
+                self._accept()
+            elif key.data == "udp":
+                self._read_udp(now)
+            elif isinstance(key.data, Client):
+                if mask & selectors.EVENT_READ:
+                    self._read_client(key.data)
+                if mask & selectors.EVENT_WRITE and key.data.sock in self.clients:
+                    self._flush_client(key.data)
+
+        self._run_commands(now)
+        self._expire_udp_clients(now)
+
+    # Link ------------------------------------------------------------------
+
+    def _read_link(self, now):
+        try:
+            data = os.read(self.link_fd, LINK_READ_SIZE)
+        except BlockingIOError:
+            return
+        self.link_bytes += len(data)
+        for topic, payload in self.decoder.feed(data, now):
+            if topic == CLI_TOPIC:
+                self.last_link_text = now
+            self._publish(topic, payload, now)
+
+    def _send_link(self, data):
+        self.link_out += data
+        self._write_link()
+
+    def _write_link(self):
+        try:
+            written = os.write(self.link_fd, self.link_out) if self.link_out else 0
+        except BlockingIOError:
+            written = 0
+        del self.link_out[:written]
+        if self.link_writing != bool(self.link_out):
+            self.link_writing = bool(self.link_out)
+            events = selectors.EVENT_READ | (selectors.EVENT_WRITE if self.link_writing else 0)
+            self.selector.modify(self.link_fd, events, "link")
+
+    # Fan-out ---------------------------------------------------------------
+
+    def _publish(self, topic, payload, now, only=None):
+        record = RECORD.pack(len(payload), topic, time.time(), self.seq[topic]) + payload
+        self.seq[topic] = (self.seq[topic] + 1) & 0xFFFFFFFF
+        if topic == CLI_TOPIC and self.command:
+            self._queue_record(self.command[0], RECORD.pack(len(payload), REPLY_TOPIC, time.time(),
+                                                            self.seq[REPLY_TOPIC]) + payload)
+            self.seq[REPLY_TOPIC] = (self.seq[REPLY_TOPIC] + 1) & 0xFFFFFFFF
+        if self.shm and only is None:
+            self.shm.write(record)
+        for client in ([only] if only else list(self.subscribers[topic])):
+            self._queue_record(client, record)
+
+    def _queue_record(self, client, record):
+        if client.address:
+            try:
+                self.udp.sendto(record, client.address)
+                client.sent += 1
+            except (BlockingIOError, OSError):
+                client.dropped += 1
+            return
+        if len(client.out) + len(record) > client.backlog:
+            client.dropped += 1
+            return
+        idle = not client.out
+        client.out += record
+        client.sent += 1
+        if idle:
+            self._flush_client(client)
+
+    def _flush_client(self, client):
+        try:
+            sent = client.sock.send(client.out)
+        except BlockingIOError:
+            sent = 0
+        except OSError:
+            self._close_client(client)
+            return
+        del client.out[:sent]
+        if client.writing != bool(client.out):
+            client.writing = bool(client.out)
+            events = selectors.EVENT_READ | (selectors.EVENT_WRITE if client.writing else 0)
+            self.selector.modify(client.sock, events, client)
+
+    def _status(self, client, text):
+        self._publish(STATUS_TOPIC, text.encode("ascii"), time.monotonic(), only=client)
+
+    # Clients ---------------------------------------------------------------
+
+    def _accept(self):
+        try:
+            sock, _ = self.listener.accept()
+        except BlockingIOError:
+            return
+        sock.setblocking(False)
+        client = Client(sock, None, self.backlog)
+        self.clients[sock] = client
+        self.selector.register(sock, selectors.EVENT_READ, client)
+
+    def _close_client(self, client):
+        # A client closed while publishing may still have events of the same poll
+        if not client.address and client.sock not in self.clients:
+            return
+        for subscribers in self.subscribers:
+            subscribers.discard(client)
+        if self.lock_owner is client:
+            self.lock_owner = None
+        self.commands = [entry for entry in self.commands if entry[0] is not client]
+        if client.address:
+            self.clients.pop(client.address, None)
+            return
+        self.clients.pop(client.sock, None)
+        self.selector.unregister(client.sock)
+        client.sock.close()
+
+    def _read_client(self, client):
+        try:
+            data = client.sock.recv(4096)
+        except BlockingIOError:
+            return
+        except OSError:
+            data = b""
+        if not data:
+            self._close_client(client)
+            return
+        client.inbuf += data
+        while b"\n" in client.inbuf:
+            line, _, rest = bytes(client.inbuf).partition(b"\n")
+            client.inbuf = bytearray(rest)
+            self._handle_line(client, line.decode("ascii", "replace").strip())
+
+    def _read_udp(self, now):
+        while True:
+            try:
+                data, address = self.udp.recvfrom(4096)
+            except BlockingIOError:
+                return
+            client = self.clients.get(address)
+            if client is None:
+                client = self.clients[address] = Client(self.udp, address, self.backlog)
+            client.last_seen = now
+            for line in data.decode("ascii", "replace").splitlines():
+                self._handle_line(client, line.strip())
+
+    def _expire_udp_clients(self, now):
+        for client in [c for c in self.clients.values() if c.address]:
+            if now - client.last_seen > UDP_CLIENT_TIMEOUT:
+                self._close_client(client)
+
+    def _handle_line(self, client, line):
+        verb, _, argument = line.partition(" ")
+        if verb in ("sub", "unsub"):
+            try:
+                ids = topic_ids(argument.split())
+            except ValueError as error:
+                self._status(client, "err %s" % error)
+                return
+            for topic in ids:
+                if verb == "sub":
+                    self.subscribers[topic].add(client)
+                    client.topics.add(topic)
+                else:
+                    self.subscribers[topic].discard(client)
+                    client.topics.discard(topic)
+            self._status(client, "ok %s" % line)
+        elif verb == "lock":
+            if self.lock_owner not in (None, client):
+                self._status(client, "err locked by %s" % self.lock_owner.name())
+            else:
+                self.lock_owner = client
+                self._status(client, "ok lock")
+        elif verb == "unlock":
+            if self.lock_owner is client:
+                self.lock_owner = None
+            self._status(client, "ok unlock")
+        elif verb == "cmd" and argument:
+            if self.lock_owner not in (None, client):
+                self._status(client, "err locked by %s" % self.lock_owner.name())
+            else:
+                self.commands.append((client, argument))
+        elif verb == "stats":
+            self._status(client, self.stats())
+        elif verb == "ping":
+            pass
+        elif line:
+            self._status(client, "err unknown request '%s'" % line)
+
+    # Commands --------------------------------------------------------------
+
+    def _run_commands(self, now):
+        if self.command:
+            client, text, started = self.command
+            answered = self.last_link_text > started
+            if (answered and now - self.last_link_text >= CMD_QUIET_TIME) or now - started >= CMD_TIMEOUT:
+                self.command = None
+                if client in self.clients.values():
+                    self._status(client, "done %s" % text)
+        if not self.command and self.commands:
+            client, text = self.commands.pop(0)
+            self.command = (client, text, now)
+            self._send_link((text + "\r").encode("ascii", "replace"))
+
+    def stats(self):
+        clients = ", ".join("%s sent %d dropped %d" % (c.name(), c.sent, c.dropped) for c in self.clients.values())
+        return "link %d bytes, %d frames, %d lines; clients: %s" % (
+            self.link_bytes, self.decoder.frames, self.decoder.lines, clients or "none")
+
+
+class TelemetryClient:
+    """Unix socket client of the telemetry server."""
+
+    def __init__(self, socket_path):
+        self.sock = socket.socket(socket.AF_UNIX, socket.SOCK_STREAM)
+        self.sock.connect(socket_path)
+        self.buffer = bytearray()
+
+    def request(self, line):
+        self.sock.sendall((line + "\n").encode("ascii"))
+
+    def records(self, timeout=None):
+        """Yields (topic, time, seq, payload) until the timeout passes without data."""
+        self.sock.settimeout(timeout)
+        while True:
+            while len(self.buffer) >= RECORD.size:
+                size, topic, timestamp, seq = RECORD.unpack_from(self.buffer, 0)
+                if len(self.buffer) < RECORD.size + size:
+                    break
+                payload = bytes(self.buffer[RECORD.size:RECORD.size + size])
+                del self.buffer[:RECORD.size + size]
+                yield topic, timestamp, seq, payload
+            try:
+                data = self.sock.recv(65536)
+            except socket.timeout:
+                return
+            if not data:
+                return
+            self.buffer += data
+
+
+def open_link(port, baud):
+    """Opens a serial port or pty in raw non-blocking mode."""
+    fd = os.open(port, os.O_RDWR | os.O_NOCTTY | os.O_NONBLOCK)
+    tty.setraw(fd)
+    attributes = termios.tcgetattr(fd)
+    speed = getattr(termios, "B%d" % baud)
+    attributes[4] = attributes[5] = speed
+    termios.tcsetattr(fd, termios.TCSANOW, attributes)
+    return fd
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("--port", required=True, help="FCB serial port, e.g. /dev/ttyACM0")
+    parser.add_argument("--baud", type=int, default=115200, help="baud rate, used for the UART")
+    parser.add_argument("--socket", default="/tmp/fcb-telemetry.sock", help="Unix socket path, '' to disable")
+    parser.add_argument("--udp", type=int, default=0, help="UDP port on localhost, 0 to disable")
+    parser.add_argument("--shm", default="", help="shared memory ring file, e.g. /dev/shm/fcb-telemetry")
+    parser.add_argument("--shm-size", type=int, default=1 << 22, help="shared memory ring size [bytes]")
+    parser.add_argument("--backlog", type=int, default=1 << 18, help="per client output backlog [bytes]")
+    parser.add_argument("--stats", type=float, default=0.0, help="print server statistics every n seconds")
+    args = parser.parse_args()
+
+    server = TelemetryServer(open_link(args.port, args.baud), args.socket or None, args.udp or None,
+                             args.shm or None, args.shm_size, args.backlog)
+    next_stats = time.monotonic() + args.stats
+    try:
+        while True:
+            server.poll(STALE_BYTES_TIMEOUT)
+            if args.stats and time.monotonic() >= next_stats:
+                sys.stderr.write(server.stats() + "\n")
+                next_stats += args.stats
+    except KeyboardInterrupt:
+        pass
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,169 @@
+#!/usr/bin/env python3
+"""
+Host side of the variable watch (fcb/src/variable_watch.c). Resolves
+variables in the firmware ELF file, adds them to the watch over the USB CLI,
+starts streaming and prints the decoded samples as CSV on stdout.
+
+Variables are given as <name>[+<offset>]:<type> or <address>:<type>, where
+<type> is one of u8, i8, u16, i16, u32, i32, f32. Symbols are resolved with
+arm-none-eabi-nm, offsets select members of structs and arrays, e.g.
+
+    python3 tools/watch.py --port /dev/ttyACM0 --elf Debug/dragonfly-fcb.elf \\
+        --div 2 rollStateInternal:f32 rollStateInternal+4:f32 0x20000100:u16
+
+The ELF file must be the one running on the board, otherwise the addresses
+are meaningless. Requires pyserial.
+"""
+
+import argparse
+import re
+import struct
+import subprocess
+import sys
+
+WATCH_SAMPLES_MSG_ENUM = 10  # communication.h ProtoMessageTypeEnum
+PROTO_HEADER_LEN = 7
+WATCH_MAX_VARIABLES = 16
+
+WATCH_TYPES = {
+    "u8": "B", "i8": "b",
+    "u16": "H", "i16": "h",
+    "u32": "I", "i32": "i",
+    "f32": "f",
+}
+
+
+def stm32_crc(data):
+    """CRC as calculated by the STM32 CRC peripheral with the settings in
+    InitCRC(): polynomial 0x04C11DB7, init 0xFFFFFFFF, no reflection, no
+    final XOR, byte input."""
+    crc = 0xFFFFFFFF
+    for byte in data:
+        crc ^= byte << 24
+        for _ in range(8):
+            if crc & 0x80000000:
+                crc = ((crc << 1) ^ 0x04C11DB7) & 0xFFFFFFFF
+            else:
+                crc = (crc << 1) & 0xFFFFFFFF
+    return crc
+
+
+def read_symbols(elf, nm):
+    """Returns a dict of symbol name -> (address, size) for all defined symbols."""
+    output = subprocess.check_output([nm, "-S", "--defined-only", elf], universal_newlines=True)
+    symbols = {}
+    for line in output.splitlines():
+        fields = line.split()
+        if len(fields) == 4:
+            symbols[fields[3]] = (int(fields[0], 16), int(fields[1], 16))
+        elif len(fields) == 3:
+            symbols[fields[2]] = (int(fields[0], 16), 0)
+    return symbols
+
+
+def resolve(spec, symbols):
+    """Resolves <name>[+<offset>]:<type> or <address>:<type> to (label, address, type)."""
+    match = re.match(r"^([A-Za-z_0-9.]+)(?:\+(\w+))?:(\w+)$", spec)
+    if not match:
+        raise ValueError("invalid variable '%s', expected <name>[+<offset>]:<type>" % spec)
+    name, offset, type_name = match.groups()
+    if type_name not in WATCH_TYPES:
+        raise ValueError("invalid type '%s' in '%s'" % (type_name, spec))
+    offset = int(offset, 0) if offset else 0
+    type_size = struct.calcsize("<" + WATCH_TYPES[type_name])
+
+    if re.match(r"^(0x[0-9a-fA-F]+|[0-9]+)$", name):
+        return spec, int(name, 0) + offset, type_name
+    if name not in symbols:
+        raise ValueError("symbol '%s' not found in ELF file" % name)
+    address, size = symbols[name]
+    if size and offset + type_size > size:
+        raise ValueError("offset %d outside '%s' (%d bytes)" % (offset, name, size))
+    return spec, address + offset, type_name
+
+
+def command(port, line, timeout=1.0):
+    """Sends a CLI command and returns the response text."""
+    port.reset_input_buffer()
+    port.write((line + "\r").encode("ascii"))
+    port.timeout = timeout
+    return port.read(4096).decode("ascii", "replace")
+
+
+def samples(port, variables):
+    """Yields (sample counter, values) tuples decoded from the USB stream.
+    Frames with wrong size or CRC are skipped, which also skips CLI text."""
+    layout = "<I" + "".join(WATCH_TYPES[type_name] for _, _, type_name in variables)
+    payload_size = struct.calcsize(layout)
+    buffer = bytearray()
+    port.timeout = 0.1
+
+    while True:
+        buffer += port.read(256)
+        while len(buffer) >= PROTO_HEADER_LEN + payload_size + 2:
+            if buffer[0] != WATCH_SAMPLES_MSG_ENUM:
+                del buffer[0]
+                continue
+            crc, size = struct.unpack_from("<IH", buffer, 1)
+            payload = bytes(buffer[PROTO_HEADER_LEN:PROTO_HEADER_LEN + payload_size])
+            end = buffer[PROTO_HEADER_LEN + payload_size:PROTO_HEADER_LEN + payload_size + 2]
+            if size != payload_size or end != b"\r\n" or stm32_crc(payload) != crc:
+                del buffer[0]
+                continue
+            del buffer[:PROTO_HEADER_LEN + payload_size + 2]
+            values = struct.unpack(layout, payload)
+            yield values[0], values[1:]
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("variables", nargs="+", help="<name>[+<offset>]:<type> or <address>:<type>")
+    parser.add_argument("--port", required=True, help="FCB USB serial port, e.g. /dev/ttyACM0")
+    parser.add_argument("--elf", help="firmware ELF file used to resolve symbol names")
+    parser.add_argument("--nm", default="arm-none-eabi-nm", help="nm executable")
+    parser.add_argument("--div", type=int, default=1, help="sample every <div>:th flight control loop")
+    parser.add_argument("--count", type=int, default=0, help="stop after this many samples, 0 = until Ctrl-C")
+    args = parser.parse_args()
+
+    if len(args.variables) > WATCH_MAX_VARIABLES:
+        parser.error("at most %d variables can be watched" % WATCH_MAX_VARIABLES)
+
+    symbols = read_symbols(args.elf, args.nm) if args.elf else {}
+    try:
+        variables = [resolve(spec, symbols) for spec in args.variables]
+    except ValueError as error:
+        parser.error(str(error))
+
+    import serial
+    port = serial.Serial(args.port, 115200)
+
+    command(port, "stop-watch")
+    command(port, "watch-clear")
+    for label, address, type_name in variables:
+        response = command(port, "watch-add 0x%08x %s" % (address, type_name))
+        if "Watch" not in response:
+            sys.exit("%s rejected: %s" % (label, response.strip()))
+    command(port, "start-watch %d" % args.div, timeout=0.1)
+
+    print("sample," + ",".join(label for label, _, _ in variables))
+    expected = None
+    dropped = 0
+    received = 0
+    try:
+        for counter, values in samples(port, variables):
+            if expected is not None and counter != expected:
+                dropped += (counter - expected) & 0xFFFFFFFF
+            expected = (counter + 1) & 0xFFFFFFFF
+            print("%d,%s" % (counter, ",".join(repr(value) for value in values)))
+            received += 1
+            if args.count and received >= args.count:
+                break
+    except KeyboardInterrupt:
+        pass
+    finally:
+        command(port, "stop-watch")
+        sys.stderr.write("%d samples received, %d dropped\n" % (received, dropped))
+
+
+if __name__ == "__main__":
+    main()
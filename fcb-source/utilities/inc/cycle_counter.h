@@ -0,0 +1,87 @@
+/******************************************************************************
+ * @file    cycle_counter.h
+ * @author  Dragonfly
+ * @version v. 1.0.0
+ * @date    2016-06-01
+ * @brief   Header file for the Cortex-M4 DWT cycle counter. Used to time code
+ *          sections with single CPU cycle resolution.
+ *
+ *          QEMU does not model the DWT unit. In KERNEL_PROFILE_SEMIHOSTING
+ *          builds the free running 24-bit SysTick counter is used instead,
+ *          which runs on the instruction counter based virtual clock when
+ *          QEMU is started with -icount. SysTick must then not be used as
+ *          HAL/RTOS time base.
+ ******************************************************************************/
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __CYCLE_COUNTER_H
+#define __CYCLE_COUNTER_H
+
+/* Includes ------------------------------------------------------------------*/
+#include "stm32f3xx.h"
+
+/* Exported constants --------------------------------------------------------*/
+#if defined(KERNEL_PROFILE_SEMIHOSTING)
+#define CYCLE_COUNTER_MASK      SysTick_LOAD_RELOAD_Msk
+#else
+#define CYCLE_COUNTER_MASK      0xFFFFFFFF
+#endif
+
+/* Exported types ------------------------------------------------------------*/
+/* Exported macro ------------------------------------------------------------*/
+
+/* Converts a number of CPU cycles to nanoseconds with the current core clock */
+#define CYCLES_TO_NS(CYCLES)    ((uint32_t) (((uint64_t) (CYCLES) * 1000000000ULL) / SystemCoreClock))
+
+/* Exported functions ------------------------------------------------------- */
+
+/*
+ * @brief  Enables the DWT cycle counter. Safe to call several times.
+ * @param  None
+ * @retval None
+ */
+static inline void InitCycleCounter(void) {
+#if defined(KERNEL_PROFILE_SEMIHOSTING)
+    if (!(SysTick->CTRL & SysTick_CTRL_ENABLE_Msk)) {
+        SysTick->LOAD = SysTick_LOAD_RELOAD_Msk;
+        SysTick->VAL = 0;
+        SysTick->CTRL = SysTick_CTRL_CLKSOURCE_Msk | SysTick_CTRL_ENABLE_Msk; // Core clock, no interrupt
+    }
+#else
+    CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+    DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+#endif
+}
+
+/*
+ * @brief  Returns the current value of the free running DWT cycle counter
+ * @param  None
+ * @retval CPU cycle count (wraps around after CYCLE_COUNTER_MASK+1 cycles, ~60 s at 72 MHz with DWT)
+ */
+static inline uint32_t GetCycleCount(void) {
+#if defined(KERNEL_PROFILE_SEMIHOSTING)
+    return SysTick_LOAD_RELOAD_Msk - SysTick->VAL; // SysTick counts down
+#else
+    return DWT->CYCCNT;
+#endif
+}
+
+/*
+ * @brief  Returns the number of CPU cycles elapsed since a previous count
+ * @param  startCount : Cycle count obtained with GetCycleCount()
+ * @retval Elapsed CPU cycles (safe for at most one wrap-around)
+ */
+static inline uint32_t GetCyclesSince(const uint32_t startCount) {
+    return (GetCycleCount() - startCount) & CYCLE_COUNTER_MASK;
+}
+
+#endif /* __CYCLE_COUNTER_H */
+
+/**
+ * @}
+ */
+
+/**
+ * @}
+ */
+/*****END OF FILE****/
@@ -50,18 +50,35 @@
 #define FLASH_MAG_CALIBRATION_PAGE              FLASH_SETTINGS_START_PAGE       // Storage page (must be >= FLASH_SETTINGS_START_ADDR)
 #define FLASH_MAG_CALIBRATION_DATA_OFFSET       FLASH_REFERENCE_MAX_LIMITS_END  // Storage byte offset from page base address (has to be word aligned)
 #define FLASH_MAG_CALIBRATION_SIZE              sizeof(float32_t) * 6
-#define FLASH_MAG_CALIBRATION_END               FLASH_MAG_CALIBRATION_DATA_OFFSET + FLASH_MAG_CALIBRATION_SIZE
+#define FLASH_MAG_CALIBRATION_END               FLASH_MAG_CALIBRATION_DATA_OFFSET + FLASH_MAG_CALIBRATION_SIZE + HAL_CRC_LENGTH_32B/4   // Added room for CRC
 /* Accelerometer calibration values */
 #define FLASH_ACC_CALIBRATION_PAGE              FLASH_SETTINGS_START_PAGE       // Storage page (must be >= FLASH_SETTINGS_START_ADDR)
 #define FLASH_ACC_CALIBRATION_DATA_OFFSET       FLASH_MAG_CALIBRATION_END  // Storage byte offset from page base address (has to be word aligned)
 #define FLASH_ACC_CALIBRATION_SIZE              sizeof(float32_t) * 6
-#define FLASH_ACC_CALIBRATION_END               FLASH_ACC_CALIBRATION_DATA_OFFSET + FLASH_ACC_CALIBRATION_SIZE
+#define FLASH_ACC_CALIBRATION_END               FLASH_ACC_CALIBRATION_DATA_OFFSET + FLASH_ACC_CALIBRATION_SIZE + HAL_CRC_LENGTH_32B/4   // Added room for CRC
+/* Earlier firmware stored the accelerometer calibration CRC on top of the last magnetometer calibration value */
+#define FLASH_ACC_CALIBRATION_LEGACY_OFFSET     FLASH_MAG_CALIBRATION_DATA_OFFSET + FLASH_MAG_CALIBRATION_SIZE
+
+/* Settings bits of FlashSettings_TypeDef, for reading and writing all settings with one page operation */
+#define FLASH_SETTINGS_RECEIVER_CALIBRATION     0x01
+#define FLASH_SETTINGS_REFERENCE_MAX_LIMITS     0x02
+#define FLASH_SETTINGS_MAG_CALIBRATION          0x04
+#define FLASH_SETTINGS_ACC_CALIBRATION          0x08
+#define FLASH_SETTINGS_ALL                      0x0F
 
 /* Exported types ------------------------------------------------------------*/
 typedef enum {
 	FLASH_ERROR = 0, FLASH_OK = !FLASH_ERROR
 } FlashErrorStatus;
 
+typedef struct {
+	uint32_t validMask;     // FLASH_SETTINGS_* bits of the settings that hold stored values
+	Receiver_CalibrationValues_TypeDef receiverCalibration;
+	RefSignals_TypeDef referenceMaxLimits;
+	float32_t magCalibration[6];
+	float32_t accCalibration[6];
+} FlashSettings_TypeDef;
+
 /* Exported macro ------------------------------------------------------------*/
 
 /* Exported function prototypes --------------------------------------------- */
@@ -73,6 +90,8 @@ FlashErrorStatus ReadMagCalibrationValuesFromFlash(float32_t magCalibrationValue
 FlashErrorStatus WriteMagCalibrationValuesToFlash(const float32_t magCalibrationValues[6]);
 FlashErrorStatus ReadAccCalibrationValuesFromFlash(float32_t accCalibrationValues[6]);
 FlashErrorStatus WriteAccCalibrationValuesToFlash(const float32_t accCalibrationValues[6]);
+FlashErrorStatus ReadAllSettingsFromFlash(FlashSettings_TypeDef* settings);
+FlashErrorStatus WriteAllSettingsToFlash(const FlashSettings_TypeDef* settings);
 
 #endif /* __FLASH_H */
 
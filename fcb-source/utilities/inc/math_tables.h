@@ -0,0 +1,136 @@
+/******************************************************************************
+ * @file    math_tables.h
+ * @author  Dragonfly
+ * @version v. 1.0.0
+ * @date    2016-06-01
+ * @brief   Header file for table based sin/cos and pressure to altitude
+ *          functions with linear interpolation.
+ *
+ *          The tables in math_tables.c are generated together with the size
+ *          defines below by tools/gen_math_tables.py, which also verifies
+ *          the interpolation accuracy. Rerun it to change the resolution.
+ ******************************************************************************/
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __MATH_TABLES_H
+#define __MATH_TABLES_H
+
+/* Includes ------------------------------------------------------------------*/
+#include "arm_math.h"
+
+/* Exported constants --------------------------------------------------------*/
+
+/* Generated by tools/gen_math_tables.py, do not edit by hand */
+#define SIN_TABLE_SIZE                  512     // Entries per period, power of two
+#define PRESSURE_TABLE_MIN              30000   // Lowest table pressure [Pa]
+#define PRESSURE_TABLE_STEP_SHIFT       8       // Pressure step between table entries is 2^shift [Pa]
+#define PRESSURE_TABLE_SIZE             314
+
+/* Angles of this magnitude and above are reduced to one period before the table index cast [rad] */
+#define SIN_TABLE_REDUCE_ANGLE          1.0e5f
+
+/* Exported types ------------------------------------------------------------*/
+/* Exported variables --------------------------------------------------------*/
+extern const float32_t SinTable[SIN_TABLE_SIZE + 1];
+extern const float32_t PressureAltitudeTable[PRESSURE_TABLE_SIZE];
+
+/* Exported macro ------------------------------------------------------------*/
+
+/* Exported functions ------------------------------------------------------- */
+
+/*
+ * @brief  Calculates both sine and cosine of an angle with a single table lookup
+ * @param  angle : Angle [rad], any range. NaN and infinity give NaN.
+ * @param  sinValue : Destination of sin(angle)
+ * @param  cosValue : Destination of cos(angle)
+ * @retval None
+ */
+static inline void FastSinCos(const float32_t angle, float32_t* sinValue, float32_t* cosValue) {
+    float32_t reducedAngle = angle;
+    float32_t findex;
+    int32_t index;
+    int32_t cosIndex;
+    float32_t fract;
+
+    /* The cast to int32_t below is undefined for NaN and for angles beyond the int32_t range of the index */
+    if (!(fabsf(angle) < SIN_TABLE_REDUCE_ANGLE)) {
+        if (isnan(angle) || isinf(angle)) {
+            *sinValue = NAN;
+            *cosValue = NAN;
+            return;
+        }
+        reducedAngle = fmodf(angle, 2.0f*PI);
+    }
+
+    findex = reducedAngle * ((float32_t) SIN_TABLE_SIZE / (2.0f*PI));
+    index = (int32_t) findex;
+
+    /* Round towards minus infinity so that the fraction is always positive */
+    if (findex < 0.0f)
+        index--;
+    fract = findex - (float32_t) index;
+
+    /* Wrap to one period, cos(x) = sin(x + pi/2) which is a quarter of the table */
+    index &= SIN_TABLE_SIZE - 1;
+    cosIndex = (index + SIN_TABLE_SIZE/4) & (SIN_TABLE_SIZE - 1);
+
+    *sinValue = SinTable[index] + fract*(SinTable[index + 1] - SinTable[index]);
+    *cosValue = SinTable[cosIndex] + fract*(SinTable[cosIndex + 1] - SinTable[cosIndex]);
+}
+
+/*
+ * @brief  Calculates the sine of an angle by table lookup
+ * @param  angle : Angle [rad], any range
+ * @retval sin(angle)
+ */
+static inline float32_t FastSin(const float32_t angle) {
+    float32_t sinValue, cosValue;
+
+    FastSinCos(angle, &sinValue, &cosValue);
+    return sinValue;
+}
+
+/*
+ * @brief  Calculates the cosine of an angle by table lookup
+ * @param  angle : Angle [rad], any range
+ * @retval cos(angle)
+ */
+static inline float32_t FastCos(const float32_t angle) {
+    float32_t sinValue, cosValue;
+
+    FastSinCos(angle, &sinValue, &cosValue);
+    return cosValue;
+}
+
+/*
+ * @brief  Calculates the altitude from pressure with the barometric formula 44330*(1-(p/101325)^(1/5.255))
+ *         by table lookup
+ * @param  pressure : Pressure [Pa], values outside the table range are saturated
+ * @retval Altitude above sea level [m]
+ */
+static inline float32_t PressureToAltitude(const int32_t pressure) {
+    const int32_t offset = pressure - PRESSURE_TABLE_MIN;
+    int32_t index;
+    float32_t fract;
+
+    if (offset <= 0)
+        return PressureAltitudeTable[0];
+
+    index = offset >> PRESSURE_TABLE_STEP_SHIFT;
+    if (index >= PRESSURE_TABLE_SIZE - 1)
+        return PressureAltitudeTable[PRESSURE_TABLE_SIZE - 1];
+
+    fract = (float32_t) (offset & ((1 << PRESSURE_TABLE_STEP_SHIFT) - 1)) * (1.0f / (1 << PRESSURE_TABLE_STEP_SHIFT));
+    return PressureAltitudeTable[index] + fract*(PressureAltitudeTable[index + 1] - PressureAltitudeTable[index]);
+}
+
+#endif /* __MATH_TABLES_H */
+
+/**
+ * @}
+ */
+
+/**
+ * @}
+ */
+/*****END OF FILE****/
@@ -13,8 +13,21 @@
 
 #include <arm_math.h>
 
+// Observation summary of the samples added since the last calibration
+typedef struct {
+	float32_t mu[3];
+	float32_t mu2[3];
+	float32_t ipXX[6];
+	float32_t ipX2X[3][3];
+	float32_t ipX2X2[6];
+	int32_t N;
+	float32_t obsMin[3];
+	float32_t obsMax[3];
+} SphereObservations_t;
 
 void addNewSample(const float32_t samples[3]);
 void calibrate(float32_t calibParams[6]);
+void saveObservations(SphereObservations_t* observations);
+void restoreObservations(const SphereObservations_t* observations);
 
 #endif /* __SPHERE_CALIBRATION_H */
@@ -9,14 +9,17 @@
 #ifndef TASK_STATUS_H
 #define TASK_STATUS_H
 
+/* Includes ------------------------------------------------------------------*/
+#include "irq_priorities.h"
+
 /* Exported constants --------------------------------------------------------*/
 #define TASK_STATUS_TIM	                    TIM15
 #define TASK_STATUS_TIM_CLK_ENABLE()        __TIM15_CLK_ENABLE()
 #define	TASK_STATUS_TIM_CLK_DISABLE()       __TIM15_CLK_DISABLE()
 #define TASK_STATUS_TIM_IRQn	            TIM15_IRQn
 #define TASK_STATUS_TIM_IRQHandler	        TIM15_IRQHandler
-#define TASK_STATUS_TIM_IRQ_PREEMPT_PRIO    0
-#define TASK_STATUS_TIM_IRQ_SUB_PRIO        0
+#define TASK_STATUS_TIM_IRQ_PREEMPT_PRIO    IRQ_PRIO_TASK_STATUS_TIM
+#define TASK_STATUS_TIM_IRQ_SUB_PRIO        IRQ_SUB_PRIO
 
 /* Exported variables --------------------------------------------------------*/
 TIM_HandleTypeDef    TaskStatusTimHandle;
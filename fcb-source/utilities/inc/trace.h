@@ -1,6 +1,8 @@
 #ifndef TRACE_H
 #define TRACE_H
 
+#include "build_profile.h"
+
 #define TRACE_SYNC(__FMT__, ...) do { trace_post(__FMT__ "\n", __VA_ARGS__);  }while(0)
 
 /**
@@ -22,7 +24,14 @@ int trace_init(void);
  *
  * @return zero for successful post to queue.
  */
+#if FCB_USE_TRACE
 int trace_post(const char * fmt, ...);
+#else
+static inline int trace_post(const char * fmt, ...) {
+    (void) fmt;
+    return 0;
+}
+#endif
 
 /**
  * This function enables debug printing in the console. The function works the same way as printf().
@@ -30,7 +39,14 @@ int trace_post(const char * fmt, ...);
  * @param format: printf format string and any number of non-string arguments
  * @return ret: size of the string in byte
  */
+#if FCB_USE_TRACE
 int trace_printf(const char* format, ...);
+#else
+static inline int trace_printf(const char* format, ...) {
+    (void) format;
+    return 0;
+}
+#endif
 
 
 /**
@@ -0,0 +1,55 @@
+/******************************************************************************
+ * @file    tx_ring_buffer.h
+ * @author  Dragonfly
+ * @version v. 1.0.0
+ * @date    2016-06-01
+ * @brief   Header file for transmit ring buffers drained by chained DMA spans
+ ******************************************************************************/
+
+#ifndef __TX_RING_BUFFER_H
+#define __TX_RING_BUFFER_H
+
+/* Includes -----------------------------------------------------------------*/
+#include <stdint.h>
+#include <stdbool.h>
+
+/* Exported constants --------------------------------------------------------*/
+
+/* Exported types ------------------------------------------------------------*/
+
+/* Transmit ring buffer. Producers append at head, the bytes from tail are sent in contiguous spans, one at a time.
+ * The span in progress is released when it has been sent, so producers never overwrite bytes being sent. */
+typedef struct {
+    uint8_t* bufferArray;           // Buffer storage array
+    uint16_t bufferSize;            // Buffer storage array size, one byte is kept free to tell full from empty
+    volatile uint16_t head;         // Index for the next byte to be appended
+    volatile uint16_t tail;         // Index for the first byte not yet sent
+    volatile uint16_t spanSize;     // Bytes in the span in progress, 0 if idle
+    uint16_t maxUsed;               // Most bytes buffered at once
+    uint32_t sentBytes;
+    uint32_t spans;                 // Spans started
+    uint32_t droppedWrites;         // Writes dropped because the buffer was full
+    uint32_t droppedBytes;
+} TxRingBuffer_TypeDef;
+
+/* Exported macro ------------------------------------------------------------*/
+
+/* Exported function prototypes --------------------------------------------- */
+void TxRingBufferInit(TxRingBuffer_TypeDef* buffer, uint8_t* bufferDataArray, const uint16_t bufferDataArraySize);
+bool TxRingBufferPut(TxRingBuffer_TypeDef* buffer, const uint8_t* putDataPtr, const uint16_t putDataSize);
+uint16_t TxRingBufferGetFree(const TxRingBuffer_TypeDef* buffer);
+bool TxRingBufferStartSpan(TxRingBuffer_TypeDef* buffer, uint8_t** spanDataPtr, uint16_t* spanDataSize);
+void TxRingBufferCompleteSpan(TxRingBuffer_TypeDef* buffer);
+void TxRingBufferAbortSpan(TxRingBuffer_TypeDef* buffer, const uint16_t sentSize);
+bool TxRingBufferIsIdle(const TxRingBuffer_TypeDef* buffer);
+
+#endif /* __TX_RING_BUFFER_H */
+
+/**
+ * @}
+ */
+
+/**
+ * @}
+ */
+/*****END OF FILE****/
@@ -0,0 +1,327 @@
+/******************************************************************************
+ * @file    vector_math.h
+ * @author  Dragonfly
+ * @version v. 1.0.0
+ * @date    2016-06-01
+ * @brief   Header-only library for fixed-size 3D vector, 3x3 matrix and
+ *          quaternion operations.
+ *
+ *          All functions are unrolled static inline functions, which avoids
+ *          the instance structs, size checks and loops of the generic
+ *          CMSIS-DSP arm_mat_* functions for 3x3 data.
+ *
+ *          Conventions:
+ *          - Vectors are float32_t[3]
+ *          - Matrices are float32_t[9] stored in row-major order
+ *          - Quaternions are float32_t[4] as q = q0 + q1*i + q2*j + q3*k
+ *
+ *          The destination may be the same array as any of the sources.
+ *
+ *          Cost: "kernel-benchmark r" prints the cycle counts on target and
+ *          tests/kernel_benchmark_host.c the relative cost on the host.
+ ******************************************************************************/
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __VECTOR_MATH_H
+#define __VECTOR_MATH_H
+
+/* Includes ------------------------------------------------------------------*/
+#include "arm_math.h"
+#include "math_tables.h"
+
+#include <math.h>
+
+/* Exported constants --------------------------------------------------------*/
+/* Exported types ------------------------------------------------------------*/
+/* Exported macro ------------------------------------------------------------*/
+
+/* Exported functions ------------------------------------------------------- */
+
+/*
+ * @brief  Copies a 3D vector
+ * @param  dst : Destination vector
+ * @param  src : Source vector
+ * @retval None
+ */
+static inline void Vec3Copy(float32_t* dst, const float32_t* src) {
+    dst[0] = src[0];
+    dst[1] = src[1];
+    dst[2] = src[2];
+}
+
+/*
+ * @brief  Calculates the dot product of two 3D vectors
+ * @param  a : Vector a
+ * @param  b : Vector b
+ * @retval a.b
+ */
+static inline float32_t Vec3Dot(const float32_t* a, const float32_t* b) {
+    return a[0]*b[0] + a[1]*b[1] + a[2]*b[2];
+}
+
+/*
+ * @brief  Calculates the cross product of two 3D vectors
+ * @param  dst : Destination vector, a x b
+ * @param  a : Vector a
+ * @param  b : Vector b
+ * @retval None
+ */
+static inline void Vec3Cross(float32_t* dst, const float32_t* a, const float32_t* b) {
+    const float32_t x = a[1]*b[2] - a[2]*b[1];
+    const float32_t y = a[2]*b[0] - a[0]*b[2];
+    const float32_t z = a[0]*b[1] - a[1]*b[0];
+
+    dst[0] = x;
+    dst[1] = y;
+    dst[2] = z;
+}
+
+/*
+ * @brief  Scales a 3D vector
+ * @param  dst : Destination vector
+ * @param  src : Source vector
+ * @param  scale : Scale factor
+ * @retval None
+ */
+static inline void Vec3Scale(float32_t* dst, const float32_t* src, const float32_t scale) {
+    dst[0] = src[0]*scale;
+    dst[1] = src[1]*scale;
+    dst[2] = src[2]*scale;
+}
+
+/*
+ * @brief  Calculates the euclidean norm (length) of a 3D vector
+ * @param  src : Source vector
+ * @retval |src|
+ */
+static inline float32_t Vec3Norm(const float32_t* src) {
+    return sqrtf(Vec3Dot(src, src));
+}
+
+/*
+ * @brief  Normalizes a 3D vector to unit length
+ * @param  dst : Destination vector
+ * @param  src : Source vector (must not be the zero vector)
+ * @retval None
+ */
+static inline void Vec3Normalize(float32_t* dst, const float32_t* src) {
+    Vec3Scale(dst, src, 1.0f/Vec3Norm(src));
+}
+
+/*
+ * @brief  Sets a 3x3 matrix to the identity matrix
+ * @param  dst : Destination matrix
+ * @retval None
+ */
+static inline void Mat3Identity(float32_t* dst) {
+    dst[0] = 1.0f; dst[1] = 0.0f; dst[2] = 0.0f;
+    dst[3] = 0.0f; dst[4] = 1.0f; dst[5] = 0.0f;
+    dst[6] = 0.0f; dst[7] = 0.0f; dst[8] = 1.0f;
+}
+
+/*
+ * @brief  Transposes a 3x3 matrix
+ * @param  dst : Destination matrix, M^T
+ * @param  m : Source matrix M
+ * @retval None
+ */
+static inline void Mat3Transpose(float32_t* dst, const float32_t* m) {
+    float32_t tmp;
+
+    dst[0] = m[0];
+    dst[4] = m[4];
+    dst[8] = m[8];
+    tmp = m[1]; dst[1] = m[3]; dst[3] = tmp;
+    tmp = m[2]; dst[2] = m[6]; dst[6] = tmp;
+    tmp = m[5]; dst[5] = m[7]; dst[7] = tmp;
+}
+
+/*
+ * @brief  Multiplies a 3x3 matrix with a 3D vector
+ * @param  dst : Destination vector, M*v
+ * @param  m : Matrix M
+ * @param  v : Vector v
+ * @retval None
+ */
+static inline void Mat3MultVec3(float32_t* dst, const float32_t* m, const float32_t* v) {
+    const float32_t x = m[0]*v[0] + m[1]*v[1] + m[2]*v[2];
+    const float32_t y = m[3]*v[0] + m[4]*v[1] + m[5]*v[2];
+    const float32_t z = m[6]*v[0] + m[7]*v[1] + m[8]*v[2];
+
+    dst[0] = x;
+    dst[1] = y;
+    dst[2] = z;
+}
+
+/*
+ * @brief  Multiplies the transpose of a 3x3 matrix with a 3D vector, without forming the transpose. For a rotation
+ *         matrix this is the inverse rotation.
+ * @param  dst : Destination vector, M^T*v
+ * @param  m : Matrix M
+ * @param  v : Vector v
+ * @retval None
+ */
+static inline void Mat3TransMultVec3(float32_t* dst, const float32_t* m, const float32_t* v) {
+    const float32_t x = m[0]*v[0] + m[3]*v[1] + m[6]*v[2];
+    const float32_t y = m[1]*v[0] + m[4]*v[1] + m[7]*v[2];
+    const float32_t z = m[2]*v[0] + m[5]*v[1] + m[8]*v[2];
+
+    dst[0] = x;
+    dst[1] = y;
+    dst[2] = z;
+}
+
+/*
+ * @brief  Multiplies two 3x3 matrices
+ * @param  dst : Destination matrix, A*B
+ * @param  a : Matrix A
+ * @param  b : Matrix B
+ * @retval None
+ */
+static inline void Mat3Mult(float32_t* dst, const float32_t* a, const float32_t* b) {
+    float32_t tmp[9];
+
+    tmp[0] = a[0]*b[0] + a[1]*b[3] + a[2]*b[6];
+    tmp[1] = a[0]*b[1] + a[1]*b[4] + a[2]*b[7];
+    tmp[2] = a[0]*b[2] + a[1]*b[5] + a[2]*b[8];
+    tmp[3] = a[3]*b[0] + a[4]*b[3] + a[5]*b[6];
+    tmp[4] = a[3]*b[1] + a[4]*b[4] + a[5]*b[7];
+    tmp[5] = a[3]*b[2] + a[4]*b[5] + a[5]*b[8];
+    tmp[6] = a[6]*b[0] + a[7]*b[3] + a[8]*b[6];
+    tmp[7] = a[6]*b[1] + a[7]*b[4] + a[8]*b[7];
+    tmp[8] = a[6]*b[2] + a[7]*b[5] + a[8]*b[8];
+
+    dst[0] = tmp[0]; dst[1] = tmp[1]; dst[2] = tmp[2];
+    dst[3] = tmp[3]; dst[4] = tmp[4]; dst[5] = tmp[5];
+    dst[6] = tmp[6]; dst[7] = tmp[7]; dst[8] = tmp[8];
+}
+
+/*
+ * @brief  Sets a quaternion to the identity (no rotation) quaternion
+ * @param  dst : Destination quaternion
+ * @retval None
+ */
+static inline void QuatIdentity(float32_t* dst) {
+    dst[0] = 1.0f;
+    dst[1] = 0.0f;
+    dst[2] = 0.0f;
+    dst[3] = 0.0f;
+}
+
+/*
+ * @brief  Calculates the conjugate of a quaternion, which is the inverse rotation of a unit quaternion
+ * @param  dst : Destination quaternion
+ * @param  q : Source quaternion
+ * @retval None
+ */
+static inline void QuatConjugate(float32_t* dst, const float32_t* q) {
+    dst[0] = q[0];
+    dst[1] = -q[1];
+    dst[2] = -q[2];
+    dst[3] = -q[3];
+}
+
+/*
+ * @brief  Normalizes a quaternion to unit length
+ * @param  dst : Destination quaternion
+ * @param  q : Source quaternion (must not be zero)
+ * @retval None
+ */
+static inline void QuatNormalize(float32_t* dst, const float32_t* q) {
+    const float32_t invNorm = 1.0f/sqrtf(q[0]*q[0] + q[1]*q[1] + q[2]*q[2] + q[3]*q[3]);
+
+    dst[0] = q[0]*invNorm;
+    dst[1] = q[1]*invNorm;
+    dst[2] = q[2]*invNorm;
+    dst[3] = q[3]*invNorm;
+}
+
+/*
+ * @brief  Composes two rotations by calculating the Hamilton product p*q. The resulting rotation is q followed by p.
+ * @param  dst : Destination quaternion, p*q
+ * @param  p : Quaternion p
+ * @param  q : Quaternion q
+ * @retval None
+ */
+static inline void QuatMult(float32_t* dst, const float32_t* p, const float32_t* q) {
+    const float32_t q0 = p[0]*q[0] - p[1]*q[1] - p[2]*q[2] - p[3]*q[3];
+    const float32_t q1 = p[0]*q[1] + p[1]*q[0] + p[2]*q[3] - p[3]*q[2];
+    const float32_t q2 = p[0]*q[2] - p[1]*q[3] + p[2]*q[0] + p[3]*q[1];
+    const float32_t q3 = p[0]*q[3] + p[1]*q[2] - p[2]*q[1] + p[3]*q[0];
+
+    dst[0] = q0;
+    dst[1] = q1;
+    dst[2] = q2;
+    dst[3] = q3;
+}
+
+/*
+ * @brief  Creates the unit quaternion for a rotation around an axis
+ * @param  dst : Destination quaternion
+ * @param  axis : Unit length rotation axis
+ * @param  angle : Rotation angle [rad]
+ * @retval None
+ */
+static inline void QuatFromAxisAngle(float32_t* dst, const float32_t* axis, const float32_t angle) {
+    float32_t sinHalfAngle, cosHalfAngle;
+
+    FastSinCos(0.5f*angle, &sinHalfAngle, &cosHalfAngle);
+    dst[0] = cosHalfAngle;
+    dst[1] = axis[0]*sinHalfAngle;
+    dst[2] = axis[1]*sinHalfAngle;
+    dst[3] = axis[2]*sinHalfAngle;
+}
+
+/*
+ * @brief  Rotates a 3D vector with a unit quaternion, v' = q*v*q^-1, without forming the rotation matrix
+ * @param  dst : Destination vector
+ * @param  q : Unit quaternion
+ * @param  v : Source vector
+ * @retval None
+ */
+static inline void QuatRotateVec3(float32_t* dst, const float32_t* q, const float32_t* v) {
+    /* t = 2*(q_v x v), v' = v + q0*t + q_v x t */
+    const float32_t tx = 2.0f*(q[2]*v[2] - q[3]*v[1]);
+    const float32_t ty = 2.0f*(q[3]*v[0] - q[1]*v[2]);
+    const float32_t tz = 2.0f*(q[1]*v[1] - q[2]*v[0]);
+    const float32_t x = v[0] + q[0]*tx + q[2]*tz - q[3]*ty;
+    const float32_t y = v[1] + q[0]*ty + q[3]*tx - q[1]*tz;
+    const float32_t z = v[2] + q[0]*tz + q[1]*ty - q[2]*tx;
+
+    dst[0] = x;
+    dst[1] = y;
+    dst[2] = z;
+}
+
+/*
+ * @brief  Converts a unit quaternion to the equivalent rotation matrix, such that M*v = q*v*q^-1
+ * @param  dst : Destination matrix
+ * @param  q : Unit quaternion
+ * @retval None
+ */
+static inline void QuatToMat3(float32_t* dst, const float32_t* q) {
+    const float32_t q00 = q[0]*q[0], q11 = q[1]*q[1], q22 = q[2]*q[2], q33 = q[3]*q[3];
+    const float32_t q01 = q[0]*q[1], q02 = q[0]*q[2], q03 = q[0]*q[3];
+    const float32_t q12 = q[1]*q[2], q13 = q[1]*q[3], q23 = q[2]*q[3];
+
+    dst[0] = q00 + q11 - q22 - q33;
+    dst[1] = 2.0f*(q12 - q03);
+    dst[2] = 2.0f*(q13 + q02);
+    dst[3] = 2.0f*(q12 + q03);
+    dst[4] = q00 - q11 + q22 - q33;
+    dst[5] = 2.0f*(q23 - q01);
+    dst[6] = 2.0f*(q13 - q02);
+    dst[7] = 2.0f*(q23 + q01);
+    dst[8] = q00 - q11 - q22 + q33;
+}
+
+#endif /* __VECTOR_MATH_H */
+
+/**
+ * @}
+ */
+
+/**
+ * @}
+ */
+/*****END OF FILE****/
@@ -9,6 +9,7 @@
 /* Includes ------------------------------------------------------------------*/
 #include "common.h"
 #include "fcb_error.h"
+#include "irq_priorities.h"
 
 #include "stm32f3_discovery.h"
 
@@ -83,7 +84,7 @@ void ConfigPVD(void) {
 	__PWR_CLK_ENABLE();
 
 	/*##-2- Configure the NVIC for PVD #########################################*/
-	HAL_NVIC_SetPriority(PVD_IRQn, 0, 0);
+	HAL_NVIC_SetPriority(PVD_IRQn, IRQ_PRIO_PVD, IRQ_SUB_PRIO);
 	HAL_NVIC_EnableIRQ(PVD_IRQn);
 
 	/* Configure the PVD level to and generate an interrupt on falling
@@ -23,6 +23,11 @@
 /* Includes ------------------------------------------------------------------*/
 #include "flash.h"
 #include "common.h"
+#include "slack_monitor.h"
+
+#include "FreeRTOS.h"
+#include "task.h"
+
 #include <string.h>
 
 /* Private typedef -----------------------------------------------------------*/
@@ -36,12 +41,16 @@
 #define IS_VALID_PAGE_OFFSET_SIZE(OFFSET,SIZE)	(((OFFSET) + (SIZE)) <= FLASH_PAGE_SIZE)
 
 /* Private variables ---------------------------------------------------------*/
+static uint8_t tmpPage[FLASH_PAGE_SIZE]; // Declared as static so stack/RTOS stack is not loaded with this
 
 /* Private function prototypes -----------------------------------------------*/
 static FlashErrorStatus WriteSettingsToFlash(const uint8_t* writeSettingsData, const uint16_t writeSettingsDataSize,
 		const uint8_t settingsPageNbr, const uint16_t settingsPageOffset);
 static FlashErrorStatus ReadSettingsFromFlash(uint8_t* readSettingsData, const uint16_t readSettingsDataSize,
 		const uint8_t settingsPageNbr, const uint16_t settingsPageOffset);
+static FlashErrorStatus InsertSettingsInPage(uint8_t* page, const uint8_t* settingsData, const uint16_t settingsDataSize,
+		const uint16_t settingsPageOffset);
+static FlashErrorStatus WaitForFlashWriteSlack(void);
 
 static FlashErrorStatus WriteFlashPage(const uint32_t* writeData,
 		const uint8_t pageNbr);
@@ -155,6 +164,11 @@ FlashErrorStatus ReadAccCalibrationValuesFromFlash(float32_t accCalibrationValue
 	status = ReadSettingsFromFlash((uint8_t*) accCalibrationValues, FLASH_ACC_CALIBRATION_SIZE,
 			FLASH_ACC_CALIBRATION_PAGE, FLASH_ACC_CALIBRATION_DATA_OFFSET);
 
+	/* Values saved by earlier firmware are still found at the old offset until the calibration is written again */
+	if (status != FLASH_OK)
+		status = ReadSettingsFromFlash((uint8_t*) accCalibrationValues, FLASH_ACC_CALIBRATION_SIZE,
+				FLASH_ACC_CALIBRATION_PAGE, FLASH_ACC_CALIBRATION_LEGACY_OFFSET);
+
 	return status;
 }
 
@@ -173,6 +187,67 @@ FlashErrorStatus WriteAccCalibrationValuesToFlash(const float32_t accCalibration
 	return status;
 }
 
+/*
+ * @brief  Reads all previously stored settings from flash memory
+ * @param  settings : Pointer to settings struct to which values will enter, validMask is set to the settings found
+ * @retval FLASH_OK if any settings read succesfully from flash, else FLASH_ERROR
+ */
+FlashErrorStatus ReadAllSettingsFromFlash(FlashSettings_TypeDef* settings) {
+	settings->validMask = 0;
+
+	if (ReadCalibrationValuesFromFlash(&settings->receiverCalibration))
+		settings->validMask |= FLASH_SETTINGS_RECEIVER_CALIBRATION;
+	if (ReadReferenceMaxLimitsFromFlash(&settings->referenceMaxLimits))
+		settings->validMask |= FLASH_SETTINGS_REFERENCE_MAX_LIMITS;
+	if (ReadMagCalibrationValuesFromFlash(settings->magCalibration))
+		settings->validMask |= FLASH_SETTINGS_MAG_CALIBRATION;
+	if (ReadAccCalibrationValuesFromFlash(settings->accCalibration))
+		settings->validMask |= FLASH_SETTINGS_ACC_CALIBRATION;
+
+	return (settings->validMask != 0) ? FLASH_OK : FLASH_ERROR;
+}
+
+/*
+ * @brief  Writes the settings in validMask to flash memory with a single page erase and program. Settings not in
+ *         validMask keep their stored values.
+ * @param  settings : Pointer to settings struct to be saved
+ * @retval FLASH_OK if settings written succesfully to flash, else FLASH_ERROR
+ */
+FlashErrorStatus WriteAllSettingsToFlash(const FlashSettings_TypeDef* settings) {
+	FlashErrorStatus status = FLASH_OK;
+
+	/* One page operation is only possible as long as all settings are stored on the same page */
+	if (FLASH_REFERENCE_MAX_LIMITS_PAGE != FLASH_RECEIVER_CALIBRATION_PAGE
+			|| FLASH_MAG_CALIBRATION_PAGE != FLASH_RECEIVER_CALIBRATION_PAGE
+			|| FLASH_ACC_CALIBRATION_PAGE != FLASH_RECEIVER_CALIBRATION_PAGE)
+		return FLASH_ERROR;
+
+	if (!WaitForFlashWriteSlack())
+		return FLASH_ERROR;
+
+	memset(tmpPage, 0x00, sizeof(tmpPage));
+	if (!ReadFlashPage(tmpPage, FLASH_RECEIVER_CALIBRATION_PAGE))
+		return FLASH_ERROR;
+
+	if (status && (settings->validMask & FLASH_SETTINGS_RECEIVER_CALIBRATION))
+		status = InsertSettingsInPage(tmpPage, (const uint8_t*) &settings->receiverCalibration,
+				sizeof(Receiver_CalibrationValues_TypeDef), FLASH_RECEIVER_CALIBRATION_DATA_OFFSET);
+	if (status && (settings->validMask & FLASH_SETTINGS_REFERENCE_MAX_LIMITS))
+		status = InsertSettingsInPage(tmpPage, (const uint8_t*) &settings->referenceMaxLimits,
+				sizeof(RefSignals_TypeDef), FLASH_REFERENCE_MAX_LIMITS_DATA_OFFSET);
+	if (status && (settings->validMask & FLASH_SETTINGS_MAG_CALIBRATION))
+		status = InsertSettingsInPage(tmpPage, (const uint8_t*) settings->magCalibration,
+				FLASH_MAG_CALIBRATION_SIZE, FLASH_MAG_CALIBRATION_DATA_OFFSET);
+	if (status && (settings->validMask & FLASH_SETTINGS_ACC_CALIBRATION))
+		status = InsertSettingsInPage(tmpPage, (const uint8_t*) settings->accCalibration,
+				FLASH_ACC_CALIBRATION_SIZE, FLASH_ACC_CALIBRATION_DATA_OFFSET);
+
+	if (status)
+		status = WriteFlashPage((uint32_t*) tmpPage, FLASH_RECEIVER_CALIBRATION_PAGE);
+
+	return status;
+}
+
 /* Private functions ---------------------------------------------------------*/
 
 /*
@@ -189,26 +264,66 @@ static FlashErrorStatus WriteSettingsToFlash(const uint8_t* writeSettingsData, c
 			|| !IS_VALID_PAGE_OFFSET_SIZE(settingsPageOffset, writeSettingsDataSize + FLASH_WORD_BYTE_SIZE))
 		return FLASH_ERROR;
 
+	if (!WaitForFlashWriteSlack())
+		return FLASH_ERROR;
+
 	/* Read the whole page and store it in tmpPage - required since when writing a page, its entire contents must first be erased */
-	static uint8_t tmpPage[FLASH_PAGE_SIZE]; // Declared as static so stack/RTOS stack is not loaded with this
 	memset(tmpPage, 0x00, sizeof(tmpPage));
 	if (!ReadFlashPage(tmpPage, settingsPageNbr))
 		return FLASH_ERROR;
 
-	/* Copy data to tmpPage at offset+1 location (CRC stored at first index) */
-	memcpy(&tmpPage[settingsPageOffset + FLASH_WORD_BYTE_SIZE], writeSettingsData,
-			writeSettingsDataSize);
+	if (!InsertSettingsInPage(tmpPage, writeSettingsData, writeSettingsDataSize, settingsPageOffset))
+		return FLASH_ERROR;
 
-	/* Take the CRC of the data to be inserted into flash storage, except for the first index which is reserved for the CRC itself */
-	uint32_t crcValue = CalculateCRC(&tmpPage[settingsPageOffset + FLASH_WORD_BYTE_SIZE],
-			writeSettingsDataSize);
-	memcpy(&tmpPage[settingsPageOffset], (uint8_t*) &crcValue, FLASH_WORD_BYTE_SIZE);
 	if (!WriteFlashPage((uint32_t*) tmpPage, settingsPageNbr))
 		return FLASH_ERROR;
 
 	return FLASH_OK;
 }
 
+/*
+ * @brief  Copies settings into a page image, preceded by the CRC of the settings
+ * @param  page : Page image of FLASH_PAGE_SIZE bytes
+ * @param  settingsData : uint8_t pointer to settings to be saved
+ * @param  settingsDataSize : settingsData byte size
+ * @param  settingsPageOffset : Byte offset of the CRC from the page base, the settings follow the CRC
+ * @retval FLASH_OK if the settings fit on the page, else FLASH_ERROR
+ */
+static FlashErrorStatus InsertSettingsInPage(uint8_t* page, const uint8_t* settingsData, const uint16_t settingsDataSize,
+		const uint16_t settingsPageOffset) {
+	if (!IS_VALID_PAGE_OFFSET_SIZE(settingsPageOffset, settingsDataSize + FLASH_WORD_BYTE_SIZE))
+		return FLASH_ERROR;
+
+	/* Copy data to the page at offset+1 location (CRC stored at first index) */
+	memcpy(&page[settingsPageOffset + FLASH_WORD_BYTE_SIZE], settingsData, settingsDataSize);
+
+	/* Take the CRC of the data to be inserted into flash storage, except for the first index which is reserved for the CRC itself */
+	uint32_t crcValue = CalculateCRC(&page[settingsPageOffset + FLASH_WORD_BYTE_SIZE], settingsDataSize);
+	memcpy(&page[settingsPageOffset], (uint8_t*) &crcValue, FLASH_WORD_BYTE_SIZE);
+
+	return FLASH_OK;
+}
+
+/*
+ * @brief  Waits until the slack monitor allows flash work. The CPU stalls on flash erase and program, so writes are
+ *         deferred while the control loop is short of headroom.
+ * @param  None
+ * @retval FLASH_OK if the write may proceed, FLASH_ERROR if it was deferred for longer than SLACK_MAX_FLASH_DEFER_MS
+ */
+static FlashErrorStatus WaitForFlashWriteSlack(void) {
+	if (!IsSlackWorkDue(SLACK_WORK_FLASH, 0)) {
+		uint32_t deferredMs = 0;
+		do {
+			if (deferredMs >= SLACK_MAX_FLASH_DEFER_MS)
+				return FLASH_ERROR;
+			vTaskDelay(SLACK_FLASH_DEFER_POLL_MS / portTICK_RATE_MS);
+			deferredMs += SLACK_FLASH_DEFER_POLL_MS;
+		} while (0 == GetSlackRateDivider(SLACK_WORK_FLASH));
+	}
+
+	return FLASH_OK;
+}
+
 /*
  * @brief  Reads previously stored receiver calibration values from flash memory
  * @param  receiverCalibrationValues : Pointer to receiver calibration values struct to which values will enter
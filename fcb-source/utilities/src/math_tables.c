@@ -0,0 +1,167 @@
+/******************************************************************************
+ * @file    math_tables.c
+ * @author  Dragonfly
+ * @brief   Lookup tables for math_tables.h
+ *
+ *          GENERATED FILE, DO NOT EDIT. Generated by tools/gen_math_tables.py
+ *          sin/cos max interpolation error: 1.89e-05
+ *          Altitude max interpolation error: 0.049 m
+ ******************************************************************************/
+
+/* Includes ------------------------------------------------------------------*/
+#include "math_tables.h"
+
+#if SIN_TABLE_SIZE != 512 || PRESSURE_TABLE_MIN != 30000 || PRESSURE_TABLE_STEP_SHIFT != 8 || PRESSURE_TABLE_SIZE != 314
+#error "math_tables.c does not match math_tables.h, rerun tools/gen_math_tables.py"
+#endif
+
+/* Exported variables --------------------------------------------------------*/
+
+/* sin(2*pi*i/SIN_TABLE_SIZE), i = 0..SIN_TABLE_SIZE */
+const float32_t SinTable[SIN_TABLE_SIZE + 1] = {
+        0.000000000e+00f, 1.227153838e-02f, 2.454122901e-02f, 3.680722415e-02f, 4.906767607e-02f, 6.132073700e-02f,
+        7.356456667e-02f, 8.579730988e-02f, 9.801714122e-02f, 1.102222055e-01f, 1.224106774e-01f, 1.345807016e-01f,
+        1.467304677e-01f, 1.588581502e-01f, 1.709618866e-01f, 1.830398887e-01f, 1.950903237e-01f, 2.071113735e-01f,
+        2.191012353e-01f, 2.310581058e-01f, 2.429801822e-01f, 2.548656464e-01f, 2.667127550e-01f, 2.785196900e-01f,
+        2.902846634e-01f, 3.020059466e-01f, 3.136817515e-01f, 3.253102899e-01f, 3.368898630e-01f, 3.484186828e-01f,
+        3.598950505e-01f, 3.713172078e-01f, 3.826834261e-01f, 3.939920366e-01f, 4.052413106e-01f, 4.164295495e-01f,
+        4.275550842e-01f, 4.386162460e-01f, 4.496113360e-01f, 4.605387151e-01f, 4.713967443e-01f, 4.821837842e-01f,
+        4.928981960e-01f, 5.035383701e-01f, 5.141027570e-01f, 5.245896578e-01f, 5.349976420e-01f, 5.453249812e-01f,
+        5.555702448e-01f, 5.657318234e-01f, 5.758081675e-01f, 5.857978463e-01f, 5.956993103e-01f, 6.055110693e-01f,
+        6.152315736e-01f, 6.248595119e-01f, 6.343932748e-01f, 6.438315511e-01f, 6.531728506e-01f, 6.624158025e-01f,
+        6.715589762e-01f, 6.806010008e-01f, 6.895405650e-01f, 6.983762383e-01f, 7.071067691e-01f, 7.157308459e-01f,
+        7.242470980e-01f, 7.326542735e-01f, 7.409511209e-01f, 7.491363883e-01f, 7.572088242e-01f, 7.651672363e-01f,
+        7.730104327e-01f, 7.807372212e-01f, 7.883464098e-01f, 7.958369255e-01f, 8.032075167e-01f, 8.104571700e-01f,
+        8.175848126e-01f, 8.245893121e-01f, 8.314695954e-01f, 8.382247090e-01f, 8.448535800e-01f, 8.513551950e-01f,
+        8.577286005e-01f, 8.639728427e-01f, 8.700869679e-01f, 8.760700822e-01f, 8.819212914e-01f, 8.876396418e-01f,
+        8.932242990e-01f, 8.986744881e-01f, 9.039893150e-01f, 9.091680050e-01f, 9.142097831e-01f, 9.191138744e-01f,
+        9.238795042e-01f, 9.285060763e-01f, 9.329928160e-01f, 9.373390079e-01f, 9.415440559e-01f, 9.456073046e-01f,
+        9.495281577e-01f, 9.533060193e-01f, 9.569403529e-01f, 9.604305029e-01f, 9.637760520e-01f, 9.669764638e-01f,
+        9.700312614e-01f, 9.729399681e-01f, 9.757021070e-01f, 9.783173800e-01f, 9.807852507e-01f, 9.831054807e-01f,
+        9.852776527e-01f, 9.873014092e-01f, 9.891765118e-01f, 9.909026623e-01f, 9.924795628e-01f, 9.939069748e-01f,
+        9.951847196e-01f, 9.963126183e-01f, 9.972904325e-01f, 9.981181026e-01f, 9.987954497e-01f, 9.993223548e-01f,
+        9.996988177e-01f, 9.999247193e-01f, 1.000000000e+00f, 9.999247193e-01f, 9.996988177e-01f, 9.993223548e-01f,
+        9.987954497e-01f, 9.981181026e-01f, 9.972904325e-01f, 9.963126183e-01f, 9.951847196e-01f, 9.939069748e-01f,
+        9.924795628e-01f, 9.909026623e-01f, 9.891765118e-01f, 9.873014092e-01f, 9.852776527e-01f, 9.831054807e-01f,
+        9.807852507e-01f, 9.783173800e-01f, 9.757021070e-01f, 9.729399681e-01f, 9.700312614e-01f, 9.669764638e-01f,
+        9.637760520e-01f, 9.604305029e-01f, 9.569403529e-01f, 9.533060193e-01f, 9.495281577e-01f, 9.456073046e-01f,
+        9.415440559e-01f, 9.373390079e-01f, 9.329928160e-01f, 9.285060763e-01f, 9.238795042e-01f, 9.191138744e-01f,
+        9.142097831e-01f, 9.091680050e-01f, 9.039893150e-01f, 8.986744881e-01f, 8.932242990e-01f, 8.876396418e-01f,
+        8.819212914e-01f, 8.760700822e-01f, 8.700869679e-01f, 8.639728427e-01f, 8.577286005e-01f, 8.513551950e-01f,
+        8.448535800e-01f, 8.382247090e-01f, 8.314695954e-01f, 8.245893121e-01f, 8.175848126e-01f, 8.104571700e-01f,
+        8.032075167e-01f, 7.958369255e-01f, 7.883464098e-01f, 7.807372212e-01f, 7.730104327e-01f, 7.651672363e-01f,
+        7.572088242e-01f, 7.491363883e-01f, 7.409511209e-01f, 7.326542735e-01f, 7.242470980e-01f, 7.157308459e-01f,
+        7.071067691e-01f, 6.983762383e-01f, 6.895405650e-01f, 6.806010008e-01f, 6.715589762e-01f, 6.624158025e-01f,
+        6.531728506e-01f, 6.438315511e-01f, 6.343932748e-01f, 6.248595119e-01f, 6.152315736e-01f, 6.055110693e-01f,
+        5.956993103e-01f, 5.857978463e-01f, 5.758081675e-01f, 5.657318234e-01f, 5.555702448e-01f, 5.453249812e-01f,
+        5.349976420e-01f, 5.245896578e-01f, 5.141027570e-01f, 5.035383701e-01f, 4.928981960e-01f, 4.821837842e-01f,
+        4.713967443e-01f, 4.605387151e-01f, 4.496113360e-01f, 4.386162460e-01f, 4.275550842e-01f, 4.164295495e-01f,
+        4.052413106e-01f, 3.939920366e-01f, 3.826834261e-01f, 3.713172078e-01f, 3.598950505e-01f, 3.484186828e-01f,
+        3.368898630e-01f, 3.253102899e-01f, 3.136817515e-01f, 3.020059466e-01f, 2.902846634e-01f, 2.785196900e-01f,
+        2.667127550e-01f, 2.548656464e-01f, 2.429801822e-01f, 2.310581058e-01f, 2.191012353e-01f, 2.071113735e-01f,
+        1.950903237e-01f, 1.830398887e-01f, 1.709618866e-01f, 1.588581502e-01f, 1.467304677e-01f, 1.345807016e-01f,
+        1.224106774e-01f, 1.102222055e-01f, 9.801714122e-02f, 8.579730988e-02f, 7.356456667e-02f, 6.132073700e-02f,
+        4.906767607e-02f, 3.680722415e-02f, 2.454122901e-02f, 1.227153838e-02f, 1.224646853e-16f, -1.227153838e-02f,
+        -2.454122901e-02f, -3.680722415e-02f, -4.906767607e-02f, -6.132073700e-02f, -7.356456667e-02f, -8.579730988e-02f,
+        -9.801714122e-02f, -1.102222055e-01f, -1.224106774e-01f, -1.345807016e-01f, -1.467304677e-01f, -1.588581502e-01f,
+        -1.709618866e-01f, -1.830398887e-01f, -1.950903237e-01f, -2.071113735e-01f, -2.191012353e-01f, -2.310581058e-01f,
+        -2.429801822e-01f, -2.548656464e-01f, -2.667127550e-01f, -2.785196900e-01f, -2.902846634e-01f, -3.020059466e-01f,
+        -3.136817515e-01f, -3.253102899e-01f, -3.368898630e-01f, -3.484186828e-01f, -3.598950505e-01f, -3.713172078e-01f,
+        -3.826834261e-01f, -3.939920366e-01f, -4.052413106e-01f, -4.164295495e-01f, -4.275550842e-01f, -4.386162460e-01f,
+        -4.496113360e-01f, -4.605387151e-01f, -4.713967443e-01f, -4.821837842e-01f, -4.928981960e-01f, -5.035383701e-01f,
+        -5.141027570e-01f, -5.245896578e-01f, -5.349976420e-01f, -5.453249812e-01f, -5.555702448e-01f, -5.657318234e-01f,
+        -5.758081675e-01f, -5.857978463e-01f, -5.956993103e-01f, -6.055110693e-01f, -6.152315736e-01f, -6.248595119e-01f,
+        -6.343932748e-01f, -6.438315511e-01f, -6.531728506e-01f, -6.624158025e-01f, -6.715589762e-01f, -6.806010008e-01f,
+        -6.895405650e-01f, -6.983762383e-01f, -7.071067691e-01f, -7.157308459e-01f, -7.242470980e-01f, -7.326542735e-01f,
+        -7.409511209e-01f, -7.491363883e-01f, -7.572088242e-01f, -7.651672363e-01f, -7.730104327e-01f, -7.807372212e-01f,
+        -7.883464098e-01f, -7.958369255e-01f, -8.032075167e-01f, -8.104571700e-01f, -8.175848126e-01f, -8.245893121e-01f,
+        -8.314695954e-01f, -8.382247090e-01f, -8.448535800e-01f, -8.513551950e-01f, -8.577286005e-01f, -8.639728427e-01f,
+        -8.700869679e-01f, -8.760700822e-01f, -8.819212914e-01f, -8.876396418e-01f, -8.932242990e-01f, -8.986744881e-01f,
+        -9.039893150e-01f, -9.091680050e-01f, -9.142097831e-01f, -9.191138744e-01f, -9.238795042e-01f, -9.285060763e-01f,
+        -9.329928160e-01f, -9.373390079e-01f, -9.415440559e-01f, -9.456073046e-01f, -9.495281577e-01f, -9.533060193e-01f,
+        -9.569403529e-01f, -9.604305029e-01f, -9.637760520e-01f, -9.669764638e-01f, -9.700312614e-01f, -9.729399681e-01f,
+        -9.757021070e-01f, -9.783173800e-01f, -9.807852507e-01f, -9.831054807e-01f, -9.852776527e-01f, -9.873014092e-01f,
+        -9.891765118e-01f, -9.909026623e-01f, -9.924795628e-01f, -9.939069748e-01f, -9.951847196e-01f, -9.963126183e-01f,
+        -9.972904325e-01f, -9.981181026e-01f, -9.987954497e-01f, -9.993223548e-01f, -9.996988177e-01f, -9.999247193e-01f,
+        -1.000000000e+00f, -9.999247193e-01f, -9.996988177e-01f, -9.993223548e-01f, -9.987954497e-01f, -9.981181026e-01f,
+        -9.972904325e-01f, -9.963126183e-01f, -9.951847196e-01f, -9.939069748e-01f, -9.924795628e-01f, -9.909026623e-01f,
+        -9.891765118e-01f, -9.873014092e-01f, -9.852776527e-01f, -9.831054807e-01f, -9.807852507e-01f, -9.783173800e-01f,
+        -9.757021070e-01f, -9.729399681e-01f, -9.700312614e-01f, -9.669764638e-01f, -9.637760520e-01f, -9.604305029e-01f,
+        -9.569403529e-01f, -9.533060193e-01f, -9.495281577e-01f, -9.456073046e-01f, -9.415440559e-01f, -9.373390079e-01f,
+        -9.329928160e-01f, -9.285060763e-01f, -9.238795042e-01f, -9.191138744e-01f, -9.142097831e-01f, -9.091680050e-01f,
+        -9.039893150e-01f, -8.986744881e-01f, -8.932242990e-01f, -8.876396418e-01f, -8.819212914e-01f, -8.760700822e-01f,
+        -8.700869679e-01f, -8.639728427e-01f, -8.577286005e-01f, -8.513551950e-01f, -8.448535800e-01f, -8.382247090e-01f,
+        -8.314695954e-01f, -8.245893121e-01f, -8.175848126e-01f, -8.104571700e-01f, -8.032075167e-01f, -7.958369255e-01f,
+        -7.883464098e-01f, -7.807372212e-01f, -7.730104327e-01f, -7.651672363e-01f, -7.572088242e-01f, -7.491363883e-01f,
+        -7.409511209e-01f, -7.326542735e-01f, -7.242470980e-01f, -7.157308459e-01f, -7.071067691e-01f, -6.983762383e-01f,
+        -6.895405650e-01f, -6.806010008e-01f, -6.715589762e-01f, -6.624158025e-01f, -6.531728506e-01f, -6.438315511e-01f,
+        -6.343932748e-01f, -6.248595119e-01f, -6.152315736e-01f, -6.055110693e-01f, -5.956993103e-01f, -5.857978463e-01f,
+        -5.758081675e-01f, -5.657318234e-01f, -5.555702448e-01f, -5.453249812e-01f, -5.349976420e-01f, -5.245896578e-01f,
+        -5.141027570e-01f, -5.035383701e-01f, -4.928981960e-01f, -4.821837842e-01f, -4.713967443e-01f, -4.605387151e-01f,
+        -4.496113360e-01f, -4.386162460e-01f, -4.275550842e-01f, -4.164295495e-01f, -4.052413106e-01f, -3.939920366e-01f,
+        -3.826834261e-01f, -3.713172078e-01f, -3.598950505e-01f, -3.484186828e-01f, -3.368898630e-01f, -3.253102899e-01f,
+        -3.136817515e-01f, -3.020059466e-01f, -2.902846634e-01f, -2.785196900e-01f, -2.667127550e-01f, -2.548656464e-01f,
+        -2.429801822e-01f, -2.310581058e-01f, -2.191012353e-01f, -2.071113735e-01f, -1.950903237e-01f, -1.830398887e-01f,
+        -1.709618866e-01f, -1.588581502e-01f, -1.467304677e-01f, -1.345807016e-01f, -1.224106774e-01f, -1.102222055e-01f,
+        -9.801714122e-02f, -8.579730988e-02f, -7.356456667e-02f, -6.132073700e-02f, -4.906767607e-02f, -3.680722415e-02f,
+        -2.454122901e-02f, -1.227153838e-02f, -2.449293705e-16f,
+};
+
+/* Altitude [m] at pressure PRESSURE_TABLE_MIN + i*2^PRESSURE_TABLE_STEP_SHIFT [Pa] */
+const float32_t PressureAltitudeTable[PRESSURE_TABLE_SIZE] = {
+        9165.155273f, 9108.249023f, 9051.731445f, 8995.596680f, 8939.838867f, 8884.452148f,
+        8829.430664f, 8774.770508f, 8720.465820f, 8666.509766f, 8612.900391f, 8559.630859f,
+        8506.696289f, 8454.092773f, 8401.815430f, 8349.859375f, 8298.220703f, 8246.895508f,
+        8195.878906f, 8145.166504f, 8094.754883f, 8044.640137f, 7994.817871f, 7945.285156f,
+        7896.037109f, 7847.071289f, 7798.383301f, 7749.969727f, 7701.827148f, 7653.952637f,
+        7606.342285f, 7558.993164f, 7511.902344f, 7465.066406f, 7418.481934f, 7372.146484f,
+        7326.057129f, 7280.210449f, 7234.604004f, 7189.234863f, 7144.100098f, 7099.197754f,
+        7054.524414f, 7010.077637f, 6965.854980f, 6921.854004f, 6878.071777f, 6834.506836f,
+        6791.155762f, 6748.017090f, 6705.087891f, 6662.365723f, 6619.849121f, 6577.535645f,
+        6535.422852f, 6493.508789f, 6451.791016f, 6410.268555f, 6368.937988f, 6327.798340f,
+        6286.847168f, 6246.083008f, 6205.503418f, 6165.106934f, 6124.891113f, 6084.854980f,
+        6044.996582f, 6005.313965f, 5965.805176f, 5926.468750f, 5887.303223f, 5848.306152f,
+        5809.477051f, 5770.813965f, 5732.314941f, 5693.978516f, 5655.803223f, 5617.787598f,
+        5579.930176f, 5542.229492f, 5504.684082f, 5467.292480f, 5430.053711f, 5392.965820f,
+        5356.027344f, 5319.237305f, 5282.594727f, 5246.097168f, 5209.744629f, 5173.535156f,
+        5137.467773f, 5101.540527f, 5065.752930f, 5030.104004f, 4994.591797f, 4959.215332f,
+        4923.974121f, 4888.866211f, 4853.890625f, 4819.046387f, 4784.333008f, 4749.748047f,
+        4715.291504f, 4680.961914f, 4646.758789f, 4612.680176f, 4578.725586f, 4544.894043f,
+        4511.184570f, 4477.595703f, 4444.127441f, 4410.777832f, 4377.546387f, 4344.432129f,
+        4311.434570f, 4278.551758f, 4245.783691f, 4213.129395f, 4180.587402f, 4148.157715f,
+        4115.838867f, 4083.629883f, 4051.530273f, 4019.539307f, 3987.656006f, 3955.879639f,
+        3924.209229f, 3892.644043f, 3861.183350f, 3829.826416f, 3798.572510f, 3767.420654f,
+        3736.370361f, 3705.420898f, 3674.571289f, 3643.821045f, 3613.169434f, 3582.615479f,
+        3552.158936f, 3521.798584f, 3491.534180f, 3461.364990f, 3431.290283f, 3401.309326f,
+        3371.421631f, 3341.626221f, 3311.922852f, 3282.310547f, 3252.789062f, 3223.357666f,
+        3194.015381f, 3164.761963f, 3135.596924f, 3106.519287f, 3077.528564f, 3048.624512f,
+        3019.806152f, 2991.073242f, 2962.425049f, 2933.860840f, 2905.380371f, 2876.982910f,
+        2848.667969f, 2820.435303f, 2792.283691f, 2764.213379f, 2736.223389f, 2708.313232f,
+        2680.482422f, 2652.730713f, 2625.057373f, 2597.461914f, 2569.943848f, 2542.502686f,
+        2515.137939f, 2487.849365f, 2460.636230f, 2433.498047f, 2406.434570f, 2379.445312f,
+        2352.529541f, 2325.687012f, 2298.917480f, 2272.220215f, 2245.594727f, 2219.040771f,
+        2192.557861f, 2166.145752f, 2139.803711f, 2113.531494f, 2087.328613f, 2061.194824f,
+        2035.129517f, 2009.132446f, 1983.203125f, 1957.341187f, 1931.546143f, 1905.817749f,
+        1880.155640f, 1854.559326f, 1829.028564f, 1803.562744f, 1778.161743f, 1752.825073f,
+        1727.552368f, 1702.343384f, 1677.197510f, 1652.114746f, 1627.094482f, 1602.136353f,
+        1577.240234f, 1552.405518f, 1527.632080f, 1502.919556f, 1478.267456f, 1453.675537f,
+        1429.143555f, 1404.671143f, 1380.257935f, 1355.903564f, 1331.607788f, 1307.370361f,
+        1283.190918f, 1259.068970f, 1235.004517f, 1210.997070f, 1187.046265f, 1163.151978f,
+        1139.313843f, 1115.531616f, 1091.804932f, 1068.133423f, 1044.516968f, 1020.955200f,
+        997.447876f, 973.994629f, 950.595276f, 927.249512f, 903.957031f, 880.717590f,
+        857.530945f, 834.396790f, 811.314880f, 788.284912f, 765.306702f, 742.379944f,
+        719.504333f, 696.679749f, 673.905762f, 651.182251f, 628.508972f, 605.885559f,
+        583.311890f, 560.787720f, 538.312683f, 515.886658f, 493.509369f, 471.180573f,
+        448.900024f, 426.667542f, 404.482819f, 382.345703f, 360.255920f, 338.213257f,
+        316.217499f, 294.268402f, 272.365784f, 250.509369f, 228.698975f, 206.934387f,
+        185.215378f, 163.541748f, 141.913269f, 120.329750f, 98.790977f, 77.296738f,
+        55.846825f, 34.441044f, 13.079185f, -8.238950f, -29.513559f, -50.744843f,
+        -71.932999f, -93.078217f, -114.180695f, -135.240631f, -156.258209f, -177.233612f,
+        -198.167053f, -219.058685f, -239.908722f, -260.717346f, -281.484711f, -302.211060f,
+        -322.896484f, -343.541260f, -364.145508f, -384.709412f, -405.233154f, -425.716919f,
+        -446.160858f, -466.565155f, -486.929993f, -507.255524f, -527.541931f, -547.789368f,
+        -567.998047f, -588.168030f, -608.299622f, -628.392883f, -648.447998f, -668.465149f,
+        -688.444458f, -708.386108f,
+};
+
+/*****END OF FILE****/
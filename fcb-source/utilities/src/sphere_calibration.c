@@ -239,3 +239,25 @@ void calibrate(float32_t calibParams[6]) {
 	clearObservationMatrices();
 }
 
+// Saves the observation summary, so that samples can be added and fitted without losing an ongoing calibration
+void saveObservations(SphereObservations_t* observations) {
+	memcpy(observations->mu, mu, sizeof(mu));
+	memcpy(observations->mu2, mu2, sizeof(mu2));
+	memcpy(observations->ipXX, ipXX, sizeof(ipXX));
+	memcpy(observations->ipX2X, ipX2X, sizeof(ipX2X));
+	memcpy(observations->ipX2X2, ipX2X2, sizeof(ipX2X2));
+	observations->N = N;
+	memcpy(observations->obsMin, obsMin, sizeof(obsMin));
+	memcpy(observations->obsMax, obsMax, sizeof(obsMax));
+}
+
+void restoreObservations(const SphereObservations_t* observations) {
+	memcpy(mu, observations->mu, sizeof(mu));
+	memcpy(mu2, observations->mu2, sizeof(mu2));
+	memcpy(ipXX, observations->ipXX, sizeof(ipXX));
+	memcpy(ipX2X, observations->ipX2X, sizeof(ipX2X));
+	memcpy(ipX2X2, observations->ipX2X2, sizeof(ipX2X2));
+	N = observations->N;
+	memcpy(obsMin, observations->obsMin, sizeof(obsMin));
+	memcpy(obsMax, observations->obsMax, sizeof(obsMax));
+}
@@ -20,6 +20,8 @@
 #include <stdarg.h>
 #include <string.h>
 
+#if FCB_USE_TRACE
+
 /* Private defines */
 #ifndef TRACE_PRINTF_TMP_ARRAY_SIZE
 #define TRACE_PRINTF_TMP_ARRAY_SIZE (128)
@@ -78,6 +80,7 @@ int trace_printf(const char* format, ...) {
 	return ret;
 }
 
+#endif /* FCB_USE_TRACE */
 
 #if TODO
 int trace_sync(const char * fmt, ...) {
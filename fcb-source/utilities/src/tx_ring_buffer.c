@@ -0,0 +1,168 @@
+/******************************************************************************
+ * @file    tx_ring_buffer.c
+ * @author  Dragonfly
+ * @version v. 1.0.0
+ * @date    2016-06-01
+ * @brief   Functions for transmit ring buffers drained by chained DMA spans.
+ *
+ *          Producers append whole writes at the head, or drop them if they do
+ *          not fit. The transmitter takes the bytes from the tail as a span
+ *          that is contiguous in the storage array, i.e. up to the head or up
+ *          to the end of the array, and starts the next span from its
+ *          transfer complete interrupt until the buffer is empty.
+ *
+ *          Producers only write head and the transmitter only writes tail and
+ *          spanSize, so a single producer context and the transmit interrupt
+ *          need no locking. The functions do not access any hardware so that
+ *          the span chaining can be run in a host model.
+ ******************************************************************************/
+
+/* Includes -----------------------------------------------------------------*/
+#include "tx_ring_buffer.h"
+
+#include <string.h>
+
+/* Private typedef -----------------------------------------------------------*/
+/* Private define ------------------------------------------------------------*/
+/* Private macro -------------------------------------------------------------*/
+/* Private variables ---------------------------------------------------------*/
+/* Private function prototypes -----------------------------------------------*/
+static uint16_t GetUsed(const TxRingBuffer_TypeDef* buffer, const uint16_t head, const uint16_t tail);
+
+/* Exported functions --------------------------------------------------------*/
+
+/*
+ * @brief  Initializes a transmit ring buffer
+ * @param  buffer : Transmit ring buffer
+ * @param  bufferDataArray : Storage array
+ * @param  bufferDataArraySize : Storage array size, at most size - 1 bytes are buffered
+ * @retval None
+ */
+void TxRingBufferInit(TxRingBuffer_TypeDef* buffer, uint8_t* bufferDataArray, const uint16_t bufferDataArraySize) {
+    memset(buffer, 0, sizeof(TxRingBuffer_TypeDef));
+    buffer->bufferArray = bufferDataArray;
+    buffer->bufferSize = bufferDataArraySize;
+}
+
+/*
+ * @brief  Appends data to a transmit ring buffer. The data is appended as a whole or dropped.
+ * @param  buffer : Transmit ring buffer
+ * @param  putDataPtr : Data to append
+ * @param  putDataSize : Size of data to append
+ * @retval true if the data was appended, false if it was dropped because the buffer was full
+ */
+bool TxRingBufferPut(TxRingBuffer_TypeDef* buffer, const uint8_t* putDataPtr, const uint16_t putDataSize) {
+    const uint16_t head = buffer->head;
+    uint16_t firstPart;
+    uint16_t used;
+
+    if (putDataSize > TxRingBufferGetFree(buffer)) {
+        buffer->droppedWrites++;
+        buffer->droppedBytes += putDataSize;
+        return false;
+    }
+
+    /* Copy up to the end of the storage array and wrap around with the rest */
+    firstPart = buffer->bufferSize - head;
+    if (firstPart > putDataSize)
+        firstPart = putDataSize;
+    memcpy(&buffer->bufferArray[head], putDataPtr, firstPart);
+    memcpy(buffer->bufferArray, &putDataPtr[firstPart], putDataSize - firstPart);
+
+    /* Publish the data to the transmitter only once it has been copied */
+    buffer->head = (head + putDataSize) % buffer->bufferSize;
+
+    used = GetUsed(buffer, buffer->head, buffer->tail);
+    if (used > buffer->maxUsed)
+        buffer->maxUsed = used;
+    return true;
+}
+
+/*
+ * @brief  Returns the free space of a transmit ring buffer
+ * @param  buffer : Transmit ring buffer
+ * @retval Bytes that can be appended
+ */
+uint16_t TxRingBufferGetFree(const TxRingBuffer_TypeDef* buffer) {
+    return buffer->bufferSize - 1 - GetUsed(buffer, buffer->head, buffer->tail);
+}
+
+/*
+ * @brief  Takes the next span to send, if no span is in progress
+ * @param  buffer : Transmit ring buffer
+ * @param  spanDataPtr : Destination of the span start
+ * @param  spanDataSize : Destination of the span size
+ * @retval true if a span was taken, false if a span is in progress or the buffer is empty
+ */
+bool TxRingBufferStartSpan(TxRingBuffer_TypeDef* buffer, uint8_t** spanDataPtr, uint16_t* spanDataSize) {
+    const uint16_t head = buffer->head;
+    const uint16_t tail = buffer->tail;
+
+    if (buffer->spanSize != 0 || head == tail)
+        return false;
+
+    /* The span ends at the head, or at the end of the storage array if the data wraps around */
+    buffer->spanSize = (head > tail) ? head - tail : buffer->bufferSize - tail;
+    buffer->spans++;
+
+    *spanDataPtr = &buffer->bufferArray[tail];
+    *spanDataSize = buffer->spanSize;
+    return true;
+}
+
+/*
+ * @brief  Releases the span in progress after it has been sent
+ * @param  buffer : Transmit ring buffer
+ * @retval None
+ */
+void TxRingBufferCompleteSpan(TxRingBuffer_TypeDef* buffer) {
+    buffer->tail = (buffer->tail + buffer->spanSize) % buffer->bufferSize;
+    buffer->sentBytes += buffer->spanSize;
+    buffer->spanSize = 0;
+}
+
+/*
+ * @brief  Aborts the span in progress. The bytes of the span that were sent are released, the next span starts with
+ *         the first byte that was not sent.
+ * @param  buffer : Transmit ring buffer
+ * @param  sentSize : Bytes of the span that were sent, at most the span size
+ * @retval None
+ */
+void TxRingBufferAbortSpan(TxRingBuffer_TypeDef* buffer, const uint16_t sentSize) {
+    const uint16_t releasedSize = (sentSize < buffer->spanSize) ? sentSize : buffer->spanSize;
+
+    buffer->tail = (buffer->tail + releasedSize) % buffer->bufferSize;
+    buffer->sentBytes += releasedSize;
+    buffer->spanSize = 0;
+}
+
+/*
+ * @brief  Checks if a transmit ring buffer has no span in progress
+ * @param  buffer : Transmit ring buffer
+ * @retval true if no span is in progress, else false
+ */
+bool TxRingBufferIsIdle(const TxRingBuffer_TypeDef* buffer) {
+    return buffer->spanSize == 0;
+}
+
+/* Private functions ---------------------------------------------------------*/
+
+/*
+ * @brief  Returns the bytes buffered between a tail and a head
+ * @param  buffer : Transmit ring buffer
+ * @param  head : Head index
+ * @param  tail : Tail index
+ * @retval Buffered bytes, including the span in progress
+ */
+static uint16_t GetUsed(const TxRingBuffer_TypeDef* buffer, const uint16_t head, const uint16_t tail) {
+    return (head >= tail) ? head - tail : buffer->bufferSize - tail + head;
+}
+
+/**
+ * @}
+ */
+
+/**
+ * @}
+ */
+/*****END OF FILE****/